@@ -61,6 +61,9 @@
 #include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/model_library.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/quick_scorer_extended.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/register_engines.h"
 #include "yggdrasil_decision_forests/utils/benchmark/inference.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
 
@@ -80,6 +83,15 @@ ABSL_FLAG(bool, generic, true,
           "Evaluates the slow engine i.e. model->predict(). The "
           "generic engine is slow and mostly a reference. Disable it if the "
           "benchmark runs for too long.");
+ABSL_FLAG(bool, instruction_sets, true,
+          "If the model is compatible with the QuickScorer engine, also "
+          "benchmarks it with each of the available SIMD instruction sets "
+          "(AVX2, AVX-512), and reports the speedup of AVX-512 over AVX2.");
+ABSL_FLAG(bool, node_layouts, true,
+          "Also benchmarks the engines using flat node models (i.e. all the "
+          "engines except QuickScorer) with each node layout (DEPTH_FIRST, "
+          "BREADTH_FIRST, VISIT_FREQUENCY), and reports the speedup of each "
+          "layout over DEPTH_FIRST (the default).");
 
 constexpr char kUsageMessage[] =
     "Benchmarks the inference time of a model with the available inference "
@@ -150,14 +162,33 @@ absl::Status Benchmark() {
   const auto engine_factories = model->ListCompatibleFastEngines();
   YDF_LOG(INFO) << "Found " << engine_factories.size()
                 << " compatible fast engines.";
+  bool has_quick_scorer = false;
   for (const auto& engine_factory : engine_factories) {
     YDF_LOG(INFO) << "Running " << engine_factory->name();
+    has_quick_scorer |= engine_factory->name() ==
+                        serving::gradient_boosted_trees::kQuickScorerExtended;
     ASSIGN_OR_RETURN(auto engine, engine_factory->CreateEngine(model.get()));
     RETURN_IF_ERROR(utils::BenchmarkFastEngine(options, *engine.get(),
                                                *model.get(), dataset, &results,
                                                engine_factory->name()));
   }
 
+  absl::optional<utils::QuickScorerInstructionSetSpeedup> avx512_speedup;
+  if (has_quick_scorer && absl::GetFlag(FLAGS_instruction_sets)) {
+    YDF_LOG(INFO) << "Running the QuickScorer engine with each instruction set";
+    ASSIGN_OR_RETURN(avx512_speedup,
+                     utils::BenchmarkQuickScorerInstructionSets(
+                         options, *model, dataset, &results));
+  }
+
+  std::vector<utils::NodeLayoutSpeedup> node_layout_speedups;
+  if (absl::GetFlag(FLAGS_node_layouts)) {
+    YDF_LOG(INFO) << "Running the engines with each node layout";
+    ASSIGN_OR_RETURN(
+        node_layout_speedups,
+        utils::BenchmarkNodeLayouts(options, *model, dataset, &results));
+  }
+
   if (absl::GetFlag(FLAGS_generic)) {
     YDF_LOG(INFO) << "Running the slow generic engine";
     RETURN_IF_ERROR(
@@ -166,6 +197,18 @@ absl::Status Benchmark() {
 
   // Show results.
   std::cout << ResultsToString(options, results);
+  if (avx512_speedup.has_value()) {
+    std::cout << "QuickScorer AVX-512 speedup over "
+              << serving::decision_forest::QuickScorerInstructionSetName(
+                     avx512_speedup->baseline)
+              << ": " << avx512_speedup->speedup << "x\n";
+  }
+  for (const auto& speedup : node_layout_speedups) {
+    std::cout << speedup.engine_name << " "
+              << serving::decision_forest::NodeLayoutName(speedup.node_layout)
+              << " node layout speedup over DEPTH_FIRST: " << speedup.speedup
+              << "x\n";
+  }
   return absl::OkStatus();
 }
 
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Computes the SHAP values of the predictions of a decision forest model, and
+// exports them in a csv file.
+//
+// The csv file contains one row per example, and one column per input feature
+// and model output (e.g. "age" for a regression or binary classification
+// model, "age:0", "age:1", ... for a multi-class classification model). The
+// last columns ("expected_value" or "expected_value:<output>") contain the
+// expected value of the model output. The expected value plus the SHAP values
+// of an example are equal to the raw model output (e.g. the logit of a
+// Gradient Boosted Trees classification model).
+//
+// If "background_dataset" is set, the interventional SHAP values are computed
+// with the examples of this dataset as background. Otherwise, the
+// path-dependent SHAP values are computed using the training statistics stored
+// in the model.
+//
+// Usage example:
+//
+// :train ... --dataset=csv:train.csv --output=model
+// :compute_shap_values --model=model --dataset=csv:test.csv \
+//   --output=csv:shap_values.csv
+//
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "yggdrasil_decision_forests/dataset/formats.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/model_library.h"
+#include "yggdrasil_decision_forests/utils/csv.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/logging.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
+
+ABSL_FLAG(std::string, model, "", "Model directory.");
+ABSL_FLAG(std::string, dataset, "",
+          "Typed path to dataset i.e. [type]:[path] format.");
+ABSL_FLAG(std::string, background_dataset, "",
+          "Optional typed path to the background dataset of the "
+          "interventional SHAP values. If not set, the path-dependent SHAP "
+          "values are computed.");
+ABSL_FLAG(std::string, output, "",
+          "Output csv file containing the SHAP values. Only the csv format is "
+          "supported e.g. \"csv:/path/to/shap.csv\".");
+ABSL_FLAG(int, num_io_threads, 10,
+          "Number of threads used to read the dataset.");
+ABSL_FLAG(int, num_compute_threads, 6,
+          "Number of threads used for the computation.");
+
+constexpr char kUsageMessage[] =
+    "Computes the SHAP values of the predictions of a decision forest model.";
+
+namespace yggdrasil_decision_forests {
+namespace cli {
+
+absl::Status WriteShapValues(const model::AbstractModel& model,
+                             const model::ShapValues& shap_values,
+                             const std::string& typed_path) {
+  ASSIGN_OR_RETURN(const auto type_and_path,
+                   dataset::SplitTypeAndPath(typed_path));
+  if (type_and_path.first != dataset::FORMAT_CSV) {
+    return absl::InvalidArgumentError(
+        "Only the csv format is supported for the output");
+  }
+  ASSIGN_OR_RETURN(auto file_handle,
+                   file::OpenOutputFile(type_and_path.second));
+  file::OutputFileCloser closer(std::move(file_handle));
+  utils::csv::Writer writer(closer.stream());
+
+  const auto column_name = [&](const std::string& name, const int output_idx) {
+    return shap_values.num_outputs == 1 ? name
+                                        : absl::StrCat(name, ":", output_idx);
+  };
+
+  std::vector<std::string> row;
+  for (const int feature_idx : model.input_features()) {
+    for (int output_idx = 0; output_idx < shap_values.num_outputs;
+         output_idx++) {
+      row.push_back(
+          column_name(model.data_spec().columns(feature_idx).name(),
+                      output_idx));
+    }
+  }
+  for (int output_idx = 0; output_idx < shap_values.num_outputs;
+       output_idx++) {
+    row.push_back(column_name("expected_value", output_idx));
+  }
+  RETURN_IF_ERROR(writer.WriteRowStrings(row));
+
+  for (int64_t example_idx = 0; example_idx < shap_values.num_examples;
+       example_idx++) {
+    row.clear();
+    for (const int feature_idx : model.input_features()) {
+      for (int output_idx = 0; output_idx < shap_values.num_outputs;
+           output_idx++) {
+        row.push_back(absl::StrCat(
+            shap_values.value(example_idx, feature_idx, output_idx)));
+      }
+    }
+    for (const float expected_value : shap_values.expected_values) {
+      row.push_back(absl::StrCat(expected_value));
+    }
+    RETURN_IF_ERROR(writer.WriteRowStrings(row));
+  }
+  return closer.Close();
+}
+
+void ComputeShapValues() {
+  // Check required flags.
+  QCHECK(!absl::GetFlag(FLAGS_model).empty());
+  QCHECK(!absl::GetFlag(FLAGS_dataset).empty());
+  QCHECK(!absl::GetFlag(FLAGS_output).empty());
+
+  YDF_LOG(INFO) << "Load model";
+  std::unique_ptr<model::AbstractModel> model;
+  QCHECK_OK(model::LoadModel(absl::GetFlag(FLAGS_model), &model));
+
+  YDF_LOG(INFO) << "Load dataset";
+  dataset::LoadConfig read_dataset_options;
+  read_dataset_options.num_threads = absl::GetFlag(FLAGS_num_io_threads);
+  dataset::VerticalDataset dataset;
+  QCHECK_OK(dataset::LoadVerticalDataset(
+      absl::GetFlag(FLAGS_dataset), model->data_spec(), &dataset,
+      /*ensure_non_missing=*/model->input_features(), read_dataset_options));
+
+  model::ShapOptions options;
+  options.num_threads = absl::GetFlag(FLAGS_num_compute_threads);
+  dataset::VerticalDataset background;
+  if (!absl::GetFlag(FLAGS_background_dataset).empty()) {
+    YDF_LOG(INFO) << "Load background dataset";
+    QCHECK_OK(dataset::LoadVerticalDataset(
+        absl::GetFlag(FLAGS_background_dataset), model->data_spec(),
+        &background,
+        /*ensure_non_missing=*/model->input_features(), read_dataset_options));
+    options.background = &background;
+  }
+
+  YDF_LOG(INFO) << "Compute the SHAP values";
+  model::ShapValues shap_values;
+  QCHECK_OK(model->ComputeShapValues(dataset, options, &shap_values));
+
+  YDF_LOG(INFO) << "Export the SHAP values";
+  QCHECK_OK(WriteShapValues(*model, shap_values, absl::GetFlag(FLAGS_output)));
+}
+
+}  // namespace cli
+}  // namespace yggdrasil_decision_forests
+
+int main(int argc, char** argv) {
+  InitLogging(kUsageMessage, &argc, &argv, true);
+  yggdrasil_decision_forests::cli::ComputeShapValues();
+  return 0;
+}
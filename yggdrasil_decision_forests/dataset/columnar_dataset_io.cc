@@ -0,0 +1,647 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/dataset/columnar_dataset_io.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "yggdrasil_decision_forests/dataset/columnar_dataset.pb.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/example.pb.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/memory_mapped_file.h"
+#include "yggdrasil_decision_forests/utils/sharded_io.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+namespace {
+
+using Header = proto::ColumnarDatasetHeader;
+using row_t = VerticalDataset::row_t;
+
+constexpr char kMagic[8] = {'Y', 'D', 'F', 'C', 'O', 'L', 'S', '\0'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+// Size of the fixed part of the file before the header proto.
+constexpr size_t kPrefixSize = 24;
+
+// Alignment of the arrays, relative to the start of the file. A memory page,
+// so that each array of a mapped file starts on a page boundary.
+constexpr size_t kSectionAlignment = 4096;
+
+// Representation of the "[begin, end)" ranges of multi-value columns.
+using Range = std::pair<uint64_t, uint64_t>;
+
+size_t Align(const size_t value) {
+  return (value + kSectionAlignment - 1) / kSectionAlignment *
+         kSectionAlignment;
+}
+
+template <typename T>
+absl::string_view AsBytes(const std::vector<T>& values) {
+  return absl::string_view(reinterpret_cast<const char*>(values.data()),
+                           values.size() * sizeof(T));
+}
+
+// Arrays of a multi-value column: The ranges and the bank of values.
+template <typename T>
+void MultiValueSections(const VerticalDataset::AbstractColumn& column,
+                        std::deque<std::string>* buffers,
+                        std::vector<absl::string_view>* sections) {
+  const auto& cast_column =
+      static_cast<const VerticalDataset::TemplateMultiValueStorage<T>&>(
+          column);
+  std::vector<Range> ranges(cast_column.values().begin(),
+                            cast_column.values().end());
+  buffers->emplace_back(AsBytes(ranges));
+  sections->push_back(buffers->back());
+  sections->push_back(AsBytes(cast_column.bank()));
+}
+
+// Lists the arrays containing the values of a column. The arrays are either
+// the storage of the column, or copies stored in "buffers".
+absl::Status ColumnSections(const VerticalDataset::AbstractColumn& column,
+                            std::deque<std::string>* buffers,
+                            std::vector<absl::string_view>* sections) {
+  switch (column.type()) {
+    case proto::ColumnType::NUMERICAL:
+      sections->push_back(AsBytes(
+          static_cast<const VerticalDataset::NumericalColumn&>(column)
+              .values()));
+      break;
+    case proto::ColumnType::DISCRETIZED_NUMERICAL:
+      sections->push_back(AsBytes(
+          static_cast<const VerticalDataset::DiscretizedNumericalColumn&>(
+              column)
+              .values()));
+      break;
+    case proto::ColumnType::CATEGORICAL:
+      sections->push_back(AsBytes(
+          static_cast<const VerticalDataset::CategoricalColumn&>(column)
+              .values()));
+      break;
+    case proto::ColumnType::BOOLEAN:
+      sections->push_back(AsBytes(
+          static_cast<const VerticalDataset::BooleanColumn&>(column).values()));
+      break;
+    case proto::ColumnType::HASH:
+      sections->push_back(AsBytes(
+          static_cast<const VerticalDataset::HashColumn&>(column).values()));
+      break;
+    case proto::ColumnType::NUMERICAL_SET:
+    case proto::ColumnType::NUMERICAL_LIST:
+      MultiValueSections<float>(column, buffers, sections);
+      break;
+    case proto::ColumnType::CATEGORICAL_SET:
+    case proto::ColumnType::CATEGORICAL_LIST:
+      MultiValueSections<int32_t>(column, buffers, sections);
+      break;
+    case proto::ColumnType::STRING: {
+      // The end offset of each value, the concatenated values, and the
+      // missing flags.
+      const auto& cast_column =
+          static_cast<const VerticalDataset::StringColumn&>(column);
+      std::vector<uint64_t> ends;
+      std::string content;
+      std::vector<char> is_na;
+      ends.reserve(column.nrows());
+      is_na.reserve(column.nrows());
+      for (row_t row = 0; row < column.nrows(); row++) {
+        content.append(cast_column.values()[row]);
+        ends.push_back(content.size());
+        is_na.push_back(cast_column.IsNa(row));
+      }
+      buffers->emplace_back(AsBytes(ends));
+      sections->push_back(buffers->back());
+      buffers->push_back(std::move(content));
+      sections->push_back(buffers->back());
+      buffers->emplace_back(AsBytes(is_na));
+      sections->push_back(buffers->back());
+    } break;
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Column \"", column.name(), "\" of type ",
+                       proto::ColumnType_Name(column.type()),
+                       " is not supported by the columnar dataset format"));
+  }
+  return absl::OkStatus();
+}
+
+// Parses the fixed prefix and the header of a columnar dataset. "data_begin"
+// is the offset of the arrays in the file.
+absl::Status ParseHeader(const absl::string_view content, Header* header,
+                         size_t* data_begin) {
+  if (content.size() < kPrefixSize ||
+      std::memcmp(content.data(), kMagic, sizeof(kMagic)) != 0) {
+    return absl::InvalidArgumentError("Not a columnar dataset");
+  }
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint64_t header_size;
+  std::memcpy(&version, content.data() + 8, sizeof(version));
+  std::memcpy(&byte_order_mark, content.data() + 12, sizeof(byte_order_mark));
+  std::memcpy(&header_size, content.data() + 16, sizeof(header_size));
+  if (version != kColumnarDatasetVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unsupported columnar dataset version ", version,
+                     ". Expecting version ", kColumnarDatasetVersion));
+  }
+  if (byte_order_mark != kByteOrderMark) {
+    return absl::InvalidArgumentError(
+        "The columnar dataset was created on a platform with a different byte "
+        "order");
+  }
+  if (header_size > content.size() - kPrefixSize ||
+      !header->ParseFromArray(content.data() + kPrefixSize, header_size)) {
+    return absl::InvalidArgumentError("Cannot parse columnar dataset header");
+  }
+  if (header->columns_size() != header->data_spec().columns_size()) {
+    return absl::InvalidArgumentError("Invalid columnar dataset header");
+  }
+  *data_begin = Align(kPrefixSize + header_size);
+  return absl::OkStatus();
+}
+
+// Gets the arrays of a column.
+absl::Status GetSections(const absl::string_view content,
+                         const size_t data_begin, const Header::Column& column,
+                         std::vector<absl::string_view>* sections) {
+  sections->clear();
+  // Number of bytes available for the arrays. The checks below cannot
+  // overflow, even with corrupted offsets and sizes.
+  const uint64_t data_size =
+      content.size() > data_begin ? content.size() - data_begin : 0;
+  for (const auto& section : column.sections()) {
+    if (section.offset() < 0 || section.size() < 0 ||
+        static_cast<uint64_t>(section.offset()) > data_size ||
+        static_cast<uint64_t>(section.size()) > data_size - section.offset()) {
+      return absl::InvalidArgumentError(
+          "Truncated or invalid columnar dataset");
+    }
+    sections->push_back(
+        content.substr(data_begin + section.offset(), section.size()));
+  }
+  return absl::OkStatus();
+}
+
+// Appends the "num_values" values of an array at the end of "dst".
+template <typename T>
+absl::Status AppendArray(const absl::string_view bytes, const size_t num_values,
+                         std::vector<T>* dst) {
+  // Note: "num_values" is not multiplied by "sizeof(T)" since it is read from
+  // the file and the product could overflow.
+  if (bytes.size() % sizeof(T) != 0 || num_values != bytes.size() / sizeof(T)) {
+    return absl::InvalidArgumentError("Invalid columnar dataset array size");
+  }
+  const size_t begin = dst->size();
+  dst->resize(begin + num_values);
+  std::memcpy(dst->data() + begin, bytes.data(), bytes.size());
+  return absl::OkStatus();
+}
+
+template <typename Column>
+absl::Status AppendScalarColumn(const std::vector<absl::string_view>& sections,
+                                const row_t num_rows,
+                                VerticalDataset::AbstractColumn* dst) {
+  STATUS_CHECK_EQ(sections.size(), 1);
+  return AppendArray(sections[0], num_rows,
+                     static_cast<Column*>(dst)->mutable_values());
+}
+
+template <typename T>
+absl::Status AppendMultiValueColumn(
+    const std::vector<absl::string_view>& sections, const row_t num_rows,
+    VerticalDataset::AbstractColumn* dst) {
+  STATUS_CHECK_EQ(sections.size(), 2);
+  auto* cast_dst =
+      static_cast<VerticalDataset::TemplateMultiValueStorage<T>*>(dst);
+  std::vector<Range> ranges;
+  RETURN_IF_ERROR(AppendArray(sections[0], num_rows, &ranges));
+  const size_t bank_begin = cast_dst->bank().size();
+  const size_t bank_size = sections[1].size() / sizeof(T);
+  RETURN_IF_ERROR(
+      AppendArray(sections[1], bank_size, &cast_dst->mutable_bank()));
+  auto& dst_ranges = cast_dst->mutable_values();
+  dst_ranges.reserve(dst_ranges.size() + num_rows);
+  for (const auto& range : ranges) {
+    // {1, 0} is the representation of a missing value.
+    const bool is_na = range.first == 1 && range.second == 0;
+    if (!is_na && (range.first > range.second || range.second > bank_size)) {
+      return absl::InvalidArgumentError("Invalid columnar dataset range");
+    }
+    dst_ranges.emplace_back(bank_begin + range.first,
+                            bank_begin + range.second);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AppendStringColumn(const std::vector<absl::string_view>& sections,
+                                const row_t num_rows,
+                                VerticalDataset::AbstractColumn* dst) {
+  STATUS_CHECK_EQ(sections.size(), 3);
+  auto* cast_dst = static_cast<VerticalDataset::StringColumn*>(dst);
+  std::vector<uint64_t> ends;
+  std::vector<char> is_na;
+  RETURN_IF_ERROR(AppendArray(sections[0], num_rows, &ends));
+  RETURN_IF_ERROR(AppendArray(sections[2], num_rows, &is_na));
+  const absl::string_view content = sections[1];
+  uint64_t begin = 0;
+  for (row_t row = 0; row < num_rows; row++) {
+    if (ends[row] < begin || ends[row] > content.size()) {
+      return absl::InvalidArgumentError("Invalid columnar dataset string");
+    }
+    if (is_na[row]) {
+      cast_dst->AddNA();
+    } else {
+      cast_dst->Add(std::string(content.substr(begin, ends[row] - begin)));
+    }
+    begin = ends[row];
+  }
+  return absl::OkStatus();
+}
+
+// Appends the values of a column stored in the file.
+absl::Status AppendColumn(const std::vector<absl::string_view>& sections,
+                          const row_t num_rows,
+                          VerticalDataset::AbstractColumn* dst) {
+  switch (dst->type()) {
+    case proto::ColumnType::NUMERICAL:
+      return AppendScalarColumn<VerticalDataset::NumericalColumn>(
+          sections, num_rows, dst);
+    case proto::ColumnType::DISCRETIZED_NUMERICAL:
+      return AppendScalarColumn<VerticalDataset::DiscretizedNumericalColumn>(
+          sections, num_rows, dst);
+    case proto::ColumnType::CATEGORICAL:
+      return AppendScalarColumn<VerticalDataset::CategoricalColumn>(
+          sections, num_rows, dst);
+    case proto::ColumnType::BOOLEAN:
+      return AppendScalarColumn<VerticalDataset::BooleanColumn>(
+          sections, num_rows, dst);
+    case proto::ColumnType::HASH:
+      return AppendScalarColumn<VerticalDataset::HashColumn>(sections,
+                                                             num_rows, dst);
+    case proto::ColumnType::NUMERICAL_SET:
+    case proto::ColumnType::NUMERICAL_LIST:
+      return AppendMultiValueColumn<float>(sections, num_rows, dst);
+    case proto::ColumnType::CATEGORICAL_SET:
+    case proto::ColumnType::CATEGORICAL_LIST:
+      return AppendMultiValueColumn<int32_t>(sections, num_rows, dst);
+    case proto::ColumnType::STRING:
+      return AppendStringColumn(sections, num_rows, dst);
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Column \"", dst->name(), "\" of type ",
+                       proto::ColumnType_Name(dst->type()),
+                       " is not supported by the columnar dataset format"));
+  }
+}
+
+// Checks that the categorical values stored in "bytes" are missing (if
+// "allow_na") or in the dictionary of "spec".
+absl::Status CheckCategoricalValues(const absl::string_view bytes,
+                                    const proto::Column& spec,
+                                    const bool allow_na) {
+  const int32_t num_values = spec.categorical().number_of_unique_values();
+  for (size_t begin = 0; begin + sizeof(int32_t) <= bytes.size();
+       begin += sizeof(int32_t)) {
+    int32_t value;
+    std::memcpy(&value, bytes.data() + begin, sizeof(value));
+    if ((value < 0 || value >= num_values) &&
+        !(allow_na &&
+          value == VerticalDataset::CategoricalColumn::kNaValue)) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The column \"", spec.name(), "\" contains the categorical value ",
+          value, " but the dataspec only has ", num_values, " values"));
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Checks that the values of a column stored as "sections" can be copied as is
+// in a column of the dataspec "spec".
+absl::Status CheckBulkCopiedValues(
+    const std::vector<absl::string_view>& sections, const proto::Column& spec) {
+  switch (spec.type()) {
+    case proto::ColumnType::CATEGORICAL:
+      STATUS_CHECK_EQ(sections.size(), 1);
+      return CheckCategoricalValues(sections[0], spec, /*allow_na=*/true);
+    case proto::ColumnType::CATEGORICAL_SET:
+    case proto::ColumnType::CATEGORICAL_LIST:
+      STATUS_CHECK_EQ(sections.size(), 2);
+      return CheckCategoricalValues(sections[1], spec, /*allow_na=*/false);
+    default:
+      return absl::OkStatus();
+  }
+}
+
+// Tests if the values of a column encoded with "a" can be used as is with "b".
+bool SameValueEncoding(const proto::Column& a, const proto::Column& b) {
+  if (a.type() != b.type()) {
+    return false;
+  }
+  switch (a.type()) {
+    case proto::ColumnType::CATEGORICAL:
+    case proto::ColumnType::CATEGORICAL_SET:
+    case proto::ColumnType::CATEGORICAL_LIST: {
+      if (a.categorical().is_already_integerized() !=
+          b.categorical().is_already_integerized()) {
+        return false;
+      }
+      if (a.categorical().is_already_integerized()) {
+        return true;
+      }
+      const auto& a_items = a.categorical().items();
+      const auto& b_items = b.categorical().items();
+      if (a_items.size() != b_items.size()) {
+        return false;
+      }
+      for (const auto& b_item : b_items) {
+        const auto it = a_items.find(b_item.first);
+        if (it == a_items.end() ||
+            it->second.index() != b_item.second.index()) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case proto::ColumnType::DISCRETIZED_NUMERICAL: {
+      const auto& a_boundaries = a.discretized_numerical().boundaries();
+      const auto& b_boundaries = b.discretized_numerical().boundaries();
+      return std::equal(a_boundaries.begin(), a_boundaries.end(),
+                        b_boundaries.begin(), b_boundaries.end());
+    }
+    default:
+      return true;
+  }
+}
+
+}  // namespace
+
+absl::Status SaveColumnarDataset(const VerticalDataset& dataset,
+                                 const absl::string_view path) {
+  Header header;
+  *header.mutable_data_spec() = dataset.data_spec();
+  header.set_num_rows(dataset.nrow());
+
+  // Arrays of all the columns, in order.
+  std::deque<std::string> buffers;
+  std::vector<absl::string_view> sections;
+  size_t offset = 0;
+  for (int col_idx = 0; col_idx < dataset.ncol(); col_idx++) {
+    const auto* column = dataset.column(col_idx);
+    if (column->nrows() != dataset.nrow()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The column \"", column->name(), "\" has ", column->nrows(),
+          " values while the dataset has ", dataset.nrow(),
+          " rows. Only datasets with all the columns loaded can be saved."));
+    }
+    const size_t begin = sections.size();
+    RETURN_IF_ERROR(ColumnSections(*column, &buffers, &sections));
+    auto* header_column = header.add_columns();
+    for (size_t section_idx = begin; section_idx < sections.size();
+         section_idx++) {
+      offset = Align(offset);
+      auto* location = header_column->add_sections();
+      location->set_offset(offset);
+      location->set_size(sections[section_idx].size());
+      offset += sections[section_idx].size();
+    }
+  }
+
+  const std::string serialized_header = header.SerializeAsString();
+  const uint64_t header_size = serialized_header.size();
+  char prefix[kPrefixSize];
+  std::memcpy(prefix, kMagic, sizeof(kMagic));
+  std::memcpy(prefix + 8, &kColumnarDatasetVersion,
+              sizeof(kColumnarDatasetVersion));
+  std::memcpy(prefix + 12, &kByteOrderMark, sizeof(kByteOrderMark));
+  std::memcpy(prefix + 16, &header_size, sizeof(header_size));
+
+  const std::string padding(kSectionAlignment, 0);
+  ASSIGN_OR_RETURN(auto file, file::OpenOutputFile(path));
+  file::OutputFileCloser closer(std::move(file));
+  RETURN_IF_ERROR(
+      closer.stream()->Write(absl::string_view(prefix, kPrefixSize)));
+  RETURN_IF_ERROR(closer.stream()->Write(serialized_header));
+  RETURN_IF_ERROR(closer.stream()->Write(absl::string_view(
+      padding.data(),
+      Align(kPrefixSize + header_size) - kPrefixSize - header_size)));
+  size_t position = 0;
+  int section_idx = 0;
+  for (const auto& column : header.columns()) {
+    for (const auto& location : column.sections()) {
+      RETURN_IF_ERROR(closer.stream()->Write(
+          absl::string_view(padding.data(), location.offset() - position)));
+      RETURN_IF_ERROR(closer.stream()->Write(sections[section_idx++]));
+      position = location.offset() + location.size();
+    }
+  }
+  return closer.Close();
+}
+
+absl::Status SaveShardedColumnarDataset(const VerticalDataset& dataset,
+                                        const absl::string_view sharded_path,
+                                        const int64_t num_records_by_shard) {
+  std::vector<std::string> paths;
+  RETURN_IF_ERROR(utils::ExpandOutputShards(sharded_path, &paths));
+  if (paths.size() == 1) {
+    return SaveColumnarDataset(dataset, paths.front());
+  }
+
+  const row_t num_rows = dataset.nrow();
+  const int64_t num_shards = paths.size();
+  const int64_t rows_per_shard =
+      num_records_by_shard == -1 ? (num_rows + num_shards - 1) / num_shards
+                                 : num_records_by_shard;
+  std::vector<row_t> rows;
+  for (int64_t shard_idx = 0; shard_idx < num_shards; shard_idx++) {
+    const row_t begin = std::min<row_t>(shard_idx * rows_per_shard, num_rows);
+    const row_t end = shard_idx == num_shards - 1
+                          ? num_rows
+                          : std::min<row_t>(begin + rows_per_shard, num_rows);
+    rows.resize(end - begin);
+    std::iota(rows.begin(), rows.end(), begin);
+    ASSIGN_OR_RETURN(const auto shard, dataset.Extract(rows));
+    RETURN_IF_ERROR(SaveColumnarDataset(shard, paths[shard_idx]));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<proto::ColumnarDatasetHeader> ReadColumnarDatasetHeader(
+    const absl::string_view path) {
+  ASSIGN_OR_RETURN(const auto file, utils::MemoryMappedFile::Open(path));
+  Header header;
+  size_t data_begin;
+  RETURN_IF_ERROR(ParseHeader(file->content(), &header, &data_begin));
+  return header;
+}
+
+absl::Status AppendColumnarDataset(
+    const absl::string_view path, const proto::DataSpecification& data_spec,
+    const absl::optional<std::vector<int>>& required_columns,
+    const absl::optional<std::vector<int>>& load_columns,
+    VerticalDataset* dataset) {
+  ASSIGN_OR_RETURN(const auto file, utils::MemoryMappedFile::Open(path));
+  const absl::string_view content = file->content();
+  Header header;
+  size_t data_begin;
+  RETURN_IF_ERROR(ParseHeader(content, &header, &data_begin));
+  const auto& file_data_spec = header.data_spec();
+  const row_t num_rows = header.num_rows();
+  // Each row occupies at least one byte in each column of the file.
+  if (num_rows < 0 || (file_data_spec.columns_size() > 0 &&
+                       static_cast<uint64_t>(num_rows) > content.size())) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid number of rows ", num_rows, " in ", path));
+  }
+
+  // Match the columns by name.
+  std::vector<std::string> file_column_names;
+  file_column_names.reserve(file_data_spec.columns_size());
+  for (const auto& column : file_data_spec.columns()) {
+    file_column_names.push_back(column.name());
+  }
+  std::vector<int> col_idx_to_file_col_idx;
+  RETURN_IF_ERROR(BuildColIdxToFeatureLabelIdx(data_spec, file_column_names,
+                                               required_columns,
+                                               &col_idx_to_file_col_idx));
+
+  std::vector<int> col_idxs;
+  if (load_columns.has_value()) {
+    col_idxs = load_columns.value();
+  } else {
+    col_idxs.resize(data_spec.columns_size());
+    std::iota(col_idxs.begin(), col_idxs.end(), 0);
+  }
+
+  std::vector<absl::string_view> sections;
+  for (const int col_idx : col_idxs) {
+    auto* dst = dataset->mutable_column(col_idx);
+    const int file_col_idx = col_idx_to_file_col_idx[col_idx];
+    if (file_col_idx == -1) {
+      // The column is not in the file.
+      dst->Reserve(dst->nrows() + num_rows);
+      for (row_t row = 0; row < num_rows; row++) {
+        dst->AddNA();
+      }
+      continue;
+    }
+    const auto& src_spec = file_data_spec.columns(file_col_idx);
+    const auto& dst_spec = data_spec.columns(col_idx);
+    if (src_spec.type() != dst_spec.type()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The column \"", dst_spec.name(), "\" is ",
+          proto::ColumnType_Name(src_spec.type()), " in ", path, " but ",
+          proto::ColumnType_Name(dst_spec.type()), " in the dataspec"));
+    }
+    RETURN_IF_ERROR(GetSections(content, data_begin,
+                                header.columns(file_col_idx), &sections));
+    if (SameValueEncoding(src_spec, dst_spec)) {
+      // Bulk copy of the values. The values are checked since the file could
+      // contain values outside of the dictionary of the dataspec.
+      RETURN_IF_ERROR(CheckBulkCopiedValues(sections, dst_spec));
+      RETURN_IF_ERROR(AppendColumn(sections, num_rows, dst));
+    } else {
+      // Convert the values to the dictionary of the dataspec.
+      ASSIGN_OR_RETURN(auto src,
+                       CreateColumn(src_spec.type(), src_spec.name()));
+      RETURN_IF_ERROR(AppendColumn(sections, num_rows, src.get()));
+      ASSIGN_OR_RETURN(auto converted,
+                       CreateColumn(dst_spec.type(), dst_spec.name()));
+      RETURN_IF_ERROR(
+          src->ConvertToGivenDataspec(converted.get(), src_spec, dst_spec));
+      RETURN_IF_ERROR(AppendColumnValues(*converted, dst));
+    }
+  }
+  dataset->set_nrow(dataset->nrow() + num_rows);
+  return absl::OkStatus();
+}
+
+ColumnarExampleBatchReader::ColumnarExampleBatchReader(
+    const proto::DataSpecification& data_spec,
+    absl::optional<std::vector<int>> required_columns,
+    absl::optional<std::vector<int>> load_columns)
+    : data_spec_(data_spec),
+      required_columns_(std::move(required_columns)),
+      load_columns_(std::move(load_columns)) {}
+
+absl::Status ColumnarExampleBatchReader::Open(
+    const absl::string_view sharded_path) {
+  RETURN_IF_ERROR(utils::ExpandInputShards(sharded_path, &paths_));
+  next_path_idx_ = 0;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<VerticalDataset::row_t> ColumnarExampleBatchReader::NextBatch(
+    VerticalDataset* dataset) {
+  while (next_path_idx_ < paths_.size()) {
+    const row_t begin = dataset->nrow();
+    RETURN_IF_ERROR(AppendColumnarDataset(paths_[next_path_idx_++], data_spec_,
+                                          required_columns_, load_columns_,
+                                          dataset));
+    if (dataset->nrow() > begin) {
+      return dataset->nrow() - begin;
+    }
+  }
+  return 0;
+}
+
+ColumnarExampleReader::ColumnarExampleReader(
+    const proto::DataSpecification& data_spec,
+    absl::optional<std::vector<int>> required_columns)
+    : batch_reader_(data_spec, std::move(required_columns), {}) {
+  buffer_.set_data_spec(data_spec);
+}
+
+absl::Status ColumnarExampleReader::Open(const absl::string_view sharded_path) {
+  next_row_ = 0;
+  RETURN_IF_ERROR(buffer_.CreateColumnsFromDataspec());
+  buffer_.set_nrow(0);
+  return batch_reader_.Open(sharded_path);
+}
+
+absl::StatusOr<bool> ColumnarExampleReader::Next(proto::Example* example) {
+  if (next_row_ >= buffer_.nrow()) {
+    // Load the next file.
+    next_row_ = 0;
+    RETURN_IF_ERROR(buffer_.CreateColumnsFromDataspec());
+    buffer_.set_nrow(0);
+    ASSIGN_OR_RETURN(const auto num_rows, batch_reader_.NextBatch(&buffer_));
+    if (num_rows == 0) {
+      return false;
+    }
+  }
+  buffer_.ExtractExample(next_row_++, example);
+  return true;
+}
+
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Columnar dataset format: A binary file containing the columns of a
+// VerticalDataset, as stored in memory, and the dataspec.
+//
+// Unlike the other formats (e.g. csv), loading a columnar dataset does not
+// parse the examples: The file is memory mapped, and each column is copied in
+// bulk (one memcpy per array) into the VerticalDataset. This is not zero-copy:
+// The VerticalDataset owns its columns, and the mapping is released once the
+// file is loaded. Re-loading a dataset in the page cache costs about a memory
+// copy. The columnar format is specific to the byte order of the binary that
+// created it.
+//
+// A sharded dataset (e.g. "/tmp/ds@4") is a set of columnar files, each
+// containing a subset of the rows.
+//
+// File format:
+//
+//   [0, 8): Magic number "YDFCOLS\0".
+//   [8, 12): Format version (uint32).
+//   [12, 16): Byte order mark (uint32 0x01020304).
+//   [16, 24): Size "h" of the header (uint64).
+//   [24, 24+h): Serialized "proto::ColumnarDatasetHeader".
+//   The arrays of the columns, each aligned on "kSectionAlignment" bytes (i.e.
+//     a memory page). The location of each array is listed in the header.
+//
+// The format is registered with the "ydf_columnar:" prefix. For example:
+//
+//   RETURN_IF_ERROR(SaveVerticalDataset(dataset, "ydf_columnar:/tmp/ds"));
+//   VerticalDataset loaded;
+//   RETURN_IF_ERROR(LoadVerticalDataset("ydf_columnar:/tmp/ds",
+//                                       dataset.data_spec(), &loaded));
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_DATASET_COLUMNAR_DATASET_IO_H_
+#define YGGDRASIL_DECISION_FORESTS_DATASET_COLUMNAR_DATASET_IO_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "yggdrasil_decision_forests/dataset/columnar_dataset.pb.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/example.pb.h"
+#include "yggdrasil_decision_forests/dataset/example_batch_reader_interface.h"
+#include "yggdrasil_decision_forests/dataset/example_reader_interface.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+
+// Current version of the columnar format.
+constexpr uint32_t kColumnarDatasetVersion = 1;
+
+// Saves a dataset in a columnar dataset file.
+absl::Status SaveColumnarDataset(const VerticalDataset& dataset,
+                                 absl::string_view path);
+
+// Saves a dataset in a sharded columnar dataset (e.g. "/tmp/ds@4"), one file
+// per shard. If "num_records_by_shard" is -1, the rows are distributed evenly
+// among the shards. Otherwise, each shard contains "num_records_by_shard" rows,
+// and the last shard contains the remaining rows. All the shards are created,
+// possibly empty. A non-sharded path is saved with "SaveColumnarDataset".
+absl::Status SaveShardedColumnarDataset(const VerticalDataset& dataset,
+                                        absl::string_view sharded_path,
+                                        int64_t num_records_by_shard = -1);
+
+// Reads the header, including the dataspec, of a columnar dataset file.
+absl::StatusOr<proto::ColumnarDatasetHeader> ReadColumnarDatasetHeader(
+    absl::string_view path);
+
+// Appends the examples of a columnar dataset file at the end of "dataset".
+// "dataset" should contain the columns of "data_spec" (e.g. created with
+// "CreateColumnsFromDataspec"), and only the "load_columns" are filled (all the
+// columns if not set). See "CreateExampleReader" for the semantic of
+// "required_columns".
+//
+// The columns are matched by name with the dataspec of the file. If the
+// dictionaries of a categorical column are different, the values are converted
+// (see "ConvertToGivenDataspec").
+absl::Status AppendColumnarDataset(
+    absl::string_view path, const proto::DataSpecification& data_spec,
+    const absl::optional<std::vector<int>>& required_columns,
+    const absl::optional<std::vector<int>>& load_columns,
+    VerticalDataset* dataset);
+
+// Reads a sharded columnar dataset, one file per batch.
+class ColumnarExampleBatchReader final : public ExampleBatchReaderInterface {
+ public:
+  ColumnarExampleBatchReader(const proto::DataSpecification& data_spec,
+                             absl::optional<std::vector<int>> required_columns,
+                             absl::optional<std::vector<int>> load_columns);
+
+  absl::Status Open(absl::string_view sharded_path) override;
+
+  absl::StatusOr<VerticalDataset::row_t> NextBatch(
+      VerticalDataset* dataset) override;
+
+ private:
+  const proto::DataSpecification data_spec_;
+  const absl::optional<std::vector<int>> required_columns_;
+  const absl::optional<std::vector<int>> load_columns_;
+  std::vector<std::string> paths_;
+  int next_path_idx_ = 0;
+};
+
+REGISTER_ExampleBatchReaderInterface(ColumnarExampleBatchReader,
+                                     "FORMAT_YDF_COLUMNAR");
+
+// Reads the examples of a sharded columnar dataset one by one. Each file is
+// loaded in memory.
+class ColumnarExampleReader final : public ExampleReaderInterface {
+ public:
+  ColumnarExampleReader(const proto::DataSpecification& data_spec,
+                        absl::optional<std::vector<int>> required_columns);
+
+  absl::Status Open(absl::string_view sharded_path) override;
+
+  absl::StatusOr<bool> Next(proto::Example* example) override;
+
+ private:
+  ColumnarExampleBatchReader batch_reader_;
+  // Examples of the current file.
+  VerticalDataset buffer_;
+  VerticalDataset::row_t next_row_ = 0;
+};
+
+REGISTER_ExampleReaderInterface(ColumnarExampleReader, "FORMAT_YDF_COLUMNAR");
+
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_DATASET_COLUMNAR_DATASET_IO_H_
@@ -0,0 +1,376 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/dataset/columnar_dataset_io.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "yggdrasil_decision_forests/dataset/columnar_dataset.pb.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/data_spec_inference.h"
+#include "yggdrasil_decision_forests/dataset/example.pb.h"
+#include "yggdrasil_decision_forests/dataset/example_reader.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/sharded_io.h"
+#include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+namespace {
+
+using test::EqualsProto;
+using test::StatusIs;
+
+std::string DatasetDir() {
+  return file::JoinPath(test::DataRootDirectory(),
+                        "yggdrasil_decision_forests/test_data/dataset");
+}
+
+// Loads the toy dataset with columns of all the supported types.
+VerticalDataset LoadToyDataset() {
+  const std::string path =
+      absl::StrCat("csv:", file::JoinPath(DatasetDir(), "toy.csv"));
+  proto::DataSpecificationGuide guide;
+  guide.mutable_default_column_guide()
+      ->mutable_categorial()
+      ->set_min_vocab_frequency(1);
+  auto* string_guide = guide.add_column_guides();
+  string_guide->set_column_name_pattern("^Cat_2$");
+  string_guide->set_type(proto::ColumnType::STRING);
+  auto* hash_guide = guide.add_column_guides();
+  hash_guide->set_column_name_pattern("^Cat_3$");
+  hash_guide->set_type(proto::ColumnType::HASH);
+  auto* discretized_guide = guide.add_column_guides();
+  discretized_guide->set_column_name_pattern("^Num_2$");
+  discretized_guide->set_type(proto::ColumnType::DISCRETIZED_NUMERICAL);
+  proto::DataSpecification data_spec;
+  CreateDataSpec(path, false, guide, &data_spec);
+  VerticalDataset dataset;
+  EXPECT_OK(LoadVerticalDataset(path, data_spec, &dataset));
+  return dataset;
+}
+
+void ExpectEqualDatasets(const VerticalDataset& a, const VerticalDataset& b) {
+  ASSERT_EQ(a.nrow(), b.nrow());
+  ASSERT_EQ(a.ncol(), b.ncol());
+  proto::Example example_a, example_b;
+  for (VerticalDataset::row_t row = 0; row < a.nrow(); row++) {
+    a.ExtractExample(row, &example_a);
+    b.ExtractExample(row, &example_b);
+    EXPECT_THAT(example_a, EqualsProto(example_b)) << "row: " << row;
+  }
+}
+
+// Offset of the arrays in the content of a columnar dataset file i.e. the first
+// multiple of 4096 bytes after the 24 bytes prefix and the header.
+size_t DataBegin(const std::string& content) {
+  uint64_t header_size;
+  std::memcpy(&header_size, content.data() + 16, sizeof(header_size));
+  return (24 + header_size + 4095) / 4096 * 4096;
+}
+
+// Replaces the header of a columnar dataset file.
+void ReplaceHeader(const std::string& path,
+                   const proto::ColumnarDatasetHeader& header) {
+  ASSERT_OK_AND_ASSIGN(const auto content, file::GetContent(path));
+  const std::string serialized_header = header.SerializeAsString();
+  const uint64_t header_size = serialized_header.size();
+  std::string new_content = content.substr(0, 16);
+  new_content.append(reinterpret_cast<const char*>(&header_size),
+                     sizeof(header_size));
+  new_content += serialized_header;
+  new_content.resize(DataBegin(new_content), 0);
+  new_content += content.substr(DataBegin(content));
+  ASSERT_OK(file::SetContent(path, new_content));
+}
+
+// Loads the adult dataset.
+VerticalDataset LoadAdultDataset() {
+  const std::string path =
+      absl::StrCat("csv:", file::JoinPath(DatasetDir(), "adult_test.csv"));
+  proto::DataSpecification data_spec;
+  CreateDataSpec(path, false, {}, &data_spec);
+  VerticalDataset dataset;
+  EXPECT_OK(LoadVerticalDataset(path, data_spec, &dataset));
+  return dataset;
+}
+
+TEST(ColumnarDatasetIO, SaveAndLoad) {
+  std::vector<VerticalDataset> datasets;
+  datasets.push_back(LoadToyDataset());
+  datasets.push_back(LoadAdultDataset());
+  for (const auto& dataset : datasets) {
+    const std::string path =
+        file::JoinPath(test::TmpDirectory(), "dataset.ydf_columnar");
+    ASSERT_OK(
+        SaveVerticalDataset(dataset, absl::StrCat("ydf_columnar:", path)));
+
+    ASSERT_OK_AND_ASSIGN(const auto header, ReadColumnarDatasetHeader(path));
+    EXPECT_EQ(header.num_rows(), dataset.nrow());
+    EXPECT_THAT(header.data_spec(), EqualsProto(dataset.data_spec()));
+
+    VerticalDataset loaded;
+    ASSERT_OK(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path),
+                                  dataset.data_spec(), &loaded));
+    ExpectEqualDatasets(loaded, dataset);
+
+    // Read the examples one by one.
+    ASSERT_OK_AND_ASSIGN(
+        auto reader, CreateExampleReader(absl::StrCat("ydf_columnar:", path),
+                                         dataset.data_spec()));
+    proto::Example example, expected_example;
+    for (VerticalDataset::row_t row = 0; row < dataset.nrow(); row++) {
+      ASSERT_OK_AND_ASSIGN(const bool has_example, reader->Next(&example));
+      ASSERT_TRUE(has_example);
+      dataset.ExtractExample(row, &expected_example);
+      EXPECT_THAT(example, EqualsProto(expected_example));
+    }
+    ASSERT_OK_AND_ASSIGN(const bool has_example, reader->Next(&example));
+    EXPECT_FALSE(has_example);
+  }
+}
+
+TEST(ColumnarDatasetIO, ShardsAndColumnSubset) {
+  const VerticalDataset dataset = LoadToyDataset();
+  const std::string path_1 = file::JoinPath(test::TmpDirectory(), "shard_1");
+  const std::string path_2 = file::JoinPath(test::TmpDirectory(), "shard_2");
+  ASSERT_OK(SaveColumnarDataset(dataset, path_1));
+  ASSERT_OK(SaveColumnarDataset(dataset, path_2));
+
+  for (const int num_threads : {1, 2}) {
+    LoadConfig config;
+    config.num_threads = num_threads;
+    config.load_columns = std::vector<int>{0, 2, 4};
+    VerticalDataset loaded;
+    ASSERT_OK(LoadVerticalDataset(
+        absl::StrCat("ydf_columnar:", path_1, ",", path_2),
+        dataset.data_spec(), &loaded, {}, config));
+    ASSERT_EQ(loaded.nrow(), 2 * dataset.nrow());
+    for (int col_idx = 0; col_idx < loaded.ncol(); col_idx++) {
+      const bool is_loaded = col_idx == 0 || col_idx == 2 || col_idx == 4;
+      ASSERT_EQ(loaded.column(col_idx)->nrows(),
+                is_loaded ? loaded.nrow() : 0);
+      if (!is_loaded) {
+        continue;
+      }
+      for (VerticalDataset::row_t row = 0; row < loaded.nrow(); row++) {
+        EXPECT_EQ(loaded.ValueToString(row, col_idx),
+                  dataset.ValueToString(row % dataset.nrow(), col_idx));
+      }
+    }
+  }
+}
+
+TEST(ColumnarDatasetIO, ShardedSaveAndLoad) {
+  const VerticalDataset dataset = LoadAdultDataset();
+  const std::string path = file::JoinPath(test::TmpDirectory(), "sharded");
+  const std::string typed_path = absl::StrCat("ydf_columnar:", path, "@3");
+
+  for (const int64_t num_records_by_shard : {-1, 1000}) {
+    ASSERT_OK(SaveVerticalDataset(dataset, typed_path, num_records_by_shard));
+
+    // Each shard is a columnar file with a subset of the rows.
+    std::vector<std::string> shards;
+    ASSERT_OK(utils::ExpandInputShards(absl::StrCat(path, "@3"), &shards));
+    ASSERT_EQ(shards.size(), 3);
+    int64_t num_rows = 0;
+    for (const auto& shard : shards) {
+      ASSERT_OK_AND_ASSIGN(const auto header, ReadColumnarDatasetHeader(shard));
+      EXPECT_GT(header.num_rows(), 0);
+      if (num_records_by_shard != -1 && shard != shards.back()) {
+        EXPECT_EQ(header.num_rows(), num_records_by_shard);
+      }
+      num_rows += header.num_rows();
+    }
+    EXPECT_EQ(num_rows, dataset.nrow());
+
+    for (const int num_threads : {1, 3}) {
+      LoadConfig config;
+      config.num_threads = num_threads;
+      VerticalDataset loaded;
+      ASSERT_OK(LoadVerticalDataset(typed_path, dataset.data_spec(), &loaded,
+                                    {}, config));
+      ExpectEqualDatasets(loaded, dataset);
+    }
+  }
+}
+
+TEST(ColumnarDatasetIO, DifferentDataSpec) {
+  const VerticalDataset dataset = LoadToyDataset();
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "different_data_spec");
+  ASSERT_OK(SaveColumnarDataset(dataset, path));
+
+  // Swap two items of the "Cat_1" dictionary, and add an extra column.
+  auto data_spec = dataset.data_spec();
+  const int cat_col_idx = GetColumnIdxFromName("Cat_1", data_spec);
+  auto& items =
+      *data_spec.mutable_columns(cat_col_idx)->mutable_categorical()
+           ->mutable_items();
+  const int64_t a_index = items["A"].index();
+  items["A"].set_index(items["B"].index());
+  items["B"].set_index(a_index);
+  auto* extra_column = data_spec.add_columns();
+  extra_column->set_name("extra");
+  extra_column->set_type(proto::ColumnType::NUMERICAL);
+
+  VerticalDataset loaded;
+  EXPECT_THAT(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path),
+                                  data_spec, &loaded),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  std::vector<int> required_columns(dataset.ncol());
+  std::iota(required_columns.begin(), required_columns.end(), 0);
+  ASSERT_OK(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path), data_spec,
+                                &loaded, required_columns));
+  ASSERT_EQ(loaded.nrow(), dataset.nrow());
+  const int extra_col_idx = data_spec.columns_size() - 1;
+  for (VerticalDataset::row_t row = 0; row < loaded.nrow(); row++) {
+    EXPECT_EQ(loaded.ValueToString(row, cat_col_idx),
+              dataset.ValueToString(row, cat_col_idx));
+    EXPECT_TRUE(loaded.column(extra_col_idx)->IsNa(row));
+  }
+  EXPECT_NE(
+      loaded.ColumnWithCast<VerticalDataset::CategoricalColumn>(cat_col_idx)
+          ->values(),
+      dataset.ColumnWithCast<VerticalDataset::CategoricalColumn>(cat_col_idx)
+          ->values());
+}
+
+TEST(ColumnarDatasetIO, Errors) {
+  const VerticalDataset dataset = LoadToyDataset();
+  const std::string path = file::JoinPath(test::TmpDirectory(), "errors");
+  VerticalDataset loaded;
+
+  ASSERT_OK(file::SetContent(path, "Not a columnar dataset"));
+  EXPECT_THAT(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path),
+                                  dataset.data_spec(), &loaded),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  ASSERT_OK(SaveColumnarDataset(dataset, path));
+  ASSERT_OK_AND_ASSIGN(auto content, file::GetContent(path));
+  content.resize(content.size() - 1);
+  ASSERT_OK(file::SetContent(path, content));
+  EXPECT_THAT(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path),
+                                  dataset.data_spec(), &loaded),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ColumnarDatasetIO, InvalidSection) {
+  const VerticalDataset dataset = LoadToyDataset();
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "invalid_section");
+  ASSERT_OK(SaveColumnarDataset(dataset, path));
+  ASSERT_OK_AND_ASSIGN(auto header, ReadColumnarDatasetHeader(path));
+
+  // "offset + size" overflows and wraps around to a small value.
+  auto* section = header.mutable_columns(0)->mutable_sections(0);
+  section->set_offset(std::numeric_limits<int64_t>::max());
+  section->set_size(std::numeric_limits<int64_t>::max());
+  ReplaceHeader(path, header);
+  VerticalDataset loaded;
+  EXPECT_THAT(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path),
+                                  dataset.data_spec(), &loaded),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ColumnarDatasetIO, InvalidNumRows) {
+  const VerticalDataset dataset = LoadToyDataset();
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "invalid_num_rows");
+  for (const int64_t num_rows :
+       {int64_t{-1}, std::numeric_limits<int64_t>::min(),
+        (std::numeric_limits<int64_t>::max() >> 2) + 1}) {
+    ASSERT_OK(SaveColumnarDataset(dataset, path));
+    ASSERT_OK_AND_ASSIGN(auto header, ReadColumnarDatasetHeader(path));
+    header.set_num_rows(num_rows);
+    ReplaceHeader(path, header);
+    VerticalDataset loaded;
+    EXPECT_THAT(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path),
+                                    dataset.data_spec(), &loaded),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  }
+}
+
+TEST(ColumnarDatasetIO, CategoricalValueOutOfDictionary) {
+  const VerticalDataset dataset = LoadToyDataset();
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "categorical_out_of_dictionary");
+  ASSERT_OK(SaveColumnarDataset(dataset, path));
+  ASSERT_OK_AND_ASSIGN(const auto header, ReadColumnarDatasetHeader(path));
+  ASSERT_OK_AND_ASSIGN(auto content, file::GetContent(path));
+
+  // The first value of "Cat_1" is replaced by a value outside of the
+  // dictionary.
+  const int col_idx = dataset.ColumnNameToColumnIdx("Cat_1");
+  const auto& values = header.columns(col_idx).sections(0);
+  const int32_t value = dataset.data_spec()
+                            .columns(col_idx)
+                            .categorical()
+                            .number_of_unique_values();
+  std::memcpy(&content[DataBegin(content) + values.offset()], &value,
+              sizeof(value));
+  ASSERT_OK(file::SetContent(path, content));
+
+  VerticalDataset loaded;
+  EXPECT_THAT(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path),
+                                  dataset.data_spec(), &loaded),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ColumnarDatasetIO, InvalidMultiValueRange) {
+  const VerticalDataset dataset = LoadToyDataset();
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "invalid_multi_value_range");
+  ASSERT_OK(SaveColumnarDataset(dataset, path));
+  ASSERT_OK_AND_ASSIGN(const auto header, ReadColumnarDatasetHeader(path));
+  ASSERT_OK_AND_ASSIGN(auto content, file::GetContent(path));
+
+  // The first value of "Cat_set_1" is "X" i.e. the range [0, 1). The range is
+  // replaced by the reversed range [2, 1).
+  const int col_idx = dataset.ColumnNameToColumnIdx("Cat_set_1");
+  const auto& ranges = header.columns(col_idx).sections(0);
+  uint64_t range[2];
+  std::memcpy(range, content.data() + DataBegin(content) + ranges.offset(),
+              sizeof(range));
+  ASSERT_EQ(range[0], 0);
+  ASSERT_EQ(range[1], 1);
+  range[0] = 2;
+  std::memcpy(&content[DataBegin(content) + ranges.offset()], range,
+              sizeof(range));
+  ASSERT_OK(file::SetContent(path, content));
+
+  VerticalDataset loaded;
+  EXPECT_THAT(LoadVerticalDataset(absl::StrCat("ydf_columnar:", path),
+                                  dataset.data_spec(), &loaded),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
@@ -15,6 +15,8 @@
 
 #include "yggdrasil_decision_forests/dataset/csv_example_reader.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -31,6 +33,7 @@
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/data_spec_inference.h"
 #include "yggdrasil_decision_forests/dataset/example.pb.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
 #include "yggdrasil_decision_forests/utils/status_macros.h"
@@ -168,87 +171,179 @@ absl::Status UpdateDataSpecWithCsvExample(
   return absl::OkStatus();
 }
 
+namespace {
+
+// Reads the header of a csv file.
+absl::StatusOr<std::vector<std::string>> ReadCsvHeader(
+    const absl::string_view path) {
+  ASSIGN_OR_RETURN(auto csv_file, file::OpenInputFile(path));
+  yggdrasil_decision_forests::utils::csv::Reader reader(csv_file.get());
+  file::InputFileCloser closer(std::move(csv_file));
+  std::vector<absl::string_view>* row;
+  ASSIGN_OR_RETURN(const bool has_header, reader.NextRow(&row));
+  if (!has_header) {
+    return absl::InvalidArgumentError(absl::StrCat(path, " is empty."));
+  }
+  return std::vector<std::string>{row->begin(), row->end()};
+}
+
+// Updates the types of the columns of "data_spec" with the values of the csv
+// file "path". "nrow" is the number of rows scanned so far (including the rows
+// of the previous files), and it is updated.
+absl::Status InferColumnTypesInCsvFile(
+    const absl::string_view path, const proto::DataSpecificationGuide& guide,
+    const std::vector<std::string>& csv_header,
+    const std::vector<std::pair<int, proto::ColumnGuide>>&
+        spec_col_idx_2_csv_col_idx,
+    proto::DataSpecification* data_spec, int64_t* nrow) {
+  // Open the csv file.
+  ASSIGN_OR_RETURN(auto csv_file, file::OpenInputFile(path));
+  yggdrasil_decision_forests::utils::csv::Reader reader(csv_file.get());
+  file::InputFileCloser closer(std::move(csv_file));
+
+  // Read the header.
+  std::vector<absl::string_view>* row;
+  ASSIGN_OR_RETURN(const bool has_header, reader.NextRow(&row));
+  if (!has_header) {
+    return absl::InvalidArgumentError(absl::StrCat(path, " is empty."));
+  }
+  if (!std::equal(csv_header.begin(), csv_header.end(), row->begin(),
+                  row->end())) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The header of ", path,
+                     " does not match the header of the other files"));
+  }
+
+  while (true) {
+    ASSIGN_OR_RETURN(const bool has_row, reader.NextRow(&row));
+    if (!has_row) {
+      break;
+    }
+    LOG_INFO_EVERY_N_SEC(30, _ << *nrow << " row(s) processed");
+    // Check if we have seen enough records to determine all the types.
+    if (guide.max_num_scanned_rows_to_guess_type() > 0 &&
+        *nrow > guide.max_num_scanned_rows_to_guess_type()) {
+      YDF_LOG(INFO) << "Stop scanning the csv file to infer the type. Some "
+                       "records were not considered.";
+      break;
+    }
+    // Check the number of fields.
+    if (row->size() != csv_header.size()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Inconsistent number of columns at line ", *nrow, " of file ", path,
+          ". The header has ", csv_header.size(),
+          " field(s) while this line has ", row->size()));
+    }
+
+    for (int col_idx = 0; col_idx < spec_col_idx_2_csv_col_idx.size();
+         col_idx++) {
+      const auto& csv_col_idx_and_guide = spec_col_idx_2_csv_col_idx[col_idx];
+      proto::Column* col = data_spec->mutable_columns(col_idx);
+      if (col->is_manual_type()) {
+        // The user has already specified the type of this column.
+        continue;
+      }
+      const absl::string_view value = (*row)[csv_col_idx_and_guide.first];
+      const auto lower_case = absl::AsciiStrToLower(value);
+      if (value.empty() || lower_case == CSV_NA || lower_case == CSV_NA_V2) {
+        // We cannot do anything with Na values.
+        continue;
+      }
+      // Update the type of the column.
+      ASSIGN_OR_RETURN(
+          auto new_type,
+          InferType(guide, value,
+                    guide.default_column_guide().tokenizer().tokenizer(),
+                    col->type()));
+      col->set_type(new_type);
+    }
+    (*nrow)++;
+  }
+  return absl::OkStatus();
+}
+
+// Infers the column types with "num_threads" threads. Shard "i" is scanned by
+// thread "i % num_threads", and the types inferred by the threads are merged
+// with "MergeInferredTypes". Since all the rows are scanned, the result is the
+// same as a sequential scan.
+absl::Status InferColumnTypesInParallel(
+    const std::vector<std::string>& paths,
+    const proto::DataSpecificationGuide& guide,
+    const std::vector<std::string>& csv_header,
+    const std::vector<std::pair<int, proto::ColumnGuide>>&
+        spec_col_idx_2_csv_col_idx,
+    const int num_threads, proto::DataSpecification* data_spec) {
+  std::vector<proto::DataSpecification> thread_data_specs(num_threads,
+                                                          *data_spec);
+  std::vector<absl::Status> thread_status(num_threads);
+  YDF_LOG(INFO) << "Infer the column types of " << paths.size()
+                << " shard(s) with " << num_threads << " thread(s)";
+  {
+    utils::concurrency::ThreadPool pool("InferColumnTypes", num_threads);
+    pool.StartWorkers();
+    for (int thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+      pool.Schedule([&, thread_idx]() {
+        int64_t nrow = 0;
+        for (size_t path_idx = thread_idx; path_idx < paths.size();
+             path_idx += num_threads) {
+          thread_status[thread_idx] = InferColumnTypesInCsvFile(
+              paths[path_idx], guide, csv_header, spec_col_idx_2_csv_col_idx,
+              &thread_data_specs[thread_idx], &nrow);
+          if (!thread_status[thread_idx].ok()) {
+            return;
+          }
+        }
+      });
+    }
+  }
+
+  for (int thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+    RETURN_IF_ERROR(thread_status[thread_idx]);
+    for (int col_idx = 0; col_idx < data_spec->columns_size(); col_idx++) {
+      proto::Column* col = data_spec->mutable_columns(col_idx);
+      col->set_type(MergeInferredTypes(
+          col->type(), thread_data_specs[thread_idx].columns(col_idx).type()));
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 absl::Status CsvDataSpecCreator::InferColumnsAndTypes(
     const std::vector<std::string>& paths,
     const proto::DataSpecificationGuide& guide,
     proto::DataSpecification* data_spec) {
+  if (paths.empty()) {
+    return absl::InvalidArgumentError("No csv file to infer the types from.");
+  }
+  // Create the dataspec columns.
+  ASSIGN_OR_RETURN(const auto csv_header, ReadCsvHeader(paths.front()));
   // For each dataspec column index, gives the csv column index and the
   // dataspec guide.
   std::vector<std::pair<int, proto::ColumnGuide>> spec_col_idx_2_csv_col_idx;
-  std::vector<std::string> csv_header;
-
-  int nrow = 0;
-  for (const auto& path : paths) {
-    // Open the csv file.
-    auto csv_file = file::OpenInputFile(path).value();
-    yggdrasil_decision_forests::utils::csv::Reader reader(csv_file.get());
-    file::InputFileCloser closer(std::move(csv_file));
+  RETURN_IF_ERROR(InitializeDataSpecFromColumnNames(
+      guide, csv_header, data_spec, &spec_col_idx_2_csv_col_idx));
 
-    // Read the header.
-    std::vector<absl::string_view>* row;
-    const bool has_header = reader.NextRow(&row).value();
-    if (!has_header) {
-      return absl::InvalidArgumentError(absl::StrCat(path, " is empty."));
-    }
-
-    if (csv_header.empty()) {
-      // Create the dataspec columns.
-      csv_header = {row->begin(), row->end()};
-      RETURN_IF_ERROR(InitializeDataSpecFromColumnNames(
-          guide, csv_header, data_spec, &spec_col_idx_2_csv_col_idx));
-    } else {
-      if (!std::equal(csv_header.begin(), csv_header.end(), row->begin(),
-                      row->end())) {
-        return absl::InvalidArgumentError(
-            absl::StrCat("The header of ", path,
-                         " does not match the header of ", paths.front()));
-      }
-    }
-    while (reader.NextRow(&row).value()) {
-      LOG_INFO_EVERY_N_SEC(30, _ << nrow << " row(s) processed");
-      // Check if we have seen enough records to determine all the types.
+  // Note: The first rows of the dataset are scanned in order if the number of
+  // scanned rows is limited.
+  const int num_threads = std::min<int>(
+      paths.size(), guide.num_threads_to_accumulate_statistics());
+  if (num_threads > 1 && guide.max_num_scanned_rows_to_guess_type() <= 0) {
+    RETURN_IF_ERROR(InferColumnTypesInParallel(paths, guide, csv_header,
+                                               spec_col_idx_2_csv_col_idx,
+                                               num_threads, data_spec));
+  } else {
+    int64_t nrow = 0;
+    for (const auto& path : paths) {
+      RETURN_IF_ERROR(InferColumnTypesInCsvFile(path, guide, csv_header,
+                                                spec_col_idx_2_csv_col_idx,
+                                                data_spec, &nrow));
       if (guide.max_num_scanned_rows_to_guess_type() > 0 &&
           nrow > guide.max_num_scanned_rows_to_guess_type()) {
-        YDF_LOG(INFO)
-            << "Stop scanning the csv file to infer the type. Some records "
-               "were not considered.";
         break;
       }
-      // Check the number of fields.
-      if (row->size() != csv_header.size()) {
-        return absl::InvalidArgumentError(absl::StrCat(
-            "Inconsistent number of columns at line ", nrow, " of file ", path,
-            ". The header has ", csv_header.size(),
-            " field(s) while this line has ", row->size()));
-      }
-
-      for (int col_idx = 0; col_idx < spec_col_idx_2_csv_col_idx.size();
-           col_idx++) {
-        auto& csv_col_idx_and_guide = spec_col_idx_2_csv_col_idx[col_idx];
-        proto::Column* col = data_spec->mutable_columns(col_idx);
-        if (col->is_manual_type()) {
-          // The user has already specified the type of this column.
-          continue;
-        }
-        const absl::string_view value = (*row)[csv_col_idx_and_guide.first];
-        const auto lower_case = absl::AsciiStrToLower(value);
-        if (value.empty() || lower_case == CSV_NA || lower_case == CSV_NA_V2) {
-          // We cannot do anything with Na values.
-          continue;
-        }
-        // Update the type of the column.
-        ASSIGN_OR_RETURN(
-            auto new_type,
-            InferType(guide, value,
-                      guide.default_column_guide().tokenizer().tokenizer(),
-                      col->type()));
-        col->set_type(new_type);
-      }
-      nrow++;
     }
-    if (guide.max_num_scanned_rows_to_guess_type() > 0 &&
-        nrow > guide.max_num_scanned_rows_to_guess_type())
-      break;
   }
   return UpdateColSpecsWithGuideInfo(spec_col_idx_2_csv_col_idx, data_spec);
 }
@@ -305,6 +400,9 @@ absl::Status CsvDataSpecCreator::ComputeColumnStatistics(
                                                    col_idx_to_field_idx,
                                                    data_spec, accumulator));
       nrow++;
+      if ((nrow % kNumRowsBetweenColumnStatisticsBounding) == 0) {
+        BoundColumnStatisticsMemory(guide, data_spec, accumulator);
+      }
     }
   }
   data_spec->set_created_num_rows(nrow);
@@ -410,5 +508,35 @@ absl::StatusOr<proto::ColumnType> InferType(
   return type;
 }
 
+proto::ColumnType MergeInferredTypes(const proto::ColumnType a,
+                                     const proto::ColumnType b) {
+  if (a == b || b == ColumnType::UNKNOWN) {
+    return a;
+  }
+  if (a == ColumnType::UNKNOWN) {
+    return b;
+  }
+  // Boolean is the weakest type, and nothing is more complex than
+  // CATEGORICAL_SET.
+  if (a == ColumnType::BOOLEAN || b == ColumnType::CATEGORICAL_SET) {
+    return b;
+  }
+  if (b == ColumnType::BOOLEAN || a == ColumnType::CATEGORICAL_SET) {
+    return a;
+  }
+  // The remaining types are NUMERICAL (or DISCRETIZED_NUMERICAL),
+  // NUMERICAL_SET and CATEGORICAL.
+  const bool multi_dimensional = IsMultiDimensional(a) || IsMultiDimensional(b);
+  const bool categorical = IsCategorical(a) || IsCategorical(b);
+  if (multi_dimensional) {
+    return categorical ? ColumnType::CATEGORICAL_SET
+                       : ColumnType::NUMERICAL_SET;
+  }
+  if (categorical) {
+    return ColumnType::CATEGORICAL;
+  }
+  return a;
+}
+
 }  // namespace dataset
 }  // namespace yggdrasil_decision_forests
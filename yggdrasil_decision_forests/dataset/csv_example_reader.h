@@ -116,6 +116,10 @@ absl::StatusOr<proto::ColumnType> InferType(
     const proto::DataSpecificationGuide& guide, absl::string_view value,
     const proto::Tokenizer& tokenizer, proto::ColumnType previous_type);
 
+// Merges two types inferred by "InferType" on two subsets of the values of a
+// column. The result is the type inferred by "InferType" on all the values.
+proto::ColumnType MergeInferredTypes(proto::ColumnType a, proto::ColumnType b);
+
 }  // namespace dataset
 }  // namespace yggdrasil_decision_forests
 
@@ -0,0 +1,588 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/dataset/csv_vertical_dataset_io.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/example.pb.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/utils/concurrency_streamprocessor.h"
+#include "yggdrasil_decision_forests/utils/csv.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/logging.h"
+#include "yggdrasil_decision_forests/utils/sharded_io.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+namespace {
+
+using row_t = VerticalDataset::row_t;
+
+// Converts the csv fields into the values of a column.
+struct ColumnParser {
+  // Index of the column in the dataspec.
+  int col_idx;
+  // Index of the field in the csv rows. -1 if the column is not in the csv
+  // files i.e. all the values are missing.
+  int field_idx;
+  const proto::Column* col_spec;
+  // Dictionary of non-integerized categorical columns. Unlike the dataspec
+  // dictionary, it can be queried without copying the field.
+  absl::flat_hash_map<std::string, int32_t> dictionary;
+};
+
+// A chunk of complete csv rows.
+struct Chunk {
+  std::string content;
+  // Index of the file containing the chunk.
+  int path_idx;
+  // Position of the chunk in the file, in bytes.
+  int64_t offset;
+};
+
+// Values of the rows in a chunk, column by column.
+struct ParsedChunk {
+  // The i-th column is filled by the i-th "ColumnParser".
+  std::vector<std::unique_ptr<VerticalDataset::AbstractColumn>> columns;
+  row_t num_rows = 0;
+};
+
+// Reads a csv file as a sequence of chunks of complete rows.
+class ChunkReader {
+ public:
+  // Opens a file and reads its header.
+  absl::Status Open(absl::string_view path, int path_idx, int chunk_size);
+
+  // Reads the next chunk of rows. Returns false at the end of the file.
+  absl::StatusOr<bool> Next(Chunk* chunk);
+
+  absl::Status Close() { return file_closer_.Close(); }
+
+  const std::vector<std::string>& header() const { return header_; }
+
+ private:
+  // Reads the next bytes of the file at the end of "buffer_".
+  absl::Status ReadMore();
+
+  file::InputFileCloser file_closer_;
+  std::vector<std::string> header_;
+  int path_idx_ = 0;
+  int chunk_size_ = 0;
+  // Bytes read but not yet returned in a chunk.
+  std::string buffer_;
+  // Position of "buffer_" in the file.
+  int64_t offset_ = 0;
+  bool end_of_file_ = false;
+};
+
+absl::Status ChunkReader::Open(const absl::string_view path,
+                               const int path_idx, const int chunk_size) {
+  STATUS_CHECK_GT(chunk_size, 0);
+  path_idx_ = path_idx;
+  chunk_size_ = chunk_size;
+  buffer_.clear();
+  offset_ = 0;
+  end_of_file_ = false;
+  ASSIGN_OR_RETURN(auto file_handle, file::OpenInputFile(path));
+  RETURN_IF_ERROR(file_closer_.reset(std::move(file_handle)));
+
+  // Read until the header row is complete.
+  size_t prefix_size = 0;
+  while (prefix_size == 0 && !end_of_file_) {
+    RETURN_IF_ERROR(ReadMore());
+    prefix_size = end_of_file_ ? buffer_.size()
+                               : utils::csv::CompleteRowsPrefixSize(buffer_);
+  }
+  if (prefix_size > 0) {
+    std::string rows = buffer_.substr(0, prefix_size);
+    utils::csv::BufferReader reader(&rows[0], rows.size());
+    std::vector<absl::string_view>* row;
+    ASSIGN_OR_RETURN(const bool has_header, reader.NextRow(&row));
+    if (has_header) {
+      header_ = {row->begin(), row->end()};
+      buffer_.erase(0, reader.num_consumed_bytes());
+      offset_ += reader.num_consumed_bytes();
+      return absl::OkStatus();
+    }
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("CSV file without header: ", path));
+}
+
+absl::Status ChunkReader::ReadMore() {
+  const size_t begin = buffer_.size();
+  buffer_.resize(begin + chunk_size_);
+  ASSIGN_OR_RETURN(const int num_read, file_closer_.stream()->ReadUpTo(
+                                           &buffer_[begin], chunk_size_));
+  buffer_.resize(begin + num_read);
+  end_of_file_ = num_read == 0;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<bool> ChunkReader::Next(Chunk* chunk) {
+  while (true) {
+    if (!end_of_file_) {
+      RETURN_IF_ERROR(ReadMore());
+    }
+    // Extract the complete rows.
+    const size_t chunk_size = end_of_file_
+                                  ? buffer_.size()
+                                  : utils::csv::CompleteRowsPrefixSize(buffer_);
+    if (chunk_size > 0) {
+      chunk->path_idx = path_idx_;
+      chunk->offset = offset_;
+      std::string remaining = buffer_.substr(chunk_size);
+      buffer_.resize(chunk_size);
+      chunk->content = std::move(buffer_);
+      buffer_ = std::move(remaining);
+      offset_ += chunk_size;
+      return true;
+    }
+    if (end_of_file_) {
+      return false;
+    }
+  }
+}
+
+bool IsNaField(const absl::string_view value) {
+  return value.empty() || absl::EqualsIgnoreCase(value, CSV_NA) ||
+         absl::EqualsIgnoreCase(value, CSV_NA_V2);
+}
+
+// Adds a csv field at the end of a column. Same as "CsvFieldToAttribute"
+// followed by "AddFromExample", but without the intermediate attribute for the
+// most common column types.
+absl::Status AddField(const ColumnParser& parser, const absl::string_view value,
+                      VerticalDataset::AbstractColumn* column,
+                      proto::Example::Attribute* attribute) {
+  const auto& col_spec = *parser.col_spec;
+  float num_value;
+  switch (col_spec.type()) {
+    case proto::ColumnType::NUMERICAL: {
+      auto* cast_column =
+          static_cast<VerticalDataset::NumericalColumn*>(column);
+      if (IsNaField(value)) {
+        cast_column->AddNA();
+        return absl::OkStatus();
+      }
+      if (absl::SimpleAtof(value, &num_value)) {
+        cast_column->Add(num_value);
+        return absl::OkStatus();
+      }
+    } break;
+
+    case proto::ColumnType::DISCRETIZED_NUMERICAL: {
+      auto* cast_column =
+          static_cast<VerticalDataset::DiscretizedNumericalColumn*>(column);
+      if (IsNaField(value)) {
+        cast_column->AddNA();
+        return absl::OkStatus();
+      }
+      if (absl::SimpleAtof(value, &num_value)) {
+        cast_column->Add(NumericalToDiscretizedNumerical(col_spec, num_value));
+        return absl::OkStatus();
+      }
+    } break;
+
+    case proto::ColumnType::BOOLEAN: {
+      auto* cast_column = static_cast<VerticalDataset::BooleanColumn*>(column);
+      if (IsNaField(value)) {
+        cast_column->AddNA();
+        return absl::OkStatus();
+      }
+      if (absl::SimpleAtof(value, &num_value)) {
+        cast_column->Add(num_value >= 0.5f
+                             ? VerticalDataset::BooleanColumn::kTrueValue
+                             : VerticalDataset::BooleanColumn::kFalseValue);
+        return absl::OkStatus();
+      }
+    } break;
+
+    case proto::ColumnType::CATEGORICAL: {
+      auto* cast_column =
+          static_cast<VerticalDataset::CategoricalColumn*>(column);
+      if (IsNaField(value)) {
+        cast_column->AddNA();
+        return absl::OkStatus();
+      }
+      if (!col_spec.categorical().is_already_integerized()) {
+        const auto it = parser.dictionary.find(value);
+        cast_column->Add(it == parser.dictionary.end()
+                             ? kOutOfDictionaryItemIndex
+                             : it->second);
+        return absl::OkStatus();
+      }
+    } break;
+
+    default:
+      break;
+  }
+
+  // Generic conversion. Also reports the parsing errors of the cases above.
+  attribute->Clear();
+  RETURN_IF_ERROR(CsvFieldToAttribute(value, col_spec, attribute));
+  column->AddFromExample(*attribute);
+  return absl::OkStatus();
+}
+
+// Parses the rows of a chunk at the end of "columns". The i-th column is
+// filled by the i-th parser.
+absl::Status ParseChunk(
+    const std::vector<ColumnParser>& parsers, const int min_num_fields,
+    Chunk* chunk,
+    const std::vector<VerticalDataset::AbstractColumn*>& columns,
+    row_t* num_rows) {
+  *num_rows = 0;
+  if (chunk->content.empty()) {
+    return absl::OkStatus();
+  }
+  utils::csv::BufferReader reader(&chunk->content[0], chunk->content.size());
+  std::vector<absl::string_view>* row;
+  proto::Example::Attribute attribute;
+  while (true) {
+    ASSIGN_OR_RETURN(const bool has_row, reader.NextRow(&row));
+    if (!has_row) {
+      break;
+    }
+    if (row->size() < static_cast<size_t>(min_num_fields)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Row ", *num_rows + 1, " of the chunk has ",
+                       row->size(), " field(s) while at least ",
+                       min_num_fields, " are expected."));
+    }
+    for (int parser_idx = 0; parser_idx < parsers.size(); parser_idx++) {
+      const auto& parser = parsers[parser_idx];
+      auto* column = columns[parser_idx];
+      if (parser.field_idx == -1) {
+        column->AddNA();
+      } else {
+        RETURN_IF_ERROR(
+            AddField(parser, (*row)[parser.field_idx], column, &attribute));
+      }
+    }
+    (*num_rows)++;
+  }
+  return absl::OkStatus();
+}
+
+// Adds the file location to a parsing error.
+absl::Status AddChunkLocation(const absl::Status& status,
+                              const absl::string_view path,
+                              const Chunk& chunk) {
+  if (status.ok()) {
+    return status;
+  }
+  return absl::Status(
+      status.code(),
+      absl::StrCat("Cannot parse the rows starting at byte ", chunk.offset,
+                   " of \"", path, "\": ", status.message()));
+}
+
+// Parses the rows of a chunk into new columns.
+absl::StatusOr<std::unique_ptr<ParsedChunk>> ParseChunkToColumns(
+    const std::vector<ColumnParser>& parsers, const int min_num_fields,
+    Chunk* chunk) {
+  auto parsed = absl::make_unique<ParsedChunk>();
+  std::vector<VerticalDataset::AbstractColumn*> columns;
+  parsed->columns.reserve(parsers.size());
+  columns.reserve(parsers.size());
+  for (const auto& parser : parsers) {
+    ASSIGN_OR_RETURN(
+        auto column,
+        CreateColumn(parser.col_spec->type(), parser.col_spec->name()));
+    columns.push_back(column.get());
+    parsed->columns.push_back(std::move(column));
+  }
+  RETURN_IF_ERROR(ParseChunk(parsers, min_num_fields, chunk, columns,
+                             &parsed->num_rows));
+  return parsed;
+}
+
+// Creates the column parsers from the header of the first csv file.
+absl::Status CreateColumnParsers(
+    const proto::DataSpecification& data_spec,
+    const std::vector<std::string>& header,
+    const absl::optional<std::vector<int>>& required_columns,
+    const absl::optional<std::vector<int>>& load_columns,
+    std::vector<ColumnParser>* parsers, int* min_num_fields) {
+  std::vector<int> col_idx_to_field_idx;
+  RETURN_IF_ERROR(BuildColIdxToFeatureLabelIdx(
+      data_spec, header, required_columns, &col_idx_to_field_idx));
+
+  std::vector<int> col_idxs;
+  if (load_columns.has_value()) {
+    col_idxs = load_columns.value();
+  } else {
+    col_idxs.resize(data_spec.columns_size());
+    std::iota(col_idxs.begin(), col_idxs.end(), 0);
+  }
+
+  *min_num_fields = 0;
+  parsers->clear();
+  parsers->reserve(col_idxs.size());
+  for (const int col_idx : col_idxs) {
+    ColumnParser parser;
+    parser.col_idx = col_idx;
+    parser.field_idx = col_idx_to_field_idx[col_idx];
+    parser.col_spec = &data_spec.columns(col_idx);
+    if (parser.col_spec->type() == proto::ColumnType::CATEGORICAL &&
+        !parser.col_spec->categorical().is_already_integerized()) {
+      const auto& items = parser.col_spec->categorical().items();
+      parser.dictionary.reserve(items.size());
+      for (const auto& item : items) {
+        parser.dictionary[item.first] = item.second.index();
+      }
+    }
+    *min_num_fields = std::max(*min_num_fields, parser.field_idx + 1);
+    parsers->push_back(std::move(parser));
+  }
+  return absl::OkStatus();
+}
+
+// Checks that the header of a file is the same as the header of the first
+// file.
+absl::Status CheckSameHeader(const std::vector<std::string>& expected,
+                             const std::vector<std::string>& header,
+                             const absl::string_view path) {
+  if (header != expected) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The header of ", path,
+                     " does not match the header of the other files"));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status LoadCsvVerticalDataset(
+    const std::vector<std::string>& paths,
+    const proto::DataSpecification& data_spec, VerticalDataset* dataset,
+    const absl::optional<std::vector<int>>& required_columns,
+    const CsvLoadConfig& config) {
+  if (paths.empty()) {
+    return absl::InvalidArgumentError("No csv file to load");
+  }
+  STATUS_CHECK_GT(config.chunk_size, 0);
+
+  // Initialize dataset.
+  dataset->set_data_spec(data_spec);
+  RETURN_IF_ERROR(dataset->CreateColumnsFromDataspec());
+  dataset->set_nrow(0);
+
+  // The parsers are created when the first header is read, and they are not
+  // modified afterward.
+  std::vector<ColumnParser> parsers;
+  int min_num_fields = 0;
+  std::vector<std::string> header;
+
+  const int num_threads = std::max(1, config.num_threads);
+  utils::concurrency::StreamProcessor<
+      Chunk, absl::StatusOr<std::unique_ptr<ParsedChunk>>>
+      processor(
+          "CsvLoader", num_threads,
+          [&](Chunk chunk) -> absl::StatusOr<std::unique_ptr<ParsedChunk>> {
+            auto parsed = ParseChunkToColumns(parsers, min_num_fields, &chunk);
+            if (!parsed.ok()) {
+              return AddChunkLocation(parsed.status(), paths[chunk.path_idx],
+                                      chunk);
+            }
+            return parsed;
+          },
+          /*result_in_order=*/true);
+
+  // Number of chunks submitted and not yet ingested.
+  int num_pending_chunks = 0;
+
+  // Appends the next parsed chunk to the dataset.
+  const auto ingest_next_chunk = [&]() -> absl::Status {
+    auto result = processor.GetResult();
+    STATUS_CHECK(result.has_value());
+    RETURN_IF_ERROR(result.value().status());
+    const auto& parsed = *result.value().value();
+    for (int parser_idx = 0; parser_idx < parsers.size(); parser_idx++) {
+      RETURN_IF_ERROR(AppendColumnValues(
+          *parsed.columns[parser_idx],
+          dataset->mutable_column(parsers[parser_idx].col_idx)));
+    }
+    dataset->set_nrow(dataset->nrow() + parsed.num_rows);
+    num_pending_chunks--;
+    LOG_INFO_EVERY_N_SEC(30, _ << dataset->nrow() << " examples scanned.");
+    return absl::OkStatus();
+  };
+
+  ChunkReader reader;
+  for (int path_idx = 0; path_idx < paths.size(); path_idx++) {
+    const auto& path = paths[path_idx];
+    RETURN_IF_ERROR(reader.Open(path, path_idx, config.chunk_size));
+    if (path_idx == 0) {
+      header = reader.header();
+      RETURN_IF_ERROR(CreateColumnParsers(data_spec, header, required_columns,
+                                          config.load_columns, &parsers,
+                                          &min_num_fields));
+      processor.StartWorkers();
+    } else {
+      RETURN_IF_ERROR(CheckSameHeader(header, reader.header(), path));
+    }
+
+    while (true) {
+      Chunk chunk;
+      ASSIGN_OR_RETURN(const bool has_chunk, reader.Next(&chunk));
+      if (!has_chunk) {
+        break;
+      }
+      processor.Submit(std::move(chunk));
+      num_pending_chunks++;
+
+      // Limit the number of chunks in memory.
+      while (num_pending_chunks >= 2 * num_threads) {
+        RETURN_IF_ERROR(ingest_next_chunk());
+      }
+    }
+    RETURN_IF_ERROR(reader.Close());
+  }
+
+  processor.CloseSubmits();
+  while (num_pending_chunks > 0) {
+    RETURN_IF_ERROR(ingest_next_chunk());
+  }
+  processor.JoinAllAndStopThreads();
+
+  dataset->ShrinkToFit();
+  LOG_INFO_EVERY_N_SEC(30, _ << dataset->nrow() << " examples and "
+                             << paths.size() << " file(s) read with "
+                             << num_threads << " threads. Memory: "
+                             << dataset->MemorySummary());
+  return absl::OkStatus();
+}
+
+class CsvExampleBatchReader::Implementation {
+ public:
+  Implementation(const proto::DataSpecification& data_spec,
+                 absl::optional<std::vector<int>> required_columns,
+                 absl::optional<std::vector<int>> load_columns)
+      : data_spec_(data_spec),
+        required_columns_(std::move(required_columns)),
+        load_columns_(std::move(load_columns)) {}
+
+  absl::Status Open(const absl::string_view sharded_path) {
+    RETURN_IF_ERROR(utils::ExpandInputShards(sharded_path, &paths_));
+    next_path_idx_ = 0;
+    has_open_file_ = false;
+    return absl::OkStatus();
+  }
+
+  absl::StatusOr<row_t> NextBatch(VerticalDataset* dataset) {
+    while (true) {
+      if (!has_open_file_) {
+        if (next_path_idx_ >= paths_.size()) {
+          return 0;
+        }
+        RETURN_IF_ERROR(OpenNextFile());
+      }
+      Chunk chunk;
+      ASSIGN_OR_RETURN(const bool has_chunk, reader_.Next(&chunk));
+      if (!has_chunk) {
+        RETURN_IF_ERROR(reader_.Close());
+        has_open_file_ = false;
+        continue;
+      }
+
+      std::vector<VerticalDataset::AbstractColumn*> columns;
+      columns.reserve(parsers_.size());
+      for (const auto& parser : parsers_) {
+        columns.push_back(dataset->mutable_column(parser.col_idx));
+      }
+      row_t num_rows;
+      RETURN_IF_ERROR(AddChunkLocation(
+          ParseChunk(parsers_, min_num_fields_, &chunk, columns, &num_rows),
+          paths_[chunk.path_idx], chunk));
+      dataset->set_nrow(dataset->nrow() + num_rows);
+      if (num_rows > 0) {
+        return num_rows;
+      }
+    }
+  }
+
+ private:
+  absl::Status OpenNextFile() {
+    const int path_idx = next_path_idx_++;
+    RETURN_IF_ERROR(
+        reader_.Open(paths_[path_idx], path_idx, CsvLoadConfig().chunk_size));
+    if (path_idx == 0) {
+      header_ = reader_.header();
+      RETURN_IF_ERROR(CreateColumnParsers(data_spec_, header_,
+                                          required_columns_, load_columns_,
+                                          &parsers_, &min_num_fields_));
+    } else {
+      RETURN_IF_ERROR(
+          CheckSameHeader(header_, reader_.header(), paths_[path_idx]));
+    }
+    has_open_file_ = true;
+    return absl::OkStatus();
+  }
+
+  // The parsers point to the columns of "data_spec_".
+  const proto::DataSpecification data_spec_;
+  const absl::optional<std::vector<int>> required_columns_;
+  const absl::optional<std::vector<int>> load_columns_;
+
+  std::vector<std::string> paths_;
+  int next_path_idx_ = 0;
+  ChunkReader reader_;
+  bool has_open_file_ = false;
+
+  std::vector<std::string> header_;
+  std::vector<ColumnParser> parsers_;
+  int min_num_fields_ = 0;
+};
+
+CsvExampleBatchReader::CsvExampleBatchReader(
+    const proto::DataSpecification& data_spec,
+    absl::optional<std::vector<int>> required_columns,
+    absl::optional<std::vector<int>> load_columns)
+    : implementation_(absl::make_unique<Implementation>(
+          data_spec, std::move(required_columns), std::move(load_columns))) {}
+
+CsvExampleBatchReader::~CsvExampleBatchReader() = default;
+
+absl::Status CsvExampleBatchReader::Open(const absl::string_view sharded_path) {
+  return implementation_->Open(sharded_path);
+}
+
+absl::StatusOr<VerticalDataset::row_t> CsvExampleBatchReader::NextBatch(
+    VerticalDataset* dataset) {
+  return implementation_->NextBatch(dataset);
+}
+
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
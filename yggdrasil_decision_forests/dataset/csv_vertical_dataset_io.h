@@ -0,0 +1,96 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Multi-threaded loading of CSV files into a VerticalDataset.
+//
+// The files are split into chunks of complete rows (the split is aware of the
+// quoted fields). The chunks are parsed in parallel, directly into columns
+// i.e. without creating intermediate "proto::Example"s. The columns of the
+// chunks are then appended to the dataset in order. The resulting dataset is
+// the same as the one loaded with the "csv" example reader.
+//
+// Unlike the generic loading (see "LoadVerticalDataset"), the parallelism does
+// not depend on the number of shards: A single large CSV file is also loaded
+// with multiple threads.
+//
+// The same parsing is exposed as an "ExampleBatchReaderInterface" (see
+// "CsvExampleBatchReader") for the single-threaded loading.
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_DATASET_CSV_VERTICAL_DATASET_IO_H_
+#define YGGDRASIL_DECISION_FORESTS_DATASET_CSV_VERTICAL_DATASET_IO_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/example_batch_reader_interface.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+
+struct CsvLoadConfig {
+  // Number of parsing threads.
+  int num_threads = 10;
+  // Approximate size, in bytes, of the chunks of file parsed independently.
+  // Each thread holds a chunk, and the reading thread holds a few chunks in
+  // advance.
+  int chunk_size = 16 * 1024 * 1024;
+  // If specified, only load this subset of columns.
+  absl::optional<std::vector<int>> load_columns;
+};
+
+// Loads a set of CSV files (e.g. the shards of a dataset) into "dataset". All
+// the files should have the same header. See "LoadVerticalDataset" for the
+// semantic of "required_columns".
+absl::Status LoadCsvVerticalDataset(
+    const std::vector<std::string>& paths,
+    const proto::DataSpecification& data_spec, VerticalDataset* dataset,
+    const absl::optional<std::vector<int>>& required_columns = {},
+    const CsvLoadConfig& config = {});
+
+// Reads csv files directly into the columns of a VerticalDataset. Each call to
+// "NextBatch" parses a chunk of ~"CsvLoadConfig::chunk_size" bytes of rows.
+// The examples are the same, and in the same order, as the ones of
+// "CsvExampleReader".
+class CsvExampleBatchReader final : public ExampleBatchReaderInterface {
+ public:
+  CsvExampleBatchReader(const proto::DataSpecification& data_spec,
+                        absl::optional<std::vector<int>> required_columns,
+                        absl::optional<std::vector<int>> load_columns);
+  ~CsvExampleBatchReader() override;
+
+  absl::Status Open(absl::string_view sharded_path) override;
+
+  absl::StatusOr<VerticalDataset::row_t> NextBatch(
+      VerticalDataset* dataset) override;
+
+ private:
+  class Implementation;
+  std::unique_ptr<Implementation> implementation_;
+};
+
+REGISTER_ExampleBatchReaderInterface(CsvExampleBatchReader, "FORMAT_CSV");
+
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_DATASET_CSV_VERTICAL_DATASET_IO_H_
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/dataset/csv_vertical_dataset_io.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/data_spec_inference.h"
+#include "yggdrasil_decision_forests/dataset/example.pb.h"
+#include "yggdrasil_decision_forests/dataset/example_reader.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+namespace {
+
+using test::EqualsProto;
+using test::StatusIs;
+
+std::string DatasetDir() {
+  return file::JoinPath(test::DataRootDirectory(),
+                        "yggdrasil_decision_forests/test_data/dataset");
+}
+
+proto::DataSpecification InferDataSpec(const std::string& path) {
+  proto::DataSpecificationGuide guide;
+  guide.mutable_default_column_guide()
+      ->mutable_categorial()
+      ->set_min_vocab_frequency(1);
+  proto::DataSpecification data_spec;
+  CreateDataSpec(absl::StrCat("csv:", path), false, guide, &data_spec);
+  return data_spec;
+}
+
+// Loads a dataset with the generic example reader.
+VerticalDataset LoadWithExampleReader(
+    const std::string& path, const proto::DataSpecification& data_spec,
+    const absl::optional<std::vector<int>>& required_columns = {},
+    const absl::optional<std::vector<int>>& load_columns = {}) {
+  LoadConfig config;
+  config.num_threads = 1;
+  config.parallel_csv_parsing = false;
+  config.batch_reading = false;
+  config.load_columns = load_columns;
+  VerticalDataset dataset;
+  EXPECT_OK(LoadVerticalDataset(absl::StrCat("csv:", path), data_spec,
+                                &dataset, required_columns, config));
+  return dataset;
+}
+
+void ExpectEqualDatasets(const VerticalDataset& a, const VerticalDataset& b) {
+  ASSERT_EQ(a.nrow(), b.nrow());
+  ASSERT_EQ(a.ncol(), b.ncol());
+  for (int col_idx = 0; col_idx < a.ncol(); col_idx++) {
+    ASSERT_EQ(a.column(col_idx)->nrows(), b.column(col_idx)->nrows());
+  }
+  proto::Example example_a, example_b;
+  for (VerticalDataset::row_t row = 0; row < a.nrow(); row++) {
+    a.ExtractExample(row, &example_a);
+    b.ExtractExample(row, &example_b);
+    EXPECT_THAT(example_a, EqualsProto(example_b)) << "row: " << row;
+  }
+}
+
+TEST(CsvVerticalDatasetIO, SameAsExampleReader) {
+  for (const std::string filename :
+       {"toy.csv", "adult_test.csv", "iris.csv", "sim_pte_test.csv"}) {
+    const std::string path = file::JoinPath(DatasetDir(), filename);
+    const auto data_spec = InferDataSpec(path);
+    const auto expected = LoadWithExampleReader(path, data_spec);
+    // Small chunks, a lot of rows split between chunks.
+    for (const int chunk_size : {7, 1000, 1 << 20}) {
+      CsvLoadConfig config;
+      config.num_threads = 4;
+      config.chunk_size = chunk_size;
+      VerticalDataset dataset;
+      ASSERT_OK(
+          LoadCsvVerticalDataset({path}, data_spec, &dataset, {}, config));
+      ExpectEqualDatasets(dataset, expected);
+    }
+  }
+}
+
+TEST(CsvVerticalDatasetIO, QuotesAndNewLines) {
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "quotes_and_new_lines.csv");
+  ASSERT_OK(file::SetContent(path,
+                             "num,text,cat\r\n"
+                             "1,\"a\nb\",x\r\n"
+                             "NA,\"\"\"quoted\"\", with comma\",y\r\n"
+                             "3.5,,\"x\"\r\n"
+                             "nan,\"\r\n\",NA\r\n"
+                             "-2,c,\"z\""));
+  proto::DataSpecification data_spec = InferDataSpec(path);
+  data_spec.mutable_columns(1)->set_type(proto::ColumnType::STRING);
+  const auto expected = LoadWithExampleReader(path, data_spec);
+  EXPECT_EQ(expected.nrow(), 5);
+
+  for (const int chunk_size : {1, 5, 100}) {
+    CsvLoadConfig config;
+    config.num_threads = 3;
+    config.chunk_size = chunk_size;
+    VerticalDataset dataset;
+    ASSERT_OK(LoadCsvVerticalDataset({path}, data_spec, &dataset, {}, config));
+    ExpectEqualDatasets(dataset, expected);
+  }
+}
+
+TEST(CsvVerticalDatasetIO, ShardsAndColumnSubset) {
+  const std::string path = file::JoinPath(DatasetDir(), "adult_test.csv");
+  const auto data_spec = InferDataSpec(path);
+  const std::vector<int> load_columns = {0, 3, 14};
+
+  LoadConfig config;
+  config.num_threads = 4;
+  config.load_columns = load_columns;
+  VerticalDataset dataset;
+  ASSERT_OK(LoadVerticalDataset(absl::StrCat("csv:", path, ",", path),
+                                data_spec, &dataset, {}, config));
+
+  const auto expected =
+      LoadWithExampleReader(path, data_spec, {}, load_columns);
+  ASSERT_EQ(dataset.nrow(), 2 * expected.nrow());
+  for (int col_idx = 0; col_idx < dataset.ncol(); col_idx++) {
+    const bool loaded = col_idx == 0 || col_idx == 3 || col_idx == 14;
+    EXPECT_EQ(dataset.column(col_idx)->nrows(), loaded ? dataset.nrow() : 0);
+  }
+  for (const int col_idx : load_columns) {
+    for (VerticalDataset::row_t row = 0; row < expected.nrow(); row++) {
+      EXPECT_EQ(dataset.ValueToString(row, col_idx),
+                expected.ValueToString(row, col_idx));
+      EXPECT_EQ(dataset.ValueToString(row + expected.nrow(), col_idx),
+                expected.ValueToString(row, col_idx));
+    }
+  }
+}
+
+TEST(CsvVerticalDatasetIO, MissingColumn) {
+  const std::string path = file::JoinPath(DatasetDir(), "toy.csv");
+  auto data_spec = InferDataSpec(path);
+  auto* extra_column = data_spec.add_columns();
+  extra_column->set_name("extra");
+  extra_column->set_type(proto::ColumnType::NUMERICAL);
+
+  VerticalDataset dataset;
+  EXPECT_THAT(LoadCsvVerticalDataset({path}, data_spec, &dataset),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  ASSERT_OK(LoadCsvVerticalDataset({path}, data_spec, &dataset,
+                                   std::vector<int>{0, 1}));
+  const auto expected =
+      LoadWithExampleReader(path, data_spec, std::vector<int>{0, 1});
+  ExpectEqualDatasets(dataset, expected);
+}
+
+TEST(CsvVerticalDatasetIO, Errors) {
+  const std::string path = file::JoinPath(test::TmpDirectory(), "error.csv");
+  proto::DataSpecification data_spec;
+  auto* column = data_spec.add_columns();
+  column->set_name("a");
+  column->set_type(proto::ColumnType::NUMERICAL);
+
+  VerticalDataset dataset;
+  ASSERT_OK(file::SetContent(path, "a\n1\nhello\n"));
+  EXPECT_THAT(LoadCsvVerticalDataset({path}, data_spec, &dataset),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  ASSERT_OK(file::SetContent(path, "a\n1\n\"2\n"));
+  EXPECT_THAT(LoadCsvVerticalDataset({path}, data_spec, &dataset),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  ASSERT_OK(file::SetContent(path, ""));
+  EXPECT_THAT(LoadCsvVerticalDataset({path}, data_spec, &dataset),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(CsvExampleBatchReader, SameAsExampleReader) {
+  for (const std::string filename : {"toy.csv", "adult_test.csv"}) {
+    const std::string path = file::JoinPath(DatasetDir(), filename);
+    const auto data_spec = InferDataSpec(path);
+    const auto expected = LoadWithExampleReader(path, data_spec);
+
+    ASSERT_TRUE(IsBatchFormatSupported(absl::StrCat("csv:", path)));
+    ASSERT_OK_AND_ASSIGN(
+        auto reader,
+        CreateExampleBatchReader(absl::StrCat("csv:", path), data_spec));
+    VerticalDataset dataset;
+    dataset.set_data_spec(data_spec);
+    ASSERT_OK(dataset.CreateColumnsFromDataspec());
+    while (true) {
+      ASSERT_OK_AND_ASSIGN(const auto num_rows, reader->NextBatch(&dataset));
+      if (num_rows == 0) {
+        break;
+      }
+    }
+    ExpectEqualDatasets(dataset, expected);
+  }
+}
+
+TEST(CsvExampleBatchReader, LoadVerticalDataset) {
+  const std::string path = file::JoinPath(DatasetDir(), "adult_test.csv");
+  const auto data_spec = InferDataSpec(path);
+  const auto expected = LoadWithExampleReader(path, data_spec);
+
+  for (const int num_threads : {1, 4}) {
+    LoadConfig config;
+    config.num_threads = num_threads;
+    config.parallel_csv_parsing = false;
+    config.batch_reading = true;
+    VerticalDataset dataset;
+    ASSERT_OK(LoadVerticalDataset(absl::StrCat("csv:", path, ",", path),
+                                  data_spec, &dataset, {}, config));
+    ASSERT_EQ(dataset.nrow(), 2 * expected.nrow());
+    proto::Example example, expected_example;
+    for (VerticalDataset::row_t row = 0; row < dataset.nrow(); row++) {
+      dataset.ExtractExample(row, &example);
+      expected.ExtractExample(row % expected.nrow(), &expected_example);
+      EXPECT_THAT(example, EqualsProto(expected_example)) << "row: " << row;
+    }
+  }
+
+  // Only load a subset of the columns.
+  LoadConfig config;
+  config.num_threads = 4;
+  config.parallel_csv_parsing = false;
+  config.batch_reading = true;
+  config.load_columns = std::vector<int>{1, 2};
+  VerticalDataset dataset;
+  ASSERT_OK(LoadVerticalDataset(absl::StrCat("csv:", path, ",", path),
+                                data_spec, &dataset, {}, config));
+  ASSERT_EQ(dataset.nrow(), 2 * expected.nrow());
+  for (int col_idx = 0; col_idx < dataset.ncol(); col_idx++) {
+    const bool loaded = col_idx == 1 || col_idx == 2;
+    EXPECT_EQ(dataset.column(col_idx)->nrows(), loaded ? dataset.nrow() : 0);
+  }
+  for (VerticalDataset::row_t row = 0; row < expected.nrow(); row++) {
+    EXPECT_EQ(dataset.ValueToString(row + expected.nrow(), 2),
+              expected.ValueToString(row, 2));
+  }
+}
+
+}  // namespace
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
@@ -31,6 +31,7 @@
 
 #include "absl/status/status.h"
 #include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
@@ -277,6 +278,121 @@ bool HasColumn(absl::string_view name,
   return false;
 }
 
+absl::Status CsvFieldToAttribute(const absl::string_view value,
+                                 const proto::Column& col_spec,
+                                 proto::Example::Attribute* attribute) {
+  if (absl::EqualsIgnoreCase(value, CSV_NA) ||
+      absl::EqualsIgnoreCase(value, CSV_NA_V2)) {
+    return absl::OkStatus();
+  }
+
+  switch (col_spec.type()) {
+    case ColumnType::UNKNOWN:
+      break;
+    case ColumnType::NUMERICAL: {
+      if (value.empty()) {
+        break;
+      }
+      float num_value;
+      if (!absl::SimpleAtof(value, &num_value)) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Cannot parse: ", value));
+      }
+
+      attribute->set_numerical(num_value);
+    } break;
+    case ColumnType::DISCRETIZED_NUMERICAL: {
+      if (value.empty()) {
+        break;
+      }
+      float num_value;
+      if (!absl::SimpleAtof(value, &num_value)) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Cannot parse: ", value));
+      }
+      attribute->set_discretized_numerical(
+          NumericalToDiscretizedNumerical(col_spec, num_value));
+    } break;
+    case ColumnType::NUMERICAL_SET:
+    case ColumnType::NUMERICAL_LIST: {
+      google::protobuf::RepeatedField<float>* dst;
+      if (col_spec.type() == ColumnType::NUMERICAL_SET) {
+        dst = attribute->mutable_numerical_set()->mutable_values();
+      } else {
+        dst = attribute->mutable_numerical_list()->mutable_values();
+      }
+      std::vector<std::string> tokens;
+      RETURN_IF_ERROR(Tokenize(value, col_spec.tokenizer(), &tokens));
+      dst->Reserve(tokens.size());
+      for (const std::string& token : tokens) {
+        float num_value;
+        if (!absl::SimpleAtof(token, &num_value)) {
+          return absl::InvalidArgumentError(
+              absl::StrCat("Cannot parse: ", token));
+        }
+        dst->Add(num_value);
+      }
+      if (col_spec.type() == ColumnType::NUMERICAL_SET) {
+        // Sets are expected to be sorted.
+        std::sort(dst->begin(), dst->end());
+        dst->erase(std::unique(dst->begin(), dst->end()), dst->end());
+      }
+    } break;
+    case ColumnType::CATEGORICAL: {
+      if (value.empty()) {
+        break;
+      }
+      ASSIGN_OR_RETURN(const auto int_value,
+                       CategoricalStringToValueWithStatus(std::string(value),
+                                                          col_spec));
+      attribute->set_categorical(int_value);
+    } break;
+    case ColumnType::CATEGORICAL_SET:
+    case ColumnType::CATEGORICAL_LIST: {
+      google::protobuf::RepeatedField<int32_t>* dst;
+      if (col_spec.type() == ColumnType::CATEGORICAL_SET) {
+        dst = attribute->mutable_categorical_set()->mutable_values();
+      } else {
+        dst = attribute->mutable_categorical_list()->mutable_values();
+      }
+      std::vector<std::string> tokens;
+      RETURN_IF_ERROR(Tokenize(value, col_spec.tokenizer(), &tokens));
+      dst->Reserve(tokens.size());
+      for (const std::string& token : tokens) {
+        ASSIGN_OR_RETURN(auto value,
+                         CategoricalStringToValueWithStatus(token, col_spec));
+        dst->Add(value);
+      }
+      if (col_spec.type() == ColumnType::CATEGORICAL_SET) {
+        // Sets are expected to be sorted.
+        std::sort(dst->begin(), dst->end());
+        dst->erase(std::unique(dst->begin(), dst->end()), dst->end());
+      }
+    } break;
+    case ColumnType::BOOLEAN: {
+      if (value.empty()) {
+        break;
+      }
+      float num_value;
+      if (!absl::SimpleAtof(value, &num_value)) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Cannot parse: ", value));
+      }
+      attribute->set_boolean(num_value >= 0.5f);
+    } break;
+    case ColumnType::STRING:
+      *attribute->mutable_text() = std::string{value};
+      break;
+    case ColumnType::HASH: {
+      if (value.empty()) {
+        break;
+      }
+      attribute->set_hash(HashColumnString(value));
+    } break;
+  }
+  return absl::OkStatus();
+}
+
 absl::Status CsvRowToExample(const std::vector<std::string>& csv_fields,
                              const proto::DataSpecification& data_spec,
                              const std::vector<int>& col_idx_to_field_idx,
@@ -285,122 +401,14 @@ absl::Status CsvRowToExample(const std::vector<std::string>& csv_fields,
   example->mutable_attributes()->Clear();
   example->mutable_attributes()->Reserve(data_spec.columns_size());
   for (int col_idx = 0; col_idx < data_spec.columns_size(); col_idx++) {
-    const auto& col_spec = data_spec.columns(col_idx);
     auto* dst_value = example->mutable_attributes()->Add();
     // Skip NAs
     const auto field_idx = col_idx_to_field_idx[col_idx];
     if (field_idx == -1) {
       continue;
     }
-    const auto& value = csv_fields[field_idx];
-    const auto lower_case = absl::AsciiStrToLower(value);
-    if (lower_case == CSV_NA || lower_case == CSV_NA_V2) {
-      continue;
-    }
-
-    switch (col_spec.type()) {
-      case ColumnType::UNKNOWN:
-        break;
-      case ColumnType::NUMERICAL: {
-        if (value.empty()) {
-          break;
-        }
-        float num_value;
-        if (!absl::SimpleAtof(value, &num_value)) {
-          return absl::InvalidArgumentError(
-              absl::StrCat("Cannot parse: ", value));
-        }
-
-        dst_value->set_numerical(num_value);
-      } break;
-      case ColumnType::DISCRETIZED_NUMERICAL: {
-        if (value.empty()) {
-          break;
-        }
-        float num_value;
-        if (!absl::SimpleAtof(value, &num_value)) {
-          return absl::InvalidArgumentError(
-              absl::StrCat("Cannot parse: ", value));
-        }
-        dst_value->set_discretized_numerical(
-            NumericalToDiscretizedNumerical(col_spec, num_value));
-      } break;
-      case ColumnType::NUMERICAL_SET:
-      case ColumnType::NUMERICAL_LIST: {
-        google::protobuf::RepeatedField<float>* dst;
-        if (col_spec.type() == ColumnType::NUMERICAL_SET) {
-          dst = dst_value->mutable_numerical_set()->mutable_values();
-        } else {
-          dst = dst_value->mutable_numerical_list()->mutable_values();
-        }
-        std::vector<std::string> tokens;
-        RETURN_IF_ERROR(Tokenize(value, col_spec.tokenizer(), &tokens));
-        dst->Reserve(tokens.size());
-        for (const std::string& token : tokens) {
-          float num_value;
-          if (!absl::SimpleAtof(token, &num_value)) {
-            return absl::InvalidArgumentError(
-                absl::StrCat("Cannot parse: ", token));
-          }
-          dst->Add(num_value);
-        }
-        if (col_spec.type() == ColumnType::NUMERICAL_SET) {
-          // Sets are expected to be sorted.
-          std::sort(dst->begin(), dst->end());
-          dst->erase(std::unique(dst->begin(), dst->end()), dst->end());
-        }
-      } break;
-      case ColumnType::CATEGORICAL: {
-        if (value.empty()) {
-          break;
-        }
-        ASSIGN_OR_RETURN(auto value,
-                         CategoricalStringToValueWithStatus(value, col_spec));
-        dst_value->set_categorical(value);
-      } break;
-      case ColumnType::CATEGORICAL_SET:
-      case ColumnType::CATEGORICAL_LIST: {
-        google::protobuf::RepeatedField<int32_t>* dst;
-        if (col_spec.type() == ColumnType::CATEGORICAL_SET) {
-          dst = dst_value->mutable_categorical_set()->mutable_values();
-        } else {
-          dst = dst_value->mutable_categorical_list()->mutable_values();
-        }
-        std::vector<std::string> tokens;
-        RETURN_IF_ERROR(Tokenize(value, col_spec.tokenizer(), &tokens));
-        dst->Reserve(tokens.size());
-        for (const std::string& token : tokens) {
-          ASSIGN_OR_RETURN(auto value,
-                           CategoricalStringToValueWithStatus(token, col_spec));
-          dst->Add(value);
-        }
-        if (col_spec.type() == ColumnType::CATEGORICAL_SET) {
-          // Sets are expected to be sorted.
-          std::sort(dst->begin(), dst->end());
-          dst->erase(std::unique(dst->begin(), dst->end()), dst->end());
-        }
-      } break;
-      case ColumnType::BOOLEAN: {
-        if (value.empty()) {
-          break;
-        }
-        float num_value;
-        if (!absl::SimpleAtof(value, &num_value)) {
-          return absl::InvalidArgumentError(
-              absl::StrCat("Cannot parse: ", value));
-        }
-        dst_value->set_boolean(num_value >= 0.5f);
-      } break;
-      case ColumnType::STRING:
-        *dst_value->mutable_text() = std::string{value};
-        break;
-      case ColumnType::HASH: {
-        if (value.empty()) {
-          break;
-        }
-        dst_value->set_hash(HashColumnString(value));
-      } break;
-    }
+    RETURN_IF_ERROR(CsvFieldToAttribute(csv_fields[field_idx],
+                                        data_spec.columns(col_idx), dst_value));
   }
   return absl::OkStatus();
 }
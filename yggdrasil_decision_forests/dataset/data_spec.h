@@ -86,6 +86,12 @@ absl::Status GetSingleColumnIdxFromName(
     const dataset::proto::DataSpecification& data_spec, int32_t* column_idx,
     absl::string_view error_message_prefix = "");
 
+// Converts a single csv field into an example attribute. NA values (see
+// "CSV_NA") leave "attribute" unset.
+absl::Status CsvFieldToAttribute(absl::string_view value,
+                                 const proto::Column& col_spec,
+                                 proto::Example::Attribute* attribute);
+
 // Converts a single row from a csv into an Example.
 // If col_idx_to_field_idx[i] == -1, all the values of the i-th column are
 // replaced by empty values.
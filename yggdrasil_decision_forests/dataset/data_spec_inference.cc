@@ -26,6 +26,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/casts.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -397,6 +398,57 @@ void CreateDataSpec(absl::string_view typed_path, bool use_flume,
   CHECK_OK(CreateDataSpecWithStatus(typed_path, use_flume, guide, data_spec));
 }
 
+namespace {
+
+// Computes the column statistics with "num_threads" threads. Shard "i" is
+// scanned by thread "i % num_threads", and the statistics of the threads are
+// merged in order. Therefore, the result does not depend on the scheduling of
+// the threads.
+absl::Status ComputeColumnStatisticsInParallel(
+    const std::string& format_name, const std::vector<std::string>& paths,
+    const proto::DataSpecificationGuide& guide, const int num_threads,
+    proto::DataSpecification* data_spec,
+    proto::DataSpecificationAccumulator* accumulator) {
+  std::vector<std::vector<std::string>> thread_paths(num_threads);
+  for (size_t path_idx = 0; path_idx < paths.size(); path_idx++) {
+    thread_paths[path_idx % num_threads].push_back(paths[path_idx]);
+  }
+  std::vector<proto::DataSpecification> thread_data_specs(num_threads,
+                                                          *data_spec);
+  std::vector<proto::DataSpecificationAccumulator> thread_accumulators(
+      num_threads, *accumulator);
+  std::vector<absl::Status> thread_status(num_threads);
+
+  YDF_LOG(INFO) << "Compute the column statistics of " << paths.size()
+                << " shard(s) with " << num_threads << " thread(s)";
+  {
+    utils::concurrency::ThreadPool pool("ComputeColumnStatistics", num_threads);
+    pool.StartWorkers();
+    for (int thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+      pool.Schedule([&, thread_idx]() {
+        auto creator = AbstractDataSpecCreatorRegisterer::Create(format_name);
+        if (!creator.ok()) {
+          thread_status[thread_idx] = creator.status();
+          return;
+        }
+        thread_status[thread_idx] = creator.value()->ComputeColumnStatistics(
+            thread_paths[thread_idx], guide, &thread_data_specs[thread_idx],
+            &thread_accumulators[thread_idx]);
+      });
+    }
+  }
+
+  for (int thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+    RETURN_IF_ERROR(thread_status[thread_idx]);
+    RETURN_IF_ERROR(MergeColumnStatistics(
+        guide, thread_data_specs[thread_idx], thread_accumulators[thread_idx],
+        data_spec, accumulator));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 absl::Status CreateDataSpecWithStatus(
     const absl::string_view typed_path, const bool use_flume,
     const proto::DataSpecificationGuide& guide,
@@ -429,10 +481,18 @@ absl::Status CreateDataSpecWithStatus(
   // each column.
   proto::DataSpecificationAccumulator accumulator;
   InitializeDataspecAccumulator(*data_spec, &accumulator);
-  // TODO: Call ComputeColumnStatistics in parallel other the different
-  // paths.
-  RETURN_IF_ERROR(
-      creator->ComputeColumnStatistics(paths, guide, data_spec, &accumulator));
+  const int num_threads = std::min<int>(
+      paths.size(), guide.num_threads_to_accumulate_statistics());
+  if (num_threads > 1 &&
+      guide.max_num_scanned_rows_to_accumulate_statistics() < 0) {
+    RETURN_IF_ERROR(ComputeColumnStatisticsInParallel(
+        format_name, paths, guide, num_threads, data_spec, &accumulator));
+  } else {
+    // Note: The first rows of the dataset are scanned in order if the number
+    // of scanned rows is limited.
+    RETURN_IF_ERROR(creator->ComputeColumnStatistics(paths, guide, data_spec,
+                                                     &accumulator));
+  }
   RETURN_IF_ERROR(FinalizeComputeSpec(guide, accumulator, data_spec));
 
   YDF_LOG(INFO) << "Finalizing [" << data_spec->created_num_rows()
@@ -555,6 +615,214 @@ absl::Status FinalizeComputeSpec(
   return absl::OkStatus();
 }
 
+namespace {
+
+// Reduces a categorical column dictionary being accumulated to at most
+// "max_num_items" items with the Misra-Gries reduction: The count of the
+// "max_num_items+1"-th most frequent item is subtracted from all the items, and
+// the items without a positive count are removed. The subtracted counts are
+// added to the out-of-dictionary item so the total count is preserved.
+//
+// Each reduction subtracts the same count from at least "max_num_items+1"
+// items. Therefore, the sum of the subtracted counts, which bounds the
+// under-estimation of the count of any item, is at most N/(max_num_items+1)
+// where N is the total count. This also holds when dictionaries are merged
+// (i.e. summed) before being reduced.
+void ReduceAccumulatedCategoricalItems(const int64_t max_num_items,
+                                       proto::Column* col) {
+  auto* items = col->mutable_categorical()->mutable_items();
+  uint64_t count_ood_items = 0;
+  std::vector<int64_t> counts;
+  counts.reserve(items->size());
+  for (const auto& item : *items) {
+    if (item.first == kOutOfDictionaryItemKey) {
+      count_ood_items = item.second.count();
+    } else {
+      counts.push_back(item.second.count());
+    }
+  }
+  if (counts.size() <= max_num_items) {
+    return;
+  }
+  std::nth_element(counts.begin(), counts.begin() + max_num_items,
+                   counts.end(), std::greater<int64_t>());
+  const int64_t decrement = counts[max_num_items];
+
+  for (auto it = items->begin(); it != items->end();) {
+    if (it->first == kOutOfDictionaryItemKey) {
+      ++it;
+      continue;
+    }
+    const int64_t count = it->second.count();
+    if (count <= decrement) {
+      count_ood_items += count;
+      it = items->erase(it);
+    } else {
+      count_ood_items += decrement;
+      it->second.set_count(count - decrement);
+      ++it;
+    }
+  }
+  (*items)[kOutOfDictionaryItemKey].set_count(count_ood_items);
+}
+
+// Reduces the number of unique values of a discretized numerical column
+// accumulator to at most "max_num_values". Each pass merges the pairs of
+// neighboring values (in value order) into the most frequent value of the
+// pair, and halves the number of values. The total count is preserved.
+void CompactAccumulatedDiscretizedNumerical(
+    const int64_t max_num_values,
+    proto::DataSpecificationAccumulator::Column* col_acc) {
+  std::vector<std::pair<float, int64_t>> values;
+  values.reserve(col_acc->discretized_numerical_size());
+  for (const auto& item : col_acc->discretized_numerical()) {
+    values.emplace_back(absl::bit_cast<float>(item.first), item.second);
+  }
+  std::sort(values.begin(), values.end());
+
+  while (values.size() > max_num_values) {
+    size_t num_merged_values = 0;
+    for (size_t value_idx = 0; value_idx < values.size(); value_idx += 2) {
+      auto merged_value = values[value_idx];
+      if (value_idx + 1 < values.size()) {
+        const auto& next_value = values[value_idx + 1];
+        if (next_value.second > merged_value.second) {
+          merged_value.first = next_value.first;
+        }
+        merged_value.second += next_value.second;
+      }
+      values[num_merged_values++] = merged_value;
+    }
+    values.resize(num_merged_values);
+  }
+
+  auto* accumulated_values = col_acc->mutable_discretized_numerical();
+  accumulated_values->clear();
+  for (const auto& value : values) {
+    (*accumulated_values)[absl::bit_cast<uint32_t>(value.first)] =
+        value.second;
+  }
+}
+
+}  // namespace
+
+absl::Status MergeColumnStatistics(
+    const proto::DataSpecificationGuide& guide,
+    const proto::DataSpecification& src_data_spec,
+    const proto::DataSpecificationAccumulator& src_accumulator,
+    proto::DataSpecification* dst_data_spec,
+    proto::DataSpecificationAccumulator* dst_accumulator) {
+  if (src_data_spec.columns_size() != dst_data_spec->columns_size() ||
+      src_accumulator.columns_size() != dst_accumulator->columns_size()) {
+    return absl::InvalidArgumentError(
+        "The merged column statistics don't have the same columns");
+  }
+  dst_data_spec->set_created_num_rows(dst_data_spec->created_num_rows() +
+                                      src_data_spec.created_num_rows());
+
+  for (int col_idx = 0; col_idx < src_data_spec.columns_size(); col_idx++) {
+    const auto& src_col = src_data_spec.columns(col_idx);
+    const auto& src_col_acc = src_accumulator.columns(col_idx);
+    auto* dst_col = dst_data_spec->mutable_columns(col_idx);
+    auto* dst_col_acc = dst_accumulator->mutable_columns(col_idx);
+    if (src_col.name() != dst_col->name() ||
+        src_col.type() != dst_col->type()) {
+      return absl::InvalidArgumentError(
+          absl::Substitute("The merged column statistics don't have the same "
+                           "columns: \"$0\" vs \"$1\"",
+                           src_col.name(), dst_col->name()));
+    }
+    dst_col->set_count_nas(dst_col->count_nas() + src_col.count_nas());
+
+    // Numerical values.
+    AccurateSum sum(dst_col_acc->kahan_sum(), dst_col_acc->kahan_sum_error());
+    sum.Add(src_col_acc.kahan_sum());
+    sum.Add(src_col_acc.kahan_sum_error());
+    dst_col_acc->set_kahan_sum(sum.Sum());
+    dst_col_acc->set_kahan_sum_error(sum.ErrorSum());
+
+    AccurateSum sum_of_square(dst_col_acc->kahan_sum_of_square(),
+                              dst_col_acc->kahan_sum_of_square_error());
+    sum_of_square.Add(src_col_acc.kahan_sum_of_square());
+    sum_of_square.Add(src_col_acc.kahan_sum_of_square_error());
+    dst_col_acc->set_kahan_sum_of_square(sum_of_square.Sum());
+    dst_col_acc->set_kahan_sum_of_square_error(sum_of_square.ErrorSum());
+
+    if (src_col_acc.has_min_value() &&
+        (!dst_col_acc->has_min_value() ||
+         src_col_acc.min_value() < dst_col_acc->min_value())) {
+      dst_col_acc->set_min_value(src_col_acc.min_value());
+    }
+    if (src_col_acc.has_max_value() &&
+        (!dst_col_acc->has_max_value() ||
+         src_col_acc.max_value() > dst_col_acc->max_value())) {
+      dst_col_acc->set_max_value(src_col_acc.max_value());
+    }
+
+    // Discretized numerical values.
+    auto* dst_discretized = dst_col_acc->mutable_discretized_numerical();
+    for (const auto& item : src_col_acc.discretized_numerical()) {
+      (*dst_discretized)[item.first] += item.second;
+    }
+
+    // Categorical values.
+    if (IsCategorical(src_col.type())) {
+      if (src_col.categorical().is_already_integerized()) {
+        if (src_col.categorical().number_of_unique_values() >
+            dst_col->categorical().number_of_unique_values()) {
+          dst_col->mutable_categorical()->set_number_of_unique_values(
+              src_col.categorical().number_of_unique_values());
+        }
+      } else {
+        auto* dst_items = dst_col->mutable_categorical()->mutable_items();
+        for (const auto& item : src_col.categorical().items()) {
+          auto& dst_item = (*dst_items)[item.first];
+          dst_item.set_count(dst_item.count() + item.second.count());
+        }
+      }
+    }
+
+    // Boolean values.
+    if (src_col.has_boolean()) {
+      dst_col->mutable_boolean()->set_count_true(
+          dst_col->boolean().count_true() + src_col.boolean().count_true());
+      dst_col->mutable_boolean()->set_count_false(
+          dst_col->boolean().count_false() + src_col.boolean().count_false());
+    }
+  }
+
+  BoundColumnStatisticsMemory(guide, dst_data_spec, dst_accumulator);
+  return absl::OkStatus();
+}
+
+void BoundColumnStatisticsMemory(
+    const proto::DataSpecificationGuide& guide,
+    proto::DataSpecification* data_spec,
+    proto::DataSpecificationAccumulator* accumulator) {
+  for (int col_idx = 0; col_idx < data_spec->columns_size(); col_idx++) {
+    BoundColumnStatisticsMemory(guide, data_spec->mutable_columns(col_idx),
+                                accumulator->mutable_columns(col_idx));
+  }
+}
+
+void BoundColumnStatisticsMemory(
+    const proto::DataSpecificationGuide& guide, proto::Column* col,
+    proto::DataSpecificationAccumulator::Column* col_acc) {
+  const int64_t max_num_items =
+      guide.max_num_categorical_items_to_accumulate_statistics();
+  if (max_num_items > 0 && IsCategorical(col->type()) &&
+      !col->categorical().is_already_integerized() &&
+      col->categorical().items_size() > 2 * max_num_items) {
+    ReduceAccumulatedCategoricalItems(max_num_items, col);
+  }
+  const int64_t max_num_values =
+      guide.max_num_discretized_values_to_accumulate_statistics();
+  if (max_num_values > 0 &&
+      col_acc->discretized_numerical_size() > 2 * max_num_values) {
+    CompactAccumulatedDiscretizedNumerical(max_num_values, col_acc);
+  }
+}
+
 absl::Status UpdateNumericalColumnSpec(
     const float num_value, proto::Column* col,
     proto::DataSpecificationAccumulator::Column* col_acc) {
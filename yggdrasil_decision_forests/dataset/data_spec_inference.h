@@ -92,6 +92,36 @@ absl::Status FinalizeComputeSpec(
     const proto::DataSpecificationAccumulator& accumulator,
     proto::DataSpecification* data_spec);
 
+// Merges the statistics accumulated on a subset of the dataset (i.e. the
+// result of "ComputeColumnStatistics" on some of the shards) into "dst". Both
+// data specs should have the same columns.
+absl::Status MergeColumnStatistics(
+    const proto::DataSpecificationGuide& guide,
+    const proto::DataSpecification& src_data_spec,
+    const proto::DataSpecificationAccumulator& src_accumulator,
+    proto::DataSpecification* dst_data_spec,
+    proto::DataSpecificationAccumulator* dst_accumulator);
+
+// Number of rows scanned by "ComputeColumnStatistics" in between two calls to
+// "BoundColumnStatisticsMemory".
+constexpr int kNumRowsBetweenColumnStatisticsBounding = 10000;
+
+// Limits the memory usage of the statistics being accumulated i.e. the
+// dictionaries of the categorical columns and the unique values of the
+// discretized numerical columns. See
+// "max_num_categorical_items_to_accumulate_statistics" and
+// "max_num_discretized_values_to_accumulate_statistics" in the guide.
+void BoundColumnStatisticsMemory(
+    const proto::DataSpecificationGuide& guide,
+    proto::DataSpecification* data_spec,
+    proto::DataSpecificationAccumulator* accumulator);
+
+// Limits the memory usage of the statistics being accumulated for a single
+// column.
+void BoundColumnStatisticsMemory(
+    const proto::DataSpecificationGuide& guide, proto::Column* col,
+    proto::DataSpecificationAccumulator::Column* col_acc);
+
 // Finalize the inference of the type of each features. Should be called after
 // "InferColumnsAndTypes" and before "ComputeColumnStatistics".
 void FinalizeInferTypes(const proto::DataSpecificationGuide& guide,
@@ -38,6 +38,7 @@
 #include "yggdrasil_decision_forests/utils/logging.h"
 #include "yggdrasil_decision_forests/utils/sharded_io.h"
 #include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
 
 namespace yggdrasil_decision_forests {
 namespace dataset {
@@ -835,6 +836,266 @@ TEST(Dataset, OverrideMostFrequentItemFail2) {
                    .ok());
 }
 
+TEST(Dataset, ParallelColumnStatistics) {
+  const std::string path = file::JoinPath(DatasetDir(), "adult_test.csv");
+  const std::string typed_path =
+      absl::StrCat("csv:", path, ",", path, ",", path);
+  proto::DataSpecificationGuide guide = PARSE_TEST_PROTO(
+      R"pb(
+        column_guides {
+          column_name_pattern: "^age$"
+          type: DISCRETIZED_NUMERICAL
+        }
+        column_guides {
+          column_name_pattern: "^education_num$"
+          type: BOOLEAN
+        }
+      )pb");
+  guide.set_num_threads_to_accumulate_statistics(1);
+  ASSERT_OK_AND_ASSIGN(const auto sequential,
+                       CreateDataSpec(typed_path, guide));
+  guide.set_num_threads_to_accumulate_statistics(2);
+  ASSERT_OK_AND_ASSIGN(const auto parallel, CreateDataSpec(typed_path, guide));
+  EXPECT_GT(parallel.created_num_rows(), 0);
+  EXPECT_THAT(parallel, ApproximatelyEqualsProto(sequential));
+}
+
+TEST(Dataset, BoundedCategoricalDictionary) {
+  // 5 frequent items and 5000 items observed once.
+  std::string content = "a\n";
+  for (int row_idx = 0; row_idx < 5000; row_idx++) {
+    absl::StrAppend(&content, "f", row_idx % 5, "\n", "u", row_idx, "\n");
+  }
+  const auto path =
+      file::JoinPath(test::TmpDirectory(), "bounded_dictionary.csv");
+  ASSERT_OK(file::SetContent(path, content));
+
+  proto::DataSpecificationGuide guide = PARSE_TEST_PROTO(
+      R"pb(
+        column_guides { column_name_pattern: "^a$" type: CATEGORICAL }
+        max_num_categorical_items_to_accumulate_statistics: 10
+      )pb");
+  ASSERT_OK_AND_ASSIGN(const auto data_spec,
+                       CreateDataSpec(absl::StrCat("csv:", path), guide));
+  const auto& col = data_spec.columns(0);
+  EXPECT_EQ(col.categorical().number_of_unique_values(), 6);
+  // The dictionary is reduced once, after 10000 rows: The count of the 11-th
+  // most frequent item (i.e. 1) is subtracted from all the items.
+  for (int item_idx = 0; item_idx < 5; item_idx++) {
+    EXPECT_EQ(
+        col.categorical().items().at(absl::StrCat("f", item_idx)).count(),
+        999);
+  }
+  EXPECT_EQ(col.categorical().items().at(kOutOfDictionaryItemKey).count(),
+            5005);
+}
+
+TEST(Dataset, CategoricalDictionaryNotBoundedByDefault) {
+  std::string content = "a\n";
+  for (int row_idx = 0; row_idx < 5000; row_idx++) {
+    absl::StrAppend(&content, "f", row_idx % 5, "\n", "u", row_idx, "\n");
+  }
+  const auto path =
+      file::JoinPath(test::TmpDirectory(), "unbounded_dictionary.csv");
+  ASSERT_OK(file::SetContent(path, content));
+
+  proto::DataSpecificationGuide guide = PARSE_TEST_PROTO(
+      R"pb(
+        column_guides { column_name_pattern: "^a$" type: CATEGORICAL }
+      )pb");
+  EXPECT_EQ(guide.max_num_categorical_items_to_accumulate_statistics(), -1);
+  ASSERT_OK_AND_ASSIGN(const auto data_spec,
+                       CreateDataSpec(absl::StrCat("csv:", path), guide));
+  const auto& col = data_spec.columns(0);
+  for (int item_idx = 0; item_idx < 5; item_idx++) {
+    EXPECT_EQ(
+        col.categorical().items().at(absl::StrCat("f", item_idx)).count(),
+        1000);
+  }
+  EXPECT_EQ(col.categorical().items().at(kOutOfDictionaryItemKey).count(),
+            5000);
+}
+
+TEST(Dataset, BoundedCategoricalDictionaryParallel) {
+  // Each shard contains 5 frequent items and 5000 items observed once.
+  std::vector<std::string> paths;
+  for (const char* prefix : {"f", "g"}) {
+    std::string content = "a\n";
+    for (int row_idx = 0; row_idx < 5000; row_idx++) {
+      absl::StrAppend(&content, prefix, row_idx % 5, "\n", prefix, "u",
+                      row_idx, "\n");
+    }
+    paths.push_back(file::JoinPath(
+        test::TmpDirectory(),
+        absl::StrCat("bounded_dictionary_parallel_", prefix, ".csv")));
+    ASSERT_OK(file::SetContent(paths.back(), content));
+  }
+
+  proto::DataSpecificationGuide guide = PARSE_TEST_PROTO(
+      R"pb(
+        column_guides { column_name_pattern: "^a$" type: CATEGORICAL }
+        max_num_categorical_items_to_accumulate_statistics: 10
+        num_threads_to_accumulate_statistics: 2
+      )pb");
+  ASSERT_OK_AND_ASSIGN(
+      const auto data_spec,
+      CreateDataSpec(absl::StrCat("csv:", paths[0], ",", paths[1]), guide));
+  const auto& col = data_spec.columns(0);
+  EXPECT_EQ(data_spec.created_num_rows(), 20000);
+  EXPECT_EQ(col.categorical().number_of_unique_values(), 11);
+
+  // The counts are under-estimated by at most N/(k+1).
+  const int64_t max_error = 20000 / 11;
+  int64_t sum_counts = 0;
+  for (const char* prefix : {"f", "g"}) {
+    for (int item_idx = 0; item_idx < 5; item_idx++) {
+      const int64_t count = col.categorical()
+                                .items()
+                                .at(absl::StrCat(prefix, item_idx))
+                                .count();
+      EXPECT_LE(count, 1000);
+      EXPECT_GE(count, 1000 - max_error);
+      sum_counts += count;
+    }
+  }
+  EXPECT_EQ(sum_counts +
+                col.categorical().items().at(kOutOfDictionaryItemKey).count(),
+            20000);
+}
+
+TEST(Dataset, ParallelTypeInference) {
+  const auto path_1 = file::JoinPath(test::TmpDirectory(), "types_1.csv");
+  ASSERT_OK(file::SetContent(path_1, "a,b,c,d\n0,1,1 2,0\n1,2,3,1\n"));
+  const auto path_2 = file::JoinPath(test::TmpDirectory(), "types_2.csv");
+  ASSERT_OK(file::SetContent(path_2, "a,b,c,d\n1.5,x,y,1\n,,,\n"));
+  const std::string typed_path = absl::StrCat("csv:", path_1, ",", path_2);
+
+  proto::DataSpecificationGuide guide;
+  guide.set_max_num_scanned_rows_to_guess_type(-1);
+  guide.set_num_threads_to_accumulate_statistics(1);
+  ASSERT_OK_AND_ASSIGN(const auto sequential,
+                       CreateDataSpec(typed_path, guide));
+  guide.set_num_threads_to_accumulate_statistics(2);
+  ASSERT_OK_AND_ASSIGN(const auto parallel, CreateDataSpec(typed_path, guide));
+  EXPECT_THAT(parallel, ApproximatelyEqualsProto(sequential));
+
+  EXPECT_EQ(parallel.columns(0).type(), proto::NUMERICAL);
+  EXPECT_EQ(parallel.columns(1).type(), proto::CATEGORICAL);
+  EXPECT_EQ(parallel.columns(2).type(), proto::CATEGORICAL_SET);
+  EXPECT_EQ(parallel.columns(3).type(), proto::BOOLEAN);
+}
+
+TEST(Dataset, BoundedDiscretizedNumerical) {
+  std::string content = "a\n";
+  for (int row_idx = 0; row_idx < 20000; row_idx++) {
+    absl::StrAppend(&content, (row_idx * 7919) % 20000, "\n");
+  }
+  const auto path =
+      file::JoinPath(test::TmpDirectory(), "bounded_discretized.csv");
+  ASSERT_OK(file::SetContent(path, content));
+
+  proto::DataSpecificationGuide guide = PARSE_TEST_PROTO(
+      R"pb(
+        column_guides {
+          column_name_pattern: "^a$"
+          type: DISCRETIZED_NUMERICAL
+          discretized_numerical { maximum_num_bins: 32 }
+        }
+      )pb");
+  ASSERT_OK_AND_ASSIGN(const auto exact,
+                       CreateDataSpec(absl::StrCat("csv:", path), guide));
+  guide.set_max_num_discretized_values_to_accumulate_statistics(1000);
+  ASSERT_OK_AND_ASSIGN(const auto approximate,
+                       CreateDataSpec(absl::StrCat("csv:", path), guide));
+
+  const auto& exact_col = exact.columns(0).discretized_numerical();
+  const auto& approximate_col = approximate.columns(0).discretized_numerical();
+  EXPECT_EQ(exact_col.original_num_unique_values(), 20000);
+  EXPECT_LE(approximate_col.original_num_unique_values(), 1000);
+  ASSERT_EQ(approximate_col.boundaries_size(), exact_col.boundaries_size());
+  for (int boundary_idx = 0; boundary_idx < exact_col.boundaries_size();
+       boundary_idx++) {
+    EXPECT_NEAR(approximate_col.boundaries(boundary_idx),
+                exact_col.boundaries(boundary_idx), 200);
+  }
+}
+
+TEST(Dataset, DiscretizedNumericalNotCompactedByDefault) {
+  std::string content = "a\n";
+  for (int row_idx = 0; row_idx < 30000; row_idx++) {
+    absl::StrAppend(&content, row_idx, "\n");
+  }
+  const auto path =
+      file::JoinPath(test::TmpDirectory(), "default_discretized.csv");
+  ASSERT_OK(file::SetContent(path, content));
+
+  const proto::DataSpecificationGuide guide = PARSE_TEST_PROTO(
+      R"pb(
+        column_guides { column_name_pattern: "^a$" type: DISCRETIZED_NUMERICAL }
+      )pb");
+  ASSERT_OK_AND_ASSIGN(const auto data_spec,
+                       CreateDataSpec(absl::StrCat("csv:", path), guide));
+  EXPECT_EQ(
+      data_spec.columns(0).discretized_numerical().original_num_unique_values(),
+      30000);
+}
+
+TEST(Dataset, BoundedDiscretizedNumericalSkewed) {
+  // Half of the values are 0. The other values are cubes, i.e. most of the
+  // unique values are in the long right tail.
+  std::vector<float> values;
+  std::string content = "a\n";
+  for (int row_idx = 0; row_idx < 20000; row_idx++) {
+    const int64_t x = (row_idx * 7919) % 10000;
+    const float value =
+        (row_idx % 2 == 0) ? 0.f : static_cast<float>(x * x * x);
+    values.push_back(value);
+    absl::StrAppend(&content, value, "\n");
+  }
+  std::sort(values.begin(), values.end());
+  const auto path =
+      file::JoinPath(test::TmpDirectory(), "bounded_discretized_skewed.csv");
+  ASSERT_OK(file::SetContent(path, content));
+
+  proto::DataSpecificationGuide guide = PARSE_TEST_PROTO(
+      R"pb(
+        column_guides {
+          column_name_pattern: "^a$"
+          type: DISCRETIZED_NUMERICAL
+          discretized_numerical { maximum_num_bins: 32 }
+        }
+        max_num_discretized_values_to_accumulate_statistics: 500
+      )pb");
+  ASSERT_OK_AND_ASSIGN(const auto approximate,
+                       CreateDataSpec(absl::StrCat("csv:", path), guide));
+  guide.clear_max_num_discretized_values_to_accumulate_statistics();
+  ASSERT_OK_AND_ASSIGN(const auto exact,
+                       CreateDataSpec(absl::StrCat("csv:", path), guide));
+
+  // Fraction of the values smaller than "boundary".
+  const auto rank = [&](const float boundary) {
+    return static_cast<double>(
+               std::lower_bound(values.begin(), values.end(), boundary) -
+               values.begin()) /
+           values.size();
+  };
+
+  const auto& exact_col = exact.columns(0).discretized_numerical();
+  const auto& approximate_col = approximate.columns(0).discretized_numerical();
+  EXPECT_LE(approximate_col.original_num_unique_values(), 500);
+  // The heavy value 0 is kept exactly.
+  ASSERT_GT(approximate_col.boundaries_size(), 0);
+  EXPECT_NEAR(rank(approximate_col.boundaries(0)), 0.5, 0.01);
+  // The boundaries are compared in rank space: In value space, the
+  // differences in the tail are arbitrarily large.
+  ASSERT_EQ(approximate_col.boundaries_size(), exact_col.boundaries_size());
+  for (int boundary_idx = 0; boundary_idx < exact_col.boundaries_size();
+       boundary_idx++) {
+    EXPECT_NEAR(rank(approximate_col.boundaries(boundary_idx)),
+                rank(exact_col.boundaries(boundary_idx)), 0.02);
+  }
+}
+
 }  // namespace
 }  // namespace dataset
 }  // namespace yggdrasil_decision_forests
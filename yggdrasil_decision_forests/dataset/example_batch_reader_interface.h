@@ -0,0 +1,67 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Base interface for a stream of examples read directly into the columns of a
+// VerticalDataset i.e. without intermediate proto::Example.
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_DATASET_EXAMPLE_BATCH_READER_INTERFACE_H_
+#define YGGDRASIL_DECISION_FORESTS_DATASET_EXAMPLE_BATCH_READER_INTERFACE_H_
+
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/utils/registration.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+
+// Interface to read a stream of examples, batch by batch, into a
+// VerticalDataset.
+//
+// The reader is constructed with the dataspec, the "required_columns" (see
+// "CreateExampleReader") and the "load_columns" i.e. the subset of columns to
+// fill (all the columns if not set).
+class ExampleBatchReaderInterface {
+ public:
+  virtual ~ExampleBatchReaderInterface() = default;
+
+  virtual absl::Status Open(absl::string_view sharded_path) = 0;
+
+  // Appends the next batch of examples at the end of "dataset". "dataset"
+  // should contain the columns of the dataspec (e.g. created with
+  // "CreateColumnsFromDataspec"). Only the "load_columns" are filled, and the
+  // number of rows of "dataset" is updated. Returns the number of examples
+  // appended. Returns 0 when all the examples have been read.
+  virtual absl::StatusOr<VerticalDataset::row_t> NextBatch(
+      VerticalDataset* dataset) = 0;
+};
+
+REGISTRATION_CREATE_POOL(ExampleBatchReaderInterface,
+                         const proto::DataSpecification&,
+                         absl::optional<std::vector<int>>,
+                         absl::optional<std::vector<int>>);
+
+#define REGISTER_ExampleBatchReaderInterface(name, key) \
+  REGISTRATION_REGISTER_CLASS(name, key, ExampleBatchReaderInterface)
+
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_DATASET_EXAMPLE_BATCH_READER_INTERFACE_H_
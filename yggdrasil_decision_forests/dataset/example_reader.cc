@@ -28,6 +28,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/example_batch_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/example_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/formats.h"
 #include "yggdrasil_decision_forests/dataset/formats.pb.h"
@@ -68,5 +69,37 @@ absl::StatusOr<bool> IsFormatSupported(absl::string_view typed_path) {
   return ExampleReaderInterfaceRegisterer::IsName(format_name);
 }
 
+absl::StatusOr<std::unique_ptr<ExampleBatchReaderInterface>>
+CreateExampleBatchReader(
+    const absl::string_view typed_path,
+    const proto::DataSpecification& data_spec,
+    const absl::optional<std::vector<int>>& required_columns,
+    const absl::optional<std::vector<int>>& load_columns) {
+  std::string sharded_path;
+  proto::DatasetFormat format;
+  ASSIGN_OR_RETURN(std::tie(sharded_path, format),
+                   GetDatasetPathAndTypeOrStatus(typed_path));
+
+  const std::string& format_name = proto::DatasetFormat_Name(format);
+  ASSIGN_OR_RETURN(auto reader,
+                   ExampleBatchReaderInterfaceRegisterer::Create(
+                       format_name, data_spec, required_columns, load_columns),
+                   _ << "When creating an example batch reader to read "
+                     << sharded_path
+                     << ". Make sure the format dependency is linked");
+  RETURN_IF_ERROR(reader->Open(sharded_path));
+  return std::move(reader);
+}
+
+bool IsBatchFormatSupported(const absl::string_view typed_path) {
+  const auto path_format_or = GetDatasetPathAndTypeOrStatus(typed_path);
+  if (!path_format_or.ok()) {
+    return false;
+  }
+  const std::string& format_name =
+      proto::DatasetFormat_Name(std::get<1>(path_format_or.value()));
+  return ExampleBatchReaderInterfaceRegisterer::IsName(format_name);
+}
+
 }  // namespace dataset
 }  // namespace yggdrasil_decision_forests
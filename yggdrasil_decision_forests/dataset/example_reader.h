@@ -20,6 +20,8 @@
 //
 // Supported readers are:
 //   - CreateExampleReader: Sequential "in-order" local reading.
+//   - CreateExampleBatchReader: Sequential "in-order" local reading directly
+//     into the columns of a VerticalDataset.
 //
 //
 // See proto::DatasetFormat for a list of supported dataset format.
@@ -43,6 +45,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/example_batch_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/example_reader_interface.h"
 
 namespace yggdrasil_decision_forests {
@@ -71,6 +74,23 @@ absl::StatusOr<std::unique_ptr<ExampleReaderInterface>> CreateExampleReader(
 // cannot be parsed. Note: This function does not read the target file.
 absl::StatusOr<bool> IsFormatSupported(absl::string_view typed_path);
 
+// Creates a batch reader reading the examples directly into the columns of a
+// VerticalDataset. Only the "load_columns" are filled (all the columns if not
+// set). See "CreateExampleReader" for the semantic of "required_columns".
+//
+// Only some of the formats support batch reading (see
+// "IsBatchFormatSupported"). The examples are read in the same order as with
+// "CreateExampleReader".
+absl::StatusOr<std::unique_ptr<ExampleBatchReaderInterface>>
+CreateExampleBatchReader(
+    absl::string_view typed_path, const proto::DataSpecification& data_spec,
+    const absl::optional<std::vector<int>>& required_columns = {},
+    const absl::optional<std::vector<int>>& load_columns = {});
+
+// Checks if a batch reader is registered for the format of a typed dataset.
+// Returns false if the typed path cannot be parsed.
+bool IsBatchFormatSupported(absl::string_view typed_path);
+
 }  // namespace dataset
 }  // namespace yggdrasil_decision_forests
 
@@ -87,6 +87,8 @@ std::string FormatToRecommendedExtension(proto::DatasetFormat format) {
       return "tfrecord";
     case proto::FORMAT_PARTIAL_DATASET_CACHE:
       return "partial_dataset_cache";
+    case proto::FORMAT_YDF_COLUMNAR:
+      return "ydf_columnar";
   }
 }
 
@@ -101,6 +103,8 @@ std::string DatasetFormatToPrefix(proto::DatasetFormat format) {
       return FORMAT_TFE_TFRECORD;
     case proto::FORMAT_PARTIAL_DATASET_CACHE:
       return FORMAT_PARTIAL_DATASET_CACHE;
+    case proto::FORMAT_YDF_COLUMNAR:
+      return FORMAT_YDF_COLUMNAR;
   }
 }
 
@@ -42,6 +42,10 @@ const char* const FORMAT_TFE_TFRECORD = "tfrecord+tfe";
 // Partially computed (e.g. non indexed) dataset cache.
 const char* const FORMAT_PARTIAL_DATASET_CACHE = "partial_dataset_cache";
 
+// Columns of a VerticalDataset stored in a binary file. See
+// "columnar_dataset_io.h".
+const char* const FORMAT_YDF_COLUMNAR = "ydf_columnar";
+
 // Splits the format and path from a typed path.
 std::pair<std::string, proto::DatasetFormat> GetDatasetPathAndType(
     absl::string_view typed_path);
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Row-major matrix of small integer bin indices.
+//
+// A "VerticalDataset" stores each column in a separate buffer. Reading the
+// values of many columns for a random subset of examples (e.g. the examples in
+// a decision tree node) costs one cache miss per example and per column. A
+// "PackedBinMatrix" stores the bin indices of all the packed columns of an
+// example contiguously. Algorithms that process all the columns of an example
+// at once (e.g. the computation of the histograms of all the features in a
+// node) read the matrix sequentially.
+//
+// This representation is used during training only (see
+// "decision_tree::PackBinnedNumericalFeatures").
+//
+// Usage example:
+//
+//   PackedBinMatrix<uint8_t> matrix(num_examples, {1, 2, 5});
+//   matrix.MutableRow(example_idx)[1] = bin_of_column_2;
+//   const uint8_t* row = matrix.Row(example_idx);
+//   // row[i] is the bin of the column matrix.column_idxs()[i].
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_DATASET_PACKED_BIN_MATRIX_H_
+#define YGGDRASIL_DECISION_FORESTS_DATASET_PACKED_BIN_MATRIX_H_
+
+#include <stddef.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "yggdrasil_decision_forests/dataset/types.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+
+template <typename Bin>
+class PackedBinMatrix {
+ public:
+  using BinType = Bin;
+
+  PackedBinMatrix() = default;
+
+  // Allocates a zero initialized matrix with "num_rows" rows and one packed
+  // column for each of the dataset columns "column_idxs".
+  PackedBinMatrix(const UnsignedExampleIdx num_rows,
+                  std::vector<int> column_idxs)
+      : num_rows_(num_rows),
+        column_idxs_(std::move(column_idxs)),
+        bins_(static_cast<size_t>(num_rows) * column_idxs_.size(), 0) {}
+
+  bool empty() const { return column_idxs_.empty(); }
+
+  UnsignedExampleIdx num_rows() const { return num_rows_; }
+
+  int num_packed_columns() const { return column_idxs_.size(); }
+
+  // Dataset column index of each packed column.
+  const std::vector<int>& column_idxs() const { return column_idxs_; }
+
+  // Bins of the example "row". The bin of the i-th packed column is "Row()[i]".
+  const Bin* Row(const UnsignedExampleIdx row) const {
+    return bins_.data() + static_cast<size_t>(row) * column_idxs_.size();
+  }
+
+  Bin* MutableRow(const UnsignedExampleIdx row) {
+    return bins_.data() + static_cast<size_t>(row) * column_idxs_.size();
+  }
+
+  // Bin of the "packed_idx"-th packed column of the example "row".
+  Bin Get(const UnsignedExampleIdx row, const int packed_idx) const {
+    return Row(row)[packed_idx];
+  }
+
+ private:
+  UnsignedExampleIdx num_rows_ = 0;
+  std::vector<int> column_idxs_;
+  std::vector<Bin> bins_;
+};
+
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_DATASET_PACKED_BIN_MATRIX_H_
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/dataset/packed_bin_matrix.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace yggdrasil_decision_forests {
+namespace dataset {
+namespace {
+
+using testing::ElementsAre;
+
+TEST(PackedBinMatrix, Base) {
+  PackedBinMatrix<uint8_t> matrix(3, {2, 1});
+  EXPECT_FALSE(matrix.empty());
+  EXPECT_EQ(matrix.num_rows(), 3);
+  EXPECT_EQ(matrix.num_packed_columns(), 2);
+  EXPECT_THAT(matrix.column_idxs(), ElementsAre(2, 1));
+
+  // The matrix is zero initialized.
+  EXPECT_THAT(std::vector<uint8_t>(matrix.Row(2), matrix.Row(2) + 2),
+              ElementsAre(0, 0));
+
+  for (int row = 0; row < 3; row++) {
+    matrix.MutableRow(row)[0] = row;
+    matrix.MutableRow(row)[1] = 10 + row;
+  }
+
+  // The bins of an example are contiguous.
+  EXPECT_THAT(std::vector<uint8_t>(matrix.Row(0), matrix.Row(0) + 6),
+              ElementsAre(0, 10, 1, 11, 2, 12));
+  EXPECT_EQ(matrix.Get(1, 0), 1);
+  EXPECT_EQ(matrix.Get(1, 1), 11);
+}
+
+TEST(PackedBinMatrix, Empty) {
+  const PackedBinMatrix<uint16_t> default_matrix;
+  EXPECT_TRUE(default_matrix.empty());
+
+  const PackedBinMatrix<uint16_t> no_columns(10, {});
+  EXPECT_TRUE(no_columns.empty());
+  EXPECT_EQ(no_columns.num_rows(), 10);
+}
+
+}  // namespace
+}  // namespace dataset
+}  // namespace yggdrasil_decision_forests
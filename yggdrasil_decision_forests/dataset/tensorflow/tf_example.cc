@@ -43,6 +43,126 @@ namespace {
 using proto::ColumnType;
 }  // namespace
 
+absl::Status TfFeatureToAttribute(const tensorflow::Feature& feature,
+                                  const proto::Column& col_spec,
+                                  proto::Example::Attribute* attribute) {
+  switch (col_spec.type()) {
+    case ColumnType::UNKNOWN:
+      break;
+    case ColumnType::NUMERICAL: {
+      ASSIGN_OR_RETURN(const float num_value,
+                       internal::GetSingleFloatFromTFFeature(
+                           feature, col_spec));
+      attribute->set_numerical(num_value);
+    } break;
+    case ColumnType::DISCRETIZED_NUMERICAL: {
+      ASSIGN_OR_RETURN(const float num_value,
+                       internal::GetSingleFloatFromTFFeature(
+                           feature, col_spec));
+      attribute->set_discretized_numerical(
+          NumericalToDiscretizedNumerical(col_spec, num_value));
+    } break;
+    case ColumnType::NUMERICAL_SET:
+    case ColumnType::NUMERICAL_LIST: {
+      std::vector<float> values;
+      RETURN_IF_ERROR(internal::GetNumericalValuesFromTFFeature(
+          feature, col_spec, &values));
+
+      google::protobuf::RepeatedField<float>* dst;
+      if (col_spec.type() == ColumnType::NUMERICAL_SET) {
+        dst = attribute->mutable_numerical_set()->mutable_values();
+      } else {
+        dst = attribute->mutable_numerical_list()->mutable_values();
+      }
+      dst->Reserve(values.size());
+      for (const float& value : values) {
+        dst->Add(value);
+      }
+      if (col_spec.type() == ColumnType::NUMERICAL_SET) {
+        // Sets are expected to be sorted.
+        std::sort(dst->begin(), dst->end());
+        dst->erase(std::unique(dst->begin(), dst->end()), dst->end());
+      }
+    } break;
+    case ColumnType::CATEGORICAL: {
+      std::vector<std::string> tokens;
+      RETURN_IF_ERROR(internal::GetCategoricalTokensFromTFFeature(
+          feature, col_spec, &tokens));
+      if (tokens.empty()) {
+        // NA.
+      } else if (tokens.size() == 1) {
+        ASSIGN_OR_RETURN(auto value, CategoricalStringToValueWithStatus(
+                                         tokens[0], col_spec));
+        attribute->set_categorical(value);
+      } else {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Categorical attribute with more than one value for feature %s",
+            col_spec.name()));
+      }
+    } break;
+    case ColumnType::CATEGORICAL_SET:
+    case ColumnType::CATEGORICAL_LIST: {
+      std::vector<std::string> tokens;
+      RETURN_IF_ERROR(internal::GetCategoricalTokensFromTFFeature(
+          feature, col_spec, &tokens));
+
+      google::protobuf::RepeatedField<int32_t>* dst;
+      if (col_spec.type() == ColumnType::CATEGORICAL_SET) {
+        dst = attribute->mutable_categorical_set()->mutable_values();
+      } else {
+        dst = attribute->mutable_categorical_list()->mutable_values();
+      }
+
+      dst->Reserve(tokens.size());
+      for (const std::string& token : tokens) {
+        ASSIGN_OR_RETURN(auto value,
+                         CategoricalStringToValueWithStatus(token, col_spec));
+        dst->Add(value);
+      }
+      if (col_spec.type() == ColumnType::CATEGORICAL_SET) {
+        // Sets are expected to be sorted.
+        std::sort(dst->begin(), dst->end());
+        dst->erase(std::unique(dst->begin(), dst->end()), dst->end());
+      }
+    } break;
+    case ColumnType::BOOLEAN: {
+      ASSIGN_OR_RETURN(const float num_value,
+                       internal::GetSingleFloatFromTFFeature(
+                           feature, col_spec));
+      attribute->set_boolean(num_value >= 0.5f);
+    } break;
+    case ColumnType::STRING:
+      STATUS_CHECK_EQ(feature.kind_case(),
+                      tensorflow::Feature::KindCase::kBytesList);
+      if (feature.bytes_list().value().empty()) {
+        // NA
+      } else if (feature.bytes_list().value().size() == 1) {
+        *attribute->mutable_text() = feature.bytes_list().value()[0];
+      } else {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "String attribute with more than one value for feature %s",
+            col_spec.name()));
+      }
+      break;
+
+    case ColumnType::HASH: {
+      std::vector<std::string> tokens;
+      RETURN_IF_ERROR(internal::GetCategoricalTokensFromTFFeature(
+          feature, col_spec, &tokens));
+      if (tokens.empty()) {
+        // NA.
+      } else if (tokens.size() == 1) {
+        attribute->set_hash(HashColumnString(tokens[0]));
+      } else {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Hash attribute with more than one value for feature %s",
+            col_spec.name()));
+      }
+    } break;
+  }
+  return absl::OkStatus();
+}
+
 absl::Status TfExampleToYdfExample(const tensorflow::Example& tf_example,
                                    const proto::DataSpecification& data_spec,
                                    proto::Example* example) {
@@ -140,121 +260,8 @@ absl::Status TfExampleToYdfExample(const tensorflow::Example& tf_example,
       continue;
     }
 
-    switch (col_spec.type()) {
-      case ColumnType::UNKNOWN:
-        break;
-      case ColumnType::NUMERICAL: {
-        ASSIGN_OR_RETURN(const float num_value,
-                         internal::GetSingleFloatFromTFFeature(
-                             it_feature->second, col_spec));
-        dst_value->set_numerical(num_value);
-      } break;
-      case ColumnType::DISCRETIZED_NUMERICAL: {
-        ASSIGN_OR_RETURN(const float num_value,
-                         internal::GetSingleFloatFromTFFeature(
-                             it_feature->second, col_spec));
-        dst_value->set_discretized_numerical(
-            NumericalToDiscretizedNumerical(col_spec, num_value));
-      } break;
-      case ColumnType::NUMERICAL_SET:
-      case ColumnType::NUMERICAL_LIST: {
-        std::vector<float> values;
-        RETURN_IF_ERROR(internal::GetNumericalValuesFromTFFeature(
-            it_feature->second, col_spec, &values));
-
-        google::protobuf::RepeatedField<float>* dst;
-        if (col_spec.type() == ColumnType::NUMERICAL_SET) {
-          dst = dst_value->mutable_numerical_set()->mutable_values();
-        } else {
-          dst = dst_value->mutable_numerical_list()->mutable_values();
-        }
-        dst->Reserve(values.size());
-        for (const float& value : values) {
-          dst->Add(value);
-        }
-        if (col_spec.type() == ColumnType::NUMERICAL_SET) {
-          // Sets are expected to be sorted.
-          std::sort(dst->begin(), dst->end());
-          dst->erase(std::unique(dst->begin(), dst->end()), dst->end());
-        }
-      } break;
-      case ColumnType::CATEGORICAL: {
-        std::vector<std::string> tokens;
-        RETURN_IF_ERROR(internal::GetCategoricalTokensFromTFFeature(
-            it_feature->second, col_spec, &tokens));
-        if (tokens.empty()) {
-          // NA.
-        } else if (tokens.size() == 1) {
-          ASSIGN_OR_RETURN(auto value, CategoricalStringToValueWithStatus(
-                                           tokens[0], col_spec));
-          dst_value->set_categorical(value);
-        } else {
-          return absl::InvalidArgumentError(absl::StrFormat(
-              "Categorical attribute with more than one value for feature %s",
-              it_feature->first));
-        }
-      } break;
-      case ColumnType::CATEGORICAL_SET:
-      case ColumnType::CATEGORICAL_LIST: {
-        std::vector<std::string> tokens;
-        RETURN_IF_ERROR(internal::GetCategoricalTokensFromTFFeature(
-            it_feature->second, col_spec, &tokens));
-
-        google::protobuf::RepeatedField<int32_t>* dst;
-        if (col_spec.type() == ColumnType::CATEGORICAL_SET) {
-          dst = dst_value->mutable_categorical_set()->mutable_values();
-        } else {
-          dst = dst_value->mutable_categorical_list()->mutable_values();
-        }
-
-        dst->Reserve(tokens.size());
-        for (const std::string& token : tokens) {
-          ASSIGN_OR_RETURN(auto value,
-                           CategoricalStringToValueWithStatus(token, col_spec));
-          dst->Add(value);
-        }
-        if (col_spec.type() == ColumnType::CATEGORICAL_SET) {
-          // Sets are expected to be sorted.
-          std::sort(dst->begin(), dst->end());
-          dst->erase(std::unique(dst->begin(), dst->end()), dst->end());
-        }
-      } break;
-      case ColumnType::BOOLEAN: {
-        ASSIGN_OR_RETURN(const float num_value,
-                         internal::GetSingleFloatFromTFFeature(
-                             it_feature->second, col_spec));
-        dst_value->set_boolean(num_value >= 0.5f);
-      } break;
-      case ColumnType::STRING:
-        STATUS_CHECK_EQ(it_feature->second.kind_case(),
-                        tensorflow::Feature::KindCase::kBytesList);
-        if (it_feature->second.bytes_list().value().empty()) {
-          // NA
-        } else if (it_feature->second.bytes_list().value().size() == 1) {
-          *dst_value->mutable_text() =
-              it_feature->second.bytes_list().value()[0];
-        } else {
-          return absl::InvalidArgumentError(absl::StrFormat(
-              "String attribute with more than one value for feature %s",
-              it_feature->first));
-        }
-        break;
-
-      case ColumnType::HASH: {
-        std::vector<std::string> tokens;
-        RETURN_IF_ERROR(internal::GetCategoricalTokensFromTFFeature(
-            it_feature->second, col_spec, &tokens));
-        if (tokens.empty()) {
-          // NA.
-        } else if (tokens.size() == 1) {
-          dst_value->set_hash(HashColumnString(tokens[0]));
-        } else {
-          return absl::InvalidArgumentError(absl::StrFormat(
-              "Hash attribute with more than one value for feature %s",
-              it_feature->first));
-        }
-      } break;
-    }
+    RETURN_IF_ERROR(TfFeatureToAttribute(it_feature->second, col_spec,
+                                         dst_value));
   }
   return absl::OkStatus();
 }
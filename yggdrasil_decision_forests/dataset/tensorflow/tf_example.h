@@ -32,6 +32,13 @@ absl::Status TfExampleToYdfExample(const ::tensorflow::Example& tf_example,
                                    const proto::DataSpecification& data_spec,
                                    proto::Example* example);
 
+// Converts the feature of a tf.Example into an example attribute. The feature
+// should be set (i.e. kind_case != KIND_NOT_SET). Does not support unstacked
+// columns.
+absl::Status TfFeatureToAttribute(const ::tensorflow::Feature& feature,
+                                  const proto::Column& col_spec,
+                                  proto::Example::Attribute* attribute);
+
 // Converts a proto::Example into a tensorflow::Example.
 absl::Status YdfExampleToTfExample(const proto::Example& example,
                                    const proto::DataSpecification& data_spec,
@@ -39,6 +39,7 @@
 #include "yggdrasil_decision_forests/dataset/formats.h"
 #include "yggdrasil_decision_forests/dataset/formats.pb.h"
 #include "yggdrasil_decision_forests/dataset/tensorflow/tf_example.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
 #include "yggdrasil_decision_forests/utils/sharded_io.h"
 #include "yggdrasil_decision_forests/utils/status_macros.h"
@@ -272,6 +273,125 @@ absl::StatusOr<bool> TFExampleReaderToExampleReader::Next(
   return true;
 }
 
+TFExampleReaderToExampleBatchReader::TFExampleReaderToExampleBatchReader(
+    const proto::DataSpecification& data_spec,
+    const absl::optional<std::vector<int>> ensure_non_missing,
+    const absl::optional<std::vector<int>> load_columns)
+    : data_spec_(data_spec) {
+  std::vector<ColumnSource> all_sources(data_spec_.columns_size());
+  for (int col_idx = 0; col_idx < data_spec_.columns_size(); col_idx++) {
+    all_sources[col_idx].col_idx = col_idx;
+    all_sources[col_idx].feature_name = data_spec_.columns(col_idx).name();
+  }
+  for (const auto& unstacked : data_spec_.unstackeds()) {
+    for (int dim_idx = 0; dim_idx < unstacked.size(); dim_idx++) {
+      auto& source = all_sources[unstacked.begin_column_idx() + dim_idx];
+      source.feature_name = unstacked.original_name();
+      source.dim_idx = dim_idx;
+      source.num_dims = unstacked.size();
+    }
+  }
+  if (load_columns.has_value()) {
+    for (const int col_idx : load_columns.value()) {
+      sources_.push_back(all_sources[col_idx]);
+    }
+  } else {
+    sources_ = std::move(all_sources);
+  }
+}
+
+absl::Status TFExampleReaderToExampleBatchReader::Open(
+    absl::string_view sharded_path) {
+  tf_reader_ = CreateReader();
+  RETURN_IF_ERROR(tf_reader_->Open(sharded_path));
+  return absl::OkStatus();
+}
+
+absl::StatusOr<VerticalDataset::row_t>
+TFExampleReaderToExampleBatchReader::NextBatch(VerticalDataset* dataset) {
+  VerticalDataset::row_t num_rows = 0;
+  while (num_rows < kBatchSize) {
+    ASSIGN_OR_RETURN(bool did_read, tf_reader_->Next(&tfexample_buffer_));
+    if (!did_read) {
+      break;
+    }
+    for (const auto& source : sources_) {
+      RETURN_IF_ERROR(AppendFeature(source, tfexample_buffer_,
+                                    dataset->mutable_column(source.col_idx)));
+    }
+    num_rows++;
+  }
+  dataset->set_nrow(dataset->nrow() + num_rows);
+  return num_rows;
+}
+
+absl::Status TFExampleReaderToExampleBatchReader::AppendFeature(
+    const ColumnSource& source, const tensorflow::Example& example,
+    VerticalDataset::AbstractColumn* column) {
+  const auto& col_spec = data_spec_.columns(source.col_idx);
+  const auto it_feature =
+      example.features().feature().find(source.feature_name);
+  if (it_feature == example.features().feature().end() ||
+      it_feature->second.kind_case() ==
+          tensorflow::Feature::KindCase::KIND_NOT_SET) {
+    column->AddNA();
+    return absl::OkStatus();
+  }
+  const auto& feature = it_feature->second;
+
+  // Unstacked column. Same logic as "TfExampleToYdfExample".
+  if (source.dim_idx >= 0) {
+    float value;
+    switch (feature.kind_case()) {
+      case tensorflow::Feature::KindCase::kFloatList:
+        if (feature.float_list().value_size() != source.num_dims) {
+          return absl::InvalidArgumentError(absl::StrCat(
+              "Wrong number of elements for feature ", source.feature_name));
+        }
+        value = feature.float_list().value(source.dim_idx);
+        break;
+      case tensorflow::Feature::KindCase::kInt64List:
+        if (feature.int64_list().value_size() != source.num_dims) {
+          return absl::InvalidArgumentError(absl::StrCat(
+              "Wrong number of elements for feature ", source.feature_name));
+        }
+        value = feature.int64_list().value(source.dim_idx);
+        break;
+      default:
+        return absl::InvalidArgumentError(
+            absl::StrCat("Feature ", source.feature_name,
+                         " is not stored as float or int64."));
+    }
+    switch (col_spec.type()) {
+      case ColumnType::NUMERICAL:
+        static_cast<VerticalDataset::NumericalColumn*>(column)->Add(value);
+        break;
+      case ColumnType::DISCRETIZED_NUMERICAL:
+        static_cast<VerticalDataset::DiscretizedNumericalColumn*>(column)->Add(
+            NumericalToDiscretizedNumerical(col_spec, value));
+        break;
+      default:
+        return absl::InvalidArgumentError(
+            absl::StrCat(source.feature_name,
+                         "'s type is not supported for stacked feature."));
+    }
+    return absl::OkStatus();
+  }
+
+  // Single value numerical columns don't need an intermediate attribute.
+  if (col_spec.type() == ColumnType::NUMERICAL) {
+    ASSIGN_OR_RETURN(const float value,
+                     internal::GetSingleFloatFromTFFeature(feature, col_spec));
+    static_cast<VerticalDataset::NumericalColumn*>(column)->Add(value);
+    return absl::OkStatus();
+  }
+
+  attribute_buffer_.Clear();
+  RETURN_IF_ERROR(TfFeatureToAttribute(feature, col_spec, &attribute_buffer_));
+  column->AddFromExample(attribute_buffer_);
+  return absl::OkStatus();
+}
+
 absl::Status TFExampleReaderToDataSpecCreator::InferColumnsAndTypes(
     const std::vector<std::string>& paths,
     const proto::DataSpecificationGuide& guide,
@@ -390,6 +510,9 @@ absl::Status TFExampleReaderToDataSpecCreator::ComputeColumnStatistics(
     RETURN_IF_ERROR(
         UpdateDataSpecWithTFExample(example, data_spec, accumulator));
     nrow++;
+    if ((nrow % kNumRowsBetweenColumnStatisticsBounding) == 0) {
+      BoundColumnStatisticsMemory(guide, data_spec, accumulator);
+    }
   }
   data_spec->set_created_num_rows(nrow);
   return absl::OkStatus();
@@ -53,8 +53,10 @@
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/data_spec_inference.h"
 #include "yggdrasil_decision_forests/dataset/example.pb.h"
+#include "yggdrasil_decision_forests/dataset/example_batch_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/example_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/example_writer_interface.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/utils/registration.h"
 #include "yggdrasil_decision_forests/utils/sharded_io.h"
 
@@ -109,6 +111,50 @@ class TFExampleReaderToExampleReader : public ExampleReaderInterface {
   const absl::optional<std::vector<int>> ensure_non_missing_;
 };
 
+// Wrapper around a TFExampleReader with the signature of an Example batch
+// reader. The tf.Examples are converted directly into the columns of the
+// VerticalDataset i.e. without intermediate proto::Example.
+class TFExampleReaderToExampleBatchReader : public ExampleBatchReaderInterface {
+ public:
+  virtual std::unique_ptr<AbstractTFExampleReader> CreateReader() = 0;
+
+  TFExampleReaderToExampleBatchReader(
+      const proto::DataSpecification& data_spec,
+      absl::optional<std::vector<int>> ensure_non_missing,
+      absl::optional<std::vector<int>> load_columns);
+
+  absl::Status Open(absl::string_view sharded_path) override;
+
+  absl::StatusOr<VerticalDataset::row_t> NextBatch(
+      VerticalDataset* dataset) override;
+
+ private:
+  // How to fill a column from a tf.Example.
+  struct ColumnSource {
+    int col_idx;
+    // Name of the tf.Example feature.
+    std::string feature_name;
+    // Index of the value in the feature for unstacked columns. -1 otherwise.
+    int dim_idx = -1;
+    // Number of values of the feature for unstacked columns.
+    int num_dims = 0;
+  };
+
+  // Appends the values of a feature at the end of a column.
+  absl::Status AppendFeature(const ColumnSource& source,
+                             const tensorflow::Example& example,
+                             VerticalDataset::AbstractColumn* column);
+
+  // Maximum number of examples read by "NextBatch".
+  static constexpr int kBatchSize = 1024;
+
+  std::unique_ptr<AbstractTFExampleReader> tf_reader_;
+  tensorflow::Example tfexample_buffer_;
+  proto::Example::Attribute attribute_buffer_;
+  const proto::DataSpecification data_spec_;
+  std::vector<ColumnSource> sources_;
+};
+
 // Wrapper around a TFExampleReader with the signature of an dataspec generator.
 class TFExampleReaderToDataSpecCreator : public AbstractDataSpecCreator {
  public:
@@ -26,6 +26,7 @@
 #include "tensorflow/core/example/example.pb.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/data_spec_inference.h"
+#include "yggdrasil_decision_forests/dataset/example_batch_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/example_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/example_writer_interface.h"
 #include "yggdrasil_decision_forests/dataset/tensorflow/tf_example_io_interface.h"
@@ -54,6 +55,23 @@ class TFRecordTFEToExampleReaderInterface
 REGISTER_ExampleReaderInterface(TFRecordTFEToExampleReaderInterface,
                                 "FORMAT_TFE_TFRECORD");
 
+class TFRecordTFEToExampleBatchReaderInterface
+    : public TFExampleReaderToExampleBatchReader {
+ public:
+  TFRecordTFEToExampleBatchReaderInterface(
+      const proto::DataSpecification& data_spec,
+      absl::optional<std::vector<int>> ensure_non_missing,
+      absl::optional<std::vector<int>> load_columns)
+      : TFExampleReaderToExampleBatchReader(data_spec, ensure_non_missing,
+                                            load_columns) {}
+
+  std::unique_ptr<AbstractTFExampleReader> CreateReader() override {
+    return absl::make_unique<TFRecordTFExampleReader>();
+  }
+};
+REGISTER_ExampleBatchReaderInterface(TFRecordTFEToExampleBatchReaderInterface,
+                                     "FORMAT_TFE_TFRECORD");
+
 class TFRTFExampleReaderToDataSpecCreator
     : public TFExampleReaderToDataSpecCreator {
   std::unique_ptr<AbstractTFExampleReader> CreateReader() override {
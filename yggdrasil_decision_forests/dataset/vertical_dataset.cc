@@ -54,6 +54,25 @@ namespace {
 constexpr char kNaSymbol[] = "NA";  // NA=non-available i.e. missing value.
 constexpr char kEmptySymbol[] = "EMPTY";
 
+// Ensure that two solumn specs are compatible i.e. "src_spec" can be converted
+// into "dst_spec".
+absl::Status CheckCompatibleCategocialColumnSpec(
+    const proto::Column& src_spec, const proto::Column& dst_spec) {
+  if (src_spec.categorical().is_already_integerized() !=
+      dst_spec.categorical().is_already_integerized()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Non matching \"is_already_integerized\" for column \"",
+                     src_spec.name(), "\"."));
+  }
+  if (src_spec.categorical().is_already_integerized()) {
+    STATUS_CHECK_LE(dst_spec.categorical().number_of_unique_values(),
+                    src_spec.categorical().number_of_unique_values());
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 absl::StatusOr<std::unique_ptr<VerticalDataset::AbstractColumn>> CreateColumn(
     const proto::ColumnType type, const absl::string_view column_name) {
   std::unique_ptr<VerticalDataset::AbstractColumn> col;
@@ -103,25 +122,52 @@ absl::StatusOr<std::unique_ptr<VerticalDataset::AbstractColumn>> CreateColumn(
   return std::move(col);
 }
 
-// Ensure that two solumn specs are compatible i.e. "src_spec" can be converted
-// into "dst_spec".
-absl::Status CheckCompatibleCategocialColumnSpec(
-    const proto::Column& src_spec, const proto::Column& dst_spec) {
-  if (src_spec.categorical().is_already_integerized() !=
-      dst_spec.categorical().is_already_integerized()) {
-    return absl::InvalidArgumentError(
-        absl::StrCat("Non matching \"is_already_integerized\" for column \"",
-                     src_spec.name(), "\"."));
-  }
-  if (src_spec.categorical().is_already_integerized()) {
-    STATUS_CHECK_LE(dst_spec.categorical().number_of_unique_values(),
-                    src_spec.categorical().number_of_unique_values());
-  }
-  return absl::OkStatus();
+namespace {
+
+// Appends the values of a scalar column.
+template <typename T>
+void AppendScalarValues(const VerticalDataset::AbstractColumn& src,
+                        VerticalDataset::AbstractColumn* dst) {
+  const auto& src_values =
+      static_cast<const VerticalDataset::TemplateScalarStorage<T>&>(src)
+          .values();
+  auto* dst_values =
+      static_cast<VerticalDataset::TemplateScalarStorage<T>*>(dst)
+          ->mutable_values();
+  dst_values->insert(dst_values->end(), src_values.begin(), src_values.end());
 }
 
 }  // namespace
 
+absl::Status AppendColumnValues(const VerticalDataset::AbstractColumn& src,
+                                VerticalDataset::AbstractColumn* dst) {
+  STATUS_CHECK_EQ(src.type(), dst->type());
+  switch (src.type()) {
+    case proto::ColumnType::NUMERICAL:
+      AppendScalarValues<VerticalDataset::NumericalColumn::Format>(src, dst);
+      break;
+    case proto::ColumnType::DISCRETIZED_NUMERICAL:
+      AppendScalarValues<VerticalDataset::DiscretizedNumericalColumn::Format>(
+          src, dst);
+      break;
+    case proto::ColumnType::CATEGORICAL:
+      AppendScalarValues<VerticalDataset::CategoricalColumn::Format>(src, dst);
+      break;
+    case proto::ColumnType::BOOLEAN:
+      AppendScalarValues<VerticalDataset::BooleanColumn::Format>(src, dst);
+      break;
+    case proto::ColumnType::HASH:
+      AppendScalarValues<VerticalDataset::HashColumn::Format>(src, dst);
+      break;
+    default: {
+      std::vector<VerticalDataset::row_t> indices(src.nrows());
+      std::iota(indices.begin(), indices.end(), 0);
+      RETURN_IF_ERROR(src.ExtractAndAppend(indices, dst));
+    } break;
+  }
+  return absl::OkStatus();
+}
+
 int VerticalDataset::ColumnNameToColumnIdx(absl::string_view name) const {
   for (int col_idx = 0; col_idx < columns_.size(); col_idx++) {
     if (column(col_idx)->name() == name) {
@@ -788,6 +788,15 @@ class VerticalDataset {
   proto::DataSpecification data_spec_;
 };
 
+// Creates an empty column of a given type.
+absl::StatusOr<std::unique_ptr<VerticalDataset::AbstractColumn>> CreateColumn(
+    proto::ColumnType type, absl::string_view column_name);
+
+// Appends all the values of "src" at the end of "dst". Both columns should
+// have the same type.
+absl::Status AppendColumnValues(const VerticalDataset::AbstractColumn& src,
+                                VerticalDataset::AbstractColumn* dst);
+
 // Converts a map of "column name -> value" into a proto::Example. Each of the
 // key of "src" should be a valid column name in "data_spec". In "src",
 // values are stored as string (independently of their true semantic) and are
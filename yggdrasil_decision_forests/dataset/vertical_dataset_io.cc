@@ -16,14 +16,19 @@
 #include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
 
 #include <memory>
+#include <numeric>
+#include <string>
 #include <type_traits>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "yggdrasil_decision_forests/dataset/columnar_dataset_io.h"
+#include "yggdrasil_decision_forests/dataset/csv_vertical_dataset_io.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/example.pb.h"
+#include "yggdrasil_decision_forests/dataset/example_batch_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/example_reader.h"
 #include "yggdrasil_decision_forests/dataset/example_reader_interface.h"
 #include "yggdrasil_decision_forests/dataset/example_writer.h"
@@ -87,6 +92,123 @@ absl::Status LoadVerticalDatasetSingleThread(
   return status.status();
 }
 
+// Loads the dataset with a batch reader using a single thread.
+absl::Status LoadVerticalDatasetWithBatchReader(
+    const absl::string_view typed_path,
+    const proto::DataSpecification& data_spec, VerticalDataset* dataset,
+    const absl::optional<std::vector<int>>& required_columns,
+    const LoadConfig& config) {
+  // Initialize dataset.
+  dataset->set_data_spec(data_spec);
+  RETURN_IF_ERROR(dataset->CreateColumnsFromDataspec());
+  dataset->set_nrow(0);
+
+  ASSIGN_OR_RETURN(auto reader,
+                   CreateExampleBatchReader(typed_path, data_spec,
+                                            required_columns,
+                                            config.load_columns));
+  while (true) {
+    ASSIGN_OR_RETURN(const auto num_rows, reader->NextBatch(dataset));
+    if (num_rows == 0) {
+      break;
+    }
+    LOG_INFO_EVERY_N_SEC(30, _ << dataset->nrow() << " examples scanned.");
+  }
+
+  dataset->ShrinkToFit();
+  LOG_INFO_EVERY_N_SEC(30, _ << dataset->nrow() << " examples read. Memory: "
+                             << dataset->MemorySummary());
+  return absl::OkStatus();
+}
+
+// Reads a shard with a batch reader.
+absl::StatusOr<std::unique_ptr<VerticalDataset>> LoadShardWithBatchReader(
+    const proto::DataSpecification& data_spec, const absl::string_view prefix,
+    const absl::optional<std::vector<int>>& required_columns,
+    const absl::optional<std::vector<int>>& load_columns,
+    const absl::string_view shard) {
+  auto block = absl::make_unique<VerticalDataset>();
+  block->set_data_spec(data_spec);
+  RETURN_IF_ERROR(block->CreateColumnsFromDataspec());
+  ASSIGN_OR_RETURN(auto reader, CreateExampleBatchReader(
+                                    absl::StrCat(prefix, ":", shard),
+                                    data_spec, required_columns, load_columns));
+  while (true) {
+    ASSIGN_OR_RETURN(const auto num_rows, reader->NextBatch(block.get()));
+    if (num_rows == 0) {
+      break;
+    }
+  }
+  return block;
+}
+
+// Loads the shards in parallel with batch readers.
+absl::Status LoadVerticalDatasetWithBatchReaderPerShard(
+    const std::vector<std::string>& shards, const absl::string_view prefix,
+    const proto::DataSpecification& data_spec, VerticalDataset* dataset,
+    const absl::optional<std::vector<int>>& required_columns,
+    const LoadConfig& config) {
+  // Initialize dataset.
+  dataset->set_data_spec(data_spec);
+  RETURN_IF_ERROR(dataset->CreateColumnsFromDataspec());
+  dataset->set_nrow(0);
+
+  std::vector<int> load_columns;
+  if (config.load_columns.has_value()) {
+    load_columns = config.load_columns.value();
+  } else {
+    load_columns.resize(data_spec.columns_size());
+    std::iota(load_columns.begin(), load_columns.end(), 0);
+  }
+
+  utils::concurrency::StreamProcessor<
+      std::string, absl::StatusOr<std::unique_ptr<VerticalDataset>>>
+      processor("DatasetLoader",
+                std::min<int>(shards.size(), config.num_threads),
+                [&](const std::string shard) {
+                  return LoadShardWithBatchReader(data_spec, prefix,
+                                                  required_columns,
+                                                  config.load_columns, shard);
+                },
+                /*result_in_order=*/true);
+  processor.StartWorkers();
+  for (const auto& shard : shards) {
+    processor.Submit(shard);
+  }
+  processor.CloseSubmits();
+
+  int loaded_shards = 0;
+  while (true) {
+    auto result = processor.GetResult();
+    if (!result.has_value()) {
+      break;
+    }
+    RETURN_IF_ERROR(result.value().status());
+    const auto& block = *result.value().value();
+    if (loaded_shards == 0 && block.nrow() > 100) {
+      dataset->Reserve(block.nrow() * shards.size(), config.load_columns);
+    }
+    for (const int col_idx : load_columns) {
+      RETURN_IF_ERROR(AppendColumnValues(*block.column(col_idx),
+                                         dataset->mutable_column(col_idx)));
+    }
+    dataset->set_nrow(dataset->nrow() + block.nrow());
+    LOG_INFO_EVERY_N_SEC(30, _ << dataset->nrow() << " examples scanned.");
+    loaded_shards++;
+  }
+  processor.JoinAllAndStopThreads();
+
+  if (loaded_shards != shards.size()) {
+    return absl::InternalError("Unexpected number of shards.");
+  }
+  dataset->ShrinkToFit();
+  LOG_INFO_EVERY_N_SEC(30, _ << dataset->nrow() << " examples and "
+                             << loaded_shards << " shards read in total with "
+                             << config.num_threads << " threads. Memory: "
+                             << dataset->MemorySummary());
+  return absl::OkStatus();
+}
+
 // Set of examples extracted by a worker.
 struct BlockOfExamples {
   // List of examples. These messages are allocated in "arena".
@@ -125,6 +247,32 @@ absl::Status LoadVerticalDataset(
   std::vector<std::string> shards;
   RETURN_IF_ERROR(utils::ExpandInputShards(path, &shards));
 
+  if (config.parallel_csv_parsing && config.num_threads > 1 &&
+      !config.load_example.has_value() &&
+      prefix == DatasetFormatToPrefix(proto::FORMAT_CSV)) {
+    // Loading csv chunks in parallel.
+    CsvLoadConfig csv_config;
+    csv_config.num_threads = config.num_threads;
+    csv_config.load_columns = config.load_columns;
+    return LoadCsvVerticalDataset(shards, data_spec, dataset, required_columns,
+                                  csv_config);
+  }
+
+  // The columnar format is stored by column, and is always read in batches.
+  const bool batch_reading =
+      config.batch_reading ||
+      prefix == DatasetFormatToPrefix(proto::FORMAT_YDF_COLUMNAR);
+  if (batch_reading && !config.load_example.has_value() &&
+      IsBatchFormatSupported(typed_path)) {
+    // Reading the examples directly into the columns.
+    if (shards.size() <= 1 || config.num_threads <= 1) {
+      return LoadVerticalDatasetWithBatchReader(typed_path, data_spec, dataset,
+                                                required_columns, config);
+    }
+    return LoadVerticalDatasetWithBatchReaderPerShard(
+        shards, prefix, data_spec, dataset, required_columns, config);
+  }
+
   if (shards.size() <= 1 || config.num_threads <= 1) {
     // Loading in a single thread.
     return LoadVerticalDatasetSingleThread(typed_path, data_spec, dataset,
@@ -237,6 +385,13 @@ absl::Status LoadVerticalDataset(
 absl::Status SaveVerticalDataset(const VerticalDataset& dataset,
                                  const absl::string_view typed_path,
                                  int64_t num_records_by_shard) {
+  std::string path, prefix;
+  ASSIGN_OR_RETURN(std::tie(prefix, path), SplitTypeAndPath(typed_path));
+  if (prefix == DatasetFormatToPrefix(proto::FORMAT_YDF_COLUMNAR)) {
+    // The columns are written as is.
+    return SaveShardedColumnarDataset(dataset, path, num_records_by_shard);
+  }
+
   ASSIGN_OR_RETURN(auto writer,
                    CreateExampleWriter(typed_path, dataset.data_spec(),
                                        num_records_by_shard));
@@ -50,18 +50,29 @@ namespace dataset {
 //     allowed. See comment above for the specific semantic of
 //     "required_columns".
 //   num_threads: Number of reading threads. Only used for multi-sharded
-//     datasets. num_threads=1 is more memory efficient than num_threads>1.
+//     datasets and csv datasets. num_threads=1 is more memory efficient than
+//     num_threads>1.
 //   load_columns: If specified, only load this subset of columns.
 //   load_example: If specified, only load the examples that evaluate to true.
 //
 struct LoadConfig {
-  // Number of reading threads. Only used for multi-sharded datasets.
-  // num_threads=1 is more memory efficient than num_threads>1.
+  // Number of reading threads. Only used for multi-sharded datasets and csv
+  // datasets. num_threads=1 is more memory efficient than num_threads>1.
   int num_threads = 10;
   // If specified, only load this subset of columns.
   absl::optional<std::vector<int>> load_columns;
   // If specified, only load the examples that evaluate to true.
   absl::optional<std::function<bool(const proto::Example&)>> load_example;
+  // If true, csv datasets are split into chunks parsed in parallel (see
+  // "csv_vertical_dataset_io.h"), including datasets with a single shard.
+  // Ignored if "load_example" is specified.
+  bool parallel_csv_parsing = true;
+  // If true and if the format supports it (see "IsBatchFormatSupported"), the
+  // examples are read directly into the columns of the dataset i.e. without
+  // intermediate "proto::Example"s. Ignored if "load_example" is specified.
+  // Experimental, disabled by default. The columnar format ("ydf_columnar:")
+  // is always read in batches.
+  bool batch_reading = false;
 };
 
 absl::Status LoadVerticalDataset(
@@ -72,7 +83,8 @@ absl::Status LoadVerticalDataset(
 
 // Save the dataset to a file (or a set of files). If
 // num_records_by_shard==-1, all the examples will be written in the first
-// shard.
+// shard, except for the columnar format ("ydf_columnar:") where the examples
+// are distributed evenly among the shards (see "SaveShardedColumnarDataset").
 absl::Status SaveVerticalDataset(const VerticalDataset& dataset,
                                  const absl::string_view typed_path,
                                  int64_t num_records_by_shard = -1);
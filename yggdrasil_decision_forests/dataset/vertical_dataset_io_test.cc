@@ -211,6 +211,51 @@ TEST(Dataset, TokenizeTfExample) {
   EXPECT_THAT(example, EqualsProto(expected_example_2));
 }
 
+// Loads a dataset with or without the batch reader.
+VerticalDataset LoadWithBatchReading(const std::string& typed_path,
+                                     const proto::DataSpecification& data_spec,
+                                     const bool batch_reading,
+                                     const int num_threads) {
+  LoadConfig config;
+  config.num_threads = num_threads;
+  config.batch_reading = batch_reading;
+  VerticalDataset dataset;
+  EXPECT_OK(LoadVerticalDataset(typed_path, data_spec, &dataset, {}, config));
+  return dataset;
+}
+
+TEST(VerticalDatasetIOTest, TfRecordBatchReadingSameAsExampleReader) {
+  // "toy" contains numerical, categorical, categorical-set and boolean
+  // columns with missing values, and is split into two shards.
+  for (const auto& filename :
+       {"toy.tfe-tfrecord@2", "sentences.tfe-tfrecord"}) {
+    const auto path =
+        absl::StrCat("tfrecord+tfe:", file::JoinPath(DatasetDir(), filename));
+    proto::DataSpecificationGuide guide;
+    guide.mutable_default_column_guide()
+        ->mutable_categorial()
+        ->set_min_vocab_frequency(1);
+    proto::DataSpecification data_spec;
+    CreateDataSpec(path, false, guide, &data_spec);
+
+    for (const int num_threads : {1, 4}) {
+      SCOPED_TRACE(absl::StrCat(filename, " num_threads:", num_threads));
+      const auto expected = LoadWithBatchReading(
+          path, data_spec, /*batch_reading=*/false, num_threads);
+      const auto dataset = LoadWithBatchReading(
+          path, data_spec, /*batch_reading=*/true, num_threads);
+      ASSERT_EQ(dataset.nrow(), expected.nrow());
+      ASSERT_EQ(dataset.ncol(), expected.ncol());
+      proto::Example example, expected_example;
+      for (VerticalDataset::row_t row = 0; row < dataset.nrow(); row++) {
+        dataset.ExtractExample(row, &example);
+        expected.ExtractExample(row, &expected_example);
+        EXPECT_THAT(example, EqualsProto(expected_example)) << "row: " << row;
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace dataset
 }  // namespace yggdrasil_decision_forests
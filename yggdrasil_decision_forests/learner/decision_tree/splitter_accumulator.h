@@ -351,6 +351,81 @@ inline std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
+// Numerical feature quantized into bins before training (see
+// "NumericalSplit::HISTOGRAM_BINNED"). Unlike
+// "FeatureDiscretizedNumericalBucket", the buckets are filled from a
+// pre-computed histogram, and the resulting condition is a "higher_condition"
+// on the original numerical value.
+struct FeatureBinnedNumericalBucket {
+  static constexpr bool kRequireSorting = false;
+
+  bool operator<(const FeatureBinnedNumericalBucket& other) const {
+    NOTREACHED();
+    return true;
+  }
+
+  static bool IsValidAttribute(const FeatureBinnedNumericalBucket& first,
+                               const FeatureBinnedNumericalBucket& last) {
+    return true;
+  }
+
+  static bool IsValidSplit(const FeatureBinnedNumericalBucket& left,
+                           const FeatureBinnedNumericalBucket& right) {
+    return true;
+  }
+
+  class Filler {
+   public:
+    // "boundaries" are the sorted boundaries between the bins i.e. the bin "i"
+    // contains the values in [boundaries[i-1], boundaries[i]).
+    Filler(const std::vector<float>& boundaries, const float na_replacement)
+        : boundaries_(boundaries), na_replacement_(na_replacement) {}
+
+    size_t NumBuckets() const { return boundaries_.size() + 1; }
+
+    void InitializeAndZero(const int bucket_idx,
+                           FeatureBinnedNumericalBucket* acc) const {}
+
+    template <typename ExampleBucketSet>
+    void SetConditionFinal(const ExampleBucketSet& example_bucket_set,
+                           const size_t best_bucket_idx,
+                           proto::NodeCondition* condition) const {
+      SetThreshold(boundaries_[best_bucket_idx], condition);
+    }
+
+    template <typename ExampleBucketSet>
+    void SetConditionInterpolatedFinal(
+        const ExampleBucketSet& example_bucket_set,
+        const size_t best_bucket_1_idx, const size_t best_bucket_2_idx,
+        proto::NodeCondition* condition) const {
+      // Buckets between "best_bucket_1_idx" and "best_bucket_2_idx" are empty.
+      // Select the bin boundary in the middle.
+      const size_t best_bucket_idx = (best_bucket_1_idx + best_bucket_2_idx) / 2;
+      SetThreshold(boundaries_[best_bucket_idx], condition);
+    }
+
+   private:
+    void SetThreshold(const float threshold,
+                      proto::NodeCondition* condition) const {
+      condition->mutable_condition()->mutable_higher_condition()->set_threshold(
+          threshold);
+      condition->set_na_value(na_replacement_ >= threshold);
+    }
+
+    const std::vector<float>& boundaries_;
+    const float na_replacement_;
+  };
+
+  friend std::ostream& operator<<(std::ostream& os,
+                                  const FeatureBinnedNumericalBucket& data);
+};
+
+inline std::ostream& operator<<(std::ostream& os,
+                                const FeatureBinnedNumericalBucket& data) {
+  // The feature bucket contains no information.
+  return os;
+}
+
 // Categorical feature.
 struct FeatureCategoricalBucket {
   int32_t value;
@@ -1930,6 +2005,55 @@ inline std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
+// Bucket of a gradient/hessian histogram (see
+// "NumericalSplit::HISTOGRAM_BINNED").
+//
+// Unlike "LabelHessianNumericalBucket", the statistics are accumulated in
+// double precision. The histogram of a node is often computed by subtracting
+// the histogram of a small node from the histogram of a large node, and float
+// precision would not be sufficient.
+struct LabelHessianNumericalHistogramBucket {
+  double sum_gradient;
+  double sum_hessian;
+  double sum_weights;
+  int64_t count;
+
+  // The initializer does not depend on the content of the buckets.
+  using Initializer = LabelHessianNumericalBucket<true>::Initializer;
+
+  void AddToScoreAcc(LabelHessianNumericalScoreAccumulator* acc) const {
+    acc->Add(sum_gradient, sum_hessian, sum_weights);
+  }
+
+  void SubToScoreAcc(LabelHessianNumericalScoreAccumulator* acc) const {
+    acc->Sub(sum_gradient, sum_hessian, sum_weights);
+  }
+
+  void AddToBucket(LabelHessianNumericalHistogramBucket* dst) const {
+    dst->sum_gradient += sum_gradient;
+    dst->sum_hessian += sum_hessian;
+    dst->sum_weights += sum_weights;
+    dst->count += count;
+  }
+
+  // Replaces the content of "dst" with the content of this bucket minus the
+  // content of "dst".
+  void SubtractBucketFrom(LabelHessianNumericalHistogramBucket* dst) const {
+    dst->sum_gradient = sum_gradient - dst->sum_gradient;
+    dst->sum_hessian = sum_hessian - dst->sum_hessian;
+    dst->sum_weights = sum_weights - dst->sum_weights;
+    dst->count = count - dst->count;
+  }
+};
+
+inline std::ostream& operator<<(
+    std::ostream& os, const LabelHessianNumericalHistogramBucket& data) {
+  os << "value:{sum_gradient:" << data.sum_gradient
+     << " sum_hessian:" << data.sum_hessian
+     << " sum_weight:" << data.sum_weights << "} count:" << data.count;
+  return os;
+}
+
 template <bool weighted>
 struct LabelCategoricalBucket {
   utils::IntegerDistributionDouble value;
@@ -158,6 +158,10 @@ using FeatureIsMissingLabelHessianNumerical =
     ExampleBucketSet<ExampleBucket<FeatureIsMissingBucket,
                                    LabelHessianNumericalBucket<weighted>>>;
 
+using FeatureBinnedNumericalLabelHessianHistogram =
+    ExampleBucketSet<ExampleBucket<FeatureBinnedNumericalBucket,
+                                   LabelHessianNumericalHistogramBucket>>;
+
 // Label: Weighted Categorical.
 
 using LabelWeightedCategoricalOneValueBucket =
@@ -338,6 +342,8 @@ struct PerThreadCacheV2 {
   FeatureBooleanLabelHessianNumerical</*weighted=*/false>
       example_bucket_set_uhnum_4;
 
+  FeatureBinnedNumericalLabelHessianHistogram example_bucket_set_bhnum_1;
+
   FeatureNumericalLabelBinaryCategoricalOneValue example_bucket_set_bcat_1;
   FeatureDiscretizedNumericalLabelBinaryCategorical example_bucket_set_bcat_5;
   FeatureCategoricalLabelBinaryCategorical example_bucket_set_bcat_2;
@@ -527,6 +533,10 @@ auto* GetCachedExampleBucketSet(PerThreadCacheV2* cache) {
   } else if constexpr (is_same_v<ExampleBucketSet,
                                  FeatureBooleanLabelBinaryCategorical>) {
     return &cache->example_bucket_set_bcat_4;
+  } else if constexpr (is_same_v<ExampleBucketSet,
+                                 FeatureBinnedNumericalLabelHessianHistogram>) {
+    // Binned hessian numerical.
+    return &cache->example_bucket_set_bhnum_1;
   } else if constexpr (
       is_same_v<ExampleBucketSet,
                 FeatureNumericalLabelUnweightedBinaryCategoricalOneValue>) {
@@ -1378,6 +1388,18 @@ void AddLabelBucket(const ExampleBucketSet& src, ExampleBucketSet* dst) {
   }
 }
 
+// Replaces the content of "dst"'s label buckets with the content of "src"'s
+// label buckets minus the content of "dst"'s label buckets. Used to compute the
+// histogram of a node from the histograms of its parent and sibling.
+template <typename ExampleBucketSet>
+void SubtractLabelBucketFrom(const ExampleBucketSet& src,
+                             ExampleBucketSet* dst) {
+  DCHECK_EQ(src.items.size(), dst->items.size());
+  for (size_t item_idx = 0; item_idx < src.items.size(); item_idx++) {
+    src.items[item_idx].label.SubtractBucketFrom(&dst->items[item_idx].label);
+  }
+}
+
 // Pre-defined ExampleBucketSets
 
 // Label: Regression.
@@ -489,6 +489,191 @@ bool IsPresortingOnNumericalSplitMoreEfficient(
   return num_selected_examples >= 25 && ratio >= 0.125;
 }
 
+// Accumulates the gradient/hessian histogram of the "selected_examples" for a
+// feature quantized into "num_bins" bins. "get_bin(example_idx)" is the bin of
+// an example.
+template <bool weighted, typename GetBin>
+void FillBinnedHessianHistogram(
+    const std::vector<UnsignedExampleIdx>& selected_examples,
+    const GetBin& get_bin, const int num_bins,
+    const std::vector<float>& gradients, const std::vector<float>& hessians,
+    const std::vector<float>& weights,
+    FeatureBinnedNumericalLabelHessianHistogram* histogram) {
+  histogram->items.assign(num_bins, {});
+  auto* const items = histogram->items.data();
+  for (const UnsignedExampleIdx example_idx : selected_examples) {
+    auto& bucket = items[get_bin(example_idx)].label;
+    bucket.sum_gradient += gradients[example_idx];
+    bucket.sum_hessian += hessians[example_idx];
+    if constexpr (weighted) {
+      bucket.sum_weights += weights[example_idx];
+    } else {
+      bucket.sum_weights += 1.;
+    }
+    bucket.count++;
+  }
+}
+
+template <bool weighted>
+void FillBinnedHessianHistogram(
+    const std::vector<UnsignedExampleIdx>& selected_examples,
+    const Preprocessing::BinnedNumericalFeature& attributes,
+    const dataset::PackedBinMatrix<uint8_t>& packed_bins,
+    const std::vector<float>& gradients, const std::vector<float>& hessians,
+    const std::vector<float>& weights,
+    FeatureBinnedNumericalLabelHessianHistogram* histogram) {
+  if (attributes.packed_idx >= 0) {
+    const int packed_idx = attributes.packed_idx;
+    FillBinnedHessianHistogram<weighted>(
+        selected_examples,
+        [&](const UnsignedExampleIdx example_idx) {
+          return packed_bins.Get(example_idx, packed_idx);
+        },
+        attributes.num_bins(), gradients, hessians, weights, histogram);
+  } else if (!attributes.bins_8bits.empty()) {
+    const auto& bins = attributes.bins_8bits;
+    FillBinnedHessianHistogram<weighted>(
+        selected_examples,
+        [&](const UnsignedExampleIdx example_idx) { return bins[example_idx]; },
+        attributes.num_bins(), gradients, hessians, weights, histogram);
+  } else {
+    const auto& bins = attributes.bins_16bits;
+    FillBinnedHessianHistogram<weighted>(
+        selected_examples,
+        [&](const UnsignedExampleIdx example_idx) { return bins[example_idx]; },
+        attributes.num_bins(), gradients, hessians, weights, histogram);
+  }
+}
+
+// Minimum number of examples scanned by each thread when filling the
+// histograms of the packed bin matrix. Below, the cost of scheduling and
+// merging the per-thread histograms dominates.
+constexpr size_t kMinExamplesPerHistogramBlock = 8192;
+
+// Computes the histograms of the columns "packed_idxs" of the packed bin matrix
+// in a single pass over the rows of the "selected_examples". If the parent
+// histograms and the sibling examples are available in "context", the
+// histograms are computed by subtraction (in which case the parent histograms
+// of "packed_idxs" should be available). If "pool" is set, the rows are split
+// into blocks scanned in parallel. The computed histograms are marked as
+// available in "context.node".
+template <bool weighted>
+void FillPackedBinnedHessianHistograms(
+    const std::vector<UnsignedExampleIdx>& selected_examples,
+    const Preprocessing& preprocessing, const std::vector<int>& packed_idxs,
+    const std::vector<float>& gradients, const std::vector<float>& hessians,
+    const std::vector<float>& weights, const HistogramContext& context,
+    utils::concurrency::ThreadPool* pool) {
+  const auto& packed_bins = preprocessing.packed_binned_numerical_features();
+  const auto& binned_features = preprocessing.binned_numerical_features();
+  const int num_columns = packed_idxs.size();
+  const bool use_subtraction = context.parent != nullptr;
+  const auto& examples =
+      use_subtraction ? *context.sibling_examples : selected_examples;
+
+  using ExampleBucket =
+      FeatureBinnedNumericalLabelHessianHistogram::ExampleBucketType;
+
+  size_t num_blocks = 1;
+  if (pool != nullptr) {
+    num_blocks = std::clamp<size_t>(
+        examples.size() / kMinExamplesPerHistogramBlock, 1,
+        pool->num_threads());
+  }
+
+  // Buckets of each block and column. The first block accumulates directly in
+  // the node histograms.
+  std::vector<std::vector<ExampleBucket>> block_buckets((num_blocks - 1) *
+                                                        num_columns);
+  std::vector<ExampleBucket*> items(num_blocks * num_columns);
+  for (int column = 0; column < num_columns; column++) {
+    const int column_idx = packed_bins.column_idxs()[packed_idxs[column]];
+    const int num_bins = binned_features[column_idx].num_bins();
+    auto& histogram = context.node->histograms[column_idx];
+    histogram.items.assign(num_bins, {});
+    items[column] = histogram.items.data();
+    for (size_t block_idx = 1; block_idx < num_blocks; block_idx++) {
+      auto& buckets = block_buckets[(block_idx - 1) * num_columns + column];
+      buckets.assign(num_bins, {});
+      items[block_idx * num_columns + column] = buckets.data();
+    }
+  }
+
+  const auto fill_block = [&](const size_t block_idx, const size_t begin,
+                              const size_t end) {
+    ExampleBucket* const* const block_items = &items[block_idx * num_columns];
+    for (size_t i = begin; i < end; i++) {
+      const UnsignedExampleIdx example_idx = examples[i];
+      const uint8_t* const row = packed_bins.Row(example_idx);
+      const float gradient = gradients[example_idx];
+      const float hessian = hessians[example_idx];
+      float weight = 1.f;
+      if constexpr (weighted) {
+        weight = weights[example_idx];
+      }
+      for (int column = 0; column < num_columns; column++) {
+        auto& bucket = block_items[column][row[packed_idxs[column]]].label;
+        bucket.sum_gradient += gradient;
+        bucket.sum_hessian += hessian;
+        bucket.sum_weights += weight;
+        bucket.count++;
+      }
+    }
+  };
+  if (num_blocks == 1) {
+    fill_block(0, 0, examples.size());
+  } else {
+    utils::concurrency::ConcurrentForLoop(num_blocks, pool, examples.size(),
+                                          fill_block);
+  }
+
+  for (int column = 0; column < num_columns; column++) {
+    const int column_idx = packed_bins.column_idxs()[packed_idxs[column]];
+    auto& histogram = context.node->histograms[column_idx];
+    for (size_t block_idx = 1; block_idx < num_blocks; block_idx++) {
+      const auto& buckets =
+          block_buckets[(block_idx - 1) * num_columns + column];
+      for (size_t bin_idx = 0; bin_idx < buckets.size(); bin_idx++) {
+        buckets[bin_idx].label.AddToBucket(&histogram.items[bin_idx].label);
+      }
+    }
+    if (use_subtraction) {
+      SubtractLabelBucketFrom(context.parent->histograms[column_idx],
+                              &histogram);
+    }
+    context.node->available[column_idx] = true;
+  }
+}
+
+// Lists the columns of the packed bin matrix whose histograms should be
+// computed by "FillPackedBinnedHessianHistograms" for a node. Returns an empty
+// list if the per-attribute splitters should compute the histograms instead
+// i.e. if only a subset of the attributes is sampled for the node, since the
+// sampled attributes are only known to the splitter.
+std::vector<int> PackedHistogramColumns(
+    const model::proto::TrainingConfig& config,
+    const model::proto::TrainingConfigLinking& config_link,
+    const proto::DecisionTreeTrainingConfig& dt_config,
+    const Preprocessing& preprocessing, const HistogramContext& context) {
+  std::vector<int> packed_idxs;
+  const int num_features = config_link.features_size();
+  if (NumAttributesToTest(dt_config, num_features, config.task()) <
+      num_features) {
+    return packed_idxs;
+  }
+  const auto& column_idxs =
+      preprocessing.packed_binned_numerical_features().column_idxs();
+  for (int packed_idx = 0; packed_idx < column_idxs.size(); packed_idx++) {
+    // With subtraction, the columns without parent histogram are computed by
+    // the splitter from the node examples.
+    if (context.parent == nullptr ||
+        context.parent->available[column_idxs[packed_idx]]) {
+      packed_idxs.push_back(packed_idx);
+    }
+  }
+  return packed_idxs;
+}
+
 }  // namespace
 
 absl::Status SetLabelDistribution(
@@ -724,7 +909,33 @@ SplitSearchResult FindBestCondition(
               .value()
               ->values();
       const auto na_replacement = attribute_column_spec.numerical().mean();
-      if (dt_config.numerical_split().type() == proto::NumericalSplit::EXACT) {
+      if (dt_config.numerical_split().type() ==
+          proto::NumericalSplit::HISTOGRAM_BINNED) {
+        // "internal_config.preprocessing" is checked in "DecisionTreeTrain".
+        const auto& binned_attribute =
+            internal_config.preprocessing
+                ->binned_numerical_features()[attribute_idx];
+        if (weights.empty()) {
+          result = FindSplitLabelHessianRegressionFeatureBinnedNumerical<
+              /*weighted=*/false>(
+              selected_examples, weights, binned_attribute,
+              label_stats.gradient_data, label_stats.hessian_data,
+              na_replacement, min_num_obs, dt_config, label_stats.sum_gradient,
+              label_stats.sum_hessian, label_stats.sum_weights, attribute_idx,
+              internal_config, constraints, monotonic_direction,
+              label_stats.histogram_context, best_condition, cache);
+        } else {
+          result = FindSplitLabelHessianRegressionFeatureBinnedNumerical<
+              /*weighted=*/true>(
+              selected_examples, weights, binned_attribute,
+              label_stats.gradient_data, label_stats.hessian_data,
+              na_replacement, min_num_obs, dt_config, label_stats.sum_gradient,
+              label_stats.sum_hessian, label_stats.sum_weights, attribute_idx,
+              internal_config, constraints, monotonic_direction,
+              label_stats.histogram_context, best_condition, cache);
+        }
+      } else if (dt_config.numerical_split().type() ==
+                 proto::NumericalSplit::EXACT) {
         if (weights.empty()) {
           result = FindSplitLabelHessianRegressionFeatureNumericalCart<
               /*weighted=*/false>(
@@ -1844,7 +2055,8 @@ absl::StatusOr<bool> FindBestCondition(
     const SplitterConcurrencySetup& splitter_concurrency_setup,
     const proto::Node& parent, const InternalTrainConfig& internal_config,
     const NodeConstraints& constraints, proto::NodeCondition* best_condition,
-    utils::RandomEngine* random, PerThreadCache* cache) {
+    utils::RandomEngine* random, PerThreadCache* cache,
+    const HistogramContext& histogram_context) {
   switch (config.task()) {
     case model::proto::Task::CLASSIFICATION: {
       STATUS_CHECK(!internal_config.hessian_score);
@@ -1901,6 +2113,29 @@ absl::StatusOr<bool> FindBestCondition(
         label_stat.sum_gradient = parent.regressor().sum_gradients();
         label_stat.sum_hessian = parent.regressor().sum_hessians();
         label_stat.sum_weights = parent.regressor().sum_weights();
+        label_stat.histogram_context = histogram_context;
+
+        if (histogram_context.node && internal_config.preprocessing &&
+            !internal_config.preprocessing->packed_binned_numerical_features()
+                 .empty()) {
+          const auto packed_idxs = PackedHistogramColumns(
+              config, config_link, dt_config, *internal_config.preprocessing,
+              histogram_context);
+          auto* pool = splitter_concurrency_setup.histogram_pool.get();
+          if (packed_idxs.empty()) {
+            // The splitters compute the histograms.
+          } else if (weights.empty()) {
+            FillPackedBinnedHessianHistograms</*weighted=*/false>(
+                selected_examples, *internal_config.preprocessing, packed_idxs,
+                label_stat.gradient_data, label_stat.hessian_data, weights,
+                histogram_context, pool);
+          } else {
+            FillPackedBinnedHessianHistograms</*weighted=*/true>(
+                selected_examples, *internal_config.preprocessing, packed_idxs,
+                label_stat.gradient_data, label_stat.hessian_data, weights,
+                histogram_context, pool);
+          }
+        }
 
         return FindBestConditionManager(
             train_dataset, selected_examples, weights, config, config_link,
@@ -2616,6 +2851,72 @@ FindSplitLabelHessianRegressionFeatureDiscretizedNumericalCart(
                 min_num_obs, attribute_idx, condition, &cache->cache_v2);
 }
 
+template <bool weighted>
+SplitSearchResult FindSplitLabelHessianRegressionFeatureBinnedNumerical(
+    const std::vector<UnsignedExampleIdx>& selected_examples,
+    const std::vector<float>& weights,
+    const Preprocessing::BinnedNumericalFeature& attributes,
+    const std::vector<float>& gradients, const std::vector<float>& hessians,
+    float na_replacement, UnsignedExampleIdx min_num_obs,
+    const proto::DecisionTreeTrainingConfig& dt_config, double sum_gradient,
+    double sum_hessian, double sum_weights, int32_t attribute_idx,
+    const InternalTrainConfig& internal_config,
+    const NodeConstraints& constraints, int8_t monotonic_direction,
+    const HistogramContext& histogram_context,
+    proto::NodeCondition* condition, SplitterPerThreadCache* cache) {
+  if constexpr (weighted) {
+    DCHECK_GE(weights.size(), selected_examples.size());
+  } else {
+    DCHECK(weights.empty());
+  }
+
+  FeatureBinnedNumericalLabelHessianHistogram* histogram;
+  if (histogram_context.node) {
+    histogram = &histogram_context.node->histograms[attribute_idx];
+  } else {
+    histogram = GetCachedExampleBucketSet<
+        FeatureBinnedNumericalLabelHessianHistogram>(&cache->cache_v2);
+  }
+
+  const auto& packed_bins =
+      internal_config.preprocessing->packed_binned_numerical_features();
+  if (histogram_context.node &&
+      histogram_context.node->available[attribute_idx]) {
+    // The histogram was already computed from the packed bin matrix.
+  } else if (histogram_context.parent &&
+             histogram_context.parent->available[attribute_idx]) {
+    // Histogram subtraction: node = parent - sibling.
+    DCHECK(histogram_context.sibling_examples);
+    FillBinnedHessianHistogram<weighted>(*histogram_context.sibling_examples,
+                                         attributes, packed_bins, gradients,
+                                         hessians, weights, histogram);
+    SubtractLabelBucketFrom(
+        histogram_context.parent->histograms[attribute_idx], histogram);
+  } else {
+    FillBinnedHessianHistogram<weighted>(selected_examples, attributes,
+                                         packed_bins, gradients, hessians,
+                                         weights, histogram);
+  }
+  if (histogram_context.node) {
+    histogram_context.node->available[attribute_idx] = true;
+  }
+
+  FeatureBinnedNumericalBucket::Filler feature_filler(attributes.boundaries,
+                                                      na_replacement);
+
+  LabelHessianNumericalHistogramBucket::Initializer initializer(
+      sum_gradient, sum_hessian, sum_weights, internal_config.hessian_l1,
+      internal_config.hessian_l2_numerical,
+      dt_config.internal().hessian_split_score_subtract_parent(),
+      monotonic_direction, constraints);
+
+  return ScanSplits<FeatureBinnedNumericalLabelHessianHistogram,
+                    LabelHessianNumericalScoreAccumulator,
+                    /*bucket_interpolation=*/true>(
+      feature_filler, initializer, *histogram, selected_examples.size(),
+      min_num_obs, attribute_idx, condition, &cache->cache_v2);
+}
+
 template <bool weighted>
 SplitSearchResult FindSplitLabelRegressionFeatureNumericalCart(
     const std::vector<UnsignedExampleIdx>& selected_examples,
@@ -4014,6 +4315,7 @@ void SetDefaultHyperParameters(proto::DecisionTreeTrainingConfig* config) {
         config->mutable_numerical_split()->set_num_candidates(1);
         break;
       case proto::NumericalSplit::HISTOGRAM_EQUAL_WIDTH:
+      case proto::NumericalSplit::HISTOGRAM_BINNED:
         config->mutable_numerical_split()->set_num_candidates(255);
         break;
       default:
@@ -4033,6 +4335,8 @@ void SetDefaultHyperParameters(proto::DecisionTreeTrainingConfig* config) {
           proto::DecisionTreeTrainingConfig::Internal::FORCE_PRESORTED) {
     if (config->has_sparse_oblique_split() ||
         config->has_mhld_oblique_split() ||
+        config->numerical_split().type() ==
+            proto::NumericalSplit::HISTOGRAM_BINNED ||
         config->missing_value_policy() !=
             proto::DecisionTreeTrainingConfig::GLOBAL_IMPUTATION) {
       config->mutable_internal()->set_sorting_strategy(
@@ -4217,6 +4521,27 @@ absl::Status DecisionTreeTrain(
     const model::proto::DeploymentConfig& deployment,
     const std::vector<float>& weights, utils::RandomEngine* random,
     DecisionTree* dt, const InternalTrainConfig& internal_config) {
+  if (dt_config.numerical_split().type() ==
+      proto::NumericalSplit::HISTOGRAM_BINNED) {
+    if (!internal_config.hessian_score) {
+      return absl::InvalidArgumentError(
+          "The HISTOGRAM_BINNED numerical split is only supported with hessian "
+          "split scores (e.g. gradient boosted trees with "
+          "use_hessian_gain=true).");
+    }
+    if (dt_config.missing_value_policy() !=
+        proto::DecisionTreeTrainingConfig::GLOBAL_IMPUTATION) {
+      return absl::InvalidArgumentError(
+          "The HISTOGRAM_BINNED numerical split only supports the "
+          "GLOBAL_IMPUTATION missing value policy.");
+    }
+    if (internal_config.preprocessing == nullptr) {
+      return absl::InvalidArgumentError(
+          "The HISTOGRAM_BINNED numerical split requires the binned "
+          "numerical features (InternalTrainConfig::preprocessing).");
+    }
+  }
+
   // Decide if execution should happen in single-thread or concurrent mode.
 
   const std::vector<UnsignedExampleIdx>* effective_selected_examples;
@@ -4282,6 +4607,15 @@ absl::Status DecisionTreeTrain(
           });
   splitter_concurrency_setup.split_finder_processor->StartWorkers();
 
+  if (internal_config.preprocessing &&
+      !internal_config.preprocessing->packed_binned_numerical_features()
+           .empty()) {
+    splitter_concurrency_setup.histogram_pool =
+        absl::make_unique<utils::concurrency::ThreadPool>(
+            "PackedHistograms", internal_config.num_threads);
+    splitter_concurrency_setup.histogram_pool->StartWorkers();
+  }
+
   return DecisionTreeCoreTrain(train_dataset, *effective_selected_examples,
                                leaf_examples, config, config_link, dt_config,
                                deployment, splitter_concurrency_setup, weights,
@@ -4331,8 +4665,9 @@ absl::Status NodeTrain(
     const std::vector<float>& weights, const int32_t depth,
     const InternalTrainConfig& internal_config,
     const NodeConstraints& constraints, bool set_leaf_already_set,
-    NodeWithChildren* node, utils::RandomEngine* random,
-    PerThreadCache* cache) {
+    NodeWithChildren* node, utils::RandomEngine* random, PerThreadCache* cache,
+    const NodeHistograms* parent_histograms,
+    const std::vector<UnsignedExampleIdx>* sibling_examples) {
   if (selected_examples.empty()) {
     return absl::InternalError("No examples fed to the node trainer");
   }
@@ -4393,6 +4728,27 @@ absl::Status NodeTrain(
     local_train_dataset_is_compact = true;
   }
 
+  // Ensure the per-depth cache is allocated.
+  while (cache->per_depth.size() < depth) {
+    cache->per_depth.push_back(absl::make_unique<PerThreadCache::PerDepth>());
+  }
+  auto& per_depth_cache = *cache->per_depth[depth - 1];
+
+  // Histograms of the binned numerical features. The histograms of the node
+  // are retained until both children are trained.
+  HistogramContext histogram_context;
+  if (dt_config.numerical_split().type() ==
+      proto::NumericalSplit::HISTOGRAM_BINNED) {
+    per_depth_cache.histograms.Reset(train_dataset.data_spec().columns_size());
+    histogram_context.node = &per_depth_cache.histograms;
+    // Only the largest of the two siblings is computed by subtraction.
+    if (parent_histograms && sibling_examples &&
+        sibling_examples->size() <= selected_examples.size()) {
+      histogram_context.parent = parent_histograms;
+      histogram_context.sibling_examples = sibling_examples;
+    }
+  }
+
   // Determine the best split.
   ASSIGN_OR_RETURN(
       const auto has_better_condition,
@@ -4400,7 +4756,8 @@ absl::Status NodeTrain(
           *local_train_dataset, *local_selected_examples, weights, config,
           config_link, dt_config, splitter_concurrency_setup, node->node(),
           internal_config, constraints,
-          node->mutable_node()->mutable_condition(), random, cache));
+          node->mutable_node()->mutable_condition(), random, cache,
+          histogram_context));
   if (!has_better_condition) {
     // No good condition found. Close the branch.
     node->FinalizeAsLeaf(dt_config.store_detailed_label_distribution());
@@ -4412,13 +4769,7 @@ absl::Status NodeTrain(
   node->FinalizeAsNonLeaf(dt_config.keep_non_leaf_label_distribution(),
                           dt_config.store_detailed_label_distribution());
 
-  // Ensure the per-depth cache is allocated.
-  while (cache->per_depth.size() < depth) {
-    cache->per_depth.push_back(absl::make_unique<PerThreadCache::PerDepth>());
-  }
-
   // Separate the positive and negative examples.
-  auto& per_depth_cache = *cache->per_depth[depth - 1];
   std::vector<UnsignedExampleIdx>& positive_examples =
       per_depth_cache.positive_examples;
   std::vector<UnsignedExampleIdx>& negative_examples =
@@ -4473,14 +4824,16 @@ absl::Status NodeTrain(
       train_dataset, positive_examples, positive_node_only_examples, config,
       config_link, dt_config, deployment, splitter_concurrency_setup, weights,
       depth + 1, internal_config, pos_constraints, true,
-      node->mutable_pos_child(), random, cache));
+      node->mutable_pos_child(), random, cache, histogram_context.node,
+      &negative_examples));
 
   // Negative child.
   RETURN_IF_ERROR(NodeTrain(
       train_dataset, negative_examples, negative_node_only_examples, config,
       config_link, dt_config, deployment, splitter_concurrency_setup, weights,
       depth + 1, internal_config, neg_constraints, true,
-      node->mutable_neg_child(), random, cache));
+      node->mutable_neg_child(), random, cache, histogram_context.node,
+      &positive_examples));
   return absl::OkStatus();
 }
 
@@ -4501,6 +4854,18 @@ absl::StatusOr<Preprocessing> PreprocessTrainingDataset(
                                              num_threads, &preprocessing));
   }
 
+  if (dt_config.numerical_split().type() ==
+      proto::NumericalSplit::HISTOGRAM_BINNED) {
+    RETURN_IF_ERROR(BinNumericalFeatures(
+        train_dataset, config_link,
+        /*max_num_bins=*/dt_config.numerical_split().num_candidates() + 1,
+        num_threads, &preprocessing));
+    if (dt_config.internal().use_packed_bin_matrix()) {
+      PackBinnedNumericalFeatures(train_dataset.nrow(), num_threads,
+                                  &preprocessing);
+    }
+  }
+
   const auto duration = absl::Now() - time_begin;
   if (duration > absl::Seconds(10)) {
     YDF_LOG(INFO) << "Feature index computed in "
@@ -4582,6 +4947,149 @@ absl::Status PresortNumericalFeatures(
   return absl::OkStatus();
 }
 
+absl::Status BinNumericalFeatures(
+    const dataset::VerticalDataset& train_dataset,
+    const model::proto::TrainingConfigLinking& config_link,
+    const int max_num_bins, const int num_threads,
+    Preprocessing* preprocessing) {
+  STATUS_CHECK_GE(max_num_bins, 2);
+  STATUS_CHECK_LE(max_num_bins, std::numeric_limits<uint16_t>::max());
+
+  preprocessing->mutable_binned_numerical_features()->resize(
+      train_dataset.data_spec().columns_size());
+
+  utils::concurrency::Mutex mutex_status;
+  absl::Status status;
+  {
+    utils::concurrency::ThreadPool pool(
+        "bin_numerical_features",
+        std::min(num_threads, config_link.features().size()));
+    pool.StartWorkers();
+
+    // For all the input features in the model.
+    for (const auto feature_idx : config_link.features()) {
+      // Skip non numerical features.
+      if (train_dataset.data_spec().columns(feature_idx).type() !=
+          dataset::proto::NUMERICAL) {
+        continue;
+      }
+
+      pool.Schedule([feature_idx, max_num_bins, &train_dataset, preprocessing,
+                     &mutex_status, &status]() {
+        const auto& values =
+            train_dataset
+                .ColumnWithCastWithStatus<
+                    dataset::VerticalDataset::NumericalColumn>(feature_idx)
+                .value()
+                ->values();
+
+        // Global imputation replacement.
+        const float na_replacement_value =
+            train_dataset.data_spec().columns(feature_idx).numerical().mean();
+        const auto get_value = [&](const UnsignedExampleIdx example_idx) {
+          const float value = values[example_idx];
+          return std::isnan(value) ? na_replacement_value : value;
+        };
+
+        // Unique values and their counts.
+        std::vector<float> sorted_values(values.size());
+        for (UnsignedExampleIdx example_idx = 0; example_idx < values.size();
+             example_idx++) {
+          sorted_values[example_idx] = get_value(example_idx);
+        }
+        std::sort(sorted_values.begin(), sorted_values.end());
+        std::vector<std::pair<float, int>> unique_values_and_counts;
+        for (const float value : sorted_values) {
+          if (unique_values_and_counts.empty() ||
+              unique_values_and_counts.back().first != value) {
+            unique_values_and_counts.push_back({value, 0});
+          }
+          unique_values_and_counts.back().second++;
+        }
+
+        auto boundaries_or = dataset::GenDiscretizedBoundaries(
+            unique_values_and_counts, max_num_bins,
+            /*min_obs_in_bins=*/1, /*special_values=*/{});
+        if (!boundaries_or.ok()) {
+          utils::concurrency::MutexLock lock(&mutex_status);
+          status.Update(boundaries_or.status());
+          return;
+        }
+
+        auto& binned =
+            (*preprocessing->mutable_binned_numerical_features())[feature_idx];
+        binned.boundaries = std::move(boundaries_or).value();
+
+        const auto bin_values = [&](auto* bins) {
+          bins->resize(values.size());
+          for (UnsignedExampleIdx example_idx = 0; example_idx < values.size();
+               example_idx++) {
+            (*bins)[example_idx] = std::distance(
+                binned.boundaries.begin(),
+                std::upper_bound(binned.boundaries.begin(),
+                                 binned.boundaries.end(),
+                                 get_value(example_idx)));
+          }
+        };
+        if (binned.num_bins() <= std::numeric_limits<uint8_t>::max() + 1) {
+          bin_values(&binned.bins_8bits);
+        } else {
+          bin_values(&binned.bins_16bits);
+        }
+      });
+    }
+  }
+  return status;
+}
+
+void PackBinnedNumericalFeatures(const UnsignedExampleIdx num_examples,
+                                 const int num_threads,
+                                 Preprocessing* preprocessing) {
+  auto& binned_features = *preprocessing->mutable_binned_numerical_features();
+  std::vector<int> column_idxs;
+  for (int column_idx = 0; column_idx < binned_features.size(); column_idx++) {
+    if (!binned_features[column_idx].bins_8bits.empty()) {
+      column_idxs.push_back(column_idx);
+    }
+  }
+
+  auto& packed_bins =
+      *preprocessing->mutable_packed_binned_numerical_features();
+  packed_bins = dataset::PackedBinMatrix<uint8_t>(num_examples, column_idxs);
+  if (column_idxs.empty()) {
+    return;
+  }
+
+  {
+    // Each thread packs a contiguous block of rows.
+    utils::concurrency::ThreadPool pool("pack_binned_numerical_features",
+                                        std::max(1, num_threads));
+    pool.StartWorkers();
+    utils::concurrency::ConcurrentForLoop(
+        pool.num_threads(), &pool, num_examples,
+        [&](const size_t block_idx, const size_t begin_idx,
+            const size_t end_idx) {
+          for (size_t example_idx = begin_idx; example_idx < end_idx;
+               example_idx++) {
+            uint8_t* const row = packed_bins.MutableRow(example_idx);
+            for (int packed_idx = 0; packed_idx < column_idxs.size();
+                 packed_idx++) {
+              row[packed_idx] =
+                  binned_features[column_idxs[packed_idx]].bins_8bits
+                      [example_idx];
+            }
+          }
+        });
+  }
+
+  for (int packed_idx = 0; packed_idx < column_idxs.size(); packed_idx++) {
+    auto& feature = binned_features[column_idxs[packed_idx]];
+    feature.packed_idx = packed_idx;
+    // Release the column-wise bins.
+    std::vector<uint8_t>().swap(feature.bins_8bits);
+  }
+}
+
 absl::Status ApplyConstraintOnNode(const NodeConstraints& constraint,
                                    NodeWithChildren* node) {
   if (!constraint.min_max_output.has_value()) {
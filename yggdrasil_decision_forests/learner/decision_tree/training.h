@@ -29,6 +29,7 @@
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/dataset/packed_bin_matrix.h"
 #include "yggdrasil_decision_forests/dataset/types.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/learner/abstract_learner.pb.h"
@@ -51,6 +52,41 @@ namespace yggdrasil_decision_forests {
 namespace model {
 namespace decision_tree {
 
+// Gradient/hessian histograms of the binned numerical features in a node (see
+// "NumericalSplit::HISTOGRAM_BINNED"). Indexed by attribute index.
+//
+// A splitter is called at most once per attribute and per node. Therefore, each
+// histogram is written by a single splitter, possibly concurrently with the
+// histograms of other attributes.
+struct NodeHistograms {
+  std::vector<FeatureBinnedNumericalLabelHessianHistogram> histograms;
+
+  // "available[i]" is true iff "histograms[i]" contains the histogram of the
+  // node. Not a std::vector<bool> because items are written concurrently.
+  std::vector<uint8_t> available;
+
+  // Marks all the histograms as unavailable.
+  void Reset(const int num_columns) {
+    histograms.resize(num_columns);
+    available.assign(num_columns, false);
+  }
+};
+
+// Histograms that the HISTOGRAM_BINNED splitter can use and populate for a
+// node.
+struct HistogramContext {
+  // Where to store the histograms computed for the node. If null, the
+  // histograms are not retained.
+  NodeHistograms* node = nullptr;
+
+  // If set, the histogram of an attribute is computed as the histogram of the
+  // parent node minus the histogram of the "sibling_examples", instead of
+  // being computed from the node examples. Only worth it if the sibling node
+  // contains less examples than the node.
+  const NodeHistograms* parent = nullptr;
+  const std::vector<UnsignedExampleIdx>* sibling_examples = nullptr;
+};
+
 // Label statistics.
 struct LabelStats {
   virtual ~LabelStats() = default;
@@ -86,6 +122,9 @@ struct RegressionHessianLabelStats : LabelStats {
   double sum_gradient;
   double sum_hessian;
   double sum_weights;
+
+  // Histograms used by the HISTOGRAM_BINNED numerical splitter.
+  HistogramContext histogram_context;
 };
 
 // Label statistics for uplift with categorical treatment and categorical
@@ -262,6 +301,10 @@ struct PerThreadCache {
     // values in a split.
     std::vector<UnsignedExampleIdx> positive_node_only_examples;
     std::vector<UnsignedExampleIdx> negative_node_only_examples;
+
+    // Histograms of the node being split at this depth. Used to compute the
+    // histograms of its children by subtraction.
+    NodeHistograms histograms;
   };
   // Cache per depth.
   // Note: We use a unique pointer to guaranty stability of content.
@@ -288,6 +331,10 @@ struct SplitterConcurrencySetup {
 
   // Distributed split finder.
   std::unique_ptr<SplitterFinderStreamProcessor> split_finder_processor;
+
+  // Threads filling the histograms of the packed bin matrix. Only set if the
+  // packed bin matrix is used.
+  std::unique_ptr<utils::concurrency::ThreadPool> histogram_pool;
 };
 
 // Signature of a function that sets the value (i.e. the prediction) of a leaf
@@ -314,6 +361,26 @@ class Preprocessing {
     std::vector<SparseItem> items;
   };
 
+  struct BinnedNumericalFeature {
+    // Sorted boundaries between the bins i.e. the bin "i" contains the values
+    // in [boundaries[i-1], boundaries[i]).
+    std::vector<float> boundaries;
+
+    // Bin index of each example. Missing values are replaced using the
+    // GLOBAL_IMPUTATION strategy. At most one of the two vectors is populated:
+    // "bins_8bits" if the feature has at most 256 bins, and "bins_16bits"
+    // otherwise. If the feature is stored in the packed bin matrix (see
+    // "packed_binned_numerical_features()"), both vectors are empty.
+    std::vector<uint8_t> bins_8bits;
+    std::vector<uint16_t> bins_16bits;
+
+    // Index of the feature in the rows of the packed bin matrix. -1 if the
+    // feature is not packed.
+    int packed_idx = -1;
+
+    int num_bins() const { return boundaries.size() + 1; }
+  };
+
   std::vector<PresortedNumericalFeature>*
   mutable_presorted_numerical_features() {
     return &presorted_numerical_features_;
@@ -324,6 +391,24 @@ class Preprocessing {
     return presorted_numerical_features_;
   }
 
+  std::vector<BinnedNumericalFeature>* mutable_binned_numerical_features() {
+    return &binned_numerical_features_;
+  }
+
+  const std::vector<BinnedNumericalFeature>& binned_numerical_features()
+      const {
+    return binned_numerical_features_;
+  }
+
+  dataset::PackedBinMatrix<uint8_t>* mutable_packed_binned_numerical_features() {
+    return &packed_binned_numerical_features_;
+  }
+
+  const dataset::PackedBinMatrix<uint8_t>& packed_binned_numerical_features()
+      const {
+    return packed_binned_numerical_features_;
+  }
+
   uint64_t num_examples() const { return num_examples_; }
 
   void set_num_examples(const uint64_t value) { num_examples_ = value; }
@@ -334,6 +419,15 @@ class Preprocessing {
   // "presorted_numerical_features_[i]" will be an empty index.
   std::vector<PresortedNumericalFeature> presorted_numerical_features_;
 
+  // List of binned numerical features, indexed by feature index. Only
+  // populated for the HISTOGRAM_BINNED numerical splitter.
+  std::vector<BinnedNumericalFeature> binned_numerical_features_;
+
+  // Row-major bins of the binned numerical features with at most 256 bins.
+  // Only populated if "internal.use_packed_bin_matrix" is set. The
+  // DISCRETIZED_NUMERICAL and CATEGORICAL features are not packed.
+  dataset::PackedBinMatrix<uint8_t> packed_binned_numerical_features_;
+
   // Total number of examples.
   uint64_t num_examples_ = -1;
 };
@@ -437,6 +531,8 @@ struct InternalTrainConfig {
 // been found.
 // This is the entry point when searching for a condition.
 // All other "FindBestCondition*" functions are called by this one.
+//
+// "histogram_context" is only used by the HISTOGRAM_BINNED numerical splitter.
 absl::StatusOr<bool> FindBestCondition(
     const dataset::VerticalDataset& train_dataset,
     const std::vector<UnsignedExampleIdx>& selected_examples,
@@ -447,7 +543,8 @@ absl::StatusOr<bool> FindBestCondition(
     const SplitterConcurrencySetup& splitter_concurrency_setup,
     const proto::Node& parent, const InternalTrainConfig& internal_config,
     const NodeConstraints& constraints, proto::NodeCondition* best_condition,
-    utils::RandomEngine* random, PerThreadCache* cache);
+    utils::RandomEngine* random, PerThreadCache* cache,
+    const HistogramContext& histogram_context = {});
 
 // Contains logic to switch between a single-threaded splitter and a concurrent
 // implementation.
@@ -792,6 +889,28 @@ FindSplitLabelHessianRegressionFeatureDiscretizedNumericalCart(
     const NodeConstraints& constraints, int8_t monotonic_direction,
     proto::NodeCondition* condition, SplitterPerThreadCache* cache);
 
+// Search for the best split for a numerical attribute quantized in
+// "PreprocessTrainingDataset" and a hessian regression label (see
+// "NumericalSplit::HISTOGRAM_BINNED").
+//
+// The per-bin gradient/hessian histogram is either computed from the
+// "selected_examples", or derived from the parent and sibling histograms
+// available in "histogram_context". The histogram is then stored in
+// "histogram_context" (if set) for the training of the children nodes.
+template <bool weighted>
+SplitSearchResult FindSplitLabelHessianRegressionFeatureBinnedNumerical(
+    const std::vector<UnsignedExampleIdx>& selected_examples,
+    const std::vector<float>& weights,
+    const Preprocessing::BinnedNumericalFeature& attributes,
+    const std::vector<float>& gradients, const std::vector<float>& hessians,
+    float na_replacement, UnsignedExampleIdx min_num_obs,
+    const proto::DecisionTreeTrainingConfig& dt_config, double sum_gradient,
+    double sum_hessian, double sum_weights, int32_t attribute_idx,
+    const InternalTrainConfig& internal_config,
+    const NodeConstraints& constraints, int8_t monotonic_direction,
+    const HistogramContext& histogram_context,
+    proto::NodeCondition* condition, SplitterPerThreadCache* cache);
+
 // Similarly to "FindSplitLabelClassificationFeatureNumericalCart", but uses an
 // histogram approach to find the best split.
 template <bool weighted>
@@ -1073,7 +1192,9 @@ absl::Status NodeTrain(
     const std::vector<float>& weights, int32_t depth,
     const InternalTrainConfig& internal_config,
     const NodeConstraints& constraints, bool set_leaf_already_set,
-    NodeWithChildren* node, utils::RandomEngine* random, PerThreadCache* cache);
+    NodeWithChildren* node, utils::RandomEngine* random, PerThreadCache* cache,
+    const NodeHistograms* parent_histograms = nullptr,
+    const std::vector<UnsignedExampleIdx>* sibling_examples = nullptr);
 
 // Preprocess the dataset before any tree training.
 absl::StatusOr<Preprocessing> PreprocessTrainingDataset(
@@ -1089,6 +1210,20 @@ absl::Status PresortNumericalFeatures(
     const model::proto::TrainingConfigLinking& config_link, int num_threads,
     Preprocessing* preprocessing);
 
+// Component of "PreprocessTrainingDataset". Quantizes the numerical features
+// into at most "max_num_bins" bins.
+absl::Status BinNumericalFeatures(
+    const dataset::VerticalDataset& train_dataset,
+    const model::proto::TrainingConfigLinking& config_link, int max_num_bins,
+    int num_threads, Preprocessing* preprocessing);
+
+// Component of "PreprocessTrainingDataset". Moves the binned numerical
+// features with at most 256 bins into a row-major packed bin matrix. The rows
+// are packed in parallel with "num_threads" threads. The other features (e.g.
+// DISCRETIZED_NUMERICAL, CATEGORICAL) are not packed.
+void PackBinnedNumericalFeatures(UnsignedExampleIdx num_examples,
+                                 int num_threads, Preprocessing* preprocessing);
+
 // Set the default values of the hyper-parameters.
 void SetDefaultHyperParameters(proto::DecisionTreeTrainingConfig* config);
 
@@ -22,6 +22,8 @@
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/learner/decision_tree/oblique.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/utils/random.h"
 #include "yggdrasil_decision_forests/utils/test.h"
 #include "yggdrasil_decision_forests/utils/testing_macros.h"
 
@@ -148,6 +150,32 @@ TEST(DecisionTreeTrainingTest,
               StatusIs(absl::StatusCode::kInvalidArgument));
 }
 
+// The HISTOGRAM_BINNED numerical split reads the binned features of the
+// preprocessing. Training without them is an error.
+TEST(DecisionTreeTrainingTest, HistogramBinnedWithoutPreprocessing) {
+  ASSERT_OK_AND_ASSIGN(const dataset::VerticalDataset dataset,
+                       CreateToyGradientDataset());
+  model::proto::TrainingConfig config;
+  config.set_task(model::proto::Task::REGRESSION);
+  model::proto::TrainingConfigLinking config_link;
+  config_link.set_label(2);  // Gradient column.
+  config_link.add_numerical_features(0);
+  proto::DecisionTreeTrainingConfig dt_config;
+  dt_config.mutable_numerical_split()->set_type(
+      proto::NumericalSplit::HISTOGRAM_BINNED);
+  InternalTrainConfig internal_config;
+  internal_config.hessian_score = true;
+  internal_config.gradient_col_idx = 2;
+  internal_config.hessian_col_idx = 2;
+
+  utils::RandomEngine random;
+  DecisionTree tree;
+  EXPECT_THAT(DecisionTreeTrain(dataset, {0, 1, 2, 3}, config, config_link,
+                                dt_config, {}, {}, &random, &tree,
+                                internal_config),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST(SparaseOblique, Classification) {
   const model::proto::TrainingConfig config;
   model::proto::TrainingConfigLinking config_link;
@@ -300,6 +300,37 @@ template class ShardedIntegerColumnReader<int16_t>;
 template class ShardedIntegerColumnReader<int32_t>;
 template class ShardedIntegerColumnReader<int64_t>;
 
+template <typename Value>
+absl::Status RangeIntegerColumnIterator<Value>::Next() {
+  while (true) {
+    if (sub_value_idx_ >= end_idx_) {
+      values_ = {};
+      return absl::OkStatus();
+    }
+    RETURN_IF_ERROR(sub_iterator_->Next());
+    const auto values = sub_iterator_->Values();
+    if (values.empty()) {
+      values_ = {};
+      return absl::OkStatus();
+    }
+    const size_t begin_value_idx = sub_value_idx_;
+    sub_value_idx_ += values.size();
+    if (sub_value_idx_ <= begin_idx_) {
+      // All the values are before the range.
+      continue;
+    }
+    const size_t begin = std::max(begin_idx_, begin_value_idx);
+    const size_t end = std::min(end_idx_, sub_value_idx_);
+    values_ = values.subspan(begin - begin_value_idx, end - begin);
+    return absl::OkStatus();
+  }
+}
+
+template class RangeIntegerColumnIterator<int8_t>;
+template class RangeIntegerColumnIterator<int16_t>;
+template class RangeIntegerColumnIterator<int32_t>;
+template class RangeIntegerColumnIterator<int64_t>;
+
 template <typename Value>
 void InMemoryIntegerColumnReaderFactory<Value>::Reserve(size_t num_values,
                                                         int64_t max_value) {
@@ -202,6 +202,38 @@ class ShardedIntegerColumnReader : public AbstractIntegerColumnIterator<Value> {
   int current_shard_idx_ = 0;
 };
 
+// Iterates over the values in [begin_idx, end_idx) of another iterator. The
+// values before "begin_idx" are read and skipped. Used to read a range of
+// values of a column stored on disk.
+template <typename Value>
+class RangeIntegerColumnIterator : public AbstractIntegerColumnIterator<Value> {
+ public:
+  RangeIntegerColumnIterator(
+      std::unique_ptr<AbstractIntegerColumnIterator<Value>> sub_iterator,
+      size_t begin_idx, size_t end_idx)
+      : sub_iterator_(std::move(sub_iterator)),
+        begin_idx_(begin_idx),
+        end_idx_(end_idx) {}
+
+  absl::Span<const Value> Values() override { return values_; }
+
+  absl::Status Next() override;
+
+  absl::Status Close() override { return sub_iterator_->Close(); }
+
+ private:
+  std::unique_ptr<AbstractIntegerColumnIterator<Value>> sub_iterator_;
+  size_t begin_idx_;
+  size_t end_idx_;
+
+  // Index, in the sub iterator, of the first value of the next
+  // "sub_iterator_->Values()".
+  size_t sub_value_idx_ = 0;
+
+  // Last set of read values.
+  absl::Span<const Value> values_;
+};
+
 // Factory of integer column iterator that pre-loads/caches the sequence of
 // integer in memory (in file format). Then the caller can call a
 // "CreateIterator()" to get an iterator directly from memory. The values are
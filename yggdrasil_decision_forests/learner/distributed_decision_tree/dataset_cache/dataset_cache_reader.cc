@@ -15,6 +15,7 @@
 
 #include "yggdrasil_decision_forests/learner/distributed_decision_tree/dataset_cache/dataset_cache_reader.h"
 
+#include <algorithm>
 #include <limits>
 #include <numeric>
 
@@ -37,6 +38,15 @@ std::string DatasetCacheReader::MetadataInformation() const {
   auto report = MetaDataReport(meta_data(), features_);
   absl::SubstituteAndAppend(&report, "Number of loaded columns: $0\n",
                             features_.size());
+  const auto num_in_memory_columns =
+      std::count_if(in_memory_columns_.begin(), in_memory_columns_.end(),
+                    [](const std::atomic<bool>& in_memory) {
+                      return in_memory.load();
+                    });
+  absl::SubstituteAndAppend(&report,
+                            "Number of columns in memory: $0 ($1 MB)\n",
+                            num_in_memory_columns,
+                            memory_usage_ / (1024 * 1024));
   return report;
 }
 
@@ -128,9 +138,7 @@ absl::StatusOr<std::unique_ptr<DatasetCacheReader>> DatasetCacheReader::Create(
     }
   }
 
-  if (options.load_cache_in_memory()) {
-    RETURN_IF_ERROR(cache->InitializeAndLoadInMemoryCache());
-  }
+  RETURN_IF_ERROR(cache->InitializeAndLoadInMemoryCache());
 
   YDF_LOG(INFO) << "Dataset cache meta-data:\n" << cache->MetadataInformation();
   YDF_LOG(INFO) << "Dataset cache reader created in " << absl::Now() - begin;
@@ -140,14 +148,19 @@ absl::StatusOr<std::unique_ptr<DatasetCacheReader>> DatasetCacheReader::Create(
 absl::Status DatasetCacheReader::NonBlockingLoadingAndUnloadingFeatures(
     const std::vector<int>& load_features,
     const std::vector<int>& unload_features, const int num_threads) {
-  if (!options_.load_cache_in_memory()) {
-    return absl::OkStatus();
-  }
-
   if (IsNonBlockingLoadingInProgress()) {
     return absl::InternalError(
         "Non-blocking feature loading already in progress.");
   }
+
+  // Note: The memory of the unloaded features is counted as available while
+  // the new features are being loaded.
+  for (const int column_idx : unload_features) {
+    ReleaseColumnMemory(column_idx);
+  }
+  for (const int column_idx : load_features) {
+    in_memory_columns_[column_idx] = ReserveColumnMemory(column_idx);
+  }
   utils::concurrency::MutexLock lock(&non_blocking_.status_mutex);
   non_blocking_.is_running = true;
   non_blocking_.status = {};  // Clear status
@@ -173,7 +186,10 @@ absl::Status DatasetCacheReader::NonBlockingLoadingAndUnloadingFeatures(
               }
               size_t column_memory_usage;
               const auto status =
-                  LoadInMemoryCacheColumn(column_idx, &column_memory_usage);
+                  in_memory_columns_[column_idx]
+                      ? LoadInMemoryCacheColumn(column_idx,
+                                                &column_memory_usage)
+                      : LoadDiscretizedNumericalBoundaries(column_idx);
               utils::concurrency::MutexLock l(&non_blocking_.status_mutex);
               non_blocking_.status.Update(status);
             });
@@ -247,43 +263,47 @@ absl::Status DatasetCacheReader::LoadingAndUnloadingFeatures(
   YDF_LOG(INFO) << "Loading " << load_features.size() << " and unloading "
                 << unload_features.size() << " feature(s)";
 
-  if (options_.load_cache_in_memory()) {
-    const auto begin = absl::Now();
+  const auto begin = absl::Now();
+
+  for (const int column_idx : unload_features) {
+    RETURN_IF_ERROR(UnloadInMemoryCacheColumn(column_idx));
+  }
 
-    for (const int column_idx : unload_features) {
-      RETURN_IF_ERROR(UnloadInMemoryCacheColumn(column_idx));
+  if (!load_features.empty()) {
+    for (const int column_idx : load_features) {
+      in_memory_columns_[column_idx] = ReserveColumnMemory(column_idx);
     }
 
-    if (!load_features.empty()) {
-      absl::Status worker_status;
-      {
-        utils::concurrency::Mutex mutex_worker_status;
-        utils::concurrency::ThreadPool pool(
-            "LoadFeatures", std::min<int>(load_features.size(), 20));
-        pool.StartWorkers();
-
-        for (const int column_idx : load_features) {
-          pool.Schedule([&, column_idx]() {
-            {
-              utils::concurrency::MutexLock l(&mutex_worker_status);
-              if (!worker_status.ok()) {
-                return;
-              }
-            }
-            size_t column_memory_usage;
-            const auto status =
-                LoadInMemoryCacheColumn(column_idx, &column_memory_usage);
+    absl::Status worker_status;
+    {
+      utils::concurrency::Mutex mutex_worker_status;
+      utils::concurrency::ThreadPool pool(
+          "LoadFeatures", std::min<int>(load_features.size(), 20));
+      pool.StartWorkers();
+
+      for (const int column_idx : load_features) {
+        pool.Schedule([&, column_idx]() {
+          {
             utils::concurrency::MutexLock l(&mutex_worker_status);
-            worker_status.Update(status);
-          });
-        }
+            if (!worker_status.ok()) {
+              return;
+            }
+          }
+          size_t column_memory_usage;
+          const auto status =
+              in_memory_columns_[column_idx]
+                  ? LoadInMemoryCacheColumn(column_idx, &column_memory_usage)
+                  : LoadDiscretizedNumericalBoundaries(column_idx);
+          utils::concurrency::MutexLock l(&mutex_worker_status);
+          worker_status.Update(status);
+        });
       }
-      RETURN_IF_ERROR(worker_status);
     }
-
-    YDF_LOG(INFO) << "Update loaded features in " << (absl::Now() - begin);
+    RETURN_IF_ERROR(worker_status);
   }
 
+  YDF_LOG(INFO) << "Update loaded features in " << (absl::Now() - begin);
+
   return ApplyLoadingAndUnloadingFeaturesToMetadata(load_features,
                                                     unload_features);
 }
@@ -319,6 +339,15 @@ bool DatasetCacheReader::has_feature(const int feature) const {
 
 absl::Status DatasetCacheReader::UnloadInMemoryCacheColumn(
     const int column_idx) {
+  ReleaseColumnMemory(column_idx);
+  if (!in_memory_columns_[column_idx]) {
+    // Only the boundaries of the column streamed from disk are in memory.
+    in_memory_cache_.boundaries_of_discretized_numerical_columns_[column_idx]
+        .clear();
+    return absl::OkStatus();
+  }
+  in_memory_columns_[column_idx] = false;
+
   const auto& column = meta_data().columns(column_idx);
   switch (column.type_case()) {
     case proto::CacheMetadata_Column::kCategorical:
@@ -507,10 +536,97 @@ absl::Status DatasetCacheReader::LoadInMemoryCacheColumn(int column_idx,
   return absl::OkStatus();
 }
 
+absl::Status DatasetCacheReader::LoadDiscretizedNumericalBoundaries(
+    const int column_idx) {
+  const auto& column = meta_data().columns(column_idx);
+  if (!column.has_numerical() || !column.numerical().discretized()) {
+    return absl::OkStatus();
+  }
+  auto& boundaries =
+      in_memory_cache_.boundaries_of_discretized_numerical_columns_[column_idx];
+  DCHECK(boundaries.empty());
+  boundaries.reserve(column.numerical().num_discretized_values() - 1);
+  return ShardedFloatColumnReader::ReadAndAppend(
+      file::JoinPath(path_, kFilenameIndexed,
+                     absl::StrCat(kFilenameColumn, column_idx),
+                     kFilenameBoundaryValueNoUnderscore),
+      /*begin_shard_idx=*/0,
+      /*end_shard_idx=*/1, &boundaries);
+}
+
+size_t DatasetCacheReader::EstimateColumnMemoryUsage(
+    const int column_idx) const {
+  const auto& column = meta_data().columns(column_idx);
+  const size_t num_examples = meta_data_.num_examples();
+  switch (column.type_case()) {
+    case proto::CacheMetadata_Column::kCategorical:
+      return num_examples * NumBytes(column.categorical().num_values());
+
+    case proto::CacheMetadata_Column::kBoolean:
+      return num_examples * NumBytes(2);
+
+    case proto::CacheMetadata_Column::kNumerical: {
+      // Raw numerical values.
+      size_t usage = num_examples * sizeof(float);
+      if (column.numerical().discretized()) {
+        usage += num_examples *
+                 NumBytes(column.numerical().num_discretized_values());
+      } else {
+        usage += num_examples *
+                     NumBytes(MaxValueWithDeltaBit(num_examples)) +
+                 column.numerical().num_unique_values() * sizeof(float);
+      }
+      return usage;
+    }
+
+    case proto::CacheMetadata_Column::TYPE_NOT_SET:
+      return 0;
+  }
+  return 0;
+}
+
+bool DatasetCacheReader::ReserveColumnMemory(const int column_idx) {
+  if (!options_.load_cache_in_memory()) {
+    return false;
+  }
+  const size_t usage = EstimateColumnMemoryUsage(column_idx);
+  if (options_.max_in_memory_bytes() >= 0 &&
+      static_cast<int64_t>(memory_usage_ + usage) >
+          options_.max_in_memory_bytes()) {
+    return false;
+  }
+  DCHECK_EQ(column_memory_usage_[column_idx], 0);
+  column_memory_usage_[column_idx] = usage;
+  memory_usage_ += usage;
+  return true;
+}
+
+void DatasetCacheReader::ReleaseColumnMemory(const int column_idx) {
+  memory_usage_ -= column_memory_usage_[column_idx];
+  column_memory_usage_[column_idx] = 0;
+}
+
+absl::StatusOr<bool> DatasetCacheReader::ReadColumnFromMemory(
+    const int column_idx) const {
+  if (in_memory_columns_[column_idx]) {
+    return true;
+  }
+  if (options_.load_cache_in_memory() && !has_feature(column_idx)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Column ", column_idx, " is not available"));
+  }
+  return false;
+}
+
 absl::Status DatasetCacheReader::InitializeAndLoadInMemoryCache() {
   YDF_LOG(INFO) << "Loading features in memory";
 
   const auto num_columns = meta_data().columns_size();
+  in_memory_columns_ = std::vector<std::atomic<bool>>(num_columns);
+  for (auto& in_memory : in_memory_columns_) {
+    in_memory = false;
+  }
+  column_memory_usage_.assign(num_columns, 0);
   in_memory_cache_.inorder_categorical_columns_.resize(num_columns);
   in_memory_cache_.inorder_numerical_columns_.resize(num_columns);
   in_memory_cache_.presorted_numerical_example_idx_columns_.resize(num_columns);
@@ -524,6 +640,16 @@ absl::Status DatasetCacheReader::InitializeAndLoadInMemoryCache() {
   const auto begin = absl::Now();
   std::atomic<size_t> memory_usage{0};
 
+  // The features are selected in order of feature index until the memory
+  // budget is exhausted.
+  int num_streamed_features = 0;
+  for (const int column_idx : features_) {
+    in_memory_columns_[column_idx] = ReserveColumnMemory(column_idx);
+    if (!in_memory_columns_[column_idx]) {
+      num_streamed_features++;
+    }
+  }
+
   absl::Status worker_status;
   {
     utils::concurrency::Mutex mutex_worker_status;
@@ -537,9 +663,11 @@ absl::Status DatasetCacheReader::InitializeAndLoadInMemoryCache() {
             return;
           }
         }
-        size_t column_memory_usage;
+        size_t column_memory_usage = 0;
         const auto status =
-            LoadInMemoryCacheColumn(column_idx, &column_memory_usage);
+            in_memory_columns_[column_idx]
+                ? LoadInMemoryCacheColumn(column_idx, &column_memory_usage)
+                : LoadDiscretizedNumericalBoundaries(column_idx);
         memory_usage += column_memory_usage;
         utils::concurrency::MutexLock l(&mutex_worker_status);
         worker_status.Update(status);
@@ -551,6 +679,10 @@ absl::Status DatasetCacheReader::InitializeAndLoadInMemoryCache() {
   load_in_memory_duration_ = absl::Now() - begin;
   YDF_LOG(INFO) << "Features loaded in memory in " << load_in_memory_duration_
                 << " for " << (memory_usage / (1024 * 1024)) << " MB";
+  if (num_streamed_features > 0) {
+    YDF_LOG(INFO) << num_streamed_features
+                  << " feature(s) are streamed from disk";
+  }
   return absl::OkStatus();
 }
 
@@ -580,7 +712,8 @@ DatasetCacheReader::PresortedNumericalFeatureExampleIterator(
         absl::StrCat("Column ", column_idx, " is not numerical"));
   }
 
-  if (options_.load_cache_in_memory()) {
+  ASSIGN_OR_RETURN(const bool in_memory, ReadColumnFromMemory(column_idx));
+  if (in_memory) {
     if (in_memory_cache_.presorted_numerical_example_idx_columns_[column_idx] ==
         nullptr) {
       return absl::InvalidArgumentError(
@@ -612,7 +745,8 @@ DatasetCacheReader::PresortedNumericalFeatureValueIterator(
         absl::StrCat("Column ", column_idx, " is not numerical"));
   }
 
-  if (options_.load_cache_in_memory()) {
+  ASSIGN_OR_RETURN(const bool in_memory, ReadColumnFromMemory(column_idx));
+  if (in_memory) {
     if (in_memory_cache_
             .presorted_numerical_unique_values_columns_[column_idx] ==
         nullptr) {
@@ -642,7 +776,8 @@ DatasetCacheReader::InOrderNumericalFeatureValueIterator(int column_idx) const {
         absl::StrCat("Column ", column_idx, " is not numerical"));
   }
 
-  if (options_.load_cache_in_memory()) {
+  ASSIGN_OR_RETURN(const bool in_memory, ReadColumnFromMemory(column_idx));
+  if (in_memory) {
     if (in_memory_cache_.inorder_numerical_columns_[column_idx] == nullptr) {
       return absl::InvalidArgumentError(
           absl::StrCat("Column ", column_idx, " is not available"));
@@ -670,7 +805,8 @@ DatasetCacheReader::InOrderCategoricalFeatureValueIterator(
         absl::StrCat("Column ", column_idx, " is not categorical"));
   }
 
-  if (options_.load_cache_in_memory()) {
+  ASSIGN_OR_RETURN(const bool in_memory, ReadColumnFromMemory(column_idx));
+  if (in_memory) {
     if (in_memory_cache_.inorder_categorical_columns_[column_idx] == nullptr) {
       return absl::InvalidArgumentError(
           absl::StrCat("Column ", column_idx, " is not available"));
@@ -700,7 +836,8 @@ DatasetCacheReader::InOrderBooleanFeatureValueIterator(int column_idx) const {
         absl::StrCat("Column ", column_idx, " is not boolean"));
   }
 
-  if (options_.load_cache_in_memory()) {
+  ASSIGN_OR_RETURN(const bool in_memory, ReadColumnFromMemory(column_idx));
+  if (in_memory) {
     if (in_memory_cache_.inorder_boolean_columns_[column_idx] == nullptr) {
       return absl::InvalidArgumentError(
           absl::StrCat("Column ", column_idx, " is not available"));
@@ -736,7 +873,8 @@ DatasetCacheReader::InOrderDiscretizedNumericalFeatureValueIterator(
         absl::StrCat("Column ", column_idx, " is not discretized"));
   }
 
-  if (options_.load_cache_in_memory()) {
+  ASSIGN_OR_RETURN(const bool in_memory, ReadColumnFromMemory(column_idx));
+  if (in_memory) {
     if (in_memory_cache_.inorder_discretized_numerical_columns_[column_idx] ==
         nullptr) {
       return absl::InvalidArgumentError(
@@ -776,7 +914,8 @@ DatasetCacheReader::InOrderDiscretizedNumericalFeatureValueIterator(
         absl::StrCat("Column ", column_idx, " is not discretized"));
   }
 
-  if (options_.load_cache_in_memory()) {
+  ASSIGN_OR_RETURN(const bool in_memory, ReadColumnFromMemory(column_idx));
+  if (in_memory) {
     if (in_memory_cache_.inorder_discretized_numerical_columns_[column_idx] ==
         nullptr) {
       return absl::InvalidArgumentError(
@@ -787,9 +926,11 @@ DatasetCacheReader::InOrderDiscretizedNumericalFeatureValueIterator(
         ->CreateIterator(begin_idx, end_idx);
   }
 
-  return absl::InvalidArgumentError(
-      "InOrderDiscretizedNumericalFeatureValueIterator does not support "
-      "begin/end index without in-memory caching");
+  ASSIGN_OR_RETURN(auto reader,
+                   InOrderDiscretizedNumericalFeatureValueIterator(column_idx));
+  return absl::make_unique<
+      RangeIntegerColumnIterator<DiscretizedIndexedNumericalType>>(
+      std::move(reader), begin_idx, end_idx);
 }
 
 const std::vector<float>&
@@ -955,7 +1096,7 @@ absl::Status PartialDatasetCacheDataSpecCreator::ComputeColumnStatistics(
             kFilenameMetaDataPostfix);
         thread_pool.Schedule([shard_meta_data_path, &mutex_data, accumulator,
                               data_spec, col_idx, &num_examples_per_columns,
-                              &thread_status]() {
+                              &thread_status, &guide]() {
           PartialColumnShardMetadata shard_meta_data;
           const auto status_get_binary = file::GetBinaryProto(
               shard_meta_data_path, &shard_meta_data, file::Defaults());
@@ -968,6 +1109,9 @@ absl::Status PartialDatasetCacheDataSpecCreator::ComputeColumnStatistics(
           num_examples_per_columns[col_idx] += shard_meta_data.num_examples();
           thread_status.Update(ComputeColumnStatisticsColumnAndShard(
               col_idx, shard_meta_data, data_spec, accumulator));
+          BoundColumnStatisticsMemory(guide,
+                                      data_spec->mutable_columns(col_idx),
+                                      accumulator->mutable_columns(col_idx));
         });
       }
     }
@@ -18,6 +18,9 @@
 #ifndef YGGDRASIL_DECISION_FORESTS_LEARNER_DISTRIBUTED_DECISION_TREE_DATASET_CACHE_DATASET_CACHE_READER_H_
 #define YGGDRASIL_DECISION_FORESTS_LEARNER_DISTRIBUTED_DECISION_TREE_DATASET_CACHE_DATASET_CACHE_READER_H_
 
+#include <atomic>
+#include <vector>
+
 #include "absl/strings/string_view.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/data_spec_inference.h"
@@ -126,6 +129,15 @@ class DatasetCacheReader {
   // Tests if a feature is available in the reader.
   bool has_feature(int feature) const;
 
+  // Tests if a feature is held in memory. The available features not held in
+  // memory are streamed from disk (see "max_in_memory_bytes").
+  bool is_feature_in_memory(int feature) const {
+    return in_memory_columns_[feature];
+  }
+
+  // Estimated memory usage of the features held in memory.
+  size_t in_memory_usage() const { return memory_usage_; }
+
   // Load and unload a set of features.
   absl::Status LoadingAndUnloadingFeatures(
       const std::vector<int>& load_features,
@@ -190,7 +202,8 @@ class DatasetCacheReader {
                      const proto::DatasetCacheReaderOptions& options)
       : path_(path), options_(options) {}
 
-  // Initialize the internal structure and load the feature columns in RAM.
+  // Initialize the internal structure and load the feature columns in RAM
+  // (within the memory budget). The other columns are streamed from disk.
   absl::Status InitializeAndLoadInMemoryCache();
 
   // Loads a single column in RAM.
@@ -199,6 +212,23 @@ class DatasetCacheReader {
   // Unloads a single column from RAM.
   absl::Status UnloadInMemoryCacheColumn(int column_idx);
 
+  // Loads the discretization boundaries of a discretized numerical column
+  // streamed from disk. Does nothing for the other columns.
+  absl::Status LoadDiscretizedNumericalBoundaries(int column_idx);
+
+  // Estimated memory usage of a column loaded with "LoadInMemoryCacheColumn".
+  size_t EstimateColumnMemoryUsage(int column_idx) const;
+
+  // Reserves the memory needed to load a column in memory. Returns false, and
+  // does not reserve anything, if the memory budget does not allow it.
+  bool ReserveColumnMemory(int column_idx);
+
+  // Releases the memory reserved with "ReserveColumnMemory" (if any).
+  void ReleaseColumnMemory(int column_idx);
+
+  // Tests if a column is read from memory (true) or from disk (false).
+  absl::StatusOr<bool> ReadColumnFromMemory(int column_idx) const;
+
   // Updates the meta-data to make the specified features available. Note: This
   // method is not in charge of actually loading/unloading the features (i.e.
   // LoadInMemoryCacheColumn and UnloadInMemoryCacheColumn). Instead, the
@@ -227,6 +257,16 @@ class DatasetCacheReader {
 
   absl::Duration load_in_memory_duration_;
 
+  // Columns held, or being loaded, in memory. Other columns are read from
+  // disk. Atomic since the readers can query a column while a non-blocking
+  // loading thread updates the set of loaded columns.
+  std::vector<std::atomic<bool>> in_memory_columns_;
+
+  // Memory reserved for each column, and total memory reserved, according to
+  // "EstimateColumnMemoryUsage". Only modified by the calling thread.
+  std::vector<size_t> column_memory_usage_;
+  size_t memory_usage_ = 0;
+
   struct NonBlocking {
     // Loading thread.
     std::unique_ptr<utils::concurrency::Thread> loading_thread;
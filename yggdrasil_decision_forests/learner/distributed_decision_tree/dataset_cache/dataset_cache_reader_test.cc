@@ -34,6 +34,22 @@ namespace distributed_decision_tree {
 namespace dataset_cache {
 namespace {
 
+// Reads all the values of a column iterator.
+template <typename Iterator>
+auto ReadAllValues(Iterator* iterator) {
+  std::vector<typename decltype(iterator->Values())::value_type> values;
+  while (true) {
+    CHECK_OK(iterator->Next());
+    const auto chunk = iterator->Values();
+    if (chunk.empty()) {
+      break;
+    }
+    values.insert(values.end(), chunk.begin(), chunk.end());
+  }
+  CHECK_OK(iterator->Close());
+  return values;
+}
+
 class End2End : public ::testing::Test {
  public:
   void SetUp() override {
@@ -152,6 +168,93 @@ TEST_F(End2End, Base) {
   YDF_LOG(INFO) << reader->MetadataInformation();
 }
 
+TEST_F(End2End, MemoryBudget) {
+  const auto expected =
+      DatasetCacheReader::Create(cache_path_, {}).value();
+
+  // With a zero budget, all the columns are streamed from disk.
+  for (const int64_t max_in_memory_bytes : {0, 100000}) {
+    proto::DatasetCacheReaderOptions options;
+    options.set_max_in_memory_bytes(max_in_memory_bytes);
+    auto reader = DatasetCacheReader::Create(cache_path_, options).value();
+    EXPECT_LE(reader->in_memory_usage(), max_in_memory_bytes);
+
+    int num_in_memory = 0;
+    for (const int feature : reader->features()) {
+      num_in_memory += reader->is_feature_in_memory(feature);
+    }
+    if (max_in_memory_bytes == 0) {
+      EXPECT_EQ(num_in_memory, 0);
+    } else {
+      EXPECT_GT(num_in_memory, 0);
+      EXPECT_LT(num_in_memory, reader->features().size());
+    }
+
+    EXPECT_EQ(
+        ReadAllValues(
+            reader->PresortedNumericalFeatureExampleIterator(0).value().get()),
+        ReadAllValues(expected->PresortedNumericalFeatureExampleIterator(0)
+                          .value()
+                          .get()));
+
+    for (const int column_idx : {0, 4}) {
+      EXPECT_EQ(
+          ReadAllValues(
+              reader->InOrderNumericalFeatureValueIterator(column_idx)
+                  .value()
+                  .get()),
+          ReadAllValues(
+              expected->InOrderNumericalFeatureValueIterator(column_idx)
+                  .value()
+                  .get()));
+    }
+
+    EXPECT_EQ(
+        ReadAllValues(
+            reader->PresortedNumericalFeatureValueIterator(0).value().get()),
+        ReadAllValues(
+            expected->PresortedNumericalFeatureValueIterator(0).value().get()));
+
+    EXPECT_EQ(
+        ReadAllValues(
+            reader->InOrderCategoricalFeatureValueIterator(1).value().get()),
+        ReadAllValues(
+            expected->InOrderCategoricalFeatureValueIterator(1).value().get()));
+
+    EXPECT_EQ(ReadAllValues(
+                  reader->InOrderDiscretizedNumericalFeatureValueIterator(4)
+                      .value()
+                      .get()),
+              ReadAllValues(
+                  expected->InOrderDiscretizedNumericalFeatureValueIterator(4)
+                      .value()
+                      .get()));
+    EXPECT_EQ(ReadAllValues(
+                  reader
+                      ->InOrderDiscretizedNumericalFeatureValueIterator(
+                          4, /*begin_idx=*/100, /*end_idx=*/5000)
+                      .value()
+                      .get()),
+              ReadAllValues(
+                  expected
+                      ->InOrderDiscretizedNumericalFeatureValueIterator(
+                          4, /*begin_idx=*/100, /*end_idx=*/5000)
+                      .value()
+                      .get()));
+    EXPECT_EQ(reader->DiscretizedNumericalFeatureBoundaries(4),
+              expected->DiscretizedNumericalFeatureBoundaries(4));
+
+    // Unloading and re-loading a column streamed from disk.
+    EXPECT_OK(reader->LoadingAndUnloadingFeatures({}, {4}));
+    EXPECT_FALSE(reader->has_feature(4));
+    EXPECT_OK(reader->LoadingAndUnloadingFeatures({4}, {}));
+    EXPECT_TRUE(reader->has_feature(4));
+    EXPECT_EQ(reader->DiscretizedNumericalFeatureBoundaries(4),
+              expected->DiscretizedNumericalFeatureBoundaries(4));
+    EXPECT_LE(reader->in_memory_usage(), max_in_memory_bytes);
+  }
+}
+
 }  // namespace
 }  // namespace dataset_cache
 }  // namespace distributed_decision_tree
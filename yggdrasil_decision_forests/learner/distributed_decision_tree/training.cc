@@ -15,8 +15,14 @@
 
 #include "yggdrasil_decision_forests/learner/distributed_decision_tree/training.h"
 
+#include <cstdint>
+#include <limits>
+#include <string>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
 #include "yggdrasil_decision_forests/learner/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/learner/decision_tree/splitter_accumulator.h"
 #include "yggdrasil_decision_forests/learner/distributed_decision_tree/dataset_cache/dataset_cache_common.h"
@@ -116,6 +122,100 @@ absl::Status TemplatedAggregateLabelStatistics(
   return absl::OkStatus();
 }
 
+void AppendVarint(uint64_t value, std::string* dst) {
+  while (value >= 0x80) {
+    dst->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  dst->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(absl::string_view src, size_t* pos, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *pos < src.size(); shift += 7) {
+    const uint8_t byte = src[(*pos)++];
+    *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Run-length encoding of a bitmap. The runs alternate between zeros and ones,
+// starting with zeros (the first run can be empty). Returns false (and leave
+// "encoded" in an undefined state) as soon as the encoding exceeds "max_size"
+// bytes.
+bool RunLengthEncode(const SplitEvaluation& evaluation, const size_t max_size,
+                     std::string* encoded) {
+  AppendVarint(evaluation.size(), encoded);
+  bool run_value = false;
+  uint64_t run_length = 0;
+  for (const char c : evaluation) {
+    const uint8_t byte = c;
+    // Fast path for the bytes that continue the current run.
+    if (byte == (run_value ? 0xFF : 0x00)) {
+      run_length += 8;
+      continue;
+    }
+    for (int bit_idx = 0; bit_idx < 8; bit_idx++) {
+      const bool value = (byte >> bit_idx) & 1;
+      if (value == run_value) {
+        run_length++;
+      } else {
+        AppendVarint(run_length, encoded);
+        if (encoded->size() > max_size) {
+          return false;
+        }
+        run_value = value;
+        run_length = 1;
+      }
+    }
+  }
+  AppendVarint(run_length, encoded);
+  return encoded->size() <= max_size;
+}
+
+absl::Status RunLengthDecode(absl::string_view encoded,
+                             SplitEvaluation* evaluation) {
+  size_t pos = 0;
+  uint64_t num_bytes;
+  if (!ReadVarint(encoded, &pos, &num_bytes)) {
+    return absl::InvalidArgumentError("Invalid run-length split evaluation");
+  }
+  evaluation->assign(num_bytes, 0);
+  const uint64_t num_bits = num_bytes * 8;
+  uint64_t bit_idx = 0;
+  bool run_value = false;
+  while (pos < encoded.size()) {
+    uint64_t run_length;
+    if (!ReadVarint(encoded, &pos, &run_length) ||
+        run_length > num_bits - bit_idx) {
+      return absl::InvalidArgumentError("Invalid run-length split evaluation");
+    }
+    if (run_value) {
+      uint64_t end_bit_idx = bit_idx + run_length;
+      // Leading bits, whole bytes, trailing bits.
+      for (; bit_idx < end_bit_idx && (bit_idx % 8) != 0; bit_idx++) {
+        (*evaluation)[bit_idx / 8] |= 1 << (bit_idx % 8);
+      }
+      for (; bit_idx + 8 <= end_bit_idx; bit_idx += 8) {
+        (*evaluation)[bit_idx / 8] = static_cast<char>(0xFF);
+      }
+      for (; bit_idx < end_bit_idx; bit_idx++) {
+        (*evaluation)[bit_idx / 8] |= 1 << (bit_idx % 8);
+      }
+    } else {
+      bit_idx += run_length;
+    }
+    run_value = !run_value;
+  }
+  if (bit_idx != num_bits) {
+    return absl::InvalidArgumentError("Invalid run-length split evaluation");
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 ExampleToNodeMap CreateExampleToNodeMap(ExampleIndex num_examples) {
@@ -1158,6 +1258,44 @@ void ConvertToProto(const SplitPerOpenNode& src,
   }
 }
 
+absl::Status EncodeSplitEvaluation(
+    const SplitEvaluation& evaluation,
+    const proto::SplitEvaluationEncoding encoding, std::string* encoded) {
+  encoded->clear();
+  if (encoding != proto::SplitEvaluationEncoding::RAW_BITMAP) {
+    encoded->push_back(proto::SplitEvaluationEncoding::RUN_LENGTH);
+    const size_t max_size =
+        encoding == proto::SplitEvaluationEncoding::ADAPTIVE
+            ? evaluation.size()
+            : std::numeric_limits<size_t>::max();
+    if (RunLengthEncode(evaluation, max_size, encoded)) {
+      return absl::OkStatus();
+    }
+    // The raw bitmap is smaller.
+    encoded->clear();
+  }
+  encoded->reserve(evaluation.size() + 1);
+  encoded->push_back(proto::SplitEvaluationEncoding::RAW_BITMAP);
+  encoded->append(evaluation);
+  return absl::OkStatus();
+}
+
+absl::Status DecodeSplitEvaluation(const absl::string_view encoded,
+                                   SplitEvaluation* evaluation) {
+  if (encoded.empty()) {
+    return absl::InvalidArgumentError("Empty encoded split evaluation");
+  }
+  switch (encoded[0]) {
+    case proto::SplitEvaluationEncoding::RAW_BITMAP:
+      evaluation->assign(encoded.data() + 1, encoded.size() - 1);
+      return absl::OkStatus();
+    case proto::SplitEvaluationEncoding::RUN_LENGTH:
+      return RunLengthDecode(encoded.substr(1), evaluation);
+    default:
+      return absl::InvalidArgumentError("Unknown split evaluation encoding");
+  }
+}
+
 }  // namespace distributed_decision_tree
 }  // namespace model
 }  // namespace yggdrasil_decision_forests
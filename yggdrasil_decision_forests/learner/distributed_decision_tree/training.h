@@ -36,6 +36,10 @@
 #ifndef YGGDRASIL_DECISION_FORESTS_LEARNER_DISTRIBUTED_DECISION_TREE_TRAINING_H_
 #define YGGDRASIL_DECISION_FORESTS_LEARNER_DISTRIBUTED_DECISION_TREE_TRAINING_H_
 
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
 #include "yggdrasil_decision_forests/learner/abstract_learner.pb.h"
 #include "yggdrasil_decision_forests/learner/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/learner/distributed_decision_tree/dataset_cache/dataset_cache.h"
@@ -314,6 +318,18 @@ absl::Status EvaluateSplitsPerBooleanFeature(
     SplitEvaluationPerOpenNode* split_evaluation,
     dataset_cache::DatasetCacheReader* dataset);
 
+// Encodes a split evaluation bitmap before it is sent to another worker. The
+// first byte of "encoded" is the encoding effectively used (RAW_BITMAP or
+// RUN_LENGTH). With the ADAPTIVE encoding, the run-length encoding is only used
+// if it is smaller than the raw bitmap.
+absl::Status EncodeSplitEvaluation(const SplitEvaluation& evaluation,
+                                   proto::SplitEvaluationEncoding encoding,
+                                   std::string* encoded);
+
+// Decodes a split evaluation encoded with "EncodeSplitEvaluation".
+absl::Status DecodeSplitEvaluation(absl::string_view encoded,
+                                   SplitEvaluation* evaluation);
+
 // Update the node index of each example according to the split.
 absl::Status UpdateExampleNodeMap(
     const SplitPerOpenNode& splits,
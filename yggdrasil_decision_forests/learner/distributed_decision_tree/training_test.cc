@@ -15,7 +15,12 @@
 
 #include "yggdrasil_decision_forests/learner/distributed_decision_tree/training.h"
 
+#include <random>
+#include <string>
+
 #include "gmock/gmock.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "yggdrasil_decision_forests/dataset/data_spec_inference.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
@@ -28,6 +33,7 @@
 #include "yggdrasil_decision_forests/utils/distribute/implementations/multi_thread/multi_thread.pb.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
+#include "yggdrasil_decision_forests/utils/random.h"
 #include "yggdrasil_decision_forests/utils/test.h"
 
 namespace yggdrasil_decision_forests {
@@ -523,6 +529,68 @@ TEST_F(AdultClassificationDataset, End2EndTrainClassification_5Threads) {
   GenericTrainingLoop(&label_accessor, this, /*num_threads=*/5);
 }
 
+// Encodes and decodes the evaluation of a split found on the dataset.
+TEST_F(AdultClassificationDataset, SplitEvaluationEncoding) {
+  utils::concurrency::ThreadPool thread_pool("", 2);
+  thread_pool.StartWorkers();
+
+  auto example_to_node = CreateExampleToNodeMap(dataset_->num_examples());
+  ClassificationLabelAccessor label_accessor(
+      dataset_->categorical_labels(), dataset_->weights(), /*num_classes=*/3);
+  auto tree_builder =
+      TreeBuilder::Create(config_, config_link_, dt_config_).value();
+
+  decision_tree::proto::LabelStatistics label_stats;
+  CHECK_OK(tree_builder->AggregateLabelStatistics(label_accessor, &label_stats,
+                                                  &thread_pool));
+  CHECK_OK(tree_builder->SetRootValue(label_stats));
+
+  // Best split on "workclass" feature.
+  SplitPerOpenNode splits;
+  CHECK_OK(tree_builder->FindBestSplits({{{1 /*workclass*/}},
+                                         example_to_node,
+                                         data_spec_,
+                                         label_accessor,
+                                         {label_stats},
+                                         false,
+                                         dataset_.get(),
+                                         &splits}));
+  ASSERT_EQ(NumValidSplits(splits), 1);
+  const auto node_remapping = tree_builder->ApplySplitToTree(splits).value();
+
+  SplitEvaluationPerOpenNode split_evaluation;
+  CHECK_OK(EvaluateSplits(example_to_node, splits, &split_evaluation,
+                          dataset_.get(), &thread_pool));
+  ASSERT_EQ(split_evaluation.size(), 1);
+
+  for (const auto encoding : {proto::SplitEvaluationEncoding::RAW_BITMAP,
+                              proto::SplitEvaluationEncoding::RUN_LENGTH,
+                              proto::SplitEvaluationEncoding::ADAPTIVE}) {
+    SCOPED_TRACE(absl::StrCat("encoding:", encoding));
+    std::string encoded;
+    ASSERT_OK(
+        EncodeSplitEvaluation(split_evaluation.front(), encoding, &encoded));
+    if (encoding == proto::SplitEvaluationEncoding::ADAPTIVE) {
+      EXPECT_LE(encoded.size(), split_evaluation.front().size() + 1);
+    }
+
+    // The decoded evaluation routes the examples as the original one.
+    SplitEvaluationPerOpenNode decoded_split_evaluation(1);
+    ASSERT_OK(
+        DecodeSplitEvaluation(encoded, &decoded_split_evaluation.front()));
+    EXPECT_EQ(decoded_split_evaluation, split_evaluation);
+
+    auto decoded_example_to_node = example_to_node;
+    auto expected_example_to_node = example_to_node;
+    CHECK_OK(UpdateExampleNodeMap(splits, decoded_split_evaluation,
+                                  node_remapping, &decoded_example_to_node,
+                                  &thread_pool));
+    CHECK_OK(UpdateExampleNodeMap(splits, split_evaluation, node_remapping,
+                                  &expected_example_to_node, &thread_pool));
+    EXPECT_EQ(decoded_example_to_node, expected_example_to_node);
+  }
+}
+
 class AbaloneRegressionDataset : public ::testing::Test {
  public:
   void SetUp() override {
@@ -564,6 +632,58 @@ TEST_F(AbaloneRegressionDataset, End2EndTrainRegression) {
   GenericTrainingLoop(&label_accessor, this);
 }
 
+TEST(SplitEvaluationEncoding, RoundTrip) {
+  utils::RandomEngine random(1234);
+  std::uniform_real_distribution<float> unif01;
+  for (const int num_bytes : {0, 1, 7, 8, 100, 10000}) {
+    for (const float positive_ratio : {0.f, 0.001f, 0.5f, 0.999f, 1.f}) {
+      SplitEvaluation evaluation(num_bytes, 0);
+      for (int bit_idx = 0; bit_idx < num_bytes * 8; bit_idx++) {
+        if (unif01(random) < positive_ratio) {
+          utils::bitmap::SetValueBit(bit_idx, &evaluation);
+        }
+      }
+      for (const auto encoding : {proto::SplitEvaluationEncoding::RAW_BITMAP,
+                                  proto::SplitEvaluationEncoding::RUN_LENGTH,
+                                  proto::SplitEvaluationEncoding::ADAPTIVE}) {
+        SCOPED_TRACE(absl::StrCat("num_bytes:", num_bytes,
+                                  " positive_ratio:", positive_ratio,
+                                  " encoding:", encoding));
+        std::string encoded;
+        ASSERT_OK(EncodeSplitEvaluation(evaluation, encoding, &encoded));
+        SplitEvaluation decoded;
+        ASSERT_OK(DecodeSplitEvaluation(encoded, &decoded));
+        EXPECT_EQ(decoded, evaluation);
+
+        if (encoding == proto::SplitEvaluationEncoding::ADAPTIVE) {
+          EXPECT_LE(encoded.size(), evaluation.size() + 1);
+          if (num_bytes == 10000 && positive_ratio != 0.5f) {
+            // Unbalanced splits are compressed.
+            EXPECT_LT(encoded.size(), evaluation.size() / 10);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(SplitEvaluationEncoding, InvalidInput) {
+  SplitEvaluation decoded;
+  EXPECT_FALSE(DecodeSplitEvaluation("", &decoded).ok());
+  EXPECT_FALSE(DecodeSplitEvaluation("\x05", &decoded).ok());
+  // A run longer than the bitmap.
+  EXPECT_FALSE(DecodeSplitEvaluation(
+                   absl::string_view("\x01\x01\x00\x09", 4), &decoded)
+                   .ok());
+  // A bitmap not entirely covered by the runs.
+  EXPECT_FALSE(DecodeSplitEvaluation(
+                   absl::string_view("\x01\x01\x00\x07", 4), &decoded)
+                   .ok());
+  EXPECT_OK(DecodeSplitEvaluation(absl::string_view("\x01\x01\x03\x05", 4),
+                                  &decoded));
+  EXPECT_EQ(decoded, "\xF8");
+}
+
 }  // namespace
 }  // namespace distributed_decision_tree
 }  // namespace model
@@ -513,10 +513,17 @@ TrainWithCache(
   Evaluation training_evaluation;
   auto time_last_checkpoint = absl::Now();
 
+  // Result of the "StartNewIter" stage of the next iteration if this stage was
+  // pipelined with the "EndIter" stage of the current iteration.
+  absl::optional<std::vector<decision_tree::proto::LabelStatistics>>
+      next_iter_label_statistics;
+
   YDF_LOG(INFO) << "Start training";
   for (; iter_idx < spe_config.gbt().num_trees(); iter_idx++) {
-    // Create a checkpoint.
-    if (iter_idx >= minimum_iter_for_new_checkpoint &&
+    // Create a checkpoint. The workers cannot create a checkpoint once the next
+    // iteration is started.
+    if (!next_iter_label_statistics.has_value() &&
+        iter_idx >= minimum_iter_for_new_checkpoint &&
         ShouldCreateCheckpoint(iter_idx, time_last_checkpoint, spe_config) &&
         (!last_checkpoint_idx.ok() || iter_idx > last_checkpoint_idx.value())) {
       time_last_checkpoint = absl::Now();
@@ -527,11 +534,18 @@ TrainWithCache(
                                        &load_balancer, &validation_aggregator));
     }
 
+    // Only start the next iteration in advance if no checkpoint is expected
+    // before it.
+    const bool start_next_iter =
+        spe_config.pipeline_stages() &&
+        !ShouldCreateCheckpoint(iter_idx + 1, time_last_checkpoint, spe_config);
+
     const auto iter_status = RunIteration(
         iter_idx, config_link, spe_config, weak_learner_train_config,
         set_leaf_functor, &load_balancer, data_spec, metric_names,
         input_features, log_directory, model.get(), &training_evaluation,
-        distribute_manager.get(), &random, monitoring, &validation_aggregator);
+        distribute_manager.get(), &random, monitoring, &validation_aggregator,
+        start_next_iter, &next_iter_label_statistics);
     if (!iter_status.ok()) {
       YDF_LOG(WARNING) << "Iteration issue: " << iter_status.message();
     }
@@ -539,6 +553,7 @@ TrainWithCache(
     if (absl::IsDataLoss(iter_status)) {
       // A worker was restarted and is missing data.
       YDF_LOG(WARNING) << "Re-synchronizing the workers";
+      next_iter_label_statistics.reset();
 
       auto resync_iter_idx_status =
           utils::GetGreatestSnapshot(SnapshotDirectory(work_directory));
@@ -676,11 +691,23 @@ absl::Status RunIteration(
     Evaluation* training_evaluation,
     distribute::AbstractManager* distribute_manager, utils::RandomEngine* rnd,
     internal::Monitoring* monitoring,
-    PartialEvaluationAggregator* validation_aggregator) {
+    PartialEvaluationAggregator* validation_aggregator,
+    const bool start_next_iter,
+    absl::optional<std::vector<decision_tree::proto::LabelStatistics>>*
+        next_iter_label_statistics) {
   monitoring->NewIter();
-  ASSIGN_OR_RETURN(const auto weak_learner_label_statistics,
-                   EmitStartNewIter(iter_idx, (*rnd)(), distribute_manager,
-                                    monitoring, load_balancer));
+  std::vector<decision_tree::proto::LabelStatistics>
+      weak_learner_label_statistics;
+  if (next_iter_label_statistics->has_value()) {
+    // The workers already started this iteration.
+    weak_learner_label_statistics =
+        std::move(next_iter_label_statistics->value());
+    next_iter_label_statistics->reset();
+  } else {
+    ASSIGN_OR_RETURN(weak_learner_label_statistics,
+                     EmitStartNewIter(iter_idx, (*rnd)(), distribute_manager,
+                                      monitoring, load_balancer));
+  }
 
   WeakModels weak_models(model->num_trees_per_iter());
   for (int weak_model_idx = 0; weak_model_idx < weak_models.size();
@@ -728,23 +755,42 @@ absl::Status RunIteration(
               .status());
     }
 
-    // Request for the workers to evaluate the splits.
-    RETURN_IF_ERROR(EmitEvaluateSplits(splits_per_weak_models,
-                                       distribute_manager, rnd, monitoring,
-                                       load_balancer));
-
-    // Request for the workers to share the evaluation results,
-    // update the tree structures, example->node mapping and label
-    // statistics
-    RETURN_IF_ERROR(EmitShareSplits(splits_per_weak_models, distribute_manager,
-                                    monitoring, load_balancer));
+    if (spe_config.pipeline_stages()) {
+      // Request for the workers to evaluate and share the splits as soon as
+      // possible.
+      RETURN_IF_ERROR(EmitEvaluateAndShareSplits(
+          splits_per_weak_models, distribute_manager, monitoring,
+          load_balancer));
+    } else {
+      // Request for the workers to evaluate the splits.
+      RETURN_IF_ERROR(EmitEvaluateSplits(splits_per_weak_models,
+                                         distribute_manager, rnd, monitoring,
+                                         load_balancer));
+
+      // Request for the workers to share the evaluation results,
+      // update the tree structures, example->node mapping and label
+      // statistics
+      RETURN_IF_ERROR(EmitShareSplits(splits_per_weak_models,
+                                      distribute_manager, monitoring,
+                                      load_balancer));
+    }
   }
 
   const bool is_last_iteration = iter_idx == spe_config.gbt().num_trees() - 1;
 
-  RETURN_IF_ERROR(EmitEndIter(
-      iter_idx, is_last_iteration, weak_models, distribute_manager,
-      training_evaluation, monitoring, load_balancer, validation_aggregator));
+  absl::optional<proto::WorkerRequest::StartNewIter> next_iter;
+  std::vector<decision_tree::proto::LabelStatistics> next_label_statistics;
+  if (start_next_iter && !is_last_iteration) {
+    next_iter = CreateStartNewIterRequest(iter_idx + 1, (*rnd)());
+  }
+
+  RETURN_IF_ERROR(EmitEndIter(iter_idx, is_last_iteration, weak_models,
+                              distribute_manager, training_evaluation,
+                              monitoring, load_balancer, validation_aggregator,
+                              next_iter, &next_label_statistics));
+  if (next_iter.has_value()) {
+    *next_iter_label_statistics = std::move(next_label_statistics);
+  }
 
   // Move the new trees in the model.
   for (int weak_model_idx = 0; weak_model_idx < weak_models.size();
@@ -789,6 +835,7 @@ absl::Status RunIteration(
       training_evaluation->metrics.begin(), training_evaluation->metrics.end()};
   log_entry->mutable_validation_secondary_metrics()->Resize(
       model->training_logs().secondary_metric_names_size(), 0);
+  monitoring->ExportIterStageDurations(log_entry);
 
   if (validation_aggregator->Active() && is_last_iteration) {
     // In the last iteration, the last validation is done synchronously.
@@ -1036,6 +1083,15 @@ absl::Status EmitSetInitialPredictions(
   return absl::OkStatus();
 }
 
+proto::WorkerRequest::StartNewIter CreateStartNewIterRequest(
+    const int iter_idx, const utils::RandomEngine::result_type seed) {
+  proto::WorkerRequest::StartNewIter request;
+  request.set_iter_idx(iter_idx);
+  request.set_iter_uid(utils::GenUniqueId());
+  request.set_seed(seed);
+  return request;
+}
+
 absl::StatusOr<std::vector<decision_tree::proto::LabelStatistics>>
 EmitStartNewIter(const int iter_idx,
                  const utils::RandomEngine::result_type seed,
@@ -1046,10 +1102,8 @@ EmitStartNewIter(const int iter_idx,
   std::vector<decision_tree::proto::LabelStatistics> root_label_statistics;
 
   proto::WorkerRequest generic_request;
-  auto& request = *generic_request.mutable_start_new_iter();
-  request.set_iter_idx(iter_idx);
-  request.set_iter_uid(utils::GenUniqueId());
-  request.set_seed(seed);
+  *generic_request.mutable_start_new_iter() =
+      CreateStartNewIterRequest(iter_idx, seed);
 
   // TODO: Implement multicast operations.
   for (int worker_idx = 0; worker_idx < load_balancer->NumWorkers();
@@ -1070,6 +1124,8 @@ EmitStartNewIter(const int iter_idx,
           load_balancer->NumWorkers() - reply_idx - 1, distribute));
       return absl::DataLossError("");
     }
+    monitoring->WorkerRuntime(generic_result.worker_idx(),
+                              generic_result.runtime_seconds());
     if (!generic_result.has_start_new_iter()) {
       return absl::InternalError("Unexpected answer. Expecting StartNewIter.");
     }
@@ -1161,6 +1217,8 @@ EmitFindSplits(
     }
     monitoring->FindSplitWorkerReplyTime(generic_result.worker_idx(),
                                          absl::Now() - begin);
+    monitoring->WorkerRuntime(generic_result.worker_idx(),
+                              generic_result.runtime_seconds());
 
     runtime_per_workers[generic_result.worker_idx()].time =
         generic_result.runtime_seconds();
@@ -1236,6 +1294,8 @@ absl::Status EmitEvaluateSplits(
           load_balancer->NumWorkers() - reply_idx - 1, distribute));
       return absl::DataLossError("");
     }
+    monitoring->WorkerRuntime(generic_result.worker_idx(),
+                              generic_result.runtime_seconds());
     if (!generic_result.has_evaluate_splits()) {
       return absl::InternalError("Unexpected answer. Expecting EvaluateSplits");
     }
@@ -1245,13 +1305,11 @@ absl::Status EmitEvaluateSplits(
   return absl::OkStatus();
 }
 
-absl::Status EmitShareSplits(
+absl::StatusOr<distributed_decision_tree::proto::SplitSharingPlan>
+CreateSplitSharingPlan(
     const std::vector<distributed_decision_tree::SplitPerOpenNode>&
         splits_per_weak_models,
-    distribute::AbstractManager* distribute, internal::Monitoring* monitoring,
     distributed_decision_tree::LoadBalancer* load_balancer) {
-  monitoring->BeginStage(internal::Monitoring::kShareSplits);
-
   ASSIGN_OR_RETURN(const auto active_features,
                    ActiveFeatures(splits_per_weak_models));
 
@@ -1265,6 +1323,19 @@ absl::Status EmitShareSplits(
                    load_balancer->MakeSplitSharingPlan(active_feature_idxs));
 
   RETURN_IF_ERROR(SetSplitsInPlan(active_features, &plan));
+  return plan;
+}
+
+absl::Status EmitShareSplits(
+    const std::vector<distributed_decision_tree::SplitPerOpenNode>&
+        splits_per_weak_models,
+    distribute::AbstractManager* distribute, internal::Monitoring* monitoring,
+    distributed_decision_tree::LoadBalancer* load_balancer) {
+  monitoring->BeginStage(internal::Monitoring::kShareSplits);
+
+  ASSIGN_OR_RETURN(
+      const auto plan,
+      CreateSplitSharingPlan(splits_per_weak_models, load_balancer));
 
   for (const auto& round : plan.rounds()) {
     // Send requests.
@@ -1288,6 +1359,8 @@ absl::Status EmitShareSplits(
         return absl::DataLossError(
             "Worker requested to restart the iteration.");
       }
+      monitoring->WorkerRuntime(generic_result.worker_idx(),
+                                generic_result.runtime_seconds());
       if (!generic_result.has_share_splits()) {
         return absl::InternalError("Unexpected answer. Expecting ShareSplits");
       }
@@ -1298,19 +1371,148 @@ absl::Status EmitShareSplits(
   return absl::OkStatus();
 }
 
-absl::Status EmitEndIter(int iter_idx, bool is_last_iteration,
-                         const WeakModels& weak_models,
-                         distribute::AbstractManager* distribute,
-                         absl::optional<Evaluation*> training_evaluation,
-                         internal::Monitoring* monitoring,
-                         distributed_decision_tree::LoadBalancer* load_balancer,
-                         PartialEvaluationAggregator* validation_aggregator) {
+absl::Status EmitEvaluateAndShareSplits(
+    const std::vector<distributed_decision_tree::SplitPerOpenNode>&
+        splits_per_weak_models,
+    distribute::AbstractManager* distribute, internal::Monitoring* monitoring,
+    distributed_decision_tree::LoadBalancer* load_balancer) {
+  monitoring->BeginStage(internal::Monitoring::kEvaluateAndShareSplits);
+
+  ASSIGN_OR_RETURN(
+      const auto plan,
+      CreateSplitSharingPlan(splits_per_weak_models, load_balancer));
+  const int num_workers = load_balancer->NumWorkers();
+  const int num_rounds = plan.rounds_size();
+
+  // Number of phases completed by each worker. The first phase is the
+  // evaluation of the splits. The following phases are the rounds of the
+  // sharing plan. A worker without request in a round completes this round as
+  // soon as it completes the previous phase.
+  std::vector<int> num_completed_phases(num_workers, 0);
+  const auto complete_phase = [&](const int worker_idx) -> absl::Status {
+    if (worker_idx < 0 || worker_idx >= num_workers) {
+      return absl::InternalError("Unexpected worker index");
+    }
+    int& num_completed = num_completed_phases[worker_idx];
+    num_completed++;
+    while (num_completed <= num_rounds &&
+           plan.rounds(num_completed - 1).requests().count(worker_idx) == 0) {
+      num_completed++;
+    }
+    return absl::OkStatus();
+  };
+
+  // Tests if the request of the worker "dst_worker" in the round "round_idx"
+  // can be sent.
+  const auto is_ready =
+      [&](const int round_idx, const int dst_worker,
+          const distributed_decision_tree::proto::SplitSharingPlan::Request&
+              request) {
+        if (num_completed_phases[dst_worker] <= round_idx) {
+          return false;
+        }
+        for (const auto& item : request.items()) {
+          if (num_completed_phases[item.src_worker()] <= round_idx) {
+            return false;
+          }
+        }
+        return true;
+      };
+
+  // Number of pending requests.
+  int num_pending_requests = 0;
+
+  // Send the split evaluation requests.
+  {
+    proto::WorkerRequest generic_request;
+    auto& request = *generic_request.mutable_evaluate_splits();
+    for (const auto& splits : splits_per_weak_models) {
+      distributed_decision_tree::ConvertToProto(
+          splits, request.add_split_per_weak_model());
+    }
+    for (int worker_idx = 0; worker_idx < num_workers; worker_idx++) {
+      RETURN_IF_ERROR(
+          distribute->AsynchronousProtoRequest(generic_request, worker_idx));
+      num_pending_requests++;
+    }
+  }
+
+  // Whether each of the sharing requests was sent. Indexed by round and
+  // destination worker.
+  std::vector<std::vector<bool>> sent(num_rounds,
+                                      std::vector<bool>(num_workers, false));
+
+  while (num_pending_requests > 0) {
+    ASSIGN_OR_RETURN(
+        const auto generic_result,
+        distribute->NextAsynchronousProtoAnswer<proto::WorkerResult>());
+    num_pending_requests--;
+    if (generic_result.request_restart_iter()) {
+      RETURN_IF_ERROR(SkipAsyncAnswers(num_pending_requests, distribute));
+      return absl::DataLossError("Worker requested to restart the iteration.");
+    }
+    monitoring->WorkerRuntime(generic_result.worker_idx(),
+                              generic_result.runtime_seconds());
+    if (!generic_result.has_evaluate_splits() &&
+        !generic_result.has_share_splits()) {
+      RETURN_IF_ERROR(SkipAsyncAnswers(num_pending_requests, distribute));
+      return absl::InternalError(
+          "Unexpected answer. Expecting EvaluateSplits or ShareSplits");
+    }
+    RETURN_IF_ERROR(complete_phase(generic_result.worker_idx()));
+
+    // Send the sharing requests that became ready.
+    for (int round_idx = 0; round_idx < num_rounds; round_idx++) {
+      for (const auto& request : plan.rounds(round_idx).requests()) {
+        if (sent[round_idx][request.first] ||
+            !is_ready(round_idx, request.first, request.second)) {
+          continue;
+        }
+        proto::WorkerRequest generic_request;
+        *generic_request.mutable_share_splits()->mutable_request() =
+            request.second;
+        RETURN_IF_ERROR(distribute->AsynchronousProtoRequest(generic_request,
+                                                             request.first));
+        sent[round_idx][request.first] = true;
+        num_pending_requests++;
+      }
+    }
+  }
+
+  for (int worker_idx = 0; worker_idx < num_workers; worker_idx++) {
+    if (num_completed_phases[worker_idx] != num_rounds + 1) {
+      return absl::InternalError("Split sharing plan not completed");
+    }
+  }
+
+  monitoring->EndStage(internal::Monitoring::kEvaluateAndShareSplits);
+  return absl::OkStatus();
+}
+
+absl::Status EmitEndIter(
+    int iter_idx, bool is_last_iteration, const WeakModels& weak_models,
+    distribute::AbstractManager* distribute,
+    absl::optional<Evaluation*> training_evaluation,
+    internal::Monitoring* monitoring,
+    distributed_decision_tree::LoadBalancer* load_balancer,
+    PartialEvaluationAggregator* validation_aggregator,
+    const absl::optional<proto::WorkerRequest::StartNewIter>& next_iter,
+    std::vector<decision_tree::proto::LabelStatistics>*
+        next_iter_label_statistics) {
   monitoring->BeginStage(internal::Monitoring::kEndIter);
 
   // Request for the trainer workers.
   proto::WorkerRequest generic_trainer_request;
   auto& trainer_request = *generic_trainer_request.mutable_end_iter();
   trainer_request.set_iter_idx(iter_idx);
+  if (next_iter.has_value()) {
+    if (next_iter_label_statistics == nullptr) {
+      return absl::InvalidArgumentError(
+          "next_iter_label_statistics required with next_iter");
+    }
+    next_iter_label_statistics->clear();
+    *trainer_request.mutable_next_iter() = next_iter.value();
+  }
 
   // Request for the evaluation workers.
   proto::WorkerRequest generic_evaluator_request;
@@ -1341,6 +1543,8 @@ absl::Status EmitEndIter(int iter_idx, bool is_last_iteration,
   }
 
   // TODO: No need for an answer.
+  int64_t split_evaluation_sent_bytes = 0;
+  int64_t split_evaluation_raw_bytes = 0;
   for (int reply_idx = 0; reply_idx < distribute->NumWorkers(); reply_idx++) {
     ASSIGN_OR_RETURN(
         const auto generic_result,
@@ -1350,11 +1554,20 @@ absl::Status EmitEndIter(int iter_idx, bool is_last_iteration,
                                        distribute));
       return absl::DataLossError("");
     }
+    monitoring->WorkerRuntime(generic_result.worker_idx(),
+                              generic_result.runtime_seconds());
     if (!generic_result.has_end_iter()) {
       return absl::InternalError("Unexpected answer. Expecting EndIter");
     }
 
     const auto& result = generic_result.end_iter();
+    if (next_iter.has_value() && result.has_next_iter() &&
+        next_iter_label_statistics->empty()) {
+      // Label statistics of the next iteration.
+      const auto& label_statistics = result.next_iter().label_statistics();
+      *next_iter_label_statistics = {label_statistics.begin(),
+                                     label_statistics.end()};
+    }
     if (result.has_training()) {
       // Get the training loss value.
       if (!training_evaluation.has_value()) {
@@ -1371,6 +1584,16 @@ absl::Status EmitEndIter(int iter_idx, bool is_last_iteration,
       // Get the validation evaluation of the previous or current iteration.
       RETURN_IF_ERROR(validation_aggregator->AddPartial(validation));
     }
+
+    split_evaluation_sent_bytes += result.split_evaluation_sent_bytes();
+    split_evaluation_raw_bytes += result.split_evaluation_raw_bytes();
+  }
+  monitoring->SplitEvaluationBytes(split_evaluation_sent_bytes,
+                                   split_evaluation_raw_bytes);
+
+  if (next_iter.has_value() && next_iter_label_statistics->empty()) {
+    return absl::InternalError(
+        "Missing label statistics of the next iteration");
   }
 
   monitoring->EndStage(internal::Monitoring::kEndIter);
@@ -1773,6 +1996,7 @@ void Monitoring::BeginStage(Monitoring::Stages stage) {
   }
   current_stage_ = stage;
   begin_current_stage_ = absl::Now();
+  current_stage_worker_durations_.clear();
 
   if (verbose_) {
     YDF_LOG(INFO) << "Starting stage " << StageName(stage);
@@ -1786,8 +2010,28 @@ void Monitoring::EndStage(Monitoring::Stages stage) {
     return;
   }
   const auto duration_current_stage = absl::Now() - begin_current_stage_;
-  stage_stats_[stage].count++;
-  stage_stats_[stage].sum_duration += duration_current_stage;
+
+  // Computation time of the slowest and of the average worker.
+  absl::Duration max_worker_duration;
+  absl::Duration mean_worker_duration;
+  int num_workers = 0;
+  for (const auto worker_duration : current_stage_worker_durations_) {
+    if (worker_duration > absl::ZeroDuration()) {
+      max_worker_duration = std::max(max_worker_duration, worker_duration);
+      mean_worker_duration += worker_duration;
+      num_workers++;
+    }
+  }
+  if (num_workers > 0) {
+    mean_worker_duration /= num_workers;
+  }
+
+  for (auto* stats : {&stage_stats_[stage], &iter_stage_stats_[stage]}) {
+    stats->count++;
+    stats->sum_duration += duration_current_stage;
+    stats->sum_max_worker_duration += max_worker_duration;
+    stats->sum_mean_worker_duration += mean_worker_duration;
+  }
 
   if (stage == kFindSplits && !last_min_split_reply_times_.empty()) {
     std::sort(last_min_split_reply_times_.begin(),
@@ -1820,6 +2064,9 @@ void Monitoring::EndStage(Monitoring::Stages stage) {
 }
 
 void Monitoring::NewIter() {
+  for (auto& stats : iter_stage_stats_) {
+    stats = StageStats();
+  }
   begin_current_iter_ = absl::Now();
   if (num_iters_ == 0) {
     time_first_iter_ = begin_current_iter_;
@@ -1836,6 +2083,45 @@ void Monitoring::FindSplitWorkerReplyTime(int worker_idx,
   last_min_split_reply_times_.push_back({worker_idx, delay});
 }
 
+void Monitoring::SplitEvaluationBytes(const int64_t sent_bytes,
+                                      const int64_t raw_bytes) {
+  last_split_evaluation_sent_bytes_ = sent_bytes;
+  last_split_evaluation_raw_bytes_ = raw_bytes;
+  sum_split_evaluation_sent_bytes_ += sent_bytes;
+  sum_split_evaluation_raw_bytes_ += raw_bytes;
+  count_split_evaluation_bytes_++;
+}
+
+void Monitoring::WorkerRuntime(const int worker_idx,
+                               const double runtime_seconds) {
+  if (worker_idx < 0) {
+    return;
+  }
+  if (worker_idx >= static_cast<int>(current_stage_worker_durations_.size())) {
+    current_stage_worker_durations_.resize(worker_idx + 1);
+  }
+  current_stage_worker_durations_[worker_idx] += absl::Seconds(runtime_seconds);
+}
+
+void Monitoring::ExportIterStageDurations(
+    gradient_boosted_trees::proto::TrainingLogs::Entry* entry) {
+  for (int stage_idx = 0; stage_idx < kNumStages; stage_idx++) {
+    const auto& stats = iter_stage_stats_[stage_idx];
+    if (stats.count == 0) {
+      continue;
+    }
+    auto* stage_duration = entry->add_stage_durations();
+    stage_duration->set_stage(
+        std::string(StageName(static_cast<Stages>(stage_idx))));
+    stage_duration->set_critical_path_seconds(
+        absl::ToDoubleSeconds(stats.sum_duration));
+    stage_duration->set_max_worker_seconds(
+        absl::ToDoubleSeconds(stats.sum_max_worker_duration));
+    stage_duration->set_mean_worker_seconds(
+        absl::ToDoubleSeconds(stats.sum_mean_worker_duration));
+  }
+}
+
 absl::string_view Monitoring::StageName(Monitoring::Stages stage) {
   switch (stage) {
     case Monitoring::kGetLabelStatistics:
@@ -1858,6 +2144,8 @@ absl::string_view Monitoring::StageName(Monitoring::Stages stage) {
       return "CreateCheckpoint";
     case Monitoring::kStartTraining:
       return "StartTraining";
+    case Monitoring::kEvaluateAndShareSplits:
+      return "EvaluateAndShareSplits";
     case Monitoring::kNumStages:
       return "NumStages";
   }
@@ -1888,6 +2176,16 @@ std::string Monitoring::InlineLogs() {
         FormatDuration(sum_max_split_reply_time_ / count_reply_times_));
   }
 
+  if (count_split_evaluation_bytes_ > 0) {
+    absl::SubstituteAndAppend(
+        &logs,
+        " last-split-sharing-{sent,raw}-bytes:$0 $1"
+        " mean-split-sharing-{sent,raw}-bytes:$2 $3",
+        last_split_evaluation_sent_bytes_, last_split_evaluation_raw_bytes_,
+        sum_split_evaluation_sent_bytes_ / count_split_evaluation_bytes_,
+        sum_split_evaluation_raw_bytes_ / count_split_evaluation_bytes_);
+  }
+
   for (int stage_idx = 0; stage_idx < kNumStages; stage_idx++) {
     const auto& stage_stat = stage_stats_[stage_idx];
     if (stage_stat.count > 0) {
@@ -1896,6 +2194,14 @@ std::string Monitoring::InlineLogs() {
           Monitoring::StageName(static_cast<Stages>(stage_idx)),
           FormatDuration(stage_stat.sum_duration / stage_stat.count),
           stage_stat.count);
+      if (stage_stat.sum_max_worker_duration > absl::ZeroDuration()) {
+        absl::SubstituteAndAppend(
+            &logs, " avg-{max,mean}-worker:$0 $1",
+            FormatDuration(stage_stat.sum_max_worker_duration /
+                           stage_stat.count),
+            FormatDuration(stage_stat.sum_mean_worker_duration /
+                           stage_stat.count));
+      }
     }
   }
 
@@ -36,11 +36,16 @@
 //   - The workers are divided into training and evaluation workers. The first
 //     worker indices are used for training workers while the last indices are
 //     used for evaluation workers.
+//   - With "pipeline_stages", the stages of an iteration are not separated by
+//     barriers when the data dependencies allow it (see
+//     "EmitEvaluateAndShareSplits" and "EmitEndIter").
 //
 #ifndef YGGDRASIL_DECISION_FORESTS_LEARNER_DISTRIBUTED_GRADIENT_BOOSTED_TREES_DISTRIBUTED_GRADIENT_BOOSTED_TREES_H_
 #define YGGDRASIL_DECISION_FORESTS_LEARNER_DISTRIBUTED_GRADIENT_BOOSTED_TREES_DISTRIBUTED_GRADIENT_BOOSTED_TREES_H_
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
@@ -144,6 +149,8 @@ class Monitoring {
     kRestoreCheckpoint,
     kCreateCheckpoint,
     kStartTraining,
+    // EvaluateSplits and ShareSplits stages pipelined together.
+    kEvaluateAndShareSplits,
     kNumStages
   };
 
@@ -155,6 +162,15 @@ class Monitoring {
   void EndStage(Stages stage);
   void NewIter();
   void FindSplitWorkerReplyTime(int worker_idx, absl::Duration delay);
+  // Number of bytes of split evaluations exchanged in between the workers
+  // during the last iteration, and the corresponding number of bytes of raw
+  // bitmaps.
+  void SplitEvaluationBytes(int64_t sent_bytes, int64_t raw_bytes);
+  // Self reported computation time of a worker in the current stage.
+  void WorkerRuntime(int worker_idx, double runtime_seconds);
+  // Exports the duration of the stages of the current iteration.
+  void ExportIterStageDurations(
+      gradient_boosted_trees::proto::TrainingLogs::Entry* entry);
   absl::string_view StageName(Stages stage);
 
  private:
@@ -185,14 +201,31 @@ class Monitoring {
   absl::Duration sum_max_split_reply_time_;
   int count_reply_times_ = 0;
 
+  int64_t last_split_evaluation_sent_bytes_ = 0;
+  int64_t last_split_evaluation_raw_bytes_ = 0;
+  int64_t sum_split_evaluation_sent_bytes_ = 0;
+  int64_t sum_split_evaluation_raw_bytes_ = 0;
+  int count_split_evaluation_bytes_ = 0;
+
   struct StageStats {
     absl::Duration sum_duration;
+    // Sum of the computation time of the slowest worker, and of the average
+    // computation time of the workers.
+    absl::Duration sum_max_worker_duration;
+    absl::Duration sum_mean_worker_duration;
     size_t count{0};
   };
 
   // Statistics for each of the stages.
   StageStats stage_stats_[kNumStages];
 
+  // Statistics for each of the stages in the current iteration.
+  StageStats iter_stage_stats_[kNumStages];
+
+  // Computation time of each worker in the current stage. Zero if the worker
+  // did not reply.
+  std::vector<absl::Duration> current_stage_worker_durations_;
+
   // Number of ran iterations so far.
   int num_iters_ = 0;
 
@@ -283,6 +316,13 @@ TrainWithCache(
     const absl::string_view& log_directory, internal::Monitoring* monitoring);
 
 // Run a single iteration of training.
+//
+// If "next_iter_label_statistics" is set, the "StartNewIter" stage of this
+// iteration was already executed (during the "EndIter" stage of the previous
+// iteration) and "next_iter_label_statistics" contains its result. If
+// "start_next_iter" is true, the "StartNewIter" stage of the next iteration is
+// executed during the "EndIter" stage of this iteration, and its result is
+// stored in "next_iter_label_statistics".
 absl::Status RunIteration(
     int iter_idx, const model::proto::TrainingConfigLinking& config_link,
     const proto::DistributedGradientBoostedTreesTrainingConfig& spe_config,
@@ -296,7 +336,9 @@ absl::Status RunIteration(
     Evaluation* training_evaluation,
     distribute::AbstractManager* distribute_manager, utils::RandomEngine* rnd,
     internal::Monitoring* monitoring,
-    PartialEvaluationAggregator* validation_aggregator);
+    PartialEvaluationAggregator* validation_aggregator, bool start_next_iter,
+    absl::optional<std::vector<decision_tree::proto::LabelStatistics>>*
+        next_iter_label_statistics);
 
 // Skips the next "num_skip" asynchronous answers from the manager.
 absl::Status SkipAsyncAnswers(int num_skip,
@@ -362,6 +404,10 @@ absl::Status EmitSetInitialPredictions(
     distribute::AbstractManager* distribute, internal::Monitoring* monitoring,
     distributed_decision_tree::LoadBalancer* load_balancer);
 
+// Creates the request of the "StartNewIter" stage.
+proto::WorkerRequest::StartNewIter CreateStartNewIterRequest(
+    int iter_idx, utils::RandomEngine::result_type seed);
+
 absl::StatusOr<std::vector<decision_tree::proto::LabelStatistics>>
 EmitStartNewIter(int iter_idx, utils::RandomEngine::result_type seed,
                  distribute::AbstractManager* distribute,
@@ -384,19 +430,43 @@ absl::Status EmitEvaluateSplits(
     internal::Monitoring* monitoring,
     distributed_decision_tree::LoadBalancer* load_balancer);
 
+// Computes the plan to share the split evaluations in between the workers.
+absl::StatusOr<distributed_decision_tree::proto::SplitSharingPlan>
+CreateSplitSharingPlan(
+    const std::vector<distributed_decision_tree::SplitPerOpenNode>&
+        splits_per_weak_models,
+    distributed_decision_tree::LoadBalancer* load_balancer);
+
 absl::Status EmitShareSplits(
     const std::vector<distributed_decision_tree::SplitPerOpenNode>&
         splits_per_weak_models,
     distribute::AbstractManager* distribute, internal::Monitoring* monitoring,
     distributed_decision_tree::LoadBalancer* load_balancer);
 
-absl::Status EmitEndIter(int iter_idx, bool is_last_iteration,
-                         const WeakModels& weak_models,
-                         distribute::AbstractManager* distribute,
-                         absl::optional<Evaluation*> training_evaluation,
-                         internal::Monitoring* monitoring,
-                         distributed_decision_tree::LoadBalancer* load_balancer,
-                         PartialEvaluationAggregator* validation_aggregator);
+// Equivalent to "EmitEvaluateSplits" followed by "EmitShareSplits", except
+// that the "ShareSplits" requests are sent as soon as their dependencies are
+// satisfied instead of after the slowest worker: A request of the i-th round
+// of the sharing plan is sent when its destination worker and all its source
+// workers have evaluated the splits and completed the previous rounds.
+absl::Status EmitEvaluateAndShareSplits(
+    const std::vector<distributed_decision_tree::SplitPerOpenNode>&
+        splits_per_weak_models,
+    distribute::AbstractManager* distribute, internal::Monitoring* monitoring,
+    distributed_decision_tree::LoadBalancer* load_balancer);
+
+// If "next_iter" is set, the training workers also run the "StartNewIter"
+// stage of the next iteration, and its result is stored in
+// "next_iter_label_statistics".
+absl::Status EmitEndIter(
+    int iter_idx, bool is_last_iteration, const WeakModels& weak_models,
+    distribute::AbstractManager* distribute,
+    absl::optional<Evaluation*> training_evaluation,
+    internal::Monitoring* monitoring,
+    distributed_decision_tree::LoadBalancer* load_balancer,
+    PartialEvaluationAggregator* validation_aggregator,
+    const absl::optional<proto::WorkerRequest::StartNewIter>& next_iter = {},
+    std::vector<decision_tree::proto::LabelStatistics>*
+        next_iter_label_statistics = nullptr);
 
 absl::Status EmitRestoreCheckpoint(
     int iter_idx, int num_shards, int num_weak_models,
@@ -19,6 +19,7 @@
 #include <string>
 
 #include "gmock/gmock.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/debugging/leak_check.h"
 #include "absl/strings/str_format.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.h"
@@ -26,6 +27,7 @@
 #include "yggdrasil_decision_forests/learner/distributed_gradient_boosted_trees/common.h"
 #include "yggdrasil_decision_forests/learner/learner_library.h"
 #include "yggdrasil_decision_forests/metric/metric.h"
+#include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
 #include "yggdrasil_decision_forests/utils/concurrency.h"
 #include "yggdrasil_decision_forests/utils/csv.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
@@ -283,6 +285,86 @@ TEST_F(DatasetAdult, ContinuousRebalancing) {
   EXPECT_NEAR(metric::LogLoss(evaluation_), 0.2765, 0.04);
 }
 
+// Out-of-core training on a single machine: Only part of the features fit in
+// the memory budget of the workers. The other features are read from disk.
+TEST_F(DatasetAdult, MemoryBudget) {
+  SetNumWorkers(2);
+  auto* spe_config = train_config_.MutableExtension(
+      distributed_gradient_boosted_trees::proto::
+          distributed_gradient_boosted_trees_config);
+  spe_config->mutable_dataset_reader_options()->set_max_in_memory_bytes(
+      100000);
+  TrainAndEvaluateModel();
+  // Note: This result does not take early stopping into account.
+  EXPECT_NEAR(metric::Accuracy(evaluation_), 0.8748, 0.01);
+  EXPECT_NEAR(metric::LogLoss(evaluation_), 0.2765, 0.04);
+}
+
+// The stages are separated by barriers on all the workers.
+TEST_F(DatasetAdult, WithoutPipelining) {
+  auto* spe_config = train_config_.MutableExtension(
+      distributed_gradient_boosted_trees::proto::
+          distributed_gradient_boosted_trees_config);
+  spe_config->set_pipeline_stages(false);
+  TrainAndEvaluateModel();
+  // Note: This result does not take early stopping into account.
+  EXPECT_NEAR(metric::Accuracy(evaluation_), 0.8748, 0.01);
+  EXPECT_NEAR(metric::LogLoss(evaluation_), 0.2765, 0.04);
+
+  const auto* gbt_model =
+      dynamic_cast<const gradient_boosted_trees::GradientBoostedTreesModel*>(
+          model_.get());
+  ASSERT_NE(gbt_model, nullptr);
+  for (const auto& entry : gbt_model->training_logs().entries()) {
+    absl::flat_hash_set<std::string> stages;
+    for (const auto& stage_duration : entry.stage_durations()) {
+      stages.insert(stage_duration.stage());
+    }
+    EXPECT_TRUE(stages.contains("StartNewIter"));
+    EXPECT_TRUE(stages.contains("EndIter"));
+    EXPECT_FALSE(stages.contains("EvaluateAndShareSplits"));
+  }
+}
+
+// The stage durations of the pipelined training are recorded in the training
+// logs.
+TEST_F(DatasetAdult, PipelinedStageDurations) {
+  SetNumWorkers(2);
+  TrainAndEvaluateModel();
+  // Note: This result does not take early stopping into account.
+  EXPECT_NEAR(metric::Accuracy(evaluation_), 0.8748, 0.01);
+  EXPECT_NEAR(metric::LogLoss(evaluation_), 0.2765, 0.04);
+
+  const auto* gbt_model =
+      dynamic_cast<const gradient_boosted_trees::GradientBoostedTreesModel*>(
+          model_.get());
+  ASSERT_NE(gbt_model, nullptr);
+  const auto& entries = gbt_model->training_logs().entries();
+  ASSERT_FALSE(entries.empty());
+  int num_entries_with_start_new_iter = 0;
+  for (const auto& entry : entries) {
+    bool has_end_iter = false;
+    for (const auto& stage_duration : entry.stage_durations()) {
+      EXPECT_NE(stage_duration.stage(), "EvaluateSplits");
+      EXPECT_NE(stage_duration.stage(), "ShareSplits");
+      EXPECT_GE(stage_duration.critical_path_seconds(),
+                stage_duration.max_worker_seconds());
+      EXPECT_GE(stage_duration.max_worker_seconds(),
+                stage_duration.mean_worker_seconds());
+      if (stage_duration.stage() == "StartNewIter") {
+        num_entries_with_start_new_iter++;
+      }
+      if (stage_duration.stage() == "EndIter") {
+        has_end_iter = true;
+      }
+    }
+    EXPECT_TRUE(has_end_iter);
+  }
+  // Except for the first iteration and the iterations following a checkpoint,
+  // the new iterations are started during the "EndIter" stage.
+  EXPECT_LT(num_entries_with_start_new_iter, entries.size() / 10);
+}
+
 class DatasetIris : public utils::TrainAndTestTester {
   void SetUp() override {
     train_config_ = PARSE_TEST_PROTO(R"pb(
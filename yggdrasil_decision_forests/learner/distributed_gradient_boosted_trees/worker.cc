@@ -823,8 +823,13 @@ absl::Status DistributedGradientBoostedTreesWorker::
       if (src_evaluations->Get(split_idx).empty()) {
         continue;
       }
-      weak_models_[weak_model_idx].last_split_evaluation[split_idx] =
-          std::move(*src_evaluations->Mutable(split_idx));
+      auto& dst = weak_models_[weak_model_idx].last_split_evaluation[split_idx];
+      if (src_split_values->encoded()) {
+        RETURN_IF_ERROR(distributed_decision_tree::DecodeSplitEvaluation(
+            src_evaluations->Get(split_idx), &dst));
+      } else {
+        dst = std::move(*src_evaluations->Mutable(split_idx));
+      }
     }
   }
 
@@ -835,11 +840,15 @@ absl::Status DistributedGradientBoostedTreesWorker::ShareSplits(
     const proto::WorkerRequest::ShareSplits& request,
     proto::WorkerResult::ShareSplits* answer,
     proto::WorkerResult* generic_answer) {
+  const auto& spe_config = welcome_.train_config().GetExtension(
+      proto::distributed_gradient_boosted_trees_config);
+
   // Request the split evaluation from other workers.
   for (const auto& items : request.request().items()) {
     proto::WorkerRequest generic_other_request;
-    *generic_other_request.mutable_get_split_value()->mutable_splits() =
-        items.splits();
+    auto* other_request = generic_other_request.mutable_get_split_value();
+    *other_request->mutable_splits() = items.splits();
+    other_request->set_encoding(spe_config.split_evaluation_encoding());
     RETURN_IF_ERROR(AsynchronousProtoRequestToOtherWorker(generic_other_request,
                                                           items.src_worker()));
   }
@@ -938,6 +947,13 @@ absl::Status DistributedGradientBoostedTreesWorker::GetSplitValue(
   }
 
   // Copy the split evaluations.
+  const bool encode =
+      request.has_encoding() &&
+      request.encoding() !=
+          distributed_decision_tree::proto::SplitEvaluationEncoding::RAW_BITMAP;
+  answer->set_encoded(encode);
+  int64_t sent_bytes = 0;
+  int64_t raw_bytes = 0;
   for (const auto& split : request.splits()) {
     const auto& src = weak_models_[split.weak_model_idx()]
                           .last_split_evaluation[split.split_idx()];
@@ -947,8 +963,17 @@ absl::Status DistributedGradientBoostedTreesWorker::GetSplitValue(
     auto& dst =
         *answer->mutable_evaluation_per_weak_model(split.weak_model_idx())
              ->mutable_evaluation_per_open_node(split.split_idx());
-    dst = src;
+    if (encode) {
+      RETURN_IF_ERROR(distributed_decision_tree::EncodeSplitEvaluation(
+          src, request.encoding(), &dst));
+    } else {
+      dst = src;
+    }
+    sent_bytes += dst.size();
+    raw_bytes += src.size();
   }
+  split_evaluation_sent_bytes_ += sent_bytes;
+  split_evaluation_raw_bytes_ += raw_bytes;
 
   return absl::OkStatus();
 }
@@ -990,6 +1015,16 @@ absl::Status DistributedGradientBoostedTreesWorker::EndIterTrainingWorker(
     answer->mutable_training()->set_num_examples(dataset_->num_examples());
   }
 
+  answer->set_split_evaluation_sent_bytes(
+      split_evaluation_sent_bytes_.exchange(0));
+  answer->set_split_evaluation_raw_bytes(
+      split_evaluation_raw_bytes_.exchange(0));
+
+  if (request.has_next_iter()) {
+    // Start the next iteration without waiting for the other workers.
+    RETURN_IF_ERROR(
+        StartNewIter(request.next_iter(), answer->mutable_next_iter()));
+  }
   return absl::OkStatus();
 }
 
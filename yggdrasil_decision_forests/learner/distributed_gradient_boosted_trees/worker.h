@@ -16,6 +16,9 @@
 #ifndef YGGDRASIL_DECISION_FORESTS_LEARNER_DISTRIBUTED_GRADIENT_BOOSTED_TREES_WORKER_H_
 #define YGGDRASIL_DECISION_FORESTS_LEARNER_DISTRIBUTED_GRADIENT_BOOSTED_TREES_WORKER_H_
 
+#include <atomic>
+#include <cstdint>
+
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/learner/distributed_decision_tree/training.h"
 #include "yggdrasil_decision_forests/learner/distributed_gradient_boosted_trees/worker.pb.h"
@@ -300,6 +303,12 @@ class DistributedGradientBoostedTreesWorker
   int num_running_requests_ = 0;
   utils::concurrency::Mutex mutex_num_running_requests_;
 
+  // Number of bytes of split evaluations sent to other workers (with
+  // "GetSplitValue") since the last "EndIter", and corresponding number of
+  // bytes of raw bitmaps.
+  std::atomic<int64_t> split_evaluation_sent_bytes_{0};
+  std::atomic<int64_t> split_evaluation_raw_bytes_{0};
+
   // Time taken to load the features of the dataset in memory.
   absl::Duration dataset_feature_duration_;
   int dataset_num_features_loaded_ = 0;
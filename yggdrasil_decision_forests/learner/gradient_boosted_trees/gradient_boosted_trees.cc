@@ -422,6 +422,12 @@ absl::Status GradientBoostedTreesLearner::CheckConfiguration(
           "Adaptive sub-sampling is not supported for per-shard sampling. "
           "Unset sample_with_shards.");
     }
+    if (gbt_config.decision_tree().numerical_split().type() ==
+        decision_tree::proto::NumericalSplit::HISTOGRAM_BINNED) {
+      return absl::InvalidArgumentError(
+          "The HISTOGRAM_BINNED numerical split is not supported for "
+          "per-shard sampling. Unset sample_with_shards.");
+    }
   }
   if (config.task() == model::proto::CATEGORICAL_UPLIFT ||
       config.task() == model::proto::NUMERICAL_UPLIFT) {
@@ -437,6 +443,13 @@ absl::Status GradientBoostedTreesLearner::CheckConfiguration(
         "use_hessian_gain=false.");
   }
 
+  if (gbt_config.decision_tree().numerical_split().type() ==
+          decision_tree::proto::NumericalSplit::HISTOGRAM_BINNED &&
+      !gbt_config.use_hessian_gain()) {
+    return absl::InvalidArgumentError(
+        "The HISTOGRAM_BINNED numerical split requires use_hessian_gain=true.");
+  }
+
   return absl::OkStatus();
 }
 
@@ -729,6 +742,18 @@ GradientBoostedTreesLearner::ShardedSamplingTrain(
     return dataset;
   };
 
+  // Thread pool used to update the predictions and the gradients in between
+  // the training of the trees. Null if training is single-threaded.
+  std::unique_ptr<utils::concurrency::ThreadPool> update_thread_pool;
+  if (deployment().num_threads() > 1) {
+    update_thread_pool = absl::make_unique<utils::concurrency::ThreadPool>(
+        "UpdatePredictions", deployment().num_threads());
+    update_thread_pool->StartWorkers();
+  }
+
+  // Total time spent updating the predictions and the gradients.
+  absl::Duration update_predictions_and_gradients_duration;
+
   // List of selected examples. Always contains all the training examples.
   std::vector<UnsignedExampleIdx> selected_examples;
 
@@ -801,6 +826,7 @@ GradientBoostedTreesLearner::ShardedSamplingTrain(
         DCHECK_EQ(mdl->NumTrees(),
                   next_train_dataset->predictions_from_num_trees +
                       num_redo_iters * mdl->num_trees_per_iter());
+        const auto begin_update_predictions = absl::Now();
         for (int redo_iter_idx = 0; redo_iter_idx < num_redo_iters;
              redo_iter_idx++) {
           std::vector<const decision_tree::DecisionTree*> last_trees;
@@ -819,10 +845,12 @@ GradientBoostedTreesLearner::ShardedSamplingTrain(
           RETURN_IF_ERROR(UpdatePredictions(
               last_trees, next_train_dataset->gradient_dataset,
               &next_train_dataset->predictions,
-              /*mean_abs_prediction=*/nullptr));
+              /*mean_abs_prediction=*/nullptr, update_thread_pool.get()));
           next_train_dataset->predictions_from_num_trees +=
               mdl->num_trees_per_iter();
         }
+        update_predictions_and_gradients_duration +=
+            absl::Now() - begin_update_predictions;
 
         current_train_dataset = std::move(next_train_dataset);
       }
@@ -872,23 +900,27 @@ GradientBoostedTreesLearner::ShardedSamplingTrain(
                                           current_train_dataset->weights));
       mdl->set_initial_predictions(initial_predictions);
 
-      internal::SetInitialPredictions(mdl->initial_predictions(),
-                                      current_train_dataset->dataset.nrow(),
-                                      &current_train_dataset->predictions);
+      internal::SetInitialPredictions(
+          mdl->initial_predictions(), current_train_dataset->dataset.nrow(),
+          &current_train_dataset->predictions, update_thread_pool.get());
 
       if (has_validation_dataset) {
-        internal::SetInitialPredictions(mdl->initial_predictions(),
-                                        validation->dataset.nrow(),
-                                        &validation->predictions);
+        internal::SetInitialPredictions(
+            mdl->initial_predictions(), validation->dataset.nrow(),
+            &validation->predictions, update_thread_pool.get());
       }
     }
 
     // Compute the gradient.
     // Compute the gradient of the residual relative to the examples.
+    const auto begin_update_gradients = absl::Now();
     RETURN_IF_ERROR(config.loss->UpdateGradients(
         current_train_dataset->gradient_dataset,
         config.train_config_link.label(), current_train_dataset->predictions,
-        nullptr, &current_train_dataset->gradients, &random));
+        nullptr, &current_train_dataset->gradients, &random,
+        update_thread_pool.get()));
+    update_predictions_and_gradients_duration +=
+        absl::Now() - begin_update_gradients;
 
     // Train a tree on the gradient.
     DCHECK_EQ(current_train_dataset->predictions_from_num_trees,
@@ -896,7 +928,8 @@ GradientBoostedTreesLearner::ShardedSamplingTrain(
     std::vector<std::unique_ptr<decision_tree::DecisionTree>> new_trees;
     new_trees.reserve(mdl->num_trees_per_iter());
     for (int grad_idx = 0; grad_idx < mdl->num_trees_per_iter(); grad_idx++) {
-      auto tree = absl::make_unique<decision_tree::DecisionTree>();
+      auto tree = absl::make_unique<decision_tree::DecisionTree>(
+          config.gbt_config->decision_tree().internal().use_node_arena());
 
       const auto internal_config = BuildWeakLearnerInternalConfig(
           config, deployment().num_threads(), grad_idx,
@@ -913,23 +946,26 @@ GradientBoostedTreesLearner::ShardedSamplingTrain(
       new_trees.push_back(std::move(tree));
     }
 
+    const auto begin_update_predictions = absl::Now();
     if (has_validation_dataset) {
       // Update the predictions on the validation dataset.
-      RETURN_IF_ERROR(UpdatePredictions(RemoveUniquePtr(new_trees),
-                                        validation->gradient_dataset,
-                                        &validation->predictions,
-                                        /*mean_abs_prediction=*/nullptr));
+      RETURN_IF_ERROR(UpdatePredictions(
+          RemoveUniquePtr(new_trees), validation->gradient_dataset,
+          &validation->predictions,
+          /*mean_abs_prediction=*/nullptr, update_thread_pool.get()));
       validation->predictions_from_num_trees += new_trees.size();
     }
 
     if (recycle_next) {
       // Update the predictions on the sample because it will be recycled.
-      RETURN_IF_ERROR(UpdatePredictions(RemoveUniquePtr(new_trees),
-                                        current_train_dataset->gradient_dataset,
-                                        &current_train_dataset->predictions,
-                                        /*mean_abs_prediction=*/nullptr));
+      RETURN_IF_ERROR(UpdatePredictions(
+          RemoveUniquePtr(new_trees), current_train_dataset->gradient_dataset,
+          &current_train_dataset->predictions,
+          /*mean_abs_prediction=*/nullptr, update_thread_pool.get()));
       current_train_dataset->predictions_from_num_trees += new_trees.size();
     }
+    update_predictions_and_gradients_duration +=
+        absl::Now() - begin_update_predictions;
 
     // Add the tree to the model.
     for (auto& tree : new_trees) {
@@ -953,6 +989,8 @@ GradientBoostedTreesLearner::ShardedSamplingTrain(
       *log_entry->mutable_training_secondary_metrics() = {
           training_loss_result.secondary_metrics.begin(),
           training_loss_result.secondary_metrics.end()};
+      log_entry->set_update_predictions_and_gradients_duration_seconds(
+          absl::ToDoubleSeconds(update_predictions_and_gradients_duration));
 
       std::string snippet =
           absl::StrFormat("\tnum-trees:%d train-loss:%f", iter_idx + 1,
@@ -1045,6 +1083,10 @@ GradientBoostedTreesLearner::ShardedSamplingTrain(
     thread_load_next_shards = {};
   }
 
+  YDF_LOG(INFO) << "Time spent updating the predictions and gradients: "
+                << absl::FormatDuration(
+                       update_predictions_and_gradients_duration);
+
   if (has_validation_dataset) {
     RETURN_IF_ERROR(FinalizeModelWithValidationDataset(
         config, early_stopping, validation->dataset, deployment().num_threads(),
@@ -1210,6 +1252,18 @@ GradientBoostedTreesLearner::TrainWithStatus(
         kAdaptativeWarmUpSeconds, config.gbt_config->min_adapted_subsample());
   }
 
+  // Thread pool used to update the predictions and the gradients in between
+  // the training of the trees. Null if training is single-threaded.
+  std::unique_ptr<utils::concurrency::ThreadPool> update_thread_pool;
+  if (deployment().num_threads() > 1) {
+    update_thread_pool = absl::make_unique<utils::concurrency::ThreadPool>(
+        "UpdatePredictions", deployment().num_threads());
+    update_thread_pool->StartWorkers();
+  }
+
+  // Total time spent updating the predictions and the gradients.
+  absl::Duration update_predictions_and_gradients_duration;
+
   // Compute and set the initial prediction of the model i.e. the "constant
   // prediction" independent of the trees.
   ASSIGN_OR_RETURN(const auto initial_predictions,
@@ -1217,13 +1271,13 @@ GradientBoostedTreesLearner::TrainWithStatus(
                        gradient_sub_train_dataset,
                        config.train_config_link.label(), weights));
   mdl->set_initial_predictions(initial_predictions);
-  internal::SetInitialPredictions(mdl->initial_predictions(),
-                                  sub_train_dataset.nrow(),
-                                  &sub_train_predictions);
+  internal::SetInitialPredictions(
+      mdl->initial_predictions(), sub_train_dataset.nrow(),
+      &sub_train_predictions, update_thread_pool.get());
   if (has_validation_dataset) {
-    internal::SetInitialPredictions(mdl->initial_predictions(),
-                                    validation_dataset.nrow(),
-                                    &validation_predictions);
+    internal::SetInitialPredictions(
+        mdl->initial_predictions(), validation_dataset.nrow(),
+        &validation_predictions, update_thread_pool.get());
   }
 
   bool dart_extraction = config.gbt_config->forest_extraction_case() ==
@@ -1324,12 +1378,12 @@ GradientBoostedTreesLearner::TrainWithStatus(
 
       RETURN_IF_ERROR(internal::ComputePredictions(
           mdl.get(), engine.get(), {}, config, gradient_sub_train_dataset,
-          &sub_train_predictions));
+          &sub_train_predictions, update_thread_pool.get()));
 
       if (has_validation_dataset) {
         RETURN_IF_ERROR(internal::ComputePredictions(
             mdl.get(), engine.get(), {}, config, gradient_validation_dataset,
-            &validation_predictions));
+            &validation_predictions, update_thread_pool.get()));
       }
       YDF_LOG(INFO) << "Re-compute the prediction accumulators in "
                     << absl::FormatDuration(absl::Now() -
@@ -1364,9 +1418,13 @@ GradientBoostedTreesLearner::TrainWithStatus(
     }
 
     // Compute the gradient of the residual relative to the examples.
+    const auto begin_update_gradients = absl::Now();
     RETURN_IF_ERROR(config.loss->UpdateGradients(
         gradient_sub_train_dataset, config.train_config_link.label(),
-        sub_train_predictions, train_ranking_index.get(), &gradients, &random));
+        sub_train_predictions, train_ranking_index.get(), &gradients, &random,
+        update_thread_pool.get()));
+    update_predictions_and_gradients_duration +=
+        absl::Now() - begin_update_gradients;
 
     float subsample_factor = 1.f;
     // Select a random set of examples (without replacement).
@@ -1412,7 +1470,8 @@ GradientBoostedTreesLearner::TrainWithStatus(
     std::vector<std::unique_ptr<decision_tree::DecisionTree>> new_trees;
     new_trees.reserve(gradients.size());
     for (int grad_idx = 0; grad_idx < gradients.size(); grad_idx++) {
-      auto tree = absl::make_unique<decision_tree::DecisionTree>();
+      auto tree = absl::make_unique<decision_tree::DecisionTree>(
+          config.gbt_config->decision_tree().internal().use_node_arena());
 
       auto internal_config = BuildWeakLearnerInternalConfig(
           config, deployment().num_threads(), grad_idx, gradients,
@@ -1438,6 +1497,7 @@ GradientBoostedTreesLearner::TrainWithStatus(
     }
 
     double mean_abs_prediction = 0;
+    const auto begin_update_predictions = absl::Now();
     if (dart_extraction) {
       // Update the Dart cache and the predictions on the training dataset.
       RETURN_IF_ERROR(dart_predictions_training.UpdateWithNewIteration(
@@ -1458,16 +1518,19 @@ GradientBoostedTreesLearner::TrainWithStatus(
       // Update the predictions on the training dataset.
       RETURN_IF_ERROR(UpdatePredictions(
           RemoveUniquePtr(new_trees), gradient_sub_train_dataset,
-          &sub_train_predictions, &mean_abs_prediction));
+          &sub_train_predictions, &mean_abs_prediction,
+          update_thread_pool.get()));
 
       if (has_validation_dataset) {
         // Update the predictions on the validation dataset.
-        RETURN_IF_ERROR(UpdatePredictions(RemoveUniquePtr(new_trees),
-                                          gradient_validation_dataset,
-                                          &validation_predictions,
-                                          /*mean_abs_prediction=*/nullptr));
+        RETURN_IF_ERROR(UpdatePredictions(
+            RemoveUniquePtr(new_trees), gradient_validation_dataset,
+            &validation_predictions,
+            /*mean_abs_prediction=*/nullptr, update_thread_pool.get()));
       }
     }
+    update_predictions_and_gradients_duration +=
+        absl::Now() - begin_update_predictions;
 
     // Add the tree to the model.
     for (auto& tree : new_trees) {
@@ -1490,6 +1553,8 @@ GradientBoostedTreesLearner::TrainWithStatus(
           training_loss_result.secondary_metrics.begin(),
           training_loss_result.secondary_metrics.end()};
       log_entry->set_mean_abs_prediction(mean_abs_prediction);
+      log_entry->set_update_predictions_and_gradients_duration_seconds(
+          absl::ToDoubleSeconds(update_predictions_and_gradients_duration));
 
       std::string snippet =
           absl::StrFormat("\tnum-trees:%d train-loss:%f", iter_idx + 1,
@@ -1599,6 +1664,10 @@ GradientBoostedTreesLearner::TrainWithStatus(
     }
   }  // End of training iteration.
 
+  YDF_LOG(INFO) << "Time spent updating the predictions and gradients: "
+                << absl::FormatDuration(
+                       update_predictions_and_gradients_duration);
+
   // Create a final snapshot
   if (deployment_.try_resume_training()) {
     const auto last_snapshot = utils::GetGreatestSnapshot(snapshot_directory);
@@ -2642,7 +2711,8 @@ absl::Status ComputePredictions(
     const std::vector<decision_tree::DecisionTree*>& trees,
     const internal::AllTrainingConfiguration& config,
     const dataset::VerticalDataset& gradient_dataset,
-    std::vector<float>* predictions) {
+    std::vector<float>* predictions,
+    utils::concurrency::ThreadPool* thread_pool) {
   if (optional_engine) {
     // Prediction using the engine (fast).
 
@@ -2651,34 +2721,56 @@ absl::Status ComputePredictions(
       return absl::InternalError("Unexpected number of prediction dimensions");
     }
 
-    const size_t batch_size = 1000;
     const size_t num_examples = gradient_dataset.nrow();
-    auto examples =
-        optional_engine->AllocateExamples(std::min(batch_size, num_examples));
-    const size_t num_batches = (num_examples + batch_size - 1) / batch_size;
-    std::vector<float> batch_predictions;
-
     predictions->resize(num_examples * mdl->initial_predictions().size());
 
-    for (size_t batch_idx = 0; batch_idx < num_batches; batch_idx++) {
-      const size_t begin_example_idx = batch_idx * batch_size;
-      const size_t end_example_idx =
-          std::min(begin_example_idx + batch_size, num_examples);
-      RETURN_IF_ERROR(serving::CopyVerticalDatasetToAbstractExampleSet(
-          gradient_dataset,
-          /*begin_example_idx=*/begin_example_idx,
-          /*end_example_idx=*/end_example_idx, optional_engine->features(),
-          examples.get()));
-      optional_engine->Predict(*examples, end_example_idx - begin_example_idx,
-                               &batch_predictions);
-      std::copy(batch_predictions.begin(), batch_predictions.end(),
-                predictions->begin() +
-                    begin_example_idx * mdl->initial_predictions().size());
+    // Computes the predictions of the examples in [begin_example_idx,
+    // end_example_idx) by batches.
+    const auto predict_range =
+        [&](const size_t begin_example_idx,
+            const size_t end_example_idx) -> absl::Status {
+      const size_t batch_size = 1000;
+      auto examples = optional_engine->AllocateExamples(
+          std::min(batch_size, end_example_idx - begin_example_idx));
+      std::vector<float> batch_predictions;
+      for (size_t begin_batch_idx = begin_example_idx;
+           begin_batch_idx < end_example_idx; begin_batch_idx += batch_size) {
+        const size_t end_batch_idx =
+            std::min(begin_batch_idx + batch_size, end_example_idx);
+        RETURN_IF_ERROR(serving::CopyVerticalDatasetToAbstractExampleSet(
+            gradient_dataset,
+            /*begin_example_idx=*/begin_batch_idx,
+            /*end_example_idx=*/end_batch_idx, optional_engine->features(),
+            examples.get()));
+        optional_engine->Predict(*examples, end_batch_idx - begin_batch_idx,
+                                 &batch_predictions);
+        std::copy(batch_predictions.begin(), batch_predictions.end(),
+                  predictions->begin() +
+                      begin_batch_idx * mdl->initial_predictions().size());
+      }
+      return absl::OkStatus();
+    };
+
+    if (thread_pool == nullptr) {
+      RETURN_IF_ERROR(predict_range(0, num_examples));
+    } else {
+      std::vector<absl::Status> block_status(thread_pool->num_threads());
+      utils::concurrency::ConcurrentForLoop(
+          thread_pool->num_threads(), thread_pool, num_examples,
+          [&predict_range, &block_status](size_t block_idx, size_t begin_idx,
+                                          size_t end_idx) {
+            if (begin_idx < end_idx) {
+              block_status[block_idx] = predict_range(begin_idx, end_idx);
+            }
+          });
+      for (const auto& status : block_status) {
+        RETURN_IF_ERROR(status);
+      }
     }
 
   } else {
     SetInitialPredictions(mdl->initial_predictions(), gradient_dataset.nrow(),
-                          predictions);
+                          predictions, thread_pool);
   }
 
   // Predictions using the trees (slow).
@@ -2691,7 +2783,7 @@ absl::Status ComputePredictions(
           trees[iter_idx * mdl->num_trees_per_iter() + tree_idx];
     }
     RETURN_IF_ERROR(UpdatePredictions(selected_trees, gradient_dataset,
-                                      predictions, nullptr));
+                                      predictions, nullptr, thread_pool));
   }
   return absl::OkStatus();
 }
@@ -2991,14 +3083,28 @@ std::vector<float> DartPredictionAccumulator::TreeOutputScaling() const {
 
 void SetInitialPredictions(const std::vector<float>& initial_predictions,
                            const UnsignedExampleIdx num_rows,
-                           std::vector<float>* predictions) {
+                           std::vector<float>* predictions,
+                           utils::concurrency::ThreadPool* thread_pool) {
   predictions->resize(num_rows * initial_predictions.size());
-  size_t cur = 0;
-  for (UnsignedExampleIdx example_idx = 0; example_idx < num_rows;
-       example_idx++) {
-    for (const auto initial_prediction : initial_predictions) {
-      (*predictions)[cur++] = initial_prediction;
+  const auto set_range = [&initial_predictions, predictions](
+                             const size_t begin_example_idx,
+                             const size_t end_example_idx) {
+    size_t cur = begin_example_idx * initial_predictions.size();
+    for (size_t example_idx = begin_example_idx;
+         example_idx < end_example_idx; example_idx++) {
+      for (const auto initial_prediction : initial_predictions) {
+        (*predictions)[cur++] = initial_prediction;
+      }
     }
+  };
+  if (thread_pool == nullptr) {
+    set_range(0, num_rows);
+  } else {
+    utils::concurrency::ConcurrentForLoop(
+        thread_pool->num_threads(), thread_pool, num_rows,
+        [&set_range](size_t block_idx, size_t begin_idx, size_t end_idx) {
+          set_range(begin_idx, end_idx);
+        });
   }
 }
 
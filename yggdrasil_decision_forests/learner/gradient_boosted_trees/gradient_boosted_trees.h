@@ -62,6 +62,7 @@
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.pb.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
 #include "yggdrasil_decision_forests/utils/hyper_parameters.h"
 #include "yggdrasil_decision_forests/utils/random.h"
 
@@ -234,14 +235,16 @@ void SetInitialPredictions(const std::vector<float>& initial_predictions,
 // existing predictions or gradient buffers.
 //
 // Only the meta-data are used from "mdl". If "optional_engine" is non-null, it
-// will be used in conjunction with "trees".
+// will be used in conjunction with "trees". If "thread_pool" is non-null, the
+// examples are processed in parallel by blocks.
 absl::Status ComputePredictions(
     const GradientBoostedTreesModel* mdl,
     const serving::FastEngine* optional_engine,
     const std::vector<decision_tree::DecisionTree*>& trees,
     const internal::AllTrainingConfiguration& config,
     const dataset::VerticalDataset& gradient_dataset,
-    std::vector<float>* predictions);
+    std::vector<float>* predictions,
+    utils::concurrency::ThreadPool* thread_pool = nullptr);
 
 // Sample (without replacement) a set of example indices.
 void SampleTrainingExamples(UnsignedExampleIdx num_rows, float sample,
@@ -409,9 +412,12 @@ LoadCompleteDatasetForWeakLearner(
 absl::StatusOr<proto::Loss> DefaultLoss(
     model::proto::Task task, const dataset::proto::Column& label_spec);
 
-void SetInitialPredictions(const std::vector<float>& initial_predictions,
-                           const UnsignedExampleIdx num_rows,
-                           std::vector<float>* predictions);
+// Copy the initial model predictions to the accumulator of predictions. If
+// "thread_pool" is non-null, the examples are processed in parallel by blocks.
+void SetInitialPredictions(
+    const std::vector<float>& initial_predictions,
+    const UnsignedExampleIdx num_rows, std::vector<float>* predictions,
+    utils::concurrency::ThreadPool* thread_pool = nullptr);
 
 // Sets the default hyper-parameters of the learner.
 absl::Status SetDefaultHyperParameters(
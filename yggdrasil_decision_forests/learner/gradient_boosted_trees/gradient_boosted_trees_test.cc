@@ -59,6 +59,8 @@
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.pb.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/quick_scorer_extended.h"
+#include "yggdrasil_decision_forests/serving/example_set_model_wrapper.h"
 #include "yggdrasil_decision_forests/utils/concurrency.h"
 #include "yggdrasil_decision_forests/utils/csv.h"
 #include "yggdrasil_decision_forests/utils/distribution.pb.h"
@@ -258,6 +260,14 @@ TEST(GradientBoostedTrees, SetInitialPredictions) {
   EXPECT_THAT(predictions, ElementsAre(1, 2, 1, 2, 1, 2));
 }
 
+TEST(GradientBoostedTrees, SetInitialPredictionsWithThreadPool) {
+  utils::concurrency::ThreadPool thread_pool("", 2);
+  thread_pool.StartWorkers();
+  std::vector<float> predictions;
+  internal::SetInitialPredictions({1, 2}, 3, &predictions, &thread_pool);
+  EXPECT_THAT(predictions, ElementsAre(1, 2, 1, 2, 1, 2));
+}
+
 TEST(GradientBoostedTrees, SampleTrainingExamplesWithGoss) {
   const UnsignedExampleIdx num_rows = 4;
   std::vector<float> weights(num_rows, 1.f);
@@ -711,6 +721,21 @@ TEST_F(PerShardSamplingOnAdult, PerShardSamplingExact) {
   YDF_TEST_METRIC(metric::Accuracy(evaluation), 0.8667, 0.008, nan);
 }
 
+// The sharded training does not compute the binned numerical features.
+TEST_F(PerShardSamplingOnAdult, PerShardSamplingHistogramBinned) {
+  auto learner = BuildBaseLearner();
+  auto* gbt_config = learner->mutable_training_config()->MutableExtension(
+      gradient_boosted_trees::proto::gradient_boosted_trees_config);
+  gbt_config->set_use_hessian_gain(true);
+  gbt_config->mutable_decision_tree()->mutable_numerical_split()->set_type(
+      decision_tree::proto::NumericalSplit::HISTOGRAM_BINNED);
+  gbt_config->mutable_sample_with_shards();
+
+  const auto sharded_path = ShardDataset(train_ds_, 2, 0.1);
+  EXPECT_THAT(learner->TrainWithStatus(sharded_path, data_spec_).status(),
+              test::StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 // Model trained with the sharded algorithm and sampling.
 TEST_F(PerShardSamplingOnAdult, PerShardSamplingSampling) {
   auto learner = BuildBaseLearner();
@@ -778,9 +803,10 @@ TEST_F(GradientBoostedTreesOnAdult, RandomCategorical) {
       decision_tree::CheckStructureOptions::GlobalImuptation()));
 }
 
-// Train and test a model on the adult dataset with too much nodes for the
-// QuickScorer serving algorithm.
-TEST_F(GradientBoostedTreesOnAdult, BaseNoQuickScorer) {
+// Train and test a model on the adult dataset with trees of more than 64 leafs.
+// The QuickScorer serving algorithm represents each tree with multiple leaf
+// masks.
+TEST_F(GradientBoostedTreesOnAdult, BaseDeepTrees) {
   auto* gbt_config = train_config_.MutableExtension(
       gradient_boosted_trees::proto::gradient_boosted_trees_config);
   gbt_config->set_num_trees(100);
@@ -799,6 +825,23 @@ TEST_F(GradientBoostedTreesOnAdult, BaseNoQuickScorer) {
       dynamic_cast<const GradientBoostedTreesModel*>(model_.get());
   EXPECT_TRUE(gbt_model->CheckStructure(
       decision_tree::CheckStructureOptions::GlobalImuptation()));
+
+  // The trees have more leaves than a single 64-bit QuickScorer leaf mask.
+  // The QuickScorer engine is still selected, and its predictions match the
+  // generic engine.
+  int64_t max_num_leaves = 0;
+  for (const auto& tree : gbt_model->decision_trees()) {
+    max_num_leaves = std::max(max_num_leaves, tree->NumLeafs());
+  }
+  EXPECT_GT(max_num_leaves, 64);
+
+  ASSERT_OK_AND_ASSIGN(const auto engine, gbt_model->BuildFastEngine());
+  using QuickScorerEngine = serving::ExampleSetModelWrapper<
+      serving::decision_forest::
+          GradientBoostedTreesBinaryClassificationQuickScorerExtended,
+      serving::decision_forest::Predict>;
+  EXPECT_NE(dynamic_cast<const QuickScorerEngine*>(engine.get()), nullptr);
+  utils::ExpectEqualPredictions(test_dataset_, *model_, *engine);
 }
 
 // Train and test a model on the adult dataset.
@@ -837,6 +880,55 @@ TEST_F(GradientBoostedTreesOnAdult, BaseConcurrent) {
   YDF_TEST_METRIC(metric::LogLoss(evaluation_), 0.296, 0.0117, 0.2942);
 }
 
+// The predictions of a model computed in parallel over blocks of examples are
+// the same as the predictions computed single-threaded.
+TEST_F(GradientBoostedTreesOnAdult, ParallelAndSingleThreadedPredictions) {
+  auto* gbt_config = train_config_.MutableExtension(
+      gradient_boosted_trees::proto::gradient_boosted_trees_config);
+  gbt_config->set_num_trees(20);
+  TrainAndEvaluateModel();
+
+  auto* gbt_model = dynamic_cast<GradientBoostedTreesModel*>(model_.get());
+  ASSERT_NE(gbt_model, nullptr);
+  std::vector<decision_tree::DecisionTree*> trees;
+  for (auto& tree : *gbt_model->mutable_decision_trees()) {
+    trees.push_back(tree.get());
+  }
+  gbt_model->set_output_logits(true);
+  ASSERT_OK_AND_ASSIGN(const auto engine, gbt_model->BuildFastEngine());
+
+  utils::concurrency::ThreadPool thread_pool("", 4);
+  thread_pool.StartWorkers();
+  const internal::AllTrainingConfiguration config;
+
+  // Predictions computed with the trees.
+  std::vector<float> single_threaded;
+  std::vector<float> parallel;
+  ASSERT_OK(internal::ComputePredictions(gbt_model, nullptr, trees, config,
+                                         test_dataset_, &single_threaded));
+  ASSERT_OK(internal::ComputePredictions(gbt_model, nullptr, trees, config,
+                                         test_dataset_, &parallel,
+                                         &thread_pool));
+  ASSERT_EQ(single_threaded.size(), test_dataset_.nrow());
+  EXPECT_EQ(single_threaded, parallel);
+
+  // Predictions computed with the engine.
+  std::vector<float> engine_single_threaded;
+  std::vector<float> engine_parallel;
+  ASSERT_OK(internal::ComputePredictions(gbt_model, engine.get(), {}, config,
+                                         test_dataset_,
+                                         &engine_single_threaded));
+  ASSERT_OK(internal::ComputePredictions(gbt_model, engine.get(), {}, config,
+                                         test_dataset_, &engine_parallel,
+                                         &thread_pool));
+  EXPECT_EQ(engine_single_threaded, engine_parallel);
+  for (size_t example_idx = 0; example_idx < single_threaded.size();
+       example_idx++) {
+    EXPECT_NEAR(single_threaded[example_idx],
+                engine_single_threaded[example_idx], 1e-4);
+  }
+}
+
 // Train and test a model on the adult dataset with Goss sampling.
 TEST_F(GradientBoostedTreesOnAdult, GossDeprecated) {
   auto* gbt_config = train_config_.MutableExtension(
@@ -1178,6 +1270,74 @@ TEST_F(GradientBoostedTreesOnAdult, HessianDiscretizedNumerical) {
   YDF_TEST_METRIC(metric::LogLoss(evaluation_), 0.2938, 0.0116, 0.2930);
 }
 
+TEST_F(GradientBoostedTreesOnAdult, HessianHistogramBinnedNumerical) {
+  auto* gbt_config = train_config_.MutableExtension(
+      gradient_boosted_trees::proto::gradient_boosted_trees_config);
+  gbt_config->set_num_trees(100);
+  gbt_config->mutable_decision_tree()->set_max_depth(4);
+  gbt_config->set_subsample(0.9f);
+  gbt_config->set_use_hessian_gain(true);
+  gbt_config->mutable_decision_tree()->mutable_numerical_split()->set_type(
+      decision_tree::proto::NumericalSplit::HISTOGRAM_BINNED);
+
+  TrainAndEvaluateModel();
+
+  YDF_TEST_METRIC(metric::Accuracy(evaluation_), 0.8664, 0.0101, 0.8652);
+  YDF_TEST_METRIC(metric::LogLoss(evaluation_), 0.2962, 0.0159, 0.2877);
+}
+
+TEST_F(GradientBoostedTreesOnAdult, HessianHistogramBinnedNumericalPacked) {
+  auto* gbt_config = train_config_.MutableExtension(
+      gradient_boosted_trees::proto::gradient_boosted_trees_config);
+  gbt_config->set_num_trees(100);
+  gbt_config->mutable_decision_tree()->set_max_depth(4);
+  gbt_config->set_subsample(0.9f);
+  gbt_config->set_use_hessian_gain(true);
+  gbt_config->mutable_decision_tree()->mutable_numerical_split()->set_type(
+      decision_tree::proto::NumericalSplit::HISTOGRAM_BINNED);
+  // The rows of the packed bin matrix are filled in parallel.
+  deployment_config_.set_num_threads(4);
+
+  const auto model_structure = [&]() {
+    const auto* gbt_model =
+        dynamic_cast<const GradientBoostedTreesModel*>(model_.get());
+    std::string structure;
+    decision_tree::AppendModelStructure(gbt_model->decision_trees(),
+                                        gbt_model->data_spec(),
+                                        gbt_model->label_col_idx(), &structure);
+    return structure;
+  };
+
+  TrainAndEvaluateModel();
+  const std::string unpacked_structure = model_structure();
+  const auto unpacked_evaluation = evaluation_;
+
+  gbt_config->mutable_decision_tree()
+      ->mutable_internal()
+      ->set_use_packed_bin_matrix(true);
+
+  // With a single thread, the histograms are accumulated in the same order,
+  // and the packed bin matrix does not change the model.
+  deployment_config_.set_num_threads(1);
+  TrainAndEvaluateModel();
+  EXPECT_EQ(model_structure(), unpacked_structure);
+  EXPECT_EQ(metric::Accuracy(evaluation_),
+            metric::Accuracy(unpacked_evaluation));
+  EXPECT_EQ(metric::LogLoss(evaluation_), metric::LogLoss(unpacked_evaluation));
+
+  // With multiple threads, the histograms of the rows scanned by each thread
+  // are summed, which can change the last bits of the split scores.
+  deployment_config_.set_num_threads(4);
+  TrainAndEvaluateModel();
+  EXPECT_NEAR(metric::Accuracy(evaluation_),
+              metric::Accuracy(unpacked_evaluation), 0.005);
+  EXPECT_NEAR(metric::LogLoss(evaluation_),
+              metric::LogLoss(unpacked_evaluation), 0.005);
+
+  YDF_TEST_METRIC(metric::Accuracy(evaluation_), 0.8664, 0.0101, 0.8652);
+  YDF_TEST_METRIC(metric::LogLoss(evaluation_), 0.2962, 0.0159, 0.2877);
+}
+
 TEST_F(GradientBoostedTreesOnAdult, HessianL2Categorical) {
   auto* gbt_config = train_config_.MutableExtension(
       gradient_boosted_trees::proto::gradient_boosted_trees_config);
@@ -34,6 +34,7 @@
 #include "yggdrasil_decision_forests/learner/decision_tree/utils.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/gradient_boosted_trees.pb.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_kernels.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_utils.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
@@ -123,21 +124,12 @@ void BinomialLogLikelihoodLoss::TemplatedUpdateGradientsImp(
     const std::vector<T>& labels, const std::vector<float>& predictions,
     size_t begin_example_idx, size_t end_example_idx,
     std::vector<float>* gradient_data, std::vector<float>* hessian_data) {
-  DCHECK_EQ(gradient_data->size(), hessian_data->size());
   // Set the gradient to:
   //   label - 1/(1 + exp(-prediction))
   // where "label" is in {0,1} and prediction is the probability of
   // label=1.
-  for (size_t example_idx = begin_example_idx; example_idx < end_example_idx;
-       example_idx++) {
-    const float label = (labels[example_idx] == 2) ? 1.f : 0.f;
-    const float prediction = predictions[example_idx];
-    const float prediction_proba = 1.f / (1.f + std::exp(-prediction));
-    DCheckIsFinite(prediction);
-    DCheckIsFinite(prediction_proba);
-    (*gradient_data)[example_idx] = label - prediction_proba;
-    (*hessian_data)[example_idx] = prediction_proba * (1 - prediction_proba);
-  }
+  kernels::BinomialGradients(labels, predictions, begin_example_idx,
+                             end_example_idx, gradient_data, hessian_data);
 }
 
 template <typename T>
@@ -34,6 +34,7 @@
 #include "yggdrasil_decision_forests/learner/decision_tree/utils.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/gradient_boosted_trees.pb.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_kernels.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_utils.h"
 #include "yggdrasil_decision_forests/metric/metric.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
@@ -103,23 +104,28 @@ absl::Status MeanSquaredErrorLoss::UpdateGradients(
     const RankingGroupsIndices* ranking_index, GradientDataRef* gradients,
     utils::RandomEngine* random,
     utils::concurrency::ThreadPool* thread_pool) const {
-  // TODO: Implement thread_pool.
-
   // Set the gradient to:
   //   label - prediction
   if (gradients->size() != 1) {
     return absl::InternalError("Wrong gradient shape");
   }
   const auto num_examples = labels.size();
-  std::vector<float>& gradient_data = *(*gradients)[0].gradient;
-  std::vector<float>& hessian_data = *(*gradients)[0].hessian;
-  DCHECK_EQ(gradient_data.size(), hessian_data.size());
+  std::vector<float>* gradient_data = (*gradients)[0].gradient;
+  std::vector<float>* hessian_data = (*gradients)[0].hessian;
+  DCHECK_EQ(gradient_data->size(), hessian_data->size());
 
-  for (size_t example_idx = 0; example_idx < num_examples; example_idx++) {
-    const float label = labels[example_idx];
-    const float prediction = predictions[example_idx];
-    gradient_data[example_idx] = label - prediction;
-    hessian_data[example_idx] = 1.f;
+  if (thread_pool == nullptr) {
+    kernels::MeanSquaredErrorGradients(labels, predictions, 0, num_examples,
+                                       gradient_data, hessian_data);
+  } else {
+    utils::concurrency::ConcurrentForLoop(
+        thread_pool->num_threads(), thread_pool, num_examples,
+        [&labels, &predictions, gradient_data, hessian_data](
+            size_t block_idx, size_t begin_idx, size_t end_idx) -> void {
+          kernels::MeanSquaredErrorGradients(labels, predictions, begin_idx,
+                                             end_idx, gradient_data,
+                                             hessian_data);
+        });
   }
   return absl::OkStatus();
 }
@@ -35,6 +35,7 @@
 #include "yggdrasil_decision_forests/learner/decision_tree/utils.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/gradient_boosted_trees.pb.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_kernels.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_utils.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
@@ -82,45 +83,27 @@ absl::Status MultinomialLogLikelihoodLoss::TemplatedUpdateGradients(
     utils::RandomEngine* random,
     utils::concurrency::ThreadPool* thread_pool) const {
   static_assert(std::is_integral<T>::value, "Integral required.");
-  // TODO: Implement thread_pool.
 
   // Set the gradient to:
   //   label_i - pred_i
   // where "label_i" is in {0,1}.
-  absl::FixedArray<float> accumulator(gradients->size());
   const auto num_examples = labels.size();
   const auto use_hessian_gain = (*gradients)[0].hessian;
   if (!use_hessian_gain) {
     return absl::InternalError("Hessian missing");
   }
-  for (size_t example_idx = 0; example_idx < num_examples; example_idx++) {
-    // Compute normalization term.
-    float sum_exp = 0;
-    for (int grad_idx = 0; grad_idx < gradients->size(); grad_idx++) {
-      float exp_val =
-          std::exp(predictions[grad_idx + example_idx * gradients->size()]);
-      accumulator[grad_idx] = exp_val;
-      sum_exp += exp_val;
-    }
-    const float normalization = 1.f / sum_exp;
-    // Update gradient.
-    const int label_cat = labels[example_idx];
-    for (int grad_idx = 0; grad_idx < gradients->size(); grad_idx++) {
-      const float label = (label_cat == (grad_idx + 1)) ? 1.f : 0.f;
-      DCheckIsFinite(label);
-      const float prediction = accumulator[grad_idx] * normalization;
-      DCheckIsFinite(prediction);
-      const float grad = label - prediction;
-      const float abs_grad = std::abs(grad);
-      DCheckIsFinite(grad);
 
-      auto& gradient_data = (*(*gradients)[grad_idx].gradient);
-      auto& hessian_data = (*(*gradients)[grad_idx].hessian);
-      DCHECK_EQ(gradient_data.size(), hessian_data.size());
-      gradient_data[example_idx] = grad;
-      hessian_data[example_idx] = abs_grad * (1 - abs_grad);
-      DCheckIsFinite(abs_grad * (1 - abs_grad));
-    }
+  if (thread_pool == nullptr) {
+    kernels::MultinomialGradients(labels, predictions, 0, num_examples,
+                                  *gradients);
+  } else {
+    utils::concurrency::ConcurrentForLoop(
+        thread_pool->num_threads(), thread_pool, num_examples,
+        [&labels, &predictions, gradients](size_t block_idx, size_t begin_idx,
+                                           size_t end_idx) -> void {
+          kernels::MultinomialGradients(labels, predictions, begin_idx,
+                                        end_idx, *gradients);
+        });
   }
   return absl::OkStatus();
 }
@@ -29,6 +29,7 @@
 #include "yggdrasil_decision_forests/learner/decision_tree/training.h"
 #include "yggdrasil_decision_forests/learner/decision_tree/utils.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_kernels.h"
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_utils.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
@@ -133,16 +134,8 @@ void PoissonLoss::UpdateGradientsImp(const std::vector<float> &labels,
   // loss = exp(prediction) - label * prediction
   // -gradient = label - exp(prediction)
   // hessian = exp(prediction)
-  for (size_t example_idx = begin_example_idx; example_idx < end_example_idx;
-       example_idx++) {
-    const float label = labels[example_idx];
-    const float prediction = predictions[example_idx];
-    const float exp_pred = std::exp(prediction);
-    DCheckIsFinite(prediction);
-    DCheckIsFinite(exp_pred);
-    (*gradient_data)[example_idx] = label - exp_pred;
-    (*hessian_data)[example_idx] = exp_pred;
-  }
+  kernels::PoissonGradients(labels, predictions, begin_example_idx,
+                            end_example_idx, gradient_data, hessian_data);
 }
 
 
@@ -0,0 +1,661 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_kernels.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "absl/base/config.h"
+#include "absl/strings/string_view.h"
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_utils.h"
+#include "yggdrasil_decision_forests/utils/logging.h"
+
+// With GCC and Clang on x86-64, the SIMD implementations are compiled with
+// function level "target" attributes. They are available even if the binary is
+// not compiled with "-mavx2" or "-mavx512f", and they are selected at runtime
+// according to the CPU support. With other compilers (e.g. MSVC), the SIMD
+// implementations are only available if the binary is compiled for the
+// corresponding instruction set.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define YDF_LOSS_KERNELS_AVX2
+#define YDF_LOSS_KERNELS_AVX512
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+// Inlines the generic SIMD code in the functions with a "target" attribute.
+#define FLATTEN __attribute__((flatten))
+#else
+#ifdef __AVX2__
+#define YDF_LOSS_KERNELS_AVX2
+#endif
+#ifdef __AVX512F__
+#define YDF_LOSS_KERNELS_AVX512
+#endif
+#define TARGET_AVX2
+#define TARGET_AVX512
+#define FLATTEN
+#endif
+
+#if defined(YDF_LOSS_KERNELS_AVX2) || defined(YDF_LOSS_KERNELS_AVX512)
+#include <immintrin.h>
+#endif
+
+// The generic SIMD functions (e.g. "FastExpImp<AVX2>") take and return vector
+// types without being compiled for the instruction set themselves. They are
+// only called from (and inlined in) the functions with a "target" attribute.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace gradient_boosted_trees {
+namespace kernels {
+namespace {
+
+// Coefficients of the exp(x) approximation. "x" is decomposed into
+// n * log(2) + r with "n" integer and |r| <= log(2)/2. exp(r) is approximated
+// with a polynomial of degree 7 (Cephes' expf), and 2^n is computed by setting
+// the float exponent bits directly. "log(2)" is split into "kLn2Hi + kLn2Lo" to
+// keep "r" exact.
+constexpr float kLog2e = 1.44269504088896341f;
+constexpr float kLn2Hi = 0.693359375f;
+constexpr float kLn2Lo = -2.12194440e-4f;
+constexpr float kExpP0 = 1.9875691500e-4f;
+constexpr float kExpP1 = 1.3981999507e-3f;
+constexpr float kExpP2 = 8.3334519073e-3f;
+constexpr float kExpP3 = 4.1665795894e-2f;
+constexpr float kExpP4 = 1.6666665459e-1f;
+constexpr float kExpP5 = 5.0000001201e-1f;
+
+// Number of examples processed at a time by the multinomial kernel.
+constexpr size_t kMultinomialBlockSize = 256;
+
+enum class InstructionSet { kScalar, kAVX2, kAVX512 };
+
+InstructionSet DetectInstructionSet() {
+#if ABSL_HAVE_BUILTIN(__builtin_cpu_supports)
+#ifdef YDF_LOSS_KERNELS_AVX512
+  if (__builtin_cpu_supports("avx512f")) {
+    return InstructionSet::kAVX512;
+  }
+#endif
+#ifdef YDF_LOSS_KERNELS_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return InstructionSet::kAVX2;
+  }
+#endif
+  return InstructionSet::kScalar;
+#else
+  // The CPU support cannot be detected. We assume the instruction set the
+  // binary was compiled for is supported.
+#if defined(__AVX512F__)
+  return InstructionSet::kAVX512;
+#elif defined(__AVX2__)
+  return InstructionSet::kAVX2;
+#else
+  return InstructionSet::kScalar;
+#endif
+#endif
+}
+
+InstructionSet GetInstructionSet() {
+  static const InstructionSet instruction_set = DetectInstructionSet();
+  return instruction_set;
+}
+
+#ifdef YDF_LOSS_KERNELS_AVX2
+// 8-wide SIMD operations.
+struct AVX2 {
+  using Float = __m256;
+  static constexpr int kWidth = 8;
+
+  TARGET_AVX2 static Float Load(const float* src) {
+    return _mm256_loadu_ps(src);
+  }
+  TARGET_AVX2 static void Store(float* dst, const Float v) {
+    _mm256_storeu_ps(dst, v);
+  }
+  TARGET_AVX2 static Float Set1(const float v) { return _mm256_set1_ps(v); }
+  TARGET_AVX2 static Float Add(const Float a, const Float b) {
+    return _mm256_add_ps(a, b);
+  }
+  TARGET_AVX2 static Float Sub(const Float a, const Float b) {
+    return _mm256_sub_ps(a, b);
+  }
+  TARGET_AVX2 static Float Mul(const Float a, const Float b) {
+    return _mm256_mul_ps(a, b);
+  }
+  TARGET_AVX2 static Float Div(const Float a, const Float b) {
+    return _mm256_div_ps(a, b);
+  }
+  TARGET_AVX2 static Float Min(const Float a, const Float b) {
+    return _mm256_min_ps(a, b);
+  }
+  TARGET_AVX2 static Float Max(const Float a, const Float b) {
+    return _mm256_max_ps(a, b);
+  }
+  TARGET_AVX2 static Float Floor(const Float a) { return _mm256_floor_ps(a); }
+
+  // 2^n for an integer valued "n".
+  TARGET_AVX2 static Float Pow2(const Float n) {
+    const __m256i exponent = _mm256_slli_epi32(
+        _mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_castsi256_ps(exponent);
+  }
+
+  // 1.f if "labels[i] == value", 0.f otherwise.
+  TARGET_AVX2 static Float LabelIndicator(const int32_t* labels,
+                                          const int32_t value) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(labels));
+    return Indicator(_mm256_cmpeq_epi32(v, _mm256_set1_epi32(value)));
+  }
+
+  TARGET_AVX2 static Float LabelIndicator(const int16_t* labels,
+                                          const int32_t value) {
+    const __m256i v = _mm256_cvtepi16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(labels)));
+    return Indicator(_mm256_cmpeq_epi32(v, _mm256_set1_epi32(value)));
+  }
+
+ private:
+  TARGET_AVX2 static Float Indicator(const __m256i mask) {
+    return _mm256_and_ps(_mm256_castsi256_ps(mask), _mm256_set1_ps(1.f));
+  }
+};
+#endif
+
+#ifdef YDF_LOSS_KERNELS_AVX512
+// 16-wide SIMD operations.
+struct AVX512 {
+  using Float = __m512;
+  static constexpr int kWidth = 16;
+
+  TARGET_AVX512 static Float Load(const float* src) {
+    return _mm512_loadu_ps(src);
+  }
+  TARGET_AVX512 static void Store(float* dst, const Float v) {
+    _mm512_storeu_ps(dst, v);
+  }
+  TARGET_AVX512 static Float Set1(const float v) { return _mm512_set1_ps(v); }
+  TARGET_AVX512 static Float Add(const Float a, const Float b) {
+    return _mm512_add_ps(a, b);
+  }
+  TARGET_AVX512 static Float Sub(const Float a, const Float b) {
+    return _mm512_sub_ps(a, b);
+  }
+  TARGET_AVX512 static Float Mul(const Float a, const Float b) {
+    return _mm512_mul_ps(a, b);
+  }
+  TARGET_AVX512 static Float Div(const Float a, const Float b) {
+    return _mm512_div_ps(a, b);
+  }
+  TARGET_AVX512 static Float Min(const Float a, const Float b) {
+    return _mm512_min_ps(a, b);
+  }
+  TARGET_AVX512 static Float Max(const Float a, const Float b) {
+    return _mm512_max_ps(a, b);
+  }
+  TARGET_AVX512 static Float Floor(const Float a) {
+    return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  }
+
+  TARGET_AVX512 static Float Pow2(const Float n) {
+    const __m512i exponent = _mm512_slli_epi32(
+        _mm512_add_epi32(_mm512_cvttps_epi32(n), _mm512_set1_epi32(127)), 23);
+    return _mm512_castsi512_ps(exponent);
+  }
+
+  TARGET_AVX512 static Float LabelIndicator(const int32_t* labels,
+                                            const int32_t value) {
+    const __m512i v = _mm512_loadu_si512(labels);
+    return Indicator(_mm512_cmpeq_epi32_mask(v, _mm512_set1_epi32(value)));
+  }
+
+  TARGET_AVX512 static Float LabelIndicator(const int16_t* labels,
+                                            const int32_t value) {
+    const __m512i v = _mm512_cvtepi16_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(labels)));
+    return Indicator(_mm512_cmpeq_epi32_mask(v, _mm512_set1_epi32(value)));
+  }
+
+ private:
+  TARGET_AVX512 static Float Indicator(const __mmask16 mask) {
+    return _mm512_maskz_mov_ps(mask, _mm512_set1_ps(1.f));
+  }
+};
+#endif
+
+// Scalar operations with the same interface as the SIMD operations. The
+// operations are applied in the same order as the SIMD implementations so that
+// all the implementations return the same values.
+struct Scalar {
+  using Float = float;
+
+  static Float Set1(const float v) { return v; }
+  static Float Add(const Float a, const Float b) { return a + b; }
+  static Float Sub(const Float a, const Float b) { return a - b; }
+  static Float Mul(const Float a, const Float b) { return a * b; }
+  static Float Div(const Float a, const Float b) { return a / b; }
+  static Float Min(const Float a, const Float b) { return std::min(a, b); }
+  static Float Max(const Float a, const Float b) { return std::max(a, b); }
+  static Float Floor(const Float a) { return std::floor(a); }
+
+  static Float Pow2(const Float n) {
+    const int32_t exponent = (static_cast<int32_t>(n) + 127) << 23;
+    float value;
+    std::memcpy(&value, &exponent, sizeof(value));
+    return value;
+  }
+};
+
+template <typename Ops>
+typename Ops::Float FastExpImp(typename Ops::Float x) {
+  using F = typename Ops::Float;
+  x = Ops::Min(Ops::Max(x, Ops::Set1(kFastExpMinInput)),
+               Ops::Set1(kFastExpMaxInput));
+
+  // n = round(x / log(2)).
+  const F n = Ops::Floor(
+      Ops::Add(Ops::Mul(x, Ops::Set1(kLog2e)), Ops::Set1(0.5f)));
+
+  // r = x - n * log(2).
+  F r = Ops::Sub(x, Ops::Mul(n, Ops::Set1(kLn2Hi)));
+  r = Ops::Sub(r, Ops::Mul(n, Ops::Set1(kLn2Lo)));
+
+  // exp(r) ~= 1 + r + r^2 * P(r).
+  F p = Ops::Set1(kExpP0);
+  p = Ops::Add(Ops::Mul(p, r), Ops::Set1(kExpP1));
+  p = Ops::Add(Ops::Mul(p, r), Ops::Set1(kExpP2));
+  p = Ops::Add(Ops::Mul(p, r), Ops::Set1(kExpP3));
+  p = Ops::Add(Ops::Mul(p, r), Ops::Set1(kExpP4));
+  p = Ops::Add(Ops::Mul(p, r), Ops::Set1(kExpP5));
+  F y = Ops::Mul(p, Ops::Mul(r, r));
+  y = Ops::Add(y, r);
+  y = Ops::Add(y, Ops::Set1(1.f));
+
+  return Ops::Mul(y, Ops::Pow2(n));
+}
+
+// sigmoid(x) = 1 / (1 + exp(-x)).
+template <typename Ops>
+typename Ops::Float SigmoidImp(const typename Ops::Float x) {
+  const auto one = Ops::Set1(1.f);
+  return Ops::Div(
+      one, Ops::Add(one, FastExpImp<Ops>(Ops::Sub(Ops::Set1(0.f), x))));
+}
+
+// The following "*Simd" functions process the examples by groups of
+// "Ops::kWidth" and return the index of the first non-processed example.
+
+template <typename Ops>
+size_t FastExpSimd(const float* src, const size_t num_values, float* dst) {
+  size_t idx = 0;
+  for (; idx + Ops::kWidth <= num_values; idx += Ops::kWidth) {
+    Ops::Store(dst + idx, FastExpImp<Ops>(Ops::Load(src + idx)));
+  }
+  return idx;
+}
+
+template <typename Ops, typename T>
+size_t BinomialGradientsSimd(const T* labels, const float* predictions,
+                             const size_t begin_example_idx,
+                             const size_t end_example_idx, float* gradients,
+                             float* hessians) {
+  const auto one = Ops::Set1(1.f);
+  size_t idx = begin_example_idx;
+  for (; idx + Ops::kWidth <= end_example_idx; idx += Ops::kWidth) {
+    const auto label = Ops::LabelIndicator(labels + idx, 2);
+    const auto proba = SigmoidImp<Ops>(Ops::Load(predictions + idx));
+    Ops::Store(gradients + idx, Ops::Sub(label, proba));
+    Ops::Store(hessians + idx, Ops::Mul(proba, Ops::Sub(one, proba)));
+  }
+  return idx;
+}
+
+template <typename Ops>
+size_t PoissonGradientsSimd(const float* labels, const float* predictions,
+                            const size_t begin_example_idx,
+                            const size_t end_example_idx, float* gradients,
+                            float* hessians) {
+  size_t idx = begin_example_idx;
+  for (; idx + Ops::kWidth <= end_example_idx; idx += Ops::kWidth) {
+    const auto exp_pred = FastExpImp<Ops>(Ops::Load(predictions + idx));
+    Ops::Store(gradients + idx, Ops::Sub(Ops::Load(labels + idx), exp_pred));
+    Ops::Store(hessians + idx, exp_pred);
+  }
+  return idx;
+}
+
+template <typename Ops>
+size_t MeanSquaredErrorGradientsSimd(const float* labels,
+                                     const float* predictions,
+                                     const size_t begin_example_idx,
+                                     const size_t end_example_idx,
+                                     float* gradients, float* hessians) {
+  const auto one = Ops::Set1(1.f);
+  size_t idx = begin_example_idx;
+  for (; idx + Ops::kWidth <= end_example_idx; idx += Ops::kWidth) {
+    Ops::Store(gradients + idx, Ops::Sub(Ops::Load(labels + idx),
+                                         Ops::Load(predictions + idx)));
+    Ops::Store(hessians + idx, one);
+  }
+  return idx;
+}
+
+// Entry points of the SIMD implementations. Each function is compiled for its
+// instruction set, and the generic SIMD code above is inlined in it.
+#ifdef YDF_LOSS_KERNELS_AVX2
+TARGET_AVX2 FLATTEN size_t FastExpAVX2(const float* src,
+                                       const size_t num_values, float* dst) {
+  return FastExpSimd<AVX2>(src, num_values, dst);
+}
+
+template <typename T>
+TARGET_AVX2 FLATTEN size_t BinomialGradientsAVX2(
+    const T* labels, const float* predictions, const size_t begin_example_idx,
+    const size_t end_example_idx, float* gradients, float* hessians) {
+  return BinomialGradientsSimd<AVX2>(labels, predictions, begin_example_idx,
+                                     end_example_idx, gradients, hessians);
+}
+
+TARGET_AVX2 FLATTEN size_t PoissonGradientsAVX2(
+    const float* labels, const float* predictions,
+    const size_t begin_example_idx, const size_t end_example_idx,
+    float* gradients, float* hessians) {
+  return PoissonGradientsSimd<AVX2>(labels, predictions, begin_example_idx,
+                                    end_example_idx, gradients, hessians);
+}
+
+TARGET_AVX2 FLATTEN size_t MeanSquaredErrorGradientsAVX2(
+    const float* labels, const float* predictions,
+    const size_t begin_example_idx, const size_t end_example_idx,
+    float* gradients, float* hessians) {
+  return MeanSquaredErrorGradientsSimd<AVX2>(labels, predictions,
+                                             begin_example_idx, end_example_idx,
+                                             gradients, hessians);
+}
+#endif
+
+#ifdef YDF_LOSS_KERNELS_AVX512
+TARGET_AVX512 FLATTEN size_t FastExpAVX512(const float* src,
+                                           const size_t num_values,
+                                           float* dst) {
+  return FastExpSimd<AVX512>(src, num_values, dst);
+}
+
+template <typename T>
+TARGET_AVX512 FLATTEN size_t BinomialGradientsAVX512(
+    const T* labels, const float* predictions, const size_t begin_example_idx,
+    const size_t end_example_idx, float* gradients, float* hessians) {
+  return BinomialGradientsSimd<AVX512>(labels, predictions, begin_example_idx,
+                                       end_example_idx, gradients, hessians);
+}
+
+TARGET_AVX512 FLATTEN size_t PoissonGradientsAVX512(
+    const float* labels, const float* predictions,
+    const size_t begin_example_idx, const size_t end_example_idx,
+    float* gradients, float* hessians) {
+  return PoissonGradientsSimd<AVX512>(labels, predictions, begin_example_idx,
+                                      end_example_idx, gradients, hessians);
+}
+
+TARGET_AVX512 FLATTEN size_t MeanSquaredErrorGradientsAVX512(
+    const float* labels, const float* predictions,
+    const size_t begin_example_idx, const size_t end_example_idx,
+    float* gradients, float* hessians) {
+  return MeanSquaredErrorGradientsSimd<AVX512>(
+      labels, predictions, begin_example_idx, end_example_idx, gradients,
+      hessians);
+}
+#endif
+
+// Checks that the values in [begin_idx, end_idx) are finite. This is a no-op in
+// release mode.
+void DCheckAreFinite(const std::vector<float>& values, const size_t begin_idx,
+                     const size_t end_idx) {
+#ifndef NDEBUG
+  for (size_t idx = begin_idx; idx < end_idx; idx++) {
+    DCheckIsFinite(values[idx]);
+  }
+#endif
+}
+
+}  // namespace
+
+float FastExp(const float x) { return FastExpImp<Scalar>(x); }
+
+void FastExp(const float* src, const size_t num_values, float* dst) {
+  size_t idx = 0;
+  switch (GetInstructionSet()) {
+#ifdef YDF_LOSS_KERNELS_AVX512
+    case InstructionSet::kAVX512:
+      idx = FastExpAVX512(src, num_values, dst);
+      break;
+#endif
+#ifdef YDF_LOSS_KERNELS_AVX2
+    case InstructionSet::kAVX2:
+      idx = FastExpAVX2(src, num_values, dst);
+      break;
+#endif
+    default:
+      break;
+  }
+  for (; idx < num_values; idx++) {
+    dst[idx] = FastExp(src[idx]);
+  }
+}
+
+absl::string_view ActiveInstructionSet() {
+  switch (GetInstructionSet()) {
+    case InstructionSet::kAVX512:
+      return "AVX512";
+    case InstructionSet::kAVX2:
+      return "AVX2";
+    case InstructionSet::kScalar:
+      return "SCALAR";
+  }
+  return "SCALAR";
+}
+
+template <typename T>
+void BinomialGradients(const std::vector<T>& labels,
+                       const std::vector<float>& predictions,
+                       const size_t begin_example_idx,
+                       const size_t end_example_idx,
+                       std::vector<float>* gradient_data,
+                       std::vector<float>* hessian_data) {
+  DCHECK_EQ(gradient_data->size(), hessian_data->size());
+  size_t example_idx = begin_example_idx;
+  switch (GetInstructionSet()) {
+#ifdef YDF_LOSS_KERNELS_AVX512
+    case InstructionSet::kAVX512:
+      example_idx = BinomialGradientsAVX512(
+          labels.data(), predictions.data(), begin_example_idx,
+          end_example_idx, gradient_data->data(), hessian_data->data());
+      break;
+#endif
+#ifdef YDF_LOSS_KERNELS_AVX2
+    case InstructionSet::kAVX2:
+      example_idx = BinomialGradientsAVX2(
+          labels.data(), predictions.data(), begin_example_idx,
+          end_example_idx, gradient_data->data(), hessian_data->data());
+      break;
+#endif
+    default:
+      break;
+  }
+  for (; example_idx < end_example_idx; example_idx++) {
+    const float label = (labels[example_idx] == 2) ? 1.f : 0.f;
+    const float proba = SigmoidImp<Scalar>(predictions[example_idx]);
+    (*gradient_data)[example_idx] = label - proba;
+    (*hessian_data)[example_idx] = proba * (1.f - proba);
+  }
+  DCheckAreFinite(predictions, begin_example_idx, end_example_idx);
+  DCheckAreFinite(*gradient_data, begin_example_idx, end_example_idx);
+  DCheckAreFinite(*hessian_data, begin_example_idx, end_example_idx);
+}
+
+template <typename T>
+void MultinomialGradients(const std::vector<T>& labels,
+                          const std::vector<float>& predictions,
+                          const size_t begin_example_idx,
+                          const size_t end_example_idx,
+                          const GradientDataRef& gradients) {
+  const int num_classes = gradients.size();
+  std::vector<float> exp_buffer(kMultinomialBlockSize * num_classes);
+
+  for (size_t block_begin_idx = begin_example_idx;
+       block_begin_idx < end_example_idx;
+       block_begin_idx += kMultinomialBlockSize) {
+    const size_t block_end_idx =
+        std::min(block_begin_idx + kMultinomialBlockSize, end_example_idx);
+
+    // The exponential of the predictions of the block are computed with SIMD
+    // instructions. The predictions of the block are contiguous.
+    FastExp(predictions.data() + block_begin_idx * num_classes,
+            (block_end_idx - block_begin_idx) * num_classes,
+            exp_buffer.data());
+
+    for (size_t example_idx = block_begin_idx; example_idx < block_end_idx;
+         example_idx++) {
+      const float* exp_values =
+          exp_buffer.data() + (example_idx - block_begin_idx) * num_classes;
+      float sum_exp = 0;
+      for (int grad_idx = 0; grad_idx < num_classes; grad_idx++) {
+        sum_exp += exp_values[grad_idx];
+      }
+      const float normalization = 1.f / sum_exp;
+      const int label_cat = labels[example_idx];
+      for (int grad_idx = 0; grad_idx < num_classes; grad_idx++) {
+        const float label = (label_cat == (grad_idx + 1)) ? 1.f : 0.f;
+        const float prediction = exp_values[grad_idx] * normalization;
+        DCheckIsFinite(prediction);
+        const float grad = label - prediction;
+        const float abs_grad = std::abs(grad);
+        DCheckIsFinite(grad);
+        (*gradients[grad_idx].gradient)[example_idx] = grad;
+        (*gradients[grad_idx].hessian)[example_idx] = abs_grad * (1 - abs_grad);
+      }
+    }
+  }
+}
+
+void PoissonGradients(const std::vector<float>& labels,
+                      const std::vector<float>& predictions,
+                      const size_t begin_example_idx,
+                      const size_t end_example_idx,
+                      std::vector<float>* gradient_data,
+                      std::vector<float>* hessian_data) {
+  DCHECK_EQ(gradient_data->size(), hessian_data->size());
+  size_t example_idx = begin_example_idx;
+  switch (GetInstructionSet()) {
+#ifdef YDF_LOSS_KERNELS_AVX512
+    case InstructionSet::kAVX512:
+      example_idx = PoissonGradientsAVX512(
+          labels.data(), predictions.data(), begin_example_idx,
+          end_example_idx, gradient_data->data(), hessian_data->data());
+      break;
+#endif
+#ifdef YDF_LOSS_KERNELS_AVX2
+    case InstructionSet::kAVX2:
+      example_idx = PoissonGradientsAVX2(
+          labels.data(), predictions.data(), begin_example_idx,
+          end_example_idx, gradient_data->data(), hessian_data->data());
+      break;
+#endif
+    default:
+      break;
+  }
+  for (; example_idx < end_example_idx; example_idx++) {
+    const float exp_pred = FastExp(predictions[example_idx]);
+    (*gradient_data)[example_idx] = labels[example_idx] - exp_pred;
+    (*hessian_data)[example_idx] = exp_pred;
+  }
+  DCheckAreFinite(predictions, begin_example_idx, end_example_idx);
+  DCheckAreFinite(*gradient_data, begin_example_idx, end_example_idx);
+  DCheckAreFinite(*hessian_data, begin_example_idx, end_example_idx);
+}
+
+void MeanSquaredErrorGradients(const std::vector<float>& labels,
+                               const std::vector<float>& predictions,
+                               const size_t begin_example_idx,
+                               const size_t end_example_idx,
+                               std::vector<float>* gradient_data,
+                               std::vector<float>* hessian_data) {
+  DCHECK_EQ(gradient_data->size(), hessian_data->size());
+  size_t example_idx = begin_example_idx;
+  switch (GetInstructionSet()) {
+#ifdef YDF_LOSS_KERNELS_AVX512
+    case InstructionSet::kAVX512:
+      example_idx = MeanSquaredErrorGradientsAVX512(
+          labels.data(), predictions.data(), begin_example_idx,
+          end_example_idx, gradient_data->data(), hessian_data->data());
+      break;
+#endif
+#ifdef YDF_LOSS_KERNELS_AVX2
+    case InstructionSet::kAVX2:
+      example_idx = MeanSquaredErrorGradientsAVX2(
+          labels.data(), predictions.data(), begin_example_idx,
+          end_example_idx, gradient_data->data(), hessian_data->data());
+      break;
+#endif
+    default:
+      break;
+  }
+  for (; example_idx < end_example_idx; example_idx++) {
+    (*gradient_data)[example_idx] =
+        labels[example_idx] - predictions[example_idx];
+    (*hessian_data)[example_idx] = 1.f;
+  }
+  DCheckAreFinite(predictions, begin_example_idx, end_example_idx);
+  DCheckAreFinite(*gradient_data, begin_example_idx, end_example_idx);
+  DCheckAreFinite(*hessian_data, begin_example_idx, end_example_idx);
+}
+
+template void BinomialGradients(const std::vector<int32_t>& labels,
+                                const std::vector<float>& predictions,
+                                size_t begin_example_idx,
+                                size_t end_example_idx,
+                                std::vector<float>* gradient_data,
+                                std::vector<float>* hessian_data);
+template void BinomialGradients(const std::vector<int16_t>& labels,
+                                const std::vector<float>& predictions,
+                                size_t begin_example_idx,
+                                size_t end_example_idx,
+                                std::vector<float>* gradient_data,
+                                std::vector<float>* hessian_data);
+template void MultinomialGradients(const std::vector<int32_t>& labels,
+                                   const std::vector<float>& predictions,
+                                   size_t begin_example_idx,
+                                   size_t end_example_idx,
+                                   const GradientDataRef& gradients);
+template void MultinomialGradients(const std::vector<int16_t>& labels,
+                                   const std::vector<float>& predictions,
+                                   size_t begin_example_idx,
+                                   size_t end_example_idx,
+                                   const GradientDataRef& gradients);
+
+}  // namespace kernels
+}  // namespace gradient_boosted_trees
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Vectorized kernels computing the gradients and hessians of the losses.
+//
+// Each kernel processes a contiguous range of examples [begin_example_idx,
+// end_example_idx). Kernels are independent for different ranges and can be
+// called concurrently on non-overlapping ranges.
+//
+// If the CPU supports AVX-512 (resp. AVX2), the kernels process 16 (resp. 8)
+// examples at a time. The instruction set is selected at runtime: With GCC and
+// Clang on x86-64, the binary does not need to be compiled with "-mavx2" or
+// "-mavx512f". Otherwise, a scalar implementation of the same algorithm is
+// used.
+// All the implementations use "FastExp" instead of "std::exp".
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_LEARNER_GRADIENT_BOOSTED_TREES_LOSS_LOSS_KERNELS_H_
+#define YGGDRASIL_DECISION_FORESTS_LEARNER_GRADIENT_BOOSTED_TREES_LOSS_LOSS_KERNELS_H_
+
+#include <stddef.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace gradient_boosted_trees {
+namespace kernels {
+
+// Range of the inputs of "FastExp". Inputs outside of this range are clamped.
+// Unlike "std::exp", "FastExp" never returns zero, a sub-normal value, or
+// infinity.
+constexpr float kFastExpMinInput = -87.33654f;
+constexpr float kFastExpMaxInput = 88.37626f;
+
+// Maximum relative error of "FastExp" compared to "std::exp" (computed in
+// double precision) for inputs in [kFastExpMinInput, kFastExpMaxInput]. This is
+// ~1 ulp. The sigmoid and softmax computed with "FastExp" have the same
+// relative error bound, up to the rounding of one division.
+constexpr float kFastExpMaxRelativeError = 1.5e-7f;
+
+// Polynomial approximation of exp(x). Same result as the SIMD implementations.
+float FastExp(float x);
+
+// dst[i] = FastExp(src[i]) for i in [0, num_values). "src" and "dst" can be
+// the same buffer.
+void FastExp(const float* src, size_t num_values, float* dst);
+
+// Name of the instruction set used by the kernels: "AVX512", "AVX2" or
+// "SCALAR".
+absl::string_view ActiveInstructionSet();
+
+// Binomial log likelihood. "labels" are in {1,2} (2 is the positive class).
+//   gradient = label - sigmoid(prediction)
+//   hessian = sigmoid(prediction) * (1 - sigmoid(prediction))
+template <typename T>
+void BinomialGradients(const std::vector<T>& labels,
+                       const std::vector<float>& predictions,
+                       size_t begin_example_idx, size_t end_example_idx,
+                       std::vector<float>* gradient_data,
+                       std::vector<float>* hessian_data);
+
+// Multinomial log likelihood with "gradients.size()" classes. "labels" are in
+// [1, num_classes]. "predictions" are stored example-major.
+//   gradient_i = label_i - softmax(prediction)_i
+//   hessian_i = |gradient_i| * (1 - |gradient_i|)
+template <typename T>
+void MultinomialGradients(const std::vector<T>& labels,
+                          const std::vector<float>& predictions,
+                          size_t begin_example_idx, size_t end_example_idx,
+                          const GradientDataRef& gradients);
+
+// Poisson.
+//   gradient = label - exp(prediction)
+//   hessian = exp(prediction)
+void PoissonGradients(const std::vector<float>& labels,
+                      const std::vector<float>& predictions,
+                      size_t begin_example_idx, size_t end_example_idx,
+                      std::vector<float>* gradient_data,
+                      std::vector<float>* hessian_data);
+
+// Mean squared error.
+//   gradient = label - prediction
+//   hessian = 1
+void MeanSquaredErrorGradients(const std::vector<float>& labels,
+                               const std::vector<float>& predictions,
+                               size_t begin_example_idx,
+                               size_t end_example_idx,
+                               std::vector<float>* gradient_data,
+                               std::vector<float>* hessian_data);
+
+}  // namespace kernels
+}  // namespace gradient_boosted_trees
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_LEARNER_GRADIENT_BOOSTED_TREES_LOSS_LOSS_KERNELS_H_
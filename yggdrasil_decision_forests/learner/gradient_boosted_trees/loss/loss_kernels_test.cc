@@ -0,0 +1,211 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_kernels.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
+#include "yggdrasil_decision_forests/utils/logging.h"
+#include "yggdrasil_decision_forests/utils/test.h"
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace gradient_boosted_trees {
+namespace kernels {
+namespace {
+
+using ::testing::AnyOf;
+using ::testing::Eq;
+using ::testing::FloatNear;
+
+// Relative precision of the kernels compared to a "std::exp" reference.
+constexpr float kPrecision = 4 * kFastExpMaxRelativeError;
+
+// Predictions covering the usual range of values, with a number of values that
+// is not a multiple of the SIMD width.
+std::vector<float> TestPredictions(const int num_values) {
+  std::vector<float> values(num_values);
+  for (int i = 0; i < num_values; i++) {
+    values[i] = -20.f + 40.f * i / num_values;
+  }
+  return values;
+}
+
+TEST(LossKernels, ActiveInstructionSet) {
+  EXPECT_THAT(ActiveInstructionSet(),
+              AnyOf(Eq("AVX512"), Eq("AVX2"), Eq("SCALAR")));
+  YDF_LOG(INFO) << "Instruction set: " << ActiveInstructionSet();
+}
+
+TEST(LossKernels, RuntimeInstructionSetSelection) {
+  // The SIMD kernels are available even if the test is not compiled with
+  // "-mavx2" or "-mavx512f".
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+  if (__builtin_cpu_supports("avx512f")) {
+    EXPECT_EQ(ActiveInstructionSet(), "AVX512");
+  } else if (__builtin_cpu_supports("avx2")) {
+    EXPECT_EQ(ActiveInstructionSet(), "AVX2");
+  } else {
+    EXPECT_EQ(ActiveInstructionSet(), "SCALAR");
+  }
+#endif
+}
+
+TEST(LossKernels, FastExpPrecision) {
+  for (float x = kFastExpMinInput; x <= kFastExpMaxInput; x += 0.0137f) {
+    const double expected = std::exp(static_cast<double>(x));
+    const double value = FastExp(x);
+    EXPECT_LE(std::abs(value - expected) / expected, kFastExpMaxRelativeError)
+        << "x=" << x;
+  }
+  EXPECT_EQ(FastExp(0.f), 1.f);
+}
+
+TEST(LossKernels, FastExpClamping) {
+  EXPECT_EQ(FastExp(-1000.f), FastExp(kFastExpMinInput));
+  EXPECT_EQ(FastExp(1000.f), FastExp(kFastExpMaxInput));
+  EXPECT_GT(FastExp(-1000.f), 0.f);
+  EXPECT_TRUE(std::isfinite(FastExp(1000.f)));
+}
+
+TEST(LossKernels, FastExpArrayMatchesScalar) {
+  const auto src = TestPredictions(1001);
+  std::vector<float> dst(src.size());
+  FastExp(src.data(), src.size(), dst.data());
+  for (int i = 0; i < src.size(); i++) {
+    EXPECT_EQ(dst[i], FastExp(src[i]));
+  }
+
+  // In place.
+  auto values = src;
+  FastExp(values.data(), values.size(), values.data());
+  EXPECT_EQ(values, dst);
+}
+
+TEST(LossKernels, Binomial) {
+  const auto predictions = TestPredictions(101);
+  std::vector<int32_t> labels(predictions.size());
+  for (int i = 0; i < labels.size(); i++) {
+    labels[i] = 1 + (i % 2);
+  }
+  std::vector<float> gradients(predictions.size(), -1.f);
+  std::vector<float> hessians(predictions.size(), -1.f);
+
+  // Only process a sub-range.
+  BinomialGradients(labels, predictions, 3, 98, &gradients, &hessians);
+
+  for (int i = 0; i < predictions.size(); i++) {
+    if (i < 3 || i >= 98) {
+      EXPECT_EQ(gradients[i], -1.f);
+      EXPECT_EQ(hessians[i], -1.f);
+      continue;
+    }
+    const float proba = 1. / (1. + std::exp(-predictions[i]));
+    const float label = labels[i] == 2 ? 1.f : 0.f;
+    EXPECT_THAT(gradients[i], FloatNear(label - proba, kPrecision));
+    EXPECT_THAT(hessians[i], FloatNear(proba * (1 - proba), kPrecision));
+  }
+}
+
+TEST(LossKernels, Multinomial) {
+  const int num_classes = 3;
+  const int num_examples = 37;
+  const auto predictions = TestPredictions(num_examples * num_classes);
+  std::vector<int16_t> labels(num_examples);
+  for (int i = 0; i < labels.size(); i++) {
+    labels[i] = 1 + (i % num_classes);
+  }
+
+  std::vector<std::vector<float>> gradients(
+      num_classes, std::vector<float>(num_examples));
+  std::vector<std::vector<float>> hessians(num_classes,
+                                           std::vector<float>(num_examples));
+  GradientDataRef gradient_refs(num_classes);
+  for (int class_idx = 0; class_idx < num_classes; class_idx++) {
+    gradient_refs[class_idx] = {&gradients[class_idx], &hessians[class_idx]};
+  }
+
+  MultinomialGradients(labels, predictions, 0, num_examples, gradient_refs);
+
+  for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+    double sum_exp = 0;
+    for (int class_idx = 0; class_idx < num_classes; class_idx++) {
+      sum_exp += std::exp(predictions[example_idx * num_classes + class_idx]);
+    }
+    for (int class_idx = 0; class_idx < num_classes; class_idx++) {
+      const float proba =
+          std::exp(predictions[example_idx * num_classes + class_idx]) /
+          sum_exp;
+      const float label = labels[example_idx] == class_idx + 1 ? 1.f : 0.f;
+      const float grad = label - proba;
+      EXPECT_THAT(gradients[class_idx][example_idx],
+                  FloatNear(grad, kPrecision));
+      EXPECT_THAT(
+          hessians[class_idx][example_idx],
+          FloatNear(std::abs(grad) * (1 - std::abs(grad)), kPrecision));
+    }
+  }
+}
+
+TEST(LossKernels, Poisson) {
+  const std::vector<float> predictions = TestPredictions(53);
+  std::vector<float> labels(predictions.size());
+  for (int i = 0; i < labels.size(); i++) {
+    labels[i] = i % 5;
+  }
+  std::vector<float> gradients(predictions.size());
+  std::vector<float> hessians(predictions.size());
+
+  PoissonGradients(labels, predictions, 0, predictions.size(), &gradients,
+                   &hessians);
+
+  for (int i = 0; i < predictions.size(); i++) {
+    const float exp_pred = std::exp(predictions[i]);
+    EXPECT_THAT(hessians[i],
+                FloatNear(exp_pred, 2 * exp_pred * kFastExpMaxRelativeError));
+    EXPECT_THAT(gradients[i],
+                FloatNear(labels[i] - exp_pred,
+                          2 * exp_pred * kFastExpMaxRelativeError + kPrecision));
+  }
+}
+
+TEST(LossKernels, MeanSquaredError) {
+  const std::vector<float> predictions = TestPredictions(29);
+  std::vector<float> labels(predictions.size());
+  for (int i = 0; i < labels.size(); i++) {
+    labels[i] = i;
+  }
+  std::vector<float> gradients(predictions.size());
+  std::vector<float> hessians(predictions.size());
+
+  MeanSquaredErrorGradients(labels, predictions, 0, predictions.size(),
+                            &gradients, &hessians);
+
+  for (int i = 0; i < predictions.size(); i++) {
+    EXPECT_EQ(gradients[i], labels[i] - predictions[i]);
+    EXPECT_EQ(hessians[i], 1.f);
+  }
+}
+
+}  // namespace
+}  // namespace kernels
+}  // namespace gradient_boosted_trees
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
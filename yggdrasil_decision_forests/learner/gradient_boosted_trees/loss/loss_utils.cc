@@ -15,6 +15,8 @@
 
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_utils.h"
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -27,6 +29,7 @@
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/utils/compatibility.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
 
 namespace yggdrasil_decision_forests {
 namespace model {
@@ -168,32 +171,43 @@ absl::Status SetLeafValueWithNewtonRaphsonStep(
   return absl::OkStatus();
 }
 
-void UpdatePredictionWithSingleUnivariateTree(
+namespace {
+
+// Minimum number of examples processed by each thread in "UpdatePredictions".
+// Smaller blocks are dominated by the scheduling overhead.
+constexpr UnsignedExampleIdx kMinNumExamplesPerBlock = 1000;
+
+// Adds the predictions of "tree" to "predictions" for the examples in
+// [begin_example_idx, end_example_idx). Returns the sum of the absolute value
+// of the added predictions.
+double UpdatePredictionWithSingleUnivariateTree(
     const dataset::VerticalDataset& dataset,
-    const decision_tree::DecisionTree& tree, std::vector<float>* predictions,
-    double* mean_abs_prediction) {
+    const decision_tree::DecisionTree& tree,
+    const UnsignedExampleIdx begin_example_idx,
+    const UnsignedExampleIdx end_example_idx,
+    std::vector<float>* predictions) {
   double sum_abs_predictions = 0;
-  const UnsignedExampleIdx num_examples = dataset.nrow();
-  for (UnsignedExampleIdx example_idx = 0; example_idx < num_examples;
-       example_idx++) {
+  for (UnsignedExampleIdx example_idx = begin_example_idx;
+       example_idx < end_example_idx; example_idx++) {
     const auto& leaf = tree.GetLeaf(dataset, example_idx);
     (*predictions)[example_idx] += leaf.regressor().top_value();
     sum_abs_predictions += std::abs(leaf.regressor().top_value());
   }
-  if (mean_abs_prediction) {
-    *mean_abs_prediction = sum_abs_predictions / num_examples;
-  }
+  return sum_abs_predictions;
 }
 
-void UpdatePredictionWithMultipleUnivariateTrees(
+// Same as "UpdatePredictionWithSingleUnivariateTree" with one tree per
+// prediction dimension.
+double UpdatePredictionWithMultipleUnivariateTrees(
     const dataset::VerticalDataset& dataset,
     const std::vector<const decision_tree::DecisionTree*>& trees,
-    std::vector<float>* predictions, double* mean_abs_prediction) {
+    const UnsignedExampleIdx begin_example_idx,
+    const UnsignedExampleIdx end_example_idx,
+    std::vector<float>* predictions) {
   double sum_abs_predictions = 0;
   const int num_trees = trees.size();
-  const UnsignedExampleIdx num_examples = dataset.nrow();
-  for (UnsignedExampleIdx example_idx = 0; example_idx < num_examples;
-       example_idx++) {
+  for (UnsignedExampleIdx example_idx = begin_example_idx;
+       example_idx < end_example_idx; example_idx++) {
     for (int grad_idx = 0; grad_idx < num_trees; grad_idx++) {
       const auto& leaf = trees[grad_idx]->GetLeaf(dataset, example_idx);
       (*predictions)[grad_idx + example_idx * num_trees] +=
@@ -201,25 +215,62 @@ void UpdatePredictionWithMultipleUnivariateTrees(
       sum_abs_predictions += std::abs(leaf.regressor().top_value());
     }
   }
-  if (mean_abs_prediction) {
-    if (num_examples == 0) {
-      *mean_abs_prediction = 0;
-    } else {
-      *mean_abs_prediction = sum_abs_predictions / num_examples;
-    }
+  return sum_abs_predictions;
+}
+
+double UpdatePredictionsInRange(
+    const std::vector<const decision_tree::DecisionTree*>& trees,
+    const dataset::VerticalDataset& dataset,
+    const UnsignedExampleIdx begin_example_idx,
+    const UnsignedExampleIdx end_example_idx,
+    std::vector<float>* predictions) {
+  if (trees.size() == 1) {
+    return UpdatePredictionWithSingleUnivariateTree(
+        dataset, *trees.front(), begin_example_idx, end_example_idx,
+        predictions);
+  } else {
+    return UpdatePredictionWithMultipleUnivariateTrees(
+        dataset, trees, begin_example_idx, end_example_idx, predictions);
   }
 }
 
+}  // namespace
+
 absl::Status UpdatePredictions(
     const std::vector<const decision_tree::DecisionTree*>& trees,
     const dataset::VerticalDataset& dataset, std::vector<float>* predictions,
-    double* mean_abs_prediction) {
-  if (trees.size() == 1) {
-    UpdatePredictionWithSingleUnivariateTree(dataset, *trees.front(),
-                                             predictions, mean_abs_prediction);
+    double* mean_abs_prediction, utils::concurrency::ThreadPool* thread_pool) {
+  const UnsignedExampleIdx num_examples = dataset.nrow();
+  double sum_abs_predictions = 0;
+
+  if (thread_pool == nullptr || num_examples < kMinNumExamplesPerBlock * 2) {
+    sum_abs_predictions = UpdatePredictionsInRange(trees, dataset, 0,
+                                                   num_examples, predictions);
   } else {
-    UpdatePredictionWithMultipleUnivariateTrees(dataset, trees, predictions,
-                                                mean_abs_prediction);
+    // Each block of examples is processed by a different thread. The blocks
+    // write to non-overlapping parts of "predictions".
+    const size_t num_blocks =
+        std::min<size_t>(thread_pool->num_threads(),
+                         num_examples / kMinNumExamplesPerBlock);
+    std::vector<double> sum_abs_predictions_per_block(num_blocks, 0);
+    utils::concurrency::ConcurrentForLoop(
+        num_blocks, thread_pool, num_examples,
+        [&trees, &dataset, predictions, &sum_abs_predictions_per_block](
+            size_t block_idx, size_t begin_idx, size_t end_idx) -> void {
+          sum_abs_predictions_per_block[block_idx] = UpdatePredictionsInRange(
+              trees, dataset, begin_idx, end_idx, predictions);
+        });
+    for (const double value : sum_abs_predictions_per_block) {
+      sum_abs_predictions += value;
+    }
+  }
+
+  if (mean_abs_prediction) {
+    if (num_examples == 0) {
+      *mean_abs_prediction = 0;
+    } else {
+      *mean_abs_prediction = sum_abs_predictions / num_examples;
+    }
   }
   return absl::OkStatus();
 }
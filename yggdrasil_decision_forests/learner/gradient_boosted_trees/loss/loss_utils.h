@@ -29,6 +29,7 @@
 #include "yggdrasil_decision_forests/learner/gradient_boosted_trees/loss/loss_interface.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
 #include "yggdrasil_decision_forests/utils/status_macros.h"
 
 namespace yggdrasil_decision_forests {
@@ -84,10 +85,15 @@ absl::Status SetLeafValueWithNewtonRaphsonStep(
     const std::vector<float>& weights, const GradientData& gradients,
     decision_tree::NodeWithChildren* node);
 
+// Adds the predictions of "trees" (one tree per prediction dimension) to
+// "predictions". If "mean_abs_prediction" is set, it is filled with the mean
+// absolute value of the added predictions. If "thread_pool" is set, the
+// examples are processed in parallel by blocks.
 absl::Status UpdatePredictions(
     const std::vector<const decision_tree::DecisionTree*>& trees,
     const dataset::VerticalDataset& dataset, std::vector<float>* predictions,
-    double* mean_abs_prediction);
+    double* mean_abs_prediction,
+    utils::concurrency::ThreadPool* thread_pool = nullptr);
 
 }  // namespace gradient_boosted_trees
 }  // namespace model
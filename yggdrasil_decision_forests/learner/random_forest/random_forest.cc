@@ -461,7 +461,8 @@ RandomForestLearner::TrainWithStatus(
     }
   }
   for (int tree_idx = 0; tree_idx < rf_config.num_trees(); tree_idx++) {
-    mdl->AddTree(absl::make_unique<decision_tree::DecisionTree>());
+    mdl->AddTree(absl::make_unique<decision_tree::DecisionTree>(
+        rf_config.decision_tree().internal().use_node_arena()));
   }
 
   // OOB (out-of-bag) predictions.
@@ -294,6 +294,17 @@ TEST_F(RandomForestOnAdult, Honest) {
   EXPECT_NEAR(metric::LogLoss(evaluation_), 0.333, 0.04);
 }
 
+TEST_F(RandomForestOnAdult, NodeArena) {
+  auto* rf_config = train_config_.MutableExtension(
+      random_forest::proto::random_forest_config);
+  rf_config->mutable_decision_tree()->mutable_internal()->set_use_node_arena(
+      true);
+
+  TrainAndEvaluateModel();
+  EXPECT_NEAR(metric::Accuracy(evaluation_), 0.860, 0.01);
+  EXPECT_NEAR(metric::LogLoss(evaluation_), 0.333, 0.04);
+}
+
 // Extremely Randomize Trees on Adult.
 TEST_F(RandomForestOnAdult, ExtremelyRandomizeTrees) {
   auto* rf_config = train_config_.MutableExtension(
@@ -21,6 +21,7 @@
 #ifndef YGGDRASIL_DECISION_FORESTS_MODEL_ABSTRACT_MODEL_H_
 #define YGGDRASIL_DECISION_FORESTS_MODEL_ABSTRACT_MODEL_H_
 
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <string>
@@ -56,6 +57,46 @@ struct ModelIOOptions {
   // auto-detected (if possible) based on the existing files in the given
   // directory.
   absl::optional<std::string> file_prefix;
+
+  // Number of threads used to load the trees of decision forest models saved
+  // in several shards.
+  int num_threads = 6;
+};
+
+// Options to compute SHAP values. See "AbstractModel::ComputeShapValues".
+struct ShapOptions {
+  // Number of threads used for the computation.
+  int num_threads = 6;
+
+  // If set, computes interventional SHAP values: The missing features take the
+  // values of the examples of this dataset, and the SHAP values are averaged
+  // over its examples. The cost is linear in the number of background
+  // examples. If not set, computes path-dependent SHAP values: The missing
+  // features are marginalized with the training statistics of the model.
+  const dataset::VerticalDataset* background = nullptr;
+};
+
+// SHAP values of a set of examples.
+struct ShapValues {
+  int64_t num_examples = 0;
+  int num_columns = 0;
+  int num_outputs = 0;
+
+  // "values[(example_idx * num_columns + column_idx) * num_outputs +
+  // output_idx]" is the SHAP value of the column "column_idx" (index in the
+  // dataspec) on the output "output_idx" for the example "example_idx". The
+  // columns that are not input features have a zero SHAP value.
+  std::vector<float> values;
+
+  // Expected value of each output. For each example, the sum of the SHAP
+  // values and of the expected value of an output is equal to the output.
+  std::vector<float> expected_values;
+
+  float value(const int64_t example_idx, const int column_idx,
+              const int output_idx) const {
+    return values[(example_idx * num_columns + column_idx) * num_outputs +
+                  output_idx];
+  }
 };
 
 class AbstractModel {
@@ -297,6 +338,18 @@ class AbstractModel {
   virtual void Predict(const dataset::proto::Example& example,
                        proto::Prediction* prediction) const = 0;
 
+  // Computes the SHAP values of the examples in "dataset" (see "ShapValues").
+  // The SHAP values explain the raw output of the model before any activation
+  // function (e.g. the logits of a Gradient Boosted Trees classifier). The
+  // outputs are defined in the documentation of each model. Returns an
+  // "Unimplemented" error if the model does not support SHAP values.
+  virtual absl::Status ComputeShapValues(
+      const dataset::VerticalDataset& dataset, const ShapOptions& options,
+      ShapValues* shap_values) const {
+    return absl::UnimplementedError(
+        "The model does not support the computation of SHAP values");
+  }
+
   // Set the ground truth values in a Prediction proto. Ground truth values
   // can be defined by fields like label or example weight. This depends on the
   // model "type" (see Prediction proto). This step is required to evaluate the
@@ -18,10 +18,18 @@
 #ifndef YGGDRASIL_DECISION_FORESTS_MODEL_DECISION_FOREST_INTERFACE_H_
 #define YGGDRASIL_DECISION_FORESTS_MODEL_DECISION_FOREST_INTERFACE_H_
 
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include "absl/status/status.h"
 #include "absl/types/span.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.pb.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/proximity.h"
 
 namespace yggdrasil_decision_forests {
 namespace model {
@@ -43,6 +51,39 @@ class DecisionForestInterface {
                                         dataset::VerticalDataset::row_t row_idx,
                                         absl::Span<int32_t> leaves) const = 0;
 
+  // Computes the prediction of the model from the leaves reached by an
+  // example, one leaf per tree in the order of "decision_trees()" (e.g. the
+  // leaves returned by "DecisionTree::GetLeaf"). Gives the same prediction as
+  // "AbstractModel::Predict" on this example.
+  //
+  // This method should be called with "leaves" containing exactly "num_trees"
+  // elements.
+  virtual absl::Status PredictFromLeaves(
+      absl::Span<const decision_tree::proto::Node* const> leaves,
+      model::proto::Prediction* prediction) const = 0;
+
+  // Incremental computation of the prediction from the leaves. The outputs of
+  // the leaves are summed in an accumulator of "LeafAccumulatorSize()" values
+  // (initially zero) with "AddLeafToAccumulator", one leaf per tree, and the
+  // prediction is computed from the accumulator with "PredictFromAccumulator".
+  // The leaf of a tree is replaced by removing its output (weight=-1) and
+  // adding the output of the new leaf (weight=1). Gives the same prediction as
+  // "PredictFromLeaves", up to the floating point rounding.
+  virtual int LeafAccumulatorSize() const = 0;
+
+  virtual void AddLeafToAccumulator(int tree_idx,
+                                    const decision_tree::proto::Node& leaf,
+                                    double weight,
+                                    absl::Span<double> accumulator) const = 0;
+
+  virtual absl::Status PredictFromAccumulator(
+      absl::Span<const double> accumulator,
+      model::proto::Prediction* prediction) const = 0;
+
+  // The trees of the model.
+  virtual const std::vector<std::unique_ptr<decision_tree::DecisionTree>>&
+  decision_trees() const = 0;
+
   // Computes the pairwise distance between examples in "dataset1" and
   // "dataset2".
   //
@@ -61,10 +102,29 @@ class DecisionForestInterface {
     return absl::UnimplementedError("Distance is not implemented");
   }
 
+  // Finds, for each example in "dataset1", the closest examples in "dataset2"
+  // according to "Distance". Unlike "Distance", the dense distance matrix is
+  // never materialized.
+  //
+  // "neighbors[i]" will be the neighbours of the i-th example of "dataset1".
+  virtual absl::Status NearestNeighbors(
+      const dataset::VerticalDataset& dataset1,
+      const dataset::VerticalDataset& dataset2,
+      const decision_tree::NearestNeighborsOptions& options,
+      std::vector<std::vector<decision_tree::Neighbor>>* neighbors) const {
+    return absl::UnimplementedError("NearestNeighbors is not implemented");
+  }
+
   // Tests if the model satisfy the condition defined in
   // "CheckStructureOptions".
   virtual bool CheckStructure(
       const decision_tree::CheckStructureOptions& options) const = 0;
+
+  // Number of times each feature is used in the model conditions. Returns a
+  // map, indexed by feature index, and counting the number of time a feature
+  // is used.
+  virtual void CountFeatureUsage(
+      std::unordered_map<int32_t, int64_t>* feature_usage) const = 0;
 };
 
 }  // namespace model
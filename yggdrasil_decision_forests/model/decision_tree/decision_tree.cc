@@ -23,6 +23,7 @@
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <new>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -333,7 +334,7 @@ size_t DecisionTree::EstimateModelSizeInBytes() const {
 }
 
 size_t NodeWithChildren::EstimateSizeInByte() const {
-  size_t size = node_.SpaceUsedLong();
+  size_t size = node_->SpaceUsedLong();
   if (!IsLeaf()) {
     size += children_[0]->EstimateSizeInByte();
     size += children_[1]->EstimateSizeInByte();
@@ -472,9 +473,29 @@ absl::Status DecisionTree::Validate(
   return absl::OkStatus();
 }
 
+DecisionTree::DecisionTree(const bool use_arena) {
+  if (use_arena) {
+    arena_ = absl::make_unique<NodeArena>();
+  }
+}
+
+DecisionTree& DecisionTree::operator=(DecisionTree&& other) {
+  if (this != &other) {
+    // The nodes might be owned by "arena_".
+    root_.reset();
+    arena_ = std::move(other.arena_);
+    root_ = std::move(other.root_);
+  }
+  return *this;
+}
+
 void DecisionTree::CreateRoot() {
   DCHECK(!root_);
-  root_ = absl::make_unique<NodeWithChildren>();
+  if (arena_) {
+    root_.reset(arena_->CreateNode());
+  } else {
+    root_.reset(NodeWithChildren::CreateHeapNode());
+  }
 }
 
 absl::Status DecisionTree::WriteNodes(
@@ -494,7 +515,7 @@ absl::Status DecisionTree::ReadNodes(
 
 absl::Status NodeWithChildren::WriteNodes(
     utils::ProtoWriterInterface<proto::Node>* writer) const {
-  RETURN_IF_ERROR(writer->Write(node_));
+  RETURN_IF_ERROR(writer->Write(*node_));
   if (!IsLeaf()) {
     RETURN_IF_ERROR(children_[0]->WriteNodes(writer));
     RETURN_IF_ERROR(children_[1]->WriteNodes(writer));
@@ -504,11 +525,11 @@ absl::Status NodeWithChildren::WriteNodes(
 
 absl::Status NodeWithChildren::ReadNodes(
     utils::ProtoReaderInterface<proto::Node>* reader) {
-  ASSIGN_OR_RETURN(bool did_read, reader->Next(&node_));
+  ASSIGN_OR_RETURN(bool did_read, reader->Next(node_));
   if (!did_read) {
     return absl::InvalidArgumentError("Unexpected EOF");
   }
-  if (node_.has_condition()) {
+  if (node_->has_condition()) {
     CreateChildren();
     RETURN_IF_ERROR(children_[0]->ReadNodes(reader));
     RETURN_IF_ERROR(children_[1]->ReadNodes(reader));
@@ -517,23 +538,76 @@ absl::Status NodeWithChildren::ReadNodes(
 }
 
 void NodeWithChildren::CreateChildren() {
-  children_[0] = absl::make_unique<NodeWithChildren>();
-  children_[1] = absl::make_unique<NodeWithChildren>();
+  if (arena_) {
+    children_[0].reset(arena_->CreateNode());
+    children_[1].reset(arena_->CreateNode());
+  } else {
+    children_[0].reset(CreateHeapNode());
+    children_[1].reset(CreateHeapNode());
+  }
+}
+
+struct NodeWithChildren::HeapNode : public NodeWithChildren {
+  HeapNode() : NodeWithChildren(&proto) {}
+
+  proto::Node proto;
+};
+
+NodeWithChildren* NodeWithChildren::CreateHeapNode() { return new HeapNode(); }
+
+NodeWithChildren::NodeWithChildren()
+    : node_(new proto::Node()), owns_node_(true) {}
+
+NodeWithChildren::NodeWithChildren(NodeArena* arena)
+    : node_(google::protobuf::Arena::CreateMessage<proto::Node>(
+          arena->proto_arena())),
+      arena_(arena) {}
+
+NodeWithChildren::NodeWithChildren(proto::Node* node) : node_(node) {}
+
+NodeWithChildren::~NodeWithChildren() {
+  if (owns_node_) {
+    delete node_;
+  }
+}
+
+void NodeWithChildrenDeleter::operator()(NodeWithChildren* node) const {
+  if (node->arena_) {
+    // Released with the arena.
+    return;
+  }
+  if (node->owns_node_) {
+    delete node;
+  } else {
+    delete static_cast<NodeWithChildren::HeapNode*>(node);
+  }
+}
+
+NodeWithChildren* NodeArena::CreateNode() {
+  if (num_nodes_in_last_block_ == block_size_) {
+    block_size_ = std::min(kMaxNumNodesPerBlock,
+                           std::max(kMinNumNodesPerBlock, 2 * block_size_));
+    blocks_.push_back(absl::make_unique<NodeStorage[]>(block_size_));
+    num_nodes_in_last_block_ = 0;
+  }
+  NodeStorage* storage = &blocks_.back()[num_nodes_in_last_block_++];
+  num_nodes_++;
+  return new (storage->data) NodeWithChildren(this);
 }
 
 void NodeWithChildren::ClearLabelDistributionDetails() {
-  switch (node_.output_case()) {
+  switch (node_->output_case()) {
     case proto::Node::OUTPUT_NOT_SET:
       CHECK(false);
       break;
     case proto::Node::OutputCase::kClassifier:
-      node_.mutable_classifier()->clear_distribution();
+      node_->mutable_classifier()->clear_distribution();
       break;
     case proto::Node::OutputCase::kRegressor:
-      node_.mutable_regressor()->clear_distribution();
-      node_.mutable_regressor()->clear_sum_gradients();
-      node_.mutable_regressor()->clear_sum_hessians();
-      node_.mutable_regressor()->clear_sum_weights();
+      node_->mutable_regressor()->clear_distribution();
+      node_->mutable_regressor()->clear_sum_gradients();
+      node_->mutable_regressor()->clear_sum_hessians();
+      node_->mutable_regressor()->clear_sum_weights();
       break;
     case proto::Node::OutputCase::kUplift:
       break;
@@ -546,7 +620,7 @@ void NodeWithChildren::FinalizeAsLeaf(
   if (!store_detailed_label_distribution) {
     ClearLabelDistributionDetails();
   }
-  node_.clear_condition();
+  node_->clear_condition();
 }
 
 void NodeWithChildren::FinalizeAsNonLeaf(
@@ -554,7 +628,7 @@ void NodeWithChildren::FinalizeAsNonLeaf(
     const bool store_detailed_label_distribution) {
   CHECK(!IsLeaf());
   if (!keep_non_leaf_label_distribution) {
-    node_.clear_output();
+    node_->clear_output();
   } else {
     if (!store_detailed_label_distribution) {
       ClearLabelDistributionDetails();
@@ -563,7 +637,7 @@ void NodeWithChildren::FinalizeAsNonLeaf(
 }
 
 void NodeWithChildren::TurnIntoLeaf() {
-  node_.clear_condition();
+  node_->clear_condition();
   children_[0].reset();
   children_[1].reset();
 }
@@ -828,13 +902,13 @@ bool EvalCondition(const proto::NodeCondition& condition,
 void NodeWithChildren::CountFeatureUsage(
     std::unordered_map<int32_t, int64_t>* feature_usage) const {
   if (!IsLeaf()) {
-    if (node_.condition().condition().has_oblique_condition()) {
+    if (node_->condition().condition().has_oblique_condition()) {
       for (const auto attribute :
-           node_.condition().condition().oblique_condition().attributes()) {
+           node_->condition().condition().oblique_condition().attributes()) {
         (*feature_usage)[attribute]++;
       }
     } else {
-      (*feature_usage)[node_.condition().attribute()]++;
+      (*feature_usage)[node_->condition().attribute()]++;
     }
 
     neg_child()->CountFeatureUsage(feature_usage);
@@ -994,16 +1068,16 @@ absl::Status NodeWithChildren::Validate(
     if (!pos_child() || !neg_child()) {
       return absl::InvalidArgumentError("Non-leaf with missing child");
     }
-    if (!node_.has_condition() || !node_.condition().has_condition()) {
+    if (!node_->has_condition() || !node_->condition().has_condition()) {
       return absl::InvalidArgumentError("Non-leaf with missing condition");
     }
-    if (node_.condition().attribute() < 0 ||
-        node_.condition().attribute() >= data_spec.columns_size()) {
+    if (node_->condition().attribute() < 0 ||
+        node_->condition().attribute() >= data_spec.columns_size()) {
       return absl::InvalidArgumentError("Invalid attribute index");
     }
-    const auto& condition = node_.condition().condition();
+    const auto& condition = node_->condition().condition();
     const auto& attribute_spec =
-        data_spec.columns(node_.condition().attribute());
+        data_spec.columns(node_->condition().attribute());
     switch (condition.type_case()) {
       case proto::Condition::TypeCase::kNaCondition:
         // Compatible with all the dataspec types.
@@ -1067,7 +1141,7 @@ absl::Status NodeWithChildren::Validate(
           return absl::InvalidArgumentError("Empty oblique condition");
         }
         if (condition.oblique_condition().attributes(0) !=
-            node_.condition().attribute()) {
+            node_->condition().attribute()) {
           return absl::InvalidArgumentError(
               "Non matching attribute in oblique condition");
         }
@@ -1079,7 +1153,7 @@ absl::Status NodeWithChildren::Validate(
     RETURN_IF_ERROR(pos_child()->Validate(data_spec, check_leaf));
     RETURN_IF_ERROR(neg_child()->Validate(data_spec, check_leaf));
   } else {
-    if (node_.output_case() == proto::Node::OUTPUT_NOT_SET) {
+    if (node_->output_case() == proto::Node::OUTPUT_NOT_SET) {
       return absl::InvalidArgumentError("Leaf with missing output");
     }
     if (pos_child() || neg_child()) {
@@ -102,9 +102,25 @@ struct CheckStructureOptions {
   }
 };
 
+class NodeArena;
+class NodeWithChildren;
+
+// Deletes a node, unless the node is owned by a "NodeArena".
+struct NodeWithChildrenDeleter {
+  void operator()(NodeWithChildren* node) const;
+};
+
 // A node and its two children (if any).
 class NodeWithChildren {
  public:
+  // Creates a standalone node. Nodes of a "DecisionTree" are created with
+  // "DecisionTree::CreateRoot" and "CreateChildren" instead.
+  NodeWithChildren();
+  ~NodeWithChildren();
+
+  NodeWithChildren(const NodeWithChildren&) = delete;
+  NodeWithChildren& operator=(const NodeWithChildren&) = delete;
+
   // Approximate size in memory (expressed in byte) of the node and all its
   // children.
   size_t EstimateSizeInByte() const;
@@ -128,9 +144,9 @@ class NodeWithChildren {
   void CountFeatureUsage(
       std::unordered_map<int32_t, int64_t>* feature_usage) const;
 
-  const proto::Node& node() const { return node_; }
+  const proto::Node& node() const { return *node_; }
 
-  proto::Node* mutable_node() { return &node_; }
+  proto::Node* mutable_node() { return node_; }
 
   // The "positive" child i.e. the child that is responsible for the prediction
   // when the condition evaluates to true.
@@ -191,21 +207,102 @@ class NodeWithChildren {
   void set_leaf_idx(const int32_t v) { leaf_idx_ = v; }
 
  private:
-  // Node content (i.e. value and condition).
-  proto::Node node_;
+  friend class DecisionTree;
+  friend class NodeArena;
+  friend struct NodeWithChildrenDeleter;
+
+  // A node not owned by an arena, allocated together with its proto.
+  struct HeapNode;
+
+  // Creates a node not owned by an arena. The node and its proto are a single
+  // allocation.
+  static NodeWithChildren* CreateHeapNode();
 
-  // Children (if any).
-  std::unique_ptr<NodeWithChildren> children_[2];
+  // Creates a node owned by "arena".
+  explicit NodeWithChildren(NodeArena* arena);
+
+  // Creates a node with the proto "node", owned by the caller.
+  explicit NodeWithChildren(proto::Node* node);
+
+  // Node content (i.e. value and condition). Owned by the arena if "arena_" is
+  // set, by this object if "owns_node_" is set, and by the enclosing
+  // "HeapNode" otherwise. The proto is not embedded so that arena nodes do not
+  // carry an unused proto.
+  proto::Node* node_;
+
+  // Children (if any). Allocated in the same arena as this node.
+  std::unique_ptr<NodeWithChildren, NodeWithChildrenDeleter> children_[2];
+
+  // Arena owning this node, if any.
+  NodeArena* arena_ = nullptr;
 
   // Index of the leaf (if the node is a leaf) in the tree in a depth first
   // exploration. It is set by calling "SetLeafIndices()".
   int32_t leaf_idx_ = -1;
+
+  // If true, "node_" is owned by this object.
+  bool owns_node_ = false;
+};
+
+// Allocator of the nodes (and of their protos) of a decision tree.
+//
+// Creating a node in an arena is a pointer increment instead of several heap
+// allocations, and all the nodes are released at once when the arena is
+// destroyed. The memory of the nodes removed from the tree (e.g. pruning) and
+// of the cleared proto fields (e.g. "ClearLabelDistributionDetails") is only
+// released with the arena.
+//
+// Nodes should not be created concurrently in the same arena.
+class NodeArena {
+ public:
+  NodeArena() = default;
+  NodeArena(const NodeArena&) = delete;
+  NodeArena& operator=(const NodeArena&) = delete;
+
+  // Creates a node owned by the arena.
+  NodeWithChildren* CreateNode();
+
+  google::protobuf::Arena* proto_arena() { return &proto_arena_; }
+
+  // Number of nodes created in the arena.
+  int64_t num_nodes() const { return num_nodes_; }
+
+ private:
+  // Uninitialized memory for a node.
+  struct alignas(NodeWithChildren) NodeStorage {
+    char data[sizeof(NodeWithChildren)];
+  };
+
+  // The size of the blocks grows geometrically so that small trees (e.g. GBT)
+  // do not waste memory.
+  static constexpr int kMinNumNodesPerBlock = 16;
+  static constexpr int kMaxNumNodesPerBlock = 4096;
+
+  // The nodes are destroyed with their blocks, without calling their
+  // destructor (which does not release anything for arena nodes).
+  std::vector<std::unique_ptr<NodeStorage[]>> blocks_;
+  int block_size_ = 0;
+  int num_nodes_in_last_block_ = 0;
+  int64_t num_nodes_ = 0;
+
+  google::protobuf::Arena proto_arena_;
 };
 
 // A generic decision tree. This class is designed for cheap modification (by
 // opposition to fast serving).
 class DecisionTree {
  public:
+  DecisionTree() = default;
+
+  // If "use_arena" is true, the nodes are allocated in a "NodeArena" owned by
+  // the tree. This speeds-up the creation (e.g. training, loading) and
+  // destruction of large trees.
+  explicit DecisionTree(bool use_arena);
+
+  // The nodes of the destination tree are released before its arena.
+  DecisionTree(DecisionTree&& other) = default;
+  DecisionTree& operator=(DecisionTree&& other);
+
   // Estimates the memory usage of the model in RAM. The serialized or the
   // compiled version of the model can be much smaller.
   size_t EstimateModelSizeInBytes() const;
@@ -300,8 +397,12 @@ class DecisionTree {
   void SetLeafIndices();
 
  private:
+  // Allocator of the nodes, if any. Declared before "root_" so that the nodes
+  // are released before the arena.
+  std::unique_ptr<NodeArena> arena_;
+
   // Root of the decision tree.
-  std::unique_ptr<NodeWithChildren> root_;
+  std::unique_ptr<NodeWithChildren, NodeWithChildrenDeleter> root_;
 };
 
 // A list of trees without specific semantic.
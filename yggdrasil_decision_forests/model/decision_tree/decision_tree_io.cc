@@ -17,6 +17,7 @@
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -27,8 +28,11 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/span.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree_io_interface.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
 #include "yggdrasil_decision_forests/utils/sharded_io.h"
 #include "yggdrasil_decision_forests/utils/status_macros.h"
@@ -41,29 +45,96 @@ namespace decision_tree {
 constexpr size_t kMaxShardSizeInByte = static_cast<size_t>(200)
                                        << 20;  // 200 MB.
 
+// Minimum size (approximate) of the shards. Models larger than this size are
+// split into several shards (up to "kMaxNumShardsForParallelLoading") so that
+// they can be loaded in parallel.
+constexpr size_t kMinShardSizeInByte = static_cast<size_t>(10)
+                                       << 20;  // 10 MB.
+constexpr int kMaxNumShardsForParallelLoading = 16;
+
+namespace {
+
+// Reads "num_trees" trees from a single shard into "trees[0, num_trees)".
+absl::Status LoadTreesFromShard(const AbstractFormat& format_impl,
+                                absl::string_view path, const int num_trees,
+                                std::unique_ptr<DecisionTree>* trees) {
+  if (num_trees == 0) {
+    return absl::OkStatus();
+  }
+  auto node_reader = format_impl.CreateReader();
+  RETURN_IF_ERROR(node_reader->Open(path));
+  for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+    auto decision_tree =
+        absl::make_unique<decision_tree::DecisionTree>(/*use_arena=*/true);
+    RETURN_IF_ERROR(decision_tree->ReadNodes(node_reader.get()));
+    decision_tree->SetLeafIndices();
+    trees[tree_idx] = std::move(decision_tree);
+  }
+  proto::Node remaining_node;
+  ASSIGN_OR_RETURN(const bool has_remaining_node,
+                   node_reader->Next(&remaining_node));
+  if (has_remaining_node) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "The shard $0 contains more than $1 trees", path, num_trees));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 absl::Status SaveTreesToDisk(
     absl::string_view directory, absl::string_view basename,
     const std::vector<std::unique_ptr<DecisionTree>>& trees,
-    absl::string_view format, int* num_shards) {
+    absl::string_view format, int* num_shards,
+    std::vector<int>* num_trees_per_shard) {
   ASSIGN_OR_RETURN(const auto format_impl, GetFormatImplementation(format));
 
   // FutureWork(gbm): The current function is fully sequential. If speed
   // becomes an issue, make it so that the shards are written in parallel.
-  *num_shards =
-      std::max<int>(1, (EstimateSizeInByte(trees) + kMaxShardSizeInByte - 1) /
-                           kMaxShardSizeInByte);
+  const size_t estimated_size = EstimateSizeInByte(trees);
+  const int max_num_shards =
+      std::max<int>((estimated_size + kMaxShardSizeInByte - 1) /
+                        kMaxShardSizeInByte,
+                    std::min<int>(kMaxNumShardsForParallelLoading,
+                                  estimated_size / kMinShardSizeInByte));
   const int64_t num_nodes = NumberOfNodes(trees);
-  const int num_nodes_per_shard =
-      std::max<int>(1, (num_nodes + *num_shards - 1) / *num_shards);
-  auto node_writer = format_impl->CreateWriter();
-  const auto base_path = file::JoinPath(directory, basename);
-  RETURN_IF_ERROR(
-      node_writer->Open(file::GenerateShardedFileSpec(base_path, *num_shards),
-                        num_nodes_per_shard));
+  const int64_t num_nodes_per_shard =
+      std::max<int64_t>(1, (num_nodes + max_num_shards - 1) /
+                               std::max(1, max_num_shards));
+
+  // Groups the trees into shards of approximately "num_nodes_per_shard" nodes.
+  std::vector<int> shard_num_trees = {0};
+  int64_t num_nodes_in_cur_shard = 0;
   for (const auto& tree : trees) {
-    RETURN_IF_ERROR(tree->WriteNodes(node_writer.get()));
+    if (num_nodes_in_cur_shard >= num_nodes_per_shard) {
+      shard_num_trees.push_back(0);
+      num_nodes_in_cur_shard = 0;
+    }
+    shard_num_trees.back()++;
+    num_nodes_in_cur_shard += tree->NumNodes();
+  }
+  *num_shards = shard_num_trees.size();
+
+  std::vector<std::string> shard_paths;
+  RETURN_IF_ERROR(utils::ExpandOutputShards(
+      file::GenerateShardedFileSpec(file::JoinPath(directory, basename),
+                                    *num_shards),
+      &shard_paths));
+  STATUS_CHECK_EQ(shard_paths.size(), *num_shards);
+
+  int tree_idx = 0;
+  for (int shard_idx = 0; shard_idx < *num_shards; shard_idx++) {
+    auto node_writer = format_impl->CreateWriter();
+    RETURN_IF_ERROR(node_writer->Open(shard_paths[shard_idx],
+                                      /*num_records_by_shard=*/-1));
+    for (int i = 0; i < shard_num_trees[shard_idx]; i++) {
+      RETURN_IF_ERROR(trees[tree_idx++]->WriteNodes(node_writer.get()));
+    }
+    RETURN_IF_ERROR(node_writer->CloseWithStatus());
+  }
+  if (num_trees_per_shard) {
+    *num_trees_per_shard = std::move(shard_num_trees);
   }
-  RETURN_IF_ERROR(node_writer->CloseWithStatus());
   return absl::OkStatus();
 }
 
@@ -76,7 +147,8 @@ absl::Status LoadTreesFromDisk(
   RETURN_IF_ERROR(node_reader->Open(file::GenerateShardedFileSpec(
       file::JoinPath(directory, basename), num_shards)));
   for (int64_t tree_idx = 0; tree_idx < num_trees; tree_idx++) {
-    auto decision_tree = absl::make_unique<decision_tree::DecisionTree>();
+    auto decision_tree =
+        absl::make_unique<decision_tree::DecisionTree>(/*use_arena=*/true);
     RETURN_IF_ERROR(decision_tree->ReadNodes(node_reader.get()));
     decision_tree->SetLeafIndices();
     trees->push_back(std::move(decision_tree));
@@ -84,6 +156,58 @@ absl::Status LoadTreesFromDisk(
   return absl::OkStatus();
 }
 
+absl::Status LoadTreesFromDisk(
+    absl::string_view directory, absl::string_view basename,
+    absl::Span<const int> num_trees_per_shard, absl::string_view format,
+    int num_threads, std::vector<std::unique_ptr<DecisionTree>>* trees) {
+  ASSIGN_OR_RETURN(const auto format_impl, GetFormatImplementation(format));
+  const int num_shards = num_trees_per_shard.size();
+  std::vector<std::string> shard_paths;
+  RETURN_IF_ERROR(utils::ExpandOutputShards(
+      file::GenerateShardedFileSpec(file::JoinPath(directory, basename),
+                                    num_shards),
+      &shard_paths));
+  STATUS_CHECK_EQ(shard_paths.size(), num_shards);
+
+  // Index of the first tree of each shard in "trees".
+  std::vector<size_t> shard_begin_tree_idxs(num_shards);
+  size_t num_trees = trees->size();
+  for (int shard_idx = 0; shard_idx < num_shards; shard_idx++) {
+    shard_begin_tree_idxs[shard_idx] = num_trees;
+    num_trees += num_trees_per_shard[shard_idx];
+  }
+  trees->resize(num_trees);
+
+  const auto load_shard = [&](const int shard_idx) {
+    return LoadTreesFromShard(
+        *format_impl, shard_paths[shard_idx], num_trees_per_shard[shard_idx],
+        trees->data() + shard_begin_tree_idxs[shard_idx]);
+  };
+
+  if (num_threads <= 1 || num_shards <= 1) {
+    for (int shard_idx = 0; shard_idx < num_shards; shard_idx++) {
+      RETURN_IF_ERROR(load_shard(shard_idx));
+    }
+    return absl::OkStatus();
+  }
+
+  std::vector<absl::Status> shard_status(num_shards);
+  {
+    utils::concurrency::ThreadPool pool("LoadTreesFromDisk",
+                                        std::min(num_threads, num_shards));
+    pool.StartWorkers();
+    for (int shard_idx = 0; shard_idx < num_shards; shard_idx++) {
+      pool.Schedule([&, shard_idx]() {
+        shard_status[shard_idx] = load_shard(shard_idx);
+      });
+    }
+  }
+  for (const auto& status : shard_status) {
+    RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
 absl::StatusOr<std::string> RecommendedSerializationFormat() {
   for (const auto& candidate : {
            "BLOB_SEQUENCE",
@@ -25,6 +25,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 
 namespace yggdrasil_decision_forests {
@@ -39,17 +40,29 @@ namespace decision_tree {
 //
 // The tree are written sequentially. For each trees, nodes are written
 // sequentially, in a depth first transversal, with the <node, negative child,
-// positive child> order.
+// positive child> order. A tree is never split across two shards. If
+// "num_trees_per_shard" is provided, it is set to the number of trees in each
+// shard. This information can then be used to load the shards in parallel.
 absl::Status SaveTreesToDisk(
     absl::string_view directory, absl::string_view basename,
     const std::vector<std::unique_ptr<DecisionTree>>& trees,
-    absl::string_view format, int* num_shards);
+    absl::string_view format, int* num_shards,
+    std::vector<int>* num_trees_per_shard = nullptr);
 
+// Loads the trees sequentially. Supports all the models, including the ones
+// saved before trees were aligned with shards.
 absl::Status LoadTreesFromDisk(
     absl::string_view directory, absl::string_view basename, int num_shards,
     int num_trees, absl::string_view format,
     std::vector<std::unique_ptr<DecisionTree>>* trees);
 
+// Loads the trees with the shards decoded in parallel by "num_threads"
+// threads. "num_trees_per_shard" is the value returned by "SaveTreesToDisk".
+absl::Status LoadTreesFromDisk(
+    absl::string_view directory, absl::string_view basename,
+    absl::Span<const int> num_trees_per_shard, absl::string_view format,
+    int num_threads, std::vector<std::unique_ptr<DecisionTree>>* trees);
+
 // Gets the recommended format to store decision trees with
 // SaveTreesToDisk among the registered ones. At least one
 // format should be registered.
@@ -33,6 +33,7 @@
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree_io.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
 #include "yggdrasil_decision_forests/utils/status_macros.h"
@@ -602,6 +603,142 @@ TEST(DecisionTree, Distance) {
   EXPECT_THAT(distances, ElementsAre(0.5f, 0.f, 0.5f, 1.f));
 }
 
+// Creates the children of "node" recursively until "depth" is reached.
+void GrowFullTree(const int depth, int* next_value, NodeWithChildren* node) {
+  if (depth == 0) {
+    node->mutable_node()->mutable_regressor()->set_top_value((*next_value)++);
+    return;
+  }
+  node->CreateChildren();
+  node->mutable_node()->mutable_condition()->set_attribute(0);
+  node->mutable_node()
+      ->mutable_condition()
+      ->mutable_condition()
+      ->mutable_higher_condition()
+      ->set_threshold((*next_value)++);
+  GrowFullTree(depth - 1, next_value, node->mutable_neg_child());
+  GrowFullTree(depth - 1, next_value, node->mutable_pos_child());
+}
+
+void ExpectEqualNodes(const NodeWithChildren& a, const NodeWithChildren& b) {
+  EXPECT_EQ(a.node().SerializeAsString(), b.node().SerializeAsString());
+  ASSERT_EQ(a.IsLeaf(), b.IsLeaf());
+  if (!a.IsLeaf()) {
+    ExpectEqualNodes(*a.neg_child(), *b.neg_child());
+    ExpectEqualNodes(*a.pos_child(), *b.pos_child());
+  }
+}
+
+TEST(DecisionTree, SaveAndLoadShards) {
+  // A forest large enough to be saved in several shards.
+  DecisionForest trees;
+  int next_value = 0;
+  for (int tree_idx = 0; tree_idx < 40; tree_idx++) {
+    auto tree = std::make_unique<DecisionTree>();
+    tree->CreateRoot();
+    GrowFullTree(12, &next_value, tree->mutable_root());
+    tree->SetLeafIndices();
+    trees.push_back(std::move(tree));
+  }
+
+  const std::string directory =
+      file::JoinPath(test::TmpDirectory(), "save_and_load_shards");
+  ASSERT_OK(file::RecursivelyCreateDir(directory, file::Defaults()));
+  ASSERT_OK_AND_ASSIGN(const std::string format,
+                       RecommendedSerializationFormat());
+  int num_shards;
+  std::vector<int> num_trees_per_shard;
+  ASSERT_OK(SaveTreesToDisk(directory, "nodes", trees, format, &num_shards,
+                            &num_trees_per_shard));
+  EXPECT_GT(num_shards, 1);
+  ASSERT_EQ(num_trees_per_shard.size(), num_shards);
+  int num_trees = 0;
+  for (const int value : num_trees_per_shard) {
+    EXPECT_GT(value, 0);
+    num_trees += value;
+  }
+  EXPECT_EQ(num_trees, trees.size());
+
+  DecisionForest sequential_trees;
+  ASSERT_OK(LoadTreesFromDisk(directory, "nodes", num_shards, trees.size(),
+                              format, &sequential_trees));
+  for (const int num_threads : {1, 4}) {
+    DecisionForest parallel_trees;
+    ASSERT_OK(LoadTreesFromDisk(directory, "nodes", num_trees_per_shard,
+                                format, num_threads, &parallel_trees));
+    ASSERT_EQ(parallel_trees.size(), trees.size());
+    ASSERT_EQ(sequential_trees.size(), trees.size());
+    for (int tree_idx = 0; tree_idx < trees.size(); tree_idx++) {
+      ExpectEqualNodes(parallel_trees[tree_idx]->root(),
+                       trees[tree_idx]->root());
+      ExpectEqualNodes(sequential_trees[tree_idx]->root(),
+                       trees[tree_idx]->root());
+    }
+  }
+
+  // Inconsistent number of trees.
+  num_trees_per_shard.back()--;
+  DecisionForest invalid_trees;
+  EXPECT_FALSE(LoadTreesFromDisk(directory, "nodes", num_trees_per_shard,
+                                 format, 4, &invalid_trees)
+                   .ok());
+}
+
+TEST(DecisionTree, NodeArena) {
+  DecisionTree heap_tree;
+  DecisionTree arena_tree(/*use_arena=*/true);
+  for (DecisionTree* tree : {&heap_tree, &arena_tree}) {
+    int next_value = 0;
+    tree->CreateRoot();
+    GrowFullTree(8, &next_value, tree->mutable_root());
+  }
+  EXPECT_EQ(arena_tree.NumNodes(), 511);
+  ExpectEqualNodes(arena_tree.root(), heap_tree.root());
+  EXPECT_EQ(heap_tree.root().node().GetArena(), nullptr);
+  EXPECT_NE(arena_tree.root().node().GetArena(), nullptr);
+  EXPECT_EQ(arena_tree.root().neg_child()->node().GetArena(),
+            arena_tree.root().node().GetArena());
+
+  // The proto of a heap node is allocated right after the node (no extra
+  // allocation).
+  const auto* heap_root = reinterpret_cast<const char*>(&heap_tree.root());
+  const auto* heap_root_proto =
+      reinterpret_cast<const char*>(&heap_tree.root().node());
+  EXPECT_GT(heap_root_proto, heap_root);
+  EXPECT_LE(heap_root_proto, heap_root + sizeof(NodeWithChildren));
+
+  // Arena nodes do not contain a proto.
+  const auto* arena_root = reinterpret_cast<const char*>(&arena_tree.root());
+  const auto* arena_root_proto =
+      reinterpret_cast<const char*>(&arena_tree.root().node());
+  EXPECT_TRUE(arena_root_proto < arena_root ||
+              arena_root_proto >= arena_root + sizeof(NodeWithChildren));
+
+  // Pruning.
+  arena_tree.mutable_root()->mutable_neg_child()->TurnIntoLeaf();
+  heap_tree.mutable_root()->mutable_neg_child()->TurnIntoLeaf();
+  EXPECT_EQ(arena_tree.NumNodes(), 257);
+  ExpectEqualNodes(arena_tree.root(), heap_tree.root());
+
+  // Move-assigns an arena tree over another arena tree.
+  DecisionTree other_arena_tree(/*use_arena=*/true);
+  int next_value = 0;
+  other_arena_tree.CreateRoot();
+  GrowFullTree(4, &next_value, other_arena_tree.mutable_root());
+  arena_tree = std::move(other_arena_tree);
+  EXPECT_EQ(arena_tree.NumNodes(), 31);
+  DecisionTree moved_arena_tree(std::move(arena_tree));
+  EXPECT_EQ(moved_arena_tree.NumNodes(), 31);
+
+  NodeArena arena;
+  for (int i = 0; i < 100; i++) {
+    NodeWithChildren* node = arena.CreateNode();
+    node->mutable_node()->mutable_regressor()->set_top_value(i);
+    EXPECT_TRUE(node->IsLeaf());
+  }
+  EXPECT_EQ(arena.num_nodes(), 100);
+}
+
 }  // namespace
 }  // namespace decision_tree
 }  // namespace model
@@ -0,0 +1,316 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/model/decision_tree/proximity.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/dataset/types.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace decision_tree {
+namespace {
+
+// Number of examples per job when computing the leaves of the indexed
+// examples.
+constexpr size_t kIndexBlockSize = 4096;
+
+// Working memory of a thread answering queries.
+struct QueryCache {
+  // "counts[i]" is the number of common leaves with the indexed example "i".
+  std::vector<uint32_t> counts;
+  // Indexed examples with a non-zero count.
+  std::vector<UnsignedExampleIdx> touched;
+  // Active leaves of the query examples.
+  std::vector<int32_t> leaves;
+};
+
+// Neighbors of a block of query examples.
+struct NeighborBlock {
+  UnsignedExampleIdx begin_example_idx;
+  std::vector<std::vector<Neighbor>> neighbors;
+};
+
+bool CloserNeighbor(const Neighbor& a, const Neighbor& b) {
+  if (a.distance != b.distance) {
+    return a.distance < b.distance;
+  }
+  return a.example_idx < b.example_idx;
+}
+
+// Finds the neighbours of the query examples [begin_example_idx,
+// end_example_idx).
+absl::StatusOr<NeighborBlock> NearestNeighborsBlock(
+    const absl::Span<const std::unique_ptr<DecisionTree>> trees,
+    const LeafExampleIndex& index, const dataset::VerticalDataset& queries,
+    const NearestNeighborsOptions& options,
+    const UnsignedExampleIdx begin_example_idx,
+    const UnsignedExampleIdx end_example_idx, QueryCache* cache) {
+  const size_t num_trees = trees.size();
+  NeighborBlock block;
+  block.begin_example_idx = begin_example_idx;
+  block.neighbors.resize(end_example_idx - begin_example_idx);
+
+  if (cache->counts.size() != index.num_examples()) {
+    cache->counts.assign(index.num_examples(), 0);
+  }
+  RETURN_IF_ERROR(GetLeaves(trees, queries, begin_example_idx, end_example_idx,
+                            &cache->leaves));
+
+  for (UnsignedExampleIdx local_idx = 0; local_idx < block.neighbors.size();
+       local_idx++) {
+    // Count the common leaves with the indexed examples.
+    cache->touched.clear();
+    const int32_t* leaves = &cache->leaves[local_idx * num_trees];
+    for (size_t tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+      const auto examples = index.Examples(tree_idx, leaves[tree_idx]);
+      for (const auto example_idx : examples) {
+        if (cache->counts[example_idx]++ == 0) {
+          cache->touched.push_back(example_idx);
+        }
+      }
+    }
+
+    // Select the neighbours. Also resets "counts" for the next query.
+    auto& neighbors = block.neighbors[local_idx];
+    neighbors.reserve(cache->touched.size());
+    for (const auto example_idx : cache->touched) {
+      const float distance =
+          1.f - static_cast<float>(cache->counts[example_idx]) / num_trees;
+      cache->counts[example_idx] = 0;
+      if (distance <= options.max_distance) {
+        neighbors.push_back({example_idx, distance});
+      }
+    }
+    if (options.top_k >= 0 &&
+        neighbors.size() > static_cast<size_t>(options.top_k)) {
+      std::nth_element(neighbors.begin(), neighbors.begin() + options.top_k,
+                       neighbors.end(), CloserNeighbor);
+      neighbors.resize(options.top_k);
+      neighbors.shrink_to_fit();
+    }
+    std::sort(neighbors.begin(), neighbors.end(), CloserNeighbor);
+  }
+  return block;
+}
+
+}  // namespace
+
+absl::StatusOr<LeafExampleIndex> LeafExampleIndex::Create(
+    const absl::Span<const std::unique_ptr<DecisionTree>> trees,
+    const dataset::VerticalDataset& dataset, const int num_threads) {
+  const size_t num_trees = trees.size();
+  if (num_trees == 0) {
+    return absl::InvalidArgumentError("No tree was provided");
+  }
+  const UnsignedExampleIdx num_examples = dataset.nrow();
+
+  LeafExampleIndex index;
+  index.num_examples_ = num_examples;
+  index.tree_offsets_.reserve(num_trees + 1);
+  index.tree_offsets_.push_back(0);
+  for (const auto& tree : trees) {
+    index.tree_offsets_.push_back(index.tree_offsets_.back() +
+                                  tree->NumLeafs());
+  }
+
+  // Active leaves of all the examples.
+  std::vector<int32_t> leaves(num_examples * num_trees);
+  {
+    const size_t num_blocks =
+        (num_examples + kIndexBlockSize - 1) / kIndexBlockSize;
+    // Note: "ConcurrentForLoop" runs a single block, even if the dataset is
+    // empty.
+    std::vector<absl::Status> block_status(std::max<size_t>(1, num_blocks));
+    utils::concurrency::ThreadPool pool("LeafExampleIndex",
+                                        std::max(1, num_threads));
+    pool.StartWorkers();
+    utils::concurrency::ConcurrentForLoop(
+        num_blocks, &pool, num_examples,
+        [&](const size_t block_idx, const size_t begin_example_idx,
+            const size_t end_example_idx) {
+          std::vector<int32_t> block_leaves;
+          block_status[block_idx] =
+              GetLeaves(trees, dataset, begin_example_idx, end_example_idx,
+                        &block_leaves);
+          std::copy(block_leaves.begin(), block_leaves.end(),
+                    leaves.begin() + begin_example_idx * num_trees);
+        });
+    for (const auto& status : block_status) {
+      RETURN_IF_ERROR(status);
+    }
+  }
+
+  // Counting sort of the examples by global leaf index.
+  const size_t num_leaves = index.tree_offsets_.back();
+  index.leaf_offsets_.assign(num_leaves + 1, 0);
+  for (UnsignedExampleIdx example_idx = 0; example_idx < num_examples;
+       example_idx++) {
+    for (size_t tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+      const auto leaf_idx = leaves[tree_idx + example_idx * num_trees];
+      index.leaf_offsets_[index.tree_offsets_[tree_idx] + leaf_idx + 1]++;
+    }
+  }
+  for (size_t leaf_idx = 0; leaf_idx < num_leaves; leaf_idx++) {
+    index.leaf_offsets_[leaf_idx + 1] += index.leaf_offsets_[leaf_idx];
+  }
+  std::vector<size_t> write_offsets(index.leaf_offsets_.begin(),
+                                    index.leaf_offsets_.end() - 1);
+  index.examples_.resize(num_examples * num_trees);
+  for (UnsignedExampleIdx example_idx = 0; example_idx < num_examples;
+       example_idx++) {
+    for (size_t tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+      const auto leaf_idx = leaves[tree_idx + example_idx * num_trees];
+      index.examples_[write_offsets[index.tree_offsets_[tree_idx] +
+                                    leaf_idx]++] = example_idx;
+    }
+  }
+  return index;
+}
+
+size_t LeafExampleIndex::MemoryUsage() const {
+  return sizeof(size_t) * (tree_offsets_.size() + leaf_offsets_.size()) +
+         sizeof(UnsignedExampleIdx) * examples_.size();
+}
+
+absl::Status GetLeaves(
+    const absl::Span<const std::unique_ptr<DecisionTree>> trees,
+    const dataset::VerticalDataset& dataset,
+    const UnsignedExampleIdx begin_example_idx,
+    const UnsignedExampleIdx end_example_idx, std::vector<int32_t>* leaves) {
+  const size_t num_trees = trees.size();
+  leaves->resize((end_example_idx - begin_example_idx) * num_trees);
+  for (UnsignedExampleIdx example_idx = begin_example_idx;
+       example_idx < end_example_idx; example_idx++) {
+    int32_t* dst = &(*leaves)[(example_idx - begin_example_idx) * num_trees];
+    for (size_t tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+      const NodeWithChildren& leaf =
+          trees[tree_idx]->GetLeafAlt(dataset, example_idx);
+      STATUS_CHECK_GE(leaf.leaf_idx(), 0);
+      dst[tree_idx] = leaf.leaf_idx();
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status NearestNeighbors(
+    const absl::Span<const std::unique_ptr<DecisionTree>> trees,
+    const LeafExampleIndex& index, const dataset::VerticalDataset& queries,
+    const NearestNeighborsOptions& options, const NeighborsConsumer& consumer) {
+  if (trees.size() != index.num_trees()) {
+    return absl::InvalidArgumentError(
+        "The index was built with a different number of trees.");
+  }
+  STATUS_CHECK_GT(options.block_size, 0);
+  const int num_threads = std::max(1, options.num_threads);
+  const UnsignedExampleIdx num_queries = queries.nrow();
+  const size_t num_blocks =
+      (num_queries + options.block_size - 1) / options.block_size;
+
+  std::vector<QueryCache> caches(num_threads);
+  // Set to true to skip the remaining blocks.
+  std::atomic<bool> stop{false};
+
+  utils::concurrency::StreamProcessor<size_t, absl::StatusOr<NeighborBlock>>
+      processor(
+          "NearestNeighbors", num_threads,
+          [&](const size_t block_idx,
+              const int thread_idx) -> absl::StatusOr<NeighborBlock> {
+            if (stop) {
+              return absl::CancelledError("Cancelled");
+            }
+            const UnsignedExampleIdx begin_example_idx =
+                block_idx * options.block_size;
+            const UnsignedExampleIdx end_example_idx = std::min<size_t>(
+                begin_example_idx + options.block_size, num_queries);
+            return NearestNeighborsBlock(trees, index, queries, options,
+                                         begin_example_idx, end_example_idx,
+                                         &caches[thread_idx]);
+          },
+          /*result_in_order=*/true);
+  processor.StartWorkers();
+
+  // Limits the number of pending blocks (and the memory usage) if the consumer
+  // is slower than the workers.
+  const size_t max_in_flight_blocks = 2 * num_threads;
+  size_t next_block_idx = 0;
+  for (; next_block_idx < std::min(num_blocks, max_in_flight_blocks);
+       next_block_idx++) {
+    processor.Submit(next_block_idx);
+  }
+
+  absl::Status status;
+  for (size_t block_idx = 0; block_idx < num_blocks; block_idx++) {
+    auto result = processor.GetResult();
+    STATUS_CHECK(result.has_value());
+    if (next_block_idx < num_blocks) {
+      processor.Submit(next_block_idx++);
+    }
+    if (!status.ok()) {
+      continue;
+    }
+    if (!result->ok()) {
+      status = result->status();
+    } else {
+      status = consumer(result->value().begin_example_idx,
+                        result->value().neighbors);
+    }
+    if (!status.ok()) {
+      stop = true;
+    }
+  }
+  processor.CloseSubmits();
+  processor.JoinAllAndStopThreads();
+  return status;
+}
+
+absl::StatusOr<std::vector<std::vector<Neighbor>>> NearestNeighbors(
+    const absl::Span<const std::unique_ptr<DecisionTree>> trees,
+    const dataset::VerticalDataset& dataset1,
+    const dataset::VerticalDataset& dataset2,
+    const NearestNeighborsOptions& options) {
+  ASSIGN_OR_RETURN(
+      const auto index,
+      LeafExampleIndex::Create(trees, dataset2, options.num_threads));
+  std::vector<std::vector<Neighbor>> neighbors(dataset1.nrow());
+  RETURN_IF_ERROR(NearestNeighbors(
+      trees, index, dataset1, options,
+      [&](const UnsignedExampleIdx begin_example_idx,
+          const absl::Span<const std::vector<Neighbor>> block) {
+        std::copy(block.begin(), block.end(),
+                  neighbors.begin() + begin_example_idx);
+        return absl::OkStatus();
+      }));
+  return neighbors;
+}
+
+}  // namespace decision_tree
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
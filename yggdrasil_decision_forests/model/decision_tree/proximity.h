@@ -0,0 +1,166 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Nearest neighbours according to the forest proximity i.e. the ratio of trees
+// in which two examples reach the same leaf.
+//
+// Unlike "Distance" (see decision_tree.h) that compares all the pairs of
+// examples, the neighbours are found with an inverted index from the leaves to
+// the examples. Only the pairs of examples sharing at least one leaf are
+// visited, and the output is a sparse list of neighbours (possibly limited to
+// the "top_k" closest ones) instead of a dense matrix.
+//
+// Usage example:
+//
+//   ASSIGN_OR_RETURN(const auto index,
+//                    LeafExampleIndex::Create(trees, dataset2, num_threads));
+//   RETURN_IF_ERROR(NearestNeighbors(
+//       trees, index, dataset1, options,
+//       [&](UnsignedExampleIdx begin_example_idx,
+//           absl::Span<const std::vector<Neighbor>> neighbors) {
+//         // Write the neighbours of the examples "begin_example_idx, ...".
+//         return absl::OkStatus();
+//       }));
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_MODEL_DECISION_TREE_PROXIMITY_H_
+#define YGGDRASIL_DECISION_FORESTS_MODEL_DECISION_TREE_PROXIMITY_H_
+
+#include <stddef.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/dataset/types.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace decision_tree {
+
+// A neighbour of an example.
+struct Neighbor {
+  // Index of the neighbour in the indexed dataset.
+  UnsignedExampleIdx example_idx;
+  // One minus the ratio of trees in which the two examples share the same leaf.
+  // Same definition as "Distance".
+  float distance;
+
+  bool operator==(const Neighbor& other) const {
+    return example_idx == other.example_idx && distance == other.distance;
+  }
+};
+
+struct NearestNeighborsOptions {
+  // Maximum number of neighbours returned for each example. If -1, all the
+  // examples sharing at least one leaf with the query example are returned.
+  int top_k = 10;
+
+  // Only the neighbours with a distance lower or equal to "max_distance" are
+  // returned. Examples without any common leaf (i.e. distance=1) are never
+  // returned.
+  float max_distance = 1.f;
+
+  // Number of threads used to build the index and to process the queries.
+  int num_threads = 6;
+
+  // Number of query examples processed in a single job.
+  int block_size = 1024;
+};
+
+// Receives the neighbours of the query examples [begin_example_idx,
+// begin_example_idx + neighbors.size()). The neighbours of an example are
+// sorted by increasing distance, and then by increasing example index.
+//
+// The consumer is called by a single thread at a time and in order of
+// "begin_example_idx". Returning an error stops the computation.
+using NeighborsConsumer = std::function<absl::Status(
+    UnsignedExampleIdx begin_example_idx,
+    absl::Span<const std::vector<Neighbor>> neighbors)>;
+
+// Inverted index from the leaves of a forest to the examples of a dataset.
+class LeafExampleIndex {
+ public:
+  // Indexes the examples of "dataset". "trees" should have leaf indices (see
+  // "DecisionTree::SetLeafIndices").
+  static absl::StatusOr<LeafExampleIndex> Create(
+      absl::Span<const std::unique_ptr<DecisionTree>> trees,
+      const dataset::VerticalDataset& dataset, int num_threads);
+
+  // Sorted indices of the examples reaching the leaf "leaf_idx" of the tree
+  // "tree_idx".
+  absl::Span<const UnsignedExampleIdx> Examples(int tree_idx,
+                                                int leaf_idx) const {
+    const size_t global_leaf_idx = tree_offsets_[tree_idx] + leaf_idx;
+    return absl::MakeConstSpan(examples_)
+        .subspan(leaf_offsets_[global_leaf_idx],
+                 leaf_offsets_[global_leaf_idx + 1] -
+                     leaf_offsets_[global_leaf_idx]);
+  }
+
+  int num_trees() const { return tree_offsets_.size() - 1; }
+  UnsignedExampleIdx num_examples() const { return num_examples_; }
+
+  // Memory usage of the index.
+  size_t MemoryUsage() const;
+
+ private:
+  // Index, in "leaf_offsets_", of the first leaf of each tree. Contains
+  // "num_trees + 1" items.
+  std::vector<size_t> tree_offsets_;
+  // "examples_[leaf_offsets_[l]..leaf_offsets_[l+1]]" are the examples in the
+  // global leaf "l".
+  std::vector<size_t> leaf_offsets_;
+  std::vector<UnsignedExampleIdx> examples_;
+  UnsignedExampleIdx num_examples_ = 0;
+};
+
+// Computes the index of the active leaf of each tree for the examples
+// [begin_example_idx, end_example_idx) of "dataset".
+//
+// "leaves[i + j * trees.size()]" is the leaf index of the example
+// "begin_example_idx + j" in the tree "i".
+absl::Status GetLeaves(absl::Span<const std::unique_ptr<DecisionTree>> trees,
+                       const dataset::VerticalDataset& dataset,
+                       UnsignedExampleIdx begin_example_idx,
+                       UnsignedExampleIdx end_example_idx,
+                       std::vector<int32_t>* leaves);
+
+// Finds the neighbours in "index" of each example in "queries". The results
+// are streamed to "consumer" so the neighbours of all the queries never need
+// to be in memory at the same time.
+absl::Status NearestNeighbors(
+    absl::Span<const std::unique_ptr<DecisionTree>> trees,
+    const LeafExampleIndex& index, const dataset::VerticalDataset& queries,
+    const NearestNeighborsOptions& options, const NeighborsConsumer& consumer);
+
+// Finds the neighbours in "dataset2" of each example in "dataset1".
+// "neighbors[i]" are the neighbours of the i-th example of "dataset1".
+absl::StatusOr<std::vector<std::vector<Neighbor>>> NearestNeighbors(
+    absl::Span<const std::unique_ptr<DecisionTree>> trees,
+    const dataset::VerticalDataset& dataset1,
+    const dataset::VerticalDataset& dataset2,
+    const NearestNeighborsOptions& options);
+
+}  // namespace decision_tree
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_MODEL_DECISION_TREE_PROXIMITY_H_
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/model/decision_tree/proximity.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/types.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
+#include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace decision_tree {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::yggdrasil_decision_forests::dataset::proto::ColumnType;
+using ::yggdrasil_decision_forests::dataset::proto::DataSpecification;
+
+// Builds a decision tree with a single condition and two leaf nodes.
+//
+// attribute >= threshold
+//     ├─(neg)─ leaf #0
+//     └─(pos)─ leaf #1
+absl::StatusOr<std::unique_ptr<DecisionTree>> MakeTree(const float threshold) {
+  auto tree = std::make_unique<DecisionTree>();
+  tree->CreateRoot();
+  NodeWithChildren* root = tree->mutable_root();
+  STATUS_CHECK(root);
+  root->CreateChildren();
+  root->mutable_node()->mutable_condition()->set_attribute(0);
+  root->mutable_node()
+      ->mutable_condition()
+      ->mutable_condition()
+      ->mutable_higher_condition()
+      ->set_threshold(threshold);
+  tree->SetLeafIndices();
+  return tree;
+}
+
+absl::StatusOr<std::vector<std::unique_ptr<DecisionTree>>> MakeForest(
+    const std::vector<float>& thresholds) {
+  std::vector<std::unique_ptr<DecisionTree>> trees;
+  for (const float threshold : thresholds) {
+    ASSIGN_OR_RETURN(auto tree, MakeTree(threshold));
+    trees.push_back(std::move(tree));
+  }
+  return trees;
+}
+
+// Dataset with a single numerical column "a" with the given values.
+absl::StatusOr<dataset::VerticalDataset> MakeDataset(
+    const std::vector<int>& values) {
+  DataSpecification dataspec;
+  dataset::AddColumn("a", ColumnType::NUMERICAL, &dataspec);
+  dataset::VerticalDataset dataset;
+  dataset.set_data_spec(dataspec);
+  RETURN_IF_ERROR(dataset.CreateColumnsFromDataspec());
+  for (const int value : values) {
+    dataset.AppendExample({{"a", absl::StrCat(value)}});
+  }
+  return dataset;
+}
+
+TEST(Proximity, SmallExample) {
+  // Same forest and datasets as the "DecisionTree.Distance" test.
+  ASSERT_OK_AND_ASSIGN(const auto trees, MakeForest({0.5f, 1.5f}));
+  ASSERT_OK_AND_ASSIGN(const auto dataset1, MakeDataset({0, 2}));
+  ASSERT_OK_AND_ASSIGN(const auto dataset2, MakeDataset({1, -1}));
+
+  ASSERT_OK_AND_ASSIGN(const auto index,
+                       LeafExampleIndex::Create(trees, dataset2, 2));
+  EXPECT_EQ(index.num_trees(), 2);
+  EXPECT_EQ(index.num_examples(), 2);
+  EXPECT_THAT(index.Examples(0, 0), ElementsAre(1));
+  EXPECT_THAT(index.Examples(0, 1), ElementsAre(0));
+  EXPECT_THAT(index.Examples(1, 0), ElementsAre(0, 1));
+  EXPECT_THAT(index.Examples(1, 1), IsEmpty());
+  EXPECT_GT(index.MemoryUsage(), 0);
+
+  NearestNeighborsOptions options;
+  options.top_k = -1;
+  ASSERT_OK_AND_ASSIGN(const auto neighbors,
+                       NearestNeighbors(trees, dataset1, dataset2, options));
+  // Distances: {0.5, 0} for the first query, {0.5, 1} for the second one.
+  EXPECT_THAT(neighbors,
+              ElementsAre(ElementsAre(Neighbor{1, 0.f}, Neighbor{0, 0.5f}),
+                          ElementsAre(Neighbor{0, 0.5f})));
+}
+
+TEST(Proximity, EmptyDatasets) {
+  ASSERT_OK_AND_ASSIGN(const auto trees, MakeForest({0.5f, 1.5f}));
+  ASSERT_OK_AND_ASSIGN(const auto empty_dataset, MakeDataset({}));
+  ASSERT_OK_AND_ASSIGN(const auto dataset, MakeDataset({0, 2}));
+
+  ASSERT_OK_AND_ASSIGN(const auto index,
+                       LeafExampleIndex::Create(trees, empty_dataset, 2));
+  EXPECT_EQ(index.num_trees(), 2);
+  EXPECT_EQ(index.num_examples(), 0);
+  EXPECT_THAT(index.Examples(0, 0), IsEmpty());
+  EXPECT_THAT(index.Examples(1, 1), IsEmpty());
+
+  NearestNeighborsOptions options;
+  options.num_threads = 2;
+  // No indexed examples.
+  ASSERT_OK_AND_ASSIGN(
+      const auto neighbors,
+      NearestNeighbors(trees, dataset, empty_dataset, options));
+  EXPECT_THAT(neighbors, ElementsAre(IsEmpty(), IsEmpty()));
+  // No query examples.
+  ASSERT_OK_AND_ASSIGN(
+      const auto no_neighbors,
+      NearestNeighbors(trees, empty_dataset, dataset, options));
+  EXPECT_THAT(no_neighbors, IsEmpty());
+}
+
+TEST(Proximity, MatchesDistance) {
+  ASSERT_OK_AND_ASSIGN(const auto trees,
+                       MakeForest({0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 2.5f}));
+  std::vector<int> values1, values2;
+  for (int i = 0; i < 50; i++) {
+    values1.push_back((i * 7) % 8);
+  }
+  for (int i = 0; i < 70; i++) {
+    values2.push_back((i * 3) % 9 - 1);
+  }
+  ASSERT_OK_AND_ASSIGN(const auto dataset1, MakeDataset(values1));
+  ASSERT_OK_AND_ASSIGN(const auto dataset2, MakeDataset(values2));
+
+  std::vector<float> distances(values1.size() * values2.size());
+  ASSERT_OK(Distance(trees, dataset1, dataset2, absl::MakeSpan(distances)));
+
+  for (const int top_k : {-1, 1, 5}) {
+    for (const float max_distance : {1.f, 0.5f}) {
+      NearestNeighborsOptions options;
+      options.top_k = top_k;
+      options.max_distance = max_distance;
+      options.num_threads = 3;
+      options.block_size = 7;
+      ASSERT_OK_AND_ASSIGN(
+          const auto neighbors,
+          NearestNeighbors(trees, dataset1, dataset2, options));
+      ASSERT_EQ(neighbors.size(), values1.size());
+
+      for (int i = 0; i < values1.size(); i++) {
+        // Expected neighbors from the dense distance matrix.
+        std::vector<Neighbor> expected;
+        for (int j = 0; j < values2.size(); j++) {
+          const float distance = distances[i * values2.size() + j];
+          if (distance < 1.f && distance <= max_distance) {
+            expected.push_back({static_cast<UnsignedExampleIdx>(j), distance});
+          }
+        }
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const Neighbor& a, const Neighbor& b) {
+                           return a.distance < b.distance;
+                         });
+        if (top_k >= 0 && expected.size() > top_k) {
+          expected.resize(top_k);
+        }
+        EXPECT_EQ(neighbors[i], expected)
+            << "top_k=" << top_k << " max_distance=" << max_distance
+            << " example=" << i;
+      }
+    }
+  }
+}
+
+TEST(Proximity, Streaming) {
+  ASSERT_OK_AND_ASSIGN(const auto trees, MakeForest({0.5f, 1.5f, 2.5f}));
+  std::vector<int> values;
+  for (int i = 0; i < 100; i++) {
+    values.push_back(i % 4);
+  }
+  ASSERT_OK_AND_ASSIGN(const auto dataset, MakeDataset(values));
+  ASSERT_OK_AND_ASSIGN(const auto index,
+                       LeafExampleIndex::Create(trees, dataset, 4));
+
+  NearestNeighborsOptions options;
+  options.top_k = 3;
+  options.num_threads = 4;
+  options.block_size = 9;
+
+  UnsignedExampleIdx next_example_idx = 0;
+  ASSERT_OK(NearestNeighbors(
+      trees, index, dataset, options,
+      [&](const UnsignedExampleIdx begin_example_idx,
+          const absl::Span<const std::vector<Neighbor>> neighbors) {
+        // Blocks are received in order.
+        EXPECT_EQ(begin_example_idx, next_example_idx);
+        EXPECT_LE(neighbors.size(), options.block_size);
+        for (int i = 0; i < neighbors.size(); i++) {
+          // The closest neighbours are the examples with the same value.
+          const int example_idx = begin_example_idx + i;
+          EXPECT_THAT(neighbors[i],
+                      ElementsAre(Neighbor{static_cast<UnsignedExampleIdx>(
+                                               example_idx % 4),
+                                           0.f},
+                                  Neighbor{static_cast<UnsignedExampleIdx>(
+                                               example_idx % 4 + 4),
+                                           0.f},
+                                  Neighbor{static_cast<UnsignedExampleIdx>(
+                                               example_idx % 4 + 8),
+                                           0.f}));
+        }
+        next_example_idx += neighbors.size();
+        return absl::OkStatus();
+      }));
+  EXPECT_EQ(next_example_idx, values.size());
+
+  // An error in the consumer stops the computation.
+  int num_calls = 0;
+  EXPECT_THAT(
+      NearestNeighbors(
+          trees, index, dataset, options,
+          [&](const UnsignedExampleIdx begin_example_idx,
+              const absl::Span<const std::vector<Neighbor>> neighbors) {
+            num_calls++;
+            return absl::InternalError("Stop");
+          }),
+      test::StatusIs(absl::StatusCode::kInternal));
+  EXPECT_EQ(num_calls, 1);
+}
+
+}  // namespace
+}  // namespace decision_tree
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
@@ -0,0 +1,564 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/model/decision_tree/tree_shap.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace decision_tree {
+namespace {
+
+// Number of blocks of examples per thread.
+constexpr int kNumBlocksPerThread = 4;
+
+// A node of a flat tree.
+struct FlatNode {
+  // Condition of the node. nullptr for a leaf.
+  const proto::NodeCondition* condition = nullptr;
+  int32_t negative_child = -1;
+  int32_t positive_child = -1;
+  // Number of (weighted) training examples that reached the node. Only used
+  // by the path-dependent algorithm.
+  double cover = 0;
+  // Index, in "FlatTree::leaf_values", of the first value of the leaf.
+  int32_t value_offset = -1;
+};
+
+// A decision tree with contiguous nodes and leaf values.
+struct FlatTree {
+  // "nodes[0]" is the root.
+  std::vector<FlatNode> nodes;
+  // Outputs of the model to which the tree contributes. Multi-class Gradient
+  // Boosted Trees, for instance, only contribute to one output per tree.
+  std::vector<int> output_idxs;
+  // "leaf_values[node.value_offset + i]" is the value of the leaf "node" for
+  // the output "output_idxs[i]".
+  std::vector<float> leaf_values;
+  // Maximum depth of a leaf. The root has a depth of 0.
+  int max_depth = 0;
+
+  int child(const FlatNode& node, const bool positive) const {
+    return positive ? node.positive_child : node.negative_child;
+  }
+};
+
+// Number of training examples in a node and in its positive child.
+absl::Status GetConditionCovers(const proto::NodeCondition& condition,
+                                double* cover, double* positive_cover) {
+  *cover = condition.num_training_examples_with_weight();
+  *positive_cover = condition.num_pos_training_examples_with_weight();
+  if (*cover <= 0) {
+    *cover = condition.num_training_examples_without_weight();
+    *positive_cover = condition.num_pos_training_examples_without_weight();
+  }
+  if (*cover <= 0 || *positive_cover < 0 || *positive_cover > *cover) {
+    return absl::FailedPreconditionError(
+        "The path-dependent SHAP values require the number of training "
+        "examples in the nodes of the trees, which this model does not "
+        "contain. Compute interventional SHAP values (i.e. with a background "
+        "dataset) instead.");
+  }
+  return absl::OkStatus();
+}
+
+// Adds the node "node" and its children to "flat_tree". "values" are the leaf
+// values for all the outputs of the model.
+absl::Status AddNode(const NodeWithChildren& node, const double cover,
+                     const int depth, const int tree_idx,
+                     const ShapForestDefinition& forest,
+                     const bool path_dependent, FlatTree* flat_tree,
+                     std::vector<float>* values) {
+  const int node_idx = flat_tree->nodes.size();
+  flat_tree->nodes.emplace_back();
+  flat_tree->nodes[node_idx].cover = cover;
+  flat_tree->max_depth = std::max(flat_tree->max_depth, depth);
+
+  if (node.IsLeaf()) {
+    flat_tree->nodes[node_idx].value_offset = values->size();
+    values->resize(values->size() + forest.num_outputs, 0.f);
+    forest.leaf_values(
+        tree_idx, node.node(),
+        absl::MakeSpan(*values).subspan(
+            flat_tree->nodes[node_idx].value_offset, forest.num_outputs));
+    return absl::OkStatus();
+  }
+
+  const auto& condition = node.node().condition();
+  if (condition.condition().has_oblique_condition()) {
+    return absl::InvalidArgumentError(
+        "SHAP values are not supported for models with oblique conditions");
+  }
+  flat_tree->nodes[node_idx].condition = &condition;
+
+  double node_cover = 0;
+  double positive_cover = 0;
+  if (path_dependent) {
+    RETURN_IF_ERROR(GetConditionCovers(condition, &node_cover,
+                                       &positive_cover));
+    flat_tree->nodes[node_idx].cover = node_cover;
+  }
+
+  const int negative_child = flat_tree->nodes.size();
+  RETURN_IF_ERROR(AddNode(*node.neg_child(), node_cover - positive_cover,
+                          depth + 1, tree_idx, forest, path_dependent,
+                          flat_tree, values));
+  const int positive_child = flat_tree->nodes.size();
+  RETURN_IF_ERROR(AddNode(*node.pos_child(), positive_cover, depth + 1,
+                          tree_idx, forest, path_dependent, flat_tree,
+                          values));
+  flat_tree->nodes[node_idx].negative_child = negative_child;
+  flat_tree->nodes[node_idx].positive_child = positive_child;
+  return absl::OkStatus();
+}
+
+// Converts a tree into a flat tree. Only the outputs with at least one
+// non-zero leaf value are kept.
+absl::StatusOr<FlatTree> FlattenTree(const int tree_idx,
+                                     const ShapForestDefinition& forest,
+                                     const bool path_dependent) {
+  FlatTree flat_tree;
+  std::vector<float> values;
+  RETURN_IF_ERROR(AddNode(forest.trees[tree_idx]->root(), /*cover=*/1.,
+                          /*depth=*/0, tree_idx, forest, path_dependent,
+                          &flat_tree, &values));
+
+  const int num_leaves = values.size() / forest.num_outputs;
+  for (int output_idx = 0; output_idx < forest.num_outputs; output_idx++) {
+    for (int leaf_idx = 0; leaf_idx < num_leaves; leaf_idx++) {
+      if (values[leaf_idx * forest.num_outputs + output_idx] != 0.f) {
+        flat_tree.output_idxs.push_back(output_idx);
+        break;
+      }
+    }
+  }
+
+  const int num_tree_outputs = flat_tree.output_idxs.size();
+  flat_tree.leaf_values.reserve(num_leaves * num_tree_outputs);
+  for (auto& node : flat_tree.nodes) {
+    if (node.condition != nullptr) {
+      continue;
+    }
+    const int src_offset = node.value_offset;
+    node.value_offset = flat_tree.leaf_values.size();
+    for (const int output_idx : flat_tree.output_idxs) {
+      flat_tree.leaf_values.push_back(values[src_offset + output_idx]);
+    }
+  }
+  return flat_tree;
+}
+
+// Active leaf of an example.
+const FlatNode& GetLeaf(const FlatTree& tree,
+                        const dataset::VerticalDataset& dataset,
+                        const dataset::VerticalDataset::row_t row) {
+  const FlatNode* node = &tree.nodes[0];
+  while (node->condition != nullptr) {
+    node = &tree.nodes[tree.child(
+        *node, EvalCondition(*node->condition, dataset, row))];
+  }
+  return *node;
+}
+
+// Adds the values of a leaf, multiplied by "weight", to "output" (indexed by
+// output).
+void AddLeafValues(const FlatTree& tree, const FlatNode& leaf,
+                   const double weight, double* output) {
+  for (int i = 0; i < tree.output_idxs.size(); i++) {
+    output[tree.output_idxs[i]] +=
+        weight * tree.leaf_values[leaf.value_offset + i];
+  }
+}
+
+// Expected value of a tree according to the training statistics of its nodes.
+void AddPathDependentExpectedValue(const FlatTree& tree, const int node_idx,
+                                   const double weight, double* output) {
+  const auto& node = tree.nodes[node_idx];
+  if (node.condition == nullptr) {
+    AddLeafValues(tree, node, weight, output);
+    return;
+  }
+  for (const int child_idx : {node.negative_child, node.positive_child}) {
+    AddPathDependentExpectedValue(
+        tree, child_idx, weight * tree.nodes[child_idx].cover / node.cover,
+        output);
+  }
+}
+
+// Path-dependent TreeSHAP.
+//
+// An element of the path of features from the root to the current node.
+struct PathElement {
+  int feature_idx;
+  // Fraction of the "zero" paths (i.e. the feature is missing) going through
+  // this element.
+  double zero_fraction;
+  // Fraction of the "one" paths (i.e. the feature is present) going through
+  // this element.
+  double one_fraction;
+  // Weight of the subsets of a given cardinality.
+  double weight;
+};
+
+void ExtendPath(PathElement* path, const int unique_depth,
+                const double zero_fraction, const double one_fraction,
+                const int feature_idx) {
+  path[unique_depth] = {feature_idx, zero_fraction, one_fraction,
+                        unique_depth == 0 ? 1. : 0.};
+  for (int i = unique_depth - 1; i >= 0; i--) {
+    path[i + 1].weight +=
+        one_fraction * path[i].weight * (i + 1) / (unique_depth + 1);
+    path[i].weight = zero_fraction * path[i].weight * (unique_depth - i) /
+                     (unique_depth + 1);
+  }
+}
+
+// Reverts the "ExtendPath" of the element "path_idx".
+void UnwindPath(PathElement* path, const int unique_depth,
+                const int path_idx) {
+  const double one_fraction = path[path_idx].one_fraction;
+  const double zero_fraction = path[path_idx].zero_fraction;
+  double next_one_portion = path[unique_depth].weight;
+  for (int i = unique_depth - 1; i >= 0; i--) {
+    if (one_fraction != 0) {
+      const double tmp = path[i].weight;
+      path[i].weight =
+          next_one_portion * (unique_depth + 1) / ((i + 1) * one_fraction);
+      next_one_portion = tmp - path[i].weight * zero_fraction *
+                                   (unique_depth - i) / (unique_depth + 1);
+    } else {
+      path[i].weight = path[i].weight * (unique_depth + 1) /
+                       (zero_fraction * (unique_depth - i));
+    }
+  }
+  for (int i = path_idx; i < unique_depth; i++) {
+    path[i].feature_idx = path[i + 1].feature_idx;
+    path[i].zero_fraction = path[i + 1].zero_fraction;
+    path[i].one_fraction = path[i + 1].one_fraction;
+  }
+}
+
+// Total weight of the path if the element "path_idx" was unwound.
+double UnwoundPathSum(const PathElement* path, const int unique_depth,
+                      const int path_idx) {
+  const double one_fraction = path[path_idx].one_fraction;
+  const double zero_fraction = path[path_idx].zero_fraction;
+  double next_one_portion = path[unique_depth].weight;
+  double total = 0;
+  for (int i = unique_depth - 1; i >= 0; i--) {
+    if (one_fraction != 0) {
+      const double tmp =
+          next_one_portion * (unique_depth + 1) / ((i + 1) * one_fraction);
+      total += tmp;
+      next_one_portion = path[i].weight - tmp * zero_fraction *
+                                              (unique_depth - i) /
+                                              (unique_depth + 1);
+    } else if (zero_fraction != 0) {
+      total += path[i].weight / zero_fraction /
+               (static_cast<double>(unique_depth - i) / (unique_depth + 1));
+    }
+  }
+  return total;
+}
+
+void PathDependentShap(const FlatTree& tree, const int node_idx,
+                       const dataset::VerticalDataset& dataset,
+                       const dataset::VerticalDataset::row_t row,
+                       const int num_outputs, PathElement* parent_path,
+                       int unique_depth, const double parent_zero_fraction,
+                       const double parent_one_fraction,
+                       const int parent_feature_idx, double* phi) {
+  // Each level of the recursion works on its own copy of the path.
+  PathElement* path = parent_path + unique_depth + 1;
+  std::copy(parent_path, parent_path + unique_depth + 1, path);
+  ExtendPath(path, unique_depth, parent_zero_fraction, parent_one_fraction,
+             parent_feature_idx);
+
+  const auto& node = tree.nodes[node_idx];
+  if (node.condition == nullptr) {
+    for (int i = 1; i <= unique_depth; i++) {
+      const double weight = UnwoundPathSum(path, unique_depth, i) *
+                            (path[i].one_fraction - path[i].zero_fraction);
+      AddLeafValues(tree, node, weight,
+                    phi + path[i].feature_idx * num_outputs);
+    }
+    return;
+  }
+
+  const int feature_idx = node.condition->attribute();
+  const int hot_idx =
+      tree.child(node, EvalCondition(*node.condition, dataset, row));
+  const int cold_idx = hot_idx == node.positive_child ? node.negative_child
+                                                      : node.positive_child;
+  const double hot_zero_fraction = tree.nodes[hot_idx].cover / node.cover;
+  const double cold_zero_fraction = tree.nodes[cold_idx].cover / node.cover;
+
+  // If the feature was already tested on the path, its previous split is
+  // undone and combined with the current one.
+  double incoming_zero_fraction = 1;
+  double incoming_one_fraction = 1;
+  int path_idx = 0;
+  while (path_idx <= unique_depth &&
+         path[path_idx].feature_idx != feature_idx) {
+    path_idx++;
+  }
+  if (path_idx <= unique_depth) {
+    incoming_zero_fraction = path[path_idx].zero_fraction;
+    incoming_one_fraction = path[path_idx].one_fraction;
+    UnwindPath(path, unique_depth, path_idx);
+    unique_depth--;
+  }
+
+  PathDependentShap(tree, hot_idx, dataset, row, num_outputs, path,
+                    unique_depth + 1,
+                    hot_zero_fraction * incoming_zero_fraction,
+                    incoming_one_fraction, feature_idx, phi);
+  PathDependentShap(tree, cold_idx, dataset, row, num_outputs, path,
+                    unique_depth + 1,
+                    cold_zero_fraction * incoming_zero_fraction, 0,
+                    feature_idx, phi);
+}
+
+// Interventional TreeSHAP.
+//
+// Features tested on the current path, for which the example and the
+// background example go in different directions.
+struct InterventionalState {
+  enum Source : int8_t { kUnset = 0, kExample = 1, kBackground = 2 };
+  // Which of the example or the background example gives the value of each
+  // feature.
+  std::vector<Source> sources;
+  std::vector<int> example_features;
+  std::vector<int> background_features;
+  // "weights[a][b] = a! b! / (a + b + 1)!" is the Shapley weight of a leaf
+  // reached with "a+1" features from the example and "b" features from the
+  // background example (or the converse).
+  std::vector<std::vector<double>> weights;
+};
+
+void InterventionalShap(const FlatTree& tree, const int node_idx,
+                        const dataset::VerticalDataset& dataset,
+                        const dataset::VerticalDataset::row_t row,
+                        const dataset::VerticalDataset& background,
+                        const dataset::VerticalDataset::row_t background_row,
+                        const int num_outputs, InterventionalState* state,
+                        double* phi) {
+  const auto& node = tree.nodes[node_idx];
+  if (node.condition == nullptr) {
+    const int num_example = state->example_features.size();
+    const int num_background = state->background_features.size();
+    if (num_example > 0) {
+      const double weight = state->weights[num_example - 1][num_background];
+      for (const int feature_idx : state->example_features) {
+        AddLeafValues(tree, node, weight, phi + feature_idx * num_outputs);
+      }
+    }
+    if (num_background > 0) {
+      const double weight = state->weights[num_example][num_background - 1];
+      for (const int feature_idx : state->background_features) {
+        AddLeafValues(tree, node, -weight, phi + feature_idx * num_outputs);
+      }
+    }
+    return;
+  }
+
+  const bool example_eval = EvalCondition(*node.condition, dataset, row);
+  const bool background_eval =
+      EvalCondition(*node.condition, background, background_row);
+  const int example_child = tree.child(node, example_eval);
+  if (example_eval == background_eval) {
+    InterventionalShap(tree, example_child, dataset, row, background,
+                       background_row, num_outputs, state, phi);
+    return;
+  }
+  const int background_child = tree.child(node, background_eval);
+  const int feature_idx = node.condition->attribute();
+  switch (state->sources[feature_idx]) {
+    case InterventionalState::kExample:
+      InterventionalShap(tree, example_child, dataset, row, background,
+                         background_row, num_outputs, state, phi);
+      break;
+    case InterventionalState::kBackground:
+      InterventionalShap(tree, background_child, dataset, row, background,
+                         background_row, num_outputs, state, phi);
+      break;
+    case InterventionalState::kUnset:
+      state->sources[feature_idx] = InterventionalState::kExample;
+      state->example_features.push_back(feature_idx);
+      InterventionalShap(tree, example_child, dataset, row, background,
+                         background_row, num_outputs, state, phi);
+      state->example_features.pop_back();
+
+      state->sources[feature_idx] = InterventionalState::kBackground;
+      state->background_features.push_back(feature_idx);
+      InterventionalShap(tree, background_child, dataset, row, background,
+                         background_row, num_outputs, state, phi);
+      state->background_features.pop_back();
+      state->sources[feature_idx] = InterventionalState::kUnset;
+      break;
+  }
+}
+
+}  // namespace
+
+absl::Status ComputeShapValues(const ShapForestDefinition& forest,
+                               const dataset::VerticalDataset& dataset,
+                               const ShapOptions& options,
+                               ShapValues* shap_values) {
+  STATUS_CHECK_GT(forest.num_outputs, 0);
+  STATUS_CHECK(forest.leaf_values);
+  if (!forest.bias.empty()) {
+    STATUS_CHECK_EQ(forest.bias.size(), forest.num_outputs);
+  }
+  const auto* background = options.background;
+  const bool path_dependent = background == nullptr;
+  if (background != nullptr) {
+    if (background->ncol() != dataset.ncol()) {
+      return absl::InvalidArgumentError(
+          "The background dataset and the dataset have different columns");
+    }
+    if (background->nrow() == 0) {
+      return absl::InvalidArgumentError("The background dataset is empty");
+    }
+  }
+
+  const int num_outputs = forest.num_outputs;
+  const int num_columns = dataset.ncol();
+
+  std::vector<FlatTree> trees;
+  trees.reserve(forest.trees.size());
+  int max_depth = 0;
+  for (int tree_idx = 0; tree_idx < forest.trees.size(); tree_idx++) {
+    ASSIGN_OR_RETURN(auto flat_tree,
+                     FlattenTree(tree_idx, forest, path_dependent));
+    max_depth = std::max(max_depth, flat_tree.max_depth);
+    for (const auto& node : flat_tree.nodes) {
+      if (node.condition != nullptr &&
+          node.condition->attribute() >= num_columns) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "The model uses the column ", node.condition->attribute(),
+            " but the dataset only has ", num_columns, " columns"));
+      }
+    }
+    trees.push_back(std::move(flat_tree));
+  }
+
+  // Expected values.
+  std::vector<double> expected_values(num_outputs, 0.);
+  if (!forest.bias.empty()) {
+    std::copy(forest.bias.begin(), forest.bias.end(),
+              expected_values.begin());
+  }
+  for (const auto& tree : trees) {
+    if (path_dependent) {
+      AddPathDependentExpectedValue(tree, 0, 1., expected_values.data());
+    } else {
+      for (dataset::VerticalDataset::row_t background_row = 0;
+           background_row < background->nrow(); background_row++) {
+        AddLeafValues(tree, GetLeaf(tree, *background, background_row),
+                      1. / background->nrow(), expected_values.data());
+      }
+    }
+  }
+
+  shap_values->num_examples = dataset.nrow();
+  shap_values->num_columns = num_columns;
+  shap_values->num_outputs = num_outputs;
+  shap_values->expected_values.assign(expected_values.begin(),
+                                      expected_values.end());
+  shap_values->values.assign(
+      static_cast<size_t>(dataset.nrow()) * num_columns * num_outputs, 0.f);
+  if (dataset.nrow() == 0) {
+    return absl::OkStatus();
+  }
+
+  const auto process_block = [&](const size_t block_idx,
+                                 const size_t begin_example_idx,
+                                 const size_t end_example_idx) {
+    std::vector<double> phi(num_columns * num_outputs);
+    // Path-dependent working memory.
+    std::vector<PathElement> path((max_depth + 3) * (max_depth + 4) / 2);
+    // Interventional working memory.
+    InterventionalState state;
+    if (!path_dependent) {
+      state.sources.assign(num_columns, InterventionalState::kUnset);
+      state.weights.assign(max_depth + 1,
+                           std::vector<double>(max_depth + 1, 0.));
+      for (int a = 0; a <= max_depth; a++) {
+        for (int b = 0; a + b <= max_depth; b++) {
+          state.weights[a][b] =
+              std::exp(std::lgamma(a + 1) + std::lgamma(b + 1) -
+                       std::lgamma(a + b + 2));
+        }
+      }
+    }
+
+    for (size_t example_idx = begin_example_idx; example_idx < end_example_idx;
+         example_idx++) {
+      std::fill(phi.begin(), phi.end(), 0.);
+      for (const auto& tree : trees) {
+        if (path_dependent) {
+          PathDependentShap(tree, 0, dataset, example_idx, num_outputs,
+                            path.data(), /*unique_depth=*/0,
+                            /*parent_zero_fraction=*/1,
+                            /*parent_one_fraction=*/1,
+                            /*parent_feature_idx=*/-1, phi.data());
+        } else {
+          for (dataset::VerticalDataset::row_t background_row = 0;
+               background_row < background->nrow(); background_row++) {
+            InterventionalShap(tree, 0, dataset, example_idx, *background,
+                               background_row, num_outputs, &state,
+                               phi.data());
+          }
+        }
+      }
+      const double scale = path_dependent ? 1. : 1. / background->nrow();
+      auto* dst = &shap_values->values[example_idx * num_columns * num_outputs];
+      for (int i = 0; i < phi.size(); i++) {
+        dst[i] = phi[i] * scale;
+      }
+    }
+  };
+
+  const int num_threads = std::max(1, options.num_threads);
+  utils::concurrency::ThreadPool pool("shap", num_threads);
+  pool.StartWorkers();
+  utils::concurrency::ConcurrentForLoop(
+      std::min<size_t>(dataset.nrow(), num_threads * kNumBlocksPerThread),
+      &pool, dataset.nrow(), process_block);
+  return absl::OkStatus();
+}
+
+}  // namespace decision_tree
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
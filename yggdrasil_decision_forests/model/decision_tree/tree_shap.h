@@ -0,0 +1,99 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Exact SHAP values (Shapley additive feature attributions) of decision
+// forests.
+//
+// Two definitions of the output of the model with a subset of the features are
+// supported (see "ShapOptions::background"):
+//
+//   - Path-dependent TreeSHAP: The missing features are marginalized with the
+//     number of training examples that reached each node. This is Algorithm 2
+//     of "Consistent Individualized Feature Attribution for Tree Ensembles",
+//     Lundberg et al., 2018. The cost is O(num_leaves * depth^2) per tree and
+//     example.
+//
+//   - Interventional TreeSHAP: The missing features take the value of a
+//     background example. The SHAP values are averaged over the background
+//     examples. The cost is linear in the number of background examples.
+//
+// The trees are first converted into a flat representation (contiguous nodes
+// with their training statistics, and contiguous leaf values) shared by the
+// threads. The examples are processed in parallel.
+//
+// The SHAP values of conditions on multiple attributes (e.g. oblique
+// conditions) are not defined. Such models are rejected.
+//
+// Usage example:
+//
+//   ShapForestDefinition forest;
+//   forest.trees = absl::MakeConstSpan(decision_trees);
+//   forest.num_outputs = 1;
+//   forest.bias = {initial_prediction};
+//   forest.leaf_values = [](const int tree_idx, const proto::Node& leaf,
+//                           absl::Span<float> values) {
+//     values[0] = leaf.regressor().top_value();
+//   };
+//   ShapValues shap_values;
+//   RETURN_IF_ERROR(ComputeShapValues(forest, dataset, {}, &shap_values));
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_MODEL_DECISION_TREE_TREE_SHAP_H_
+#define YGGDRASIL_DECISION_FORESTS_MODEL_DECISION_TREE_TREE_SHAP_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace decision_tree {
+
+// A decision forest seen as a sum of per-tree outputs.
+struct ShapForestDefinition {
+  absl::Span<const std::unique_ptr<DecisionTree>> trees;
+
+  // Number of outputs of the model.
+  int num_outputs = 1;
+
+  // Writes the contribution of the leaf "leaf" of the tree "tree_idx" to the
+  // "num_outputs" outputs of the model in "values". "values" is initially
+  // zero.
+  std::function<void(int tree_idx, const proto::Node& leaf,
+                     absl::Span<float> values)>
+      leaf_values;
+
+  // Constant part of each output. If empty, zero.
+  std::vector<float> bias;
+};
+
+// Computes the SHAP values of the examples in "dataset". The output of the
+// model is the bias plus the sum of the leaf values.
+absl::Status ComputeShapValues(const ShapForestDefinition& forest,
+                               const dataset::VerticalDataset& dataset,
+                               const ShapOptions& options,
+                               ShapValues* shap_values);
+
+}  // namespace decision_tree
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_MODEL_DECISION_TREE_TREE_SHAP_H_
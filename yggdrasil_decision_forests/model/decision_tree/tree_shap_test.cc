@@ -0,0 +1,341 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/model/decision_tree/tree_shap.h"
+
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/abstract_model.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_forest_interface.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+#include "yggdrasil_decision_forests/model/prediction.pb.h"
+#include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/test_utils.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace model {
+namespace decision_tree {
+namespace {
+
+using test::StatusIs;
+
+dataset::VerticalDataset ExtractRows(const dataset::VerticalDataset& dataset,
+                                     const std::vector<int>& rows) {
+  return dataset.Extract(rows).value();
+}
+
+// The multi-class GBT as a 3-outputs forest.
+ShapForestDefinition MultiClassGbtForest(const AbstractModel& model) {
+  const auto* df_model =
+      dynamic_cast<const DecisionForestInterface*>(&model);
+  ShapForestDefinition forest;
+  forest.trees = absl::MakeConstSpan(df_model->decision_trees());
+  forest.num_outputs = 3;
+  forest.leaf_values = [](const int tree_idx, const proto::Node& leaf,
+                          absl::Span<float> values) {
+    values[tree_idx % 3] = leaf.regressor().top_value();
+  };
+  return forest;
+}
+
+// Output of a tree in which the features not in "present" take the value of
+// the background example (interventional) or are marginalized with the
+// training statistics of the nodes (path-dependent, if "background" is null).
+void AddTreeValue(const ShapForestDefinition& forest, const int tree_idx,
+                  const NodeWithChildren& node,
+                  const dataset::VerticalDataset& dataset,
+                  const dataset::VerticalDataset::row_t row,
+                  const dataset::VerticalDataset* background,
+                  const dataset::VerticalDataset::row_t background_row,
+                  const std::vector<bool>& present, const double weight,
+                  std::vector<double>* output) {
+  if (node.IsLeaf()) {
+    std::vector<float> values(forest.num_outputs, 0.f);
+    forest.leaf_values(tree_idx, node.node(), absl::MakeSpan(values));
+    for (int output_idx = 0; output_idx < forest.num_outputs; output_idx++) {
+      (*output)[output_idx] += weight * values[output_idx];
+    }
+    return;
+  }
+  const auto& condition = node.node().condition();
+  const auto recurse = [&](const NodeWithChildren& child,
+                           const double child_weight) {
+    AddTreeValue(forest, tree_idx, child, dataset, row, background,
+                 background_row, present, child_weight, output);
+  };
+  bool eval;
+  if (present[condition.attribute()]) {
+    eval = EvalCondition(condition, dataset, row);
+  } else if (background != nullptr) {
+    eval = EvalCondition(condition, *background, background_row);
+  } else {
+    double total = condition.num_training_examples_with_weight();
+    double positive = condition.num_pos_training_examples_with_weight();
+    if (total <= 0) {
+      total = condition.num_training_examples_without_weight();
+      positive = condition.num_pos_training_examples_without_weight();
+    }
+    recurse(*node.pos_child(), weight * positive / total);
+    recurse(*node.neg_child(), weight * (total - positive) / total);
+    return;
+  }
+  recurse(eval ? *node.pos_child() : *node.neg_child(), weight);
+}
+
+std::vector<double> ForestValue(const ShapForestDefinition& forest,
+                                const dataset::VerticalDataset& dataset,
+                                const dataset::VerticalDataset::row_t row,
+                                const dataset::VerticalDataset* background,
+                                const std::vector<bool>& present) {
+  std::vector<double> output(forest.num_outputs, 0.);
+  const int num_background_rows =
+      background != nullptr ? background->nrow() : 1;
+  for (int background_row = 0; background_row < num_background_rows;
+       background_row++) {
+    for (int tree_idx = 0; tree_idx < forest.trees.size(); tree_idx++) {
+      AddTreeValue(forest, tree_idx, forest.trees[tree_idx]->root(), dataset,
+                   row, background, background_row, present,
+                   1. / num_background_rows, &output);
+    }
+  }
+  return output;
+}
+
+// Exact Shapley values by enumeration of the subsets of features.
+void ExpectSameAsBruteForce(const ShapForestDefinition& forest,
+                            const std::vector<int>& features,
+                            const dataset::VerticalDataset& dataset,
+                            const dataset::VerticalDataset* background,
+                            const ShapValues& shap_values) {
+  const int num_features = features.size();
+  for (dataset::VerticalDataset::row_t row = 0; row < dataset.nrow(); row++) {
+    std::vector<double> expected(dataset.ncol() * forest.num_outputs, 0.);
+    for (int mask = 0; mask < (1 << num_features); mask++) {
+      std::vector<bool> present(dataset.ncol(), false);
+      int subset_size = 0;
+      for (int i = 0; i < num_features; i++) {
+        if (mask & (1 << i)) {
+          present[features[i]] = true;
+          subset_size++;
+        }
+      }
+      const auto value_without = ForestValue(forest, dataset, row, background,
+                                             present);
+      const double weight = std::exp(std::lgamma(subset_size + 1) +
+                                     std::lgamma(num_features - subset_size) -
+                                     std::lgamma(num_features + 1));
+      for (int i = 0; i < num_features; i++) {
+        if (mask & (1 << i)) {
+          continue;
+        }
+        present[features[i]] = true;
+        const auto value_with =
+            ForestValue(forest, dataset, row, background, present);
+        present[features[i]] = false;
+        for (int output_idx = 0; output_idx < forest.num_outputs;
+             output_idx++) {
+          expected[features[i] * forest.num_outputs + output_idx] +=
+              weight * (value_with[output_idx] - value_without[output_idx]);
+        }
+      }
+    }
+    for (int col_idx = 0; col_idx < dataset.ncol(); col_idx++) {
+      for (int output_idx = 0; output_idx < forest.num_outputs; output_idx++) {
+        EXPECT_NEAR(shap_values.value(row, col_idx, output_idx),
+                    expected[col_idx * forest.num_outputs + output_idx], 1e-4)
+            << "row:" << row << " col:" << col_idx << " output:" << output_idx;
+      }
+    }
+
+    // Expected value.
+    const auto base_value = ForestValue(
+        forest, dataset, row, background,
+        std::vector<bool>(dataset.ncol(), false));
+    for (int output_idx = 0; output_idx < forest.num_outputs; output_idx++) {
+      EXPECT_NEAR(shap_values.expected_values[output_idx],
+                  base_value[output_idx], 1e-4);
+    }
+  }
+}
+
+TEST(TreeShap, PathDependentSameAsBruteForce) {
+  std::unique_ptr<AbstractModel> model;
+  dataset::VerticalDataset full_dataset;
+  ASSERT_OK(utils::LoadTestModelAndDataset("iris_multi_class_gbdt", "iris.csv",
+                                           &model, &full_dataset));
+  const auto dataset = ExtractRows(full_dataset, {0, 10, 60, 75, 110, 149});
+  const auto forest = MultiClassGbtForest(*model);
+
+  ShapValues shap_values;
+  ASSERT_OK(ComputeShapValues(forest, dataset, {}, &shap_values));
+  EXPECT_EQ(shap_values.num_examples, dataset.nrow());
+  EXPECT_EQ(shap_values.num_columns, dataset.ncol());
+  EXPECT_EQ(shap_values.num_outputs, 3);
+  ExpectSameAsBruteForce(forest, model->input_features(), dataset,
+                         /*background=*/nullptr, shap_values);
+}
+
+TEST(TreeShap, InterventionalSameAsBruteForce) {
+  std::unique_ptr<AbstractModel> model;
+  dataset::VerticalDataset full_dataset;
+  ASSERT_OK(utils::LoadTestModelAndDataset("iris_multi_class_gbdt", "iris.csv",
+                                           &model, &full_dataset));
+  const auto dataset = ExtractRows(full_dataset, {0, 10, 60, 75, 110, 149});
+  const auto background = ExtractRows(full_dataset, {5, 55, 105, 140});
+  const auto forest = MultiClassGbtForest(*model);
+
+  ShapOptions options;
+  options.background = &background;
+  ShapValues shap_values;
+  ASSERT_OK(ComputeShapValues(forest, dataset, options, &shap_values));
+  ExpectSameAsBruteForce(forest, model->input_features(), dataset,
+                         &background, shap_values);
+}
+
+TEST(TreeShap, NumThreads) {
+  std::unique_ptr<AbstractModel> model;
+  dataset::VerticalDataset full_dataset;
+  ASSERT_OK(utils::LoadTestModelAndDataset(
+      "adult_binary_class_gbdt", "adult_test.csv", &model, &full_dataset));
+  std::vector<int> rows(500);
+  std::iota(rows.begin(), rows.end(), 0);
+  const auto dataset = ExtractRows(full_dataset, rows);
+  const auto background = ExtractRows(full_dataset, {1000, 1001, 1002});
+  for (const auto* background_ptr :
+       {static_cast<const dataset::VerticalDataset*>(nullptr), &background}) {
+    ShapValues expected;
+    ShapOptions options;
+    options.num_threads = 1;
+    options.background = background_ptr;
+    ASSERT_OK(model->ComputeShapValues(dataset, options, &expected));
+    ShapValues shap_values;
+    options.num_threads = 7;
+    ASSERT_OK(model->ComputeShapValues(dataset, options, &shap_values));
+    EXPECT_EQ(shap_values.values, expected.values);
+    EXPECT_EQ(shap_values.expected_values, expected.expected_values);
+  }
+}
+
+// The SHAP values and the expected value sum to the raw model output.
+TEST(TreeShap, Additivity) {
+  for (const auto& model_and_dataset :
+       std::vector<std::pair<std::string, std::string>>{
+           {"adult_binary_class_gbdt", "adult_test.csv"},
+           {"iris_multi_class_rf", "iris.csv"},
+           {"iris_multi_class_gbdt", "iris.csv"},
+           {"abalone_regression_gbdt", "abalone.csv"}}) {
+    SCOPED_TRACE(model_and_dataset.first);
+    std::unique_ptr<AbstractModel> model;
+    dataset::VerticalDataset full_dataset;
+    ASSERT_OK(utils::LoadTestModelAndDataset(
+        model_and_dataset.first, model_and_dataset.second, &model,
+        &full_dataset));
+    std::vector<int> rows;
+    for (int row = 0; row < full_dataset.nrow(); row += 7) {
+      rows.push_back(row);
+    }
+    const auto dataset = ExtractRows(full_dataset, rows);
+    const auto background = ExtractRows(full_dataset, {1, 2, 3, 4, 5});
+
+    for (const auto* background_ptr :
+         {static_cast<const dataset::VerticalDataset*>(nullptr), &background}) {
+      ShapOptions options;
+      options.background = background_ptr;
+      ShapValues shap_values;
+      ASSERT_OK(model->ComputeShapValues(dataset, options, &shap_values));
+
+      for (dataset::VerticalDataset::row_t row = 0; row < dataset.nrow();
+           row++) {
+        std::vector<double> outputs(shap_values.expected_values.begin(),
+                                    shap_values.expected_values.end());
+        for (int col_idx = 0; col_idx < shap_values.num_columns; col_idx++) {
+          for (int output_idx = 0; output_idx < shap_values.num_outputs;
+               output_idx++) {
+            outputs[output_idx] += shap_values.value(row, col_idx, output_idx);
+          }
+        }
+
+        model::proto::Prediction prediction;
+        model->Predict(dataset, row, &prediction);
+        std::vector<double> expected_outputs;
+        if (prediction.has_regression()) {
+          expected_outputs = {prediction.regression().value()};
+        } else if (model->name() == "RANDOM_FOREST") {
+          const auto& distribution = prediction.classification().distribution();
+          for (int class_idx = 1; class_idx < distribution.counts_size();
+               class_idx++) {
+            expected_outputs.push_back(distribution.counts(class_idx) /
+                                       distribution.sum());
+          }
+        } else if (shap_values.num_outputs == 1) {
+          // Binary classification: Logit of the positive class.
+          const double proba =
+              prediction.classification().distribution().counts(2);
+          expected_outputs = {std::log(proba / (1. - proba))};
+        } else {
+          // Multi-class classification: Softmax of the outputs.
+          double sum_exp = 0;
+          for (const double output : outputs) {
+            sum_exp += std::exp(output);
+          }
+          for (double& output : outputs) {
+            output = std::exp(output) / sum_exp;
+          }
+          const auto& distribution = prediction.classification().distribution();
+          for (int class_idx = 1; class_idx < distribution.counts_size();
+               class_idx++) {
+            expected_outputs.push_back(distribution.counts(class_idx));
+          }
+        }
+        ASSERT_EQ(outputs.size(), expected_outputs.size());
+        for (int output_idx = 0; output_idx < outputs.size(); output_idx++) {
+          EXPECT_NEAR(outputs[output_idx], expected_outputs[output_idx], 1e-3)
+              << "row:" << row << " output:" << output_idx;
+        }
+      }
+    }
+  }
+}
+
+TEST(TreeShap, InvalidBackground) {
+  std::unique_ptr<AbstractModel> model;
+  dataset::VerticalDataset dataset;
+  ASSERT_OK(utils::LoadTestModelAndDataset("iris_multi_class_gbdt", "iris.csv",
+                                           &model, &dataset));
+  const auto background = ExtractRows(dataset, {});
+  ShapOptions options;
+  options.background = &background;
+  ShapValues shap_values;
+  EXPECT_THAT(model->ComputeShapValues(dataset, options, &shap_values),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace decision_tree
+}  // namespace model
+}  // namespace yggdrasil_decision_forests
@@ -46,7 +46,9 @@
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree_io.h"
+#include "yggdrasil_decision_forests/model/decision_tree/proximity.h"
 #include "yggdrasil_decision_forests/model/decision_tree/structure_analysis.h"
+#include "yggdrasil_decision_forests/model/decision_tree/tree_shap.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.pb.h"
 #include "yggdrasil_decision_forests/model/prediction.pb.h"
 #include "yggdrasil_decision_forests/utils/compatibility.h"
@@ -88,11 +90,15 @@ absl::Status GradientBoostedTreesModel::Save(
   int num_shards;
   std::string node_base_filename =
       absl::StrCat(io_options.file_prefix.value(), kNodeBaseFilename);
+  std::vector<int> num_trees_per_shard;
   RETURN_IF_ERROR(decision_tree::SaveTreesToDisk(
-      directory, node_base_filename, decision_trees_, format, &num_shards));
+      directory, node_base_filename, decision_trees_, format, &num_shards,
+      &num_trees_per_shard));
   proto::Header header;
   header.set_node_format(format);
   header.set_num_node_shards(num_shards);
+  *header.mutable_num_trees_per_node_shard() = {num_trees_per_shard.begin(),
+                                                num_trees_per_shard.end()};
   header.set_num_trees(decision_trees_.size());
   header.set_loss(loss_);
   header.set_num_trees_per_iter(num_trees_per_iter_);
@@ -120,9 +126,17 @@ absl::Status GradientBoostedTreesModel::Load(absl::string_view directory,
       file::JoinPath(directory, header_filename), &header, file::Defaults()));
   std::string node_base_filename =
       absl::StrCat(io_options.file_prefix.value(), kNodeBaseFilename);
-  RETURN_IF_ERROR(decision_tree::LoadTreesFromDisk(
-      directory, node_base_filename, header.num_node_shards(),
-      header.num_trees(), header.node_format(), &decision_trees_));
+  if (header.num_trees_per_node_shard_size() == header.num_node_shards()) {
+    // Each tree is contained in a single shard.
+    RETURN_IF_ERROR(decision_tree::LoadTreesFromDisk(
+        directory, node_base_filename, header.num_trees_per_node_shard(),
+        header.node_format(), io_options.num_threads, &decision_trees_));
+    STATUS_CHECK_EQ(decision_trees_.size(), header.num_trees());
+  } else {
+    RETURN_IF_ERROR(decision_tree::LoadTreesFromDisk(
+        directory, node_base_filename, header.num_node_shards(),
+        header.num_trees(), header.node_format(), &decision_trees_));
+  }
   node_format_ = header.node_format();
   loss_ = header.loss();
   initial_predictions_.assign(header.initial_predictions().begin(),
@@ -234,20 +248,39 @@ absl::Status GradientBoostedTreesModel::PredictGetLeaves(
   return absl::OkStatus();
 }
 
-void GradientBoostedTreesModel::Predict(
-    const dataset::VerticalDataset& dataset,
-    dataset::VerticalDataset::row_t row_idx,
+template <typename LeafIterator>
+void GradientBoostedTreesModel::PredictWithLeafIterator(
+    const LeafIterator& call_on_all_leafs,
     model::proto::Prediction* prediction) const {
-  utils::usage::OnInference(1, metadata());
+  if (loss_ == proto::Loss::MULTINOMIAL_LOG_LIKELIHOOD) {
+    absl::FixedArray<float> accumulator(num_trees_per_iter_);
+    // Zero initial prediction for the MULTINOMIAL_LOG_LIKELIHOOD.
+    std::fill(accumulator.begin(), accumulator.end(), 0);
+
+    int accumulator_cell_idx = 0;
+    call_on_all_leafs([&accumulator, &accumulator_cell_idx,
+                       this](const decision_tree::proto::Node& node) {
+      accumulator[accumulator_cell_idx] += node.regressor().top_value();
+      accumulator_cell_idx++;
+      if (accumulator_cell_idx == num_trees_per_iter_) {
+        accumulator_cell_idx = 0;
+      }
+    });
+    FinalizeMultinomialPrediction(accumulator, prediction);
+  } else {
+    double accumulator = initial_predictions_[0];
+    call_on_all_leafs([&accumulator](const decision_tree::proto::Node& node) {
+      accumulator += node.regressor().top_value();
+    });
+    FinalizeSingleOutputPrediction(accumulator, prediction);
+  }
+}
+
+void GradientBoostedTreesModel::FinalizeSingleOutputPrediction(
+    const double accumulator, model::proto::Prediction* prediction) const {
   switch (loss_) {
     case proto::Loss::BINOMIAL_LOG_LIKELIHOOD:
     case proto::Loss::BINARY_FOCAL_LOSS: {
-      double accumulator = initial_predictions_[0];
-      CallOnAllLeafs(dataset, row_idx,
-                     [&accumulator](const decision_tree::proto::Node& node) {
-                       accumulator += node.regressor().top_value();
-                     });
-
       prediction->mutable_classification()->set_value(accumulator > 0.f ? 2
                                                                         : 1);
       auto* dist = prediction->mutable_classification()->mutable_distribution();
@@ -263,80 +296,8 @@ void GradientBoostedTreesModel::Predict(
       dist->set_counts(1, 1.f - proba_true);
       dist->set_counts(2, proba_true);
     } break;
-    case proto::Loss::MULTINOMIAL_LOG_LIKELIHOOD: {
-      absl::FixedArray<float> accumulator(num_trees_per_iter_);
-      // Zero initial prediction for the MULTINOMIAL_LOG_LIKELIHOOD.
-      std::fill(accumulator.begin(), accumulator.end(), 0);
-
-      {
-        int accumulator_cell_idx = 0;
-        CallOnAllLeafs(dataset, row_idx,
-                       [&accumulator, &accumulator_cell_idx,
-                        this](const decision_tree::proto::Node& node) {
-                         accumulator[accumulator_cell_idx] +=
-                             node.regressor().top_value();
-                         accumulator_cell_idx++;
-                         if (accumulator_cell_idx == num_trees_per_iter_) {
-                           accumulator_cell_idx = 0;
-                         }
-                       });
-      }
-
-      auto* dist = prediction->mutable_classification()->mutable_distribution();
-      dist->mutable_counts()->Resize(num_trees_per_iter_ + 1, 0.f);
-
-      // Top class.
-      if (output_logits_) {
-        float sum_logit = 0;
-        int highest_cell_idx = 0;
-        float highest_cell_value = 0;
-        for (int accumulator_idx = 0; accumulator_idx < num_trees_per_iter_;
-             accumulator_idx++) {
-          auto value = accumulator[accumulator_idx];
-          sum_logit += value;
-          dist->set_counts(accumulator_idx + 1, value);
-          if (value > highest_cell_value) {
-            highest_cell_value = value;
-            highest_cell_idx = accumulator_idx;
-          }
-        }
-        prediction->mutable_classification()->set_value(highest_cell_idx + 1);
-        dist->set_sum(sum_logit);
-      } else {
-        // Sum logits.
-        float sum_exp = 0;
-        for (int accumulator_idx = 0; accumulator_idx < num_trees_per_iter_;
-             accumulator_idx++) {
-          const float exp_val = std::exp(accumulator[accumulator_idx]);
-          sum_exp += exp_val;
-          // The offset of 1 between the class idx and the accumulator_idx is to
-          // skill the special OOD value with index 0.
-          dist->set_counts(accumulator_idx + 1, exp_val);
-        }
-        // Softmax
-        int highest_cell_idx = 0;
-        float highest_cell_value = 0;
-        const float normalization = (sum_exp > 0) ? (1.f / sum_exp) : 0.f;
-        for (int accumulator_idx = 0; accumulator_idx < num_trees_per_iter_;
-             accumulator_idx++) {
-          const float value = dist->counts(accumulator_idx + 1);
-          dist->set_counts(accumulator_idx + 1, value * normalization);
-          if (value > highest_cell_value) {
-            highest_cell_value = value;
-            highest_cell_idx = accumulator_idx;
-          }
-        }
-        prediction->mutable_classification()->set_value(highest_cell_idx + 1);
-        dist->set_sum(1.f);
-      }
-    } break;
     case proto::Loss::MEAN_AVERAGE_ERROR:
     case proto::Loss::SQUARED_ERROR: {
-      double accumulator = initial_predictions_[0];
-      CallOnAllLeafs(dataset, row_idx,
-                     [&accumulator](const decision_tree::proto::Node& node) {
-                       accumulator += node.regressor().top_value();
-                     });
       if (task() == model::proto::RANKING) {
         prediction->mutable_ranking()->set_relevance(accumulator);
       } else if (task() == model::proto::REGRESSION) {
@@ -346,11 +307,6 @@ void GradientBoostedTreesModel::Predict(
       }
     } break;
     case proto::Loss::POISSON: {
-      double accumulator = initial_predictions_[0];
-      CallOnAllLeafs(dataset, row_idx,
-                     [&accumulator](const decision_tree::proto::Node& node) {
-                       accumulator += node.regressor().top_value();
-                     });
       if (task() == model::proto::REGRESSION) {
         double clamped_accumulator = utils::clamp(accumulator, -19., 19.);
         prediction->mutable_regression()->set_value(
@@ -361,11 +317,6 @@ void GradientBoostedTreesModel::Predict(
     } break;
     case proto::Loss::LAMBDA_MART_NDCG5:
     case proto::Loss::XE_NDCG_MART: {
-      double accumulator = initial_predictions_[0];
-      CallOnAllLeafs(dataset, row_idx,
-                     [&accumulator](const decision_tree::proto::Node& node) {
-                       accumulator += node.regressor().top_value();
-                     });
       prediction->mutable_ranking()->set_relevance(accumulator);
     } break;
     default:
@@ -373,6 +324,115 @@ void GradientBoostedTreesModel::Predict(
   }
 }
 
+void GradientBoostedTreesModel::FinalizeMultinomialPrediction(
+    const absl::Span<const float> accumulator,
+    model::proto::Prediction* prediction) const {
+  auto* dist = prediction->mutable_classification()->mutable_distribution();
+  dist->mutable_counts()->Resize(num_trees_per_iter_ + 1, 0.f);
+
+  // Top class.
+  if (output_logits_) {
+    float sum_logit = 0;
+    int highest_cell_idx = 0;
+    float highest_cell_value = 0;
+    for (int accumulator_idx = 0; accumulator_idx < num_trees_per_iter_;
+         accumulator_idx++) {
+      auto value = accumulator[accumulator_idx];
+      sum_logit += value;
+      dist->set_counts(accumulator_idx + 1, value);
+      if (value > highest_cell_value) {
+        highest_cell_value = value;
+        highest_cell_idx = accumulator_idx;
+      }
+    }
+    prediction->mutable_classification()->set_value(highest_cell_idx + 1);
+    dist->set_sum(sum_logit);
+  } else {
+    // Sum logits.
+    float sum_exp = 0;
+    for (int accumulator_idx = 0; accumulator_idx < num_trees_per_iter_;
+         accumulator_idx++) {
+      const float exp_val = std::exp(accumulator[accumulator_idx]);
+      sum_exp += exp_val;
+      // The offset of 1 between the class idx and the accumulator_idx is to
+      // skill the special OOD value with index 0.
+      dist->set_counts(accumulator_idx + 1, exp_val);
+    }
+    // Softmax
+    int highest_cell_idx = 0;
+    float highest_cell_value = 0;
+    const float normalization = (sum_exp > 0) ? (1.f / sum_exp) : 0.f;
+    for (int accumulator_idx = 0; accumulator_idx < num_trees_per_iter_;
+         accumulator_idx++) {
+      const float value = dist->counts(accumulator_idx + 1);
+      dist->set_counts(accumulator_idx + 1, value * normalization);
+      if (value > highest_cell_value) {
+        highest_cell_value = value;
+        highest_cell_idx = accumulator_idx;
+      }
+    }
+    prediction->mutable_classification()->set_value(highest_cell_idx + 1);
+    dist->set_sum(1.f);
+  }
+}
+
+void GradientBoostedTreesModel::Predict(
+    const dataset::VerticalDataset& dataset,
+    dataset::VerticalDataset::row_t row_idx,
+    model::proto::Prediction* prediction) const {
+  utils::usage::OnInference(1, metadata());
+  PredictWithLeafIterator(
+      [&](const std::function<void(const decision_tree::proto::Node& node)>&
+              callback) { CallOnAllLeafs(dataset, row_idx, callback); },
+      prediction);
+}
+
+absl::Status GradientBoostedTreesModel::PredictFromLeaves(
+    absl::Span<const decision_tree::proto::Node* const> leaves,
+    model::proto::Prediction* prediction) const {
+  if (leaves.size() != num_trees()) {
+    return absl::InvalidArgumentError("Wrong number of trees");
+  }
+  PredictWithLeafIterator(
+      [&](const std::function<void(const decision_tree::proto::Node& node)>&
+              callback) {
+        for (const auto* leaf : leaves) {
+          callback(*leaf);
+        }
+      },
+      prediction);
+  return absl::OkStatus();
+}
+
+int GradientBoostedTreesModel::LeafAccumulatorSize() const {
+  return loss_ == proto::Loss::MULTINOMIAL_LOG_LIKELIHOOD ? num_trees_per_iter_
+                                                         : 1;
+}
+
+void GradientBoostedTreesModel::AddLeafToAccumulator(
+    const int tree_idx, const decision_tree::proto::Node& leaf,
+    const double weight, absl::Span<double> accumulator) const {
+  accumulator[tree_idx % num_trees_per_iter_] +=
+      weight * leaf.regressor().top_value();
+}
+
+absl::Status GradientBoostedTreesModel::PredictFromAccumulator(
+    const absl::Span<const double> accumulator,
+    model::proto::Prediction* prediction) const {
+  if (accumulator.size() != LeafAccumulatorSize()) {
+    return absl::InvalidArgumentError("Wrong accumulator size");
+  }
+  if (loss_ == proto::Loss::MULTINOMIAL_LOG_LIKELIHOOD) {
+    const absl::FixedArray<float> float_accumulator(accumulator.begin(),
+                                                    accumulator.end());
+    FinalizeMultinomialPrediction(float_accumulator, prediction);
+  } else {
+    FinalizeSingleOutputPrediction(initial_predictions_[0] + accumulator[0],
+                                   prediction);
+  }
+  return absl::OkStatus();
+}
+
 void GradientBoostedTreesModel::Predict(
     const dataset::proto::Example& example,
     model::proto::Prediction* prediction) const {
@@ -705,6 +765,55 @@ absl::Status GradientBoostedTreesModel::MakePureServing() {
   return AbstractModel::MakePureServing();
 }
 
+absl::Status GradientBoostedTreesModel::ComputeShapValues(
+    const dataset::VerticalDataset& dataset, const ShapOptions& options,
+    ShapValues* shap_values) const {
+  decision_tree::ShapForestDefinition forest;
+  forest.trees = absl::MakeConstSpan(decision_trees_);
+  switch (loss_) {
+    case proto::Loss::MULTINOMIAL_LOG_LIKELIHOOD:
+      // The trees of an iteration contribute to the successive classes. The
+      // initial prediction is zero.
+      forest.num_outputs = num_trees_per_iter_;
+      forest.leaf_values = [&](const int tree_idx,
+                               const decision_tree::proto::Node& leaf,
+                               absl::Span<float> values) {
+        values[tree_idx % num_trees_per_iter_] = leaf.regressor().top_value();
+      };
+      break;
+    case proto::Loss::BINOMIAL_LOG_LIKELIHOOD:
+    case proto::Loss::BINARY_FOCAL_LOSS:
+    case proto::Loss::MEAN_AVERAGE_ERROR:
+    case proto::Loss::SQUARED_ERROR:
+    case proto::Loss::POISSON:
+    case proto::Loss::LAMBDA_MART_NDCG5:
+    case proto::Loss::XE_NDCG_MART:
+      forest.bias = {initial_predictions_[0]};
+      forest.leaf_values = [](const int tree_idx,
+                              const decision_tree::proto::Node& leaf,
+                              absl::Span<float> values) {
+        values[0] = leaf.regressor().top_value();
+      };
+      break;
+    default:
+      return absl::InvalidArgumentError(absl::StrCat(
+          "SHAP values not supported for loss ", proto::Loss_Name(loss_)));
+  }
+  return decision_tree::ComputeShapValues(forest, dataset, options,
+                                          shap_values);
+}
+
+absl::Status GradientBoostedTreesModel::NearestNeighbors(
+    const dataset::VerticalDataset& dataset1,
+    const dataset::VerticalDataset& dataset2,
+    const decision_tree::NearestNeighborsOptions& options,
+    std::vector<std::vector<decision_tree::Neighbor>>* neighbors) const {
+  ASSIGN_OR_RETURN(*neighbors,
+                   decision_tree::NearestNeighbors(decision_trees(), dataset1,
+                                                   dataset2, options));
+  return absl::OkStatus();
+}
+
 REGISTER_AbstractModel(GradientBoostedTreesModel,
                        GradientBoostedTreesModel::kRegisteredName);
 
@@ -31,6 +31,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "yggdrasil_decision_forests/dataset/example.pb.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/metric/metric.pb.h"
@@ -39,6 +40,7 @@
 #include "yggdrasil_decision_forests/model/decision_tree/decision_forest_interface.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/proximity.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.pb.h"
 #include "yggdrasil_decision_forests/model/prediction.pb.h"
 
@@ -68,6 +70,21 @@ class GradientBoostedTreesModel : public AbstractModel,
                                 dataset::VerticalDataset::row_t row_idx,
                                 absl::Span<int32_t> leaves) const override;
 
+  absl::Status PredictFromLeaves(
+      absl::Span<const decision_tree::proto::Node* const> leaves,
+      model::proto::Prediction* prediction) const override;
+
+  int LeafAccumulatorSize() const override;
+
+  void AddLeafToAccumulator(int tree_idx,
+                            const decision_tree::proto::Node& leaf,
+                            double weight,
+                            absl::Span<double> accumulator) const override;
+
+  absl::Status PredictFromAccumulator(
+      absl::Span<const double> accumulator,
+      model::proto::Prediction* prediction) const override;
+
   void Predict(const dataset::VerticalDataset& dataset,
                dataset::VerticalDataset::row_t row_idx,
                model::proto::Prediction* prediction) const override;
@@ -91,10 +108,10 @@ class GradientBoostedTreesModel : public AbstractModel,
   // Number of times each feature is used in the model. Returns a map, indexed
   // by feature index, and counting the number of time a feature is used.
   void CountFeatureUsage(
-      std::unordered_map<int32_t, int64_t>* feature_usage) const;
+      std::unordered_map<int32_t, int64_t>* feature_usage) const override;
 
   const std::vector<std::unique_ptr<decision_tree::DecisionTree>>&
-  decision_trees() const {
+  decision_trees() const override {
     return decision_trees_;
   }
 
@@ -159,6 +176,22 @@ class GradientBoostedTreesModel : public AbstractModel,
 
   absl::Status MakePureServing() override;
 
+  // SHAP values of the raw predictions i.e. before the activation function
+  // (logits for classification, log space for the Poisson loss). Multi-class
+  // classification models have one output per class.
+  absl::Status ComputeShapValues(const dataset::VerticalDataset& dataset,
+                                 const ShapOptions& options,
+                                 ShapValues* shap_values) const override;
+
+  // Neighbors according to the ratio of trees in which the examples reach the
+  // same leaf (i.e. the same definition as the Random Forest proximity).
+  absl::Status NearestNeighbors(
+      const dataset::VerticalDataset& dataset1,
+      const dataset::VerticalDataset& dataset2,
+      const decision_tree::NearestNeighborsOptions& options,
+      std::vector<std::vector<decision_tree::Neighbor>>* neighbors)
+      const override;
+
   // Fields related to unit testing.
   struct Testing {
     // If true, the "CheckStructure" method will fail if
@@ -167,6 +200,18 @@ class GradientBoostedTreesModel : public AbstractModel,
   };
   Testing* Testing() { return &testing_; }
 
+  // Computes the prediction of a model with a single output dimension (i.e.
+  // all the losses except MULTINOMIAL_LOG_LIKELIHOOD) from the sum of the
+  // initial prediction and of the leaf values.
+  void FinalizeSingleOutputPrediction(
+      double accumulator, model::proto::Prediction* prediction) const;
+
+  // Computes the prediction of a MULTINOMIAL_LOG_LIKELIHOOD model from the sum
+  // of the initial prediction and of the leaf values of each class.
+  void FinalizeMultinomialPrediction(
+      absl::Span<const float> accumulator,
+      model::proto::Prediction* prediction) const;
+
  private:
   void PredictClassification(const dataset::VerticalDataset& dataset,
                              dataset::VerticalDataset::row_t row_idx,
@@ -186,6 +231,12 @@ class GradientBoostedTreesModel : public AbstractModel,
   // compiled version of the model can be much smaller.
   absl::optional<size_t> ModelSizeInBytes() const override;
 
+  // Computes the prediction from the leaves of the trees, in order.
+  // "call_on_all_leafs(callback)" calls "callback" on each of the leaves.
+  template <typename LeafIterator>
+  void PredictWithLeafIterator(const LeafIterator& call_on_all_leafs,
+                               model::proto::Prediction* prediction) const;
+
   // Call the function "callback" on all the leafs in which the example (defined
   // by a dataset and a row index) is falling.
   void CallOnAllLeafs(
@@ -42,7 +42,9 @@
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree_io.h"
+#include "yggdrasil_decision_forests/model/decision_tree/proximity.h"
 #include "yggdrasil_decision_forests/model/decision_tree/structure_analysis.h"
+#include "yggdrasil_decision_forests/model/decision_tree/tree_shap.h"
 #include "yggdrasil_decision_forests/model/prediction.pb.h"
 #include "yggdrasil_decision_forests/model/random_forest/random_forest.pb.h"
 #include "yggdrasil_decision_forests/utils/distribution.h"
@@ -84,11 +86,15 @@ absl::Status RandomForestModel::Save(absl::string_view directory,
   int num_shards;
   const auto node_base_filename =
       absl::StrCat(io_options.file_prefix.value(), kNodeBaseFilename);
+  std::vector<int> num_trees_per_shard;
   RETURN_IF_ERROR(decision_tree::SaveTreesToDisk(
-      directory, node_base_filename, decision_trees_, format, &num_shards));
+      directory, node_base_filename, decision_trees_, format, &num_shards,
+      &num_trees_per_shard));
   proto::Header header;
   header.set_node_format(format);
   header.set_num_node_shards(num_shards);
+  *header.mutable_num_trees_per_node_shard() = {num_trees_per_shard.begin(),
+                                                num_trees_per_shard.end()};
   header.set_num_trees(decision_trees_.size());
   header.set_winner_take_all_inference(winner_take_all_inference_);
 
@@ -122,9 +128,17 @@ absl::Status RandomForestModel::Load(absl::string_view directory,
       file::JoinPath(directory, header_filename), &header, file::Defaults()));
   const auto node_base_filename =
       absl::StrCat(io_options.file_prefix.value(), kNodeBaseFilename);
-  RETURN_IF_ERROR(decision_tree::LoadTreesFromDisk(
-      directory, node_base_filename, header.num_node_shards(),
-      header.num_trees(), header.node_format(), &decision_trees_));
+  if (header.num_trees_per_node_shard_size() == header.num_node_shards()) {
+    // Each tree is contained in a single shard.
+    RETURN_IF_ERROR(decision_tree::LoadTreesFromDisk(
+        directory, node_base_filename, header.num_trees_per_node_shard(),
+        header.node_format(), io_options.num_threads, &decision_trees_));
+    STATUS_CHECK_EQ(decision_trees_.size(), header.num_trees());
+  } else {
+    RETURN_IF_ERROR(decision_tree::LoadTreesFromDisk(
+        directory, node_base_filename, header.num_node_shards(),
+        header.num_trees(), header.node_format(), &decision_trees_));
+  }
 
   node_format_ = header.node_format();
   winner_take_all_inference_ = header.winner_take_all_inference();
@@ -299,6 +313,152 @@ absl::Status RandomForestModel::PredictGetLeaves(
   return absl::OkStatus();
 }
 
+absl::Status RandomForestModel::PredictFromLeaves(
+    absl::Span<const decision_tree::proto::Node* const> leaves,
+    model::proto::Prediction* prediction) const {
+  if (leaves.size() != num_trees()) {
+    return absl::InvalidArgumentError("Wrong number of trees");
+  }
+  switch (task_) {
+    case model::proto::Task::CLASSIFICATION: {
+      utils::IntegerDistribution<float> accumulator(
+          data_spec_.columns(label_col_idx_)
+              .categorical()
+              .number_of_unique_values());
+      for (const auto* leaf : leaves) {
+        internal::AddClassificationLeafToAccumulator(winner_take_all_inference_,
+                                                     *leaf, &accumulator);
+      }
+      internal::FinalizeClassificationLeafToAccumulator(accumulator,
+                                                        prediction);
+    } break;
+    case model::proto::Task::REGRESSION: {
+      double accumulator = 0;
+      for (const auto* leaf : leaves) {
+        internal::AddRegressionLeafToAccumulator(*leaf, &accumulator);
+      }
+      accumulator /= NumTrees();
+      prediction->mutable_regression()->set_value(accumulator);
+    } break;
+    case model::proto::Task::CATEGORICAL_UPLIFT:
+    case model::proto::Task::NUMERICAL_UPLIFT: {
+      internal::UplifLeafAccumulator accumulator(
+          data_spec_.columns(uplift_treatment_col_idx_)
+                  .categorical()
+                  .number_of_unique_values() -
+              2,
+          0);
+      for (const auto* leaf : leaves) {
+        internal::AddUpliftLeafToAccumulator(*leaf, &accumulator);
+      }
+      for (auto& value : accumulator) {
+        value /= NumTrees();
+      }
+      *prediction->mutable_uplift()->mutable_treatment_effect() = {
+          accumulator.begin(), accumulator.end()};
+    } break;
+    default:
+      return absl::InvalidArgumentError("Non supported task.");
+  }
+  return absl::OkStatus();
+}
+
+int RandomForestModel::LeafAccumulatorSize() const {
+  switch (task_) {
+    case model::proto::Task::CLASSIFICATION:
+      // The class counts, followed by the sum of the counts.
+      return data_spec_.columns(label_col_idx_)
+                 .categorical()
+                 .number_of_unique_values() +
+             1;
+    case model::proto::Task::REGRESSION:
+      return 1;
+    case model::proto::Task::CATEGORICAL_UPLIFT:
+    case model::proto::Task::NUMERICAL_UPLIFT:
+      return data_spec_.columns(uplift_treatment_col_idx_)
+                 .categorical()
+                 .number_of_unique_values() -
+             2;
+    default:
+      return 0;
+  }
+}
+
+void RandomForestModel::AddLeafToAccumulator(
+    const int tree_idx, const decision_tree::proto::Node& leaf,
+    const double weight, absl::Span<double> accumulator) const {
+  switch (task_) {
+    case model::proto::Task::CLASSIFICATION: {
+      // Same as "internal::AddClassificationLeafToAccumulator".
+      const int num_classes = accumulator.size() - 1;
+      if (winner_take_all_inference_) {
+        accumulator[leaf.classifier().top_value()] += weight;
+      } else {
+        const auto& distribution = leaf.classifier().distribution();
+        if (distribution.sum() == 0) {
+          return;
+        }
+        DCHECK_EQ(distribution.counts_size(), num_classes);
+        for (int class_idx = 0; class_idx < num_classes; class_idx++) {
+          accumulator[class_idx] +=
+              weight * (distribution.counts(class_idx) / distribution.sum());
+        }
+      }
+      accumulator[num_classes] += weight;
+    } break;
+    case model::proto::Task::REGRESSION:
+      accumulator[0] += weight * leaf.regressor().top_value();
+      break;
+    case model::proto::Task::CATEGORICAL_UPLIFT:
+    case model::proto::Task::NUMERICAL_UPLIFT:
+      DCHECK_EQ(accumulator.size(), leaf.uplift().treatment_effect_size());
+      for (int effect_idx = 0; effect_idx < accumulator.size(); effect_idx++) {
+        accumulator[effect_idx] +=
+            weight * leaf.uplift().treatment_effect(effect_idx);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+absl::Status RandomForestModel::PredictFromAccumulator(
+    const absl::Span<const double> accumulator,
+    model::proto::Prediction* prediction) const {
+  if (accumulator.empty() || accumulator.size() != LeafAccumulatorSize()) {
+    return absl::InvalidArgumentError("Wrong accumulator size");
+  }
+  switch (task_) {
+    case model::proto::Task::CLASSIFICATION: {
+      const int num_classes = accumulator.size() - 1;
+      auto* distribution =
+          prediction->mutable_classification()->mutable_distribution();
+      distribution->set_sum(accumulator[num_classes]);
+      distribution->mutable_counts()->Resize(num_classes, 0.f);
+      for (int class_idx = 0; class_idx < num_classes; class_idx++) {
+        distribution->set_counts(class_idx, accumulator[class_idx]);
+      }
+      prediction->mutable_classification()->set_value(
+          utils::TopClass(*distribution));
+    } break;
+    case model::proto::Task::REGRESSION:
+      prediction->mutable_regression()->set_value(accumulator[0] / NumTrees());
+      break;
+    case model::proto::Task::CATEGORICAL_UPLIFT:
+    case model::proto::Task::NUMERICAL_UPLIFT: {
+      auto* treatment_effect =
+          prediction->mutable_uplift()->mutable_treatment_effect();
+      treatment_effect->Clear();
+      for (const double value : accumulator) {
+        treatment_effect->Add(value / NumTrees());
+      }
+    } break;
+    default:
+      return absl::InvalidArgumentError("Non supported task.");
+  }
+  return absl::OkStatus();
+}
+
 void RandomForestModel::Predict(const dataset::VerticalDataset& dataset,
                                 dataset::VerticalDataset::row_t row_idx,
                                 model::proto::Prediction* prediction) const {
@@ -667,6 +827,78 @@ absl::Status RandomForestModel::Proximity(
                                  proximities);
 }
 
+absl::Status RandomForestModel::NearestNeighbors(
+    const dataset::VerticalDataset& dataset1,
+    const dataset::VerticalDataset& dataset2,
+    const decision_tree::NearestNeighborsOptions& options,
+    std::vector<std::vector<decision_tree::Neighbor>>* neighbors) const {
+  ASSIGN_OR_RETURN(*neighbors,
+                   decision_tree::NearestNeighbors(decision_trees(), dataset1,
+                                                   dataset2, options));
+  return absl::OkStatus();
+}
+
+absl::Status RandomForestModel::ComputeShapValues(
+    const dataset::VerticalDataset& dataset, const ShapOptions& options,
+    ShapValues* shap_values) const {
+  decision_tree::ShapForestDefinition forest;
+  forest.trees = absl::MakeConstSpan(decision_trees_);
+  const float tree_weight = 1.f / NumTrees();
+  switch (task_) {
+    case model::proto::Task::CLASSIFICATION:
+      forest.num_outputs = data_spec_.columns(label_col_idx_)
+                               .categorical()
+                               .number_of_unique_values() -
+                           1;
+      forest.leaf_values = [&](const int tree_idx,
+                               const decision_tree::proto::Node& leaf,
+                               absl::Span<float> values) {
+        if (winner_take_all_inference_) {
+          const int top_value = leaf.classifier().top_value();
+          if (top_value > 0) {
+            values[top_value - 1] = tree_weight;
+          }
+          return;
+        }
+        const auto& distribution = leaf.classifier().distribution();
+        if (distribution.sum() == 0) {
+          return;
+        }
+        for (int output_idx = 0; output_idx < values.size(); output_idx++) {
+          values[output_idx] = distribution.counts(output_idx + 1) /
+                               distribution.sum() * tree_weight;
+        }
+      };
+      break;
+    case model::proto::Task::REGRESSION:
+      forest.leaf_values = [&](const int tree_idx,
+                               const decision_tree::proto::Node& leaf,
+                               absl::Span<float> values) {
+        values[0] = leaf.regressor().top_value() * tree_weight;
+      };
+      break;
+    case model::proto::Task::CATEGORICAL_UPLIFT:
+    case model::proto::Task::NUMERICAL_UPLIFT:
+      forest.num_outputs = data_spec_.columns(uplift_treatment_col_idx_)
+                               .categorical()
+                               .number_of_unique_values() -
+                           2;
+      forest.leaf_values = [&](const int tree_idx,
+                               const decision_tree::proto::Node& leaf,
+                               absl::Span<float> values) {
+        for (int output_idx = 0; output_idx < values.size(); output_idx++) {
+          values[output_idx] =
+              leaf.uplift().treatment_effect(output_idx) * tree_weight;
+        }
+      };
+      break;
+    default:
+      return absl::InvalidArgumentError("Non supported task.");
+  }
+  return decision_tree::ComputeShapValues(forest, dataset, options,
+                                          shap_values);
+}
+
 namespace internal {
 std::string EvaluationSnippet(
     const metric::proto::EvaluationResults& evaluation) {
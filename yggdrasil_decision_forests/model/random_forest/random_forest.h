@@ -38,6 +38,7 @@
 #include "yggdrasil_decision_forests/model/decision_tree/decision_forest_interface.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/proximity.h"
 #include "yggdrasil_decision_forests/model/prediction.pb.h"
 #include "yggdrasil_decision_forests/model/random_forest/random_forest.pb.h"
 #include "yggdrasil_decision_forests/utils/distribution.h"
@@ -107,6 +108,21 @@ class RandomForestModel : public AbstractModel, public DecisionForestInterface {
                                 dataset::VerticalDataset::row_t row_idx,
                                 absl::Span<int32_t> leaves) const override;
 
+  absl::Status PredictFromLeaves(
+      absl::Span<const decision_tree::proto::Node* const> leaves,
+      model::proto::Prediction* prediction) const override;
+
+  int LeafAccumulatorSize() const override;
+
+  void AddLeafToAccumulator(int tree_idx,
+                            const decision_tree::proto::Node& leaf,
+                            double weight,
+                            absl::Span<double> accumulator) const override;
+
+  absl::Status PredictFromAccumulator(
+      absl::Span<const double> accumulator,
+      model::proto::Prediction* prediction) const override;
+
   // Add a new tree to the model.
   void AddTree(std::unique_ptr<decision_tree::DecisionTree> decision_tree);
 
@@ -128,10 +144,10 @@ class RandomForestModel : public AbstractModel, public DecisionForestInterface {
   // Number of times each feature is used in the model. Returns a map, indexed
   // by feature index, and counting the number of time a feature is used.
   void CountFeatureUsage(
-      std::unordered_map<int32_t, int64_t>* feature_usage) const;
+      std::unordered_map<int32_t, int64_t>* feature_usage) const override;
 
   const std::vector<std::unique_ptr<decision_tree::DecisionTree>>&
-  decision_trees() const {
+  decision_trees() const override {
     return decision_trees_;
   }
 
@@ -226,6 +242,21 @@ class RandomForestModel : public AbstractModel, public DecisionForestInterface {
     return Proximity(dataset1, dataset2, distances);
   }
 
+  absl::Status NearestNeighbors(
+      const dataset::VerticalDataset& dataset1,
+      const dataset::VerticalDataset& dataset2,
+      const decision_tree::NearestNeighborsOptions& options,
+      std::vector<std::vector<decision_tree::Neighbor>>* neighbors)
+      const override;
+
+  // SHAP values of the predictions. The outputs are the probabilities of the
+  // classes (excluding the out-of-vocabulary class 0, i.e. output "i" is the
+  // class "i+1") for classification, the predicted value for regression, and
+  // the treatment effects for uplift.
+  absl::Status ComputeShapValues(const dataset::VerticalDataset& dataset,
+                                 const ShapOptions& options,
+                                 ShapValues* shap_values) const override;
+
   // Fields related to unit testing.
   struct Testing {
     // If true, the "CheckStructure" method will fail if
@@ -1,4 +1,4 @@
-from typing import Optional, TypeVar, List
+from typing import Optional, TypeVar, List, Tuple
 
 # pylint: disable=g-wrong-blank-lines
 
@@ -104,12 +104,27 @@ class DecisionForestCCModel(GenericCCModel):
   def PredictLeaves(
       self,
       dataset: VerticalDataset,
+      num_threads: int,
   ) -> npt.NDArray[np.int32]: ...
   def Distance(
       self,
       dataset1: VerticalDataset,
       dataset2: VerticalDataset,
   ) -> npt.NDArray[np.float32]: ...
+  def NearestNeighbors(
+      self,
+      dataset1: VerticalDataset,
+      dataset2: VerticalDataset,
+      top_k: int,
+      max_distance: float,
+      num_threads: int,
+  ) -> Tuple[npt.NDArray[np.int64], npt.NDArray[np.float32]]: ...
+  def PredictShap(
+      self,
+      dataset: VerticalDataset,
+      background: Optional[VerticalDataset],
+      num_threads: int,
+  ) -> Tuple[npt.NDArray[np.float32], npt.NDArray[np.float32]]: ...
 
 class RandomForestCCModel(DecisionForestCCModel):
   @property
@@ -14,7 +14,7 @@
 
 """Definitions for generic decision forest models."""
 
-from typing import Optional
+from typing import Optional, Tuple
 
 import numpy as np
 
@@ -32,7 +32,9 @@ class DecisionForestModel(generic_model.GenericModel):
     """Returns the number of trees in the decision forest."""
     return self._model.num_trees()
 
-  def predict_leaves(self, data: dataset.InputDataset) -> np.ndarray:
+  def predict_leaves(
+      self, data: dataset.InputDataset, num_threads: int = 6
+  ) -> np.ndarray:
     """Gets the index of the active leaf in each tree.
 
     The active leaf is the leave that that receive the example during inference.
@@ -41,8 +43,13 @@ class DecisionForestModel(generic_model.GenericModel):
     i-th example and the j-th tree. Leaves are indexed by depth first
     exploration with the negative child visited before the positive one.
 
+    The leaves are computed in parallel with a flat (i.e. compiled) version of
+    the model, and written directly in the returned array. This makes it
+    possible to extract leaf embeddings on large datasets.
+
     Args:
       data: Dataset.
+      num_threads: Number of threads used to compute the leaves.
 
     Returns:
       Index of the active leaf for each tree in the model.
@@ -51,7 +58,7 @@ class DecisionForestModel(generic_model.GenericModel):
     ds = dataset.create_vertical_dataset(
         data, data_spec=self._model.data_spec()
     )
-    return self._model.PredictLeaves(ds._dataset)  # pylint: disable=protected-access
+    return self._model.PredictLeaves(ds._dataset, num_threads=num_threads)  # pylint: disable=protected-access
 
   def distance(
       self,
@@ -109,3 +116,119 @@ class DecisionForestModel(generic_model.GenericModel):
           data2, data_spec=self._model.data_spec()
       )
     return self._model.Distance(ds1._dataset, ds2._dataset)  # pylint: disable=protected-access
+
+  def nearest_neighbors(
+      self,
+      data1: dataset.InputDataset,
+      data2: Optional[dataset.InputDataset] = None,
+      top_k: int = 10,
+      max_distance: float = 1.0,
+      num_threads: int = 6,
+  ) -> Tuple[np.ndarray, np.ndarray]:
+    """Finds the closest examples in "data2" of each example in "data1".
+
+    The distance between two examples is one minus the ratio of trees in which
+    both examples reach the same leaf. For Random Forest models, this is the
+    distance returned by `distance`. The dense pairwise distance matrix is not
+    computed: Only the pairs of examples that share at least one leaf are
+    compared. This makes it possible to use large datasets.
+
+    If "data2" is not provided, the neighbors are searched in "data1".
+
+    Usage example:
+
+    ```python
+    indices, distances = model.nearest_neighbors(test_ds, train_ds, top_k=5)
+    # "indices[i,k]" is the index of the k-th closest train example to the i-th
+    # test example, and "distances[i,k]" is its distance.
+    ```
+
+    Args:
+      data1: Dataset. Can be a dictionary of list or numpy array of values,
+        Pandas DataFrame, or a VerticalDataset.
+      data2: Dataset. Can be a dictionary of list or numpy array of values,
+        Pandas DataFrame, or a VerticalDataset.
+      top_k: Maximum number of neighbors returned for each example.
+      max_distance: Only the neighbors with a distance lower or equal to
+        "max_distance" are returned.
+      num_threads: Number of threads used for the computation.
+
+    Returns:
+      Indices and distances of the neighbors, sorted by increasing distance.
+      Both arrays have shape [num examples in data1, top_k]. Missing neighbors
+      have an index of -1 and a distance of 1.
+    """
+
+    ds1 = dataset.create_vertical_dataset(
+        data1, data_spec=self._model.data_spec()
+    )
+    if data2 is None:
+      ds2 = ds1
+    else:
+      ds2 = dataset.create_vertical_dataset(
+          data2, data_spec=self._model.data_spec()
+      )
+    return self._model.NearestNeighbors(
+        ds1._dataset,  # pylint: disable=protected-access
+        ds2._dataset,  # pylint: disable=protected-access
+        top_k=top_k,
+        max_distance=max_distance,
+        num_threads=num_threads,
+    )
+
+  def predict_shap(
+      self,
+      data: dataset.InputDataset,
+      background: Optional[dataset.InputDataset] = None,
+      num_threads: int = 6,
+  ) -> Tuple[np.ndarray, np.ndarray]:
+    """Computes the exact SHAP values of the predictions.
+
+    The SHAP values of an example explain the raw output of the model (e.g. the
+    logit of a gradient boosted trees classifier, the probability of a random
+    forest classifier) as the sum of an expected value and of the contribution
+    of each feature.
+
+    If "background" is provided, the interventional SHAP values are computed:
+    The missing features take the values of the examples in "background".
+    Otherwise, the path-dependent SHAP values (TreeSHAP) are computed using the
+    number of training examples in each node of the trees.
+
+    Usage example:
+
+    ```python
+    values, expected_values = model.predict_shap(test_ds)
+    # "values[i,j,k]" is the contribution of the j-th column of the dataspec
+    # to the k-th output of the model for the i-th example.
+    # "expected_values[k] + values[i,:,k].sum()" is the k-th raw output of the
+    # model for the i-th example.
+    ```
+
+    Models with oblique conditions are not supported.
+
+    Args:
+      data: Dataset. Can be a dictionary of list or numpy array of values,
+        Pandas DataFrame, or a VerticalDataset.
+      background: Optional background dataset. Can be a dictionary of list or
+        numpy array of values, Pandas DataFrame, or a VerticalDataset. The cost
+        of the computation is linear in the number of background examples.
+      num_threads: Number of threads used for the computation.
+
+    Returns:
+      SHAP values of shape [num examples, num columns in the dataspec, num
+      outputs], and the expected values of shape [num outputs].
+    """
+
+    ds = dataset.create_vertical_dataset(
+        data, data_spec=self._model.data_spec()
+    )
+    background_ds = None
+    if background is not None:
+      background_ds = dataset.create_vertical_dataset(
+          background, data_spec=self._model.data_spec()
+      )
+    return self._model.PredictShap(
+        ds._dataset,  # pylint: disable=protected-access
+        background_ds._dataset if background_ds is not None else None,  # pylint: disable=protected-access
+        num_threads=num_threads,
+    )
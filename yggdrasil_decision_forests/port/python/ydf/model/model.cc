@@ -113,9 +113,16 @@ void init_model(py::module_& m) {
                  "<model_cc.DecisionForestCCModel of type $0.", a.name());
            })
       .def("num_trees", &DecisionForestCCModel::num_trees)
-      .def("PredictLeaves", &DecisionForestCCModel::PredictLeaves)
+      .def("PredictLeaves", &DecisionForestCCModel::PredictLeaves,
+           py::arg("dataset"), py::arg("num_threads"))
       .def("Distance", &DecisionForestCCModel::Distance, py::arg("dataset1"),
-           py::arg("dataset2"));
+           py::arg("dataset2"))
+      .def("NearestNeighbors", &DecisionForestCCModel::NearestNeighbors,
+           py::arg("dataset1"), py::arg("dataset2"), py::arg("top_k"),
+           py::arg("max_distance"), py::arg("num_threads"))
+      .def("PredictShap", &DecisionForestCCModel::PredictShap,
+           py::arg("dataset"), py::arg("background").none(true),
+           py::arg("num_threads"));
 
   py::class_<RandomForestCCModel,
              /*parent class*/ DecisionForestCCModel>(m, "RandomForestCCModel")
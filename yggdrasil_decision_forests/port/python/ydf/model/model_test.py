@@ -296,6 +296,44 @@ Use `model.describe()` for more details
     self.assertEqual(leaves.shape, (dataset.shape[0], model.num_trees()))
     self.assertTrue(np.all(leaves >= 0))
 
+    # The number of threads does not change the leaves.
+    np.testing.assert_array_equal(
+        model.predict_leaves(dataset, num_threads=1), leaves
+    )
+
+  def test_predict_shap(self):
+    model_path = os.path.join(
+        test_utils.ydf_test_data_path(),
+        "model",
+        "adult_binary_class_gbdt",
+    )
+    model = model_lib.load_model(model_path)
+
+    dataset_path = os.path.join(
+        test_utils.ydf_test_data_path(), "dataset", "adult_test.csv"
+    )
+    dataset = pd.read_csv(dataset_path).head(200)
+    num_columns = len(model.data_spec().columns)
+
+    # The SHAP values sum to the logit of the prediction.
+    predictions = model.predict(dataset)
+    expected_logits = np.log(predictions / (1.0 - predictions))
+    for background in [None, dataset.head(10)]:
+      values, expected_values = model.predict_shap(dataset, background)
+      self.assertEqual(values.shape, (dataset.shape[0], num_columns, 1))
+      self.assertEqual(expected_values.shape, (1,))
+      np.testing.assert_allclose(
+          expected_values[0] + values[:, :, 0].sum(axis=1),
+          expected_logits,
+          atol=1e-3,
+      )
+
+    # The number of threads does not change the values.
+    np.testing.assert_array_equal(
+        model.predict_shap(dataset, num_threads=1)[0],
+        model.predict_shap(dataset)[0],
+    )
+
   def test_benchmark(self):
     model_path = os.path.join(
         test_utils.ydf_test_data_path(), "model", "adult_binary_class_gbdt"
@@ -359,6 +397,21 @@ class RandomForestModelTest(absltest.TestCase):
         dataset1.iloc[0]["income"],
     )
 
+    # The nearest neighbors match the dense distance matrix.
+    indices, nn_distances = model.nearest_neighbors(
+        dataset1, dataset2, top_k=3
+    )
+    self.assertEqual(indices.shape, (dataset1.shape[0], 3))
+    self.assertEqual(nn_distances.shape, (dataset1.shape[0], 3))
+    np.testing.assert_allclose(
+        nn_distances, np.sort(distances, axis=1)[:, :3], atol=1e-6
+    )
+    np.testing.assert_allclose(
+        distances[np.arange(dataset1.shape[0])[:, np.newaxis], indices],
+        nn_distances,
+        atol=1e-6,
+    )
+
 
 class GradientBoostedTreesTest(absltest.TestCase):
 
@@ -371,6 +424,25 @@ class GradientBoostedTreesTest(absltest.TestCase):
     validation_loss = model.validation_loss()
     self.assertAlmostEqual(validation_loss, 0.573842942, places=6)
 
+  def test_nearest_neighbors(self):
+    model_path = os.path.join(
+        test_utils.ydf_test_data_path(), "model", "adult_binary_class_gbdt"
+    )
+    model = model_lib.load_model(model_path)
+    dataset = pd.read_csv(
+        os.path.join(
+            test_utils.ydf_test_data_path(), "dataset", "adult_test.csv"
+        ),
+        nrows=200,
+    )
+
+    indices, distances = model.nearest_neighbors(dataset, top_k=3)
+    self.assertEqual(indices.shape, (dataset.shape[0], 3))
+    self.assertEqual(distances.shape, (dataset.shape[0], 3))
+    # Each example is its own closest neighbor.
+    np.testing.assert_array_equal(distances[:, 0], 0)
+    self.assertTrue(np.all(np.diff(distances, axis=1) >= 0))
+
 
 if __name__ == "__main__":
   absltest.main()
@@ -37,12 +37,14 @@
 #include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/model_library.h"
 #include "yggdrasil_decision_forests/serving/example_set.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
 #include "yggdrasil_decision_forests/serving/fast_engine.h"
 #include "yggdrasil_decision_forests/utils/benchmark/inference.h"
 #include "yggdrasil_decision_forests/utils/model_analysis.h"
 #include "yggdrasil_decision_forests/utils/model_analysis.pb.h"
 #include "yggdrasil_decision_forests/utils/random.h"
 #include "yggdrasil_decision_forests/utils/status_macros.h"
+#include "yggdrasil_decision_forests/utils/synchronization_primitives.h"
 
 namespace yggdrasil_decision_forests::port::python {
 
@@ -141,14 +143,37 @@ absl::Status GenericCCModel::Save(
   return model::SaveModel(directory, model_.get(), {file_prefix});
 }
 
+const serving::decision_forest::LeafIndexEngine*
+DecisionForestCCModel::GetLeafIndexEngine() {
+  utils::concurrency::MutexLock lock(&leaf_engine_mutex_);
+  if (!leaf_engine_built_) {
+    leaf_engine_built_ = true;
+    auto leaf_engine_or =
+        serving::decision_forest::LeafIndexEngine::Create(*model_);
+    if (leaf_engine_or.ok()) {
+      leaf_engine_ = std::move(leaf_engine_or).value();
+    }
+  }
+  return leaf_engine_.get();
+}
+
 absl::StatusOr<py::array_t<int32_t>> DecisionForestCCModel::PredictLeaves(
-    const dataset::VerticalDataset& dataset) {
+    const dataset::VerticalDataset& dataset, const int num_threads) {
   py::array_t<int32_t, py::array::c_style | py::array::forcecast> leaves;
 
   const size_t num_examples = dataset.nrow();
   const size_t num_trees = df_model_->num_trees();
 
   leaves.resize({num_examples, num_trees});
+
+  // Models not compatible with the leaf index engine (e.g. with conditions
+  // not supported by the flat models) are evaluated example by example.
+  if (const auto* leaf_engine = GetLeafIndexEngine()) {
+    auto dst = absl::MakeSpan(leaves.mutable_data(), num_examples * num_trees);
+    RETURN_IF_ERROR(leaf_engine->PredictLeaves(dataset, num_threads, dst));
+    return leaves;
+  }
+
   auto unchecked_leaves = leaves.mutable_unchecked();
   for (size_t example_idx = 0; example_idx < num_examples; example_idx++) {
     auto dst = absl::MakeSpan(unchecked_leaves.mutable_data(example_idx, 0),
@@ -171,6 +196,68 @@ absl::StatusOr<py::array_t<float>> DecisionForestCCModel::Distance(
   return distances;
 }
 
+absl::StatusOr<std::pair<py::array_t<int64_t>, py::array_t<float>>>
+DecisionForestCCModel::NearestNeighbors(
+    const dataset::VerticalDataset& dataset1,
+    const dataset::VerticalDataset& dataset2, const int top_k,
+    const float max_distance, const int num_threads) {
+  if (top_k <= 0) {
+    return absl::InvalidArgumentError("top_k should be strictly positive");
+  }
+  model::decision_tree::NearestNeighborsOptions options;
+  options.top_k = top_k;
+  options.max_distance = max_distance;
+  options.num_threads = num_threads;
+  std::vector<std::vector<model::decision_tree::Neighbor>> neighbors;
+  RETURN_IF_ERROR(
+      df_model_->NearestNeighbors(dataset1, dataset2, options, &neighbors));
+
+  const size_t n1 = dataset1.nrow();
+  py::array_t<int64_t, py::array::c_style | py::array::forcecast> indices;
+  py::array_t<float, py::array::c_style | py::array::forcecast> distances;
+  indices.resize({n1, static_cast<size_t>(top_k)});
+  distances.resize({n1, static_cast<size_t>(top_k)});
+  auto unchecked_indices = indices.mutable_unchecked();
+  auto unchecked_distances = distances.mutable_unchecked();
+  for (size_t example_idx = 0; example_idx < n1; example_idx++) {
+    const auto& src = neighbors[example_idx];
+    for (size_t k = 0; k < top_k; k++) {
+      if (k < src.size()) {
+        unchecked_indices(example_idx, k) = src[k].example_idx;
+        unchecked_distances(example_idx, k) = src[k].distance;
+      } else {
+        unchecked_indices(example_idx, k) = -1;
+        unchecked_distances(example_idx, k) = 1.f;
+      }
+    }
+  }
+  return std::make_pair(std::move(indices), std::move(distances));
+}
+
+absl::StatusOr<std::pair<py::array_t<float>, py::array_t<float>>>
+DecisionForestCCModel::PredictShap(const dataset::VerticalDataset& dataset,
+                                   const dataset::VerticalDataset* background,
+                                   const int num_threads) {
+  model::ShapOptions options;
+  options.num_threads = num_threads;
+  options.background = background;
+  model::ShapValues shap_values;
+  RETURN_IF_ERROR(model_->ComputeShapValues(dataset, options, &shap_values));
+
+  py::array_t<float, py::array::c_style | py::array::forcecast> values;
+  py::array_t<float, py::array::c_style | py::array::forcecast>
+      expected_values;
+  values.resize({static_cast<size_t>(shap_values.num_examples),
+                 static_cast<size_t>(shap_values.num_columns),
+                 static_cast<size_t>(shap_values.num_outputs)});
+  expected_values.resize({static_cast<size_t>(shap_values.num_outputs)});
+  std::copy(shap_values.values.begin(), shap_values.values.end(),
+            values.mutable_data());
+  std::copy(shap_values.expected_values.begin(),
+            shap_values.expected_values.end(), expected_values.mutable_data());
+  return std::make_pair(std::move(values), std::move(expected_values));
+}
+
 // TODO: Pass utils::BenchmarkInferenceRunOptions directly.
 absl::StatusOr<BenchmarkInferenceCCResult> GenericCCModel::Benchmark(
     const dataset::VerticalDataset& dataset, const double benchmark_duration,
@@ -37,11 +37,13 @@
 #include "yggdrasil_decision_forests/model/decision_tree/decision_forest_interface.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
 #include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
 #include "yggdrasil_decision_forests/serving/fast_engine.h"
 #include "yggdrasil_decision_forests/utils/benchmark/inference.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
 #include "yggdrasil_decision_forests/utils/model_analysis.pb.h"
 #include "yggdrasil_decision_forests/utils/status_macros.h"
+#include "yggdrasil_decision_forests/utils/synchronization_primitives.h"
 
 namespace py = ::pybind11;
 
@@ -127,13 +129,31 @@ class DecisionForestCCModel : public GenericCCModel {
  public:
   int num_trees() const { return df_model_->num_trees(); }
 
+  // Computes the active leaves with the flat leaf index engine, in parallel
+  // over "num_threads" threads, writing directly in the output array. The
+  // engine is built on the first call and reused by the next calls.
   absl::StatusOr<py::array_t<int32_t>> PredictLeaves(
-      const dataset::VerticalDataset& dataset);
+      const dataset::VerticalDataset& dataset, int num_threads);
 
   absl::StatusOr<py::array_t<float>> Distance(
       const dataset::VerticalDataset& dataset1,
       const dataset::VerticalDataset& dataset2);
 
+  // Returns the indices (padded with -1) and distances (padded with 1) of the
+  // "top_k" closest examples in "dataset2" of each example in "dataset1".
+  absl::StatusOr<std::pair<py::array_t<int64_t>, py::array_t<float>>>
+  NearestNeighbors(const dataset::VerticalDataset& dataset1,
+                   const dataset::VerticalDataset& dataset2, int top_k,
+                   float max_distance, int num_threads);
+
+  // Returns the SHAP values, of shape [num_examples, num_columns,
+  // num_outputs], and the expected values, of shape [num_outputs]. Computes
+  // the interventional SHAP values if "background" is set, and the
+  // path-dependent SHAP values otherwise.
+  absl::StatusOr<std::pair<py::array_t<float>, py::array_t<float>>>
+  PredictShap(const dataset::VerticalDataset& dataset,
+              const dataset::VerticalDataset* background, int num_threads);
+
  protected:
   // `model` and `df_model` must correspond to the same object.
   DecisionForestCCModel(std::unique_ptr<model::AbstractModel>&& model,
@@ -141,8 +161,19 @@ class DecisionForestCCModel : public GenericCCModel {
       : GenericCCModel(std::move(model)), df_model_(df_model) {}
 
  private:
+  // Gets the leaf index engine of the model. If the engine does not exist,
+  // create it. Returns nullptr if the model is not compatible with the engine.
+  // This method is thread safe.
+  const serving::decision_forest::LeafIndexEngine* GetLeafIndexEngine();
+
   // This is a non-owning pointer to the model held by `model_`.
   model::DecisionForestInterface* df_model_;
+
+  utils::concurrency::Mutex leaf_engine_mutex_;
+  // Whether "leaf_engine_" was built (successfully or not).
+  bool leaf_engine_built_ GUARDED_BY(leaf_engine_mutex_) = false;
+  std::unique_ptr<serving::decision_forest::LeafIndexEngine> leaf_engine_
+      GUARDED_BY(leaf_engine_mutex_);
 };
 
 class RandomForestCCModel : public DecisionForestCCModel {
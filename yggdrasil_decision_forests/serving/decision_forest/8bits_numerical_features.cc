@@ -15,6 +15,10 @@
 
 #include "yggdrasil_decision_forests/serving/decision_forest/8bits_numerical_features.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
 #include <limits>
 
 #include "absl/status/status.h"
@@ -23,6 +27,7 @@
 #include "absl/strings/substitute.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/utils/compatibility.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
 
 namespace yggdrasil_decision_forests {
 namespace serving {
@@ -33,24 +38,45 @@ namespace {
 // Maximum stack size used by the model during inference
 constexpr size_t kMaxStackUsageInBytes = 16 * 1024;
 
+using model::decision_tree::DecisionTree;
 using model::decision_tree::NodeWithChildren;
 using model::decision_tree::proto::Condition;
+using model::gradient_boosted_trees::GradientBoostedTreesModel;
 using model::gradient_boosted_trees::proto::Loss;
+using model::random_forest::RandomForestModel;
+
+// Sets the "num_values_per_leaf" values of a leaf.
+using SetLeafFunction = std::function<absl::Status(
+    const model::decision_tree::proto::Node& node, LeafOutput* values)>;
 
 // Activation function for the log likelihood loss.
-float ActivationBinomialLogLikelihood(const float value) {
-  return utils::clamp(1.f / (1.f + std::exp(-value)), 0.f, 1.f);
+void ActivationBinomialLogLikelihood(float* values, const int num_values) {
+  values[0] = utils::clamp(1.f / (1.f + std::exp(-values[0])), 0.f, 1.f);
+}
+
+// Activation function for the multinomial log likelihood loss i.e. softmax.
+void ActivationMultinomialLogLikelihood(float* values, const int num_values) {
+  float sum = 0;
+  for (int i = 0; i < num_values; i++) {
+    values[i] = std::exp(values[i]);
+    sum += values[i];
+  }
+  const float normalize = 1.f / sum;
+  for (int i = 0; i < num_values; i++) {
+    values[i] *= normalize;
+  }
 }
 
 // Identity activation function.
-float ActivationIdentity(const float value) { return value; }
+void ActivationIdentity(float* values, const int num_values) {}
 
-template <float (*Activation)(float)>
+template <void (*Activation)(float*, int)>
 absl::Status RawPredict(const RawModel& model,
                         const std::vector<uint8_t>& examples,
                         uint32_t num_examples,
                         std::vector<float>* predictions) {
-  predictions->resize(num_examples);
+  const int num_outputs = model.num_outputs;
+  predictions->resize(num_examples * num_outputs);
 
   // Allocate active leaf buffer.
   const size_t active_leaf_buffer_size = model.num_trees * sizeof(LeafMask);
@@ -67,12 +93,16 @@ absl::Status RawPredict(const RawModel& model,
 
   const int num_features = model.num_features;
   const int num_trees = model.num_trees;
+  const int num_values_per_leaf = model.num_values_per_leaf;
 
   const LeafMask* __restrict masks_v2 = model.masks_v2.data();
   const uint32_t* __restrict feature_value_to_mask_list =
       model.feature_value_to_mask_list.data();
   const uint32_t* __restrict feature_to_feature_value =
       model.feature_to_feature_value.data();
+  const LeafOutput* __restrict leaves = model.leaves.data();
+  const uint32_t* __restrict leaves_tree_index =
+      model.leaves_tree_index.data();
 
   // Run inference
   const uint8_t* example_reader = examples.data();
@@ -94,15 +124,45 @@ absl::Status RawPredict(const RawModel& model,
       }
     }
 
-    // Get the active leaf.
-    float output = model.initial_prediction;
-    for (int tree_idx = 0; tree_idx < model.num_trees; tree_idx++) {
-      const auto node_idx = absl::countr_zero(active_leaf_buffer[tree_idx]);
-      output += model.leaves[model.leaves_tree_index[tree_idx] + node_idx];
+    // Get the active leaves.
+    float* output = &(*predictions)[example_idx * num_outputs];
+    if (num_outputs == 1) {
+      float value = model.initial_predictions[0];
+      for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+        const auto node_idx = absl::countr_zero(active_leaf_buffer[tree_idx]);
+        value += leaves[leaves_tree_index[tree_idx] + node_idx];
+      }
+      output[0] = value;
+    } else {
+      std::copy(model.initial_predictions.begin(),
+                model.initial_predictions.end(), output);
+      if (num_values_per_leaf == 1) {
+        // The trees are interleaved by output.
+        int output_idx = 0;
+        for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+          const auto node_idx =
+              absl::countr_zero(active_leaf_buffer[tree_idx]);
+          output[output_idx] += leaves[leaves_tree_index[tree_idx] + node_idx];
+          if (++output_idx == num_outputs) {
+            output_idx = 0;
+          }
+        }
+      } else {
+        for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+          const auto node_idx =
+              absl::countr_zero(active_leaf_buffer[tree_idx]);
+          const LeafOutput* leaf =
+              &leaves[(leaves_tree_index[tree_idx] + node_idx) *
+                      num_values_per_leaf];
+          for (int output_idx = 0; output_idx < num_outputs; output_idx++) {
+            output[output_idx] += leaf[output_idx];
+          }
+        }
+      }
     }
 
-    (*predictions)[example_idx] = Activation(output);
-    example_reader += model.num_features;
+    Activation(output, num_outputs);
+    example_reader += num_features;
   }
 
   if (!active_leaf_buffer_uses_stack) {
@@ -113,49 +173,81 @@ absl::Status RawPredict(const RawModel& model,
   return absl::OkStatus();
 }
 
-absl::Status Initialize(
-    const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
-    RawModel* dst, BuildingWorkMemory* working) {
-  working->sum_num_buckets = 0;
-
-  dst->num_buckets.assign(dst->num_features, 0);
+// Checks that a feature is compatible with the engine.
+absl::Status CheckFeature(const dataset::proto::Column& column_spec) {
+  if (column_spec.type() != dataset::proto::ColumnType::DISCRETIZED_NUMERICAL) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Feature \"$0\" hs not DISCRETIZED_NUMERICAL.", column_spec.name()));
+  }
 
-  for (int local_feature_idx = 0;
-       local_feature_idx < src.input_features().size(); local_feature_idx++) {
-    const int feature_idx = src.input_features()[local_feature_idx];
-    const auto& column_spec = src.data_spec().columns(feature_idx);
+  const auto num_boundaries =
+      column_spec.discretized_numerical().boundaries_size();
 
-    if (column_spec.type() !=
-        dataset::proto::ColumnType::DISCRETIZED_NUMERICAL) {
-      return absl::InvalidArgumentError(absl::Substitute(
-          "Feature \"$0\" hs not DISCRETIZED_NUMERICAL.", column_spec.name()));
-    }
+  if (num_boundaries + 1 > 256) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "The number of buckets of feature \"$0\" is greater than 256.",
+        column_spec.name()));
+  }
 
-    const auto num_boundaries =
-        column_spec.discretized_numerical().boundaries_size();
-    const auto num_buckets = num_boundaries + 1;
+  if (num_boundaries == 0) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Feature \"$0\" has only one bucket.", column_spec.name()));
+  }
 
-    if (num_boundaries + 1 > 256) {
+  for (int boundary_idx = 0; boundary_idx < num_boundaries; boundary_idx++) {
+    const float expected_boundary = static_cast<float>(boundary_idx) + 0.5f;
+    const float boundary =
+        column_spec.discretized_numerical().boundaries()[boundary_idx];
+    if (std::abs(expected_boundary - boundary) >= 0.001) {
       return absl::InvalidArgumentError(absl::Substitute(
-          "The number of buckets of feature \"$0\" is greater than 256.",
+          "The boundaries of feature \"$0\" are not [0.5, 1.5, 2.5, ...].",
           column_spec.name()));
     }
+  }
+  return absl::OkStatus();
+}
 
-    if (num_boundaries == 0) {
-      return absl::InvalidArgumentError(absl::Substitute(
-          "Feature \"$0\" has only one bucket.", column_spec.name()));
+absl::Status RawCheckCompatibility(
+    const model::AbstractModel& src,
+    const std::vector<std::unique_ptr<DecisionTree>>& trees) {
+  for (const int feature_idx : src.input_features()) {
+    RETURN_IF_ERROR(CheckFeature(src.data_spec().columns(feature_idx)));
+  }
+  if (trees.size() > kMaxTrees) {
+    return absl::InvalidArgumentError("Too many trees");
+  }
+  for (const auto& tree : trees) {
+    if (tree->NumLeafs() > kMaxLeafs) {
+      return absl::InvalidArgumentError("Too many leaves");
     }
-
-    for (int boundary_idx = 0; boundary_idx < num_boundaries; boundary_idx++) {
-      const float expected_boundary = static_cast<float>(boundary_idx) + 0.5f;
-      const float boundary =
-          column_spec.discretized_numerical().boundaries()[boundary_idx];
-      if (std::abs(expected_boundary - boundary) >= 0.001) {
-        return absl::InvalidArgumentError(absl::Substitute(
-            "The boundaries of feature \"$0\" are not [0.5, 1.5, 2.5, ...].",
-            column_spec.name()));
+    bool valid_conditions = true;
+    tree->IterateOnNodes([&](const NodeWithChildren& node, const int depth) {
+      if (!node.IsLeaf() &&
+          node.node().condition().condition().type_case() !=
+              Condition::TypeCase::kDiscretizedHigherCondition) {
+        valid_conditions = false;
       }
+    });
+    if (!valid_conditions) {
+      return absl::InvalidArgumentError("Non supported condition");
     }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Initialize(const model::AbstractModel& src, RawModel* dst,
+                        BuildingWorkMemory* working) {
+  working->sum_num_buckets = 0;
+
+  dst->num_buckets.assign(dst->num_features, 0);
+
+  for (int local_feature_idx = 0;
+       local_feature_idx < src.input_features().size(); local_feature_idx++) {
+    const int feature_idx = src.input_features()[local_feature_idx];
+    const auto& column_spec = src.data_spec().columns(feature_idx);
+    RETURN_IF_ERROR(CheckFeature(column_spec));
+    const auto num_buckets =
+        column_spec.discretized_numerical().boundaries_size() + 1;
 
     working->features[feature_idx] = {
         /*name=*/column_spec.name(),
@@ -166,13 +258,15 @@ absl::Status Initialize(
     dst->num_buckets[local_feature_idx] = num_buckets;
     working->sum_num_buckets += num_buckets;
   }
+
   return absl::OkStatus();
 }
 
-absl::Status FillMaskNode(
-    const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
-    const uint32_t tree_idx, const NodeWithChildren& src_node, RawModel* dst,
-    BuildingWorkMemory* working, int* leaf_idx, int* non_leaf_idx) {
+absl::Status FillMaskNode(const SetLeafFunction& set_leaf,
+                          const uint32_t tree_idx,
+                          const NodeWithChildren& src_node, RawModel* dst,
+                          BuildingWorkMemory* working, int* leaf_idx,
+                          int* non_leaf_idx) {
   if (src_node.IsLeaf()) {
     // Store the leaf value.
     if (*leaf_idx >= kMaxLeafs) {
@@ -180,15 +274,17 @@ absl::Status FillMaskNode(
     }
 
     const auto leaf_value_idx = *leaf_idx + dst->leaves_tree_index[tree_idx];
-    dst->leaves[leaf_value_idx] = src_node.node().regressor().top_value();
+    RETURN_IF_ERROR(set_leaf(
+        src_node.node(),
+        &dst->leaves[leaf_value_idx * dst->num_values_per_leaf]));
     (*leaf_idx)++;
   } else {
     // Index of the first leaf in the negative branch.
     const auto begin_neg_leaf_idx = *leaf_idx;
 
     // Parse the negative branch.
-    RETURN_IF_ERROR(FillMaskNode(src, tree_idx, *src_node.neg_child(), dst,
-                                 working, leaf_idx, non_leaf_idx));
+    RETURN_IF_ERROR(FillMaskNode(set_leaf, tree_idx, *src_node.neg_child(),
+                                 dst, working, leaf_idx, non_leaf_idx));
 
     // Index of the feature used by the node.
     const int feature_idx = src_node.node().condition().attribute();
@@ -226,38 +322,37 @@ absl::Status FillMaskNode(
 
     ++(*non_leaf_idx);
 
-    RETURN_IF_ERROR(FillMaskNode(src, tree_idx, *src_node.pos_child(), dst,
-                                 working, leaf_idx, non_leaf_idx));
+    RETURN_IF_ERROR(FillMaskNode(set_leaf, tree_idx, *src_node.pos_child(),
+                                 dst, working, leaf_idx, non_leaf_idx));
   }
 
   return absl::OkStatus();
 }
 
-absl::Status FillMask(
-    const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
-    RawModel* dst, BuildingWorkMemory* working) {
+absl::Status FillMask(const std::vector<std::unique_ptr<DecisionTree>>& trees,
+                      const SetLeafFunction& set_leaf, RawModel* dst,
+                      BuildingWorkMemory* working) {
   uint32_t sum_num_leaves = 0;
   for (uint32_t tree_idx = 0; tree_idx < dst->num_trees; tree_idx++) {
-    const auto& src_tree = src.decision_trees()[tree_idx];
+    const auto& src_tree = trees[tree_idx];
     const auto num_leaves = src_tree->NumLeafs();
     dst->leaves_tree_index[tree_idx] = sum_num_leaves;
     sum_num_leaves += num_leaves;
   }
-  dst->leaves.assign(sum_num_leaves, std::numeric_limits<float>::quiet_NaN());
+  dst->leaves.assign(sum_num_leaves * dst->num_values_per_leaf,
+                     std::numeric_limits<float>::quiet_NaN());
 
   for (uint32_t tree_idx = 0; tree_idx < dst->num_trees; tree_idx++) {
-    const auto& src_tree = src.decision_trees()[tree_idx];
+    const auto& src_tree = trees[tree_idx];
     int leaf_idx = 0;
     int non_leaf_idx = 0;
-    RETURN_IF_ERROR(FillMaskNode(src, tree_idx, src_tree->root(), dst, working,
-                                 &leaf_idx, &non_leaf_idx));
+    RETURN_IF_ERROR(FillMaskNode(set_leaf, tree_idx, src_tree->root(), dst,
+                                 working, &leaf_idx, &non_leaf_idx));
   }
   return absl::OkStatus();
 }
 
-absl::Status FinalizeMask(
-    const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
-    RawModel* dst, BuildingWorkMemory* working) {
+absl::Status FinalizeMask(RawModel* dst, BuildingWorkMemory* working) {
   // Unlike for QS, the inference don't apply all the valid masks. Instead, it
   // only applies the one corresponding to the most specific condition.
   // Therefore, We need to "spread" a mask to all the other most specific
@@ -268,9 +363,11 @@ absl::Status FinalizeMask(
   std::vector<LeafMask> full_mask(dst->num_trees, kFullLeafMask);
   dst->masks_v2.insert(dst->masks_v2.end(), full_mask.begin(), full_mask.end());
 
+  // Note: "feature_to_feature_value" is indexed by local feature index.
+  dst->feature_to_feature_value.assign(dst->num_features, 0);
   for (const auto& feature : working->features) {
-    dst->feature_to_feature_value.push_back(
-        dst->feature_value_to_mask_list.size());
+    dst->feature_to_feature_value[feature.second.local_idx] =
+        dst->feature_value_to_mask_list.size();
 
     // Current active mask.
     std::vector<LeafMask> active_mask = full_mask;
@@ -300,10 +397,23 @@ absl::Status FinalizeMask(
   return absl::OkStatus();
 }
 
+// Compiles a model. "dst->num_outputs", "dst->num_values_per_leaf" and
+// "dst->initial_predictions" should be set by the caller.
 absl::Status RawGenericToSpecializedModel(
-    const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
-    RawModel* dst) {
-  dst->num_trees = src.num_trees();
+    const model::AbstractModel& src,
+    const std::vector<std::unique_ptr<DecisionTree>>& trees,
+    const SetLeafFunction& set_leaf, RawModel* dst) {
+  if (trees.size() > kMaxTrees) {
+    return absl::InvalidArgumentError("Too many trees");
+  }
+  if (dst->initial_predictions.size() != dst->num_outputs) {
+    return absl::InternalError("Unexpected number of initial predictions");
+  }
+  if (dst->num_values_per_leaf != 1 &&
+      dst->num_values_per_leaf != dst->num_outputs) {
+    return absl::InternalError("Unexpected number of values per leaf");
+  }
+  dst->num_trees = trees.size();
   dst->features = src.input_features();
   dst->num_features = dst->features.size();
 
@@ -313,27 +423,113 @@ absl::Status RawGenericToSpecializedModel(
 
   // Compile the model
   dst->leaves_tree_index.assign(dst->num_trees, 0);
-  RETURN_IF_ERROR(FillMask(src, dst, &working));
-  RETURN_IF_ERROR(FinalizeMask(src, dst, &working));
+  RETURN_IF_ERROR(FillMask(trees, set_leaf, dst, &working));
+  RETURN_IF_ERROR(FinalizeMask(dst, &working));
 
   return absl::OkStatus();
 }
 
+// Leaf of a GBT model.
+absl::Status SetLeafGradientBoostedTrees(
+    const model::decision_tree::proto::Node& node, LeafOutput* values) {
+  values[0] = node.regressor().top_value();
+  return absl::OkStatus();
+}
+
+// Compiles a GBT with a single output.
+absl::Status GradientBoostedTreesSingleOutputToSpecializedModel(
+    const GradientBoostedTreesModel& src, RawModel* dst) {
+  if (src.initial_predictions().size() != 1) {
+    return absl::InvalidArgumentError("The GBT has more than one output.");
+  }
+  dst->num_outputs = 1;
+  dst->num_values_per_leaf = 1;
+  dst->initial_predictions = {src.initial_predictions()[0]};
+  return RawGenericToSpecializedModel(src, src.decision_trees(),
+                                      SetLeafGradientBoostedTrees, dst);
+}
+
+// Vote of a leaf of a winner-take-all RF classifier.
+absl::StatusOr<int> WinnerTakeAllVote(
+    const model::decision_tree::proto::Node& node, const int num_classes) {
+  const int32_t vote = node.classifier().top_value();
+  if (vote == dataset::kOutOfDictionaryItemIndex || vote > num_classes) {
+    return absl::InvalidArgumentError(
+        "The model outputs out-of-dictionary or unknown class values.");
+  }
+  return vote;
+}
+
+// Compiles a RF classifier. "num_classes" is the number of classes (excluding
+// the out-of-dictionary item). If "positive_class_only", only the probability
+// of the positive class of a binary classifier is returned.
+absl::Status RandomForestClassificationToSpecializedModel(
+    const RandomForestModel& src, const int num_classes,
+    const bool positive_class_only, RawModel* dst) {
+  const float normalize = 1.f / src.NumTrees();
+  const int first_class = positive_class_only ? 1 : 0;
+  dst->num_outputs = positive_class_only ? 1 : num_classes;
+  dst->num_values_per_leaf = dst->num_outputs;
+  dst->initial_predictions.assign(dst->num_outputs, 0.f);
+
+  const auto set_leaf = [&](const model::decision_tree::proto::Node& node,
+                            LeafOutput* values) -> absl::Status {
+    std::fill(values, values + dst->num_outputs, 0.f);
+    if (src.winner_take_all_inference()) {
+      ASSIGN_OR_RETURN(const int vote, WinnerTakeAllVote(node, num_classes));
+      const int output_idx = vote - 1 - first_class;
+      if (output_idx >= 0) {
+        values[output_idx] = normalize;
+      }
+    } else {
+      const auto& distribution = node.classifier().distribution();
+      if (distribution.counts_size() != num_classes + 1) {
+        return absl::InvalidArgumentError(
+            "Unexpected number of classes in the leaf distribution.");
+      }
+      for (int output_idx = 0; output_idx < dst->num_outputs; output_idx++) {
+        values[output_idx] = static_cast<float>(
+            distribution.counts(output_idx + 1 + first_class) /
+            (distribution.sum() * src.NumTrees()));
+      }
+    }
+    return absl::OkStatus();
+  };
+  return RawGenericToSpecializedModel(src, src.decision_trees(), set_leaf,
+                                      dst);
+}
+
+// Number of classes of a classification model (excluding the
+// out-of-dictionary item).
+absl::StatusOr<int> NumClasses(const model::AbstractModel& src) {
+  if (src.task() != model::proto::Task::CLASSIFICATION) {
+    return absl::InvalidArgumentError("The model is not a classifier.");
+  }
+  return src.label_col_spec().categorical().number_of_unique_values() - 1;
+}
+
 }  // namespace
 
+absl::Status CheckCompatibility(const GradientBoostedTreesModel& src) {
+  return RawCheckCompatibility(src, src.decision_trees());
+}
+
+absl::Status CheckCompatibility(const RandomForestModel& src) {
+  return RawCheckCompatibility(src, src.decision_trees());
+}
+
 absl::Status GenericToSpecializedModel(
-    const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
+    const GradientBoostedTreesModel& src,
     GradientBoostedTreesBinaryClassificationModel* dst) {
   if (src.loss() != Loss::BINOMIAL_LOG_LIKELIHOOD) {
     return absl::InvalidArgumentError(
         "The GBT is not trained with the binomial log likelihood loss.");
   }
-  dst->initial_prediction = src.initial_predictions()[0];
-  return RawGenericToSpecializedModel(src, dst);
+  return GradientBoostedTreesSingleOutputToSpecializedModel(src, dst);
 }
 
 absl::Status GenericToSpecializedModel(
-    const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
+    const GradientBoostedTreesModel& src,
     GradientBoostedTreesBinaryRegressiveModel* dst) {
   if (src.loss() != Loss::BINOMIAL_LOG_LIKELIHOOD &&
       src.loss() != Loss::SQUARED_ERROR &&
@@ -342,8 +538,64 @@ absl::Status GenericToSpecializedModel(
     return absl::InvalidArgumentError(
         "The GBT is not trained with a compatible loss.");
   }
-  dst->initial_prediction = src.initial_predictions()[0];
-  return RawGenericToSpecializedModel(src, dst);
+  return GradientBoostedTreesSingleOutputToSpecializedModel(src, dst);
+}
+
+absl::Status GenericToSpecializedModel(
+    const GradientBoostedTreesModel& src,
+    GradientBoostedTreesMulticlassClassificationModel* dst) {
+  if (src.loss() != Loss::MULTINOMIAL_LOG_LIKELIHOOD) {
+    return absl::InvalidArgumentError(
+        "The GBT is not trained with the multinomial log likelihood loss.");
+  }
+  ASSIGN_OR_RETURN(const int num_classes, NumClasses(src));
+  if (src.num_trees_per_iter() != num_classes ||
+      src.initial_predictions().size() != num_classes) {
+    return absl::InvalidArgumentError(
+        "The GBT does not have one tree per class and per iteration.");
+  }
+  dst->num_outputs = num_classes;
+  dst->num_values_per_leaf = 1;
+  dst->initial_predictions = src.initial_predictions();
+  return RawGenericToSpecializedModel(src, src.decision_trees(),
+                                      SetLeafGradientBoostedTrees, dst);
+}
+
+absl::Status GenericToSpecializedModel(
+    const RandomForestModel& src, RandomForestBinaryClassificationModel* dst) {
+  ASSIGN_OR_RETURN(const int num_classes, NumClasses(src));
+  if (num_classes != 2) {
+    return absl::InvalidArgumentError("The model is not a binary classifier.");
+  }
+  return RandomForestClassificationToSpecializedModel(
+      src, num_classes, /*positive_class_only=*/true, dst);
+}
+
+absl::Status GenericToSpecializedModel(
+    const RandomForestModel& src,
+    RandomForestMulticlassClassificationModel* dst) {
+  ASSIGN_OR_RETURN(const int num_classes, NumClasses(src));
+  return RandomForestClassificationToSpecializedModel(
+      src, num_classes, /*positive_class_only=*/false, dst);
+}
+
+absl::Status GenericToSpecializedModel(const RandomForestModel& src,
+                                       RandomForestRegressionModel* dst) {
+  if (src.task() != model::proto::Task::REGRESSION) {
+    return absl::InvalidArgumentError("The model is not a regressor.");
+  }
+  dst->num_outputs = 1;
+  dst->num_values_per_leaf = 1;
+  dst->initial_predictions = {0.f};
+  const float normalize = 1.f / src.NumTrees();
+  const auto set_leaf = [normalize](
+                            const model::decision_tree::proto::Node& node,
+                            LeafOutput* values) -> absl::Status {
+    values[0] = node.regressor().top_value() * normalize;
+    return absl::OkStatus();
+  };
+  return RawGenericToSpecializedModel(src, src.decision_trees(), set_leaf,
+                                      dst);
 }
 
 absl::Status Predict(const GradientBoostedTreesBinaryClassificationModel& model,
@@ -360,8 +612,72 @@ absl::Status Predict(const GradientBoostedTreesBinaryRegressiveModel& model,
                                         predictions);
 }
 
-template <typename Engine>
-std::string GenericEngineDetails(const Engine& model) {
+absl::Status Predict(
+    const GradientBoostedTreesMulticlassClassificationModel& model,
+    const std::vector<uint8_t>& examples, uint32_t num_examples,
+    std::vector<float>* predictions) {
+  return RawPredict<ActivationMultinomialLogLikelihood>(
+      model, examples, num_examples, predictions);
+}
+
+absl::Status Predict(const RandomForestBinaryClassificationModel& model,
+                     const std::vector<uint8_t>& examples,
+                     uint32_t num_examples, std::vector<float>* predictions) {
+  return RawPredict<ActivationIdentity>(model, examples, num_examples,
+                                        predictions);
+}
+
+absl::Status Predict(const RandomForestMulticlassClassificationModel& model,
+                     const std::vector<uint8_t>& examples,
+                     uint32_t num_examples, std::vector<float>* predictions) {
+  return RawPredict<ActivationIdentity>(model, examples, num_examples,
+                                        predictions);
+}
+
+absl::Status Predict(const RandomForestRegressionModel& model,
+                     const std::vector<uint8_t>& examples,
+                     uint32_t num_examples, std::vector<float>* predictions) {
+  return RawPredict<ActivationIdentity>(model, examples, num_examples,
+                                        predictions);
+}
+
+absl::Status InitializeExampleSetFeatures(
+    const RawModel& model, const dataset::proto::DataSpecification& data_spec,
+    FeaturesDefinitionNumericalOrCategoricalFlat* features) {
+  RETURN_IF_ERROR(features->Initialize(model.features, data_spec));
+  for (int local_feature_idx = 0; local_feature_idx < model.num_features;
+       local_feature_idx++) {
+    ASSIGN_OR_RETURN(
+        const auto feature_id,
+        features->GetNumericalFeatureId(model.features[local_feature_idx]));
+    if (feature_id.index != local_feature_idx) {
+      return absl::InternalError("Unexpected feature order");
+    }
+  }
+  return absl::OkStatus();
+}
+
+void ExampleSetToBuckets(const RawModel& model,
+                         const std::vector<NumericalOrCategoricalValue>& values,
+                         const uint32_t num_examples,
+                         std::vector<uint8_t>* buckets) {
+  const int num_features = model.num_features;
+  buckets->resize(num_examples * num_features);
+  for (size_t value_idx = 0; value_idx < buckets->size(); value_idx++) {
+    // With the boundaries [0.5, 1.5, ...], the bucket of "v" is "floor(v +
+    // 0.5)" clamped to the number of buckets.
+    const float value = values[value_idx].numerical_value;
+    const int num_buckets = model.num_buckets[value_idx % num_features];
+    uint8_t bucket = 0;
+    if (value >= 0.5f) {  // Also false for NaNs.
+      bucket = static_cast<uint8_t>(
+          std::min(value + 0.5f, static_cast<float>(num_buckets - 1)));
+    }
+    (*buckets)[value_idx] = bucket;
+  }
+}
+
+std::string EngineDetails(const RawModel& model) {
   std::string details;
   absl::StrAppendFormat(&details, "Ram usage (in bytes)\n");
   absl::StrAppendFormat(&details, "\tmasks: %d\n",
@@ -380,16 +696,6 @@ std::string GenericEngineDetails(const Engine& model) {
   return details;
 }
 
-std::string EngineDetails(
-    const GradientBoostedTreesBinaryClassificationModel& model) {
-  return GenericEngineDetails(model);
-}
-
-std::string EngineDetails(
-    const GradientBoostedTreesBinaryRegressiveModel& model) {
-  return GenericEngineDetails(model);
-}
-
 }  // namespace num_8bits
 }  // namespace decision_forest
 }  // namespace serving
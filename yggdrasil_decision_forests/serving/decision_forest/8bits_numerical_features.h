@@ -17,14 +17,17 @@
 // numerical features.
 //
 // Limitations:
-//   - For binary classification, regression and ranking GBT models
+//   - For binary classification, multi-class classification, regression and
+//     ranking GBT models, and for binary classification, multi-class
+//     classification and regression RF models.
 //   - Only for uint8 numerical features represented as follows:
 //     - With only discretized numerical features with integers buckets starting
 //       at 0.
 //     - The number of buckets to encode the discretized numerical features
 //       should be less or equal than 256.
 //     - The bucket boundaries should be [0.5, 1.5, 2.5, ....].
-//   - No support for missing values.
+//   - Missing values are replaced by the feature mean. The engine is only
+//     selected for models trained with global imputation.
 //   - The input features are fed as an array of uint8 values. The order of the
 //     features is determined by the dataspec.
 //   - Maximum of 64 leaves per trees.
@@ -33,9 +36,11 @@
 // 10s of trees). For larger models, the QuickScorer engine (when compatible)
 // is faster.
 //
-// This engine is not selected automatically during model inference. The only
-// way to use this engine is to call it directly. See
-// examples/fast_8bits_numerical.cc for an example
+// The engine can be called directly on an array of uint8 values (see
+// examples/fast_8bits_numerical.cc for an example), or through the generic
+// "FastEngine" API (i.e. "model.BuildFastEngine()") where it is automatically
+// selected for compatible models. In the later case, the numerical feature
+// values are converted into bucket indices.
 //
 // This engine works with a leaf masking algorithm similar to quick scorer.
 // However, instead of looking for the mask corresponding to a feature value
@@ -52,9 +57,14 @@
 #include <vector>
 
 #include "absl/status/status.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
+#include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+#include "yggdrasil_decision_forests/serving/example_set.h"
+#include "yggdrasil_decision_forests/utils/logging.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
 
 namespace yggdrasil_decision_forests {
 namespace serving {
@@ -86,8 +96,18 @@ struct RawModel {
   int num_trees;
   int num_features;
 
+  // Dimension of the output of the model, and dimension of
+  // "initial_predictions".
+  int num_outputs = 1;
+
+  // Number of values in each leaf. Either 1 or "num_outputs". If
+  // "num_values_per_leaf=1" and "num_outputs>1", the tree "t" only contributes
+  // to the output "t % num_outputs" (e.g. multi-class GBT). Otherwise, each
+  // leaf contributes to all the outputs (e.g. multi-class RF).
+  int num_values_per_leaf = 1;
+
   // Bias of the model.
-  float initial_prediction;
+  std::vector<float> initial_predictions;
 
   // Node mask according to the feature values.
   //
@@ -106,8 +126,9 @@ struct RawModel {
 
   // Leaf values.
   //
-  // "leaves[leaves_tree_index[t]]..leaves[leaves_tree_index[t+1]]-1" are the
-  // leaf values of tree "t".
+  // "leaves[i * num_values_per_leaf .. (i+1) * num_values_per_leaf - 1]" are
+  // the values of the leaf "i". The leaves
+  // "leaves_tree_index[t]..leaves_tree_index[t+1]-1" belong to tree "t".
   std::vector<LeafOutput> leaves;
   std::vector<uint32_t> leaves_tree_index;
 
@@ -151,6 +172,19 @@ struct BuildingWorkMemory {
 
 struct GradientBoostedTreesBinaryClassificationModel : RawModel {};
 struct GradientBoostedTreesBinaryRegressiveModel : RawModel {};
+struct GradientBoostedTreesMulticlassClassificationModel : RawModel {};
+struct RandomForestBinaryClassificationModel : RawModel {};
+struct RandomForestMulticlassClassificationModel : RawModel {};
+struct RandomForestRegressionModel : RawModel {};
+
+// Checks if the input features and the trees of a model are compatible with
+// this engine (see the limitations at the top of this file). Does not check
+// the task or the loss of the model.
+absl::Status CheckCompatibility(
+    const model::gradient_boosted_trees::GradientBoostedTreesModel& src);
+
+absl::Status CheckCompatibility(
+    const model::random_forest::RandomForestModel& src);
 
 // Compiles a model into a compatible engine.
 absl::Status GenericToSpecializedModel(
@@ -161,6 +195,22 @@ absl::Status GenericToSpecializedModel(
     const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
     GradientBoostedTreesBinaryRegressiveModel* dst);
 
+absl::Status GenericToSpecializedModel(
+    const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
+    GradientBoostedTreesMulticlassClassificationModel* dst);
+
+absl::Status GenericToSpecializedModel(
+    const model::random_forest::RandomForestModel& src,
+    RandomForestBinaryClassificationModel* dst);
+
+absl::Status GenericToSpecializedModel(
+    const model::random_forest::RandomForestModel& src,
+    RandomForestMulticlassClassificationModel* dst);
+
+absl::Status GenericToSpecializedModel(
+    const model::random_forest::RandomForestModel& src,
+    RandomForestRegressionModel* dst);
+
 // Run the engine on a set of examples.
 //
 // Args:
@@ -171,8 +221,10 @@ absl::Status GenericToSpecializedModel(
 //     "k = model.get_features()[j]" for the "i-th" example. The string name of
 //     the feature is available using the dataspec i.e.
 //     "pre_compiled_model.data_spec().columns(k).name()"
-//   num_examples: Number of examples. predictions: Output predictions. Will be
-//     resized to "num_examples".
+//   num_examples: Number of examples.
+//   predictions: Output predictions. Will be resized to
+//     "num_examples * model.num_outputs". "predictions[i * model.num_outputs +
+//     j]" is the "j-th" output of the "i-th" example.
 
 absl::Status Predict(const GradientBoostedTreesBinaryClassificationModel& model,
                      const std::vector<uint8_t>& examples,
@@ -182,12 +234,82 @@ absl::Status Predict(const GradientBoostedTreesBinaryRegressiveModel& model,
                      const std::vector<uint8_t>& examples,
                      uint32_t num_examples, std::vector<float>* predictions);
 
-// Human readable string with information about the engine.
-std::string EngineDetails(
-    const GradientBoostedTreesBinaryClassificationModel& model);
+absl::Status Predict(
+    const GradientBoostedTreesMulticlassClassificationModel& model,
+    const std::vector<uint8_t>& examples, uint32_t num_examples,
+    std::vector<float>* predictions);
 
-std::string EngineDetails(
-    const GradientBoostedTreesBinaryRegressiveModel& model);
+absl::Status Predict(const RandomForestBinaryClassificationModel& model,
+                     const std::vector<uint8_t>& examples,
+                     uint32_t num_examples, std::vector<float>* predictions);
+
+absl::Status Predict(const RandomForestMulticlassClassificationModel& model,
+                     const std::vector<uint8_t>& examples,
+                     uint32_t num_examples, std::vector<float>* predictions);
+
+absl::Status Predict(const RandomForestRegressionModel& model,
+                     const std::vector<uint8_t>& examples,
+                     uint32_t num_examples, std::vector<float>* predictions);
+
+// A compiled model and the definition of its input features for the
+// "ExampleSet" API. Used to wrap the engine into a "FastEngine" (see
+// "ExampleSetModelWrapper").
+template <typename Model>
+struct FastEngineModel {
+  using ExampleSet =
+      ExampleSetNumericalOrCategoricalFlat<FastEngineModel<Model>,
+                                           ExampleFormat::FORMAT_EXAMPLE_MAJOR>;
+
+  const typename ExampleSet::FeaturesDefinition& features() const {
+    return intern_features;
+  }
+
+  Model model;
+
+  // Dimension of the predictions. Same as "model.num_outputs".
+  int num_classes;
+
+  typename ExampleSet::FeaturesDefinition intern_features;
+};
+
+// Initializes the "ExampleSet" features of a compiled model. The "ExampleSet"
+// features are in the same order as "model.features".
+absl::Status InitializeExampleSetFeatures(
+    const RawModel& model, const dataset::proto::DataSpecification& data_spec,
+    FeaturesDefinitionNumericalOrCategoricalFlat* features);
+
+// Converts the numerical feature values of an ExampleSet into bucket indices
+// i.e. the input format of "Predict". Missing values are already replaced by
+// the feature mean in "values".
+void ExampleSetToBuckets(const RawModel& model,
+                         const std::vector<NumericalOrCategoricalValue>& values,
+                         uint32_t num_examples, std::vector<uint8_t>* buckets);
+
+template <typename SourceModel, typename Model>
+absl::Status GenericToSpecializedModel(const SourceModel& src,
+                                       FastEngineModel<Model>* dst) {
+  RETURN_IF_ERROR(GenericToSpecializedModel(src, &dst->model));
+  dst->num_classes = dst->model.num_outputs;
+  return InitializeExampleSetFeatures(dst->model, src.data_spec(),
+                                      &dst->intern_features);
+}
+
+// Version of "Predict" compatible with the ExampleSet signature.
+template <typename Model>
+void Predict(const FastEngineModel<Model>& model,
+             const typename FastEngineModel<Model>::ExampleSet& examples,
+             int num_examples, std::vector<float>* predictions) {
+  std::vector<uint8_t> buckets;
+  ExampleSetToBuckets(model.model,
+                      examples.InternalCategoricalAndNumericalValues(),
+                      num_examples, &buckets);
+  // "Predict" only fails on inputs that cannot be produced by
+  // "ExampleSetToBuckets".
+  CHECK_OK(Predict(model.model, buckets, num_examples, predictions));
+}
+
+// Human readable string with information about the engine.
+std::string EngineDetails(const RawModel& model);
 
 }  // namespace num_8bits
 }  // namespace decision_forest
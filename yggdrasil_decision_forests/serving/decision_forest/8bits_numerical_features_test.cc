@@ -15,8 +15,15 @@
 
 #include "yggdrasil_decision_forests/serving/decision_forest/8bits_numerical_features.h"
 
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
@@ -26,8 +33,12 @@
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
 #include "yggdrasil_decision_forests/model/model_library.h"
 #include "yggdrasil_decision_forests/model/prediction.pb.h"
+#include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/register_engines.h"
+#include "yggdrasil_decision_forests/serving/example_set.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
 #include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
 
 namespace yggdrasil_decision_forests {
 namespace serving {
@@ -39,6 +50,7 @@ using model::decision_tree::DecisionTree;
 using model::decision_tree::NodeWithChildren;
 using model::gradient_boosted_trees::GradientBoostedTreesModel;
 using model::gradient_boosted_trees::proto::Loss;
+using model::random_forest::RandomForestModel;
 using testing::ElementsAre;
 
 std::string TestDataDir() {
@@ -46,10 +58,8 @@ std::string TestDataDir() {
                         "yggdrasil_decision_forests/test_data");
 }
 
-void BuildToyModelAndToyDataset(
-    model::gradient_boosted_trees::GradientBoostedTreesModel* model,
-    dataset::VerticalDataset* dataset) {
-  dataset::proto::DataSpecification dataspec = PARSE_TEST_PROTO(R"pb(
+dataset::proto::DataSpecification ToyDataspec() {
+  return PARSE_TEST_PROTO(R"pb(
     columns {
       type: CATEGORICAL
       name: "label"
@@ -71,13 +81,13 @@ void BuildToyModelAndToyDataset(
       discretized_numerical { boundaries: 0.5 boundaries: 1.5 boundaries: 2.5 }
     }
   )pb");
+}
 
-  dataset->set_data_spec(dataspec);
-  CHECK_OK(dataset->CreateColumnsFromDataspec());
-
-  CHECK_OK(dataset->AppendExampleWithStatus(
-      {{"label", "1"}, {"f1", "0"}, {"f2", "2"}}));
-
+// Builds the two trees of the toy model. "set_leaf" sets the value of a leaf
+// from its identifier.
+void BuildToyTrees(
+    const std::function<void(NodeWithChildren*, int)>& set_leaf,
+    std::vector<std::unique_ptr<DecisionTree>>* trees) {
   struct NodeHelper {
     NodeWithChildren* pos;
     NodeWithChildren* neg;
@@ -96,15 +106,6 @@ void BuildToyModelAndToyDataset(
             /*.neg =*/node->mutable_neg_child()};
   };
 
-  model->set_task(model::proto::Task::CLASSIFICATION);
-  model->set_label_col_idx(0);
-  model->set_data_spec(dataspec);
-  model->set_loss(Loss::BINOMIAL_LOG_LIKELIHOOD);
-  model->mutable_initial_predictions()->push_back(1.f);
-  *model->mutable_input_features() = {1, 2};
-  // Avoid an access to uninitialized memory when printing the model.
-  model->set_num_trees_per_iter(1);
-
   {
     // Tree #0:
     //     "f1".index >= 2 i.e. "f1" >= 1.5
@@ -119,14 +120,14 @@ void BuildToyModelAndToyDataset(
     auto n1 = split(tree->mutable_root(), 1, 2);
 
     auto n2 = split(n1.pos, 1, 3);
-    n2.pos->mutable_node()->mutable_regressor()->set_top_value(1.f);
-    n2.neg->mutable_node()->mutable_regressor()->set_top_value(2.f);
+    set_leaf(n2.pos, 1);
+    set_leaf(n2.neg, 2);
 
     auto n3 = split(n1.neg, 2, 1);
-    n3.pos->mutable_node()->mutable_regressor()->set_top_value(3.f);
-    n3.neg->mutable_node()->mutable_regressor()->set_top_value(4.f);
+    set_leaf(n3.pos, 3);
+    set_leaf(n3.neg, 4);
 
-    model->mutable_decision_trees()->push_back(std::move(tree));
+    trees->push_back(std::move(tree));
   }
 
   {
@@ -137,13 +138,44 @@ void BuildToyModelAndToyDataset(
     auto tree = absl::make_unique<DecisionTree>();
     tree->CreateRoot();
     auto n1 = split(tree->mutable_root(), 2, 2);
-    n1.pos->mutable_node()->mutable_regressor()->set_top_value(10.f);
-    n1.neg->mutable_node()->mutable_regressor()->set_top_value(11.f);
+    set_leaf(n1.pos, 10);
+    set_leaf(n1.neg, 11);
 
-    model->mutable_decision_trees()->push_back(std::move(tree));
+    trees->push_back(std::move(tree));
   }
 }
 
+void SetRegressiveLeaf(NodeWithChildren* node, const int value) {
+  node->mutable_node()->mutable_regressor()->set_top_value(value);
+}
+
+void BuildToyModelAndToyDataset(
+    model::gradient_boosted_trees::GradientBoostedTreesModel* model,
+    dataset::VerticalDataset* dataset) {
+  const auto dataspec = ToyDataspec();
+  dataset->set_data_spec(dataspec);
+  CHECK_OK(dataset->CreateColumnsFromDataspec());
+
+  CHECK_OK(dataset->AppendExampleWithStatus(
+      {{"label", "1"}, {"f1", "0"}, {"f2", "2"}}));
+
+  model->set_task(model::proto::Task::CLASSIFICATION);
+  model->set_label_col_idx(0);
+  model->set_data_spec(dataspec);
+  model->set_loss(Loss::BINOMIAL_LOG_LIKELIHOOD);
+  model->mutable_initial_predictions()->push_back(1.f);
+  *model->mutable_input_features() = {1, 2};
+  // Avoid an access to uninitialized memory when printing the model.
+  model->set_num_trees_per_iter(1);
+  BuildToyTrees(SetRegressiveLeaf, model->mutable_decision_trees());
+}
+
+// Examples of the toy model, and values of the leaves of the toy model
+// reached by each example.
+const std::vector<uint8_t> kToyExamples = {1, 0, 2, 0, 3, 0, 1, 1, 1, 2, 1, 3};
+const std::vector<std::pair<int, int>> kToyActiveLeaves = {
+    {4, 11}, {2, 11}, {1, 11}, {3, 11}, {3, 10}, {3, 10}};
+
 float logistic(const float value) {
   return utils::clamp(1.f / (1.f + std::exp(-value)), 0.f, 1.f);
 }
@@ -161,7 +193,7 @@ TEST(Num8Bits, ToyExample) {
 
   EXPECT_EQ(engine.num_trees, 2);
   EXPECT_EQ(engine.num_features, 2);
-  EXPECT_EQ(engine.initial_prediction, 1);
+  EXPECT_THAT(engine.initial_predictions, ElementsAre(1));
   // EXPECT_EQ(engine.masks.size(), 18); // V0
   // EXPECT_THAT(engine.masks_feature_index, ElementsAre(0, 10)); // V0
   EXPECT_THAT(engine.num_buckets, ElementsAre(5, 4));
@@ -178,6 +210,219 @@ TEST(Num8Bits, ToyExample) {
                           logistic(15), logistic(14), logistic(14)));
 }
 
+TEST(Num8Bits, ToyExampleGBTMulticlass) {
+  GradientBoostedTreesModel model;
+  dataset::VerticalDataset dataset;
+  BuildToyModelAndToyDataset(&model, &dataset);
+  // Each tree is dedicated to one of the two classes.
+  model.set_loss(Loss::MULTINOMIAL_LOG_LIKELIHOOD);
+  model.set_num_trees_per_iter(2);
+  *model.mutable_initial_predictions() = {1.f, -1.f};
+  auto dataspec = model.data_spec();
+  dataspec.mutable_columns(0)
+      ->mutable_categorical()
+      ->set_number_of_unique_values(3);
+  model.set_data_spec(dataspec);
+
+  GradientBoostedTreesMulticlassClassificationModel engine;
+  ASSERT_OK(GenericToSpecializedModel(model, &engine));
+  EXPECT_EQ(engine.num_outputs, 2);
+  EXPECT_EQ(engine.num_values_per_leaf, 1);
+
+  std::vector<float> predictions;
+  ASSERT_OK(Predict(engine, kToyExamples, /*num_examples=*/6, &predictions));
+  ASSERT_EQ(predictions.size(), 12);
+  for (int example_idx = 0; example_idx < 6; example_idx++) {
+    const float logit_0 = 1.f + kToyActiveLeaves[example_idx].first;
+    const float logit_1 = -1.f + kToyActiveLeaves[example_idx].second;
+    const float proba_0 =
+        std::exp(logit_0) / (std::exp(logit_0) + std::exp(logit_1));
+    EXPECT_NEAR(predictions[example_idx * 2 + 0], proba_0, 0.0001f);
+    EXPECT_NEAR(predictions[example_idx * 2 + 1], 1.f - proba_0, 0.0001f);
+  }
+
+  // The binary classification engine is not compatible.
+  GradientBoostedTreesBinaryClassificationModel binary_engine;
+  EXPECT_FALSE(GenericToSpecializedModel(model, &binary_engine).ok());
+}
+
+TEST(Num8Bits, ToyExampleRFRegression) {
+  RandomForestModel model;
+  model.set_task(model::proto::Task::REGRESSION);
+  model.set_label_col_idx(0);
+  model.set_data_spec(ToyDataspec());
+  *model.mutable_input_features() = {1, 2};
+  BuildToyTrees(SetRegressiveLeaf, model.mutable_decision_trees());
+  ASSERT_OK(CheckCompatibility(model));
+
+  RandomForestRegressionModel engine;
+  ASSERT_OK(GenericToSpecializedModel(model, &engine));
+
+  std::vector<float> predictions;
+  ASSERT_OK(Predict(engine, kToyExamples, /*num_examples=*/6, &predictions));
+  ASSERT_EQ(predictions.size(), 6);
+  for (int example_idx = 0; example_idx < 6; example_idx++) {
+    EXPECT_NEAR(predictions[example_idx],
+                (kToyActiveLeaves[example_idx].first +
+                 kToyActiveLeaves[example_idx].second) /
+                    2.f,
+                0.0001f);
+  }
+}
+
+TEST(Num8Bits, ToyExampleRFClassification) {
+  // The leaf "v" contains the class distribution [v, 1, 2].
+  const auto set_leaf = [](NodeWithChildren* node, const int value) {
+    auto* classifier = node->mutable_node()->mutable_classifier();
+    classifier->set_top_value(value > 2 ? 1 : 3);
+    auto* distribution = classifier->mutable_distribution();
+    distribution->add_counts(0);
+    distribution->add_counts(value);
+    distribution->add_counts(1);
+    distribution->add_counts(2);
+    distribution->set_sum(value + 3);
+  };
+  auto dataspec = ToyDataspec();
+  dataspec.mutable_columns(0)
+      ->mutable_categorical()
+      ->set_number_of_unique_values(4);
+
+  RandomForestModel model;
+  model.set_task(model::proto::Task::CLASSIFICATION);
+  model.set_label_col_idx(0);
+  model.set_data_spec(dataspec);
+  *model.mutable_input_features() = {1, 2};
+  BuildToyTrees(set_leaf, model.mutable_decision_trees());
+
+  // Probability of the class "class_idx" in the leaf "value".
+  const auto leaf_proba = [](const int value, const int class_idx) {
+    const float counts[] = {static_cast<float>(value), 1.f, 2.f};
+    return counts[class_idx] / (value + 3);
+  };
+
+  {
+    model.set_winner_take_all_inference(false);
+    RandomForestMulticlassClassificationModel engine;
+    ASSERT_OK(GenericToSpecializedModel(model, &engine));
+    EXPECT_EQ(engine.num_outputs, 3);
+    EXPECT_EQ(engine.num_values_per_leaf, 3);
+
+    std::vector<float> predictions;
+    ASSERT_OK(Predict(engine, kToyExamples, /*num_examples=*/6, &predictions));
+    ASSERT_EQ(predictions.size(), 18);
+    for (int example_idx = 0; example_idx < 6; example_idx++) {
+      for (int class_idx = 0; class_idx < 3; class_idx++) {
+        EXPECT_NEAR(
+            predictions[example_idx * 3 + class_idx],
+            (leaf_proba(kToyActiveLeaves[example_idx].first, class_idx) +
+             leaf_proba(kToyActiveLeaves[example_idx].second, class_idx)) /
+                2,
+            0.0001f);
+      }
+    }
+  }
+
+  {
+    model.set_winner_take_all_inference(true);
+    RandomForestMulticlassClassificationModel engine;
+    ASSERT_OK(GenericToSpecializedModel(model, &engine));
+
+    std::vector<float> predictions;
+    ASSERT_OK(Predict(engine, kToyExamples, /*num_examples=*/6, &predictions));
+    // The leaves 1 and 2 vote for the class 3. The other leaves vote for the
+    // class 1.
+    EXPECT_THAT(predictions,
+                ElementsAre(1, 0, 0, 0.5, 0, 0.5, 0.5, 0, 0.5, 1, 0, 0, 1, 0,
+                            0, 1, 0, 0));
+  }
+
+  // The binary classification engine is not compatible.
+  RandomForestBinaryClassificationModel binary_engine;
+  EXPECT_FALSE(GenericToSpecializedModel(model, &binary_engine).ok());
+}
+
+TEST(Num8Bits, ExampleSetToBuckets) {
+  GradientBoostedTreesModel model;
+  dataset::VerticalDataset dataset;
+  BuildToyModelAndToyDataset(&model, &dataset);
+  FastEngineModel<GradientBoostedTreesBinaryClassificationModel> engine;
+  ASSERT_OK(GenericToSpecializedModel(model, &engine));
+  EXPECT_EQ(engine.num_classes, 1);
+
+  const std::vector<float> values = {-1.f, 0.4f, 1.f, 1.6f, 4.f, 10.f};
+  decltype(engine)::ExampleSet examples(values.size(), engine);
+  ASSERT_OK_AND_ASSIGN(const auto f1,
+                       engine.features().GetNumericalFeatureId("f1"));
+  ASSERT_OK_AND_ASSIGN(const auto f2,
+                       engine.features().GetNumericalFeatureId("f2"));
+  for (int example_idx = 0; example_idx < values.size(); example_idx++) {
+    examples.SetNumerical(example_idx, f1, values[example_idx], engine);
+    examples.SetNumerical(example_idx, f2, values[example_idx], engine);
+  }
+  examples.SetMissingNumerical(0, f2, engine);
+
+  std::vector<uint8_t> buckets;
+  ExampleSetToBuckets(engine.model,
+                      examples.InternalCategoricalAndNumericalValues(),
+                      values.size(), &buckets);
+  EXPECT_THAT(buckets, ElementsAre(0, 0, 0, 0, 1, 1, 2, 2, 4, 3, 4, 3));
+
+  // Same predictions as with the bucket indices.
+  std::vector<float> predictions;
+  Predict(engine, examples, values.size(), &predictions);
+  std::vector<float> expected_predictions;
+  ASSERT_OK(Predict(engine.model, buckets, values.size(),
+                    &expected_predictions));
+  EXPECT_EQ(predictions, expected_predictions);
+}
+
+// Missing values are replaced by the feature mean. The engine is only selected
+// for models trained with global imputation, and then returns the same
+// predictions as the generic inference.
+TEST(Num8Bits, MissingValuesSameAsGenericInference) {
+  for (const bool root_na_value : {false, true}) {
+    SCOPED_TRACE(absl::StrCat("root_na_value:", root_na_value));
+    GradientBoostedTreesModel model;
+    dataset::VerticalDataset dataset;
+    BuildToyModelAndToyDataset(&model, &dataset);
+    // The root condition is "f1" >= 1.5, and the mean of "f1" is 0. Only
+    // "na_value=false" follows the global imputation.
+    model.mutable_decision_trees()
+        ->front()
+        ->mutable_root()
+        ->mutable_node()
+        ->mutable_condition()
+        ->set_na_value(root_na_value);
+    ASSERT_OK(dataset.AppendExampleWithStatus({{"label", "1"}, {"f2", "2"}}));
+    ASSERT_OK(dataset.AppendExampleWithStatus({{"label", "1"}, {"f1", "3"}}));
+    ASSERT_OK(dataset.AppendExampleWithStatus({{"label", "1"}}));
+
+    bool num_8bits_is_compatible = false;
+    for (const auto& factory : model.ListCompatibleFastEngines()) {
+      num_8bits_is_compatible |=
+          factory->name() == gradient_boosted_trees::kNum8Bits;
+    }
+    EXPECT_EQ(num_8bits_is_compatible, !root_na_value);
+
+    ASSERT_OK_AND_ASSIGN(const auto engine, model.BuildFastEngine());
+    auto examples = engine->AllocateExamples(dataset.nrow());
+    ASSERT_OK(CopyVerticalDatasetToAbstractExampleSet(
+        dataset, 0, dataset.nrow(), engine->features(), examples.get()));
+    std::vector<float> predictions;
+    engine->Predict(*examples, dataset.nrow(), &predictions);
+    ASSERT_EQ(predictions.size(), dataset.nrow());
+
+    for (int example_idx = 0; example_idx < dataset.nrow(); example_idx++) {
+      model::proto::Prediction prediction;
+      model.Predict(dataset, example_idx, &prediction);
+      EXPECT_NEAR(predictions[example_idx],
+                  prediction.classification().distribution().counts(2) /
+                      prediction.classification().distribution().sum(),
+                  0.0001f);
+    }
+  }
+}
+
 TEST(Num8Bits, CompareToSlowEngine) {
   const std::string model_dir = file::JoinPath(
       TestDataDir(), "model", "8bits_numerical_binary_class_gbdt");
@@ -15,12 +15,28 @@
 
 #include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
 
+#include <stddef.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/serving/example_set.h"
 #include "yggdrasil_decision_forests/utils/bitmap.h"
 #include "yggdrasil_decision_forests/utils/compatibility.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
 #include "yggdrasil_decision_forests/utils/status_macros.h"
 
@@ -38,6 +54,15 @@ using ConditionType = model::decision_tree::proto::Condition::TypeCase;
 
 namespace {
 
+// Number of examples converted into an example set at once by
+// "PredictLeaves".
+constexpr size_t kLeafIndexBatchSize = 1024;
+
+// Size of the top of the trees (i.e. the part visited by most of the examples)
+// packed by the "kBreadthFirst" and "kVisitFrequency" layouts. Packing larger
+// parts of the trees breaks the locality of the small sub-trees.
+constexpr size_t kTopOfTreeBytes = 1024;
+
 // Tests if a model is compatible with binary classification engines.
 bool IsBinaryClassification(const GradientBoostedTreesModel& model) {
   return (model.loss() == Loss::BINOMIAL_LOG_LIKELIHOOD ||
@@ -593,6 +618,24 @@ absl::Status SetLeafGradientBoostedTreesRanking(
   return SetRegressiveLeaf(src_model, src_node, 1.f, dst_node);
 }
 
+// Set the leaf of a leaf index model.
+template <typename GenericModel, typename SpecializedModel>
+absl::Status SetLeafIndex(const GenericModel& src_model,
+                          const NodeWithChildren& src_node,
+                          SpecializedModel* dst_model,
+                          typename SpecializedModel::NodeType* dst_node) {
+  using Node = typename SpecializedModel::NodeType;
+  if (src_node.leaf_idx() < 0) {
+    return absl::InvalidArgumentError("Leaf idx not set");
+  }
+  *dst_node = Node::LeafIndex(
+      /*.right_idx =*/0,
+      /*.feature_idx =*/0,
+      /*.type =*/Node::Type::kLeaf,
+      /*.leaf_idx =*/static_cast<uint32_t>(src_node.leaf_idx()));
+  return absl::OkStatus();
+}
+
 // Recursively explore the children of a node and output the result in the flat
 // node array "specialized_node_array".
 //
@@ -642,20 +685,122 @@ absl::Status ConvertGenericNodeToFlatNode(
   return absl::OkStatus();
 }
 
+// Converts a tree into flat nodes with the "kBreadthFirst" or
+// "kVisitFrequency" layout. The top of the tree is made of negative chains
+// placed one after the other: The next chain to be placed is the pending chain
+// with the highest priority, and the oldest one in case of ties. With the
+// "kBreadthFirst" layout, all the chains have the same priority. With the
+// "kVisitFrequency" layout, the priority is the number of training examples
+// reaching the chain. Once the top of the tree contains "kTopOfTreeBytes"
+// bytes, the remaining pending chains are converted, in the same order, as
+// depth-first sub-trees.
+//
+// Arguments: See "ConvertGenericNodeToFlatNode".
+template <typename GenericModel, typename SpecializedModel>
+absl::Status ConvertGenericTreeToFlatNodeChains(
+    const GenericModel& src_model, const NodeWithChildren& root,
+    const NodeLayout node_layout,
+    const SetLeafFunctor<GenericModel, SpecializedModel> set_node,
+    SpecializedModel* dst_model,
+    std::vector<typename SpecializedModel::NodeType>* specialized_node_array) {
+  // A chain whose nodes are not yet created.
+  struct PendingChain {
+    // First node of the chain.
+    const NodeWithChildren* head;
+    // Index, in "specialized_node_array", of the node whose positive child is
+    // "head". -1 for the root of the tree.
+    int64_t parent_idx;
+    // Chains with a higher priority are placed first.
+    int64_t priority;
+    // Index of creation of the pending chain.
+    int64_t sequence;
+  };
+  const auto lower_priority = [](const PendingChain& a, const PendingChain& b) {
+    if (a.priority != b.priority) {
+      return a.priority < b.priority;
+    }
+    return a.sequence > b.sequence;
+  };
+  std::priority_queue<PendingChain, std::vector<PendingChain>,
+                      decltype(lower_priority)>
+      pending_chains(lower_priority);
+
+  const size_t begin_node_idx = specialized_node_array->size();
+  const size_t max_top_nodes =
+      kTopOfTreeBytes / sizeof(typename SpecializedModel::NodeType);
+  int64_t num_chains = 0;
+  pending_chains.push({&root, -1, 0, num_chains++});
+  while (!pending_chains.empty()) {
+    const PendingChain chain = pending_chains.top();
+    pending_chains.pop();
+
+    if (chain.parent_idx >= 0) {
+      const int64_t node_offset =
+          specialized_node_array->size() - chain.parent_idx;
+      if (node_offset >=
+          std::numeric_limits<
+              typename SpecializedModel::NodeType::NodeOffset>::max()) {
+        return absl::InvalidArgumentError(
+            "Tree with too many nodes for this optimized model format.");
+      }
+      (*specialized_node_array)[chain.parent_idx].right_idx = node_offset;
+    }
+
+    if (specialized_node_array->size() - begin_node_idx >= max_top_nodes) {
+      RETURN_IF_ERROR(ConvertGenericNodeToFlatNode(src_model, *chain.head,
+                                                   set_node, dst_model,
+                                                   specialized_node_array));
+      continue;
+    }
+
+    const NodeWithChildren* node = chain.head;
+    while (!node->IsLeaf()) {
+      const int spec_feature_idx = node->node().condition().attribute();
+      typename SpecializedModel::NodeType non_leaf_node;
+      RETURN_IF_ERROR(SetNonLeafNode(src_model, *node, spec_feature_idx,
+                                     dst_model, &non_leaf_node));
+      const int64_t node_idx = specialized_node_array->size();
+      specialized_node_array->push_back(non_leaf_node);
+
+      int64_t priority = 0;
+      if (node_layout == NodeLayout::kVisitFrequency) {
+        priority = node->node()
+                       .condition()
+                       .num_pos_training_examples_without_weight();
+      }
+      pending_chains.push(
+          {node->pos_child(), node_idx, priority, num_chains++});
+      node = node->neg_child();
+    }
+
+    typename SpecializedModel::NodeType leaf_node;
+    RETURN_IF_ERROR(set_node(src_model, *node, dst_model, &leaf_node));
+    specialized_node_array->push_back(leaf_node);
+  }
+  return absl::OkStatus();
+}
+
 // Creates the nodes of a flat model.
 template <typename GenericModel, typename SpecializedModel>
 absl::Status CreateFlatModelNodes(
     const GenericModel& src_model,
     SetLeafFunctor<GenericModel, SpecializedModel> set_node,
     SpecializedModel* dst_model) {
+  const NodeLayout node_layout = dst_model->node_layout;
   dst_model->nodes.clear();
   dst_model->nodes.reserve(src_model.NumNodes());
   dst_model->root_offsets.clear();
   dst_model->root_offsets.reserve(src_model.NumTrees());
   for (const auto& tree : src_model.decision_trees()) {
     dst_model->root_offsets.push_back(dst_model->nodes.size());
-    RETURN_IF_ERROR(ConvertGenericNodeToFlatNode(
-        src_model, tree->root(), set_node, dst_model, &dst_model->nodes));
+    if (node_layout == NodeLayout::kDepthFirst) {
+      RETURN_IF_ERROR(ConvertGenericNodeToFlatNode(
+          src_model, tree->root(), set_node, dst_model, &dst_model->nodes));
+    } else {
+      RETURN_IF_ERROR(ConvertGenericTreeToFlatNodeChains(
+          src_model, tree->root(), node_layout, set_node, dst_model,
+          &dst_model->nodes));
+    }
   }
   YDF_LOG(INFO) << "Model loaded with " << dst_model->root_offsets.size()
                 << " root(s), " << dst_model->nodes.size() << " node(s), and "
@@ -684,6 +829,28 @@ absl::Status GenericToSpecializedModelHelper(
   return CreateFlatModelNodes(src_model, set_node, dst_model);
 }
 
+// Tests if most of the conditions of a model of generic nodes are numerical or
+// categorical mask conditions i.e. conditions evaluated with SIMD instructions
+// by the batched traversal.
+template <typename SpecializedModel>
+bool UseBatchedTraversal(const SpecializedModel& model) {
+  using Type = typename SpecializedModel::NodeType::Type;
+  int64_t num_conditions = 0;
+  int64_t num_simd_conditions = 0;
+  for (const auto& node : model.nodes) {
+    if (!node.right_idx) {
+      continue;
+    }
+    num_conditions++;
+    if (node.type == Type::kNumericalIsHigherMissingIsFalse ||
+        node.type == Type::kNumericalIsHigherMissingIsTrue ||
+        node.type == Type::kCategoricalContainsMask) {
+      num_simd_conditions++;
+    }
+  }
+  return 2 * num_simd_conditions >= num_conditions;
+}
+
 // A version of "GenericToSpecializedModelHelper" to handle generic engines,
 // that is, the most engines with the greatest coverage.
 template <typename SetLeaf, typename GenericModel, typename SpecializedModel>
@@ -693,9 +860,31 @@ absl::Status GenericToSpecializedGenericModelHelper(
   dst->global_imputation_optimization =
       src.CheckStructure({/*.global_imputation_is_higher =*/true});
 
-  return GenericToSpecializedModelHelper(
+  RETURN_IF_ERROR(GenericToSpecializedModelHelper(
       src, SetLeafFunctor<GenericModel, SpecializedModel>(set_leaf), dst,
-      dst->global_imputation_optimization);
+      dst->global_imputation_optimization));
+  dst->batched_traversal = UseBatchedTraversal(*dst);
+  return absl::OkStatus();
+}
+
+// Version of "GenericToSpecializedGenericModelHelper" for the leaf index
+// models. Leaf index models are independent of the task.
+template <typename GenericModel, typename SpecializedModel>
+absl::Status GenericToSpecializedLeafIndexModelHelper(const GenericModel& src,
+                                                      SpecializedModel* dst) {
+  dst->global_imputation_optimization =
+      src.CheckStructure({/*.global_imputation_is_higher =*/true});
+  src.metadata().Export(&dst->metadata);
+  RETURN_IF_ERROR(InitializeFlatNodeModel(
+      src, dst,
+      /*missing_numerical_is_na=*/!dst->global_imputation_optimization));
+  RETURN_IF_ERROR(CreateFlatModelNodes(
+      src,
+      SetLeafFunctor<GenericModel, SpecializedModel>(
+          SetLeafIndex<GenericModel, SpecializedModel>),
+      dst));
+  dst->batched_traversal = UseBatchedTraversal(*dst);
+  return absl::OkStatus();
 }
 
 // Checks that a model is a binary classifier.
@@ -1057,6 +1246,354 @@ absl::Status GenericToSpecializedModel(const GradientBoostedTreesModel& src,
       SetLeafGradientBoostedTreesRegression<DstType>, src, dst);
 }
 
+template <>
+absl::Status GenericToSpecializedModel(const RandomForestModel& src,
+                                       DecisionForestLeafIndex* dst) {
+  return GenericToSpecializedLeafIndexModelHelper(src, dst);
+}
+
+template <>
+absl::Status GenericToSpecializedModel(
+    const RandomForestModel& src,
+    GenericDecisionForestLeafIndex<uint32_t>* dst) {
+  return GenericToSpecializedLeafIndexModelHelper(src, dst);
+}
+
+template <>
+absl::Status GenericToSpecializedModel(const GradientBoostedTreesModel& src,
+                                       DecisionForestLeafIndex* dst) {
+  return GenericToSpecializedLeafIndexModelHelper(src, dst);
+}
+
+template <>
+absl::Status GenericToSpecializedModel(
+    const GradientBoostedTreesModel& src,
+    GenericDecisionForestLeafIndex<uint32_t>* dst) {
+  return GenericToSpecializedLeafIndexModelHelper(src, dst);
+}
+
+template <typename Model>
+absl::Status PredictLeaves(const Model& model,
+                           const dataset::VerticalDataset& dataset,
+                           const int num_threads, absl::Span<int32_t> leaves) {
+  const size_t num_trees = model.root_offset_array().size();
+  const VerticalDataset::row_t num_examples = dataset.nrow();
+  if (leaves.size() != num_examples * num_trees) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "\"leaves\" should contain ", num_examples * num_trees, " values"));
+  }
+  if (num_examples == 0) {
+    return absl::OkStatus();
+  }
+
+  // Each block is split into batches of "kLeafIndexBatchSize" examples
+  // converted into an example set one at a time.
+  const int num_blocks = std::max<int64_t>(
+      1, std::min<int64_t>(num_threads,
+                           (num_examples + kLeafIndexBatchSize - 1) /
+                               kLeafIndexBatchSize));
+  std::vector<absl::Status> block_status(num_blocks);
+
+  const auto process_block = [&](const size_t block_idx,
+                                 const size_t begin_example_idx,
+                                 const size_t end_example_idx) {
+    typename Model::ExampleSet examples(kLeafIndexBatchSize, model);
+    for (size_t begin_batch_idx = begin_example_idx;
+         begin_batch_idx < end_example_idx;
+         begin_batch_idx += kLeafIndexBatchSize) {
+      const size_t end_batch_idx =
+          std::min(begin_batch_idx + kLeafIndexBatchSize, end_example_idx);
+      examples.Clear();
+      auto status = CopyVerticalDatasetToAbstractExampleSet(
+          dataset, begin_batch_idx, end_batch_idx, model.features(),
+          &examples);
+      if (!status.ok()) {
+        block_status[block_idx] = status;
+        return;
+      }
+      PredictLeaves(model, examples, end_batch_idx - begin_batch_idx,
+                    leaves.subspan(begin_batch_idx * num_trees,
+                                   (end_batch_idx - begin_batch_idx) *
+                                       num_trees));
+    }
+  };
+
+  if (num_blocks == 1) {
+    process_block(0, 0, num_examples);
+  } else {
+    utils::concurrency::ThreadPool pool("PredictLeaves", num_blocks);
+    pool.StartWorkers();
+    utils::concurrency::ConcurrentForLoop(num_blocks, &pool, num_examples,
+                                          process_block);
+  }
+  for (const auto& status : block_status) {
+    RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+template absl::Status PredictLeaves(const DecisionForestLeafIndex& model,
+                                    const dataset::VerticalDataset& dataset,
+                                    int num_threads,
+                                    absl::Span<int32_t> leaves);
+
+template absl::Status PredictLeaves(
+    const GenericDecisionForestLeafIndex<uint32_t>& model,
+    const dataset::VerticalDataset& dataset, int num_threads,
+    absl::Span<int32_t> leaves);
+
+absl::StatusOr<std::unique_ptr<LeafIndexEngine>> LeafIndexEngine::Create(
+    const model::AbstractModel& model) {
+  const auto* rf_model = dynamic_cast<const RandomForestModel*>(&model);
+  const auto* gbt_model =
+      dynamic_cast<const GradientBoostedTreesModel*>(&model);
+  if (!rf_model && !gbt_model) {
+    return absl::InvalidArgumentError(
+        "The model is not a Random Forest or a Gradient Boosted Trees model");
+  }
+  // Like the generic engines, the flat models impute the missing categorical
+  // and boolean values globally.
+  const bool global_imputation =
+      rf_model ? rf_model->CheckStructure(
+                     {/*.global_imputation_is_higher =*/false})
+               : gbt_model->CheckStructure(
+                     {/*.global_imputation_is_higher =*/false});
+  if (!global_imputation) {
+    return absl::FailedPreconditionError(
+        "The leaf index engine only supports models trained with "
+        "missing_value_policy=GLOBAL_IMPUTATION.");
+  }
+
+  int64_t max_num_nodes = 0;
+  const auto& trees = rf_model ? rf_model->decision_trees()
+                               : gbt_model->decision_trees();
+  for (const auto& tree : trees) {
+    max_num_nodes = std::max(max_num_nodes, tree->NumNodes());
+  }
+
+  auto engine = absl::WrapUnique(new LeafIndexEngine());
+  if (max_num_nodes < std::numeric_limits<uint16_t>::max()) {
+    engine->model_ = std::make_unique<DecisionForestLeafIndex>();
+    if (rf_model) {
+      RETURN_IF_ERROR(
+          GenericToSpecializedModel(*rf_model, engine->model_.get()));
+    } else {
+      RETURN_IF_ERROR(
+          GenericToSpecializedModel(*gbt_model, engine->model_.get()));
+    }
+  } else {
+    engine->model_many_nodes_ =
+        std::make_unique<GenericDecisionForestLeafIndex<uint32_t>>();
+    if (rf_model) {
+      RETURN_IF_ERROR(GenericToSpecializedModel(
+          *rf_model, engine->model_many_nodes_.get()));
+    } else {
+      RETURN_IF_ERROR(GenericToSpecializedModel(
+          *gbt_model, engine->model_many_nodes_.get()));
+    }
+  }
+  return engine;
+}
+
+int LeafIndexEngine::num_trees() const {
+  return model_ ? model_->root_offsets.size()
+                : model_many_nodes_->root_offsets.size();
+}
+
+absl::Status LeafIndexEngine::PredictLeaves(
+    const dataset::VerticalDataset& dataset, const int num_threads,
+    absl::Span<int32_t> leaves) const {
+  if (model_) {
+    return decision_forest::PredictLeaves(*model_, dataset, num_threads,
+                                          leaves);
+  }
+  return decision_forest::PredictLeaves(*model_many_nodes_, dataset,
+                                        num_threads, leaves);
+}
+
+namespace {
+
+// Replaces the leaf values of a model with the deduplicated quantized values
+// "quantize(label_buffer)". Returns the new label buffer.
+template <typename Model, typename QuantizedValue, typename Quantize>
+std::vector<QuantizedValue> DeduplicateQuantizedLeafOutputs(Model* model,
+                                                            Quantize quantize) {
+  const int num_outputs = model->num_classes;
+  std::vector<QuantizedValue> buffer;
+  absl::flat_hash_map<std::vector<QuantizedValue>, uint32_t> leaf_value_offsets;
+  std::vector<QuantizedValue> leaf_values(num_outputs);
+  for (auto& node : model->nodes) {
+    if (node.right_idx) {
+      continue;
+    }
+    for (int output_idx = 0; output_idx < num_outputs; output_idx++) {
+      leaf_values[output_idx] =
+          quantize(model->label_buffer[node.label_buffer_offset + output_idx]);
+    }
+    const auto it_and_inserted =
+        leaf_value_offsets.try_emplace(leaf_values, buffer.size());
+    if (it_and_inserted.second) {
+      buffer.insert(buffer.end(), leaf_values.begin(), leaf_values.end());
+    }
+    node.label_buffer_offset = it_and_inserted.first->second;
+  }
+  return buffer;
+}
+
+}  // namespace
+
+template <typename Model>
+absl::Status CompressLeafOutputs(const LeafOutputQuantization quantization,
+                                 Model* model) {
+  if (model->external_arrays) {
+    return absl::InvalidArgumentError(
+        "The leaf values of a model with external arrays cannot be "
+        "compressed.");
+  }
+  if (model->label_buffer_quantization != LeafOutputQuantization::kFloat32 ||
+      !model->label_buffer_float16.empty() ||
+      !model->label_buffer_int8.empty()) {
+    return absl::InvalidArgumentError("The leaf values are already quantized.");
+  }
+  float max_abs_value = 0.f;
+  for (const float value : model->label_buffer) {
+    max_abs_value = std::max(max_abs_value, std::abs(value));
+  }
+  const size_t num_values = model->label_buffer.size();
+
+  switch (quantization) {
+    case LeafOutputQuantization::kFloat32:
+      model->label_buffer = DeduplicateQuantizedLeafOutputs<Model, float>(
+          model, [](const float value) { return value; });
+      break;
+
+    case LeafOutputQuantization::kFloat16:
+      if (!(max_abs_value <= 65504.f)) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "The leaf values cannot be represented with half precision "
+            "floats. Largest absolute leaf value: ",
+            max_abs_value));
+      }
+      model->label_buffer_float16 =
+          DeduplicateQuantizedLeafOutputs<Model, uint16_t>(
+              model, [](const float value) { return FloatToFloat16(value); });
+      model->label_buffer.clear();
+      model->label_buffer.shrink_to_fit();
+      break;
+
+    case LeafOutputQuantization::kInt8: {
+      const float scale = max_abs_value > 0.f ? max_abs_value / 127.f : 1.f;
+      model->label_buffer_int8 = DeduplicateQuantizedLeafOutputs<Model, int8_t>(
+          model, [scale](const float value) {
+            return static_cast<int8_t>(
+                std::clamp(std::round(value / scale), -127.f, 127.f));
+          });
+      model->label_buffer_int8_scale = scale;
+      model->label_buffer.clear();
+      model->label_buffer.shrink_to_fit();
+    } break;
+  }
+  model->label_buffer_quantization = quantization;
+
+  const size_t num_compressed_values =
+      model->label_buffer.size() + model->label_buffer_float16.size() +
+      model->label_buffer_int8.size();
+  YDF_LOG(INFO) << "Leaf values compressed from " << num_values << " to "
+                << num_compressed_values << " value(s)";
+  return absl::OkStatus();
+}
+
+template <typename Model>
+absl::StatusOr<PredictionDifference> ComparePredictions(
+    const Model& reference_model, const Model& model,
+    const dataset::VerticalDataset& dataset) {
+  ASSIGN_OR_RETURN(const auto examples,
+                   VerticalDatasetToExampleSet(dataset, reference_model));
+  const int num_examples = dataset.nrow();
+  std::vector<float> reference_predictions;
+  std::vector<float> predictions;
+  Predict(reference_model, examples, num_examples, &reference_predictions);
+  Predict(model, examples, num_examples, &predictions);
+  if (reference_predictions.size() != predictions.size()) {
+    return absl::InvalidArgumentError(
+        "The models have different output dimensions.");
+  }
+
+  PredictionDifference difference;
+  difference.num_examples = num_examples;
+  if (num_examples == 0) {
+    return difference;
+  }
+  const int num_dims = predictions.size() / num_examples;
+  double sum_abs_diff = 0;
+  int64_t num_argmax_disagreements = 0;
+  for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+    const auto* reference_values =
+        &reference_predictions[example_idx * num_dims];
+    const auto* values = &predictions[example_idx * num_dims];
+    for (int dim_idx = 0; dim_idx < num_dims; dim_idx++) {
+      const double abs_diff =
+          std::abs(reference_values[dim_idx] - values[dim_idx]);
+      difference.max_abs_diff = std::max(difference.max_abs_diff, abs_diff);
+      sum_abs_diff += abs_diff;
+    }
+    if (num_dims > 1 &&
+        std::max_element(reference_values, reference_values + num_dims) -
+                reference_values !=
+            std::max_element(values, values + num_dims) - values) {
+      num_argmax_disagreements++;
+    }
+  }
+  difference.mean_abs_diff = sum_abs_diff / predictions.size();
+  difference.argmax_disagreement_ratio =
+      static_cast<double>(num_argmax_disagreements) / num_examples;
+  return difference;
+}
+
+template absl::Status CompressLeafOutputs(
+    LeafOutputQuantization quantization,
+    GenericRandomForestMulticlassClassification<uint16_t>* model);
+template absl::Status CompressLeafOutputs(
+    LeafOutputQuantization quantization,
+    GenericRandomForestMulticlassClassification<uint32_t>* model);
+template absl::Status CompressLeafOutputs(
+    LeafOutputQuantization quantization,
+    GenericRandomForestCategoricalUplift<uint16_t>* model);
+template absl::Status CompressLeafOutputs(
+    LeafOutputQuantization quantization,
+    GenericRandomForestCategoricalUplift<uint32_t>* model);
+
+template absl::StatusOr<PredictionDifference> ComparePredictions(
+    const GenericRandomForestMulticlassClassification<uint16_t>&
+        reference_model,
+    const GenericRandomForestMulticlassClassification<uint16_t>& model,
+    const dataset::VerticalDataset& dataset);
+template absl::StatusOr<PredictionDifference> ComparePredictions(
+    const GenericRandomForestMulticlassClassification<uint32_t>&
+        reference_model,
+    const GenericRandomForestMulticlassClassification<uint32_t>& model,
+    const dataset::VerticalDataset& dataset);
+template absl::StatusOr<PredictionDifference> ComparePredictions(
+    const GenericRandomForestCategoricalUplift<uint16_t>& reference_model,
+    const GenericRandomForestCategoricalUplift<uint16_t>& model,
+    const dataset::VerticalDataset& dataset);
+template absl::StatusOr<PredictionDifference> ComparePredictions(
+    const GenericRandomForestCategoricalUplift<uint32_t>& reference_model,
+    const GenericRandomForestCategoricalUplift<uint32_t>& model,
+    const dataset::VerticalDataset& dataset);
+
+std::string NodeLayoutName(const NodeLayout node_layout) {
+  switch (node_layout) {
+    case NodeLayout::kDepthFirst:
+      return "DEPTH_FIRST";
+    case NodeLayout::kBreadthFirst:
+      return "BREADTH_FIRST";
+    case NodeLayout::kVisitFrequency:
+      return "VISIT_FREQUENCY";
+  }
+  return "UNKNOWN";
+}
+
 template <typename Value>
 absl::Status LoadFlatBatchFromDataset(
     const VerticalDataset& dataset, VerticalDataset::row_t begin_example_idx,
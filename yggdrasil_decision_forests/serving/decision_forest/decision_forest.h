@@ -47,7 +47,17 @@
 #ifndef YGGDRASIL_DECISION_FORESTS_SERVING_DECISION_FOREST_H_
 #define YGGDRASIL_DECISION_FORESTS_SERVING_DECISION_FOREST_H_
 
+#include <stddef.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
 #include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
 #include "yggdrasil_decision_forests/serving/decision_forest/decision_forest_serving.h"
@@ -109,6 +119,108 @@ absl::Status GenericToSpecializedModel(
     const model::gradient_boosted_trees::GradientBoostedTreesModel& src,
     GradientBoostedTreesRankingNumericalAndCategorical* dst);
 
+// Human readable name of a node layout e.g. "BREADTH_FIRST".
+std::string NodeLayoutName(NodeLayout node_layout);
+
+// Compresses the multi-dimensional leaf outputs (i.e. "label_buffer") of a
+// compiled model: The leaf values are quantized (see "LeafOutputQuantization"),
+// and the leaves with identical (quantized) values share the same values. With
+// "kFloat32", only the deduplication is applied and the predictions are not
+// changed. Random Forest leaves contain many duplicates (e.g. with
+// winner-take-all inference, there are only "num_classes" distinct leaf
+// values).
+//
+// Use "ComparePredictions" to measure the impact of the quantization on the
+// predictions, and "ModelSizeInBytes" to measure the memory saving. The
+// engines created with "EngineOptions::leaf_output_quantization" (see
+// register_engines.h) are compressed and checked this way.
+//
+// Only for models with multi-dimensional leaves i.e. Random Forest multi-class
+// classification and categorical uplift. Fails if the leaf values are already
+// quantized, or if the model does not own its arrays (e.g. a memory mapped
+// serving snapshot).
+template <typename Model>
+absl::Status CompressLeafOutputs(LeafOutputQuantization quantization,
+                                 Model* model);
+
+// Difference between the predictions of two versions of the same model e.g.
+// before and after "CompressLeafOutputs".
+struct PredictionDifference {
+  int64_t num_examples = 0;
+  // Maximum and mean absolute difference between two prediction values.
+  double max_abs_diff = 0;
+  double mean_abs_diff = 0;
+  // Ratio of examples where the largest prediction value is not on the same
+  // dimension (e.g. the predicted class differ). Only computed for models with
+  // multi-dimensional predictions.
+  double argmax_disagreement_ratio = 0;
+};
+
+// Computes the difference between the predictions of two versions of the same
+// model on a dataset.
+template <typename Model>
+absl::StatusOr<PredictionDifference> ComparePredictions(
+    const Model& reference_model, const Model& model,
+    const dataset::VerticalDataset& dataset);
+
+// Memory used by the nodes and the buffers of a flat node model, including
+// the external arrays (e.g. the memory mapped file of a serving snapshot).
+template <typename Model>
+size_t ModelSizeInBytes(const Model& model) {
+  return model.node_array().size() * sizeof(typename Model::NodeType) +
+         model.root_offset_array().size() * sizeof(int32_t) +
+         model.label_buffer_array().size() * sizeof(float) +
+         model.label_buffer_float16_array().size() * sizeof(uint16_t) +
+         model.label_buffer_int8_array().size() * sizeof(int8_t) +
+         model.categorical_mask_buffer.size() / 8 +
+         model.oblique_weight_array().size() * sizeof(float) +
+         model.oblique_internal_feature_idx_array().size() *
+             sizeof(typename Model::NodeType::FeatureIdx);
+}
+
+// Computes the index of the active leaf of each tree for all the examples of
+// "dataset" with a leaf index model (see "GenericDecisionForestLeafIndex").
+// "leaves" follows the same layout as the batch version of "PredictLeaves".
+//
+// The dataset is split into "num_threads" blocks processed in parallel. Each
+// block is converted into example sets one batch at a time, so the memory
+// usage does not depend on the size of the dataset.
+template <typename Model>
+absl::Status PredictLeaves(const Model& model,
+                           const dataset::VerticalDataset& dataset,
+                           int num_threads, absl::Span<int32_t> leaves);
+
+// Leaf index model of a Random Forest or Gradient Boosted Trees model. Uses
+// 32-bits node offsets only if a tree contains more than 65k nodes. Missing
+// values are imputed globally: "Create" returns a FailedPrecondition error for
+// models trained with another missing value policy.
+//
+// Usage example:
+//
+//   ASSIGN_OR_RETURN(auto engine, LeafIndexEngine::Create(*model));
+//   std::vector<int32_t> leaves(dataset.nrow() * engine->num_trees());
+//   RETURN_IF_ERROR(engine->PredictLeaves(dataset, /*num_threads=*/6,
+//                                         absl::MakeSpan(leaves)));
+//
+class LeafIndexEngine {
+ public:
+  static absl::StatusOr<std::unique_ptr<LeafIndexEngine>> Create(
+      const model::AbstractModel& model);
+
+  int num_trees() const;
+
+  absl::Status PredictLeaves(const dataset::VerticalDataset& dataset,
+                             int num_threads,
+                             absl::Span<int32_t> leaves) const;
+
+ private:
+  LeafIndexEngine() = default;
+
+  // Only one of the two models is set.
+  std::unique_ptr<DecisionForestLeafIndex> model_;
+  std::unique_ptr<GenericDecisionForestLeafIndex<uint32_t>> model_many_nodes_;
+};
+
 // Loads a batch a examples from a vertical dataset (i.e. column major generic
 // dataset stored in memory) into a flat batch. This code is inefficient and
 // should not be used for time critical applications. This functions replaces
@@ -15,12 +15,52 @@
 
 #include "yggdrasil_decision_forests/serving/decision_forest/decision_forest_serving.h"
 
+#include <stddef.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "absl/base/config.h"
+#include "absl/numeric/bits.h"
+#include "absl/types/span.h"
 #include "yggdrasil_decision_forests/utils/usage.h"
 
 namespace yggdrasil_decision_forests {
 namespace serving {
 namespace decision_forest {
 
+namespace {
+
+// Number of examples traversed in lockstep by the "Predict" functions.
+constexpr int kExampleBatchSize = 8;
+
+// Number of trees traversed simultaneously by the AVX2 "Predict" functions.
+// Interleaving independent trees hides the latency of the gathers.
+constexpr int kNumInterleavedTrees = 4;
+
+#ifdef __AVX2__
+bool DetectAVX2() {
+#if ABSL_HAVE_BUILTIN(__builtin_cpu_supports)
+  return __builtin_cpu_supports("avx2");
+#else
+  // We cannot detect if the CPU supports AVX2 instructions. If it does not,
+  // a fatal error will be raised.
+  return true;
+#endif
+}
+
+bool CpuSupportsAVX2() {
+  static const bool cpu_supports_avx2 = DetectAVX2();
+  return cpu_supports_avx2;
+}
+#endif
+
+}  // namespace
+
 template <typename SpecializedModel>
 void ActivationMultiDimIdentity(const SpecializedModel& model,
                                 float* const values, const int num_values) {}
@@ -147,10 +187,12 @@ inline bool EvalCondition(const typename Model::NodeType* node,
 
     case GenericNode::Type::kNumericalObliqueProjectionIsHigher: {
       float sum = 0;
-      const auto attributes = model.oblique_internal_feature_idxs.begin() +
-                              node->oblique_projection_offset;
+      const auto oblique_weights = model.oblique_weight_array();
+      const auto attributes =
+          model.oblique_internal_feature_idx_array().begin() +
+          node->oblique_projection_offset;
       const auto weights =
-          model.oblique_weights.begin() + node->oblique_projection_offset;
+          oblique_weights.begin() + node->oblique_projection_offset;
 
       const uint32_t num_projection = node->feature_idx;
       for (uint32_t projection_idx = 0; projection_idx < num_projection;
@@ -160,8 +202,8 @@ inline bool EvalCondition(const typename Model::NodeType* node,
         const float weight = weights[projection_idx];
         sum += weight * attribute_value;
       }
-      return sum >= model.oblique_weights[node->oblique_projection_offset +
-                                          num_projection];
+      return sum >= oblique_weights[node->oblique_projection_offset +
+                                    num_projection];
     }
 
     default:
@@ -170,7 +212,446 @@ inline bool EvalCondition(const typename Model::NodeType* node,
   }
 }
 
+// Traverses a tree with one example, and returns the reached leaf.
+// "eval_condition(node)" evaluates the condition of "node" on the example.
+template <typename Node, typename EvalConditionFn>
+inline const Node* FindLeaf(const Node* node, EvalConditionFn eval_condition) {
+  while (node->right_idx) {
+    node += eval_condition(node) ? node->right_idx : 1;
+  }
+  return node;
+}
+
+// Traverses a tree with "num_examples" (<= kExampleBatchSize) examples in
+// lockstep, and outputs the leaf reached by each example in "leaves".
+//
+// Each iteration evaluates one node for each example that has not yet reached
+// a leaf. Since the traversals of the different examples are independent, the
+// loads of their nodes and feature values overlap instead of waiting for each
+// other. "eval_condition(node, i)" evaluates the condition of "node" on the
+// i-th example.
+template <typename Node, typename EvalConditionFn>
+inline void FindLeavesInLockstep(const Node* root, const int num_examples,
+                                 EvalConditionFn eval_condition,
+                                 const Node** leaves) {
+  // Indices of the examples that have not yet reached a leaf.
+  int active_example_idxs[kExampleBatchSize];
+  int num_active = root->right_idx ? num_examples : 0;
+  for (int i = 0; i < num_examples; i++) {
+    leaves[i] = root;
+    active_example_idxs[i] = i;
+  }
+  while (num_active) {
+    int num_still_active = 0;
+    for (int active_idx = 0; active_idx < num_active; active_idx++) {
+      const int i = active_example_idxs[active_idx];
+      const Node* node = leaves[i];
+      node += eval_condition(node, i) ? node->right_idx : 1;
+      leaves[i] = node;
+      active_example_idxs[num_still_active] = i;
+      num_still_active += node->right_idx != 0;
+    }
+    num_active = num_still_active;
+  }
+}
+
+#ifdef __AVX2__
+// Evaluates the numerical conditions of 8 nodes on 8 examples with AVX2.
+//
+// Args:
+//   header: The "right_idx" (lower 16 bits) and "feature_idx" (upper 16 bits)
+//     of the nodes.
+//   payload: The "threshold" of the nodes.
+//   active: Mask of the non-leaf nodes. The feature values of the other
+//     examples are not read.
+//   values: Feature values of the first example.
+//   example_offsets: Index of the first feature value of each example in
+//     "values".
+//
+// Returns a mask of the examples for which the condition is true.
+inline __m256i EvalConditionAVX2(const OneDimensionOutputNumericalFeatureNode*,
+                                 const __m256i header, const __m256i payload,
+                                 const __m256i active, const float* values,
+                                 const __m256i example_offsets) {
+  const __m256i feature_idxs = _mm256_srli_epi32(header, 16);
+  const __m256 feature_values = _mm256_mask_i32gather_ps(
+      _mm256_setzero_ps(), values,
+      _mm256_add_epi32(example_offsets, feature_idxs),
+      _mm256_castsi256_ps(active), sizeof(float));
+  // Note: Like in "EvalCondition", NaN values evaluate to false.
+  return _mm256_castps_si256(_mm256_cmp_ps(
+      feature_values, _mm256_castsi256_ps(payload), _CMP_GE_OQ));
+}
+
+// Evaluates the numerical and categorical conditions of 8 nodes on 8 examples
+// with AVX2. Same arguments as above, except that "payload" contains the
+// "threshold" of the numerical conditions, and the "mask" of the categorical
+// conditions.
+inline __m256i EvalConditionAVX2(
+    const OneDimensionOutputNumericalAndCategoricalFeatureNode*,
+    const __m256i header, const __m256i payload, const __m256i active,
+    const NumericalOrCategoricalValue* values, const __m256i example_offsets) {
+  // Sign extended "feature_idx". Strictly negative for categorical conditions.
+  const __m256i signed_feature_idxs = _mm256_srai_epi32(header, 16);
+  const __m256i is_categorical =
+      _mm256_cmpgt_epi32(_mm256_setzero_si256(), signed_feature_idxs);
+  // "-(feature_idx + 1)" is "~feature_idx".
+  const __m256i feature_idxs =
+      _mm256_xor_si256(signed_feature_idxs, is_categorical);
+  const __m256i feature_values = _mm256_mask_i32gather_epi32(
+      _mm256_setzero_si256(), reinterpret_cast<const int*>(values),
+      _mm256_add_epi32(example_offsets, feature_idxs), active,
+      sizeof(NumericalOrCategoricalValue));
+
+  const __m256i numerical_condition = _mm256_castps_si256(
+      _mm256_cmp_ps(_mm256_castsi256_ps(feature_values),
+                    _mm256_castsi256_ps(payload), _CMP_GE_OQ));
+  const __m256i categorical_bits = _mm256_and_si256(
+      _mm256_sllv_epi32(_mm256_set1_epi32(1), feature_values), payload);
+  const __m256i categorical_condition = _mm256_xor_si256(
+      _mm256_cmpeq_epi32(categorical_bits, _mm256_setzero_si256()),
+      _mm256_set1_epi32(-1));
+  return _mm256_blendv_epi8(numerical_condition, categorical_condition,
+                            is_categorical);
+}
+
+// Traverses "num_trees" (<= kNumInterleavedTrees) trees with 8 examples in
+// lockstep using AVX2 gathers on the node array, and outputs the label of the
+// leaf reached by each example in each tree.
+//
+// Args:
+//   model: A flat model with 8 bytes nodes.
+//   root_offsets: Index of the roots of the trees in "model.node_array()".
+//   num_trees: Number of trees.
+//   values: Feature values of the first example.
+//   example_offsets: Index of the first feature value of each example in
+//     "values".
+//   leaf_values: Output labels, indexed by tree.
+template <typename Model>
+inline void GetLeafValuesAVX2(const Model& model, const int32_t* root_offsets,
+                              const int num_trees,
+                              const typename Model::ValueType* values,
+                              const __m256i example_offsets,
+                              __m256* leaf_values) {
+  using Node = typename Model::NodeType;
+  static_assert(sizeof(Node) == 2 * sizeof(int32_t),
+                "The node gathers expect 8 bytes nodes.");
+  const int* nodes = reinterpret_cast<const int*>(model.node_array().data());
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i all_ones = _mm256_set1_epi32(-1);
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i right_idx_mask = _mm256_set1_epi32(0xFFFF);
+
+  __m256i node_idxs[kNumInterleavedTrees];
+  bool done[kNumInterleavedTrees];
+  for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+    node_idxs[tree_idx] = _mm256_set1_epi32(root_offsets[tree_idx]);
+    done[tree_idx] = false;
+  }
+  int num_done = 0;
+  while (num_done < num_trees) {
+    for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+      if (done[tree_idx]) {
+        continue;
+      }
+      const __m256i header =
+          _mm256_i32gather_epi32(nodes, node_idxs[tree_idx], sizeof(Node));
+      const __m256i payload =
+          _mm256_i32gather_epi32(nodes + 1, node_idxs[tree_idx], sizeof(Node));
+      const __m256i right_idxs = _mm256_and_si256(header, right_idx_mask);
+      const __m256i is_leaf = _mm256_cmpeq_epi32(right_idxs, zero);
+      if (_mm256_movemask_epi8(is_leaf) == -1) {
+        // All the examples reached a leaf. "payload" contains the labels.
+        leaf_values[tree_idx] = _mm256_castsi256_ps(payload);
+        done[tree_idx] = true;
+        num_done++;
+        continue;
+      }
+      const __m256i active = _mm256_xor_si256(is_leaf, all_ones);
+      const __m256i condition =
+          EvalConditionAVX2(static_cast<const Node*>(nullptr), header, payload,
+                            active, values, example_offsets);
+      const __m256i offsets = _mm256_blendv_epi8(one, right_idxs, condition);
+      node_idxs[tree_idx] = _mm256_add_epi32(
+          node_idxs[tree_idx], _mm256_and_si256(offsets, active));
+    }
+  }
+}
+
+// Predictions of a flat model on 8 examples with AVX2. The examples are
+// stored example-major starting at "values". "output" contains the sum of the
+// leaf values (i.e. before the final transformation).
+template <typename Model>
+inline void PredictExampleBatchAVX2(const Model& model,
+                                    const typename Model::ValueType* values,
+                                    const int num_features, float* output) {
+  const __m256i example_offsets = _mm256_mullo_epi32(
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+      _mm256_set1_epi32(num_features));
+  const auto root_offsets = model.root_offset_array();
+  const int num_trees = root_offsets.size();
+  __m256 accumulator = _mm256_setzero_ps();
+  __m256 leaf_values[kNumInterleavedTrees];
+  for (int begin_tree_idx = 0; begin_tree_idx < num_trees;
+       begin_tree_idx += kNumInterleavedTrees) {
+    const int num_trees_in_group =
+        std::min(kNumInterleavedTrees, num_trees - begin_tree_idx);
+    GetLeafValuesAVX2(model, &root_offsets[begin_tree_idx],
+                      num_trees_in_group, values, example_offsets,
+                      leaf_values);
+    for (int tree_idx = 0; tree_idx < num_trees_in_group; tree_idx++) {
+      accumulator = _mm256_add_ps(accumulator, leaf_values[tree_idx]);
+    }
+  }
+  _mm256_storeu_ps(output, accumulator);
+}
+
+// Extracts the field of "kNumBits" bits at byte offset "kByteOffset" (in
+// the node) from the gathered node words "words". If "kSigned", the field is
+// sign extended.
+template <int kByteOffset, int kNumBits, bool kSigned>
+inline __m256i ExtractNodeFieldAVX2(const __m256i (&words)[3]) {
+  static_assert(kByteOffset % 4 + kNumBits / 8 <= 4,
+                "The field should not overlap two words.");
+  const __m256i word = words[kByteOffset / 4];
+  constexpr int kLeftShift = 32 - kNumBits - (kByteOffset % 4) * 8;
+  const __m256i shifted = _mm256_slli_epi32(word, kLeftShift);
+  if (kSigned) {
+    return _mm256_srai_epi32(shifted, 32 - kNumBits);
+  } else {
+    return _mm256_srli_epi32(shifted, 32 - kNumBits);
+  }
+}
+
+// Traverses "num_trees" (<= kNumInterleavedTrees) trees of generic nodes with
+// 8 examples in lockstep using AVX2 gathers on the node array, and outputs the
+// leaf reached by each example in each tree.
+//
+// The numerical and categorical mask conditions are evaluated with SIMD
+// instructions. The other conditions (e.g. categorical-set and oblique
+// conditions) are evaluated one example at a time with "EvalCondition".
+template <typename Model>
+inline void FindLeavesAVX2(
+    const Model& model, const int32_t* root_offsets, const int num_trees,
+    const typename Model::ExampleSet& examples, const int begin_example_idx,
+    const typename Model::NodeType* (*leaves)[kExampleBatchSize]) {
+  using Node = typename Model::NodeType;
+  using NodeType = typename Node::Type;
+  static_assert(sizeof(Node) == 3 * sizeof(int32_t),
+                "The node gathers expect 12 bytes nodes.");
+  constexpr int kNodeNumWords = sizeof(Node) / sizeof(int32_t);
+  constexpr int kRightIdxBits = 8 * sizeof(typename Node::NodeOffset);
+  constexpr int kFeatureIdxOffset = offsetof(Node, feature_idx);
+  constexpr int kTypeOffset = offsetof(Node, type);
+  static_assert(offsetof(Node, right_idx) == 0, "Unexpected node layout.");
+  static_assert(offsetof(Node, label) == 8, "Unexpected node layout.");
+  static_assert(Model::ExampleSet::kFormat ==
+                    ExampleFormat::FORMAT_EXAMPLE_MAJOR,
+                "The feature gathers expect example-major examples.");
+
+  const Node* const model_nodes = model.node_array().data();
+  const int* nodes = reinterpret_cast<const int*>(model_nodes);
+  const int num_features = model.features().fixed_length_features().size();
+  const int* values = reinterpret_cast<const int*>(
+      examples.InternalCategoricalAndNumericalValues().data() +
+      begin_example_idx * num_features);
+  const __m256i example_offsets =
+      _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                         _mm256_set1_epi32(num_features));
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i all_ones = _mm256_set1_epi32(-1);
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i node_num_words = _mm256_set1_epi32(kNodeNumWords);
+  const auto type_value = [](const NodeType type) {
+    return _mm256_set1_epi32(static_cast<int>(type));
+  };
+  const __m256i numerical_missing_is_false =
+      type_value(NodeType::kNumericalIsHigherMissingIsFalse);
+  const __m256i numerical_missing_is_true =
+      type_value(NodeType::kNumericalIsHigherMissingIsTrue);
+  const __m256i categorical_mask =
+      type_value(NodeType::kCategoricalContainsMask);
+
+  // Index of the current node of each example, in number of 32 bits words.
+  __m256i node_word_idxs[kNumInterleavedTrees];
+  bool done[kNumInterleavedTrees];
+  for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+    node_word_idxs[tree_idx] =
+        _mm256_set1_epi32(root_offsets[tree_idx] * kNodeNumWords);
+    done[tree_idx] = false;
+  }
+  int num_done = 0;
+  while (num_done < num_trees) {
+    for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+      if (done[tree_idx]) {
+        continue;
+      }
+      const __m256i word_idxs = node_word_idxs[tree_idx];
+      const __m256i words[kNodeNumWords] = {
+          _mm256_i32gather_epi32(nodes, word_idxs, sizeof(int32_t)),
+          _mm256_i32gather_epi32(nodes + 1, word_idxs, sizeof(int32_t)),
+          _mm256_i32gather_epi32(nodes + 2, word_idxs, sizeof(int32_t))};
+      const __m256i right_idxs =
+          ExtractNodeFieldAVX2<0, kRightIdxBits, false>(words);
+      const __m256i is_leaf = _mm256_cmpeq_epi32(right_idxs, zero);
+      if (_mm256_movemask_epi8(is_leaf) == -1) {
+        alignas(32) int32_t leaf_word_idxs[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(leaf_word_idxs),
+                           word_idxs);
+        for (int i = 0; i < 8; i++) {
+          leaves[tree_idx][i] = &model_nodes[leaf_word_idxs[i] / kNodeNumWords];
+        }
+        done[tree_idx] = true;
+        num_done++;
+        continue;
+      }
+      const __m256i active = _mm256_xor_si256(is_leaf, all_ones);
+      const __m256i feature_idxs =
+          ExtractNodeFieldAVX2<kFeatureIdxOffset, 16, true>(words);
+      const __m256i types = ExtractNodeFieldAVX2<kTypeOffset, 8, false>(words);
+      const __m256i payloads = words[2];
+
+      const __m256i is_numerical_missing_is_false =
+          _mm256_cmpeq_epi32(types, numerical_missing_is_false);
+      const __m256i is_numerical_missing_is_true =
+          _mm256_cmpeq_epi32(types, numerical_missing_is_true);
+      const __m256i is_categorical_mask =
+          _mm256_cmpeq_epi32(types, categorical_mask);
+      const __m256i is_simd = _mm256_and_si256(
+          active,
+          _mm256_or_si256(_mm256_or_si256(is_numerical_missing_is_false,
+                                          is_numerical_missing_is_true),
+                          is_categorical_mask));
+
+      const __m256i feature_values = _mm256_mask_i32gather_epi32(
+          zero, values, _mm256_add_epi32(example_offsets, feature_idxs),
+          is_simd, sizeof(NumericalOrCategoricalValue));
+      const __m256 numerical_values = _mm256_castsi256_ps(feature_values);
+      const __m256 thresholds = _mm256_castsi256_ps(payloads);
+      // Note: "!(value < threshold)" is true for NaN values.
+      const __m256i numerical_missing_is_false_condition = _mm256_castps_si256(
+          _mm256_cmp_ps(numerical_values, thresholds, _CMP_GE_OQ));
+      const __m256i numerical_missing_is_true_condition = _mm256_castps_si256(
+          _mm256_cmp_ps(numerical_values, thresholds, _CMP_NLT_UQ));
+      const __m256i categorical_bits = _mm256_and_si256(
+          _mm256_sllv_epi32(one, feature_values), payloads);
+      const __m256i categorical_condition = _mm256_xor_si256(
+          _mm256_cmpeq_epi32(categorical_bits, zero), all_ones);
+      __m256i condition = _mm256_or_si256(
+          _mm256_or_si256(
+              _mm256_and_si256(is_numerical_missing_is_false,
+                               numerical_missing_is_false_condition),
+              _mm256_and_si256(is_numerical_missing_is_true,
+                               numerical_missing_is_true_condition)),
+          _mm256_and_si256(is_categorical_mask, categorical_condition));
+
+      // Evaluates the other conditions one example at a time.
+      int scalar_lanes = _mm256_movemask_ps(
+          _mm256_castsi256_ps(_mm256_andnot_si256(is_simd, active)));
+      if (scalar_lanes) {
+        alignas(32) int32_t lane_word_idxs[8];
+        alignas(32) int32_t lane_conditions[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane_word_idxs),
+                           word_idxs);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane_conditions),
+                           condition);
+        while (scalar_lanes) {
+          const int lane =
+              absl::countr_zero(static_cast<uint32_t>(scalar_lanes));
+          scalar_lanes &= scalar_lanes - 1;
+          const Node* node = &model_nodes[lane_word_idxs[lane] / kNodeNumWords];
+          lane_conditions[lane] =
+              EvalCondition(node, examples, begin_example_idx + lane, model)
+                  ? -1
+                  : 0;
+        }
+        condition = _mm256_load_si256(
+            reinterpret_cast<const __m256i*>(lane_conditions));
+      }
+
+      const __m256i offsets = _mm256_blendv_epi8(one, right_idxs, condition);
+      node_word_idxs[tree_idx] = _mm256_add_epi32(
+          word_idxs, _mm256_mullo_epi32(_mm256_and_si256(offsets, active),
+                                        node_num_words));
+    }
+  }
+}
+#endif
+
+// Outputs the leaf reached by each of the examples [begin_example_idx,
+// begin_example_idx + batch_size) in each of the "num_trees" (<=
+// kNumInterleavedTrees) trees of generic nodes rooted at "root_offsets".
+// "leaves[i][j]" is the leaf of the j-th example in the i-th tree.
+template <typename Model>
+inline void FindLeaves(const Model& model, const int32_t* root_offsets,
+                       const int num_trees,
+                       const typename Model::ExampleSet& examples,
+                       const int begin_example_idx, const int batch_size,
+                       const typename Model::NodeType* (*leaves)
+                           [kExampleBatchSize]) {
+  using Node = typename Model::NodeType;
+#ifdef __AVX2__
+  if (model.batched_traversal && batch_size == kExampleBatchSize &&
+      CpuSupportsAVX2()) {
+    static_assert(kExampleBatchSize == 8, "One example per AVX2 lane.");
+    FindLeavesAVX2(model, root_offsets, num_trees, examples, begin_example_idx,
+                   leaves);
+    return;
+  }
+#endif
+  const auto nodes = model.node_array();
+  for (int tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+    const Node* root = &nodes[root_offsets[tree_idx]];
+    if (model.batched_traversal) {
+      FindLeavesInLockstep(
+          root, batch_size,
+          [&](const Node* node, const int i) {
+            return EvalCondition(node, examples, begin_example_idx + i, model);
+          },
+          leaves[tree_idx]);
+    } else {
+      for (int i = 0; i < batch_size; i++) {
+        leaves[tree_idx][i] = FindLeaf(root, [&](const Node* node) {
+          return EvalCondition(node, examples, begin_example_idx + i, model);
+        });
+      }
+    }
+  }
+}
+
+// Calls "process_leaf(tree_idx, i, leaf)" for each tree and for each of the
+// examples [begin_example_idx, begin_example_idx + batch_size), where "leaf" is
+// the leaf reached by the i-th example of the batch in the "tree_idx"-th tree.
+// The trees are visited in order.
+template <typename Model, typename ProcessLeafFn>
+inline void ForEachLeaf(const Model& model,
+                        const typename Model::ExampleSet& examples,
+                        const int begin_example_idx, const int batch_size,
+                        ProcessLeafFn process_leaf) {
+  using Node = typename Model::NodeType;
+  const Node* leaves[kNumInterleavedTrees][kExampleBatchSize];
+  const auto root_offsets = model.root_offset_array();
+  const int num_trees = root_offsets.size();
+  for (int begin_tree_idx = 0; begin_tree_idx < num_trees;
+       begin_tree_idx += kNumInterleavedTrees) {
+    const int num_trees_in_group =
+        std::min(kNumInterleavedTrees, num_trees - begin_tree_idx);
+    FindLeaves(model, &root_offsets[begin_tree_idx], num_trees_in_group,
+               examples, begin_example_idx, batch_size, leaves);
+    for (int tree_idx = 0; tree_idx < num_trees_in_group; tree_idx++) {
+      for (int i = 0; i < batch_size; i++) {
+        process_leaf(begin_tree_idx + tree_idx, i, leaves[tree_idx][i]);
+      }
+    }
+  }
+}
+
 // Basic inference of a decision forest on a set of trees.
+//
+// If the CPU supports AVX2, the examples are processed in batches of
+// "kExampleBatchSize" examples, and groups of "kNumInterleavedTrees" trees are
+// traversed by all the examples of a batch in lockstep using SIMD gathers on
+// the node array. Otherwise, the examples are processed one at a time.
 template <typename Model,
           float (*FinalTransform)(const Model&, const float) = Idendity<Model>>
 inline void PredictHelper(
@@ -180,11 +661,29 @@ inline void PredictHelper(
   const int num_features = model.features().fixed_length_features().size();
   predictions->resize(num_examples);
   const typename Model::ValueType* sample = examples.data();
-  for (int example_idx = 0; example_idx < num_examples; ++example_idx) {
+  int example_idx = 0;
+
+#ifdef __AVX2__
+  if (CpuSupportsAVX2()) {
+    static_assert(kExampleBatchSize == 8, "One example per AVX2 lane.");
+    float output[kExampleBatchSize];
+    for (; example_idx + kExampleBatchSize <= num_examples;
+         example_idx += kExampleBatchSize) {
+      PredictExampleBatchAVX2(model, sample, num_features, output);
+      for (int i = 0; i < kExampleBatchSize; i++) {
+        (*predictions)[example_idx + i] = FinalTransform(model, output[i]);
+      }
+      sample += kExampleBatchSize * num_features;
+    }
+  }
+#endif
+
+  const auto nodes = model.node_array();
+  for (; example_idx < num_examples; ++example_idx) {
     float output = 0.f;
 
-    for (const auto root_node_idx : model.root_offsets) {
-      const auto* node = &model.nodes[root_node_idx];
+    for (const auto root_node_idx : model.root_offset_array()) {
+      const auto* node = &nodes[root_node_idx];
       while (node->right_idx) {
         node += EvalCondition(node, sample) ? node->right_idx : 1;
       }
@@ -196,25 +695,36 @@ inline void PredictHelper(
   }
 }
 
+// Inference of a decision forest of generic nodes (e.g. with categorical-set
+// or oblique conditions).
+//
+// If "model.batched_traversal" is true, the examples are processed in batches
+// of "kExampleBatchSize" examples, and each tree is traversed by all the
+// examples of a batch in lockstep. If the CPU supports AVX2, groups of
+// "kNumInterleavedTrees" trees are traversed simultaneously using SIMD gathers
+// on the node array. Otherwise, the examples of a batch are interleaved with
+// scalar code (see "FindLeavesInLockstep").
 template <typename Model,
           float (*FinalTransform)(const Model&, const float) /*= Idendity*/>
 inline void PredictHelper(const Model& model,
                           const typename Model::ExampleSet& examples,
                           int num_examples, std::vector<float>* predictions) {
+  using Node = typename Model::NodeType;
   utils::usage::OnInference(num_examples, model.metadata);
   predictions->resize(num_examples);
-  for (int example_idx = 0; example_idx < num_examples; ++example_idx) {
-    float output = 0.f;
-    for (const auto root_node_idx : model.root_offsets) {
-      const auto* node = &model.nodes[root_node_idx];
-      while (node->right_idx) {
-        node += EvalCondition(node, examples, example_idx, model)
-                    ? node->right_idx
-                    : 1;
-      }
-      output += node->label;
+  float output[kExampleBatchSize];
+  for (int begin_example_idx = 0; begin_example_idx < num_examples;
+       begin_example_idx += kExampleBatchSize) {
+    const int batch_size =
+        std::min(kExampleBatchSize, num_examples - begin_example_idx);
+    std::fill(output, output + batch_size, 0.f);
+    ForEachLeaf(model, examples, begin_example_idx, batch_size,
+                [&](const int tree_idx, const int i, const Node* leaf) {
+                  output[i] += leaf->label;
+                });
+    for (int i = 0; i < batch_size; i++) {
+      (*predictions)[begin_example_idx + i] = FinalTransform(model, output[i]);
     }
-    (*predictions)[example_idx] = FinalTransform(model, output);
   }
 }
 
@@ -223,27 +733,52 @@ template <typename Model,
 inline void PredictHelperMultiDimensionTrees(
     const Model& model, const typename Model::ExampleSet& examples,
     int num_examples, std::vector<float>* predictions) {
+  using Node = typename Model::NodeType;
   utils::usage::OnInference(num_examples, model.metadata);
   predictions->assign(num_examples * model.num_classes, 0.f);
-  float* cur_predictions = &(*predictions)[0];
-  for (int example_idx = 0; example_idx < num_examples; ++example_idx) {
-    for (const auto root_node_idx : model.root_offsets) {
-      const auto* node = &model.nodes[root_node_idx];
-      while (node->right_idx) {
-        node += EvalCondition(node, examples, example_idx, model)
-                    ? node->right_idx
-                    : 1;
-      }
-      for (int class_idx = 0; class_idx < model.num_classes; class_idx++) {
-        cur_predictions[class_idx] +=
-            model.label_buffer[node->label_buffer_offset + class_idx];
-      }
+  for (int begin_example_idx = 0; begin_example_idx < num_examples;
+       begin_example_idx += kExampleBatchSize) {
+    const int batch_size =
+        std::min(kExampleBatchSize, num_examples - begin_example_idx);
+    float* batch_predictions =
+        &(*predictions)[begin_example_idx * model.num_classes];
+    // Accumulates the leaf values with "get_value(label_buffer index)".
+    const auto accumulate_leaf_values = [&](const auto get_value) {
+      ForEachLeaf(
+          model, examples, begin_example_idx, batch_size,
+          [&](const int tree_idx, const int i, const Node* leaf) {
+            float* cur_predictions = batch_predictions + i * model.num_classes;
+            for (int class_idx = 0; class_idx < model.num_classes;
+                 class_idx++) {
+              cur_predictions[class_idx] +=
+                  get_value(leaf->label_buffer_offset + class_idx);
+            }
+          });
+    };
+    switch (model.label_buffer_quantization) {
+      case LeafOutputQuantization::kFloat32: {
+        const auto label_buffer = model.label_buffer_array();
+        accumulate_leaf_values(
+            [&](const uint32_t idx) { return label_buffer[idx]; });
+      } break;
+      case LeafOutputQuantization::kFloat16: {
+        const auto label_buffer = model.label_buffer_float16_array();
+        accumulate_leaf_values([&](const uint32_t idx) {
+          return Float16ToFloat(label_buffer[idx]);
+        });
+      } break;
+      case LeafOutputQuantization::kInt8: {
+        const auto label_buffer = model.label_buffer_int8_array();
+        accumulate_leaf_values([&](const uint32_t idx) {
+          return label_buffer[idx] * model.label_buffer_int8_scale;
+        });
+      } break;
     }
-    for (int class_idx = 0; class_idx < model.num_classes; class_idx++) {
-      cur_predictions[class_idx] =
-          FinalTransform(model, cur_predictions[class_idx]);
+    for (int value_idx = 0; value_idx < batch_size * model.num_classes;
+         value_idx++) {
+      batch_predictions[value_idx] =
+          FinalTransform(model, batch_predictions[value_idx]);
     }
-    cur_predictions += model.num_classes;
   }
 }
 
@@ -252,22 +787,24 @@ template <typename Model,
 inline void PredictHelperMultiDimensionFromSingleDimensionTrees(
     const Model& model, const typename Model::ExampleSet& examples,
     int num_examples, std::vector<float>* predictions) {
+  using Node = typename Model::NodeType;
   predictions->assign(num_examples * model.num_classes, 0.f);
-  float* cur_predictions = &(*predictions)[0];
-  for (int example_idx = 0; example_idx < num_examples; ++example_idx) {
-    int class_idx = 0;
-    for (const auto root_node_idx : model.root_offsets) {
-      const auto* node = &model.nodes[root_node_idx];
-      while (node->right_idx) {
-        node += EvalCondition(node, examples, example_idx, model)
-                    ? node->right_idx
-                    : 1;
-      }
-      cur_predictions[class_idx] += node->label;
-      class_idx = (class_idx + 1) % model.num_classes;
+  for (int begin_example_idx = 0; begin_example_idx < num_examples;
+       begin_example_idx += kExampleBatchSize) {
+    const int batch_size =
+        std::min(kExampleBatchSize, num_examples - begin_example_idx);
+    float* batch_predictions =
+        &(*predictions)[begin_example_idx * model.num_classes];
+    ForEachLeaf(model, examples, begin_example_idx, batch_size,
+                [&](const int tree_idx, const int i, const Node* leaf) {
+                  batch_predictions[i * model.num_classes +
+                                    tree_idx % model.num_classes] +=
+                      leaf->label;
+                });
+    for (int i = 0; i < batch_size; i++) {
+      FinalTransform(model, batch_predictions + i * model.num_classes,
+                     model.num_classes);
     }
-    FinalTransform(model, cur_predictions, model.num_classes);
-    cur_predictions += model.num_classes;
   }
 }
 
@@ -286,9 +823,11 @@ inline void PredictHelperOptimizedV1(
     return;
   }
 
-  const int num_tree_batches = model.root_offsets.size() / kTreeBatchSize;
+  const auto model_nodes = model.node_array();
+  const auto root_offsets = model.root_offset_array();
+  const int num_tree_batches = root_offsets.size() / kTreeBatchSize;
   const int num_remaining_trees =
-      model.root_offsets.size() - num_tree_batches * kTreeBatchSize;
+      root_offsets.size() - num_tree_batches * kTreeBatchSize;
 
   // The active nodes in the current tree batch. If "nodes[i]==nullptr", the
   // tree "i" is disabled i.e. it reached a leaf.
@@ -308,7 +847,7 @@ inline void PredictHelperOptimizedV1(
     float output = 0.f;
 
     // Select the first tree bath.
-    auto current_root_node_offset = &model.root_offsets[0];
+    auto current_root_node_offset = root_offsets.data();
 
     for (int tree_batch_idx = 0; tree_batch_idx < num_tree_batches;
          ++tree_batch_idx) {
@@ -321,7 +860,7 @@ inline void PredictHelperOptimizedV1(
       for (int tree_in_batch_idx = 0; tree_in_batch_idx < kTreeBatchSize;
            ++tree_in_batch_idx) {
         nodes[tree_in_batch_idx] =
-            &model.nodes[*(current_root_node_offset + tree_in_batch_idx)];
+            &model_nodes[*(current_root_node_offset + tree_in_batch_idx)];
       }
       current_root_node_offset += kTreeBatchSize;
       num_active = kTreeBatchSize;
@@ -352,7 +891,7 @@ inline void PredictHelperOptimizedV1(
 
     for (int tree_in_batch_idx = 0; tree_in_batch_idx < num_remaining_trees;
          tree_in_batch_idx++) {
-      auto node = &model.nodes[*(current_root_node_offset + tree_in_batch_idx)];
+      auto node = &model_nodes[*(current_root_node_offset + tree_in_batch_idx)];
       while (node->right_idx) {
         node += EvalCondition(node, sample) ? node->right_idx : 1;
       }
@@ -700,6 +1239,37 @@ void Predict(const GradientBoostedTreesRanking& model,
                                                 predictions);
 }
 
+template <typename Model>
+void PredictLeaves(const Model& model,
+                   const typename Model::ExampleSet& examples,
+                   const int num_examples, absl::Span<int32_t> leaves) {
+  using Node = typename Model::NodeType;
+  utils::usage::OnInference(num_examples, model.metadata);
+  const int num_trees = model.root_offset_array().size();
+  for (int begin_example_idx = 0; begin_example_idx < num_examples;
+       begin_example_idx += kExampleBatchSize) {
+    const int batch_size =
+        std::min(kExampleBatchSize, num_examples - begin_example_idx);
+    int32_t* batch_leaves =
+        leaves.data() + static_cast<size_t>(begin_example_idx) * num_trees;
+    ForEachLeaf(model, examples, begin_example_idx, batch_size,
+                [&](const int tree_idx, const int i, const Node* leaf) {
+                  batch_leaves[i * num_trees + tree_idx] = leaf->leaf_idx;
+                });
+  }
+}
+
+template void PredictLeaves(
+    const DecisionForestLeafIndex& model,
+    const typename DecisionForestLeafIndex::ExampleSet& examples,
+    int num_examples, absl::Span<int32_t> leaves);
+
+template void PredictLeaves(
+    const GenericDecisionForestLeafIndex<uint32_t>& model,
+    const typename GenericDecisionForestLeafIndex<uint32_t>::ExampleSet&
+        examples,
+    int num_examples, absl::Span<int32_t> leaves);
+
 }  // namespace decision_forest
 }  // namespace serving
 }  // namespace yggdrasil_decision_forests
@@ -16,8 +16,13 @@
 #ifndef YGGDRASIL_DECISION_FORESTS_SERVING_DECISION_FOREST_DECISION_FOREST_SERVING_H_
 #define YGGDRASIL_DECISION_FORESTS_SERVING_DECISION_FOREST_DECISION_FOREST_SERVING_H_
 
+#include <cmath>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "absl/base/casts.h"
+#include "absl/types/span.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
 #include "yggdrasil_decision_forests/serving/example_set.h"
 
@@ -132,6 +137,11 @@ struct GenericNode {
     // label_buffer[label_buffer_offset+class_idx].
     uint32_t label_buffer_offset;
 
+    // Index of the leaf in its tree (see "NodeWithChildren::leaf_idx") if the
+    // node is a leaf. Only used by the leaf index models (see
+    // "GenericDecisionForestLeafIndex").
+    uint32_t leaf_idx;
+
     // Numerical condition as "attribute >= threshold".
     // Also used for discretized numerical features.
     float numerical_is_higher_threshold;
@@ -175,6 +185,18 @@ struct GenericNode {
     return node;
   }
 
+  // Leaf index constructor.
+  static GenericNode<NodeOffsetRep> LeafIndex(NodeOffset right_idx,
+                                              FeatureIdx feature_idx,
+                                              Type type, uint32_t leaf_idx) {
+    GenericNode<NodeOffsetRep> node;
+    node.right_idx = right_idx;
+    node.feature_idx = feature_idx;
+    node.type = type;
+    node.leaf_idx = leaf_idx;
+    return node;
+  }
+
   // Simple categorical-uplift output leaf constructor.
   static GenericNode<NodeOffsetRep> LeafCategoricalUplift(
       NodeOffset right_idx, FeatureIdx feature_idx, Type type,
@@ -184,6 +206,62 @@ struct GenericNode {
   }
 };
 
+// Order of the nodes of a tree in a flat node model. In all the layouts, the
+// negative child of a node is the next node, and the positive child is
+// "right_idx" nodes after. A layout is a choice of the position of the
+// positive sub-trees. Each tree remains contiguous.
+enum class NodeLayout {
+  // Each node is followed by its negative sub-tree, and then by its positive
+  // sub-tree.
+  kDepthFirst = 0,
+  // The top of the tree (~1kB) is made of "negative chains" i.e. a node
+  // followed by its negative child, recursively until a leaf. The chains are
+  // ordered by the number of positive branches between them and the root. The
+  // rest of the tree is stored depth-first.
+  kBreadthFirst = 1,
+  // Same as "kBreadthFirst", but the chains are ordered by number of training
+  // examples reaching them (most visited first, among the chains whose parent
+  // is already placed). The most frequently visited paths are packed at the
+  // beginning of the tree. Equivalent to "kBreadthFirst" if the model does not
+  // contain training statistics.
+  kVisitFrequency = 2,
+};
+
+// Representation of the values in the "label_buffer" of a flat node model.
+enum class LeafOutputQuantization {
+  kFloat32 = 0,
+  // IEEE 754 half precision. Relative error of 2^-11.
+  kFloat16 = 1,
+  // 8-bit signed integers with a common scale for the entire model. Absolute
+  // error of half the scale i.e. max(|value|) / 254.
+  kInt8 = 2,
+};
+
+// Converts a float into an IEEE 754 half precision float (rounding to the
+// nearest even value). "value" should be finite and smaller than 65504 in
+// absolute value.
+inline uint16_t FloatToFloat16(const float value) {
+  const uint32_t bits = absl::bit_cast<uint32_t>(value);
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t abs_bits = bits & 0x7fffffff;
+  if (abs_bits < 0x38800000) {
+    // Zero or sub-normal half float i.e. |value| < 2^-14.
+    return sign |
+           static_cast<uint16_t>(std::nearbyint(std::abs(value) * 0x1p24f));
+  }
+  const uint32_t rounded_bits = abs_bits + 0xfff + ((abs_bits >> 13) & 1);
+  return sign | static_cast<uint16_t>((rounded_bits - 0x38000000) >> 13);
+}
+
+// Converts a finite IEEE 754 half precision float into a float.
+inline float Float16ToFloat(const uint16_t value) {
+  const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  const float abs_value =
+      absl::bit_cast<float>(static_cast<uint32_t>(value & 0x7fff) << 13) *
+      0x1p112f;
+  return absl::bit_cast<float>(absl::bit_cast<uint32_t>(abs_value) | sign);
+}
+
 // A generic decision forest.
 template <typename Node, typename Value>
 struct FlatNodeModel {
@@ -204,12 +282,28 @@ struct FlatNodeModel {
   // The indices (in "nodes") of the root nodes.
   std::vector<int32_t> root_offsets;
 
+  // Order of the nodes in "nodes". Should be set before the compilation of the
+  // model (i.e. "GenericToSpecializedModel"). The layout does not change the
+  // predictions. For large models that do not fit in the CPU cache, packing
+  // the most visited nodes together reduces the number of cache misses.
+  NodeLayout node_layout = NodeLayout::kDepthFirst;
+
   FeaturesDefinition internal_features;
 
   // Buffer of label values. Used for multi-dimensional output trees.
   // See the description of "label_buffer_offset".
   std::vector<float> label_buffer;
 
+  // Representation of the label values. If not "kFloat32", "label_buffer" is
+  // empty and the label values are stored in "label_buffer_float16" or
+  // "label_buffer_int8" (see "CompressLeafOutputs"), with the same offsets.
+  LeafOutputQuantization label_buffer_quantization =
+      LeafOutputQuantization::kFloat32;
+  std::vector<uint16_t> label_buffer_float16;
+  // The label values are "label_buffer_int8[i] * label_buffer_int8_scale".
+  std::vector<int8_t> label_buffer_int8;
+  float label_buffer_int8_scale = 0.f;
+
   // Buffer of categorical mask to use for categorical condition.
   std::vector<bool> categorical_mask_buffer;
 
@@ -219,6 +313,57 @@ struct FlatNodeModel {
   std::vector<typename Node::FeatureIdx> oblique_internal_feature_idxs;
 
   model::proto::Metadata metadata;
+
+  // Arrays of a model that does not own them e.g. a model loaded from a memory
+  // mapped serving snapshot (see "serving_snapshot.h"). The arrays remain valid
+  // as long as "storage" is alive.
+  struct ExternalArrays {
+    std::shared_ptr<const void> storage;
+    absl::Span<const Node> nodes;
+    absl::Span<const int32_t> root_offsets;
+    absl::Span<const float> label_buffer;
+    absl::Span<const uint16_t> label_buffer_float16;
+    absl::Span<const int8_t> label_buffer_int8;
+    absl::Span<const float> oblique_weights;
+    absl::Span<const typename Node::FeatureIdx> oblique_internal_feature_idxs;
+  };
+
+  // If set, the model arrays are "external_arrays" and the corresponding
+  // vectors (e.g. "nodes", "root_offsets") are empty. Copies of the model share
+  // the external arrays.
+  std::shared_ptr<const ExternalArrays> external_arrays;
+
+  // Arrays used for inference: The external arrays if set, and the vectors of
+  // the model otherwise.
+  absl::Span<const Node> node_array() const {
+    return external_arrays ? external_arrays->nodes : absl::MakeConstSpan(nodes);
+  }
+  absl::Span<const int32_t> root_offset_array() const {
+    return external_arrays ? external_arrays->root_offsets
+                           : absl::MakeConstSpan(root_offsets);
+  }
+  absl::Span<const float> label_buffer_array() const {
+    return external_arrays ? external_arrays->label_buffer
+                           : absl::MakeConstSpan(label_buffer);
+  }
+  absl::Span<const uint16_t> label_buffer_float16_array() const {
+    return external_arrays ? external_arrays->label_buffer_float16
+                           : absl::MakeConstSpan(label_buffer_float16);
+  }
+  absl::Span<const int8_t> label_buffer_int8_array() const {
+    return external_arrays ? external_arrays->label_buffer_int8
+                           : absl::MakeConstSpan(label_buffer_int8);
+  }
+  absl::Span<const float> oblique_weight_array() const {
+    return external_arrays ? external_arrays->oblique_weights
+                           : absl::MakeConstSpan(oblique_weights);
+  }
+  absl::Span<const typename Node::FeatureIdx>
+  oblique_internal_feature_idx_array() const {
+    return external_arrays
+               ? external_arrays->oblique_internal_feature_idxs
+               : absl::MakeConstSpan(oblique_internal_feature_idxs);
+  }
 };
 
 // Specialized models.
@@ -332,6 +477,13 @@ struct ExampleSetModel
   // If true, the engine inference runs with the global imputation optimization.
   // That is, missing values are replaced with global imputation.
   bool global_imputation_optimization;
+
+  // If true, the examples traverse the trees by batches, in lockstep (with
+  // AVX2 gathers on the node array if supported by the CPU). Enabled when most
+  // of the conditions are numerical or categorical mask conditions. Other
+  // conditions (e.g. categorical-set conditions) are faster to evaluate one
+  // example at a time.
+  bool batched_traversal = false;
 };
 
 struct ExampleSetModelManyNodes : ExampleSetModel<uint32_t> {};
@@ -428,10 +580,33 @@ struct GenericGradientBoostedTreesRanking : ExampleSetModel<NodeOffsetRep> {
 };
 using GradientBoostedTreesRanking = GenericGradientBoostedTreesRanking<>;
 
+// Decision forest model that outputs the index of the active leaf in each tree
+// instead of a prediction (e.g. to use the leaves as embedding features).
+// Compatible with the Random Forest and Gradient Boosted Trees models of all
+// the tasks.
+template <typename NodeOffsetRep = uint16_t>
+struct GenericDecisionForestLeafIndex : ExampleSetModel<NodeOffsetRep> {};
+using DecisionForestLeafIndex = GenericDecisionForestLeafIndex<>;
+
 template <typename Model>
 void Predict(const Model& model, const typename Model::ExampleSet& examples,
              int num_examples, std::vector<float>* predictions);
 
+// Computes the index of the active leaf of each tree for a batch of examples.
+// The leaf indices are the same as "NodeWithChildren::leaf_idx" in the generic
+// model.
+//
+// "leaves" should contain "num_examples * model.root_offsets.size()" values.
+// "leaves[example_idx * num_trees + tree_idx]" will be the leaf reached by the
+// "example_idx"-th example in the "tree_idx"-th tree.
+//
+// The trees are traversed with the same batched (and AVX2 if available)
+// algorithm as "Predict".
+template <typename Model>
+void PredictLeaves(const Model& model,
+                   const typename Model::ExampleSet& examples,
+                   int num_examples, absl::Span<int32_t> leaves);
+
 // Generates the predictions of a model on a batch of examples.
 //
 // Args:
@@ -444,7 +619,10 @@ void Predict(const Model& model, const typename Model::ExampleSet& examples,
 //    predictions: The predictions.
 //
 // "Predict" is a simple inference solution that iterates over all the examples
-// and all the trees iteratively.
+// and all the trees iteratively. If the binary is compiled with AVX2 support
+// and if the CPU supports it, "Predict" traverses the trees with batches of 8
+// examples in lockstep, using SIMD gathers on the node array. The predictions
+// are the same in both cases.
 //
 // "PredictOptimizedV1" iterates over trees in batches (bathes of trees) which
 // is more efficient for RAM access.
@@ -16,6 +16,8 @@
 #include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
@@ -33,10 +35,12 @@
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_forest_interface.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/model/fast_engine_factory.h"
@@ -54,6 +58,7 @@
 #include "yggdrasil_decision_forests/utils/status_macros.h"  // IWYU pragma: keep
 #include "yggdrasil_decision_forests/utils/test.h"
 #include "yggdrasil_decision_forests/utils/test_utils.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
 
 namespace yggdrasil_decision_forests {
 namespace serving {
@@ -304,10 +309,12 @@ TEST_P(AllCompatibleEnginesTest, AutomtacForceCheckFail) {
     return;
   }
 
-  // None of the Opt engines are compatible.
+  // None of the Opt and 8-bit engines are compatible.
   auto expected_engines = GetParam().expected_engines;
   expected_engines.erase(gradient_boosted_trees::kOptPred);
   expected_engines.erase(random_forest::kOptPred);
+  expected_engines.erase(gradient_boosted_trees::kNum8Bits);
+  expected_engines.erase(random_forest::kNum8Bits);
 
   const auto dataset = LoadDataset(model->data_spec(), GetParam().dataset,
                                    GetParam().dataset_format);
@@ -346,6 +353,13 @@ std::unordered_set<std::string> AllRFEngines() {
 INSTANTIATE_TEST_SUITE_P(
     AllCompatibleEnginesTests, AllCompatibleEnginesTest,
     testing::ValuesIn<AllCompatibleEnginesTestParams>({
+        {
+            "8bits_numerical_binary_class_gbdt",
+            "8bits_numerical_test.csv",
+            {gradient_boosted_trees::kGeneric,
+             gradient_boosted_trees::kQuickScorerExtended,
+             gradient_boosted_trees::kNum8Bits},
+        },
         {"abalone_regression_gbdt", "abalone.csv", AllGBTEngines()},
         {"abalone_regression_rf", "abalone.csv", AllRFEngines()},
         {"adult_binary_class_gbdt", "adult_test.csv", GBTQSAndGenericEngines()},
@@ -479,6 +493,122 @@ TEST(IrisMulticlassClassRF, ManualGeneric) {
       dataset, *model, engine);
 }
 
+TEST(IrisMulticlassClassRF, CompressLeafOutputs) {
+  const auto model = LoadModel("iris_multi_class_rf");
+  const auto dataset = LoadDataset(model->data_spec(), "iris.csv", "csv");
+
+  auto* rf_model = dynamic_cast<RandomForestModel*>(model.get());
+  RandomForestMulticlassClassification engine;
+  CHECK_OK(GenericToSpecializedModel(*rf_model, &engine));
+  const size_t num_trees = engine.root_offsets.size();
+
+  for (const auto quantization :
+       {LeafOutputQuantization::kFloat32, LeafOutputQuantization::kFloat16,
+        LeafOutputQuantization::kInt8}) {
+    SCOPED_TRACE(static_cast<int>(quantization));
+    auto compressed_engine = engine;
+    ASSERT_OK(CompressLeafOutputs(quantization, &compressed_engine));
+    if (quantization != LeafOutputQuantization::kFloat32) {
+      EXPECT_FALSE(CompressLeafOutputs(quantization, &compressed_engine).ok());
+    }
+    EXPECT_EQ(compressed_engine.label_buffer_quantization, quantization);
+    EXPECT_LT(ModelSizeInBytes(compressed_engine), ModelSizeInBytes(engine));
+
+    ASSERT_OK_AND_ASSIGN(
+        const auto difference,
+        ComparePredictions(engine, compressed_engine, dataset));
+    EXPECT_EQ(difference.num_examples, dataset.nrow());
+    switch (quantization) {
+      case LeafOutputQuantization::kFloat32:
+        EXPECT_EQ(difference.max_abs_diff, 0);
+        utils::ExpectEqualPredictionsTemplate<decltype(compressed_engine),
+                                              Predict>(dataset, *model,
+                                                       compressed_engine);
+        break;
+      case LeafOutputQuantization::kFloat16:
+        // The leaf values are smaller than 1 / num_trees.
+        EXPECT_LE(difference.max_abs_diff, 1. / 2048 + 1e-6);
+        EXPECT_LE(difference.argmax_disagreement_ratio, 0.01);
+        break;
+      case LeafOutputQuantization::kInt8:
+        // Each of the leaf value has an error smaller than 1 / (254 *
+        // num_trees).
+        EXPECT_LE(difference.max_abs_diff, 1. / 254 + 1e-6);
+        EXPECT_LE(difference.argmax_disagreement_ratio, 0.05);
+        break;
+    }
+    EXPECT_LE(difference.mean_abs_diff, difference.max_abs_diff);
+    EXPECT_EQ(compressed_engine.root_offsets.size(), num_trees);
+  }
+}
+
+TEST(IrisMulticlassClassRF, CreateEngineWithLeafOutputQuantization) {
+  const auto model = LoadModel("iris_multi_class_rf");
+  const auto dataset = LoadDataset(model->data_spec(), "iris.csv", "csv");
+
+  // The deduplication does not change the predictions.
+  EngineOptions options;
+  options.leaf_output_quantization = LeafOutputQuantization::kFloat32;
+  ASSERT_OK_AND_ASSIGN(auto engine,
+                       CreateEngine(*model, random_forest::kGeneric, options));
+  utils::ExpectEqualPredictions(dataset, *model, *engine);
+
+  // The quantization requires a dataset to check the predictions.
+  options.leaf_output_quantization = LeafOutputQuantization::kInt8;
+  EXPECT_THAT(CreateEngine(*model, random_forest::kGeneric, options).status(),
+              test::StatusIs(absl::StatusCode::kInvalidArgument));
+
+  // The predictions are checked when the engine is created.
+  options.leaf_output_quantization_dataset = &dataset;
+  options.max_leaf_output_quantization_abs_diff = 1e-6;
+  EXPECT_THAT(CreateEngine(*model, random_forest::kGeneric, options).status(),
+              test::StatusIs(absl::StatusCode::kInvalidArgument));
+
+  options.max_leaf_output_quantization_abs_diff = 0.01;
+  ASSERT_OK_AND_ASSIGN(engine,
+                       CreateEngine(*model, random_forest::kGeneric, options));
+  auto examples = engine->AllocateExamples(dataset.nrow());
+  ASSERT_OK(CopyVerticalDatasetToAbstractExampleSet(
+      dataset, 0, dataset.nrow(), engine->features(), examples.get()));
+  std::vector<float> predictions;
+  engine->Predict(*examples, dataset.nrow(), &predictions);
+  const int num_classes = engine->NumPredictionDimension();
+  ASSERT_EQ(predictions.size(), dataset.nrow() * num_classes);
+  for (int example_idx = 0; example_idx < dataset.nrow(); example_idx++) {
+    model::proto::Prediction prediction;
+    model->Predict(dataset, example_idx, &prediction);
+    const auto& distribution = prediction.classification().distribution();
+    for (int class_idx = 0; class_idx < num_classes; class_idx++) {
+      EXPECT_NEAR(predictions[example_idx * num_classes + class_idx],
+                  distribution.counts(class_idx + 1) / distribution.sum(),
+                  0.01);
+    }
+  }
+
+  // The option is ignored by the engines without multi-dimensional leaves.
+  const auto gbt_model = LoadModel("iris_multi_class_gbdt");
+  EXPECT_OK(CreateEngine(*gbt_model, gradient_boosted_trees::kGeneric, options)
+                .status());
+}
+
+TEST(DecisionForest, Float16) {
+  for (const float value : {0.f, 1.f, -1.f, 0.5f, 0.1f, -3.25f, 1000.f,
+                            65504.f, 0x1p-14f, 0x1p-24f, 3 * 0x1p-24f}) {
+    const float converted_value = Float16ToFloat(FloatToFloat16(value));
+    EXPECT_NEAR(converted_value, value, std::abs(value) * 0x1p-11f) << value;
+  }
+  // Exactly representable values.
+  EXPECT_EQ(Float16ToFloat(FloatToFloat16(0.5f)), 0.5f);
+  EXPECT_EQ(Float16ToFloat(FloatToFloat16(-3.25f)), -3.25f);
+  EXPECT_EQ(Float16ToFloat(FloatToFloat16(65504.f)), 65504.f);
+  EXPECT_EQ(Float16ToFloat(FloatToFloat16(0x1p-24f)), 0x1p-24f);
+  EXPECT_EQ(FloatToFloat16(1.f), 0x3c00);
+  EXPECT_EQ(FloatToFloat16(-2.f), 0xc000);
+  // Rounding to the nearest even value.
+  EXPECT_EQ(FloatToFloat16(1.f + 0x1p-11f), 0x3c00);
+  EXPECT_EQ(FloatToFloat16(1.f + 3 * 0x1p-11f), 0x3c02);
+}
+
 TEST(SimPTECategoricalupliftRF, ManualGeneric) {
   const auto model = LoadModel("sim_pte_categorical_uplift_rf");
   const auto dataset =
@@ -492,6 +622,182 @@ TEST(SimPTECategoricalupliftRF, ManualGeneric) {
       dataset, *model, engine);
 }
 
+TEST(DecisionForest, BatchedTraversal) {
+  // Numerical and categorical conditions.
+  const auto adult_model = LoadModel("adult_binary_class_gbdt");
+  const auto adult_dataset =
+      LoadDataset(adult_model->data_spec(), "adult_test.csv", "csv");
+  GradientBoostedTreesBinaryClassification adult_engine;
+  CHECK_OK(GenericToSpecializedModel(
+      *dynamic_cast<GradientBoostedTreesModel*>(adult_model.get()),
+      &adult_engine));
+  EXPECT_TRUE(adult_engine.batched_traversal);
+  utils::ExpectEqualPredictionsTemplate<decltype(adult_engine), Predict>(
+      adult_dataset, *adult_model, adult_engine);
+
+  // Categorical-set conditions.
+  const auto sst_model = LoadModel("sst_binary_class_gbdt");
+  const auto sst_dataset =
+      LoadDataset(sst_model->data_spec(), "sst_binary_test.csv", "csv");
+  GradientBoostedTreesBinaryClassification sst_engine;
+  CHECK_OK(GenericToSpecializedModel(
+      *dynamic_cast<GradientBoostedTreesModel*>(sst_model.get()), &sst_engine));
+  EXPECT_FALSE(sst_engine.batched_traversal);
+  utils::ExpectEqualPredictionsTemplate<decltype(sst_engine), Predict>(
+      sst_dataset, *sst_model, sst_engine);
+}
+
+TEST(DecisionForest, NodeLayouts) {
+  const auto model = LoadModel("adult_binary_class_gbdt");
+  const auto dataset =
+      LoadDataset(model->data_spec(), "adult_test.csv", "csv");
+  const auto* gbt_model =
+      dynamic_cast<const GradientBoostedTreesModel*>(model.get());
+
+  GradientBoostedTreesBinaryClassification depth_first_engine;
+  CHECK_OK(GenericToSpecializedModel(*gbt_model, &depth_first_engine));
+  EXPECT_EQ(depth_first_engine.node_layout, NodeLayout::kDepthFirst);
+
+  for (const auto node_layout :
+       {NodeLayout::kBreadthFirst, NodeLayout::kVisitFrequency}) {
+    GradientBoostedTreesBinaryClassification engine;
+    engine.node_layout = node_layout;
+    CHECK_OK(GenericToSpecializedModel(*gbt_model, &engine));
+
+    EXPECT_EQ(engine.node_layout, node_layout);
+    EXPECT_EQ(engine.root_offsets, depth_first_engine.root_offsets);
+    ASSERT_EQ(engine.nodes.size(), depth_first_engine.nodes.size());
+    int num_moved_nodes = 0;
+    for (int node_idx = 0; node_idx < engine.nodes.size(); node_idx++) {
+      num_moved_nodes += engine.nodes[node_idx].right_idx !=
+                         depth_first_engine.nodes[node_idx].right_idx;
+    }
+    EXPECT_GT(num_moved_nodes, 0) << NodeLayoutName(node_layout);
+
+    utils::ExpectEqualPredictionsTemplate<decltype(engine), Predict>(
+        dataset, *model, engine);
+  }
+}
+
+TEST(DecisionForest, PredictLeaves) {
+  for (const auto& [model_name, dataset_name] :
+       std::vector<std::pair<std::string, std::string>>{
+           {"adult_binary_class_gbdt", "adult_test.csv"},
+           {"sst_binary_class_gbdt", "sst_binary_test.csv"},
+           {"iris_multi_class_rf", "iris.csv"},
+       }) {
+    SCOPED_TRACE(model_name);
+    const auto model = LoadModel(model_name);
+    const auto dataset = LoadDataset(model->data_spec(), dataset_name, "csv");
+    const auto* df_model =
+        dynamic_cast<const model::DecisionForestInterface*>(model.get());
+    const int num_trees = df_model->num_trees();
+
+    std::vector<int32_t> expected_leaves(dataset.nrow() * num_trees);
+    for (int example_idx = 0; example_idx < dataset.nrow(); example_idx++) {
+      CHECK_OK(df_model->PredictGetLeaves(
+          dataset, example_idx,
+          absl::MakeSpan(expected_leaves)
+              .subspan(example_idx * num_trees, num_trees)));
+    }
+
+    ASSERT_OK_AND_ASSIGN(const auto engine, LeafIndexEngine::Create(*model));
+    EXPECT_EQ(engine->num_trees(), num_trees);
+    for (const int num_threads : {1, 3}) {
+      std::vector<int32_t> leaves(dataset.nrow() * num_trees, -1);
+      ASSERT_OK(engine->PredictLeaves(dataset, num_threads,
+                                      absl::MakeSpan(leaves)));
+      EXPECT_EQ(leaves, expected_leaves);
+    }
+
+    // Wrong output size.
+    std::vector<int32_t> leaves(num_trees);
+    EXPECT_FALSE(
+        engine->PredictLeaves(dataset, 1, absl::MakeSpan(leaves)).ok());
+  }
+}
+
+// GBT with a single condition "c in {2}" on a categorical feature. If
+// "global_imputation" is true, the missing values follow the most frequent
+// value (1) i.e. the negative branch.
+std::unique_ptr<GradientBoostedTreesModel> BuildCategoricalGBT(
+    const bool global_imputation) {
+  auto model = absl::make_unique<GradientBoostedTreesModel>();
+  model->set_task(model::proto::Task::REGRESSION);
+  model->set_label_col_idx(0);
+  const dataset::proto::DataSpecification data_spec = PARSE_TEST_PROTO(R"pb(
+    columns { type: NUMERICAL name: "l" }
+    columns {
+      type: CATEGORICAL
+      name: "c"
+      categorical {
+        number_of_unique_values: 3
+        most_frequent_value: 1
+        is_already_integerized: true
+      }
+    }
+  )pb");
+  model->set_data_spec(data_spec);
+  model->set_loss(model::gradient_boosted_trees::proto::Loss::SQUARED_ERROR);
+  model->mutable_initial_predictions()->push_back(0);
+  model->mutable_input_features()->push_back(1);
+
+  auto tree = absl::make_unique<model::decision_tree::DecisionTree>();
+  tree->CreateRoot();
+  auto* root = tree->mutable_root();
+  root->CreateChildren();
+  auto* condition = root->mutable_node()->mutable_condition();
+  condition->set_attribute(1);
+  condition->mutable_condition()->mutable_contains_condition()->add_elements(
+      2);
+  condition->set_na_value(!global_imputation);
+  root->mutable_pos_child()->mutable_node()->mutable_regressor()->set_top_value(
+      1.f);
+  root->mutable_neg_child()->mutable_node()->mutable_regressor()->set_top_value(
+      2.f);
+  tree->SetLeafIndices();
+  model->mutable_decision_trees()->push_back(std::move(tree));
+  return model;
+}
+
+// The leaf index engine imputes the missing values globally. It is not
+// available for the other models.
+TEST(DecisionForest, PredictLeavesMissingValues) {
+  for (const bool global_imputation : {false, true}) {
+    SCOPED_TRACE(global_imputation);
+    const auto model = BuildCategoricalGBT(global_imputation);
+    dataset::VerticalDataset dataset;
+    dataset.set_data_spec(model->data_spec());
+    ASSERT_OK(dataset.CreateColumnsFromDataspec());
+    ASSERT_OK(dataset.AppendExampleWithStatus({{"l", "0"}, {"c", "1"}}));
+    ASSERT_OK(dataset.AppendExampleWithStatus({{"l", "0"}, {"c", "2"}}));
+    ASSERT_OK(dataset.AppendExampleWithStatus({{"l", "0"}}));
+    ASSERT_TRUE(dataset.column(1)->IsNa(2));
+
+    std::vector<int32_t> expected_leaves(dataset.nrow());
+    for (int example_idx = 0; example_idx < dataset.nrow(); example_idx++) {
+      ASSERT_OK(model->PredictGetLeaves(
+          dataset, example_idx,
+          absl::MakeSpan(expected_leaves).subspan(example_idx, 1)));
+    }
+    EXPECT_NE(expected_leaves[0], expected_leaves[1]);
+    EXPECT_EQ(expected_leaves[2],
+              global_imputation ? expected_leaves[0] : expected_leaves[1]);
+
+    const auto engine = LeafIndexEngine::Create(*model);
+    if (!global_imputation) {
+      EXPECT_THAT(engine.status(),
+                  test::StatusIs(absl::StatusCode::kFailedPrecondition));
+      continue;
+    }
+    ASSERT_OK(engine.status());
+    std::vector<int32_t> leaves(dataset.nrow(), -1);
+    ASSERT_OK(engine.value()->PredictLeaves(dataset, /*num_threads=*/1,
+                                            absl::MakeSpan(leaves)));
+    EXPECT_EQ(leaves, expected_leaves);
+  }
+}
+
 void BuildFullTree(const int d, model::decision_tree::NodeWithChildren* node) {
   if (d <= 0) {
     node->mutable_node()->mutable_classifier()->set_top_value(1.f);
@@ -649,6 +955,45 @@ TEST(DecisionForest, NonGlobalImputationGeneric) {
   CheckNonGlobalImputationPredictions(predictions);
 }
 
+// Same as "NonGlobalImputationGeneric" with enough examples to fill the
+// batches of the batched traversal.
+TEST(DecisionForest, NonGlobalImputationGenericBatchedTraversal) {
+  auto model = BuildNonGlobalImputationGBT();
+
+  GradientBoostedTreesRegression engine;
+  CHECK_OK(GenericToSpecializedModel(*model.get(), &engine));
+  EXPECT_TRUE(engine.batched_traversal);
+
+  const float kMissing = std::numeric_limits<float>::quiet_NaN();
+  const std::vector<float> values_b = {2.f, 0.f, 0.f, 2.f, 2.f, 0.f};
+  const std::vector<float> values_c = {kMissing, 3.f, kMissing, 0.f, 3.f, 0.f};
+  const std::vector<float> expected_predictions = {4.f, 2.f, 1.f,
+                                                   3.f, 4.f, 1.f};
+
+  const int num_examples = 19;
+  const auto& fs = engine.features();
+  const auto feature_b = fs.GetNumericalFeatureId("b").value();
+  const auto feature_c = fs.GetNumericalFeatureId("c").value();
+  GradientBoostedTreesRegression::ExampleSet examples(num_examples, engine);
+  for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+    const int pattern_idx = example_idx % values_b.size();
+    examples.SetNumerical(example_idx, feature_b, values_b[pattern_idx], fs);
+    if (std::isnan(values_c[pattern_idx])) {
+      examples.SetMissingNumerical(example_idx, feature_c, fs);
+    } else {
+      examples.SetNumerical(example_idx, feature_c, values_c[pattern_idx], fs);
+    }
+  }
+
+  std::vector<float> predictions;
+  Predict(engine, examples, num_examples, &predictions);
+  ASSERT_EQ(predictions.size(), num_examples);
+  for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+    EXPECT_NEAR(predictions[example_idx],
+                expected_predictions[example_idx % values_b.size()], 0.0001);
+  }
+}
+
 TEST(DecisionForest, NonGlobalImputationQuickScorer) {
   auto model = BuildNonGlobalImputationGBT();
 
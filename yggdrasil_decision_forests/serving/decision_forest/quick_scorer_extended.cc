@@ -17,9 +17,28 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "absl/status/status.h"
 
-#ifdef __AVX2__
+// With GCC and Clang on x86-64, the AVX-512 implementation is compiled with a
+// function level "target" attribute: It is available even if the binary is not
+// compiled with "-mavx512f", and it is selected at runtime according to the CPU
+// support. With other compilers (e.g. MSVC), the AVX-512 implementation is only
+// available if the binary is compiled with "-mavx512f".
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define YDF_QUICK_SCORER_AVX512
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#elif defined(__AVX512F__)
+#define YDF_QUICK_SCORER_AVX512
+#define TARGET_AVX512
+#endif
+
+// At least one of the SIMD implementations is available. The SIMD
+// implementations require an aligned "active_leaf_buffer".
+#if defined(__AVX2__) || defined(YDF_QUICK_SCORER_AVX512)
+#define YDF_QUICK_SCORER_SIMD
 #include <immintrin.h>
 #endif
 
@@ -50,7 +69,7 @@ namespace {
 constexpr size_t kMaxStackUsageInBytes = 16 * 1024;
 
 namespace portable {
-#ifdef __AVX2__
+#ifdef YDF_QUICK_SCORER_SIMD
 void* aligned_alloc(std::size_t alignment, std::size_t size) {
 #if defined(_WIN32)
   // Visual Studio
@@ -108,7 +127,7 @@ absl::Status InitializeAccumulator(
             accumulator->categorical_contains_conditions[feature.spec_idx];
         feature_acc.internal_feature_idx = feature.internal_idx;
         feature_acc.items.assign(
-            src.NumTrees() *
+            dst.NumLeafMasks() *
                 feature_spec.categorical().number_of_unique_values(),
             ~internal::QuickScorerExtendedModel::kZeroLeafMask);
       } break;
@@ -198,6 +217,59 @@ absl::Status FinalizeModel(
   return absl::OkStatus();
 }
 
+// Leaf masks of the tree "tree_idx" in which the leafs in
+// [begin_leaf_idx, end_leaf_idx) are hidden (i.e. set to 0) and the other leafs
+// are visible (i.e. set to 1). Only the leaf masks containing at least one
+// hidden leaf are returned.
+std::vector<internal::QuickScorerExtendedModel::ConditionItem>
+NegativeBranchLeafMasks(
+    const internal::QuickScorerExtendedModel::TreeIdx tree_idx,
+    const int begin_leaf_idx, const int end_leaf_idx,
+    const int num_leaf_masks_per_tree) {
+  using Model = internal::QuickScorerExtendedModel;
+  constexpr int kNumLeafsPerMask = Model::kNumLeafsPerMask;
+  std::vector<Model::ConditionItem> masks;
+  if (begin_leaf_idx >= end_leaf_idx) {
+    return masks;
+  }
+  const int begin_mask = begin_leaf_idx / kNumLeafsPerMask;
+  const int end_mask = (end_leaf_idx - 1) / kNumLeafsPerMask + 1;
+  for (int mask_idx = begin_mask; mask_idx < end_mask; mask_idx++) {
+    // Range of hidden leafs in the leaf mask.
+    const int begin_bit =
+        std::max(begin_leaf_idx - mask_idx * kNumLeafsPerMask, 0);
+    const int end_bit =
+        std::min(end_leaf_idx - mask_idx * kNumLeafsPerMask, kNumLeafsPerMask);
+    const LeafMask start_leaf_mask = (Model::kOneLeafMask << begin_bit) - 1;
+    const LeafMask after_neg_mask = end_bit == kNumLeafsPerMask
+                                        ? ~Model::kZeroLeafMask
+                                        : (Model::kOneLeafMask << end_bit) - 1;
+    masks.push_back({/*.mask_idx =*/static_cast<Model::TreeIdx>(
+                         tree_idx * num_leaf_masks_per_tree + mask_idx),
+                     /*.leaf_mask =*/~(after_neg_mask ^ start_leaf_mask)});
+  }
+  return masks;
+}
+
+// Index of the first active leaf of a tree. "active_leaf_masks" points to the
+// first leaf mask of the tree. The leaf masks of the tree are separated by
+// "stride" elements.
+template <int stride>
+int FirstActiveLeaf(const LeafMask* active_leaf_masks,
+                    const int num_leaf_masks_per_tree) {
+  for (int mask_idx = 0; mask_idx < num_leaf_masks_per_tree - 1; mask_idx++) {
+    const auto mask = active_leaf_masks[mask_idx * stride];
+    if (mask) {
+      return mask_idx * internal::QuickScorerExtendedModel::kNumLeafsPerMask +
+             FindLSBSetNonZero64(mask);
+    }
+  }
+  // Note: A tree always has at least one active leaf.
+  const int last_mask_idx = num_leaf_masks_per_tree - 1;
+  return last_mask_idx * internal::QuickScorerExtendedModel::kNumLeafsPerMask +
+         FindLSBSetNonZero64(active_leaf_masks[last_mask_idx * stride]);
+}
+
 // Adds the content of a node (and its children i.e. recursive visit) to the
 // quick scorer tree structure.
 template <typename AbstractModel>
@@ -209,7 +281,8 @@ absl::Status FillQuickScorerNode(
     internal::QuickScorerExtendedModel::BuildingAccumulator* accumulator) {
   if (src_node.IsLeaf()) {
     // Store the lead value.
-    if (*leaf_idx >= internal::QuickScorerExtendedModel::kMaxLeafs) {
+    if (*leaf_idx >= internal::QuickScorerExtendedModel::kNumLeafsPerMask *
+                         dst->num_leaf_masks_per_tree) {
       return absl::InternalError("Leaf idx too large");
     }
     if (*leaf_idx >= dst->max_num_leafs_per_tree) {
@@ -234,22 +307,17 @@ absl::Status FillQuickScorerNode(
     // Index of the feature used by the node.
     const int spec_feature_idx = src_node.node().condition().attribute();
 
-    // Compute the bitmap mask i.e. the bitmap that hide the leafs of the
-    // negative branch.
+    // Compute the bitmap masks i.e. the bitmaps that hide the leafs of the
+    // negative branch. Only the leaf masks overlapping the negative branch are
+    // listed.
     //
     // Example:
     // If begin_neg_leaf_idx=2 and end_neg_leaf_idx = 5, the mask will be:
     //   "1100011111" + 54 * "1" (lower bit on the left).
     const auto end_neg_leaf_idx = *leaf_idx;
-    const auto start_leaf_mask =
-        (internal::QuickScorerExtendedModel::kOneLeafMask
-         << begin_neg_leaf_idx) -
-        1;
-    const auto after_neg_mask =
-        (internal::QuickScorerExtendedModel::kOneLeafMask << end_neg_leaf_idx) -
-        1;
-    internal::QuickScorerExtendedModel::LeafMask mask =
-        ~(after_neg_mask ^ start_leaf_mask);
+    const auto masks =
+        NegativeBranchLeafMasks(tree_idx, begin_neg_leaf_idx, end_neg_leaf_idx,
+                                dst->num_leaf_masks_per_tree);
 
     const auto& condition = src_node.node().condition().condition();
     // Branch to take is case of missing value. Can be ignored in the case of
@@ -261,22 +329,25 @@ absl::Status FillQuickScorerNode(
 
     auto set_numerical_higher = [&]() {
       const auto threshold = condition.higher_condition().threshold();
-      accumulator->is_higher_conditions[spec_feature_idx].items.push_back(
-          {/*.threshold =*/threshold, /*.tree_idx =*/tree_idx,
-           /*.leaf_mask =*/mask});
-
-      if (src_node.node().condition().na_value()) {
-        // The condition evaluates to true when the attribute is missing.
-        accumulator->is_higher_conditions[spec_feature_idx]
-            .missing_value_items.push_back({/*.tree_idx =*/tree_idx,
-                                            /*.leaf_mask =*/mask});
+      for (const auto& mask : masks) {
+        accumulator->is_higher_conditions[spec_feature_idx].items.push_back(
+            {/*.threshold =*/threshold, /*.mask_idx =*/mask.mask_idx,
+             /*.leaf_mask =*/mask.leaf_mask});
+
+        if (src_node.node().condition().na_value()) {
+          // The condition evaluates to true when the attribute is missing.
+          accumulator->is_higher_conditions[spec_feature_idx]
+              .missing_value_items.push_back(mask);
+        }
       }
     };
 
     auto set_boolean_is_true = [&]() {
-      accumulator->is_higher_conditions[spec_feature_idx].items.push_back(
-          {/*.threshold =*/0.5f, /*.tree_idx =*/tree_idx,
-           /*.leaf_mask =*/mask});
+      for (const auto& mask : masks) {
+        accumulator->is_higher_conditions[spec_feature_idx].items.push_back(
+            {/*.threshold =*/0.5f, /*.mask_idx =*/mask.mask_idx,
+             /*.leaf_mask =*/mask.leaf_mask});
+      }
     };
 
     auto set_discretized_numerical_higher = [&]() {
@@ -284,16 +355,35 @@ absl::Status FillQuickScorerNode(
           condition.discretized_higher_condition().threshold();
       const float threshold = attribute_spec.discretized_numerical().boundaries(
           discretized_threshold - 1);
-      accumulator->is_higher_conditions[spec_feature_idx].items.push_back(
-          {/*.threshold = */ threshold, /*.tree_idx =*/tree_idx,
-           /*.leaf_mask =*/mask});
+      for (const auto& mask : masks) {
+        accumulator->is_higher_conditions[spec_feature_idx].items.push_back(
+            {/*.threshold = */ threshold, /*.mask_idx =*/mask.mask_idx,
+             /*.leaf_mask =*/mask.leaf_mask});
+      }
+    };
+
+    auto and_categorical_contains = [&](const int feature_value) {
+      auto& items =
+          accumulator->categorical_contains_conditions[spec_feature_idx].items;
+      for (const auto& mask : masks) {
+        items[mask.mask_idx + feature_value * dst->NumLeafMasks()] &=
+            mask.leaf_mask;
+      }
+    };
+
+    auto and_categoricalset_contains = [&](const int feature_value) {
+      for (const auto& mask : masks) {
+        internal::AndMaskMap(
+            mask.mask_idx, mask.leaf_mask,
+            &accumulator->categoricalset_contains_conditions[spec_feature_idx]
+                 .masks[feature_value]);
+      }
     };
 
     auto set_categorical_contains = [&]() {
       const auto elements = condition.contains_condition().elements();
       for (const auto feature_value : elements) {
-        accumulator->categorical_contains_conditions[spec_feature_idx]
-            .items[tree_idx + feature_value * dst->num_trees] &= mask;
+        and_categorical_contains(feature_value);
       }
     };
 
@@ -305,8 +395,7 @@ absl::Status FillQuickScorerNode(
       for (int feature_value = 0; feature_value < num_unique_values;
            ++feature_value) {
         if (utils::bitmap::GetValueBit(bitmap, feature_value)) {
-          accumulator->categorical_contains_conditions[spec_feature_idx]
-              .items[tree_idx + feature_value * dst->num_trees] &= mask;
+          and_categorical_contains(feature_value);
         }
       }
     };
@@ -314,25 +403,16 @@ absl::Status FillQuickScorerNode(
     auto set_categoricalset_contains = [&]() {
       const auto elements = condition.contains_condition().elements();
       if (na_value) {
-        internal::AndMaskMap(
-            tree_idx, mask,
-            &accumulator->categoricalset_contains_conditions[spec_feature_idx]
-                 .masks[0]);
+        and_categoricalset_contains(0);
       }
       for (const auto feature_value : elements) {
-        internal::AndMaskMap(
-            tree_idx, mask,
-            &accumulator->categoricalset_contains_conditions[spec_feature_idx]
-                 .masks[feature_value + 1]);
+        and_categoricalset_contains(feature_value + 1);
       }
     };
 
     auto set_categoricalset_bitmap_contains = [&]() {
       if (na_value) {
-        internal::AndMaskMap(
-            tree_idx, mask,
-            &accumulator->categoricalset_contains_conditions[spec_feature_idx]
-                 .masks[0]);
+        and_categoricalset_contains(0);
       }
       const auto bitmap =
           condition.contains_bitmap_condition().elements_bitmap();
@@ -341,10 +421,7 @@ absl::Status FillQuickScorerNode(
       for (int feature_value = 0; feature_value < num_unique_values;
            ++feature_value) {
         if (utils::bitmap::GetValueBit(bitmap, feature_value)) {
-          internal::AndMaskMap(
-              tree_idx, mask,
-              &accumulator->categoricalset_contains_conditions[spec_feature_idx]
-                   .masks[feature_value + 1]);
+          and_categoricalset_contains(feature_value + 1);
         }
       }
     };
@@ -404,8 +481,6 @@ template <typename AbstractModel>
 absl::Status FillQuickScorer(
     const AbstractModel& src, internal::QuickScorerExtendedModel* dst,
     internal::QuickScorerExtendedModel::BuildingAccumulator* accumulator) {
-  RETURN_IF_ERROR(InitializeAccumulator(src, *dst, accumulator));
-
   dst->initial_prediction = src.initial_predictions()[0];
   dst->output_logits = src.output_logits();
   dst->num_trees = src.NumTrees();
@@ -432,6 +507,19 @@ absl::Status FillQuickScorer(
         absl::Substitute("The model contains trees with more than $0 leafs",
                          internal::QuickScorerExtendedModel::kMaxLeafs));
   }
+  constexpr int kNumLeafsPerMask =
+      internal::QuickScorerExtendedModel::kNumLeafsPerMask;
+  dst->num_leaf_masks_per_tree = std::max(
+      1, (dst->max_num_leafs_per_tree + kNumLeafsPerMask - 1) /
+             kNumLeafsPerMask);
+  if (static_cast<size_t>(dst->num_trees) * dst->num_leaf_masks_per_tree >
+      internal::QuickScorerExtendedModel::kMaxTrees) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "The model contains more than $0 leaf masks",
+        internal::QuickScorerExtendedModel::kMaxTrees));
+  }
+
+  RETURN_IF_ERROR(InitializeAccumulator(src, *dst, accumulator));
 
   dst->leaf_values.assign(dst->max_num_leafs_per_tree * dst->num_trees, 0.f);
 
@@ -451,7 +539,7 @@ absl::Status FillQuickScorer(
 // Tree inference without SIMD i.e. one example at a time.
 // This method is used for the examples outside of the SIMD batch.
 //
-// "active_leaf_buffer" is a pre-allocated buffer of at least "num-trees"
+// "active_leaf_buffer" is a pre-allocated buffer of at least "NumLeafMasks()"
 // elements.
 template <typename Model, float (*Activation)(float)>
 void PredictQuickScorerSequential(
@@ -462,7 +550,8 @@ void PredictQuickScorerSequential(
     const int begin_example_idx, const int end_example_idx,
     const int major_feature_offset, std::vector<float>* predictions,
     internal::QuickScorerExtendedModel::LeafMask* active_leaf_buffer) {
-  const size_t active_leaf_buffer_size = model.num_trees * sizeof(LeafMask);
+  const size_t active_leaf_buffer_size =
+      model.NumLeafMasks() * sizeof(LeafMask);
 
   const auto index = [&major_feature_offset](const int feature_idx,
                                              const int example_idx) -> int {
@@ -486,12 +575,12 @@ void PredictQuickScorerSequential(
           if (item.threshold > feature_value) {
             break;
           }
-          active_leaf_buffer[item.tree_idx] &= item.leaf_mask;
+          active_leaf_buffer[item.mask_idx] &= item.leaf_mask;
         }
 
       } else {
         for (const auto& item : is_higher_condition.missing_value_items) {
-          active_leaf_buffer[item.tree_idx] &= item.leaf_mask;
+          active_leaf_buffer[item.mask_idx] &= item.leaf_mask;
         }
       }
     }
@@ -503,12 +592,13 @@ void PredictQuickScorerSequential(
           fixed_length_features[index(contains_condition.internal_feature_idx,
                                       example_idx)]
               .categorical_value;
-      DCHECK_LE(model.num_trees * (feature_value + 1),
+      DCHECK_LE(model.NumLeafMasks() * (feature_value + 1),
                 contains_condition.items.size());
       const auto* leaf_mask_stream =
-          &contains_condition.items[model.num_trees * feature_value];
-      for (int tree_idx = 0; tree_idx < model.num_trees; ++tree_idx) {
-        active_leaf_buffer[tree_idx] &= *(leaf_mask_stream++);
+          &contains_condition.items[model.NumLeafMasks() * feature_value];
+      const int num_leaf_masks = model.NumLeafMasks();
+      for (int mask_idx = 0; mask_idx < num_leaf_masks; ++mask_idx) {
+        active_leaf_buffer[mask_idx] &= *(leaf_mask_stream++);
       }
     }
 
@@ -534,8 +624,9 @@ void PredictQuickScorerSequential(
     auto* leaf_reader = model.leaf_values.data();
     float output = model.initial_prediction;
     for (int tree_idx = 0; tree_idx < model.num_trees; ++tree_idx) {
-      const auto shift_mask = active_leaf_buffer[tree_idx];
-      const auto node_idx = FindLSBSetNonZero64(shift_mask);
+      const auto node_idx = FirstActiveLeaf</*stride=*/1>(
+          &active_leaf_buffer[tree_idx * model.num_leaf_masks_per_tree],
+          model.num_leaf_masks_per_tree);
       output += leaf_reader[node_idx];
       leaf_reader += model.max_num_leafs_per_tree;
     }
@@ -544,6 +635,195 @@ void PredictQuickScorerSequential(
   }
 }
 
+#ifdef YDF_QUICK_SCORER_SIMD
+// Applies the contains conditions, and sums the leaf values, of a batch of
+// "kNumParallelExamples" consecutive examples starting at "example_idx". The
+// is-higher conditions are expected to be already applied on
+// "active_leaf_buffer" (with the layout "mask_idx * kNumParallelExamples +
+// sub_example_idx").
+//
+// "sample_reader" and "prediction_reader" point to the first example of the
+// batch.
+template <typename Model, float (*Activation)(float), int kNumParallelExamples>
+void FinalizeQuickScorerBatch(
+    const Model& model, const NumericalOrCategoricalValue* sample_reader,
+    const std::vector<Rangei32>& categorical_set_begins_and_ends,
+    const std::vector<int32_t>& categorical_item_buffer, const int example_idx,
+    const int major_feature_offset, LeafMask* active_leaf_buffer,
+    float* prediction_reader) {
+  // Dense contains conditions.
+  for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
+       ++sub_example_idx) {
+    for (const auto& contains_condition :
+         model.categorical_contains_conditions) {
+      const auto feature_value =
+          sample_reader[contains_condition.internal_feature_idx *
+                            major_feature_offset +
+                        sub_example_idx]
+              .categorical_value;
+      const auto* leaf_mask_stream =
+          &contains_condition.items[model.NumLeafMasks() * feature_value];
+      const int num_leaf_masks = model.NumLeafMasks();
+      for (int mask_idx = 0; mask_idx < num_leaf_masks; ++mask_idx) {
+        active_leaf_buffer[mask_idx * kNumParallelExamples + sub_example_idx] &=
+            *(leaf_mask_stream++);
+      }
+    }
+  }
+
+  // Sparse contains conditions.
+  for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
+       ++sub_example_idx) {
+    for (const auto& contains_condition :
+         model.categoricalset_contains_conditions) {
+      const auto& range_values = categorical_set_begins_and_ends
+          [contains_condition.internal_feature_idx * major_feature_offset +
+           sub_example_idx + example_idx];
+      for (int value_idx = range_values.begin; value_idx < range_values.end;
+           value_idx++) {
+        const auto value = categorical_item_buffer[value_idx] + 1;
+        const auto& range_masks = contains_condition.value_to_mask_range[value];
+        for (int mask_idx = range_masks.first; mask_idx < range_masks.second;
+             mask_idx++) {
+          const auto& mask = contains_condition.mask_buffer[mask_idx];
+          active_leaf_buffer[mask.first * kNumParallelExamples +
+                             sub_example_idx] &= mask.second;
+        }
+      }
+    }
+  }
+
+#pragma loop unroll(full)
+  for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
+       ++sub_example_idx) {
+    prediction_reader[sub_example_idx] = model.initial_prediction;
+  }
+
+  auto* leaf_reader = model.leaf_values.data();
+  for (int tree_idx = 0; tree_idx < model.num_trees; ++tree_idx) {
+#pragma loop unroll(full)
+    for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
+         ++sub_example_idx) {
+      const auto node_idx = FirstActiveLeaf<kNumParallelExamples>(
+          &active_leaf_buffer[tree_idx * model.num_leaf_masks_per_tree *
+                                  kNumParallelExamples +
+                              sub_example_idx],
+          model.num_leaf_masks_per_tree);
+      prediction_reader[sub_example_idx] += leaf_reader[node_idx];
+    }
+    leaf_reader += model.max_num_leafs_per_tree;
+  }
+
+// Note: The compiler should be able to remove the following loop when
+// Activation == Identity. Tested with gcc9 and clang9.
+#pragma loop unroll(full)
+  for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
+       ++sub_example_idx) {
+    prediction_reader[sub_example_idx] =
+        Activation(prediction_reader[sub_example_idx]);
+  }
+}
+#endif
+
+#ifdef YDF_QUICK_SCORER_AVX512
+// Tree inference with AVX-512 i.e. 16 examples at a time. The 16 leaf masks
+// (64 bits each) of a tree are stored in two 512-bits registers. Returns the
+// number of processed examples i.e. the largest multiple of 16 lower or equal
+// to "num_examples". The remaining examples are not processed.
+//
+// "active_leaf_buffer" is a 64-bytes aligned buffer of at least
+// "NumLeafMasks() * 16" elements.
+template <typename Model, float (*Activation)(float)>
+TARGET_AVX512 int PredictQuickScorerAVX512(
+    const Model& model,
+    const std::vector<NumericalOrCategoricalValue>& fixed_length_features,
+    const std::vector<Rangei32>& categorical_set_begins_and_ends,
+    const std::vector<int32_t>& categorical_item_buffer, const int num_examples,
+    const int major_feature_offset, std::vector<float>* predictions,
+    LeafMask* active_leaf_buffer) {
+  constexpr int kNumParallelExamples = 16;
+  const size_t active_leaf_buffer_size =
+      model.NumLeafMasks() * kNumParallelExamples * sizeof(LeafMask);
+
+  auto* sample_reader = fixed_length_features.data();
+  auto* prediction_reader = predictions->data();
+
+  int example_idx = 0;
+  int num_remaining_iters = num_examples / kNumParallelExamples;
+  while (num_remaining_iters--) {
+    // Reset active node buffer.
+    std::memset(active_leaf_buffer, 0xFF, active_leaf_buffer_size);
+
+    // Is higher conditions.
+    for (const auto& is_higher_condition : model.is_higher_conditions) {
+      const float* begin_example =
+          &sample_reader[0].numerical_value +
+          is_higher_condition.internal_feature_idx * major_feature_offset;
+
+      const auto feature_values = _mm512_loadu_ps(begin_example);
+
+      if (!model.global_imputation_optimization) {
+        // Bitmask of the missing values.
+        const __mmask16 is_nan =
+            _mm512_cmp_ps_mask(feature_values, feature_values, _CMP_UNORD_Q);
+        if (is_nan) {
+          const __mmask8 is_nan_lo = static_cast<__mmask8>(is_nan);
+          const __mmask8 is_nan_hi = static_cast<__mmask8>(is_nan >> 8);
+          for (const auto& item : is_higher_condition.missing_value_items) {
+            auto* active = reinterpret_cast<__m512i*>(
+                &active_leaf_buffer[item.mask_idx * kNumParallelExamples]);
+            const auto mask = _mm512_set1_epi64(item.leaf_mask);
+            // active[i] &= mask iif. the i-th value is missing.
+            const auto active_lo = _mm512_load_si512(active);
+            const auto active_hi = _mm512_load_si512(active + 1);
+            _mm512_store_si512(
+                active, _mm512_mask_and_epi64(active_lo, is_nan_lo, active_lo,
+                                              mask));
+            _mm512_store_si512(
+                active + 1, _mm512_mask_and_epi64(active_hi, is_nan_hi,
+                                                  active_hi, mask));
+          }
+          // Missing values are represented as Nan. They will fail at the
+          // first comparison "value >= threshold" in the next loop.
+        }
+      }
+
+      for (const auto& item : is_higher_condition.items) {
+        const __mmask16 comparison = _mm512_cmp_ps_mask(
+            feature_values, _mm512_set1_ps(item.threshold), _CMP_GE_OQ);
+        if (!comparison) {
+          break;
+        }
+        auto* active = reinterpret_cast<__m512i*>(
+            &active_leaf_buffer[item.mask_idx * kNumParallelExamples]);
+        const auto mask = _mm512_set1_epi64(item.leaf_mask);
+        // active[i] &= mask iif. the condition is true for the i-th example.
+        const auto active_lo = _mm512_load_si512(active);
+        const auto active_hi = _mm512_load_si512(active + 1);
+        _mm512_store_si512(
+            active,
+            _mm512_mask_and_epi64(active_lo, static_cast<__mmask8>(comparison),
+                                  active_lo, mask));
+        _mm512_store_si512(
+            active + 1, _mm512_mask_and_epi64(
+                            active_hi, static_cast<__mmask8>(comparison >> 8),
+                            active_hi, mask));
+      }
+    }
+
+    FinalizeQuickScorerBatch<Model, Activation, kNumParallelExamples>(
+        model, sample_reader, categorical_set_begins_and_ends,
+        categorical_item_buffer, example_idx, major_feature_offset,
+        active_leaf_buffer, prediction_reader);
+
+    sample_reader += kNumParallelExamples;
+    prediction_reader += kNumParallelExamples;
+    example_idx += kNumParallelExamples;
+  }
+  return example_idx;
+}
+#endif
+
 }  // namespace
 
 // Apply the quick scorer algorithm.
@@ -571,14 +851,26 @@ void PredictQuickScorerMajorFeatureOffset(
   // instructions. If the number of examples is not a multiple of
   // "kNumParallelExamples", the remaining examples are treated with
   // "PredictQuickScorerSequential".
+  //
+  // With AVX-512, the examples are first processed 16 at a time with
+  // "PredictQuickScorerAVX512", and the buffer is sized accordingly.
   constexpr int kNumParallelExamples = 4;
+  int max_num_parallel_examples = kNumParallelExamples;
+#ifdef YDF_QUICK_SCORER_AVX512
+  if (model.cpu_supports_avx512) {
+    max_num_parallel_examples = 16;
+  }
+#endif
 
   const size_t active_leaf_buffer_size =
-      model.num_trees * kNumParallelExamples * sizeof(LeafMask);
-  const size_t alignment = 32 * 8;
+      model.NumLeafMasks() * kNumParallelExamples * sizeof(LeafMask);
+  const size_t allocated_active_leaf_buffer_size =
+      model.NumLeafMasks() * max_num_parallel_examples * sizeof(LeafMask);
+  // Alignment of the buffer in bytes.
+  const size_t alignment = 64;
 
   // Make sure the allocated chunk of memory is a multiple of "alignment".
-  size_t rounded_up_active_leaf_buffer_size = active_leaf_buffer_size;
+  size_t rounded_up_active_leaf_buffer_size = allocated_active_leaf_buffer_size;
   if ((rounded_up_active_leaf_buffer_size % alignment) != 0) {
     rounded_up_active_leaf_buffer_size +=
         alignment - rounded_up_active_leaf_buffer_size % alignment;
@@ -587,22 +879,23 @@ void PredictQuickScorerMajorFeatureOffset(
   // Note: Alloca was measured to be faster and more consistent (in terms of
   // speed) than malloc or pre-allocated caches.
   //
-  // The buffer must be aligned on a 32-byte boundary to work with _mm256
-  // class of SIMD instructions (intrinsics).
+  // The buffer must be aligned on a 32-byte (resp. 64-byte) boundary to work
+  // with _mm256 (resp. _mm512) class of SIMD instructions (intrinsics).
   LeafMask* active_leaf_buffer;
   const bool active_leaf_buffer_uses_stack =
-      active_leaf_buffer_size <= kMaxStackUsageInBytes;
+      allocated_active_leaf_buffer_size <= kMaxStackUsageInBytes;
 
   if (active_leaf_buffer_uses_stack) {
-#ifdef __AVX2__
+#ifdef YDF_QUICK_SCORER_SIMD
 
 #if defined(_WIN32)
     void* non_aligned = alloca(rounded_up_active_leaf_buffer_size + alignment);
     std::size_t space = rounded_up_active_leaf_buffer_size + alignment;
     void* aligned = std::align(alignment, 1, non_aligned, space);
 #else
+    // Note: The alignment of "__builtin_alloca_with_align" is in bits.
     void* aligned = __builtin_alloca_with_align(
-        rounded_up_active_leaf_buffer_size, alignment);
+        rounded_up_active_leaf_buffer_size, alignment * 8);
 #endif
     active_leaf_buffer = reinterpret_cast<LeafMask*>(aligned);
 
@@ -611,7 +904,7 @@ void PredictQuickScorerMajorFeatureOffset(
         reinterpret_cast<LeafMask*>(alloca(rounded_up_active_leaf_buffer_size));
 #endif
   } else {
-#ifdef __AVX2__
+#ifdef YDF_QUICK_SCORER_SIMD
     active_leaf_buffer = reinterpret_cast<LeafMask*>(
         portable::aligned_alloc(alignment, rounded_up_active_leaf_buffer_size));
 #else
@@ -622,14 +915,24 @@ void PredictQuickScorerMajorFeatureOffset(
 
   int example_idx = 0;
 
+#ifdef YDF_QUICK_SCORER_AVX512
+  if (model.cpu_supports_avx512) {
+    example_idx = PredictQuickScorerAVX512<Model, Activation>(
+        model, fixed_length_features, categorical_set_begins_and_ends,
+        categorical_item_buffer, num_examples, major_feature_offset,
+        predictions, active_leaf_buffer);
+  }
+#endif
+
 #ifdef __AVX2__
   if (model.cpu_supports_avx2) {
-    auto* sample_reader = fixed_length_features.data();
-    auto* prediction_reader = predictions->data();
+    auto* sample_reader = fixed_length_features.data() + example_idx;
+    auto* prediction_reader = predictions->data() + example_idx;
 
     // First run on sub-batches of kNumParallelExamples at a time. The
     // remaining will be done sequentially below.
-    int num_remaining_iters = num_examples / kNumParallelExamples;
+    int num_remaining_iters =
+        (num_examples - example_idx) / kNumParallelExamples;
     while (num_remaining_iters--) {
       // Reset active node buffer.
       std::memset(active_leaf_buffer, 0xFF, active_leaf_buffer_size);
@@ -663,7 +966,7 @@ void PredictQuickScorerMajorFeatureOffset(
             for (const auto& item : is_higher_condition.missing_value_items) {
               // Update the active node
               auto* active_si256 = reinterpret_cast<__m256i*>(
-                  &active_leaf_buffer[item.tree_idx * kNumParallelExamples]);
+                  &active_leaf_buffer[item.mask_idx * kNumParallelExamples]);
 
               const auto active = _mm256_load_si256(active_si256);
               // new_active = active & ( mask_split | mask_no_nan )
@@ -690,7 +993,7 @@ void PredictQuickScorerMajorFeatureOffset(
             // active node bitmap iif. the condition is true.
             const auto mask = _mm256_set1_epi64x(item.leaf_mask);
             auto* active_si256 = reinterpret_cast<__m256i*>(
-                &active_leaf_buffer[item.tree_idx * kNumParallelExamples]);
+                &active_leaf_buffer[item.mask_idx * kNumParallelExamples]);
             const auto active = _mm256_load_si256(active_si256);
 
             // Expand the comparison to 8 bytes.
@@ -708,76 +1011,10 @@ void PredictQuickScorerMajorFeatureOffset(
         }
       }
 
-      // Dense contains conditions.
-      for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
-           ++sub_example_idx) {
-        for (const auto& contains_condition :
-             model.categorical_contains_conditions) {
-          const auto feature_value =
-              sample_reader[contains_condition.internal_feature_idx *
-                                major_feature_offset +
-                            sub_example_idx]
-                  .categorical_value;
-          const auto* leaf_mask_stream =
-              &contains_condition.items[model.num_trees * feature_value];
-          for (int tree_idx = 0; tree_idx < model.num_trees; ++tree_idx) {
-            active_leaf_buffer[tree_idx * kNumParallelExamples +
-                               sub_example_idx] &= *(leaf_mask_stream++);
-          }
-        }
-      }
-
-      // Sparse contains conditions.
-      for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
-           ++sub_example_idx) {
-        for (const auto& contains_condition :
-             model.categoricalset_contains_conditions) {
-          const auto& range_values = categorical_set_begins_and_ends
-              [contains_condition.internal_feature_idx * major_feature_offset +
-               sub_example_idx + example_idx];
-          for (int value_idx = range_values.begin; value_idx < range_values.end;
-               value_idx++) {
-            const auto value = categorical_item_buffer[value_idx] + 1;
-            const auto& range_masks =
-                contains_condition.value_to_mask_range[value];
-            for (int mask_idx = range_masks.first;
-                 mask_idx < range_masks.second; mask_idx++) {
-              const auto& mask = contains_condition.mask_buffer[mask_idx];
-              active_leaf_buffer[mask.first * kNumParallelExamples +
-                                 sub_example_idx] &= mask.second;
-            }
-          }
-        }
-      }
-
-#pragma loop unroll(full)
-      for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
-           ++sub_example_idx) {
-        prediction_reader[sub_example_idx] = model.initial_prediction;
-      }
-
-      auto* leaf_reader = model.leaf_values.data();
-      for (int tree_idx = 0; tree_idx < model.num_trees; ++tree_idx) {
-#pragma loop unroll(full)
-        for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
-             ++sub_example_idx) {
-          const auto shift_mask =
-              active_leaf_buffer[tree_idx * kNumParallelExamples +
-                                 sub_example_idx];
-          const auto node_idx = FindLSBSetNonZero64(shift_mask);
-          prediction_reader[sub_example_idx] += leaf_reader[node_idx];
-        }
-        leaf_reader += model.max_num_leafs_per_tree;
-      }
-
-// Note: The compiler should be able to remove the following loop when
-// Activation == Identity. Tested with gcc9 and clang9.
-#pragma loop unroll(full)
-      for (int sub_example_idx = 0; sub_example_idx < kNumParallelExamples;
-           ++sub_example_idx) {
-        prediction_reader[sub_example_idx] =
-            Activation(prediction_reader[sub_example_idx]);
-      }
+      FinalizeQuickScorerBatch<Model, Activation, kNumParallelExamples>(
+          model, sample_reader, categorical_set_begins_and_ends,
+          categorical_item_buffer, example_idx, major_feature_offset,
+          active_leaf_buffer, prediction_reader);
 
       sample_reader += kNumParallelExamples;
       prediction_reader += kNumParallelExamples;
@@ -792,7 +1029,7 @@ void PredictQuickScorerMajorFeatureOffset(
       predictions, active_leaf_buffer);
 
   if (!active_leaf_buffer_uses_stack) {
-#ifdef __AVX2__
+#ifdef YDF_QUICK_SCORER_SIMD
     portable::aligned_free(active_leaf_buffer);
 #else
     free(active_leaf_buffer);
@@ -896,6 +1133,8 @@ absl::Status BaseGenericToSpecializedModel(const AbstractModel& src,
   // a fatal error will be raised.
   dst->cpu_supports_avx2 = true;
 #endif
+  dst->cpu_supports_avx2 &=
+      dst->max_instruction_set >= QuickScorerInstructionSet::kAVX2;
 #elif ABSL_HAVE_BUILTIN(__builtin_cpu_supports)
   if (__builtin_cpu_supports("avx2")) {
     LOG_INFO_EVERY_N_SEC(
@@ -904,6 +1143,20 @@ absl::Status BaseGenericToSpecializedModel(const AbstractModel& src,
   }
 #endif
 
+#ifdef YDF_QUICK_SCORER_AVX512
+#if ABSL_HAVE_BUILTIN(__builtin_cpu_supports)
+  dst->cpu_supports_avx512 = __builtin_cpu_supports("avx512f");
+#else
+  // We cannot detect if the CPU supports AVX-512 instructions. The binary was
+  // compiled with "-mavx512f".
+  dst->cpu_supports_avx512 = true;
+#endif
+  dst->cpu_supports_avx512 &=
+      dst->max_instruction_set >= QuickScorerInstructionSet::kAVX512;
+#else
+  dst->cpu_supports_avx512 = false;
+#endif
+
   if (src.task() != CompiledModel::kTask) {
     return absl::InvalidArgumentError("Wrong model class.");
   }
@@ -990,6 +1243,81 @@ CreateEmptyModel<GradientBoostedTreesRegressionQuickScorerExtended>(
     const std::vector<int>& input_features, const DataSpecification& dataspec,
     GradientBoostedTreesRegressionQuickScorerExtended* dst);
 
+QuickScorerInstructionSet MaxSupportedQuickScorerInstructionSet() {
+#if ABSL_HAVE_BUILTIN(__builtin_cpu_supports)
+#ifdef YDF_QUICK_SCORER_AVX512
+  if (__builtin_cpu_supports("avx512f")) {
+    return QuickScorerInstructionSet::kAVX512;
+  }
+#endif
+#ifdef __AVX2__
+  if (__builtin_cpu_supports("avx2")) {
+    return QuickScorerInstructionSet::kAVX2;
+  }
+#endif
+  return QuickScorerInstructionSet::kScalar;
+#elif defined(__AVX512F__)
+  return QuickScorerInstructionSet::kAVX512;
+#elif defined(__AVX2__)
+  return QuickScorerInstructionSet::kAVX2;
+#else
+  return QuickScorerInstructionSet::kScalar;
+#endif
+}
+
+bool IsQuickScorerInstructionSetSupported(
+    const QuickScorerInstructionSet instruction_set) {
+  switch (instruction_set) {
+    case QuickScorerInstructionSet::kScalar:
+      return true;
+    case QuickScorerInstructionSet::kAVX2:
+#if !defined(__AVX2__)
+      return false;
+#elif ABSL_HAVE_BUILTIN(__builtin_cpu_supports)
+      return __builtin_cpu_supports("avx2");
+#else
+      return true;
+#endif
+    case QuickScorerInstructionSet::kAVX512:
+#if !defined(YDF_QUICK_SCORER_AVX512)
+      return false;
+#elif ABSL_HAVE_BUILTIN(__builtin_cpu_supports)
+      return __builtin_cpu_supports("avx512f");
+#else
+      return true;
+#endif
+  }
+  return false;
+}
+
+QuickScorerInstructionSet GetQuickScorerInstructionSet(
+    const internal::QuickScorerExtendedModel& model) {
+#ifdef YDF_QUICK_SCORER_AVX512
+  if (model.cpu_supports_avx512) {
+    return QuickScorerInstructionSet::kAVX512;
+  }
+#endif
+#ifdef __AVX2__
+  if (model.cpu_supports_avx2) {
+    return QuickScorerInstructionSet::kAVX2;
+  }
+#endif
+  return QuickScorerInstructionSet::kScalar;
+}
+
+std::string QuickScorerInstructionSetName(
+    const QuickScorerInstructionSet instruction_set) {
+  switch (instruction_set) {
+    case QuickScorerInstructionSet::kScalar:
+      return "SCALAR";
+    case QuickScorerInstructionSet::kAVX2:
+      return "AVX2";
+    case QuickScorerInstructionSet::kAVX512:
+      return "AVX512";
+  }
+  return "UNKNOWN";
+}
+
 template <typename Model>
 std::string DescribeQuickScorer(const Model& model, const bool detailed) {
   std::string structure;
@@ -1000,8 +1328,13 @@ std::string DescribeQuickScorer(const Model& model, const bool detailed) {
                             model.max_num_leafs_per_tree);
   absl::SubstituteAndAppend(&structure, "Number of trees: $0\n",
                             model.num_trees);
+  absl::SubstituteAndAppend(&structure, "Number of leaf masks per tree: $0\n",
+                            model.num_leaf_masks_per_tree);
   absl::SubstituteAndAppend(&structure, "Initial prediction: $0\n",
                             model.initial_prediction);
+  absl::SubstituteAndAppend(
+      &structure, "Instruction set: $0\n",
+      QuickScorerInstructionSetName(GetQuickScorerInstructionSet(model)));
 
   // List of input features.
   absl::StrAppend(&structure, "Features (and missing replacement value):\n");
@@ -1062,10 +1395,10 @@ std::string DescribeQuickScorer(const Model& model, const bool detailed) {
             std::string(
                 reinterpret_cast<const char* const>(&item.items[item_idx]),
                 sizeof(LeafMask)),
-            internal::QuickScorerExtendedModel::kMaxLeafs);
+            internal::QuickScorerExtendedModel::kNumLeafsPerMask);
         absl::SubstituteAndAppend(
-            &structure, "\t\ttree:$0 value:$1 mask : $2\n",
-            item_idx % model.num_trees, item_idx / model.num_trees,
+            &structure, "\t\tleaf mask:$0 value:$1 mask : $2\n",
+            item_idx % model.NumLeafMasks(), item_idx / model.NumLeafMasks(),
             bitmap_representation);
       }
     }
@@ -1097,8 +1430,9 @@ std::string DescribeQuickScorer(const Model& model, const bool detailed) {
           const auto bitmap_representation = ToStringBit(
               std::string(reinterpret_cast<const char* const>(&mask.second),
                           sizeof(LeafMask)),
-              internal::QuickScorerExtendedModel::kMaxLeafs);
-          absl::SubstituteAndAppend(&structure, "\t\ttree:$0 mask : $1\n",
+              internal::QuickScorerExtendedModel::kNumLeafsPerMask);
+          absl::SubstituteAndAppend(&structure,
+                                    "\t\tleaf mask:$0 mask : $1\n",
                                     mask.first, bitmap_representation);
         }
       }
@@ -1136,11 +1470,11 @@ std::string DescribeQuickScorer(const Model& model, const bool detailed) {
             std::string(
                 reinterpret_cast<const char* const>(&sub_item.leaf_mask),
                 sizeof(LeafMask)),
-            internal::QuickScorerExtendedModel::kMaxLeafs);
-        absl::SubstituteAndAppend(&structure,
-                                  "\t\tmask:$0 = $1 threshold:$2 tree:$3\n",
-                                  sub_item.leaf_mask, bitmap_representation,
-                                  sub_item.threshold, sub_item.tree_idx);
+            internal::QuickScorerExtendedModel::kNumLeafsPerMask);
+        absl::SubstituteAndAppend(
+            &structure, "\t\tmask:$0 = $1 threshold:$2 leaf mask:$3\n",
+            sub_item.leaf_mask, bitmap_representation, sub_item.threshold,
+            sub_item.mask_idx);
       }
 
       for (const auto& sub_item : item.missing_value_items) {
@@ -1148,10 +1482,10 @@ std::string DescribeQuickScorer(const Model& model, const bool detailed) {
             std::string(
                 reinterpret_cast<const char* const>(&sub_item.leaf_mask),
                 sizeof(LeafMask)),
-            internal::QuickScorerExtendedModel::kMaxLeafs);
+            internal::QuickScorerExtendedModel::kNumLeafsPerMask);
         absl::SubstituteAndAppend(
-            &structure, "\t\tmask:$0 = $1 threshold:MISSING tree:$2\n",
-            sub_item.leaf_mask, bitmap_representation, sub_item.tree_idx);
+            &structure, "\t\tmask:$0 = $1 threshold:MISSING leaf mask:$2\n",
+            sub_item.leaf_mask, bitmap_representation, sub_item.mask_idx);
       }
     }
   }
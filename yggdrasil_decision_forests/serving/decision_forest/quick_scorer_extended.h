@@ -30,6 +30,11 @@
 // non-zero bitmap value) is returned.
 //
 // The SIMD instructions are used to process multiple examples at the sametime.
+// With AVX2, 4 examples are processed at a time. With AVX-512, 16 examples are
+// processed at a time. The widest instruction set supported by both the binary
+// and the CPU is selected at runtime (see "max_instruction_set"). With GCC and
+// Clang on x86-64, the AVX-512 implementation does not require any compilation
+// flag.
 //
 // Important: This library works faster if AVX2 is enabled at computation:
 //   Add "--copt=-mavx2" to the build call.
@@ -46,7 +51,9 @@
 //
 // With the following constraints:
 //   - Maximum of 65k trees.
-//   - Maximum of 128 nodes per trees (e.g. max depth = 6).
+//   - Maximum of 1024 leafs per trees i.e. "kMaxLeafs" (e.g. max depth = 10).
+//     Trees with more than 64 leafs are supported but slower (see
+//     "num_leaf_masks_per_tree").
 //   - Maximum of 65k unique input features.
 //   - Support categorical and numerical features.
 //
@@ -101,6 +108,14 @@ namespace yggdrasil_decision_forests {
 namespace serving {
 namespace decision_forest {
 
+// Instruction sets of the QuickScorer inference, from the narrowest to the
+// widest.
+enum class QuickScorerInstructionSet {
+  kScalar = 0,
+  kAVX2 = 1,
+  kAVX512 = 2,
+};
+
 namespace internal {
 
 // Base model representation compatible with the QuickScorer algorithm.
@@ -125,9 +140,11 @@ struct QuickScorerExtendedModel {
 
   // Note: The following four fields will be integrated as template parameters
   // in a future cl.
-  // Index of a tree in the model. Limits the number of trees of the model.
+  // Index of a tree, or of a leaf mask (see "num_leaf_masks_per_tree"), in the
+  // model. Limits the number of trees of the model.
   using TreeIdx = uint32_t;
-  // Bitmap over the leafs in a tree. Limits the number of leafs in a tree.
+  // Bitmap over (a subset of) the leafs in a tree. A tree is represented by
+  // "num_leaf_masks_per_tree" leaf masks.
   using LeafMask = uint64_t;
   // The value of a leaf.
   using LeafOutput = float;
@@ -136,9 +153,12 @@ struct QuickScorerExtendedModel {
   static constexpr LeafMask kZeroLeafMask = static_cast<LeafMask>(0);
   static constexpr LeafMask kOneLeafMask = static_cast<LeafMask>(1);
 
-  // Maximum number of trees and number of leafs per trees.
+  // Maximum number of trees, number of leafs per leaf mask, number of leaf
+  // masks per tree, and number of leafs per trees.
   static constexpr size_t kMaxTrees = std::numeric_limits<TreeIdx>::max();
-  static constexpr size_t kMaxLeafs = sizeof(LeafMask) * 8;
+  static constexpr size_t kNumLeafsPerMask = sizeof(LeafMask) * 8;
+  static constexpr size_t kMaxLeafMasksPerTree = 16;
+  static constexpr size_t kMaxLeafs = kNumLeafsPerMask * kMaxLeafMasksPerTree;
 
   // If true, the engine inference runs with the global imputation optimization.
   // That is, missing values are replaced with global imputation.
@@ -155,50 +175,78 @@ struct QuickScorerExtendedModel {
   // Number of trees in the model.
   int num_trees;
 
+  // Number of leaf masks used to represent the active leafs of each tree. The
+  // "i-th" leaf of a tree is the "i % kNumLeafsPerMask"-th bit of its
+  // "i / kNumLeafsPerMask"-th leaf mask. The "j-th" leaf mask of the "k-th"
+  // tree has the mask index "j + k * num_leaf_masks_per_tree".
+  //
+  // The conditions only store the leaf masks that overlap the leafs they
+  // disable. Therefore, trees with more than "kNumLeafsPerMask" leafs only
+  // increase the size of the active leaf buffer and the cost of the final leaf
+  // lookup.
+  int num_leaf_masks_per_tree = 1;
+
+  // Total number of leaf masks in the model.
+  int NumLeafMasks() const { return num_trees * num_leaf_masks_per_tree; }
+
   // Initial prediction / bias of the model.
   float initial_prediction = 0.f;
 
   // If true, do not apply the activation function of the model (if any).
   bool output_logits = false;
 
+  // Widest instruction set used by the model. Should be set before the
+  // compilation of the model (i.e. "GenericToSpecializedModel"). The
+  // instruction set is also limited by the compilation flags and by the CPU.
+  // Used to benchmark the SIMD implementations against each other.
+  QuickScorerInstructionSet max_instruction_set =
+      QuickScorerInstructionSet::kAVX512;
+
 #ifdef __AVX2__
   // This flag is set during the compilation of the model and indicates if the
   // CPU supports AVX2 instructions
   bool cpu_supports_avx2 = true;
 #endif
 
+  // This flag is set during the compilation of the model and indicates if the
+  // AVX-512 (Foundation) implementation is used i.e. it is available in the
+  // binary, the CPU supports it, and "max_instruction_set" allows it.
+  bool cpu_supports_avx512 = false;
+
   struct ConditionItem {
-    TreeIdx tree_idx;
+    // Index of the leaf mask. See "num_leaf_masks_per_tree".
+    TreeIdx mask_idx;
     LeafMask leaf_mask;
 
     bool operator<(const ConditionItem& e) const {
-      return tree_idx < e.tree_idx;
+      return mask_idx < e.mask_idx;
     }
 
     // Indicates that two items can be merged without impact on the inference
     // logic.
     bool CanMerge(const ConditionItem& e) const {
-      return tree_idx == e.tree_idx;
+      return mask_idx == e.mask_idx;
     }
   };
 
   // Data for "IsHigher" conditions i.e. condition of the form "feature >= t".
   struct IsHigherConditionItem {
     float threshold;
-    TreeIdx tree_idx;
+    // Index of the leaf mask. See "num_leaf_masks_per_tree".
+    TreeIdx mask_idx;
     LeafMask leaf_mask;
 
     bool operator<(const IsHigherConditionItem& e) const {
       if (threshold != e.threshold) {
         return threshold < e.threshold;
       }
-      return tree_idx < e.tree_idx;
+      return mask_idx < e.mask_idx;
     }
 
     // Indicates that two items can be merged without impact on the inference
     // logic.
     bool CanMerge(const IsHigherConditionItem& e) const {
-      return tree_idx == e.tree_idx && threshold == e.threshold;
+      return mask_idx == e.mask_idx && threshold == e.threshold;
     }
   };
 
@@ -221,13 +269,13 @@ struct QuickScorerExtendedModel {
     int internal_feature_idx;
 
     // "Contains" type condition for each feature value.
-    // items[tree_idx + feature_value * num_trees] is the mask to apply on tree
-    // "tree_idx" when the feature value is "feature_value".
+    // items[mask_idx + feature_value * NumLeafMasks()] is the mask to apply on
+    // the leaf mask "mask_idx" when the feature value is "feature_value".
     std::vector<LeafMask> items;
   };
 
-  // Similar to "ContainsConditions", but only index the trees impacted by each
-  // feature value.
+  // Similar to "ContainsConditions", but only index the leaf masks impacted by
+  // each feature value.
   struct SparseContainsConditions {
     // Internal index of the feature.
     int internal_feature_idx;
@@ -250,7 +298,7 @@ struct QuickScorerExtendedModel {
       int internal_feature_idx;
 
       // "masks[i][j]" is the mask for the "i-th" feature value on the "j-th"
-      // tree;
+      // leaf mask;
       std::vector<std::unordered_map<TreeIdx, LeafMask>> masks;
     };
 
@@ -367,6 +415,24 @@ absl::Status CreateEmptyModel(const std::vector<int>& input_features,
                               const DataSpecification& dataspec,
                               CompiledModel* dst);
 
+// Widest instruction set supported by both the binary and the CPU.
+QuickScorerInstructionSet MaxSupportedQuickScorerInstructionSet();
+
+// Tells if an instruction set is supported by both the binary and the CPU. The
+// AVX-512 implementation is selected at runtime while the AVX2 implementation
+// requires the binary to be compiled with AVX2. Therefore, AVX-512 can be
+// supported while AVX2 is not.
+bool IsQuickScorerInstructionSetSupported(
+    QuickScorerInstructionSet instruction_set);
+
+// Instruction set used by a compiled model.
+QuickScorerInstructionSet GetQuickScorerInstructionSet(
+    const internal::QuickScorerExtendedModel& model);
+
+// Human readable name of an instruction set e.g. "AVX2".
+std::string QuickScorerInstructionSetName(
+    QuickScorerInstructionSet instruction_set);
+
 // Generates a human readable text describing the internal of the quick scorer
 // model.
 //
@@ -13,13 +13,24 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
 #include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
 
 #include "yggdrasil_decision_forests/serving/decision_forest/quick_scorer_extended.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/register_engines.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
 
 namespace yggdrasil_decision_forests {
 namespace serving {
@@ -390,40 +401,385 @@ TEST(QuickScorer, ExceedStackBuffer) {
                   (1 + 1 + 10 + 300 + 2000 + 20000) * duplicate_factor));
 }
 
+TEST(QuickScorer, InstructionSets) {
+  // 5 toy examples repeated 9 times, with some missing values. With AVX-512,
+  // 32 examples are processed 16 at a time, 12 examples are processed 4 at a
+  // time, and the last example is processed alone.
+  const int num_examples = 5 * 9;
+
+  GradientBoostedTreesModel model;
+  dataset::VerticalDataset dataset;
+  BuildToyModelAndToyDataset(model::proto::Task::REGRESSION,
+                             /*use_cateset_feature=*/true, &model, &dataset);
+
+  std::vector<std::vector<float>> predictions_per_instruction_set;
+  for (const auto instruction_set : {QuickScorerInstructionSet::kScalar,
+                                     QuickScorerInstructionSet::kAVX2,
+                                     QuickScorerInstructionSet::kAVX512}) {
+    GradientBoostedTreesRegressionQuickScorerExtended quick_scorer_model;
+    quick_scorer_model.max_instruction_set = instruction_set;
+    CHECK_OK(GenericToSpecializedModel(model, &quick_scorer_model));
+    EXPECT_LE(GetQuickScorerInstructionSet(quick_scorer_model),
+              instruction_set);
+    YDF_LOG(INFO) << "Instruction set: "
+                  << QuickScorerInstructionSetName(
+                         GetQuickScorerInstructionSet(quick_scorer_model));
+
+    GradientBoostedTreesRegressionQuickScorerExtended::ExampleSet examples(
+        num_examples, quick_scorer_model);
+    examples.FillMissing(quick_scorer_model);
+
+    const auto feature_1 =
+        GradientBoostedTreesRegressionQuickScorerExtended::ExampleSet::
+            GetNumericalFeatureId("b", quick_scorer_model)
+                .value();
+    const auto feature_2 =
+        GradientBoostedTreesRegressionQuickScorerExtended::ExampleSet::
+            GetCategoricalFeatureId("c", quick_scorer_model)
+                .value();
+    const auto feature_3 =
+        GradientBoostedTreesRegressionQuickScorerExtended::ExampleSet::
+            GetCategoricalSetFeatureId("d", quick_scorer_model)
+                .value();
+    const auto feature_4 =
+        GradientBoostedTreesRegressionQuickScorerExtended::ExampleSet::
+            GetNumericalFeatureId("e", quick_scorer_model)
+                .value();
+
+    const std::vector<float> values_1 = {0.5f, 1.0f, 1.5f, 2.5f, 3.5f};
+    const std::vector<int> values_2 = {0, 1, 2, 0, 1};
+    const std::vector<std::vector<std::string>> values_3 = {
+        {"v1"}, {"v2"}, {"v3"}, {"v2", "v3"}, {}};
+    const std::vector<float> values_4 = {0.00f, 0.05f, 0.10f, 0.20f, 0.30f};
+
+    for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+      const int toy_idx = example_idx % 5;
+      if (example_idx % 7 == 3) {
+        examples.SetMissingNumerical(example_idx, feature_1,
+                                     quick_scorer_model);
+      } else {
+        examples.SetNumerical(example_idx, feature_1, values_1[toy_idx],
+                              quick_scorer_model);
+      }
+      examples.SetCategorical(example_idx, feature_2, values_2[toy_idx],
+                              quick_scorer_model);
+      if (values_3[toy_idx].empty()) {
+        examples.SetMissingCategoricalSet(example_idx, feature_3,
+                                          quick_scorer_model);
+      } else {
+        examples.SetCategoricalSet(example_idx, feature_3, values_3[toy_idx],
+                                   quick_scorer_model);
+      }
+      if (example_idx % 11 == 5) {
+        examples.SetMissingNumerical(example_idx, feature_4,
+                                     quick_scorer_model);
+      } else {
+        examples.SetNumerical(example_idx, feature_4, values_4[toy_idx],
+                              quick_scorer_model);
+      }
+    }
+
+    std::vector<float> predictions;
+    Predict(quick_scorer_model, examples, num_examples, &predictions);
+    predictions_per_instruction_set.push_back(std::move(predictions));
+  }
+
+  // Non-missing examples have the same predictions as in the "ExampleSet"
+  // test.
+  EXPECT_EQ(predictions_per_instruction_set[0][1],
+            1 + 3 + 20 + 300 + 2000 + 10000);
+  EXPECT_EQ(predictions_per_instruction_set[0][44],
+            1 + 1 + 10 + 300 + 2000 + 20000);
+
+  EXPECT_EQ(predictions_per_instruction_set[1],
+            predictions_per_instruction_set[0]);
+  EXPECT_EQ(predictions_per_instruction_set[2],
+            predictions_per_instruction_set[0]);
+}
+
+// Builds a model with trees of different depths, and a dataset with random
+// examples. The trees have up to 2^max_depth leafs.
+void BuildDeepModelAndDataset(const std::vector<int>& tree_depths,
+                              const int num_examples,
+                              GradientBoostedTreesModel* model,
+                              dataset::VerticalDataset* dataset) {
+  const dataset::proto::DataSpecification dataspec = PARSE_TEST_PROTO(R"pb(
+    columns { type: NUMERICAL name: "l" }
+    columns { type: NUMERICAL name: "a" }
+    columns { type: NUMERICAL name: "b" }
+    columns {
+      type: CATEGORICAL
+      name: "c"
+      categorical { is_already_integerized: true number_of_unique_values: 5 }
+    }
+    columns {
+      type: CATEGORICAL_SET
+      name: "d"
+      categorical {
+        number_of_unique_values: 4
+        items {
+          key: "v0"
+          value { index: 0 }
+        }
+        items {
+          key: "v1"
+          value { index: 1 }
+        }
+        items {
+          key: "v2"
+          value { index: 2 }
+        }
+        items {
+          key: "v3"
+          value { index: 3 }
+        }
+      }
+    }
+  )pb");
+
+  std::mt19937 rnd(1234);
+  std::uniform_real_distribution<float> numerical_dist(0.f, 1.f);
+  std::uniform_int_distribution<int> categorical_dist(0, 4);
+  std::uniform_int_distribution<int> categorical_set_dist(1, 15);
+
+  model->set_task(model::proto::Task::REGRESSION);
+  model->set_label_col_idx(0);
+  model->set_data_spec(dataspec);
+  model->set_loss(Loss::SQUARED_ERROR);
+  model->mutable_initial_predictions()->push_back(0.5f);
+
+  int num_leafs = 0;
+  std::function<void(NodeWithChildren*, int)> build_node;
+  build_node = [&](NodeWithChildren* node, const int remaining_depth) {
+    if (remaining_depth == 0) {
+      node->mutable_node()->mutable_regressor()->set_top_value(num_leafs++);
+      return;
+    }
+    node->CreateChildren();
+    auto* condition = node->mutable_node()->mutable_condition();
+    switch (remaining_depth % 3) {
+      case 0:
+        condition->set_attribute(1 + remaining_depth % 2);
+        condition->mutable_condition()
+            ->mutable_higher_condition()
+            ->set_threshold(numerical_dist(rnd));
+        break;
+      case 1: {
+        // Note: The elements of a contains condition are sorted.
+        condition->set_attribute(3);
+        const int value_1 = categorical_dist(rnd);
+        const int value_2 = categorical_dist(rnd);
+        auto* contains =
+            condition->mutable_condition()->mutable_contains_condition();
+        contains->add_elements(std::min(value_1, value_2));
+        if (value_1 != value_2) {
+          contains->add_elements(std::max(value_1, value_2));
+        }
+        // Global imputation: The most frequent value is 0.
+        condition->set_na_value(std::min(value_1, value_2) == 0);
+      } break;
+      case 2:
+        condition->set_attribute(4);
+        condition->mutable_condition()
+            ->mutable_contains_condition()
+            ->add_elements(categorical_dist(rnd) % 4);
+        break;
+    }
+    build_node(node->mutable_neg_child(), remaining_depth - 1);
+    build_node(node->mutable_pos_child(), remaining_depth - 1);
+  };
+
+  for (const int depth : tree_depths) {
+    auto tree = absl::make_unique<DecisionTree>();
+    tree->CreateRoot();
+    build_node(tree->mutable_root(), depth);
+    model->mutable_decision_trees()->push_back(std::move(tree));
+  }
+
+  dataset->set_data_spec(dataspec);
+  CHECK_OK(dataset->CreateColumnsFromDataspec());
+  for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+    const int categorical_set_bits = categorical_set_dist(rnd);
+    std::string categorical_set;
+    for (int item = 0; item < 4; item++) {
+      if (categorical_set_bits & (1 << item)) {
+        absl::StrAppend(&categorical_set, categorical_set.empty() ? "" : " ",
+                        "v", item);
+      }
+    }
+    CHECK_OK(dataset->AppendExampleWithStatus(
+        {{"l", "0"},
+         {"a", absl::StrCat(numerical_dist(rnd))},
+         {"b", absl::StrCat(numerical_dist(rnd))},
+         {"c", absl::StrCat(categorical_dist(rnd))},
+         {"d", categorical_set}}));
+  }
+}
+
+TEST(QuickScorer, DeepTrees) {
+  // Trees with 512, 128, 64 and 8 leafs. The largest tree is represented with 8
+  // leaf masks.
+  GradientBoostedTreesModel model;
+  dataset::VerticalDataset dataset;
+  const int num_examples = 101;
+  BuildDeepModelAndDataset({9, 7, 6, 3}, num_examples, &model, &dataset);
+
+  std::vector<float> expected_predictions(num_examples);
+  for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+    float prediction = model.initial_predictions()[0];
+    for (const auto& tree : model.decision_trees()) {
+      prediction += tree->GetLeaf(dataset, example_idx).regressor().top_value();
+    }
+    expected_predictions[example_idx] = prediction;
+  }
+
+  for (const auto instruction_set : {QuickScorerInstructionSet::kScalar,
+                                     QuickScorerInstructionSet::kAVX2,
+                                     QuickScorerInstructionSet::kAVX512}) {
+    GradientBoostedTreesRegressionQuickScorerExtended quick_scorer_model;
+    quick_scorer_model.max_instruction_set = instruction_set;
+    ASSERT_OK(GenericToSpecializedModel(model, &quick_scorer_model));
+    EXPECT_EQ(quick_scorer_model.max_num_leafs_per_tree, 512);
+    EXPECT_EQ(quick_scorer_model.num_leaf_masks_per_tree, 8);
+
+    ASSERT_OK_AND_ASSIGN(
+        const auto examples,
+        VerticalDatasetToExampleSet(dataset, quick_scorer_model));
+    std::vector<float> predictions;
+    Predict(quick_scorer_model, examples, num_examples, &predictions);
+    EXPECT_EQ(predictions, expected_predictions)
+        << "Instruction set: "
+        << QuickScorerInstructionSetName(
+               GetQuickScorerInstructionSet(quick_scorer_model));
+  }
+}
+
+// The AVX-512 implementation is selected at runtime, even if the test is not
+// compiled with "-mavx512f", and returns the same predictions as the scalar
+// implementation.
+TEST(QuickScorer, RuntimeAVX512Selection) {
+  GradientBoostedTreesModel model;
+  dataset::VerticalDataset dataset;
+  const int num_examples = 101;
+  BuildDeepModelAndDataset({9, 7, 6, 3}, num_examples, &model, &dataset);
+
+  GradientBoostedTreesRegressionQuickScorerExtended scalar_model;
+  scalar_model.max_instruction_set = QuickScorerInstructionSet::kScalar;
+  ASSERT_OK(GenericToSpecializedModel(model, &scalar_model));
+  EXPECT_EQ(GetQuickScorerInstructionSet(scalar_model),
+            QuickScorerInstructionSet::kScalar);
+
+  GradientBoostedTreesRegressionQuickScorerExtended avx512_model;
+  avx512_model.max_instruction_set = QuickScorerInstructionSet::kAVX512;
+  ASSERT_OK(GenericToSpecializedModel(model, &avx512_model));
+  EXPECT_EQ(avx512_model.cpu_supports_avx512,
+            IsQuickScorerInstructionSetSupported(
+                QuickScorerInstructionSet::kAVX512));
+
+  // An engine limited to AVX2 only uses AVX2 if the binary supports it.
+  GradientBoostedTreesRegressionQuickScorerExtended avx2_model;
+  avx2_model.max_instruction_set = QuickScorerInstructionSet::kAVX2;
+  ASSERT_OK(GenericToSpecializedModel(model, &avx2_model));
+  EXPECT_EQ(GetQuickScorerInstructionSet(avx2_model),
+            IsQuickScorerInstructionSetSupported(
+                QuickScorerInstructionSet::kAVX2)
+                ? QuickScorerInstructionSet::kAVX2
+                : QuickScorerInstructionSet::kScalar);
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+  EXPECT_EQ(avx512_model.cpu_supports_avx512,
+            __builtin_cpu_supports("avx512f") != 0);
+  if (!__builtin_cpu_supports("avx512f")) {
+    YDF_LOG(INFO) << "The CPU does not support AVX-512. Only the scalar "
+                     "implementation is tested.";
+  }
+#endif
+
+  std::vector<float> scalar_predictions;
+  std::vector<float> avx512_predictions;
+  ASSERT_OK_AND_ASSIGN(const auto scalar_examples,
+                       VerticalDatasetToExampleSet(dataset, scalar_model));
+  ASSERT_OK_AND_ASSIGN(const auto avx512_examples,
+                       VerticalDatasetToExampleSet(dataset, avx512_model));
+  Predict(scalar_model, scalar_examples, num_examples, &scalar_predictions);
+  Predict(avx512_model, avx512_examples, num_examples, &avx512_predictions);
+  EXPECT_EQ(avx512_predictions, scalar_predictions);
+}
+
+// Engines with different instruction sets can be created side by side.
+TEST(QuickScorer, EngineOptions) {
+  GradientBoostedTreesModel model;
+  dataset::VerticalDataset dataset;
+  const int num_examples = 101;
+  BuildDeepModelAndDataset({9, 7, 6, 3}, num_examples, &model, &dataset);
+
+  std::vector<std::unique_ptr<FastEngine>> engines;
+  for (const auto instruction_set : {QuickScorerInstructionSet::kScalar,
+                                     QuickScorerInstructionSet::kAVX2,
+                                     QuickScorerInstructionSet::kAVX512}) {
+    EngineOptions options;
+    options.max_quick_scorer_instruction_set = instruction_set;
+    ASSERT_OK_AND_ASSIGN(
+        auto engine,
+        CreateEngine(model, gradient_boosted_trees::kQuickScorerExtended,
+                     options));
+    engines.push_back(std::move(engine));
+  }
+
+  std::vector<std::vector<float>> predictions_per_engine;
+  for (const auto& engine : engines) {
+    auto examples = engine->AllocateExamples(num_examples);
+    ASSERT_OK(CopyVerticalDatasetToAbstractExampleSet(
+        dataset, 0, num_examples, engine->features(), examples.get()));
+    std::vector<float> predictions;
+    engine->Predict(*examples, num_examples, &predictions);
+    predictions_per_engine.push_back(std::move(predictions));
+  }
+  EXPECT_EQ(predictions_per_engine[1], predictions_per_engine[0]);
+  EXPECT_EQ(predictions_per_engine[2], predictions_per_engine[0]);
+}
+
+TEST(QuickScorer, TooManyLeafs) {
+  GradientBoostedTreesModel model;
+  dataset::VerticalDataset dataset;
+  BuildDeepModelAndDataset({11}, 1, &model, &dataset);
+  GradientBoostedTreesRegressionQuickScorerExtended quick_scorer_model;
+  EXPECT_FALSE(GenericToSpecializedModel(model, &quick_scorer_model).ok());
+}
+
 TEST(QuickScorer, FinalizeConditionItems) {
   std::vector<internal::QuickScorerExtendedModel::ConditionItem> items{
-      {/*.tree_idx =*/2, /*.leaf_mask =*/0b0111},
-      {/*.tree_idx =*/1, /*.leaf_mask =*/0b1011},
-      {/*.tree_idx =*/2, /*.leaf_mask =*/0b1101},
-      {/*.tree_idx =*/1, /*.leaf_mask =*/0b1110},
+      {/*.mask_idx =*/2, /*.leaf_mask =*/0b0111},
+      {/*.mask_idx =*/1, /*.leaf_mask =*/0b1011},
+      {/*.mask_idx =*/2, /*.leaf_mask =*/0b1101},
+      {/*.mask_idx =*/1, /*.leaf_mask =*/0b1110},
   };
   internal::FinalizeConditionItems(&items);
   EXPECT_EQ(items.size(), 2);
-  EXPECT_EQ(items[0].tree_idx, 1);
-  EXPECT_EQ(items[1].tree_idx, 2);
+  EXPECT_EQ(items[0].mask_idx, 1);
+  EXPECT_EQ(items[1].mask_idx, 2);
   EXPECT_EQ(items[0].leaf_mask, 0b1010);
   EXPECT_EQ(items[1].leaf_mask, 0b0101);
 }
 
 TEST(QuickScorer, FinalizeIsHigherConditionItems) {
   std::vector<internal::QuickScorerExtendedModel::IsHigherConditionItem> items{
-      {/*.threshold =*/1.f, /*.tree_idx =*/2, /*.leaf_mask =*/0b0111},
-      {/*.threshold =*/3.f, /*.tree_idx =*/1, /*.leaf_mask =*/0b1011},
-      {/*.threshold =*/1.f, /*.tree_idx =*/2, /*.leaf_mask =*/0b1101},
-      {/*.threshold =*/2.f, /*.tree_idx =*/1, /*.leaf_mask =*/0b1110},
+      {/*.threshold =*/1.f, /*.mask_idx =*/2, /*.leaf_mask =*/0b0111},
+      {/*.threshold =*/3.f, /*.mask_idx =*/1, /*.leaf_mask =*/0b1011},
+      {/*.threshold =*/1.f, /*.mask_idx =*/2, /*.leaf_mask =*/0b1101},
+      {/*.threshold =*/2.f, /*.mask_idx =*/1, /*.leaf_mask =*/0b1110},
   };
   internal::FinalizeIsHigherConditionItems(&items);
   EXPECT_EQ(items.size(), 3);
 
-  EXPECT_EQ(items[0].tree_idx, 2);
+  EXPECT_EQ(items[0].mask_idx, 2);
   EXPECT_EQ(items[0].leaf_mask, 0b0101);
   EXPECT_EQ(items[0].threshold, 1);
 
-  EXPECT_EQ(items[1].tree_idx, 1);
+  EXPECT_EQ(items[1].mask_idx, 1);
   EXPECT_EQ(items[1].leaf_mask, 0b1110);
   EXPECT_EQ(items[1].threshold, 2);
 
-  EXPECT_EQ(items[2].tree_idx, 1);
+  EXPECT_EQ(items[2].mask_idx, 1);
   EXPECT_EQ(items[2].leaf_mask, 0b1011);
   EXPECT_EQ(items[2].threshold, 3);
 }
@@ -23,6 +23,7 @@
 #include "yggdrasil_decision_forests/model/fast_engine_factory.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
 #include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.pb.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/8bits_numerical_features.h"
 #include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
 #include "yggdrasil_decision_forests/serving/decision_forest/quick_scorer_extended.h"
 #include "yggdrasil_decision_forests/serving/example_set_model_wrapper.h"
@@ -148,12 +149,91 @@ bool AllConditionsCompatibleQuickScorerExtendedModels(
   return CheckAllConditions(decision_trees, check_condition);
 }
 
+// Applies the engine options to a model before its compilation.
+void SetEngineOptions(
+    const serving::decision_forest::EngineOptions& options,
+    serving::decision_forest::internal::QuickScorerExtendedModel* model) {
+  model->max_instruction_set = options.max_quick_scorer_instruction_set;
+}
+
+template <typename Node, typename Value>
+void SetEngineOptions(
+    const serving::decision_forest::EngineOptions& options,
+    serving::decision_forest::FlatNodeModel<Node, Value>* model) {
+  model->node_layout = options.node_layout;
+}
+
+// Compiles "src" into "engine" according to the engine options.
+template <typename SourceModel, typename Engine>
+absl::Status LoadModelWithOptions(
+    const SourceModel& src,
+    const serving::decision_forest::EngineOptions& options, Engine* engine) {
+  SetEngineOptions(options, engine->mutable_model());
+  return engine->template LoadModel<SourceModel>(src);
+}
+
+// Applies the leaf output quantization of the engine options to a compiled
+// model, and checks the impact of the quantization on the predictions.
+template <typename Model>
+absl::Status CompressLeafOutputsWithOptions(
+    const serving::decision_forest::EngineOptions& options, Model* model) {
+  using serving::decision_forest::LeafOutputQuantization;
+  if (!options.leaf_output_quantization.has_value()) {
+    return absl::OkStatus();
+  }
+  const auto quantization = options.leaf_output_quantization.value();
+  if (quantization == LeafOutputQuantization::kFloat32) {
+    // The deduplication does not change the predictions.
+    return serving::decision_forest::CompressLeafOutputs(quantization, model);
+  }
+  if (options.leaf_output_quantization_dataset == nullptr) {
+    return absl::InvalidArgumentError(
+        "The quantization of the leaf values requires a "
+        "\"leaf_output_quantization_dataset\" to check the predictions.");
+  }
+  const Model reference_model = *model;
+  RETURN_IF_ERROR(
+      serving::decision_forest::CompressLeafOutputs(quantization, model));
+  ASSIGN_OR_RETURN(const auto difference,
+                   serving::decision_forest::ComparePredictions(
+                       reference_model, *model,
+                       *options.leaf_output_quantization_dataset));
+  if (difference.max_abs_diff >
+      options.max_leaf_output_quantization_abs_diff) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "The quantization of the leaf values changes the predictions by up to ",
+        difference.max_abs_diff, " (mean: ", difference.mean_abs_diff,
+        ") while max_leaf_output_quantization_abs_diff=",
+        options.max_leaf_output_quantization_abs_diff,
+        ". Use a more precise quantization."));
+  }
+  YDF_LOG(INFO) << "Leaf values quantized. Max prediction difference: "
+                << difference.max_abs_diff
+                << " Argmax disagreement ratio: "
+                << difference.argmax_disagreement_ratio;
+  return absl::OkStatus();
+}
+
+// Same as "LoadModelWithOptions", followed by the compression of the leaf
+// values.
+template <typename SourceModel, typename Engine>
+absl::Status LoadCompressedModelWithOptions(
+    const SourceModel& src,
+    const serving::decision_forest::EngineOptions& options, Engine* engine) {
+  RETURN_IF_ERROR(LoadModelWithOptions(src, options, engine));
+  return CompressLeafOutputsWithOptions(options, engine->mutable_model());
+}
+
 }  // namespace
 
 class GradientBoostedTreesGenericFastEngineFactory : public FastEngineFactory {
  public:
   using SourceModel = gradient_boosted_trees::GradientBoostedTreesModel;
 
+  explicit GradientBoostedTreesGenericFastEngineFactory(
+      const serving::decision_forest::EngineOptions& options = {})
+      : options_(options) {}
+
   std::string name() const override {
     return serving::gradient_boosted_trees::kGeneric;
   }
@@ -203,14 +283,16 @@ class GradientBoostedTreesGenericFastEngineFactory : public FastEngineFactory {
                 serving::decision_forest::
                     GenericGradientBoostedTreesBinaryClassification<uint32_t>,
                 serving::decision_forest::Predict>>();
-            RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+            RETURN_IF_ERROR(
+                LoadModelWithOptions(*gbt_model, options_, engine.get()));
             return engine;
           } else {
             auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
                 serving::decision_forest::
                     GradientBoostedTreesBinaryClassification,
                 serving::decision_forest::Predict>>();
-            RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+            RETURN_IF_ERROR(
+                LoadModelWithOptions(*gbt_model, options_, engine.get()));
             return engine;
           }
         } else {
@@ -219,7 +301,8 @@ class GradientBoostedTreesGenericFastEngineFactory : public FastEngineFactory {
               serving::decision_forest::
                   GradientBoostedTreesMulticlassClassification,
               serving::decision_forest::Predict>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+          RETURN_IF_ERROR(
+              LoadModelWithOptions(*gbt_model, options_, engine.get()));
           return engine;
         }
 
@@ -227,7 +310,8 @@ class GradientBoostedTreesGenericFastEngineFactory : public FastEngineFactory {
         auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
             serving::decision_forest::GradientBoostedTreesRegression,
             serving::decision_forest::Predict>>();
-        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+        RETURN_IF_ERROR(
+            LoadModelWithOptions(*gbt_model, options_, engine.get()));
         return engine;
       }
 
@@ -235,7 +319,8 @@ class GradientBoostedTreesGenericFastEngineFactory : public FastEngineFactory {
         auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
             serving::decision_forest::GradientBoostedTreesRanking,
             serving::decision_forest::Predict>>();
-        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+        RETURN_IF_ERROR(
+            LoadModelWithOptions(*gbt_model, options_, engine.get()));
         return engine;
       }
 
@@ -243,6 +328,9 @@ class GradientBoostedTreesGenericFastEngineFactory : public FastEngineFactory {
         return absl::InvalidArgumentError("Non supported GBDT model");
     }
   }
+
+ private:
+  serving::decision_forest::EngineOptions options_;
 };
 
 REGISTER_FastEngineFactory(GradientBoostedTreesGenericFastEngineFactory,
@@ -253,6 +341,10 @@ class GradientBoostedTreesQuickScorerFastEngineFactory
  public:
   using SourceModel = gradient_boosted_trees::GradientBoostedTreesModel;
 
+  explicit GradientBoostedTreesQuickScorerFastEngineFactory(
+      const serving::decision_forest::EngineOptions& options = {})
+      : options_(options) {}
+
   std::string name() const override {
     return serving::gradient_boosted_trees::kQuickScorerExtended;
   }
@@ -299,7 +391,10 @@ class GradientBoostedTreesQuickScorerFastEngineFactory
 
   std::vector<std::string> IsBetterThan() const override {
     return {serving::gradient_boosted_trees::kGeneric,
-            serving::gradient_boosted_trees::kOptPred};
+            serving::gradient_boosted_trees::kOptPred,
+            // The 8-bit engine is only used when QuickScorer is not
+            // compatible with the model.
+            serving::gradient_boosted_trees::kNum8Bits};
   }
 
   absl::StatusOr<std::unique_ptr<serving::FastEngine>> CreateEngine(
@@ -324,7 +419,8 @@ class GradientBoostedTreesQuickScorerFastEngineFactory
               serving::decision_forest::
                   GradientBoostedTreesBinaryClassificationQuickScorerExtended,
               serving::decision_forest::Predict>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+          RETURN_IF_ERROR(
+              LoadModelWithOptions(*gbt_model, options_, engine.get()));
           return engine;
         } else {
           return absl::InvalidArgumentError("Non supported GBDT model");
@@ -336,14 +432,16 @@ class GradientBoostedTreesQuickScorerFastEngineFactory
               serving::decision_forest::
                   GradientBoostedTreesPoissonRegressionQuickScorerExtended,
               serving::decision_forest::Predict>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+          RETURN_IF_ERROR(
+              LoadModelWithOptions(*gbt_model, options_, engine.get()));
           return engine;
         } else {
           auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
               serving::decision_forest::
                   GradientBoostedTreesRegressionQuickScorerExtended,
               serving::decision_forest::Predict>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+          RETURN_IF_ERROR(
+              LoadModelWithOptions(*gbt_model, options_, engine.get()));
           return engine;
         }
       }
@@ -353,7 +451,8 @@ class GradientBoostedTreesQuickScorerFastEngineFactory
             serving::decision_forest::
                 GradientBoostedTreesRankingQuickScorerExtended,
             serving::decision_forest::Predict>>();
-        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+        RETURN_IF_ERROR(
+            LoadModelWithOptions(*gbt_model, options_, engine.get()));
         return engine;
       }
 
@@ -361,6 +460,8 @@ class GradientBoostedTreesQuickScorerFastEngineFactory
         return absl::InvalidArgumentError("Non supported GBDT model");
     }
   }
+ private:
+  serving::decision_forest::EngineOptions options_;
 };
 
 REGISTER_FastEngineFactory(
@@ -371,6 +472,10 @@ class GradientBoostedTreesOptPredFastEngineFactory : public FastEngineFactory {
  public:
   using SourceModel = gradient_boosted_trees::GradientBoostedTreesModel;
 
+  explicit GradientBoostedTreesOptPredFastEngineFactory(
+      const serving::decision_forest::EngineOptions& options = {})
+      : options_(options) {}
+
   std::string name() const override {
     return serving::gradient_boosted_trees::kOptPred;
   }
@@ -446,7 +551,8 @@ class GradientBoostedTreesOptPredFastEngineFactory : public FastEngineFactory {
               serving::decision_forest::
                   GradientBoostedTreesBinaryClassificationNumericalAndCategorical,
               serving::decision_forest::PredictWithExampleSet>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+          RETURN_IF_ERROR(
+              LoadModelWithOptions(*gbt_model, options_, engine.get()));
           return engine;
         } else {
           return absl::InvalidArgumentError("Non supported GBDT model");
@@ -457,7 +563,8 @@ class GradientBoostedTreesOptPredFastEngineFactory : public FastEngineFactory {
             serving::decision_forest::
                 GradientBoostedTreesRegressionNumericalAndCategorical,
             serving::decision_forest::PredictWithExampleSet>>();
-        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+        RETURN_IF_ERROR(
+            LoadModelWithOptions(*gbt_model, options_, engine.get()));
         return engine;
       }
 
@@ -466,7 +573,8 @@ class GradientBoostedTreesOptPredFastEngineFactory : public FastEngineFactory {
             serving::decision_forest::
                 GradientBoostedTreesRankingNumericalAndCategorical,
             serving::decision_forest::PredictWithExampleSet>>();
-        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+        RETURN_IF_ERROR(
+            LoadModelWithOptions(*gbt_model, options_, engine.get()));
         return engine;
       }
 
@@ -474,15 +582,127 @@ class GradientBoostedTreesOptPredFastEngineFactory : public FastEngineFactory {
         return absl::InvalidArgumentError("Non supported GBDT model");
     }
   }
+
+ private:
+  serving::decision_forest::EngineOptions options_;
 };
 
 REGISTER_FastEngineFactory(GradientBoostedTreesOptPredFastEngineFactory,
                            serving::gradient_boosted_trees::kOptPred);
 
+class GradientBoostedTreesNum8BitsFastEngineFactory : public FastEngineFactory {
+ public:
+  using SourceModel = gradient_boosted_trees::GradientBoostedTreesModel;
+
+  std::string name() const override {
+    return serving::gradient_boosted_trees::kNum8Bits;
+  }
+
+  bool IsCompatible(const AbstractModel* const model) const override {
+    auto* gbt_model = dynamic_cast<const SourceModel*>(model);
+    if (gbt_model == nullptr) {
+      return false;
+    }
+
+    if (!gbt_model->CheckStructure({/*.global_imputation_is_higher =*/true})) {
+      return false;
+    }
+
+    if (!serving::decision_forest::num_8bits::CheckCompatibility(*gbt_model)
+             .ok()) {
+      return false;
+    }
+
+    switch (gbt_model->task()) {
+      case proto::CLASSIFICATION:
+        return gbt_model->loss() ==
+                   gradient_boosted_trees::proto::BINOMIAL_LOG_LIKELIHOOD ||
+               gbt_model->loss() ==
+                   gradient_boosted_trees::proto::MULTINOMIAL_LOG_LIKELIHOOD;
+      case proto::REGRESSION:
+        return gbt_model->loss() ==
+               gradient_boosted_trees::proto::SQUARED_ERROR;
+      case proto::RANKING:
+        return gbt_model->loss() ==
+                   gradient_boosted_trees::proto::LAMBDA_MART_NDCG5 ||
+               gbt_model->loss() == gradient_boosted_trees::proto::XE_NDCG_MART;
+      default:
+        return false;
+    }
+  }
+
+  std::vector<std::string> IsBetterThan() const override {
+    return {serving::gradient_boosted_trees::kGeneric,
+            serving::gradient_boosted_trees::kOptPred};
+  }
+
+  absl::StatusOr<std::unique_ptr<serving::FastEngine>> CreateEngine(
+      const AbstractModel* const model) const override {
+    using serving::decision_forest::num_8bits::FastEngineModel;
+    using serving::decision_forest::num_8bits::
+        GradientBoostedTreesBinaryClassificationModel;
+    using serving::decision_forest::num_8bits::
+        GradientBoostedTreesBinaryRegressiveModel;
+    using serving::decision_forest::num_8bits::
+        GradientBoostedTreesMulticlassClassificationModel;
+    using serving::decision_forest::num_8bits::Predict;
+
+    auto* gbt_model = dynamic_cast<const SourceModel*>(model);
+    if (!gbt_model) {
+      return absl::InvalidArgumentError("The model is not a GBDT.");
+    }
+
+    if (!gbt_model->CheckStructure({/*.global_imputation_is_higher =*/true})) {
+      return NoGlobalImputationError(
+          "GradientBoostedTreesNum8BitsFastEngineFactory");
+    }
+
+    switch (gbt_model->task()) {
+      case proto::CLASSIFICATION:
+        if (gbt_model->label_col_spec()
+                .categorical()
+                .number_of_unique_values() == 3) {
+          // Binary classification.
+          auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
+              FastEngineModel<GradientBoostedTreesBinaryClassificationModel>,
+              Predict<GradientBoostedTreesBinaryClassificationModel>>>();
+          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+          return engine;
+        } else {
+          // Multi-class classification.
+          using Engine = GradientBoostedTreesMulticlassClassificationModel;
+          auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
+              FastEngineModel<Engine>, Predict<Engine>>>();
+          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+          return engine;
+        }
+
+      case proto::REGRESSION:
+      case proto::RANKING: {
+        auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
+            FastEngineModel<GradientBoostedTreesBinaryRegressiveModel>,
+            Predict<GradientBoostedTreesBinaryRegressiveModel>>>();
+        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*gbt_model));
+        return engine;
+      }
+
+      default:
+        return absl::InvalidArgumentError("Non supported GBDT model");
+    }
+  }
+};
+
+REGISTER_FastEngineFactory(GradientBoostedTreesNum8BitsFastEngineFactory,
+                           serving::gradient_boosted_trees::kNum8Bits);
+
 class RandomForestGenericFastEngineFactory : public model::FastEngineFactory {
  public:
   using SourceModel = random_forest::RandomForestModel;
 
+  explicit RandomForestGenericFastEngineFactory(
+      const serving::decision_forest::EngineOptions& options = {})
+      : options_(options) {}
+
   std::string name() const override { return serving::random_forest::kGeneric; }
 
   bool IsCompatible(const AbstractModel* const model) const override {
@@ -521,14 +741,16 @@ class RandomForestGenericFastEngineFactory : public model::FastEngineFactory {
               serving::decision_forest::GenericRandomForestBinaryClassification<
                   uint32_t>,
               serving::decision_forest::Predict>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+          RETURN_IF_ERROR(
+              LoadModelWithOptions(*rf_model, options_, engine.get()));
           return engine;
         } else {
           auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
               serving::decision_forest::GenericRandomForestBinaryClassification<
                   uint16_t>,
               serving::decision_forest::Predict>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+          RETURN_IF_ERROR(
+              LoadModelWithOptions(*rf_model, options_, engine.get()));
           return engine;
         }
       } else {
@@ -538,14 +760,16 @@ class RandomForestGenericFastEngineFactory : public model::FastEngineFactory {
               serving::decision_forest::
                   GenericRandomForestMulticlassClassification<uint32_t>,
               serving::decision_forest::Predict>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+          RETURN_IF_ERROR(LoadCompressedModelWithOptions(
+              *rf_model, options_, engine.get()));
           return engine;
         } else {
           auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
               serving::decision_forest::
                   GenericRandomForestMulticlassClassification<uint16_t>,
               serving::decision_forest::Predict>>();
-          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+          RETURN_IF_ERROR(LoadCompressedModelWithOptions(
+              *rf_model, options_, engine.get()));
           return engine;
         }
 
@@ -555,14 +779,16 @@ class RandomForestGenericFastEngineFactory : public model::FastEngineFactory {
                 serving::decision_forest::GenericRandomForestRegression<
                     uint32_t>,
                 serving::decision_forest::Predict>>();
-            RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+            RETURN_IF_ERROR(
+                LoadModelWithOptions(*rf_model, options_, engine.get()));
             return engine;
           } else {
             auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
                 serving::decision_forest::GenericRandomForestRegression<
                     uint16_t>,
                 serving::decision_forest::Predict>>();
-            RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+            RETURN_IF_ERROR(
+                LoadModelWithOptions(*rf_model, options_, engine.get()));
             return engine;
           }
 
@@ -572,14 +798,16 @@ class RandomForestGenericFastEngineFactory : public model::FastEngineFactory {
                 serving::decision_forest::GenericRandomForestCategoricalUplift<
                     uint32_t>,
                 serving::decision_forest::Predict>>();
-            RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+            RETURN_IF_ERROR(LoadCompressedModelWithOptions(
+                *rf_model, options_, engine.get()));
             return engine;
           } else {
             auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
                 serving::decision_forest::GenericRandomForestCategoricalUplift<
                     uint16_t>,
                 serving::decision_forest::Predict>>();
-            RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+            RETURN_IF_ERROR(LoadCompressedModelWithOptions(
+                *rf_model, options_, engine.get()));
             return engine;
           }
 
@@ -589,14 +817,16 @@ class RandomForestGenericFastEngineFactory : public model::FastEngineFactory {
                 serving::decision_forest::GenericRandomForestNumericalUplift<
                     uint32_t>,
                 serving::decision_forest::Predict>>();
-            RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+            RETURN_IF_ERROR(
+                LoadModelWithOptions(*rf_model, options_, engine.get()));
             return engine;
           } else {
             auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
                 serving::decision_forest::GenericRandomForestNumericalUplift<
                     uint16_t>,
                 serving::decision_forest::Predict>>();
-            RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+            RETURN_IF_ERROR(
+                LoadModelWithOptions(*rf_model, options_, engine.get()));
             return engine;
           }
 
@@ -604,6 +834,9 @@ class RandomForestGenericFastEngineFactory : public model::FastEngineFactory {
           return absl::InvalidArgumentError("Non supported RF model");
       }
   }
+
+ private:
+  serving::decision_forest::EngineOptions options_;
 };
 
 REGISTER_FastEngineFactory(RandomForestGenericFastEngineFactory,
@@ -613,6 +846,10 @@ class RandomForestOptPredFastEngineFactory : public model::FastEngineFactory {
  public:
   using SourceModel = random_forest::RandomForestModel;
 
+  explicit RandomForestOptPredFastEngineFactory(
+      const serving::decision_forest::EngineOptions& options = {})
+      : options_(options) {}
+
   std::string name() const override { return serving::random_forest::kOptPred; }
 
   bool IsCompatible(const AbstractModel* const model) const override {
@@ -675,7 +912,8 @@ class RandomForestOptPredFastEngineFactory : public model::FastEngineFactory {
             serving::decision_forest::
                 RandomForestBinaryClassificationNumericalAndCategoricalFeatures,
             serving::decision_forest::PredictWithExampleSet>>();
-        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+        RETURN_IF_ERROR(
+            LoadModelWithOptions(*rf_model, options_, engine.get()));
         return engine;
       }
 
@@ -684,7 +922,8 @@ class RandomForestOptPredFastEngineFactory : public model::FastEngineFactory {
             serving::decision_forest::
                 RandomForestRegressionNumericalAndCategorical,
             serving::decision_forest::PredictWithExampleSet>>();
-        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+        RETURN_IF_ERROR(
+            LoadModelWithOptions(*rf_model, options_, engine.get()));
         return engine;
       }
 
@@ -692,10 +931,144 @@ class RandomForestOptPredFastEngineFactory : public model::FastEngineFactory {
         return absl::InvalidArgumentError("Non supported RF model");
     }
   }
+
+ private:
+  serving::decision_forest::EngineOptions options_;
 };
 
 REGISTER_FastEngineFactory(RandomForestOptPredFastEngineFactory,
                            serving::random_forest::kOptPred);
 
+class RandomForestNum8BitsFastEngineFactory : public model::FastEngineFactory {
+ public:
+  using SourceModel = random_forest::RandomForestModel;
+
+  std::string name() const override {
+    return serving::random_forest::kNum8Bits;
+  }
+
+  bool IsCompatible(const AbstractModel* const model) const override {
+    auto* rf_model = dynamic_cast<const SourceModel*>(model);
+    if (rf_model == nullptr) {
+      return false;
+    }
+
+    if (!rf_model->CheckStructure({/*.global_imputation_is_higher =*/true})) {
+      return false;
+    }
+
+    if (!serving::decision_forest::num_8bits::CheckCompatibility(*rf_model)
+             .ok()) {
+      return false;
+    }
+
+    switch (rf_model->task()) {
+      case proto::CLASSIFICATION:
+      case proto::REGRESSION:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  std::vector<std::string> IsBetterThan() const override {
+    return {serving::random_forest::kGeneric,
+            serving::random_forest::kOptPred};
+  }
+
+  absl::StatusOr<std::unique_ptr<serving::FastEngine>> CreateEngine(
+      const AbstractModel* const model) const override {
+    using serving::decision_forest::num_8bits::FastEngineModel;
+    using serving::decision_forest::num_8bits::Predict;
+    using serving::decision_forest::num_8bits::
+        RandomForestBinaryClassificationModel;
+    using serving::decision_forest::num_8bits::
+        RandomForestMulticlassClassificationModel;
+    using serving::decision_forest::num_8bits::RandomForestRegressionModel;
+
+    auto* rf_model = dynamic_cast<const SourceModel*>(model);
+    if (!rf_model) {
+      return absl::InvalidArgumentError("The model is not a RF.");
+    }
+
+    if (!rf_model->CheckStructure({/*.global_imputation_is_higher =*/true})) {
+      return NoGlobalImputationError("RandomForestNum8BitsFastEngineFactory");
+    }
+
+    switch (rf_model->task()) {
+      case model::proto::CLASSIFICATION:
+        if (rf_model->label_col_spec()
+                .categorical()
+                .number_of_unique_values() == 3) {
+          // Binary classification.
+          auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
+              FastEngineModel<RandomForestBinaryClassificationModel>,
+              Predict<RandomForestBinaryClassificationModel>>>();
+          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+          return engine;
+        } else {
+          // Multi-class classification.
+          auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
+              FastEngineModel<RandomForestMulticlassClassificationModel>,
+              Predict<RandomForestMulticlassClassificationModel>>>();
+          RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+          return engine;
+        }
+
+      case model::proto::REGRESSION: {
+        auto engine = absl::make_unique<serving::ExampleSetModelWrapper<
+            FastEngineModel<RandomForestRegressionModel>,
+            Predict<RandomForestRegressionModel>>>();
+        RETURN_IF_ERROR(engine->LoadModel<SourceModel>(*rf_model));
+        return engine;
+      }
+
+      default:
+        return absl::InvalidArgumentError("Non supported RF model");
+    }
+  }
+};
+
+REGISTER_FastEngineFactory(RandomForestNum8BitsFastEngineFactory,
+                           serving::random_forest::kNum8Bits);
+
 }  // namespace model
+
+namespace serving {
+namespace decision_forest {
+
+absl::StatusOr<std::unique_ptr<FastEngine>> CreateEngine(
+    const model::AbstractModel& model, const absl::string_view engine_name,
+    const EngineOptions& options) {
+  std::unique_ptr<model::FastEngineFactory> factory;
+  if (engine_name == gradient_boosted_trees::kGeneric) {
+    factory = absl::make_unique<
+        model::GradientBoostedTreesGenericFastEngineFactory>(options);
+  } else if (engine_name == gradient_boosted_trees::kQuickScorerExtended) {
+    factory = absl::make_unique<
+        model::GradientBoostedTreesQuickScorerFastEngineFactory>(options);
+  } else if (engine_name == gradient_boosted_trees::kOptPred) {
+    factory = absl::make_unique<
+        model::GradientBoostedTreesOptPredFastEngineFactory>(options);
+  } else if (engine_name == random_forest::kGeneric) {
+    factory =
+        absl::make_unique<model::RandomForestGenericFastEngineFactory>(options);
+  } else if (engine_name == random_forest::kOptPred) {
+    factory =
+        absl::make_unique<model::RandomForestOptPredFastEngineFactory>(options);
+  } else {
+    // Engine without options.
+    ASSIGN_OR_RETURN(factory,
+                     model::FastEngineFactoryRegisterer::Create(engine_name));
+  }
+  if (!factory->IsCompatible(&model)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The engine \"", engine_name,
+                     "\" is not compatible with the model."));
+  }
+  return factory->CreateEngine(&model);
+}
+
+}  // namespace decision_forest
+}  // namespace serving
 }  // namespace yggdrasil_decision_forests
@@ -13,12 +13,20 @@
  * limitations under the License.
  */
 
-// Inference engine names for decision forest models.
+// Inference engine names and options for decision forest models.
 //
 #ifndef YGGDRASIL_DECISION_FORESTS_SERVING_REGISTER_ENGINE_DECISION_FOREST_H_
 #define YGGDRASIL_DECISION_FORESTS_SERVING_REGISTER_ENGINE_DECISION_FOREST_H_
 
+#include <memory>
+#include <optional>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest_serving.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/quick_scorer_extended.h"
 #include "yggdrasil_decision_forests/serving/fast_engine.h"
 
 namespace yggdrasil_decision_forests {
@@ -29,13 +37,52 @@ constexpr char kGeneric[] = "GradientBoostedTreesGeneric";
 constexpr char kQuickScorerExtended[] =
     "GradientBoostedTreesQuickScorerExtended";
 constexpr char kOptPred[] = "GradientBoostedTreesOptPred";
+constexpr char kNum8Bits[] = "GradientBoostedTreesNum8Bits";
 }  // namespace gradient_boosted_trees
 
 namespace random_forest {
 constexpr char kGeneric[] = "RandomForestGeneric";
 constexpr char kOptPred[] = "RandomForestOptPred";
+constexpr char kNum8Bits[] = "RandomForestNum8Bits";
 }  // namespace random_forest
 
+namespace decision_forest {
+
+// Options of the decision forest engines. The default values are the options
+// of the engines created by "AbstractModel::BuildFastEngine".
+struct EngineOptions {
+  // Order of the nodes of the flat node engines (e.g. "kGeneric", "kOptPred").
+  NodeLayout node_layout = NodeLayout::kDepthFirst;
+
+  // Widest instruction set used by the QuickScorer engine.
+  QuickScorerInstructionSet max_quick_scorer_instruction_set =
+      QuickScorerInstructionSet::kAVX512;
+
+  // If set, the leaf values of the flat node engines with multi-dimensional
+  // leaves (i.e. Random Forest multi-class classification and categorical
+  // uplift) are deduplicated and quantized (see "CompressLeafOutputs"). Ignored
+  // by the other engines.
+  std::optional<LeafOutputQuantization> leaf_output_quantization;
+
+  // Dataset used to check the predictions of a quantized engine (see
+  // "ComparePredictions"). Required if "leaf_output_quantization" is
+  // "kFloat16" or "kInt8". The engine creation fails if a prediction value
+  // differs by more than "max_leaf_output_quantization_abs_diff" from the
+  // prediction of the non-quantized engine. Only used during the creation of
+  // the engine.
+  const dataset::VerticalDataset* leaf_output_quantization_dataset = nullptr;
+  double max_leaf_output_quantization_abs_diff = 0.01;
+};
+
+// Creates the engine "engine_name" (e.g. "kQuickScorerExtended") for "model"
+// with the given options. The options not relevant to the engine are ignored.
+// Fails if the engine is not compatible with the model.
+absl::StatusOr<std::unique_ptr<FastEngine>> CreateEngine(
+    const model::AbstractModel& model, absl::string_view engine_name,
+    const EngineOptions& options);
+
+}  // namespace decision_forest
+
 }  // namespace serving
 }  // namespace yggdrasil_decision_forests
 #endif  // YGGDRASIL_DECISION_FORESTS_SERVING_REGISTER_ENGINE_DECISION_FOREST_H_
@@ -0,0 +1,923 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/serving/decision_forest/serving_snapshot.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/abstract_model.pb.h"
+#include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
+#include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest_serving.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/serving_snapshot.pb.h"
+#include "yggdrasil_decision_forests/serving/example_set_model_wrapper.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/memory_mapped_file.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace serving {
+namespace decision_forest {
+namespace {
+
+using Header = proto::ServingSnapshotHeader;
+using model::gradient_boosted_trees::GradientBoostedTreesModel;
+using model::random_forest::RandomForestModel;
+
+constexpr char kMagic[8] = {'Y', 'D', 'F', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+// Size of the fixed part of the file before the header proto.
+constexpr size_t kPrefixSize = 24;
+
+// Alignment of the arrays, relative to the start of the file.
+constexpr size_t kSectionAlignment = 64;
+
+// Maximum size of the header. Protobuf messages are limited to 2GB.
+constexpr uint64_t kMaxHeaderSize = uint64_t{1} << 30;
+
+// Arrays of a flat node model, in the order of the file.
+enum Section {
+  kNodes = 0,
+  kRootOffsets,
+  kLabelBuffer,
+  kLabelBufferFloat16,
+  kLabelBufferInt8,
+  kCategoricalMaskBuffer,
+  kObliqueWeights,
+  kObliqueInternalFeatureIdxs,
+  kNumSections,
+};
+
+size_t Align(const size_t value) {
+  return (value + kSectionAlignment - 1) / kSectionAlignment *
+         kSectionAlignment;
+}
+
+template <typename T>
+absl::string_view AsBytes(const absl::Span<const T> values) {
+  return absl::string_view(reinterpret_cast<const char*>(values.data()),
+                           values.size() * sizeof(T));
+}
+
+// Class and task specific fields of the models.
+// =============================================
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericRandomForestBinaryClassification<NodeOffsetRep>&) {
+  return Header::RANDOM_FOREST_BINARY_CLASSIFICATION;
+}
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericRandomForestMulticlassClassification<NodeOffsetRep>&) {
+  return Header::RANDOM_FOREST_MULTICLASS_CLASSIFICATION;
+}
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericRandomForestRegression<NodeOffsetRep>&) {
+  return Header::RANDOM_FOREST_REGRESSION;
+}
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericRandomForestCategoricalUplift<NodeOffsetRep>&) {
+  return Header::RANDOM_FOREST_CATEGORICAL_UPLIFT;
+}
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericRandomForestNumericalUplift<NodeOffsetRep>&) {
+  return Header::RANDOM_FOREST_NUMERICAL_UPLIFT;
+}
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericGradientBoostedTreesBinaryClassification<NodeOffsetRep>&) {
+  return Header::GRADIENT_BOOSTED_TREES_BINARY_CLASSIFICATION;
+}
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericGradientBoostedTreesMulticlassClassification<NodeOffsetRep>&) {
+  return Header::GRADIENT_BOOSTED_TREES_MULTICLASS_CLASSIFICATION;
+}
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericGradientBoostedTreesRegression<NodeOffsetRep>&) {
+  return Header::GRADIENT_BOOSTED_TREES_REGRESSION;
+}
+
+template <typename NodeOffsetRep>
+Header::ModelType ModelType(
+    const GenericGradientBoostedTreesRanking<NodeOffsetRep>&) {
+  return Header::GRADIENT_BOOSTED_TREES_RANKING;
+}
+
+// Models without task specific fields.
+template <typename Model>
+void ExportTaskFields(const Model& model, Header* header) {}
+
+template <typename Model>
+absl::Status ImportTaskFields(const Header& header, Model* model) {
+  return absl::OkStatus();
+}
+
+template <typename NodeOffsetRep>
+void ExportTaskFields(
+    const GenericRandomForestMulticlassClassification<NodeOffsetRep>& model,
+    Header* header) {
+  header->set_num_classes(model.num_classes);
+}
+
+template <typename NodeOffsetRep>
+absl::Status ImportTaskFields(
+    const Header& header,
+    GenericRandomForestMulticlassClassification<NodeOffsetRep>* model) {
+  STATUS_CHECK_GT(header.num_classes(), 0);
+  model->num_classes = header.num_classes();
+  return absl::OkStatus();
+}
+
+template <typename NodeOffsetRep>
+void ExportTaskFields(
+    const GenericRandomForestCategoricalUplift<NodeOffsetRep>& model,
+    Header* header) {
+  header->set_num_classes(model.num_classes);
+}
+
+template <typename NodeOffsetRep>
+absl::Status ImportTaskFields(
+    const Header& header,
+    GenericRandomForestCategoricalUplift<NodeOffsetRep>* model) {
+  STATUS_CHECK_GT(header.num_classes(), 0);
+  model->num_classes = header.num_classes();
+  return absl::OkStatus();
+}
+
+template <typename NodeOffsetRep>
+void ExportTaskFields(
+    const GenericGradientBoostedTreesBinaryClassification<NodeOffsetRep>&
+        model,
+    Header* header) {
+  header->add_initial_predictions(model.initial_predictions);
+  header->set_output_logits(model.output_logits);
+}
+
+template <typename NodeOffsetRep>
+absl::Status ImportTaskFields(
+    const Header& header,
+    GenericGradientBoostedTreesBinaryClassification<NodeOffsetRep>* model) {
+  STATUS_CHECK_EQ(header.initial_predictions_size(), 1);
+  model->initial_predictions = header.initial_predictions(0);
+  model->output_logits = header.output_logits();
+  return absl::OkStatus();
+}
+
+template <typename NodeOffsetRep>
+void ExportTaskFields(
+    const GenericGradientBoostedTreesMulticlassClassification<NodeOffsetRep>&
+        model,
+    Header* header) {
+  header->set_num_classes(model.num_classes);
+  header->mutable_initial_predictions()->Add(model.initial_predictions.begin(),
+                                             model.initial_predictions.end());
+  header->set_output_logits(model.output_logits);
+}
+
+template <typename NodeOffsetRep>
+absl::Status ImportTaskFields(
+    const Header& header,
+    GenericGradientBoostedTreesMulticlassClassification<NodeOffsetRep>*
+        model) {
+  STATUS_CHECK_GT(header.num_classes(), 0);
+  STATUS_CHECK_EQ(header.initial_predictions_size(), header.num_classes());
+  model->num_classes = header.num_classes();
+  model->initial_predictions.assign(header.initial_predictions().begin(),
+                                    header.initial_predictions().end());
+  model->output_logits = header.output_logits();
+  return absl::OkStatus();
+}
+
+template <typename NodeOffsetRep>
+void ExportTaskFields(
+    const GenericGradientBoostedTreesRegression<NodeOffsetRep>& model,
+    Header* header) {
+  header->add_initial_predictions(model.initial_predictions);
+}
+
+template <typename NodeOffsetRep>
+absl::Status ImportTaskFields(
+    const Header& header,
+    GenericGradientBoostedTreesRegression<NodeOffsetRep>* model) {
+  STATUS_CHECK_EQ(header.initial_predictions_size(), 1);
+  model->initial_predictions = header.initial_predictions(0);
+  return absl::OkStatus();
+}
+
+template <typename NodeOffsetRep>
+void ExportTaskFields(
+    const GenericGradientBoostedTreesRanking<NodeOffsetRep>& model,
+    Header* header) {
+  header->add_initial_predictions(model.initial_predictions);
+}
+
+template <typename NodeOffsetRep>
+absl::Status ImportTaskFields(
+    const Header& header,
+    GenericGradientBoostedTreesRanking<NodeOffsetRep>* model) {
+  STATUS_CHECK_EQ(header.initial_predictions_size(), 1);
+  model->initial_predictions = header.initial_predictions(0);
+  return absl::OkStatus();
+}
+
+// Number of values in "label_buffer" for each leaf. Zero if the leaves store
+// their value in the node.
+template <typename Model>
+int NumLeafOutputs(const Model& model) {
+  return 0;
+}
+
+template <typename NodeOffsetRep>
+int NumLeafOutputs(
+    const GenericRandomForestMulticlassClassification<NodeOffsetRep>& model) {
+  return model.num_classes;
+}
+
+template <typename NodeOffsetRep>
+int NumLeafOutputs(
+    const GenericRandomForestCategoricalUplift<NodeOffsetRep>& model) {
+  return model.num_classes;
+}
+
+// Reading and writing.
+// ====================
+
+// Parses the header of the serving snapshot "content". "sections_begin" is set
+// to the position of the first section in "content".
+absl::Status ParseHeader(const absl::string_view content, Header* header,
+                         size_t* sections_begin) {
+  if (content.size() < kPrefixSize) {
+    return absl::InvalidArgumentError("Truncated serving snapshot");
+  }
+  const char* prefix = content.data();
+  if (std::memcmp(prefix, kMagic, sizeof(kMagic)) != 0) {
+    return absl::InvalidArgumentError("Not a serving snapshot");
+  }
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint64_t header_size;
+  std::memcpy(&version, prefix + 8, sizeof(version));
+  std::memcpy(&byte_order_mark, prefix + 12, sizeof(byte_order_mark));
+  std::memcpy(&header_size, prefix + 16, sizeof(header_size));
+  if (version != kServingSnapshotVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unsupported serving snapshot version ", version,
+                     ". Expecting version ", kServingSnapshotVersion));
+  }
+  if (byte_order_mark != kByteOrderMark) {
+    return absl::InvalidArgumentError(
+        "The serving snapshot was created on a platform with a different byte "
+        "order");
+  }
+
+  if (header_size > kMaxHeaderSize ||
+      header_size > content.size() - kPrefixSize) {
+    return absl::InvalidArgumentError("Invalid serving snapshot header size");
+  }
+  if (!header->ParseFromArray(content.data() + kPrefixSize, header_size)) {
+    return absl::InvalidArgumentError("Cannot parse serving snapshot header");
+  }
+  if (header->sections_size() != kNumSections) {
+    return absl::InvalidArgumentError("Invalid serving snapshot header");
+  }
+  *sections_begin = Align(kPrefixSize + header_size);
+  return absl::OkStatus();
+}
+
+// Gets the array stored in a section of the serving snapshot "content",
+// without copying it.
+template <typename T>
+absl::Status GetSection(const absl::string_view content,
+                        const size_t sections_begin, const Header& header,
+                        const Section section, absl::Span<const T>* values) {
+  const auto& location = header.sections(section);
+  const int64_t offset = location.offset();
+  const int64_t size = location.size();
+  const uint64_t available =
+      content.size() > sections_begin ? content.size() - sections_begin : 0;
+  if (offset < 0 || size < 0 || size % sizeof(T) != 0 ||
+      offset > available || size > available - offset) {
+    return absl::InvalidArgumentError("Invalid serving snapshot section");
+  }
+  const char* begin = content.data() + sections_begin + offset;
+  if (reinterpret_cast<uintptr_t>(begin) % alignof(T) != 0) {
+    return absl::InvalidArgumentError("Misaligned serving snapshot section");
+  }
+  *values = absl::MakeConstSpan(reinterpret_cast<const T*>(begin),
+                                size / sizeof(T));
+  return absl::OkStatus();
+}
+
+// Number of values in the label buffer of a model.
+template <typename Model>
+size_t LabelBufferSize(const Model& model) {
+  switch (model.label_buffer_quantization) {
+    case LeafOutputQuantization::kFloat32:
+      return model.label_buffer_array().size();
+    case LeafOutputQuantization::kFloat16:
+      return model.label_buffer_float16_array().size();
+    case LeafOutputQuantization::kInt8:
+      return model.label_buffer_int8_array().size();
+  }
+  return 0;
+}
+
+// Checks that the condition of a non-leaf node only accesses the features
+// and the buffers of the model.
+template <typename Model>
+absl::Status CheckCondition(const Model& model,
+                            const typename Model::NodeType& node) {
+  using Node = typename Model::NodeType;
+  const auto& fixed_length_features = model.features().fixed_length_features();
+  const auto& categorical_set_features =
+      model.features().categorical_set_features();
+  const auto& data_spec = model.features().data_spec();
+  const auto invalid_condition = []() {
+    return absl::InvalidArgumentError("Invalid serving snapshot condition");
+  };
+  // Tests if "offset + size" is within a buffer of size "buffer_size".
+  const auto in_buffer = [](const uint64_t offset, const uint64_t size,
+                            const uint64_t buffer_size) {
+    return offset + size <= buffer_size;
+  };
+
+  switch (node.type) {
+    case Node::Type::kNumericalIsHigherMissingIsFalse:
+    case Node::Type::kNumericalIsHigherMissingIsTrue:
+    case Node::Type::kCategoricalContainsMask:
+      if (node.feature_idx < 0 ||
+          node.feature_idx >= fixed_length_features.size()) {
+        return invalid_condition();
+      }
+      return absl::OkStatus();
+
+    case Node::Type::kCategoricalContainsBufferOffset: {
+      if (node.feature_idx < 0 ||
+          node.feature_idx >= fixed_length_features.size()) {
+        return invalid_condition();
+      }
+      const auto& column =
+          data_spec.columns(fixed_length_features[node.feature_idx].spec_idx);
+      if (!in_buffer(node.categorical_contains_buffer_offset,
+                     column.categorical().number_of_unique_values(),
+                     model.categorical_mask_buffer.size())) {
+        return invalid_condition();
+      }
+      return absl::OkStatus();
+    }
+
+    case Node::Type::kCategoricalSetContainsBufferOffset: {
+      if (node.feature_idx < 0 ||
+          node.feature_idx >= categorical_set_features.size()) {
+        return invalid_condition();
+      }
+      const auto& column = data_spec.columns(
+          categorical_set_features[node.feature_idx].spec_idx);
+      // The value before the offset is the evaluation of missing values.
+      if (node.categorical_contains_buffer_offset == 0 ||
+          !in_buffer(node.categorical_contains_buffer_offset,
+                     column.categorical().number_of_unique_values(),
+                     model.categorical_mask_buffer.size())) {
+        return invalid_condition();
+      }
+      return absl::OkStatus();
+    }
+
+    case Node::Type::kNumericalObliqueProjectionIsHigher: {
+      const auto num_projections = node.num_oblique_projections;
+      const auto oblique_internal_feature_idxs =
+          model.oblique_internal_feature_idx_array();
+      if (num_projections < 0 ||
+          !in_buffer(node.oblique_projection_offset, num_projections + 1,
+                     model.oblique_weight_array().size()) ||
+          !in_buffer(node.oblique_projection_offset, num_projections,
+                     oblique_internal_feature_idxs.size())) {
+        return invalid_condition();
+      }
+      for (int projection_idx = 0; projection_idx < num_projections;
+           projection_idx++) {
+        const auto feature_idx =
+            oblique_internal_feature_idxs[node.oblique_projection_offset +
+                                          projection_idx];
+        if (feature_idx < 0 || feature_idx >= fixed_length_features.size()) {
+          return invalid_condition();
+        }
+      }
+      return absl::OkStatus();
+    }
+
+    default:
+      return invalid_condition();
+  }
+}
+
+// Checks that the trees of a model read from a snapshot can be traversed
+// without accessing memory outside of the model.
+template <typename Model>
+absl::Status CheckModel(const Model& model) {
+  const int num_leaf_outputs = NumLeafOutputs(model);
+  if (num_leaf_outputs < 0) {
+    return absl::InvalidArgumentError("Invalid serving snapshot model");
+  }
+  const size_t label_buffer_size = LabelBufferSize(model);
+  const auto nodes = model.node_array();
+  const auto root_offsets = model.root_offset_array();
+  const int64_t num_nodes = nodes.size();
+  const int64_t num_trees = root_offsets.size();
+
+  for (int64_t tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+    // The nodes of a tree are contiguous and the trees are stored in order.
+    const int64_t begin = root_offsets[tree_idx];
+    const int64_t end =
+        tree_idx + 1 < num_trees ? root_offsets[tree_idx + 1] : num_nodes;
+    if (begin < 0 || begin >= end || end > num_nodes) {
+      return absl::InvalidArgumentError("Invalid serving snapshot root");
+    }
+
+    for (int64_t node_idx = begin; node_idx < end; node_idx++) {
+      const auto& node = nodes[node_idx];
+      if (node.right_idx == 0) {
+        // A leaf.
+        if (num_leaf_outputs > 0 &&
+            uint64_t{node.label_buffer_offset} + num_leaf_outputs >
+                label_buffer_size) {
+          return absl::InvalidArgumentError("Invalid serving snapshot leaf");
+        }
+        continue;
+      }
+      // The negative child is the next node, and the positive child is
+      // "right_idx" nodes after. Both are in the same tree.
+      if (node_idx + node.right_idx >= end) {
+        return absl::InvalidArgumentError(
+            "Invalid serving snapshot child node");
+      }
+      RETURN_IF_ERROR(CheckCondition(model, node));
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Sets the model from the serving snapshot "file". The arrays of the model
+// reference the content of the file.
+template <typename Model>
+absl::Status ReadModel(const Header& header,
+                       std::shared_ptr<const utils::MemoryMappedFile> file,
+                       const size_t sections_begin, Model* model) {
+  using Node = typename Model::NodeType;
+  if (header.model_type() != ModelType(*model) ||
+      header.node_offset_32bits() !=
+          (sizeof(typename Node::NodeOffset) == sizeof(uint32_t))) {
+    return absl::InvalidArgumentError(
+        "The serving snapshot does not contain this type of model");
+  }
+  if (header.node_size_bytes() != sizeof(Node)) {
+    return absl::InvalidArgumentError(
+        "The serving snapshot was created with an incompatible binary");
+  }
+
+  if (header.node_layout() < static_cast<int>(NodeLayout::kDepthFirst) ||
+      header.node_layout() > static_cast<int>(NodeLayout::kVisitFrequency) ||
+      header.label_buffer_quantization() <
+          static_cast<int>(LeafOutputQuantization::kFloat32) ||
+      header.label_buffer_quantization() >
+          static_cast<int>(LeafOutputQuantization::kInt8)) {
+    return absl::InvalidArgumentError("Invalid serving snapshot header");
+  }
+  for (const int input_feature : header.input_features()) {
+    if (input_feature < 0 ||
+        input_feature >= header.data_spec().columns_size()) {
+      return absl::InvalidArgumentError(
+          "Invalid serving snapshot input feature");
+    }
+  }
+
+  RETURN_IF_ERROR(model->mutable_features()->Initialize(
+      {header.input_features().begin(), header.input_features().end()},
+      header.data_spec(),
+      /*missing_numerical_is_na=*/!header.global_imputation_optimization()));
+  model->global_imputation_optimization =
+      header.global_imputation_optimization();
+  model->batched_traversal = header.batched_traversal();
+  model->node_layout = static_cast<NodeLayout>(header.node_layout());
+  model->label_buffer_quantization =
+      static_cast<LeafOutputQuantization>(header.label_buffer_quantization());
+  model->label_buffer_int8_scale = header.label_buffer_int8_scale();
+  model->metadata = header.metadata();
+  RETURN_IF_ERROR(ImportTaskFields(header, model));
+
+  const absl::string_view content = file->content();
+  auto arrays = std::make_shared<typename Model::ExternalArrays>();
+  RETURN_IF_ERROR(
+      GetSection(content, sections_begin, header, kNodes, &arrays->nodes));
+  RETURN_IF_ERROR(GetSection(content, sections_begin, header, kRootOffsets,
+                             &arrays->root_offsets));
+  RETURN_IF_ERROR(GetSection(content, sections_begin, header, kLabelBuffer,
+                             &arrays->label_buffer));
+  RETURN_IF_ERROR(GetSection(content, sections_begin, header,
+                             kLabelBufferFloat16,
+                             &arrays->label_buffer_float16));
+  RETURN_IF_ERROR(GetSection(content, sections_begin, header, kLabelBufferInt8,
+                             &arrays->label_buffer_int8));
+  absl::Span<const uint8_t> mask_bytes;
+  RETURN_IF_ERROR(GetSection(content, sections_begin, header,
+                             kCategoricalMaskBuffer, &mask_bytes));
+  RETURN_IF_ERROR(GetSection(content, sections_begin, header, kObliqueWeights,
+                             &arrays->oblique_weights));
+  RETURN_IF_ERROR(GetSection(content, sections_begin, header,
+                             kObliqueInternalFeatureIdxs,
+                             &arrays->oblique_internal_feature_idxs));
+  arrays->storage = std::move(file);
+
+  // The model does not own the arrays.
+  model->nodes.clear();
+  model->root_offsets.clear();
+  model->label_buffer.clear();
+  model->label_buffer_float16.clear();
+  model->label_buffer_int8.clear();
+  model->oblique_weights.clear();
+  model->oblique_internal_feature_idxs.clear();
+  model->external_arrays = std::move(arrays);
+
+  // "std::vector<bool>" is not contiguous: The categorical masks are copied.
+  const int64_t num_mask_bits = header.num_categorical_mask_bits();
+  if (num_mask_bits < 0 || mask_bytes.size() != (num_mask_bits + 7) / 8) {
+    return absl::InvalidArgumentError("Invalid serving snapshot mask buffer");
+  }
+  model->categorical_mask_buffer.resize(num_mask_bits);
+  for (int64_t bit_idx = 0; bit_idx < num_mask_bits; bit_idx++) {
+    model->categorical_mask_buffer[bit_idx] =
+        (mask_bytes[bit_idx / 8] >> (bit_idx % 8)) & 1;
+  }
+
+  return CheckModel(*model);
+}
+
+// Creates an engine from the serving snapshot "file".
+template <typename Model>
+absl::StatusOr<std::unique_ptr<FastEngine>> ReadEngine(
+    const Header& header, std::shared_ptr<const utils::MemoryMappedFile> file,
+    const size_t sections_begin) {
+  auto engine = std::make_unique<ExampleSetModelWrapper<Model, Predict>>();
+  RETURN_IF_ERROR(ReadModel(header, std::move(file), sections_begin,
+                            engine->mutable_model()));
+  return engine;
+}
+
+absl::StatusOr<std::shared_ptr<const utils::MemoryMappedFile>> OpenSnapshot(
+    const absl::string_view path) {
+  ASSIGN_OR_RETURN(auto file, utils::MemoryMappedFile::Open(path));
+  return std::shared_ptr<const utils::MemoryMappedFile>(std::move(file));
+}
+
+// Compiles a generic model into a flat node model and saves it.
+template <typename Model, typename GenericModel>
+absl::Status CompileAndSave(const GenericModel& src, absl::string_view path) {
+  Model model;
+  RETURN_IF_ERROR(GenericToSpecializedModel(src, &model));
+  return SaveServingSnapshot(model, path);
+}
+
+template <typename GenericModel>
+bool NeedUint32NodeOffset(const GenericModel& src) {
+  for (const auto& tree : src.decision_trees()) {
+    if (tree->NumNodes() >= std::numeric_limits<uint16_t>::max()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+absl::Status CreateRandomForestServingSnapshot(const RandomForestModel& src,
+                                               absl::string_view path) {
+  const bool uint32_offsets = NeedUint32NodeOffset(src);
+  switch (src.task()) {
+    case model::proto::Task::CLASSIFICATION:
+      if (src.label_col_spec().categorical().number_of_unique_values() == 3) {
+        return uint32_offsets
+                   ? CompileAndSave<
+                         GenericRandomForestBinaryClassification<uint32_t>>(
+                         src, path)
+                   : CompileAndSave<RandomForestBinaryClassification>(src,
+                                                                      path);
+      }
+      return uint32_offsets
+                 ? CompileAndSave<
+                       GenericRandomForestMulticlassClassification<uint32_t>>(
+                       src, path)
+                 : CompileAndSave<RandomForestMulticlassClassification>(src,
+                                                                        path);
+    case model::proto::Task::REGRESSION:
+      return uint32_offsets
+                 ? CompileAndSave<GenericRandomForestRegression<uint32_t>>(
+                       src, path)
+                 : CompileAndSave<RandomForestRegression>(src, path);
+    case model::proto::Task::CATEGORICAL_UPLIFT:
+      return uint32_offsets
+                 ? CompileAndSave<
+                       GenericRandomForestCategoricalUplift<uint32_t>>(src,
+                                                                       path)
+                 : CompileAndSave<RandomForestCategoricalUplift>(src, path);
+    case model::proto::Task::NUMERICAL_UPLIFT:
+      return uint32_offsets
+                 ? CompileAndSave<GenericRandomForestNumericalUplift<uint32_t>>(
+                       src, path)
+                 : CompileAndSave<RandomForestNumericalUplift>(src, path);
+    default:
+      return absl::InvalidArgumentError(
+          "Serving snapshots do not support this task");
+  }
+}
+
+absl::Status CreateGradientBoostedTreesServingSnapshot(
+    const GradientBoostedTreesModel& src, absl::string_view path) {
+  const bool uint32_offsets = NeedUint32NodeOffset(src);
+  if (src.task() == model::proto::Task::CLASSIFICATION &&
+      src.initial_predictions().size() == 1) {
+    return uint32_offsets
+               ? CompileAndSave<
+                     GenericGradientBoostedTreesBinaryClassification<uint32_t>>(
+                     src, path)
+               : CompileAndSave<GradientBoostedTreesBinaryClassification>(
+                     src, path);
+  }
+  if (uint32_offsets) {
+    return absl::InvalidArgumentError(
+        "Serving snapshots only support Gradient Boosted Trees with more than "
+        "65k nodes per tree for binary classification");
+  }
+  switch (src.task()) {
+    case model::proto::Task::CLASSIFICATION:
+      return CompileAndSave<GradientBoostedTreesMulticlassClassification>(
+          src, path);
+    case model::proto::Task::REGRESSION:
+      return CompileAndSave<GradientBoostedTreesRegression>(src, path);
+    case model::proto::Task::RANKING:
+      return CompileAndSave<GradientBoostedTreesRanking>(src, path);
+    default:
+      return absl::InvalidArgumentError(
+          "Serving snapshots do not support this task");
+  }
+}
+
+}  // namespace
+
+template <typename Model>
+absl::Status SaveServingSnapshot(const Model& model, absl::string_view path) {
+  using Node = typename Model::NodeType;
+
+  Header header;
+  header.set_model_type(ModelType(model));
+  header.set_node_offset_32bits(sizeof(typename Node::NodeOffset) ==
+                                sizeof(uint32_t));
+  header.set_node_size_bytes(sizeof(Node));
+  *header.mutable_data_spec() = model.features().data_spec();
+  const auto& input_features = model.features().column_input_features();
+  header.mutable_input_features()->Add(input_features.begin(),
+                                       input_features.end());
+  header.set_global_imputation_optimization(
+      model.global_imputation_optimization);
+  header.set_batched_traversal(model.batched_traversal);
+  header.set_node_layout(static_cast<int>(model.node_layout));
+  header.set_label_buffer_quantization(
+      static_cast<int>(model.label_buffer_quantization));
+  header.set_label_buffer_int8_scale(model.label_buffer_int8_scale);
+  *header.mutable_metadata() = model.metadata;
+  ExportTaskFields(model, &header);
+
+  // "std::vector<bool>" is not contiguous.
+  const auto& mask = model.categorical_mask_buffer;
+  std::vector<uint8_t> mask_bytes((mask.size() + 7) / 8, 0);
+  for (size_t bit_idx = 0; bit_idx < mask.size(); bit_idx++) {
+    if (mask[bit_idx]) {
+      mask_bytes[bit_idx / 8] |= 1 << (bit_idx % 8);
+    }
+  }
+  header.set_num_categorical_mask_bits(mask.size());
+
+  std::vector<absl::string_view> sections(kNumSections);
+  sections[kNodes] = AsBytes(model.node_array());
+  sections[kRootOffsets] = AsBytes(model.root_offset_array());
+  sections[kLabelBuffer] = AsBytes(model.label_buffer_array());
+  sections[kLabelBufferFloat16] = AsBytes(model.label_buffer_float16_array());
+  sections[kLabelBufferInt8] = AsBytes(model.label_buffer_int8_array());
+  sections[kCategoricalMaskBuffer] = AsBytes(absl::MakeConstSpan(mask_bytes));
+  sections[kObliqueWeights] = AsBytes(model.oblique_weight_array());
+  sections[kObliqueInternalFeatureIdxs] =
+      AsBytes(model.oblique_internal_feature_idx_array());
+
+  size_t offset = 0;
+  for (const auto& section : sections) {
+    offset = Align(offset);
+    auto* location = header.add_sections();
+    location->set_offset(offset);
+    location->set_size(section.size());
+    offset += section.size();
+  }
+
+  const std::string serialized_header = header.SerializeAsString();
+  const uint64_t header_size = serialized_header.size();
+  char prefix[kPrefixSize];
+  std::memcpy(prefix, kMagic, sizeof(kMagic));
+  std::memcpy(prefix + 8, &kServingSnapshotVersion,
+              sizeof(kServingSnapshotVersion));
+  std::memcpy(prefix + 12, &kByteOrderMark, sizeof(kByteOrderMark));
+  std::memcpy(prefix + 16, &header_size, sizeof(header_size));
+
+  const std::string padding(kSectionAlignment, 0);
+  ASSIGN_OR_RETURN(auto file, file::OpenOutputFile(path));
+  file::OutputFileCloser closer(std::move(file));
+  RETURN_IF_ERROR(
+      closer.stream()->Write(absl::string_view(prefix, kPrefixSize)));
+  RETURN_IF_ERROR(closer.stream()->Write(serialized_header));
+  RETURN_IF_ERROR(closer.stream()->Write(absl::string_view(
+      padding.data(),
+      Align(kPrefixSize + header_size) - kPrefixSize - header_size)));
+  size_t position = 0;
+  for (int section_idx = 0; section_idx < kNumSections; section_idx++) {
+    const size_t section_offset = header.sections(section_idx).offset();
+    RETURN_IF_ERROR(closer.stream()->Write(
+        absl::string_view(padding.data(), section_offset - position)));
+    RETURN_IF_ERROR(closer.stream()->Write(sections[section_idx]));
+    position = section_offset + sections[section_idx].size();
+  }
+  return closer.Close();
+}
+
+template <typename Model>
+absl::Status LoadServingSnapshot(absl::string_view path, Model* model) {
+  ASSIGN_OR_RETURN(auto file, OpenSnapshot(path));
+  Header header;
+  size_t sections_begin;
+  RETURN_IF_ERROR(ParseHeader(file->content(), &header, &sections_begin));
+  return ReadModel(header, std::move(file), sections_begin, model);
+}
+
+absl::StatusOr<proto::ServingSnapshotHeader> ReadServingSnapshotHeader(
+    absl::string_view path) {
+  ASSIGN_OR_RETURN(const auto file, OpenSnapshot(path));
+  Header header;
+  size_t sections_begin;
+  RETURN_IF_ERROR(ParseHeader(file->content(), &header, &sections_begin));
+  return header;
+}
+
+absl::Status CreateServingSnapshot(const model::AbstractModel& model,
+                                   absl::string_view path) {
+  if (const auto* rf_model = dynamic_cast<const RandomForestModel*>(&model)) {
+    return CreateRandomForestServingSnapshot(*rf_model, path);
+  }
+  if (const auto* gbt_model =
+          dynamic_cast<const GradientBoostedTreesModel*>(&model)) {
+    return CreateGradientBoostedTreesServingSnapshot(*gbt_model, path);
+  }
+  return absl::InvalidArgumentError(
+      "Serving snapshots only support Random Forest and Gradient Boosted Trees "
+      "models");
+}
+
+absl::StatusOr<std::unique_ptr<FastEngine>> LoadServingSnapshotEngine(
+    absl::string_view path) {
+  ASSIGN_OR_RETURN(auto file, OpenSnapshot(path));
+  Header header;
+  size_t sections_begin;
+  RETURN_IF_ERROR(ParseHeader(file->content(), &header, &sections_begin));
+
+  absl::StatusOr<std::unique_ptr<FastEngine>> engine;
+  const bool uint32_offsets = header.node_offset_32bits();
+  switch (header.model_type()) {
+    case Header::RANDOM_FOREST_BINARY_CLASSIFICATION:
+      engine = uint32_offsets
+                   ? ReadEngine<
+                         GenericRandomForestBinaryClassification<uint32_t>>(
+                         header, file, sections_begin)
+                   : ReadEngine<RandomForestBinaryClassification>(
+                         header, file, sections_begin);
+      break;
+    case Header::RANDOM_FOREST_MULTICLASS_CLASSIFICATION:
+      engine = uint32_offsets
+                   ? ReadEngine<
+                         GenericRandomForestMulticlassClassification<uint32_t>>(
+                         header, file, sections_begin)
+                   : ReadEngine<RandomForestMulticlassClassification>(
+                         header, file, sections_begin);
+      break;
+    case Header::RANDOM_FOREST_REGRESSION:
+      engine = uint32_offsets
+                   ? ReadEngine<GenericRandomForestRegression<uint32_t>>(
+                         header, file, sections_begin)
+                   : ReadEngine<RandomForestRegression>(header, file,
+                                                        sections_begin);
+      break;
+    case Header::RANDOM_FOREST_CATEGORICAL_UPLIFT:
+      engine = uint32_offsets
+                   ? ReadEngine<GenericRandomForestCategoricalUplift<uint32_t>>(
+                         header, file, sections_begin)
+                   : ReadEngine<RandomForestCategoricalUplift>(
+                         header, file, sections_begin);
+      break;
+    case Header::RANDOM_FOREST_NUMERICAL_UPLIFT:
+      engine = uint32_offsets
+                   ? ReadEngine<GenericRandomForestNumericalUplift<uint32_t>>(
+                         header, file, sections_begin)
+                   : ReadEngine<RandomForestNumericalUplift>(header, file,
+                                                             sections_begin);
+      break;
+    case Header::GRADIENT_BOOSTED_TREES_BINARY_CLASSIFICATION:
+      engine =
+          uint32_offsets
+              ? ReadEngine<
+                    GenericGradientBoostedTreesBinaryClassification<uint32_t>>(
+                    header, file, sections_begin)
+              : ReadEngine<GradientBoostedTreesBinaryClassification>(
+                    header, file, sections_begin);
+      break;
+    case Header::GRADIENT_BOOSTED_TREES_MULTICLASS_CLASSIFICATION:
+      engine = ReadEngine<GradientBoostedTreesMulticlassClassification>(
+          header, file, sections_begin);
+      break;
+    case Header::GRADIENT_BOOSTED_TREES_REGRESSION:
+      engine = ReadEngine<GradientBoostedTreesRegression>(header, file,
+                                                          sections_begin);
+      break;
+    case Header::GRADIENT_BOOSTED_TREES_RANKING:
+      engine = ReadEngine<GradientBoostedTreesRanking>(header, file,
+                                                       sections_begin);
+      break;
+    default:
+      return absl::InvalidArgumentError("Unknown serving snapshot model type");
+  }
+  return engine;
+}
+
+#define INSTANTIATE_SERVING_SNAPSHOT(MODEL)                                \
+  template absl::Status SaveServingSnapshot(const MODEL& model,            \
+                                            absl::string_view path);       \
+  template absl::Status LoadServingSnapshot(absl::string_view path,        \
+                                            MODEL* model);
+
+INSTANTIATE_SERVING_SNAPSHOT(RandomForestBinaryClassification);
+INSTANTIATE_SERVING_SNAPSHOT(GenericRandomForestBinaryClassification<uint32_t>);
+INSTANTIATE_SERVING_SNAPSHOT(RandomForestMulticlassClassification);
+INSTANTIATE_SERVING_SNAPSHOT(
+    GenericRandomForestMulticlassClassification<uint32_t>);
+INSTANTIATE_SERVING_SNAPSHOT(RandomForestRegression);
+INSTANTIATE_SERVING_SNAPSHOT(GenericRandomForestRegression<uint32_t>);
+INSTANTIATE_SERVING_SNAPSHOT(RandomForestCategoricalUplift);
+INSTANTIATE_SERVING_SNAPSHOT(GenericRandomForestCategoricalUplift<uint32_t>);
+INSTANTIATE_SERVING_SNAPSHOT(RandomForestNumericalUplift);
+INSTANTIATE_SERVING_SNAPSHOT(GenericRandomForestNumericalUplift<uint32_t>);
+INSTANTIATE_SERVING_SNAPSHOT(GradientBoostedTreesBinaryClassification);
+INSTANTIATE_SERVING_SNAPSHOT(
+    GenericGradientBoostedTreesBinaryClassification<uint32_t>);
+INSTANTIATE_SERVING_SNAPSHOT(GradientBoostedTreesMulticlassClassification);
+INSTANTIATE_SERVING_SNAPSHOT(GradientBoostedTreesRegression);
+INSTANTIATE_SERVING_SNAPSHOT(GradientBoostedTreesRanking);
+
+#undef INSTANTIATE_SERVING_SNAPSHOT
+
+}  // namespace decision_forest
+}  // namespace serving
+}  // namespace yggdrasil_decision_forests
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Serving snapshots: A file containing a compiled flat node model (see
+// "ExampleSetModel" in "decision_forest_serving.h") i.e. the arrays of a
+// decision forest engine, as stored in memory.
+//
+// Loading a model normally requires to parse each node of the generic model
+// (see "LoadTreesFromDisk"), and then to compile the generic model into an
+// engine (see "BuildFastEngine"). Instead, loading a serving snapshot memory
+// maps the file, and the engine references the arrays of the file directly,
+// without any copy, parsing or allocation per node. The mapping is kept alive
+// by the engine (and its copies) through "FlatNodeModel::external_arrays". The
+// generic model is never created, and pages of the file are only loaded when
+// accessed. Only the categorical masks, stored as "std::vector<bool>", are
+// copied.
+//
+// The arrays are validated after loading (e.g. the child node offsets, the
+// feature indices and the buffer offsets of the nodes), so that a corrupted
+// snapshot is reported as an error instead of an out-of-bounds access.
+//
+// A serving snapshot is not a replacement for the model: It only supports
+// inference with a specific engine, and it is specific to the byte order and
+// node layout of the binary that created it.
+//
+// File format:
+//
+//   [0, 8): Magic number "YDFSNAP\0".
+//   [8, 12): Format version (uint32).
+//   [12, 16): Byte order mark (uint32 0x01020304).
+//   [16, 24): Size "h" of the header (uint64).
+//   [24, 24+h): Serialized "proto::ServingSnapshotHeader".
+//   Padding to the next multiple of 64 bytes.
+//   The arrays of the model, each aligned on 64 bytes. The location of each
+//     array is listed in the header.
+//
+// Usage example:
+//
+//   // Offline.
+//   std::unique_ptr<model::AbstractModel> model = ...;
+//   RETURN_IF_ERROR(CreateServingSnapshot(*model, "/path/model.ydfsnap"));
+//
+//   // At serving time.
+//   ASSIGN_OR_RETURN(std::unique_ptr<serving::FastEngine> engine,
+//                    LoadServingSnapshotEngine("/path/model.ydfsnap"));
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_SERVING_DECISION_FOREST_SERVING_SNAPSHOT_H_
+#define YGGDRASIL_DECISION_FORESTS_SERVING_DECISION_FOREST_SERVING_SNAPSHOT_H_
+
+#include <memory>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/serving_snapshot.pb.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+
+namespace yggdrasil_decision_forests {
+namespace serving {
+namespace decision_forest {
+
+// Current version of the serving snapshot format.
+constexpr uint32_t kServingSnapshotVersion = 1;
+
+// Saves a flat node model in a serving snapshot.
+//
+// "Model" is one of the generic flat node models e.g.
+// "RandomForestBinaryClassification" or
+// "GenericGradientBoostedTreesBinaryClassification<uint32_t>".
+template <typename Model>
+absl::Status SaveServingSnapshot(const Model& model, absl::string_view path);
+
+// Loads a serving snapshot created with "SaveServingSnapshot" with the same
+// "Model" type. The arrays of "model" reference the mapped file.
+template <typename Model>
+absl::Status LoadServingSnapshot(absl::string_view path, Model* model);
+
+// Reads the header of a serving snapshot.
+absl::StatusOr<proto::ServingSnapshotHeader> ReadServingSnapshotHeader(
+    absl::string_view path);
+
+// Compiles a Random Forest or Gradient Boosted Trees model into the generic
+// flat node engine, and saves it in a serving snapshot.
+absl::Status CreateServingSnapshot(const model::AbstractModel& model,
+                                   absl::string_view path);
+
+// Loads the engine of a serving snapshot created with "CreateServingSnapshot"
+// or "SaveServingSnapshot".
+absl::StatusOr<std::unique_ptr<FastEngine>> LoadServingSnapshotEngine(
+    absl::string_view path);
+
+}  // namespace decision_forest
+}  // namespace serving
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_SERVING_DECISION_FOREST_SERVING_SNAPSHOT_H_
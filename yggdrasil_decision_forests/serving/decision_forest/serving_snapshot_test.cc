@@ -0,0 +1,383 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/serving/decision_forest/serving_snapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/model_library.h"
+#include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest_serving.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/serving_snapshot.pb.h"
+#include "yggdrasil_decision_forests/serving/example_set.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/memory_mapped_file.h"
+#include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace serving {
+namespace decision_forest {
+namespace {
+
+using test::StatusIs;
+using testing::FloatNear;
+using testing::Pointwise;
+
+std::string TestDataDir() {
+  return file::JoinPath(test::DataRootDirectory(),
+                        "yggdrasil_decision_forests/test_data");
+}
+
+struct SnapshotTestCase {
+  std::string model;
+  std::string dataset;
+  proto::ServingSnapshotHeader::ModelType model_type;
+};
+
+class ServingSnapshot : public testing::TestWithParam<SnapshotTestCase> {};
+
+// The engine loaded from the snapshot returns the same predictions as the
+// engine compiled from the model.
+TEST_P(ServingSnapshot, SameAsFastEngine) {
+  std::unique_ptr<model::AbstractModel> model;
+  ASSERT_OK(model::LoadModel(
+      file::JoinPath(TestDataDir(), "model", GetParam().model), &model));
+  dataset::VerticalDataset dataset;
+  ASSERT_OK(dataset::LoadVerticalDataset(
+      absl::StrCat("csv:", file::JoinPath(TestDataDir(), "dataset",
+                                          GetParam().dataset)),
+      model->data_spec(), &dataset));
+
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), GetParam().model + ".ydfsnap");
+  ASSERT_OK(CreateServingSnapshot(*model, path));
+
+  ASSERT_OK_AND_ASSIGN(const auto header, ReadServingSnapshotHeader(path));
+  EXPECT_EQ(header.model_type(), GetParam().model_type);
+
+  ASSERT_OK_AND_ASSIGN(const auto expected_engine, model->BuildFastEngine());
+  ASSERT_OK_AND_ASSIGN(const auto engine, LoadServingSnapshotEngine(path));
+  ASSERT_EQ(engine->NumPredictionDimension(),
+            expected_engine->NumPredictionDimension());
+
+  const int num_examples = dataset.nrow();
+  auto expected_examples = expected_engine->AllocateExamples(num_examples);
+  auto examples = engine->AllocateExamples(num_examples);
+  ASSERT_OK(CopyVerticalDatasetToAbstractExampleSet(
+      dataset, 0, num_examples, expected_engine->features(),
+      expected_examples.get()));
+  ASSERT_OK(CopyVerticalDatasetToAbstractExampleSet(
+      dataset, 0, num_examples, engine->features(), examples.get()));
+
+  std::vector<float> expected_predictions;
+  std::vector<float> predictions;
+  expected_engine->Predict(*expected_examples, num_examples,
+                           &expected_predictions);
+  engine->Predict(*examples, num_examples, &predictions);
+  // The reference engine can be a different algorithm (e.g. QuickScorer) which
+  // accumulates the leaf values in a different order.
+  EXPECT_THAT(predictions,
+              Pointwise(FloatNear(0.0001f), expected_predictions));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ServingSnapshotTests, ServingSnapshot,
+    testing::ValuesIn<SnapshotTestCase>({
+        {"adult_binary_class_gbdt", "adult_test.csv",
+         proto::ServingSnapshotHeader::
+             GRADIENT_BOOSTED_TREES_BINARY_CLASSIFICATION},
+        {"adult_binary_class_gbdt_32cat", "adult_test.csv",
+         proto::ServingSnapshotHeader::
+             GRADIENT_BOOSTED_TREES_BINARY_CLASSIFICATION},
+        {"iris_multi_class_gbdt", "iris.csv",
+         proto::ServingSnapshotHeader::
+             GRADIENT_BOOSTED_TREES_MULTICLASS_CLASSIFICATION},
+        {"abalone_regression_gbdt", "abalone.csv",
+         proto::ServingSnapshotHeader::GRADIENT_BOOSTED_TREES_REGRESSION},
+        {"synthetic_ranking_gbdt", "synthetic_ranking_test.csv",
+         proto::ServingSnapshotHeader::GRADIENT_BOOSTED_TREES_RANKING},
+        {"iris_multi_class_rf", "iris.csv",
+         proto::ServingSnapshotHeader::
+             RANDOM_FOREST_MULTICLASS_CLASSIFICATION},
+        {"sim_pte_categorical_uplift_rf", "sim_pte_test.csv",
+         proto::ServingSnapshotHeader::RANDOM_FOREST_CATEGORICAL_UPLIFT},
+    }),
+    [](const testing::TestParamInfo<ServingSnapshot::ParamType>& info) {
+      return info.param.model;
+    });
+
+TEST(ServingSnapshot, InvalidFile) {
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "invalid.ydfsnap");
+  ASSERT_OK(file::SetContent(path, "This is not a serving snapshot"));
+  EXPECT_THAT(LoadServingSnapshotEngine(path).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  // Truncated file.
+  ASSERT_OK(file::SetContent(path, "YDF"));
+  EXPECT_FALSE(LoadServingSnapshotEngine(path).ok());
+}
+
+TEST(ServingSnapshot, WrongModelType) {
+  std::unique_ptr<model::AbstractModel> model;
+  ASSERT_OK(model::LoadModel(
+      file::JoinPath(TestDataDir(), "model", "iris_multi_class_rf"), &model));
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "wrong_type.ydfsnap");
+  ASSERT_OK(CreateServingSnapshot(*model, path));
+
+  RandomForestRegression regression_model;
+  EXPECT_THAT(LoadServingSnapshot(path, &regression_model),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  RandomForestMulticlassClassification classification_model;
+  EXPECT_OK(LoadServingSnapshot(path, &classification_model));
+  EXPECT_EQ(classification_model.num_classes, 3);
+}
+
+// The arrays of a loaded snapshot reference the mapped file instead of being
+// copied.
+TEST(ServingSnapshot, NoCopy) {
+  std::unique_ptr<model::AbstractModel> model;
+  ASSERT_OK(model::LoadModel(
+      file::JoinPath(TestDataDir(), "model", "iris_multi_class_rf"), &model));
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "no_copy.ydfsnap");
+  ASSERT_OK(CreateServingSnapshot(*model, path));
+
+  RandomForestMulticlassClassification flat_models[2];
+  for (auto& flat_model : flat_models) {
+    ASSERT_OK(LoadServingSnapshot(path, &flat_model));
+    ASSERT_NE(flat_model.external_arrays, nullptr);
+    EXPECT_TRUE(flat_model.nodes.empty());
+    EXPECT_TRUE(flat_model.label_buffer.empty());
+
+    const auto file = std::static_pointer_cast<const utils::MemoryMappedFile>(
+        flat_model.external_arrays->storage);
+    EXPECT_TRUE(file->is_mapped());
+    const char* begin = file->content().data();
+    const char* end = begin + file->content().size();
+    const auto* nodes = reinterpret_cast<const char*>(
+        flat_model.node_array().data());
+    const auto* label_buffer = reinterpret_cast<const char*>(
+        flat_model.label_buffer_array().data());
+    EXPECT_TRUE(nodes >= begin && nodes < end);
+    EXPECT_TRUE(label_buffer >= begin && label_buffer < end);
+  }
+  // Each load maps the file independently.
+  EXPECT_NE(flat_models[0].external_arrays->storage,
+            flat_models[1].external_arrays->storage);
+
+  // The models remain usable, and identical, after being copied.
+  RandomForestMulticlassClassification copied_model = flat_models[1];
+  EXPECT_EQ(copied_model.node_array().data(),
+            flat_models[1].node_array().data());
+  dataset::VerticalDataset dataset;
+  ASSERT_OK(dataset::LoadVerticalDataset(
+      absl::StrCat("csv:",
+                   file::JoinPath(TestDataDir(), "dataset", "iris.csv")),
+      model->data_spec(), &dataset));
+  std::vector<float> predictions[2];
+  for (int model_idx = 0; model_idx < 2; model_idx++) {
+    const auto& flat_model = model_idx == 0 ? flat_models[0] : copied_model;
+    RandomForestMulticlassClassification::ExampleSet examples(
+        dataset.nrow(), flat_model);
+    ASSERT_OK(CopyVerticalDatasetToAbstractExampleSet(
+        dataset, 0, dataset.nrow(), flat_model.features(), &examples));
+    Predict(flat_model, examples, dataset.nrow(), &predictions[model_idx]);
+  }
+  EXPECT_EQ(predictions[0], predictions[1]);
+  EXPECT_EQ(predictions[0].size(), dataset.nrow() * 3);
+}
+
+// Replaces the header of the serving snapshot "content".
+std::string ReplaceHeader(const std::string& content,
+                          const proto::ServingSnapshotHeader& header) {
+  const auto align = [](const size_t value) { return (value + 63) / 64 * 64; };
+  uint64_t header_size;
+  std::memcpy(&header_size, content.data() + 16, sizeof(header_size));
+  const std::string serialized_header = header.SerializeAsString();
+  const uint64_t new_header_size = serialized_header.size();
+  std::string prefix = content.substr(0, 24);
+  std::memcpy(prefix.data() + 16, &new_header_size, sizeof(new_header_size));
+  return absl::StrCat(
+      prefix, serialized_header,
+      std::string(align(24 + new_header_size) - 24 - new_header_size, 0),
+      content.substr(align(24 + header_size)));
+}
+
+TEST(ServingSnapshot, CorruptedFile) {
+  std::unique_ptr<model::AbstractModel> model;
+  ASSERT_OK(model::LoadModel(
+      file::JoinPath(TestDataDir(), "model", "iris_multi_class_rf"), &model));
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "valid.ydfsnap");
+  ASSERT_OK(CreateServingSnapshot(*model, path));
+  ASSERT_OK_AND_ASSIGN(const std::string content, file::GetContent(path));
+  ASSERT_OK_AND_ASSIGN(const auto header, ReadServingSnapshotHeader(path));
+
+  const std::string corrupted_path =
+      file::JoinPath(test::TmpDirectory(), "corrupted.ydfsnap");
+  const auto expect_invalid = [&](const std::string& corrupted_content) {
+    ASSERT_OK(file::SetContent(corrupted_path, corrupted_content));
+    EXPECT_THAT(LoadServingSnapshotEngine(corrupted_path).status(),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  };
+  // The error of a truncated file depends on the file system.
+  const auto expect_truncated = [&](const std::string& corrupted_content) {
+    ASSERT_OK(file::SetContent(corrupted_path, corrupted_content));
+    EXPECT_FALSE(LoadServingSnapshotEngine(corrupted_path).ok());
+  };
+
+  // Truncated file.
+  expect_truncated(content.substr(0, content.size() - 10));
+
+  // Header larger than the file.
+  std::string large_header = content;
+  const uint64_t header_size = uint64_t{1} << 40;
+  std::memcpy(large_header.data() + 16, &header_size, sizeof(header_size));
+  expect_invalid(large_header);
+
+  // Node section larger than the file.
+  auto large_section_header = header;
+  large_section_header.mutable_sections(0)->set_size(
+      header.node_size_bytes() * (int64_t{1} << 40));
+  expect_invalid(ReplaceHeader(content, large_section_header));
+
+  // Section offset past the end of the file.
+  auto large_offset_header = header;
+  large_offset_header.mutable_sections(1)->set_offset(int64_t{1} << 62);
+  expect_invalid(ReplaceHeader(content, large_offset_header));
+
+  // Negative section size.
+  auto negative_section_header = header;
+  negative_section_header.mutable_sections(1)->set_size(-4);
+  expect_invalid(ReplaceHeader(content, negative_section_header));
+
+  // Input feature not in the dataspec.
+  auto invalid_feature_header = header;
+  invalid_feature_header.add_input_features(
+      header.data_spec().columns_size());
+  expect_invalid(ReplaceHeader(content, invalid_feature_header));
+
+  // Saves a snapshot of the model modified by "corrupt", and checks that it
+  // cannot be loaded.
+  const auto expect_invalid_model =
+      [&](const std::function<void(RandomForestMulticlassClassification*)>&
+              corrupt) {
+        // The model is compiled from the generic model since a loaded snapshot
+        // does not own its arrays.
+        RandomForestMulticlassClassification flat_model;
+        ASSERT_OK(GenericToSpecializedModel(
+            *dynamic_cast<model::random_forest::RandomForestModel*>(
+                model.get()),
+            &flat_model));
+        corrupt(&flat_model);
+        ASSERT_OK(SaveServingSnapshot(flat_model, corrupted_path));
+        RandomForestMulticlassClassification loaded_model;
+        EXPECT_THAT(LoadServingSnapshot(corrupted_path, &loaded_model),
+                    StatusIs(absl::StatusCode::kInvalidArgument));
+      };
+
+  // Positive child of the first root in the second tree.
+  expect_invalid_model([](RandomForestMulticlassClassification* flat_model) {
+    flat_model->nodes[0].right_idx = flat_model->root_offsets[1];
+  });
+
+  // Feature index out of range.
+  expect_invalid_model([](RandomForestMulticlassClassification* flat_model) {
+    flat_model->nodes[0].feature_idx = 1000;
+  });
+
+  // Leaf value outside of the label buffer.
+  expect_invalid_model([](RandomForestMulticlassClassification* flat_model) {
+    for (auto& node : flat_model->nodes) {
+      if (node.right_idx == 0) {
+        node.label_buffer_offset = flat_model->label_buffer.size() - 1;
+        break;
+      }
+    }
+  });
+
+  // Root outside of the nodes.
+  expect_invalid_model([](RandomForestMulticlassClassification* flat_model) {
+    flat_model->root_offsets.push_back(flat_model->nodes.size());
+  });
+
+  // No classes.
+  auto no_class_header = header;
+  no_class_header.set_num_classes(0);
+  expect_invalid(ReplaceHeader(content, no_class_header));
+}
+
+TEST(ServingSnapshot, CorruptedMulticlassGradientBoostedTrees) {
+  std::unique_ptr<model::AbstractModel> model;
+  ASSERT_OK(model::LoadModel(
+      file::JoinPath(TestDataDir(), "model", "iris_multi_class_gbdt"),
+      &model));
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "valid_gbt.ydfsnap");
+  ASSERT_OK(CreateServingSnapshot(*model, path));
+  ASSERT_OK_AND_ASSIGN(const std::string content, file::GetContent(path));
+  ASSERT_OK_AND_ASSIGN(const auto header, ReadServingSnapshotHeader(path));
+  ASSERT_EQ(header.model_type(),
+            proto::ServingSnapshotHeader::
+                GRADIENT_BOOSTED_TREES_MULTICLASS_CLASSIFICATION);
+
+  const std::string corrupted_path =
+      file::JoinPath(test::TmpDirectory(), "corrupted_gbt.ydfsnap");
+  const auto expect_invalid = [&](const proto::ServingSnapshotHeader&
+                                      corrupted_header) {
+    ASSERT_OK(file::SetContent(corrupted_path,
+                               ReplaceHeader(content, corrupted_header)));
+    EXPECT_THAT(LoadServingSnapshotEngine(corrupted_path).status(),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  };
+
+  // No classes.
+  auto no_class_header = header;
+  no_class_header.set_num_classes(0);
+  no_class_header.clear_initial_predictions();
+  expect_invalid(no_class_header);
+
+  // Fewer initial predictions than classes.
+  auto missing_prediction_header = header;
+  missing_prediction_header.mutable_initial_predictions()->RemoveLast();
+  expect_invalid(missing_prediction_header);
+
+  // More classes than initial predictions.
+  auto extra_class_header = header;
+  extra_class_header.set_num_classes(header.num_classes() + 1);
+  expect_invalid(extra_class_header);
+}
+
+}  // namespace
+}  // namespace decision_forest
+}  // namespace serving
+}  // namespace yggdrasil_decision_forests
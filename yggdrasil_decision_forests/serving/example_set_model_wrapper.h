@@ -72,6 +72,10 @@ class ExampleSetModelWrapper : public FastEngine {
     return model_.features();
   }
 
+  // Underlying model. Used to load a model without "LoadModel" e.g. from a
+  // serving snapshot.
+  Model* mutable_model() { return &model_; }
+
  private:
   Model model_;
 };
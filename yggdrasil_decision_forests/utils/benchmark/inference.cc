@@ -19,9 +19,11 @@
 #include <cmath>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/clock.h"
@@ -29,6 +31,10 @@
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/fast_engine_factory.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest_serving.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/quick_scorer_extended.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/register_engines.h"
 #include "yggdrasil_decision_forests/serving/example_set.h"
 #include "yggdrasil_decision_forests/serving/fast_engine.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
@@ -220,4 +226,113 @@ absl::Status BenchmarkFastEngine(const BenchmarkInferenceRunOptions& options,
   return absl::OkStatus();
 }
 
+absl::StatusOr<QuickScorerInstructionSetSpeedup>
+BenchmarkQuickScorerInstructionSets(
+    const BenchmarkInferenceRunOptions& options,
+    const model::AbstractModel& model, const dataset::VerticalDataset& dataset,
+    std::vector<BenchmarkInferenceResult>* results) {
+  using serving::decision_forest::IsQuickScorerInstructionSetSupported;
+  using serving::decision_forest::QuickScorerInstructionSet;
+
+  // Note: The AVX2 implementation is only compiled with "-mavx2" while the
+  // AVX-512 implementation is selected at runtime. Limiting the engine to AVX2
+  // in a binary without AVX2 runs the scalar implementation.
+  QuickScorerInstructionSetSpeedup speedup{
+      /*.baseline =*/IsQuickScorerInstructionSetSupported(
+          QuickScorerInstructionSet::kAVX2)
+          ? QuickScorerInstructionSet::kAVX2
+          : QuickScorerInstructionSet::kScalar,
+      /*.speedup =*/1.};
+  const bool avx512_supported =
+      IsQuickScorerInstructionSetSupported(QuickScorerInstructionSet::kAVX512);
+
+  absl::Duration duration_per_example[3];
+  for (const auto instruction_set :
+       {speedup.baseline, QuickScorerInstructionSet::kAVX512}) {
+    if (!IsQuickScorerInstructionSetSupported(instruction_set)) {
+      continue;
+    }
+    serving::decision_forest::EngineOptions engine_options;
+    engine_options.max_quick_scorer_instruction_set = instruction_set;
+    ASSIGN_OR_RETURN(
+        const auto engine,
+        serving::decision_forest::CreateEngine(
+            model, serving::gradient_boosted_trees::kQuickScorerExtended,
+            engine_options));
+
+    RETURN_IF_ERROR(BenchmarkFastEngine(
+        options, *engine, model, dataset, results,
+        absl::StrCat(
+            serving::gradient_boosted_trees::kQuickScorerExtended, " [",
+            serving::decision_forest::QuickScorerInstructionSetName(
+                instruction_set),
+            "]")));
+    duration_per_example[static_cast<int>(instruction_set)] =
+        results->back().duration_per_example;
+  }
+
+  if (!avx512_supported) {
+    YDF_LOG(INFO) << "AVX-512 is not supported by the binary or by the CPU.";
+    return speedup;
+  }
+  speedup.speedup = absl::FDivDuration(
+      duration_per_example[static_cast<int>(speedup.baseline)],
+      duration_per_example[static_cast<int>(
+          QuickScorerInstructionSet::kAVX512)]);
+  YDF_LOG(INFO) << "Speedup of the AVX-512 QuickScorer over "
+                << serving::decision_forest::QuickScorerInstructionSetName(
+                       speedup.baseline)
+                << ": " << speedup.speedup;
+  return speedup;
+}
+
+absl::StatusOr<std::vector<NodeLayoutSpeedup>> BenchmarkNodeLayouts(
+    const BenchmarkInferenceRunOptions& options,
+    const model::AbstractModel& model, const dataset::VerticalDataset& dataset,
+    std::vector<BenchmarkInferenceResult>* results) {
+  using serving::decision_forest::NodeLayout;
+
+  std::vector<NodeLayoutSpeedup> speedups;
+  for (const auto& engine_factory : model.ListCompatibleFastEngines()) {
+    const std::string engine_name = engine_factory->name();
+    if (engine_name != serving::gradient_boosted_trees::kGeneric &&
+        engine_name != serving::gradient_boosted_trees::kOptPred &&
+        engine_name != serving::random_forest::kGeneric &&
+        engine_name != serving::random_forest::kOptPred) {
+      // The engine does not use flat nodes.
+      continue;
+    }
+    absl::Duration depth_first_duration_per_example;
+    for (const auto node_layout :
+         {NodeLayout::kDepthFirst, NodeLayout::kBreadthFirst,
+          NodeLayout::kVisitFrequency}) {
+      serving::decision_forest::EngineOptions engine_options;
+      engine_options.node_layout = node_layout;
+      ASSIGN_OR_RETURN(const auto engine,
+                       serving::decision_forest::CreateEngine(
+                           model, engine_name, engine_options));
+
+      RETURN_IF_ERROR(BenchmarkFastEngine(
+          options, *engine, model, dataset, results,
+          absl::StrCat(engine_name, " [",
+                       serving::decision_forest::NodeLayoutName(node_layout),
+                       "]")));
+      const auto duration_per_example = results->back().duration_per_example;
+      if (node_layout == NodeLayout::kDepthFirst) {
+        depth_first_duration_per_example = duration_per_example;
+        continue;
+      }
+      speedups.push_back(
+          {engine_name, node_layout,
+           absl::FDivDuration(depth_first_duration_per_example,
+                              duration_per_example)});
+      YDF_LOG(INFO) << "Speedup of the "
+                    << serving::decision_forest::NodeLayoutName(node_layout)
+                    << " node layout over DEPTH_FIRST for " << engine_name
+                    << ": " << speedups.back().speedup;
+    }
+  }
+  return speedups;
+}
+
 }  // namespace yggdrasil_decision_forests::utils
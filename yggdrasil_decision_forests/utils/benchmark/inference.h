@@ -20,12 +20,15 @@
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/model_library.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest_serving.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/quick_scorer_extended.h"
 #include "yggdrasil_decision_forests/serving/fast_engine.h"
 
 namespace yggdrasil_decision_forests::utils {
@@ -76,6 +79,43 @@ absl::Status BenchmarkFastEngine(const BenchmarkInferenceRunOptions& options,
                                  std::vector<BenchmarkInferenceResult>* results,
                                  absl::string_view engine_name = "");
 
+// Speedup of the AVX-512 QuickScorer over a narrower instruction set.
+struct QuickScorerInstructionSetSpeedup {
+  // AVX2 if supported by the binary and the CPU, scalar otherwise.
+  serving::decision_forest::QuickScorerInstructionSet baseline;
+  // Ratio of the time per example of "baseline" and of AVX-512.
+  double speedup;
+};
+
+// Benchmarks the "GradientBoostedTreesQuickScorerExtended" engine with AVX-512
+// and with the widest narrower instruction set (AVX2 or scalar) supported by
+// the binary and the CPU. Returns the speedup of the AVX-512 implementation
+// over this baseline. The speedup is 1 if AVX-512 is not available. Fails if
+// the model is not compatible with the engine.
+absl::StatusOr<QuickScorerInstructionSetSpeedup>
+BenchmarkQuickScorerInstructionSets(
+    const BenchmarkInferenceRunOptions& options,
+    const model::AbstractModel& model, const dataset::VerticalDataset& dataset,
+    std::vector<BenchmarkInferenceResult>* results);
+
+// Speedup of a node layout over the depth-first layout for an engine.
+struct NodeLayoutSpeedup {
+  std::string engine_name;
+  serving::decision_forest::NodeLayout node_layout;
+  // Ratio of the time per example of the depth-first layout and of
+  // "node_layout".
+  double speedup;
+};
+
+// Benchmarks the engines built on flat node models (i.e. the generic and
+// OptPred engines) compatible with the model with each node layout (see
+// "serving::decision_forest::NodeLayout"). Returns the speedup of the
+// non-default layouts over the default depth-first layout.
+absl::StatusOr<std::vector<NodeLayoutSpeedup>> BenchmarkNodeLayouts(
+    const BenchmarkInferenceRunOptions& options,
+    const model::AbstractModel& model, const dataset::VerticalDataset& dataset,
+    std::vector<BenchmarkInferenceResult>* results);
+
 }  // namespace yggdrasil_decision_forests::utils
 
 #endif  // YGGDRASIL_DECISION_FORESTS_UTILS_BENCHMARK_INFERENCE_H_
@@ -28,6 +28,9 @@
 #include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/model_library.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/decision_forest_serving.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/quick_scorer_extended.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
 #include "yggdrasil_decision_forests/utils/test.h"
 #include "yggdrasil_decision_forests/utils/testing_macros.h"
@@ -91,5 +94,77 @@ TEST(BenchmarkInference, GenericEngine) {
   EXPECT_GT(absl::ToDoubleSeconds(results[0].duration_per_example), 0);
 }
 
+TEST(BenchmarkInference, QuickScorerInstructionSets) {
+  const BenchmarkInterfaceNumRunsOptions num_runs_options = {
+      /*.num_runs =*/2,
+      /*.warmup_runs =*/1,
+  };
+  const BenchmarkInferenceRunOptions options{/*.batch_size =*/100,
+                                             /*.runs =*/num_runs_options,
+                                             /*.time =*/std::nullopt};
+  std::vector<BenchmarkInferenceResult> results;
+
+  std::unique_ptr<model::AbstractModel> model;
+  EXPECT_OK(model::LoadModel(
+      file::JoinPath(TestDataDir(), "model", "adult_binary_class_gbdt"),
+      &model));
+
+  dataset::VerticalDataset dataset;
+  EXPECT_OK(dataset::LoadVerticalDataset(
+      absl::StrCat("csv:",
+                   file::JoinPath(TestDataDir(), "dataset", "adult_test.csv")),
+      model->data_spec(), &dataset));
+
+  ASSERT_OK_AND_ASSIGN(
+      const auto speedup,
+      BenchmarkQuickScorerInstructionSets(options, *model, dataset, &results));
+  EXPECT_GT(speedup.speedup, 0);
+  EXPECT_NE(speedup.baseline,
+            serving::decision_forest::QuickScorerInstructionSet::kAVX512);
+  for (const auto& result : results) {
+    EXPECT_THAT(result.name,
+                testing::HasSubstr("GradientBoostedTreesQuickScorerExtended"));
+    EXPECT_GT(absl::ToDoubleSeconds(result.duration_per_example), 0);
+  }
+}
+
+TEST(BenchmarkInference, NodeLayouts) {
+  const BenchmarkInterfaceNumRunsOptions num_runs_options = {
+      /*.num_runs =*/2,
+      /*.warmup_runs =*/1,
+  };
+  const BenchmarkInferenceRunOptions options{/*.batch_size =*/100,
+                                             /*.runs =*/num_runs_options,
+                                             /*.time =*/std::nullopt};
+  std::vector<BenchmarkInferenceResult> results;
+
+  std::unique_ptr<model::AbstractModel> model;
+  EXPECT_OK(model::LoadModel(
+      file::JoinPath(TestDataDir(), "model", "adult_binary_class_gbdt"),
+      &model));
+
+  dataset::VerticalDataset dataset;
+  EXPECT_OK(dataset::LoadVerticalDataset(
+      absl::StrCat("csv:",
+                   file::JoinPath(TestDataDir(), "dataset", "adult_test.csv")),
+      model->data_spec(), &dataset));
+
+  ASSERT_OK_AND_ASSIGN(const auto speedups, BenchmarkNodeLayouts(
+                                                options, *model, dataset,
+                                                &results));
+  // The generic engine is the only compatible engine using flat nodes.
+  EXPECT_THAT(speedups, testing::SizeIs(2));
+  EXPECT_THAT(results, testing::SizeIs(3));
+  for (const auto& speedup : speedups) {
+    EXPECT_GT(speedup.speedup, 0);
+  }
+  for (const auto& result : results) {
+    EXPECT_THAT(result.name,
+                testing::AnyOf(testing::HasSubstr("[DEPTH_FIRST]"),
+                               testing::HasSubstr("[BREADTH_FIRST]"),
+                               testing::HasSubstr("[VISIT_FREQUENCY]")));
+  }
+}
+
 }  // namespace
 }  // namespace yggdrasil_decision_forests::utils
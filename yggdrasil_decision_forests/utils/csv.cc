@@ -15,6 +15,14 @@
 
 #include "yggdrasil_decision_forests/utils/csv.h"
 
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "absl/numeric/bits.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
@@ -53,6 +61,40 @@ bool NeedsEscape(absl::string_view field) {
   return false;
 }
 
+// Returns a pointer to the first character in [begin, end) equal to "a", "b",
+// "c" or "d". Returns "end" if there are no such characters.
+const char* FindFirstOf(const char* begin, const char* const end, const char a,
+                        const char b, const char c, const char d) {
+#if defined(__SSE2__)
+  // Test 16 characters at a time.
+  const __m128i simd_a = _mm_set1_epi8(a);
+  const __m128i simd_b = _mm_set1_epi8(b);
+  const __m128i simd_c = _mm_set1_epi8(c);
+  const __m128i simd_d = _mm_set1_epi8(d);
+  while (end - begin >= 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const __m128i match =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, simd_a),
+                                  _mm_cmpeq_epi8(block, simd_b)),
+                     _mm_or_si128(_mm_cmpeq_epi8(block, simd_c),
+                                  _mm_cmpeq_epi8(block, simd_d)));
+    const uint32_t mask = _mm_movemask_epi8(match);
+    if (mask != 0) {
+      return begin + absl::countr_zero(mask);
+    }
+    begin += 16;
+  }
+#endif
+  for (; begin < end; begin++) {
+    const char x = *begin;
+    if (x == a || x == b || x == c || x == d) {
+      return begin;
+    }
+  }
+  return end;
+}
+
 }  // namespace
 
 Reader::Reader(InputByteStream* stream) : stream_(stream) {}
@@ -213,6 +255,123 @@ void Reader::FinalizeRowCache() {
   }
 }
 
+BufferReader::BufferReader(char* buffer, const size_t size)
+    : buffer_(buffer), size_(size) {}
+
+absl::StatusOr<bool> BufferReader::NextRow(
+    std::vector<absl::string_view>** fields) {
+  *fields = &fields_;
+  fields_.clear();
+  if (pos_ >= size_) {
+    // The end of the buffer is reached.
+    return false;
+  }
+  num_rows_++;
+
+  const char* const end = buffer_ + size_;
+  while (true) {
+    // Beginning of a field.
+    if (pos_ < size_ && buffer_[pos_] == '"') {
+      RETURN_IF_ERROR(ReadQuotedField());
+    } else {
+      const char* const begin = buffer_ + pos_;
+      const char* const sep = FindFirstOf(begin, end, ',', '"', '\n', '\r');
+      if (sep != end && *sep == '"') {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Quote in non quoted field at line %d", num_rows_));
+      }
+      fields_.emplace_back(begin, sep - begin);
+      pos_ = sep - buffer_;
+    }
+
+    // End of the field.
+    if (pos_ >= size_) {
+      return true;
+    }
+    const char c = buffer_[pos_];
+    if (c == ',') {
+      pos_++;
+    } else if (c == '\n' || c == '\r') {
+      ConsumeEndOfRow();
+      return true;
+    } else {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Unexpected character after quote: '%c' at line %d",
+                          c, num_rows_));
+    }
+  }
+}
+
+absl::Status BufferReader::ReadQuotedField() {
+  // Skip the opening quote.
+  pos_++;
+  const char* const end = buffer_ + size_;
+  // The unescaped field is written at "dst". "dst" is always behind the
+  // current character.
+  char* const field_begin = buffer_ + pos_;
+  char* dst = field_begin;
+  while (true) {
+    const char* const src = buffer_ + pos_;
+    const char* const quote =
+        static_cast<const char*>(std::memchr(src, '"', end - src));
+    if (quote == nullptr) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "End of file reached in a quote at line %d", num_rows_));
+    }
+    const size_t length = quote - src;
+    if (dst != src) {
+      std::memmove(dst, src, length);
+    }
+    dst += length;
+    pos_ = quote - buffer_ + 1;
+    if (pos_ < size_ && buffer_[pos_] == '"') {
+      // Escaped double quote.
+      *dst++ = '"';
+      pos_++;
+    } else {
+      break;
+    }
+  }
+  fields_.emplace_back(field_begin, dst - field_begin);
+  return absl::OkStatus();
+}
+
+void BufferReader::ConsumeEndOfRow() {
+  if (pos_ < size_ && buffer_[pos_] == '\r') {
+    pos_++;
+  }
+  if (pos_ < size_ && buffer_[pos_] == '\n') {
+    pos_++;
+  }
+}
+
+size_t CompleteRowsPrefixSize(const absl::string_view buffer) {
+  const char* const begin = buffer.data();
+  const char* const end = begin + buffer.size();
+  size_t prefix_size = 0;
+  bool in_quote = false;
+  const char* cur = begin;
+  while (true) {
+    // Note: Escaped quotes are seen as two consecutive quotes.
+    cur = in_quote ? static_cast<const char*>(
+                         std::memchr(cur, '"', end - cur))
+                   : FindFirstOf(cur, end, '"', '"', '\n', '\r');
+    if (cur == nullptr || cur == end) {
+      break;
+    }
+    if (*cur == '"') {
+      in_quote = !in_quote;
+    } else if (*cur == '\n') {
+      prefix_size = cur - begin + 1;
+    } else if (cur + 1 < end && cur[1] != '\n') {
+      // Mac new line i.e. a '\r' not followed by a '\n'.
+      prefix_size = cur - begin + 1;
+    }
+    cur++;
+  }
+  return prefix_size;
+}
+
 Writer::Writer(OutputByteStream* stream, NewLine newline) : stream_(stream) {
   switch (newline) {
     case NewLine::UNIX:
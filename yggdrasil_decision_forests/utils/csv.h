@@ -27,6 +27,13 @@
 //   }
 //   file_handle->Close();
 //
+//   // Reader of an in-memory buffer.
+//   std::string buffer = ...;
+//   BufferReader reader(buffer.data(), buffer.size());
+//   while(reader.NextRow(&row).value()) {
+//     // Do something with "row".
+//   }
+//
 //   // Writer
 //   auto file_handle = file::OpenOutputFile(...).value();
 //   Writer writer(output_handle.get());
@@ -44,9 +51,12 @@
 #ifndef THIRD_PARTY_YGGDRASIL_DECISION_FORESTS_UTILS_CSV_H_
 #define THIRD_PARTY_YGGDRASIL_DECISION_FORESTS_UTILS_CSV_H_
 
+#include <cstddef>
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "yggdrasil_decision_forests/utils/bytestream.h"
 
 namespace yggdrasil_decision_forests {
@@ -128,6 +138,57 @@ class Reader {
   int num_rows = 0;
 };
 
+// Parses the CSV rows stored in a memory buffer e.g. a chunk of file split with
+// "CompleteRowsPrefixSize". Supports the same format as "Reader".
+//
+// Unlike "Reader", the fields are not copied: The returned fields point
+// directly in the buffer, and quoted fields are unescaped in place. Therefore,
+// the buffer is modified by the reader, and should outlive the returned
+// fields.
+class BufferReader {
+ public:
+  // Does not take ownership of "buffer".
+  BufferReader(char* buffer, size_t size);
+
+  // Reads the next row. The data pointed by "row" is valid until the next call
+  // to "NextRow" or until the buffer is destroyed. Returns false when no new
+  // rows are available.
+  absl::StatusOr<bool> NextRow(std::vector<absl::string_view>** fields);
+
+  // Number of bytes of the buffer consumed so far.
+  size_t num_consumed_bytes() const { return pos_; }
+
+ private:
+  // Parses a quoted field starting at "pos_" (i.e. the opening quote) and
+  // adds it to "fields_".
+  absl::Status ReadQuotedField();
+
+  // Consumes the character(s) representing an end of row, if any.
+  void ConsumeEndOfRow();
+
+  // Non-owned buffer.
+  char* buffer_;
+  size_t size_;
+
+  // Index, in "buffer_", of the current character.
+  size_t pos_ = 0;
+
+  // Fields of the last read row.
+  std::vector<absl::string_view> fields_;
+
+  // Number of rows read so far.
+  int num_rows_ = 0;
+};
+
+// Returns the size of the longest prefix of "buffer" made of complete rows i.e.
+// the index following the last end of row which is not in a quoted field.
+// "buffer" should start at the beginning of a row. Returns 0 if "buffer" does
+// not contain any complete row.
+//
+// A '\r' at the end of "buffer" is not considered as an end of row since it can
+// be followed by a '\n' in the next chunk.
+size_t CompleteRowsPrefixSize(absl::string_view buffer);
+
 class Writer {
  public:
   // CSV writer constructor.
@@ -15,10 +15,18 @@
 
 #include "yggdrasil_decision_forests/utils/csv.h"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
 #include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
 
 namespace yggdrasil_decision_forests {
 namespace utils {
@@ -256,6 +264,102 @@ TEST(Csv, WriterUnix) {
   EXPECT_OK(input_handle->Close());
 }
 
+// Reads all the rows with "Reader".
+absl::StatusOr<std::vector<std::vector<std::string>>> ReadAllRows(
+    const absl::string_view content) {
+  StringInputByteStream stream{std::string(content)};
+  Reader reader(&stream);
+  std::vector<std::vector<std::string>> rows;
+  std::vector<absl::string_view>* row;
+  while (true) {
+    ASSIGN_OR_RETURN(const bool has_row, reader.NextRow(&row));
+    if (!has_row) {
+      break;
+    }
+    rows.push_back({row->begin(), row->end()});
+  }
+  return rows;
+}
+
+// Reads all the rows with "BufferReader". The buffer is split into chunks with
+// "CompleteRowsPrefixSize" after each "step" bytes.
+absl::StatusOr<std::vector<std::vector<std::string>>> ReadAllRowsInChunks(
+    const absl::string_view content, const int step) {
+  std::vector<std::vector<std::string>> rows;
+  size_t begin = 0;
+  size_t end = 0;
+  while (begin < content.size()) {
+    end = std::min(end + step, content.size());
+    size_t chunk_size = content.size() - begin;
+    if (end < content.size()) {
+      chunk_size = CompleteRowsPrefixSize(content.substr(begin, end - begin));
+      if (chunk_size == 0) {
+        continue;
+      }
+    }
+    std::string chunk(content.substr(begin, chunk_size));
+    BufferReader reader(&chunk[0], chunk.size());
+    std::vector<absl::string_view>* row;
+    while (true) {
+      ASSIGN_OR_RETURN(const bool has_row, reader.NextRow(&row));
+      if (!has_row) {
+        break;
+      }
+      rows.push_back({row->begin(), row->end()});
+    }
+    begin += chunk_size;
+    end = begin;
+  }
+  return rows;
+}
+
+TEST(Csv, BufferReaderSameAsReader) {
+  const std::vector<std::string> contents = {
+      "a,b\nc,d\n",
+      "a,b\r\nc,d\r\n",
+      "a,b\rc,d\r",
+      "a,b\rc,d\r\ne,f",
+      "a,b\n,,\n\n,\n",
+      "a,b\n\"c\",\"d\"\n\"\",\"\"\n\"\"\"\",\"\"\"\"\n\"a\"\"b\",\",c\nd\"",
+      "x,\"multi\r\nline\",\"with \"\"quotes\"\"\"\r\n1,2,3\r\n4,\"\",",
+      "a very long field to test the vectorized scan,another one,\"and a "
+      "quoted one, with a comma\"\nfoo,bar,\"\n\n\"\n",
+  };
+  for (const auto& content : contents) {
+    ASSERT_OK_AND_ASSIGN(const auto expected_rows, ReadAllRows(content));
+    for (int step = 1; step <= content.size(); step++) {
+      ASSERT_OK_AND_ASSIGN(const auto rows, ReadAllRowsInChunks(content, step));
+      EXPECT_EQ(rows, expected_rows) << "content: " << content
+                                     << " step: " << step;
+    }
+  }
+}
+
+TEST(Csv, BufferReaderErrors) {
+  for (const std::string content : {"a,\"b\nc,d\n", "a,b\"\"c", "a,\"b\"c\n"}) {
+    std::string buffer = content;
+    BufferReader reader(&buffer[0], buffer.size());
+    std::vector<absl::string_view>* row;
+    absl::StatusOr<bool> status;
+    while ((status = reader.NextRow(&row)).ok() && status.value()) {
+    }
+    EXPECT_FALSE(status.ok()) << content;
+  }
+}
+
+TEST(Csv, CompleteRowsPrefixSize) {
+  EXPECT_EQ(CompleteRowsPrefixSize(""), 0);
+  EXPECT_EQ(CompleteRowsPrefixSize("a,b"), 0);
+  EXPECT_EQ(CompleteRowsPrefixSize("a,b\nc"), 4);
+  EXPECT_EQ(CompleteRowsPrefixSize("a,b\nc,d\n"), 8);
+  EXPECT_EQ(CompleteRowsPrefixSize("a,b\r"), 0);
+  EXPECT_EQ(CompleteRowsPrefixSize("a,b\r\n"), 5);
+  EXPECT_EQ(CompleteRowsPrefixSize("a,b\rc"), 4);
+  EXPECT_EQ(CompleteRowsPrefixSize("a,\"b\nc\"\nd"), 8);
+  EXPECT_EQ(CompleteRowsPrefixSize("a\n\"b\nc"), 2);
+  EXPECT_EQ(CompleteRowsPrefixSize("a\n\"b\"\"\nc"), 2);
+}
+
 }  // namespace
 }  // namespace csv
 }  // namespace utils
@@ -16,16 +16,23 @@
 #include "yggdrasil_decision_forests/utils/feature_importance.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <numeric>
 #include <random>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/example.pb.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
@@ -33,7 +40,11 @@
 #include "yggdrasil_decision_forests/metric/metric.pb.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_forest_interface.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/utils/concurrency.h"
+#include "yggdrasil_decision_forests/utils/logging.h"
 #include "yggdrasil_decision_forests/utils/random.h"
 
 namespace yggdrasil_decision_forests {
@@ -71,6 +82,220 @@ void SortVariableImportance(const std::vector<std::string>& importance_names,
   }
 }
 
+// Leaves reached by the examples of a dataset in the trees of a decision
+// forest, and the accumulated outputs of these leaves.
+struct ForestLeafCache {
+  const model::DecisionForestInterface* forest;
+  int num_trees;
+  int accumulator_size;
+  // "leaves[example_idx * num_trees + tree_idx]" is the leaf reached by the
+  // example "example_idx" in the tree "tree_idx".
+  std::vector<const model::decision_tree::proto::Node*> leaves;
+  // "accumulators[example_idx * accumulator_size + i]" is the i-th value of
+  // the accumulator (see "DecisionForestInterface::AddLeafToAccumulator") of
+  // the example "example_idx" over all the trees.
+  std::vector<double> accumulators;
+  // "trees_per_feature[feature_idx]" are the trees with at least one
+  // condition on "feature_idx".
+  std::vector<std::vector<int>> trees_per_feature;
+};
+
+// Tests if a tree contains oblique conditions. The leaf of a tree with oblique
+// conditions cannot be computed with "GetLeafWithSwappedAttribute".
+bool HasObliqueCondition(const model::decision_tree::DecisionTree& tree) {
+  bool has_oblique_condition = false;
+  tree.IterateOnNodes([&](const model::decision_tree::NodeWithChildren& node,
+                          const int depth) {
+    if (!node.IsLeaf() &&
+        node.node().condition().condition().has_oblique_condition()) {
+      has_oblique_condition = true;
+    }
+  });
+  return has_oblique_condition;
+}
+
+// Computes the leaves reached by all the examples of "dataset". Returns
+// nullptr if the model does not support the incremental computation of the
+// permutation feature importances.
+std::unique_ptr<ForestLeafCache> BuildForestLeafCache(
+    const dataset::VerticalDataset& dataset, const model::AbstractModel& model,
+    const ComputeFeatureImportanceOptions& options) {
+  const auto* forest =
+      dynamic_cast<const model::DecisionForestInterface*>(&model);
+  if (forest == nullptr) {
+    return {};
+  }
+  const int accumulator_size = forest->LeafAccumulatorSize();
+  if (accumulator_size == 0) {
+    return {};
+  }
+  const auto& trees = forest->decision_trees();
+  const int64_t cache_size_bytes =
+      dataset.nrow() *
+      (trees.size() * sizeof(const model::decision_tree::proto::Node*) +
+       accumulator_size * sizeof(double));
+  if (cache_size_bytes > options.incremental_max_memory_bytes) {
+    YDF_LOG(INFO) << "The leaf cache of the incremental permutation feature "
+                     "importance would use "
+                  << cache_size_bytes << " bytes (limit: "
+                  << options.incremental_max_memory_bytes
+                  << "). Using the non-incremental computation.";
+    return {};
+  }
+
+  auto cache = absl::make_unique<ForestLeafCache>();
+  cache->forest = forest;
+  cache->num_trees = trees.size();
+  cache->accumulator_size = accumulator_size;
+  cache->trees_per_feature.resize(model.data_spec().columns_size());
+  for (int tree_idx = 0; tree_idx < trees.size(); tree_idx++) {
+    if (HasObliqueCondition(*trees[tree_idx])) {
+      YDF_LOG(INFO) << "The model contains oblique conditions. Using the "
+                       "non-incremental permutation feature importance.";
+      return {};
+    }
+    std::unordered_map<int32_t, int64_t> feature_usage;
+    trees[tree_idx]->CountFeatureUsage(&feature_usage);
+    for (const auto& usage : feature_usage) {
+      cache->trees_per_feature[usage.first].push_back(tree_idx);
+    }
+  }
+
+  cache->leaves.resize(dataset.nrow() * cache->num_trees);
+  cache->accumulators.assign(dataset.nrow() * accumulator_size, 0.);
+  {
+    utils::concurrency::ThreadPool pool("leaf_cache", options.num_threads);
+    pool.StartWorkers();
+    utils::concurrency::ConcurrentForLoop(
+        options.num_threads, &pool, dataset.nrow(),
+        [&](const size_t block_idx, const size_t begin_example_idx,
+            const size_t end_example_idx) {
+          for (size_t example_idx = begin_example_idx;
+               example_idx < end_example_idx; example_idx++) {
+            auto* example_leaves =
+                &cache->leaves[example_idx * cache->num_trees];
+            const absl::Span<double> accumulator(
+                &cache->accumulators[example_idx * accumulator_size],
+                accumulator_size);
+            for (int tree_idx = 0; tree_idx < cache->num_trees; tree_idx++) {
+              example_leaves[tree_idx] =
+                  &trees[tree_idx]->GetLeaf(dataset, example_idx);
+              forest->AddLeafToAccumulator(tree_idx, *example_leaves[tree_idx],
+                                           1., accumulator);
+            }
+          }
+        });
+  }
+  return cache;
+}
+
+// Evaluates the model from the cached accumulators. If "permuted_feature_idx"
+// is set, the value of this feature for the example "example_idx" is read from
+// the example "permuted_rows[example_idx]", and only the trees testing this
+// feature are re-evaluated: The output of the cached leaf is replaced by the
+// output of the new leaf in the accumulator.
+absl::StatusOr<metric::proto::EvaluationResults> EvaluateFromLeafCache(
+    const dataset::VerticalDataset& dataset, const model::AbstractModel& model,
+    const ForestLeafCache& cache,
+    const metric::proto::EvaluationOptions& eval_options,
+    const absl::optional<int> permuted_feature_idx,
+    const std::vector<dataset::VerticalDataset::row_t>& permuted_rows,
+    utils::RandomEngine* rnd) {
+  const auto& trees = cache.forest->decision_trees();
+  metric::proto::EvaluationResults evaluation;
+  RETURN_IF_ERROR(metric::InitializeEvaluation(
+      eval_options, model.LabelColumnSpec(), &evaluation));
+  std::vector<double> accumulator(cache.accumulator_size);
+  model::proto::Prediction prediction;
+  for (dataset::VerticalDataset::row_t example_idx = 0;
+       example_idx < dataset.nrow(); example_idx++) {
+    const auto cached_accumulator =
+        cache.accumulators.begin() + example_idx * cache.accumulator_size;
+    std::copy(cached_accumulator, cached_accumulator + cache.accumulator_size,
+              accumulator.begin());
+    if (permuted_feature_idx.has_value()) {
+      const auto* cached_leaves = &cache.leaves[example_idx * cache.num_trees];
+      for (const int tree_idx :
+           cache.trees_per_feature[permuted_feature_idx.value()]) {
+        const auto* leaf = &trees[tree_idx]->GetLeafWithSwappedAttribute(
+            dataset, example_idx, permuted_feature_idx.value(),
+            permuted_rows[example_idx]);
+        if (leaf == cached_leaves[tree_idx]) {
+          continue;
+        }
+        cache.forest->AddLeafToAccumulator(tree_idx, *cached_leaves[tree_idx],
+                                           -1., absl::MakeSpan(accumulator));
+        cache.forest->AddLeafToAccumulator(tree_idx, *leaf, 1.,
+                                           absl::MakeSpan(accumulator));
+      }
+    }
+    prediction.Clear();
+    RETURN_IF_ERROR(
+        cache.forest->PredictFromAccumulator(accumulator, &prediction));
+    RETURN_IF_ERROR(model.SetGroundTruth(dataset, example_idx, &prediction));
+    RETURN_IF_ERROR(
+        metric::AddPrediction(eval_options, prediction, rnd, &evaluation));
+  }
+  evaluation.set_num_folds(evaluation.num_folds() + 1);
+  RETURN_IF_ERROR(metric::FinalizeEvaluation(
+      eval_options, model.LabelColumnSpec(), &evaluation));
+  return evaluation;
+}
+
+// Computes the permutation feature importances from the cached leaves. Same
+// result as the non-incremental computation (up to the numerical precision of
+// the inference engines).
+absl::Status ComputeIncrementalPermutationFeatureImportance(
+    const dataset::VerticalDataset& dataset, const model::AbstractModel* model,
+    const ForestLeafCache& cache,
+    const metric::proto::EvaluationOptions& eval_options,
+    ResultFeatureImportance* output,
+    const ComputeFeatureImportanceOptions& options) {
+  utils::RandomEngine rng;
+  utils::concurrency::Mutex rng_mutex;
+
+  ASSIGN_OR_RETURN(const auto base_evaluation,
+                   EvaluateFromLeafCache(dataset, *model, cache, eval_options,
+                                         {}, {}, &rng));
+
+  const auto permutation_evaluation =
+      [&dataset, &eval_options, &rng, &rng_mutex, &cache,
+       model](const int feature_idx)
+      -> absl::StatusOr<absl::optional<metric::proto::EvaluationResults>> {
+    const auto it_input_feature =
+        std::find(model->input_features().begin(),
+                  model->input_features().end(), feature_idx);
+    if (it_input_feature == model->input_features().end()) {
+      return absl::optional<metric::proto::EvaluationResults>();
+    }
+    utils::RandomEngine sub_rng;
+    {
+      utils::concurrency::MutexLock lock(&rng_mutex);
+      sub_rng.seed(rng());
+    }
+    // Same permutation as "ShuffleDatasetColumns": The value of the example
+    // "i" is moved to the example "shuffled_indices[i]".
+    std::vector<dataset::VerticalDataset::row_t> shuffled_indices(
+        dataset.nrow());
+    std::iota(shuffled_indices.begin(), shuffled_indices.end(), 0);
+    std::shuffle(shuffled_indices.begin(), shuffled_indices.end(), sub_rng);
+    std::vector<dataset::VerticalDataset::row_t> permuted_rows(dataset.nrow());
+    for (dataset::VerticalDataset::row_t example_idx = 0;
+         example_idx < dataset.nrow(); example_idx++) {
+      permuted_rows[shuffled_indices[example_idx]] = example_idx;
+    }
+    ASSIGN_OR_RETURN(auto evaluation,
+                     EvaluateFromLeafCache(dataset, *model, cache, eval_options,
+                                           feature_idx, permuted_rows,
+                                           &sub_rng));
+    return absl::optional<metric::proto::EvaluationResults>(
+        std::move(evaluation));
+  };
+
+  return utils::ComputePermutationFeatureImportance(
+      base_evaluation, permutation_evaluation, model, output, options);
+}
+
 }  // namespace
 
 dataset::VerticalDataset ShuffleDatasetColumns(
@@ -232,6 +457,14 @@ absl::Status ComputePermutationFeatureImportance(
   eval_options.set_bootstrapping_samples(0);
   eval_options.set_task(model->task());
 
+  if (options.incremental) {
+    const auto leaf_cache = BuildForestLeafCache(dataset, *model, options);
+    if (leaf_cache) {
+      return ComputeIncrementalPermutationFeatureImportance(
+          dataset, model, *leaf_cache, eval_options, output, options);
+    }
+  }
+
   utils::RandomEngine rng;
   utils::concurrency::Mutex rng_mutex;
 
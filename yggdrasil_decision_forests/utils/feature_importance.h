@@ -16,6 +16,7 @@
 #ifndef YGGDRASIL_DECISION_FORESTS_TOOL_FEATURE_IMPORTANCE_H_
 #define YGGDRASIL_DECISION_FORESTS_TOOL_FEATURE_IMPORTANCE_H_
 
+#include <cstdint>
 #include <functional>
 #include <random>
 #include <vector>
@@ -42,6 +43,17 @@ struct ComputeFeatureImportanceOptions {
   // Number of repetitions of the estimation. More repetitions increase the
   // quality of the variable importance estimates. Should be >=1.
   int num_rounds = 1;
+
+  // If true and the model is a decision forest, the leaf reached by each
+  // example in each tree, and the sum of the outputs of these leaves, are
+  // computed once. The permutation of a feature then only re-evaluates the
+  // trees testing this feature, reading the permuted values in place (i.e.
+  // without copying the dataset), and replaces the outputs of their leaves in
+  // the sum. The cache contains one pointer per example and tree, and is only
+  // used if it fits in "incremental_max_memory_bytes". Models with oblique
+  // conditions always use the non-incremental computation.
+  bool incremental = true;
+  int64_t incremental_max_memory_bytes = int64_t{4} * 1024 * 1024 * 1024;
 };
 
 // Computes and adds to the model permutation feature importances.
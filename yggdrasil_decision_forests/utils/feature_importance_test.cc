@@ -0,0 +1,218 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/utils/feature_importance.h"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+#include "absl/types/span.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/abstract_model.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_forest_interface.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
+#include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/test_utils.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace utils {
+namespace {
+
+using test::EqualsProto;
+
+// Indexes the importances by importance name and attribute.
+absl::flat_hash_map<std::pair<std::string, int>, double> IndexImportances(
+    const ResultFeatureImportance& importances) {
+  absl::flat_hash_map<std::pair<std::string, int>, double> index;
+  for (const auto& importance : importances) {
+    for (const auto& variable : importance.second.variable_importances()) {
+      index[{importance.first, variable.attribute_idx()}] =
+          variable.importance();
+    }
+  }
+  return index;
+}
+
+// Pre-trained decision forests of the test_data directory, and a dataset to
+// evaluate them.
+constexpr std::pair<const char*, const char*> kForestModelsAndDatasets[] = {
+    {"adult_binary_class_gbdt", "adult_test.csv"},
+    {"iris_multi_class_rf", "iris.csv"},
+    {"iris_multi_class_gbdt", "iris.csv"},
+    {"abalone_regression_gbdt", "abalone.csv"},
+};
+
+// The incremental computation evaluates the same permutations as the
+// non-incremental one.
+TEST(DecisionForest, IncrementalSameAsNonIncremental) {
+  for (const auto& model_and_dataset : kForestModelsAndDatasets) {
+    SCOPED_TRACE(model_and_dataset.first);
+    std::unique_ptr<model::AbstractModel> model;
+    dataset::VerticalDataset dataset;
+    ASSERT_OK(LoadTestModelAndDataset(model_and_dataset.first,
+                                      model_and_dataset.second, &model,
+                                      &dataset,
+                                      /*max_num_examples=*/1000));
+
+    // With a single thread, the permutations are generated in the same order.
+    ComputeFeatureImportanceOptions options;
+    options.num_threads = 1;
+    options.num_rounds = 2;
+
+    options.incremental = false;
+    ResultFeatureImportance expected;
+    ASSERT_OK(ComputePermutationFeatureImportance(dataset, model.get(),
+                                                  &expected, options));
+
+    options.incremental = true;
+    ResultFeatureImportance importances;
+    ASSERT_OK(ComputePermutationFeatureImportance(dataset, model.get(),
+                                                  &importances, options));
+
+    const auto expected_index = IndexImportances(expected);
+    const auto index = IndexImportances(importances);
+    EXPECT_FALSE(index.empty());
+    ASSERT_EQ(index.size(), expected_index.size());
+    for (const auto& item : expected_index) {
+      const auto it = index.find(item.first);
+      ASSERT_TRUE(it != index.end());
+      // The small differences between the predictions of the fast engine
+      // (non-incremental) and the generic inference (incremental) change the
+      // order of the examples with equal scores, frequent on iris. The ranking
+      // metrics (AUC, PR-AUC, AP) are not compared.
+      if (absl::StrContains(item.first.first, "AUC_") ||
+          absl::StrContains(item.first.first, "_AP_")) {
+        continue;
+      }
+      EXPECT_NEAR(it->second, item.second, 1e-3)
+          << item.first.first << " " << item.first.second;
+    }
+
+    // The cache does not fit in the memory budget.
+    options.incremental_max_memory_bytes = 1;
+    ResultFeatureImportance non_incremental;
+    ASSERT_OK(ComputePermutationFeatureImportance(dataset, model.get(),
+                                                  &non_incremental, options));
+    EXPECT_EQ(IndexImportances(non_incremental).size(), expected_index.size());
+  }
+}
+
+TEST(DecisionForest, PredictFromLeavesSameAsPredict) {
+  for (const auto& model_and_dataset : kForestModelsAndDatasets) {
+    SCOPED_TRACE(model_and_dataset.first);
+    std::unique_ptr<model::AbstractModel> model;
+    dataset::VerticalDataset dataset;
+    ASSERT_OK(LoadTestModelAndDataset(model_and_dataset.first,
+                                      model_and_dataset.second, &model,
+                                      &dataset,
+                                      /*max_num_examples=*/200));
+    const auto* forest =
+        dynamic_cast<const model::DecisionForestInterface*>(model.get());
+    ASSERT_TRUE(forest != nullptr);
+
+    std::vector<const model::decision_tree::proto::Node*> leaves(
+        forest->num_trees());
+    model::proto::Prediction prediction;
+    model::proto::Prediction expected_prediction;
+    for (dataset::VerticalDataset::row_t row = 0; row < dataset.nrow(); row++) {
+      for (int tree_idx = 0; tree_idx < leaves.size(); tree_idx++) {
+        leaves[tree_idx] =
+            &forest->decision_trees()[tree_idx]->GetLeaf(dataset, row);
+      }
+      prediction.Clear();
+      ASSERT_OK(forest->PredictFromLeaves(leaves, &prediction));
+      model->Predict(dataset, row, &expected_prediction);
+      EXPECT_THAT(prediction, EqualsProto(expected_prediction));
+    }
+    leaves.pop_back();
+    EXPECT_FALSE(forest->PredictFromLeaves(leaves, &prediction).ok());
+  }
+}
+
+TEST(DecisionForest, PredictFromAccumulatorSameAsPredict) {
+  for (const auto& model_and_dataset : kForestModelsAndDatasets) {
+    SCOPED_TRACE(model_and_dataset.first);
+    std::unique_ptr<model::AbstractModel> model;
+    dataset::VerticalDataset dataset;
+    ASSERT_OK(LoadTestModelAndDataset(model_and_dataset.first,
+                                      model_and_dataset.second, &model,
+                                      &dataset,
+                                      /*max_num_examples=*/200));
+    const auto* forest =
+        dynamic_cast<const model::DecisionForestInterface*>(model.get());
+    ASSERT_TRUE(forest != nullptr);
+
+    std::vector<double> accumulator(forest->LeafAccumulatorSize());
+    ASSERT_FALSE(accumulator.empty());
+    model::proto::Prediction prediction;
+    model::proto::Prediction expected_prediction;
+    for (dataset::VerticalDataset::row_t row = 0; row < dataset.nrow(); row++) {
+      std::fill(accumulator.begin(), accumulator.end(), 0.);
+      for (int tree_idx = 0; tree_idx < forest->num_trees(); tree_idx++) {
+        const auto& leaf =
+            forest->decision_trees()[tree_idx]->GetLeaf(dataset, row);
+        forest->AddLeafToAccumulator(tree_idx, leaf, 1.,
+                                     absl::MakeSpan(accumulator));
+      }
+      // Replacing the leaf of the first tree by itself does not change the
+      // prediction.
+      const auto& first_leaf =
+          forest->decision_trees().front()->GetLeaf(dataset, row);
+      forest->AddLeafToAccumulator(0, first_leaf, -1.,
+                                   absl::MakeSpan(accumulator));
+      forest->AddLeafToAccumulator(0, first_leaf, 1.,
+                                   absl::MakeSpan(accumulator));
+
+      prediction.Clear();
+      ASSERT_OK(forest->PredictFromAccumulator(accumulator, &prediction));
+      model->Predict(dataset, row, &expected_prediction);
+      if (expected_prediction.has_classification()) {
+        EXPECT_EQ(prediction.classification().value(),
+                  expected_prediction.classification().value());
+        const auto& distribution = prediction.classification().distribution();
+        const auto& expected_distribution =
+            expected_prediction.classification().distribution();
+        ASSERT_EQ(distribution.counts_size(),
+                  expected_distribution.counts_size());
+        for (int class_idx = 0; class_idx < distribution.counts_size();
+             class_idx++) {
+          EXPECT_NEAR(distribution.counts(class_idx) / distribution.sum(),
+                      expected_distribution.counts(class_idx) /
+                          expected_distribution.sum(),
+                      1e-5);
+        }
+      } else {
+        EXPECT_NEAR(prediction.regression().value(),
+                    expected_prediction.regression().value(), 1e-5);
+      }
+    }
+    accumulator.push_back(0.);
+    EXPECT_FALSE(forest->PredictFromAccumulator(accumulator, &prediction).ok());
+  }
+}
+
+}  // namespace
+}  // namespace utils
+}  // namespace yggdrasil_decision_forests
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/utils/memory_mapped_file.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace utils {
+
+absl::StatusOr<std::unique_ptr<MemoryMappedFile>> MemoryMappedFile::Open(
+    const absl::string_view path, const bool allow_mmap) {
+  auto file = std::unique_ptr<MemoryMappedFile>(new MemoryMappedFile());
+#ifndef _WIN32
+  if (allow_mmap) {
+    const std::string path_str(path);
+    const int fd = ::open(path_str.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      struct stat file_stat;
+      if (::fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) &&
+          file_stat.st_size > 0) {
+        void* data = ::mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED,
+                            fd, 0);
+        if (data != MAP_FAILED) {
+          ::close(fd);
+          file->data_ = static_cast<const char*>(data);
+          file->size_ = file_stat.st_size;
+          file->is_mapped_ = true;
+          return file;
+        }
+      }
+      ::close(fd);
+    }
+  }
+#endif
+  // The file is not a local file, or it cannot be mapped.
+  ASSIGN_OR_RETURN(file->buffer_, file::GetContent(path));
+  file->data_ = file->buffer_.data();
+  file->size_ = file->buffer_.size();
+  return file;
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+#ifndef _WIN32
+  if (is_mapped_) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+#endif
+}
+
+}  // namespace utils
+}  // namespace yggdrasil_decision_forests
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Read-only view of the content of a file.
+//
+// On POSIX platforms, local files are memory mapped: Opening a file is cheap,
+// and the pages are loaded (or shared with the page cache) when accessed. On
+// other platforms, or if the file cannot be mapped (e.g. a remote file), the
+// content is read in memory.
+//
+// Usage example:
+//
+//   ASSIGN_OR_RETURN(auto file, MemoryMappedFile::Open("/path/to/file"));
+//   absl::string_view content = file->content();
+//
+#ifndef YGGDRASIL_DECISION_FORESTS_UTILS_MEMORY_MAPPED_FILE_H_
+#define YGGDRASIL_DECISION_FORESTS_UTILS_MEMORY_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace yggdrasil_decision_forests {
+namespace utils {
+
+class MemoryMappedFile {
+ public:
+  // Opens a file. If "allow_mmap" is false, the file is always read in memory.
+  static absl::StatusOr<std::unique_ptr<MemoryMappedFile>> Open(
+      absl::string_view path, bool allow_mmap = true);
+
+  ~MemoryMappedFile();
+
+  MemoryMappedFile(const MemoryMappedFile&) = delete;
+  MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+  // Content of the file. Valid until the object is destroyed.
+  absl::string_view content() const { return {data_, size_}; }
+
+  // True if the file is memory mapped. False if the file is read in memory.
+  bool is_mapped() const { return is_mapped_; }
+
+ private:
+  MemoryMappedFile() = default;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  bool is_mapped_ = false;
+  // Content of the file, if not mapped.
+  std::string buffer_;
+};
+
+}  // namespace utils
+}  // namespace yggdrasil_decision_forests
+
+#endif  // YGGDRASIL_DECISION_FORESTS_UTILS_MEMORY_MAPPED_FILE_H_
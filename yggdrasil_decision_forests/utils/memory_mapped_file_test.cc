@@ -0,0 +1,61 @@
+/*
+ * Copyright 2022 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yggdrasil_decision_forests/utils/memory_mapped_file.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "yggdrasil_decision_forests/utils/filesystem.h"
+#include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
+
+namespace yggdrasil_decision_forests {
+namespace utils {
+namespace {
+
+TEST(MemoryMappedFile, Base) {
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "memory_mapped_file");
+  const std::string content =
+      std::string("Hello\0world", 11) + std::string(10000, 'a');
+  ASSERT_OK(file::SetContent(path, content));
+  for (const bool allow_mmap : {false, true}) {
+    ASSERT_OK_AND_ASSIGN(auto file, MemoryMappedFile::Open(path, allow_mmap));
+    EXPECT_EQ(file->content(), content);
+    if (!allow_mmap) {
+      EXPECT_FALSE(file->is_mapped());
+    }
+  }
+}
+
+TEST(MemoryMappedFile, EmptyFile) {
+  const std::string path =
+      file::JoinPath(test::TmpDirectory(), "empty_memory_mapped_file");
+  ASSERT_OK(file::SetContent(path, ""));
+  ASSERT_OK_AND_ASSIGN(auto file, MemoryMappedFile::Open(path));
+  EXPECT_TRUE(file->content().empty());
+}
+
+TEST(MemoryMappedFile, MissingFile) {
+  EXPECT_FALSE(MemoryMappedFile::Open(file::JoinPath(test::TmpDirectory(),
+                                                     "non_existing_file"))
+                   .ok());
+}
+
+}  // namespace
+}  // namespace utils
+}  // namespace yggdrasil_decision_forests
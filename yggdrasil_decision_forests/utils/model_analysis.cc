@@ -27,7 +27,6 @@
 #include "yggdrasil_decision_forests/dataset/data_spec.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
-#include "yggdrasil_decision_forests/model/model_engine_wrapper.h"
 #include "yggdrasil_decision_forests/utils/distribution.h"
 #include "yggdrasil_decision_forests/utils/feature_importance.h"
 #include "yggdrasil_decision_forests/utils/filesystem.h"
@@ -681,49 +680,36 @@ absl::StatusOr<proto::AnalysisResult> Analyse(
     return absl::InvalidArgumentError("The dataset is empty.");
   }
 
-  // Try to create a fast engine.
-  const model::AbstractModel* effective_model = &model;
-  auto engine_or = model.BuildFastEngine();
-  std::unique_ptr<model::EngineWrapperModel> engine_wrapper;
-  if (engine_or.ok()) {
-    YDF_LOG(INFO) << "Run the model with the fast engine wrapper";
-    engine_wrapper = std::make_unique<model::EngineWrapperModel>(
-        &model, std::move(engine_or.value()));
-    effective_model = engine_wrapper.get();
-  } else {
-    YDF_LOG(INFO)
-        << "Run the model with the slow engine. No fast engine could be found: "
-        << engine_or.status().message();
-  }
-
   // Partial Dependence Plots
   if (options.pdp().enabled()) {
     ASSIGN_OR_RETURN(const auto attribute_idxs,
                      GenerateAttributesCombinations(
-                         *effective_model, /*flag_1d=*/true,
+                         model, /*flag_1d=*/true,
                          /*flag_2d=*/false,
                          /*flag_2d_categorical_numerical=*/false));
 
     ASSIGN_OR_RETURN(*analysis.mutable_pdp_set(),
                      utils::ComputePartialDependencePlotSet(
-                         dataset, *effective_model, attribute_idxs,
+                         dataset, model, attribute_idxs,
                          options.pdp().num_numerical_bins(),
-                         options.pdp().example_sampling()));
+                         options.pdp().example_sampling(),
+                         options.num_threads()));
   }
 
   // Conditional Expectation Plot
   if (options.cep().enabled()) {
     ASSIGN_OR_RETURN(const auto attribute_idxs,
                      GenerateAttributesCombinations(
-                         *effective_model, /*flag_1d=*/true,
+                         model, /*flag_1d=*/true,
                          /*flag_2d=*/false,
                          /*flag_2d_categorical_numerical=*/false));
 
     ASSIGN_OR_RETURN(*analysis.mutable_cep_set(),
                      utils::ComputeConditionalExpectationPlotSet(
-                         dataset, *effective_model, attribute_idxs,
+                         dataset, model, attribute_idxs,
                          options.cep().num_numerical_bins(),
-                         options.cep().example_sampling()));
+                         options.cep().example_sampling(),
+                         options.num_threads()));
   }
 
   if (options.permuted_variable_importance().enabled()) {
@@ -24,6 +24,7 @@
 #include <optional>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -32,6 +33,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/example.pb.h"
@@ -41,7 +43,16 @@
 #include "yggdrasil_decision_forests/dataset/weight.h"
 #include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_forest_interface.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
+#include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.pb.h"
 #include "yggdrasil_decision_forests/model/prediction.pb.h"
+#include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+#include "yggdrasil_decision_forests/serving/decision_forest/register_engines.h"
+#include "yggdrasil_decision_forests/serving/example_set.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+#include "yggdrasil_decision_forests/utils/concurrency.h"
 #include "yggdrasil_decision_forests/utils/distribution.h"
 #include "yggdrasil_decision_forests/utils/distribution.pb.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
@@ -53,7 +64,11 @@ namespace utils {
 using dataset::proto::ColumnType;
 using dataset::proto::DataSpecification;
 using dataset::proto::Example;
+using model::decision_tree::DecisionTree;
+using model::decision_tree::NodeWithChildren;
+using model::gradient_boosted_trees::GradientBoostedTreesModel;
 using model::proto::Prediction;
+using model::random_forest::RandomForestModel;
 using proto::PartialDependencePlotSet;
 
 namespace {
@@ -341,6 +356,630 @@ void ModifyExample(
   }
 }
 
+// Number of examples processed together by the fast engine.
+constexpr int kEngineBatchSize = 64;
+
+// Minimum ratio of trees not using the attributes of a plot for the forest to
+// be split. Below, the saved tree evaluations do not justify copying the
+// trees and compiling two engines.
+constexpr float kMinStaticTreeRatio = 0.25f;
+
+// Adds the labels accumulated in "src" to "dst".
+absl::Status AddLabelAccumulator(
+    const PartialDependencePlotSet::PartialDependencePlot::LabelAccumulator&
+        src,
+    PartialDependencePlotSet::PartialDependencePlot::LabelAccumulator* dst) {
+  // The regression and ranking accumulators are only set once a value is
+  // accumulated.
+  if (src.prediction_value_case() ==
+      PartialDependencePlotSet::PartialDependencePlot::LabelAccumulator::
+          PREDICTION_VALUE_NOT_SET) {
+    return absl::OkStatus();
+  }
+  if (dst->prediction_value_case() ==
+      PartialDependencePlotSet::PartialDependencePlot::LabelAccumulator::
+          PREDICTION_VALUE_NOT_SET) {
+    *dst = src;
+    return absl::OkStatus();
+  }
+  STATUS_CHECK_EQ(src.prediction_value_case(), dst->prediction_value_case());
+  switch (src.prediction_value_case()) {
+    case PartialDependencePlotSet::PartialDependencePlot::LabelAccumulator::
+        kClassificationClassDistribution: {
+      const auto& src_dist = src.classification_class_distribution();
+      auto* dst_dist = dst->mutable_classification_class_distribution();
+      STATUS_CHECK_EQ(src_dist.counts_size(), dst_dist->counts_size());
+      for (int i = 0; i < src_dist.counts_size(); i++) {
+        dst_dist->set_counts(i, dst_dist->counts(i) + src_dist.counts(i));
+      }
+      dst_dist->set_sum(dst_dist->sum() + src_dist.sum());
+    } break;
+    case PartialDependencePlotSet::PartialDependencePlot::LabelAccumulator::
+        kSumOfRegressionPredictions:
+      dst->set_sum_of_regression_predictions(
+          dst->sum_of_regression_predictions() +
+          src.sum_of_regression_predictions());
+      break;
+    case PartialDependencePlotSet::PartialDependencePlot::LabelAccumulator::
+        kSumOfRankingPredictions:
+      dst->set_sum_of_ranking_predictions(dst->sum_of_ranking_predictions() +
+                                          src.sum_of_ranking_predictions());
+      break;
+    case PartialDependencePlotSet::PartialDependencePlot::LabelAccumulator::
+        PREDICTION_VALUE_NOT_SET:
+      break;
+  }
+  return absl::OkStatus();
+}
+
+// Adds the observations accumulated in "src" to "dst". "src" and "dst" should
+// have been initialized identically.
+absl::Status AddPartialDependencePlot(
+    const PartialDependencePlotSet::PartialDependencePlot& src,
+    PartialDependencePlotSet::PartialDependencePlot* dst) {
+  STATUS_CHECK_EQ(src.pdp_bins_size(), dst->pdp_bins_size());
+  STATUS_CHECK_EQ(src.attribute_info_size(), dst->attribute_info_size());
+  dst->set_num_observations(dst->num_observations() + src.num_observations());
+
+  for (int info_idx = 0; info_idx < src.attribute_info_size(); info_idx++) {
+    const auto& src_counts =
+        src.attribute_info(info_idx).num_observations_per_bins();
+    auto& dst_counts = *dst->mutable_attribute_info(info_idx)
+                            ->mutable_num_observations_per_bins();
+    STATUS_CHECK_EQ(src_counts.size(), dst_counts.size());
+    for (int i = 0; i < src_counts.size(); i++) {
+      dst_counts.Set(i, dst_counts.Get(i) + src_counts.Get(i));
+    }
+  }
+
+  for (int bin_idx = 0; bin_idx < src.pdp_bins_size(); bin_idx++) {
+    const auto& src_bin = src.pdp_bins(bin_idx);
+    auto* dst_bin = dst->mutable_pdp_bins(bin_idx);
+    RETURN_IF_ERROR(AddLabelAccumulator(src_bin.prediction(),
+                                        dst_bin->mutable_prediction()));
+    if (src_bin.has_ground_truth()) {
+      RETURN_IF_ERROR(AddLabelAccumulator(src_bin.ground_truth(),
+                                          dst_bin->mutable_ground_truth()));
+    }
+    if (src_bin.evaluation().has_num_correct_predictions()) {
+      dst_bin->mutable_evaluation()->set_num_correct_predictions(
+          dst_bin->evaluation().num_correct_predictions() +
+          src_bin.evaluation().num_correct_predictions());
+    }
+    if (src_bin.evaluation().has_sum_squared_error()) {
+      dst_bin->mutable_evaluation()->set_sum_squared_error(
+          dst_bin->evaluation().sum_squared_error() +
+          src_bin.evaluation().sum_squared_error());
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Tells, for each column of the dataspec, if the column can impact the
+// predictions of the model. Only the columns tested by at least one condition
+// of a decision forest can. For other model types, all the columns are assumed
+// to impact the predictions.
+std::vector<bool> AttributesImpactingPredictions(
+    const model::AbstractModel& model) {
+  const auto* forest =
+      dynamic_cast<const model::DecisionForestInterface*>(&model);
+  if (forest == nullptr) {
+    return std::vector<bool>(model.data_spec().columns_size(), true);
+  }
+  std::unordered_map<int32_t, int64_t> feature_usage;
+  forest->CountFeatureUsage(&feature_usage);
+  std::vector<bool> impacting(model.data_spec().columns_size(), false);
+  for (const auto& usage : feature_usage) {
+    impacting[usage.first] = true;
+  }
+  return impacting;
+}
+
+// Copies the node "src" and its children into "dst".
+void CopyNodes(const NodeWithChildren& src, NodeWithChildren* dst) {
+  *dst->mutable_node() = src.node();
+  if (!src.IsLeaf()) {
+    dst->CreateChildren();
+    CopyNodes(*src.neg_child(), dst->mutable_neg_child());
+    CopyNodes(*src.pos_child(), dst->mutable_pos_child());
+  }
+}
+
+std::unique_ptr<DecisionTree> CopyTree(const DecisionTree& src) {
+  auto dst = std::make_unique<DecisionTree>();
+  dst->CreateRoot();
+  CopyNodes(src.root(), dst->mutable_root());
+  return dst;
+}
+
+// Tests if at least one condition of the tree tests one of the attributes.
+bool TreeUsesAttributes(const DecisionTree& tree,
+                        const std::vector<int>& attribute_idxs) {
+  std::unordered_map<int32_t, int64_t> feature_usage;
+  tree.CountFeatureUsage(&feature_usage);
+  for (const int attribute_idx : attribute_idxs) {
+    if (feature_usage.find(attribute_idx) != feature_usage.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The trees of a decision forest split in two engines according to the
+// attributes of a partial dependence plot. The predictions of the "static"
+// trees (not using the attributes) do not depend on the bin and are computed
+// once per example. Only the "dynamic" trees are evaluated for each bin.
+struct SplitForestEngines {
+  std::unique_ptr<serving::FastEngine> static_engine;
+  std::unique_ptr<serving::FastEngine> dynamic_engine;
+  int num_static_trees = 0;
+  int num_dynamic_trees = 0;
+
+  // Set for Gradient Boosted Trees. The engines return the logits, and the
+  // static engine contains the initial predictions. For Random Forests, the
+  // engines return the average of their trees.
+  const GradientBoostedTreesModel* gbt = nullptr;
+};
+
+// Creates the engine of a sub-model of a "SplitForestEngines".
+absl::StatusOr<std::unique_ptr<serving::FastEngine>> BuildSubModelEngine(
+    const model::AbstractModel& sub_model, const bool output_logits) {
+  if (!output_logits) {
+    return sub_model.BuildFastEngine();
+  }
+  // Not all the engines support "output_logits" (e.g. the 8-bit engine).
+  const auto factories = sub_model.ListCompatibleFastEngines();
+  for (const absl::string_view engine_name :
+       {serving::gradient_boosted_trees::kQuickScorerExtended,
+        serving::gradient_boosted_trees::kGeneric}) {
+    for (const auto& factory : factories) {
+      if (factory->name() == engine_name &&
+          factory->IsCompatible(&sub_model)) {
+        return factory->CreateEngine(&sub_model);
+      }
+    }
+  }
+  return absl::InvalidArgumentError("No engine returning logits");
+}
+
+// Splits a Gradient Boosted Trees or a Random Forest model according to the
+// attributes of a partial dependence plot. Returns nullptr if the model cannot
+// be split e.g. the model is not a supported decision forest, or if too few
+// (or none) of the trees do not use the attributes.
+std::unique_ptr<SplitForestEngines> BuildSplitForestEngines(
+    const model::AbstractModel& model, const std::vector<int>& attribute_idxs) {
+  const auto* gbt = dynamic_cast<const GradientBoostedTreesModel*>(&model);
+  const auto* rf = dynamic_cast<const RandomForestModel*>(&model);
+  if (gbt == nullptr && rf == nullptr) {
+    return nullptr;
+  }
+  const auto& trees = gbt ? gbt->decision_trees() : rf->decision_trees();
+  // The trees of a Gradient Boosted Trees iteration (one per class for
+  // multi-class classification) are kept together.
+  const int num_trees_per_group = gbt ? gbt->num_trees_per_iter() : 1;
+  if (num_trees_per_group <= 0 || trees.size() % num_trees_per_group != 0) {
+    return nullptr;
+  }
+
+  // Counts the trees not using the attributes before copying any tree.
+  std::vector<bool> group_uses_attributes(trees.size() / num_trees_per_group);
+  size_t num_static_trees = 0;
+  for (size_t group_idx = 0; group_idx < group_uses_attributes.size();
+       group_idx++) {
+    bool uses_attributes = false;
+    for (int i = 0; i < num_trees_per_group; i++) {
+      uses_attributes |= TreeUsesAttributes(
+          *trees[group_idx * num_trees_per_group + i], attribute_idxs);
+    }
+    group_uses_attributes[group_idx] = uses_attributes;
+    if (!uses_attributes) {
+      num_static_trees += num_trees_per_group;
+    }
+  }
+  if (num_static_trees == trees.size() ||
+      num_static_trees < kMinStaticTreeRatio * trees.size()) {
+    return nullptr;
+  }
+
+  std::unique_ptr<model::AbstractModel> sub_models[2];
+  std::vector<std::unique_ptr<DecisionTree>>* sub_model_trees[2];
+  for (int sub_model_idx = 0; sub_model_idx < 2; sub_model_idx++) {
+    if (gbt) {
+      auto sub_model = std::make_unique<GradientBoostedTreesModel>();
+      gbt->CopyAbstractModelMetaData(sub_model.get());
+      sub_model->set_loss(gbt->loss());
+      sub_model->set_num_trees_per_iter(gbt->num_trees_per_iter());
+      sub_model->set_output_logits(true);
+      // The initial predictions are only added once, by the static trees.
+      sub_model->set_initial_predictions(
+          sub_model_idx == 0
+              ? gbt->initial_predictions()
+              : std::vector<float>(gbt->initial_predictions().size(), 0.f));
+      sub_model_trees[sub_model_idx] = sub_model->mutable_decision_trees();
+      sub_models[sub_model_idx] = std::move(sub_model);
+    } else {
+      auto sub_model = std::make_unique<RandomForestModel>();
+      rf->CopyAbstractModelMetaData(sub_model.get());
+      sub_model->set_winner_take_all_inference(
+          rf->winner_take_all_inference());
+      sub_model_trees[sub_model_idx] = sub_model->mutable_decision_trees();
+      sub_models[sub_model_idx] = std::move(sub_model);
+    }
+  }
+
+  for (size_t group_idx = 0; group_idx < group_uses_attributes.size();
+       group_idx++) {
+    for (int i = 0; i < num_trees_per_group; i++) {
+      sub_model_trees[group_uses_attributes[group_idx] ? 1 : 0]->push_back(
+          CopyTree(*trees[group_idx * num_trees_per_group + i]));
+    }
+  }
+
+  auto split = std::make_unique<SplitForestEngines>();
+  split->num_static_trees = sub_model_trees[0]->size();
+  split->num_dynamic_trees = sub_model_trees[1]->size();
+  split->gbt = gbt;
+  auto static_engine = BuildSubModelEngine(*sub_models[0], gbt != nullptr);
+  auto dynamic_engine = BuildSubModelEngine(*sub_models[1], gbt != nullptr);
+  if (!static_engine.ok() || !dynamic_engine.ok()) {
+    return nullptr;
+  }
+  split->static_engine = std::move(static_engine).value();
+  split->dynamic_engine = std::move(dynamic_engine).value();
+  return split;
+}
+
+// Computes the prediction of the model on the "example_idx"-th example from
+// the predictions of the static and dynamic engines of a split forest.
+void CombineSplitForestPredictions(const model::AbstractModel& model,
+                                   const SplitForestEngines& split,
+                                   const std::vector<float>& static_predictions,
+                                   const std::vector<float>& dynamic_predictions,
+                                   const int example_idx,
+                                   std::vector<float>* buffer,
+                                   Prediction* prediction) {
+  const int num_dims = split.dynamic_engine->NumPredictionDimension();
+  const float* static_values = &static_predictions[example_idx * num_dims];
+  const float* dynamic_values = &dynamic_predictions[example_idx * num_dims];
+  buffer->resize(num_dims);
+  if (split.gbt) {
+    for (int dim_idx = 0; dim_idx < num_dims; dim_idx++) {
+      (*buffer)[dim_idx] = static_values[dim_idx] + dynamic_values[dim_idx];
+    }
+    if (split.gbt->loss() ==
+        model::gradient_boosted_trees::proto::MULTINOMIAL_LOG_LIKELIHOOD) {
+      split.gbt->FinalizeMultinomialPrediction(*buffer, prediction);
+    } else {
+      split.gbt->FinalizeSingleOutputPrediction((*buffer)[0], prediction);
+    }
+  } else {
+    const float num_trees = split.num_static_trees + split.num_dynamic_trees;
+    for (int dim_idx = 0; dim_idx < num_dims; dim_idx++) {
+      (*buffer)[dim_idx] =
+          (static_values[dim_idx] * split.num_static_trees +
+           dynamic_values[dim_idx] * split.num_dynamic_trees) /
+          num_trees;
+    }
+    model::FloatToProtoPrediction(*buffer, 0, model.task(), num_dims,
+                                  prediction);
+  }
+}
+
+// Data shared by the workers computing plots with a fast engine.
+struct EngineContext {
+  const model::AbstractModel* model;
+  const serving::FastEngine* engine;
+  const dataset::VerticalDataset* dataset;
+  absl::optional<dataset::proto::LinkedWeightDefinition> weights;
+  std::vector<bool> attributes_impacting_predictions;
+};
+
+// Gets the weights of the examples [begin, end).
+absl::Status GetWeights(const EngineContext& context,
+                        const dataset::VerticalDataset::row_t begin,
+                        const dataset::VerticalDataset::row_t end,
+                        std::vector<float>* weights) {
+  weights->assign(end - begin, 1.f);
+  if (context.weights.has_value()) {
+    for (auto row = begin; row < end; row++) {
+      ASSIGN_OR_RETURN((*weights)[row - begin],
+                       dataset::GetWeightWithStatus(*context.dataset, row,
+                                                    context.weights.value()));
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Copies the values of the "attribute_idxs" columns of an example of the
+// dataset to "example". The other attributes of "example" are not modified.
+void ExtractAttributes(const dataset::VerticalDataset& dataset,
+                       const dataset::VerticalDataset::row_t row,
+                       const std::vector<int>& attribute_idxs,
+                       Example* example) {
+  for (const int attribute_idx : attribute_idxs) {
+    auto* attribute = example->mutable_attributes(attribute_idx);
+    // Missing values are not written by "ExtractExample".
+    attribute->Clear();
+    dataset.column(attribute_idx)->ExtractExample(row, attribute);
+  }
+}
+
+// Sets the attributes of a batch of examples to the center of a PDP bin.
+absl::Status SetBinCenter(
+    const PartialDependencePlotSet::PartialDependencePlot& pdp,
+    const PartialDependencePlotSet::PartialDependencePlot::Bin& bin,
+    const DataSpecification& data_spec,
+    const serving::FeaturesDefinition& features, const int num_examples,
+    serving::AbstractExampleSet* examples) {
+  for (int i = 0; i < pdp.attribute_info_size(); ++i) {
+    const int attribute_idx = pdp.attribute_info(i).attribute_idx();
+    const auto& value = bin.center_input_feature_values(i);
+    switch (data_spec.columns(attribute_idx).type()) {
+      case ColumnType::NUMERICAL: {
+        ASSIGN_OR_RETURN(const auto feature_id,
+                         features.GetNumericalFeatureId(attribute_idx));
+        for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+          examples->SetNumerical(example_idx, feature_id, value.numerical(),
+                                 features);
+        }
+      } break;
+      case ColumnType::CATEGORICAL: {
+        ASSIGN_OR_RETURN(const auto feature_id,
+                         features.GetCategoricalFeatureId(attribute_idx));
+        for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+          examples->SetCategorical(example_idx, feature_id,
+                                   value.categorical(), features);
+        }
+      } break;
+      case ColumnType::BOOLEAN: {
+        ASSIGN_OR_RETURN(const auto feature_id,
+                         features.GetBooleanFeatureId(attribute_idx));
+        for (int example_idx = 0; example_idx < num_examples; example_idx++) {
+          examples->SetBoolean(example_idx, feature_id, value.boolean(),
+                               features);
+        }
+      } break;
+      default:
+        return absl::InvalidArgumentError("Not supported attribute type");
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Accumulates the examples [begin, end) of the dataset in a partial dependence
+// plot using a fast engine. If "split" is set, only the dynamic trees are
+// evaluated for each bin.
+absl::Status UpdatePartialDependencePlotWithEngine(
+    const EngineContext& context, const SplitForestEngines* split,
+    const dataset::VerticalDataset::row_t begin,
+    const dataset::VerticalDataset::row_t end,
+    PartialDependencePlotSet::PartialDependencePlot* pdp) {
+  const auto& model = *context.model;
+  // Engine evaluated for each bin.
+  const auto& engine = split ? *split->dynamic_engine : *context.engine;
+  const auto& data_spec = model.data_spec();
+  const int num_prediction_dimensions = engine.NumPredictionDimension();
+
+  std::vector<int> attribute_idxs;
+  bool impacting_predictions = false;
+  for (const auto& attribute_info : pdp->attribute_info()) {
+    attribute_idxs.push_back(attribute_info.attribute_idx());
+    impacting_predictions |=
+        context.attributes_impacting_predictions[attribute_idxs.back()];
+  }
+
+  auto examples = engine.AllocateExamples(kEngineBatchSize);
+  std::unique_ptr<serving::AbstractExampleSet> static_examples;
+  if (split) {
+    static_examples = split->static_engine->AllocateExamples(kEngineBatchSize);
+  }
+  std::vector<float> predictions;
+  std::vector<float> static_predictions;
+  std::vector<float> combined_predictions;
+  std::vector<float> weights;
+  Prediction prediction;
+  Example example;
+  example.mutable_attributes()->Reserve(data_spec.columns_size());
+  for (int col_idx = 0; col_idx < data_spec.columns_size(); col_idx++) {
+    example.add_attributes();
+  }
+
+  for (auto batch_begin = begin; batch_begin < end;
+       batch_begin += kEngineBatchSize) {
+    const auto batch_end =
+        std::min<dataset::VerticalDataset::row_t>(batch_begin +
+                                                      kEngineBatchSize,
+                                                  end);
+    const int batch_size = batch_end - batch_begin;
+    RETURN_IF_ERROR(GetWeights(context, batch_begin, batch_end, &weights));
+
+    if (split) {
+      // The static trees are evaluated once per example.
+      RETURN_IF_ERROR(serving::CopyVerticalDatasetToAbstractExampleSet(
+          *context.dataset, batch_begin, batch_end,
+          split->static_engine->features(), static_examples.get()));
+      split->static_engine->Predict(*static_examples, batch_size,
+                                    &static_predictions);
+    }
+
+    // Density.
+    for (int example_idx = 0; example_idx < batch_size; example_idx++) {
+      ExtractAttributes(*context.dataset, batch_begin + example_idx,
+                        attribute_idxs, &example);
+      RETURN_IF_ERROR(
+          UpdateDensity(data_spec, example, weights[example_idx], pdp));
+      pdp->set_num_observations(pdp->num_observations() +
+                                weights[example_idx]);
+    }
+
+    // PDP.
+    RETURN_IF_ERROR(serving::CopyVerticalDatasetToAbstractExampleSet(
+        *context.dataset, batch_begin, batch_end, engine.features(),
+        examples.get()));
+    if (!impacting_predictions) {
+      // The prediction does not depend on the value of the attributes.
+      engine.Predict(*examples, batch_size, &predictions);
+    }
+    for (int bin_idx = 0; bin_idx < pdp->pdp_bins_size(); ++bin_idx) {
+      auto* bin = pdp->mutable_pdp_bins(bin_idx);
+      if (impacting_predictions) {
+        RETURN_IF_ERROR(SetBinCenter(*pdp, *bin, data_spec, engine.features(),
+                                     batch_size, examples.get()));
+        engine.Predict(*examples, batch_size, &predictions);
+      }
+      for (int example_idx = 0; example_idx < batch_size; example_idx++) {
+        if (split) {
+          CombineSplitForestPredictions(model, *split, static_predictions,
+                                        predictions, example_idx,
+                                        &combined_predictions, &prediction);
+        } else {
+          model::FloatToProtoPrediction(predictions, example_idx, model.task(),
+                                        num_prediction_dimensions,
+                                        &prediction);
+        }
+        prediction.set_weight(weights[example_idx]);
+        RETURN_IF_ERROR(UpdateBin(model, prediction, false, bin));
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Accumulates the examples [begin, end) of the dataset in a set of conditional
+// expectation plots using a fast engine.
+absl::Status UpdateConditionalExpectationPlotSetWithEngine(
+    const EngineContext& context, const dataset::VerticalDataset::row_t begin,
+    const dataset::VerticalDataset::row_t end,
+    ConditionalExpectationPlotSet* cond_set) {
+  const auto& model = *context.model;
+  const auto& engine = *context.engine;
+  const auto& data_spec = model.data_spec();
+  const int num_prediction_dimensions = engine.NumPredictionDimension();
+
+  std::vector<int> attribute_idxs;
+  for (const auto& cond : cond_set->pdps()) {
+    for (const auto& attribute_info : cond.attribute_info()) {
+      attribute_idxs.push_back(attribute_info.attribute_idx());
+    }
+  }
+  std::sort(attribute_idxs.begin(), attribute_idxs.end());
+  attribute_idxs.erase(
+      std::unique(attribute_idxs.begin(), attribute_idxs.end()),
+      attribute_idxs.end());
+
+  auto examples = engine.AllocateExamples(kEngineBatchSize);
+  std::vector<float> predictions;
+  std::vector<float> weights;
+  Prediction prediction;
+  Example example;
+  example.mutable_attributes()->Reserve(data_spec.columns_size());
+  for (int col_idx = 0; col_idx < data_spec.columns_size(); col_idx++) {
+    example.add_attributes();
+  }
+
+  for (auto batch_begin = begin; batch_begin < end;
+       batch_begin += kEngineBatchSize) {
+    const auto batch_end =
+        std::min<dataset::VerticalDataset::row_t>(batch_begin +
+                                                      kEngineBatchSize,
+                                                  end);
+    const int batch_size = batch_end - batch_begin;
+    RETURN_IF_ERROR(GetWeights(context, batch_begin, batch_end, &weights));
+    RETURN_IF_ERROR(serving::CopyVerticalDatasetToAbstractExampleSet(
+        *context.dataset, batch_begin, batch_end, engine.features(),
+        examples.get()));
+    engine.Predict(*examples, batch_size, &predictions);
+
+    for (int example_idx = 0; example_idx < batch_size; example_idx++) {
+      const auto row = batch_begin + example_idx;
+      model::FloatToProtoPrediction(predictions, example_idx, model.task(),
+                                    num_prediction_dimensions, &prediction);
+      prediction.set_weight(weights[example_idx]);
+      RETURN_IF_ERROR(model.SetGroundTruth(*context.dataset, row, &prediction));
+      ExtractAttributes(*context.dataset, row, attribute_idxs, &example);
+
+      for (int cond_idx = 0; cond_idx < cond_set->pdps_size(); ++cond_idx) {
+        auto* cond = cond_set->mutable_pdps(cond_idx);
+        RETURN_IF_ERROR(
+            UpdateDensity(data_spec, example, prediction.weight(), cond));
+        ASSIGN_OR_RETURN(const int bin_idx, internal::ExampleToBinIndex(
+                                                example, data_spec, *cond));
+        RETURN_IF_ERROR(UpdateBin(model, prediction, true,
+                                  cond->mutable_pdp_bins(bin_idx)));
+        cond->set_num_observations(cond->num_observations() +
+                                   prediction.weight());
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Selects the examples used to compute the plots. Returns "dataset" if all
+// the examples are selected.
+absl::StatusOr<const dataset::VerticalDataset*> SampleExamples(
+    const dataset::VerticalDataset& dataset, const float example_sampling,
+    dataset::VerticalDataset* sampled_dataset) {
+  if (example_sampling >= 1.f) {
+    return &dataset;
+  }
+  std::default_random_engine random;
+  std::uniform_real_distribution<float> dist_unif_unit;
+  std::vector<dataset::VerticalDataset::row_t> selected_examples;
+  for (dataset::VerticalDataset::row_t example_idx = 0;
+       example_idx < dataset.nrow(); example_idx++) {
+    if (example_sampling >= dist_unif_unit(random)) {
+      selected_examples.push_back(example_idx);
+    }
+  }
+  ASSIGN_OR_RETURN(*sampled_dataset, dataset.Extract(selected_examples));
+  return sampled_dataset;
+}
+
+// Splits the examples of the dataset into "num_chunks" contiguous ranges.
+std::vector<std::pair<dataset::VerticalDataset::row_t,
+                      dataset::VerticalDataset::row_t>>
+SplitExamples(const dataset::VerticalDataset::row_t num_examples,
+              const int num_chunks) {
+  std::vector<std::pair<dataset::VerticalDataset::row_t,
+                        dataset::VerticalDataset::row_t>>
+      chunks;
+  for (int chunk_idx = 0; chunk_idx < num_chunks; chunk_idx++) {
+    chunks.push_back({num_examples * chunk_idx / num_chunks,
+                      num_examples * (chunk_idx + 1) / num_chunks});
+  }
+  return chunks;
+}
+
+// Runs "work(unit_idx)" for each unit in [0, num_units) in parallel.
+absl::Status RunInParallel(const int num_units, const int num_threads,
+                           const std::function<absl::Status(int)>& work) {
+  utils::concurrency::Mutex mutex;
+  absl::Status status;
+  int num_done_units = 0;
+  {
+    utils::concurrency::ThreadPool pool(
+        "plots", std::max(1, std::min(num_threads, num_units)));
+    pool.StartWorkers();
+    for (int unit_idx = 0; unit_idx < num_units; unit_idx++) {
+      pool.Schedule([&, unit_idx]() {
+        {
+          utils::concurrency::MutexLock lock(&mutex);
+          if (!status.ok()) {
+            return;
+          }
+        }
+        const auto unit_status = work(unit_idx);
+        utils::concurrency::MutexLock lock(&mutex);
+        status.Update(unit_status);
+        num_done_units++;
+        LOG_INFO_EVERY_N_SEC(30, _ << num_done_units << "/" << num_units
+                                   << " work units done.");
+      });
+    }
+  }
+  return status;
+}
+
 }  // namespace
 
 absl::StatusOr<PartialDependencePlotSet> InitializePartialDependencePlotSet(
@@ -482,7 +1121,8 @@ absl::Status AppendAttributesCombinations2D(
 absl::StatusOr<proto::PartialDependencePlotSet> ComputePartialDependencePlotSet(
     const dataset::VerticalDataset& dataset, const model::AbstractModel& model,
     const std::vector<std::vector<int>>& attribute_idxs,
-    const int num_numerical_bins, const float example_sampling) {
+    const int num_numerical_bins, const float example_sampling,
+    const int num_threads) {
   YDF_LOG(INFO) << "Initiate PDP accumulator";
   ASSIGN_OR_RETURN(auto pdp_set,
                    InitializePartialDependencePlotSet(
@@ -493,23 +1133,326 @@ absl::StatusOr<proto::PartialDependencePlotSet> ComputePartialDependencePlotSet(
                 << NumModelCallPerExample(pdp_set)
                 << " model call(s) per example.";
 
-  std::default_random_engine random;
-  std::uniform_real_distribution<float> dist_unif_unit;
+  dataset::VerticalDataset sampled_dataset;
+  ASSIGN_OR_RETURN(const auto* selected_dataset,
+                   SampleExamples(dataset, example_sampling, &sampled_dataset));
+
+  auto engine_or = model.BuildFastEngine();
+  if (!engine_or.ok()) {
+    YDF_LOG(INFO) << "Run the model with the slow generic engine: "
+                  << engine_or.status().message();
+    dataset::proto::Example example;
+    for (size_t example_idx = 0; example_idx < selected_dataset->nrow();
+         example_idx++) {
+      if ((example_idx % 100) == 0) {
+        LOG_INFO_EVERY_N_SEC(30, _ << example_idx + 1 << " examples scanned.");
+      }
+      selected_dataset->ExtractExample(example_idx, &example);
+      RETURN_IF_ERROR(
+          UpdatePartialDependencePlotSet(model, example, &pdp_set));
+    }
+    return pdp_set;
+  }
+
+  const auto engine = std::move(engine_or).value();
+  const int num_plots = pdp_set.pdps_size();
+  if (num_plots == 0) {
+    return pdp_set;
+  }
+
+  const EngineContext context{&model, engine.get(), selected_dataset,
+                              model.weights(),
+                              AttributesImpactingPredictions(model)};
+
+  // For each plot, the forest is split into the trees using the attributes of
+  // the plot and the other trees. Since each split copies the trees of the
+  // model, the plots are computed in batches of "num_threads" plots, and the
+  // split forests of a batch are released before the next batch.
+  const int max_batch_size = std::max(1, num_threads);
+  const int max_num_chunks = std::max<int64_t>(
+      1, (selected_dataset->nrow() + kEngineBatchSize - 1) / kEngineBatchSize);
+  for (int batch_begin = 0; batch_begin < num_plots;
+       batch_begin += max_batch_size) {
+    const int batch_size = std::min(max_batch_size, num_plots - batch_begin);
+
+    std::vector<std::unique_ptr<SplitForestEngines>> split_forests(batch_size);
+    RETURN_IF_ERROR(
+        RunInParallel(batch_size, num_threads, [&](const int batch_idx) {
+          std::vector<int> plot_attribute_idxs;
+          for (const auto& attribute_info :
+               pdp_set.pdps(batch_begin + batch_idx).attribute_info()) {
+            plot_attribute_idxs.push_back(attribute_info.attribute_idx());
+          }
+          split_forests[batch_idx] =
+              BuildSplitForestEngines(model, plot_attribute_idxs);
+          return absl::OkStatus();
+        }));
+
+    // Each plot is computed on "num_chunks" separate ranges of examples so
+    // that all the threads are busy even when there are only a few plots.
+    const int num_chunks = utils::clamp(
+        (4 * num_threads + batch_size - 1) / batch_size, 1, max_num_chunks);
+    const auto chunks = SplitExamples(selected_dataset->nrow(), num_chunks);
 
-  // TODO: Multi-thread.
-  dataset::proto::Example example;
-  for (size_t example_idx = 0; example_idx < dataset.nrow(); example_idx++) {
-    if (example_sampling < 1.f && example_sampling < dist_unif_unit(random)) {
+    // The first chunk of each plot is accumulated directly in "pdp_set". The
+    // other chunks are accumulated separately, and then added to "pdp_set".
+    std::vector<PartialDependencePlotSet::PartialDependencePlot> chunk_pdps(
+        batch_size * (num_chunks - 1));
+    for (int batch_idx = 0; batch_idx < batch_size; batch_idx++) {
+      for (int chunk_idx = 1; chunk_idx < num_chunks; chunk_idx++) {
+        chunk_pdps[batch_idx * (num_chunks - 1) + chunk_idx - 1] =
+            pdp_set.pdps(batch_begin + batch_idx);
+      }
+    }
+
+    RETURN_IF_ERROR(RunInParallel(
+        batch_size * num_chunks, num_threads, [&](const int unit_idx) {
+          const int batch_idx = unit_idx / num_chunks;
+          const int chunk_idx = unit_idx % num_chunks;
+          auto* pdp =
+              (chunk_idx == 0)
+                  ? pdp_set.mutable_pdps(batch_begin + batch_idx)
+                  : &chunk_pdps[batch_idx * (num_chunks - 1) + chunk_idx - 1];
+          return UpdatePartialDependencePlotWithEngine(
+              context, split_forests[batch_idx].get(), chunks[chunk_idx].first,
+              chunks[chunk_idx].second, pdp);
+        }));
+
+    for (int batch_idx = 0; batch_idx < batch_size; batch_idx++) {
+      for (int chunk_idx = 1; chunk_idx < num_chunks; chunk_idx++) {
+        RETURN_IF_ERROR(AddPartialDependencePlot(
+            chunk_pdps[batch_idx * (num_chunks - 1) + chunk_idx - 1],
+            pdp_set.mutable_pdps(batch_begin + batch_idx)));
+      }
+    }
+  }
+  return pdp_set;
+}
+
+absl::StatusOr<ConditionalExpectationPlotSet>
+InitializeConditionalExpectationPlotSet(
+    const dataset::proto::DataSpecification& data_spec,
+    const std::vector<std::vector<int>>& attribute_idxs,
+    const model::proto::Task& task, int label_col_idx, int num_numerical_bins,
+    const dataset::VerticalDataset& dataset) {
+  PartialDependencePlotSet pdp_set;
+  for (const auto& set_of_attribute_idxs : attribute_idxs) {
+    auto* pdp = pdp_set.add_pdps();
+    RETURN_IF_ERROR(InitializePartialDependence(
+        data_spec, set_of_attribute_idxs, task, label_col_idx,
+        num_numerical_bins, true, dataset, pdp));
+  }
+  return pdp_set;
+}
+
+absl::Status UpdatePartialDependencePlotSet(const model::AbstractModel& model,
+                                            const Example& example,
+                                            PartialDependencePlotSet* pdp_set) {
+  Prediction prediction;
+  if (model.weights().has_value()) {
+    prediction.set_weight(
+        dataset::GetWeightWithStatus(example, model.weights().value()).value());
+  }
+
+  for (int pdp_idx = 0; pdp_idx < pdp_set->pdps_size(); ++pdp_idx) {
+    auto* pdp = pdp_set->mutable_pdps(pdp_idx);
+    // Density.
+    RETURN_IF_ERROR(
+        UpdateDensity(model.data_spec(), example, prediction.weight(), pdp));
+
+    // PDP.
+    Example modified_example = example;
+    for (int bin_idx = 0; bin_idx < pdp->pdp_bins_size(); ++bin_idx) {
+      auto* bin = pdp->mutable_pdp_bins(bin_idx);
+      ModifyExample(bin, pdp, &modified_example);
+
+      model.Predict(modified_example, &prediction);
+      RETURN_IF_ERROR(UpdateBin(model, prediction, false, bin));
+    }
+    pdp->set_num_observations(pdp->num_observations() + prediction.weight());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status UpdateConditionalExpectationPlotSet(
+    const model::AbstractModel& model, const dataset::proto::Example& example,
+    ConditionalExpectationPlotSet* cond_set) {
+  // Apply the model.
+  Prediction prediction;
+  if (model.weights().has_value()) {
+    prediction.set_weight(
+        dataset::GetWeightWithStatus(example, model.weights().value()).value());
+  }
+
+  model.Predict(example, &prediction);
+  RETURN_IF_ERROR(model.SetGroundTruth(example, &prediction));
+
+  for (int cond_idx = 0; cond_idx < cond_set->pdps_size(); ++cond_idx) {
+    auto* cond = cond_set->mutable_pdps(cond_idx);
+    // Density.
+    RETURN_IF_ERROR(
+        UpdateDensity(model.data_spec(), example, prediction.weight(), cond));
+
+    // Conditional expectation.
+    ASSIGN_OR_RETURN(const int bin_idx, internal::ExampleToBinIndex(
+                                            example, model.data_spec(), *cond));
+    auto* bin = cond->mutable_pdp_bins(bin_idx);
+    RETURN_IF_ERROR(UpdateBin(model, prediction, true, bin));
+
+    cond->set_num_observations(cond->num_observations() + prediction.weight());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AppendAttributesCombinations(
+    const model::AbstractModel& model, const int num_dims,
+    std::vector<std::vector<int>>* attribute_idxs) {
+  const auto supported_input_features = SupportedInputFeatures(model);
+  if (num_dims == 1) {
+    for (const auto col_idx : supported_input_features) {
+      attribute_idxs->push_back({col_idx});
+    }
+  } else if (num_dims == 2) {
+    const int n = supported_input_features.size();
+    for (int idx_1 = 0; idx_1 < n; idx_1++) {
+      for (int idx_2 = idx_1 + 1; idx_2 < n; idx_2++) {
+        attribute_idxs->push_back(
+            {supported_input_features[idx_1], supported_input_features[idx_2]});
+      }
+    }
+  } else {
+    return absl::InvalidArgumentError("Non supported num_dims");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AppendAttributesCombinations2D(
+    const model::AbstractModel& model, const dataset::proto::ColumnType type_1,
+    const dataset::proto::ColumnType type_2,
+    std::vector<std::vector<int>>* attribute_idxs) {
+  const auto supported_input_features = SupportedInputFeatures(model);
+  for (const auto feature_1 : supported_input_features) {
+    if (model.data_spec().columns(feature_1).type() != type_1) {
       continue;
     }
-    if ((example_idx % 100) == 0) {
-      LOG_INFO_EVERY_N_SEC(30, _ << example_idx + 1 << " examples scanned.");
+    for (const auto feature_2 : supported_input_features) {
+      if (model.data_spec().columns(feature_2).type() != type_2) {
+        continue;
+      }
+      if (type_1 == type_2 && feature_1 >= feature_2) {
+        // If the two types are similar, we skip the attribute groups
+        // <attr2,attr1> (Since <attr1,attr2> is already present).
+        continue;
+      }
+      attribute_idxs->push_back({feature_1, feature_2});
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<proto::PartialDependencePlotSet> ComputePartialDependencePlotSet(
+    const dataset::VerticalDataset& dataset, const model::AbstractModel& model,
+    const std::vector<std::vector<int>>& attribute_idxs,
+    const int num_numerical_bins, const float example_sampling,
+    const int num_threads) {
+  YDF_LOG(INFO) << "Initiate PDP accumulator";
+  ASSIGN_OR_RETURN(auto pdp_set,
+                   InitializePartialDependencePlotSet(
+                       model.data_spec(), attribute_idxs, model.task(),
+                       model.label_col_idx(), num_numerical_bins, dataset));
+  YDF_LOG(INFO) << "Compute partial dependence plot for "
+                << attribute_idxs.size() << " set of features and "
+                << NumModelCallPerExample(pdp_set)
+                << " model call(s) per example.";
+
+  dataset::VerticalDataset sampled_dataset;
+  ASSIGN_OR_RETURN(const auto* selected_dataset,
+                   SampleExamples(dataset, example_sampling, &sampled_dataset));
+
+  auto engine_or = model.BuildFastEngine();
+  if (!engine_or.ok()) {
+    YDF_LOG(INFO) << "Run the model with the slow generic engine: "
+                  << engine_or.status().message();
+    dataset::proto::Example example;
+    for (size_t example_idx = 0; example_idx < selected_dataset->nrow();
+         example_idx++) {
+      if ((example_idx % 100) == 0) {
+        LOG_INFO_EVERY_N_SEC(30, _ << example_idx + 1 << " examples scanned.");
+      }
+      selected_dataset->ExtractExample(example_idx, &example);
+      RETURN_IF_ERROR(
+          UpdatePartialDependencePlotSet(model, example, &pdp_set));
     }
-    dataset.ExtractExample(example_idx, &example);
+    return pdp_set;
+  }
 
-    RETURN_IF_ERROR(UpdatePartialDependencePlotSet(model, example, &pdp_set));
+  const auto engine = std::move(engine_or).value();
+  const int num_plots = pdp_set.pdps_size();
+  if (num_plots == 0) {
+    return pdp_set;
   }
 
+  // For each plot, splits the forest into the trees using the attributes of
+  // the plot and the other trees.
+  std::vector<std::unique_ptr<SplitForestEngines>> split_forests(num_plots);
+  RETURN_IF_ERROR(
+      RunInParallel(num_plots, num_threads, [&](const int plot_idx) {
+        std::vector<int> plot_attribute_idxs;
+        for (const auto& attribute_info :
+             pdp_set.pdps(plot_idx).attribute_info()) {
+          plot_attribute_idxs.push_back(attribute_info.attribute_idx());
+        }
+        split_forests[plot_idx] =
+            BuildSplitForestEngines(model, plot_attribute_idxs);
+        return absl::OkStatus();
+      }));
+
+  const EngineContext context{&model,
+                              engine.get(),
+                              selected_dataset,
+                              model.weights(),
+                              AttributesImpactingPredictions(model),
+                              std::move(split_forests)};
+
+  // Each plot is computed on "num_chunks" separate ranges of examples so that
+  // all the threads are busy even when there are only a few plots.
+  const int max_num_chunks = std::max<int64_t>(
+      1, (selected_dataset->nrow() + kEngineBatchSize - 1) / kEngineBatchSize);
+  const int num_chunks = utils::clamp(
+      (4 * num_threads + num_plots - 1) / num_plots, 1, max_num_chunks);
+  const auto chunks = SplitExamples(selected_dataset->nrow(), num_chunks);
+
+  // The first chunk of each plot is accumulated directly in "pdp_set". The
+  // other chunks are accumulated separately, and then added to "pdp_set".
+  std::vector<PartialDependencePlotSet::PartialDependencePlot> chunk_pdps(
+      num_plots * (num_chunks - 1));
+  for (int plot_idx = 0; plot_idx < num_plots; plot_idx++) {
+    for (int chunk_idx = 1; chunk_idx < num_chunks; chunk_idx++) {
+      chunk_pdps[plot_idx * (num_chunks - 1) + chunk_idx - 1] =
+          pdp_set.pdps(plot_idx);
+    }
+  }
+
+  RETURN_IF_ERROR(RunInParallel(
+      num_plots * num_chunks, num_threads, [&](const int unit_idx) {
+        const int plot_idx = unit_idx / num_chunks;
+        const int chunk_idx = unit_idx % num_chunks;
+        auto* pdp =
+            (chunk_idx == 0)
+                ? pdp_set.mutable_pdps(plot_idx)
+                : &chunk_pdps[plot_idx * (num_chunks - 1) + chunk_idx - 1];
+        return UpdatePartialDependencePlotWithEngine(
+            context, context.split_forests[plot_idx].get(),
+            chunks[chunk_idx].first, chunks[chunk_idx].second, pdp);
+      }));
+
+  for (int plot_idx = 0; plot_idx < num_plots; plot_idx++) {
+    for (int chunk_idx = 1; chunk_idx < num_chunks; chunk_idx++) {
+      RETURN_IF_ERROR(AddPartialDependencePlot(
+          chunk_pdps[plot_idx * (num_chunks - 1) + chunk_idx - 1],
+          pdp_set.mutable_pdps(plot_idx)));
+    }
+  }
   return pdp_set;
 }
 
@@ -517,7 +1460,7 @@ absl::StatusOr<ConditionalExpectationPlotSet>
 ComputeConditionalExpectationPlotSet(
     const dataset::VerticalDataset& dataset, const model::AbstractModel& model,
     const std::vector<std::vector<int>>& attribute_idxs, int num_numerical_bins,
-    float example_sampling) {
+    float example_sampling, const int num_threads) {
   YDF_LOG(INFO) << "Initiate CEP accumulator";
   ASSIGN_OR_RETURN(auto pdp_set,
                    InitializeConditionalExpectationPlotSet(
@@ -528,23 +1471,56 @@ ComputeConditionalExpectationPlotSet(
                 << NumModelCallPerExample(pdp_set)
                 << " model call(s) per example.";
 
-  std::default_random_engine random;
-  std::uniform_real_distribution<float> dist_unif_01;
+  dataset::VerticalDataset sampled_dataset;
+  ASSIGN_OR_RETURN(const auto* selected_dataset,
+                   SampleExamples(dataset, example_sampling, &sampled_dataset));
 
-  // TODO: Multi-thread.
-  dataset::proto::Example example;
-  for (size_t example_idx = 0; example_idx < dataset.nrow(); example_idx++) {
-    if (example_sampling < 1.f && example_sampling < dist_unif_01(random)) {
-      continue;
-    }
-    if ((example_idx % 100) == 0) {
-      LOG_INFO_EVERY_N_SEC(30, _ << example_idx + 1 << " examples scanned.");
+  auto engine_or = model.BuildFastEngine();
+  if (!engine_or.ok()) {
+    YDF_LOG(INFO) << "Run the model with the slow generic engine: "
+                  << engine_or.status().message();
+    dataset::proto::Example example;
+    for (size_t example_idx = 0; example_idx < selected_dataset->nrow();
+         example_idx++) {
+      if ((example_idx % 100) == 0) {
+        LOG_INFO_EVERY_N_SEC(30, _ << example_idx + 1 << " examples scanned.");
+      }
+      selected_dataset->ExtractExample(example_idx, &example);
+      RETURN_IF_ERROR(
+          UpdateConditionalExpectationPlotSet(model, example, &pdp_set));
     }
-    dataset.ExtractExample(example_idx, &example);
-    RETURN_IF_ERROR(
-        UpdateConditionalExpectationPlotSet(model, example, &pdp_set));
+    return pdp_set;
   }
 
+  const auto engine = std::move(engine_or).value();
+  const EngineContext context{&model, engine.get(), selected_dataset,
+                              model.weights(),
+                              AttributesImpactingPredictions(model)};
+
+  // The model is applied once per example, for all the plots. The work is
+  // split by ranges of examples.
+  const int max_num_chunks = std::max<int64_t>(
+      1, (selected_dataset->nrow() + kEngineBatchSize - 1) / kEngineBatchSize);
+  const int num_chunks = utils::clamp(4 * num_threads, 1, max_num_chunks);
+  const auto chunks = SplitExamples(selected_dataset->nrow(), num_chunks);
+  std::vector<ConditionalExpectationPlotSet> chunk_sets(num_chunks - 1,
+                                                        pdp_set);
+
+  RETURN_IF_ERROR(
+      RunInParallel(num_chunks, num_threads, [&](const int chunk_idx) {
+        auto* cond_set =
+            (chunk_idx == 0) ? &pdp_set : &chunk_sets[chunk_idx - 1];
+        return UpdateConditionalExpectationPlotSetWithEngine(
+            context, chunks[chunk_idx].first, chunks[chunk_idx].second,
+            cond_set);
+      }));
+
+  for (const auto& chunk_set : chunk_sets) {
+    for (int plot_idx = 0; plot_idx < pdp_set.pdps_size(); plot_idx++) {
+      RETURN_IF_ERROR(AddPartialDependencePlot(
+          chunk_set.pdps(plot_idx), pdp_set.mutable_pdps(plot_idx)));
+    }
+  }
   return pdp_set;
 }
 
@@ -74,16 +74,25 @@ absl::Status UpdateConditionalExpectationPlotSet(
     ConditionalExpectationPlotSet* cond_set);
 
 // Given a dataset and a model, computes a PartialDependencePlotSet locally.
+//
+// If the model has a fast engine (see "AbstractModel::BuildFastEngine"), the
+// examples are processed in batches with the fast engine, and the work is
+// distributed over "num_threads" threads (by plot and by block of examples).
+// The plots of attributes not used by any condition of a decision forest are
+// flat: The model is only applied once per example for those. For Gradient
+// Boosted Trees and Random Forests, the trees not using the attributes of a
+// plot are evaluated once per example, and only the other trees are evaluated
+// for each bin. Otherwise, the slow generic inference is used.
 absl::StatusOr<PartialDependencePlotSet> ComputePartialDependencePlotSet(
     const dataset::VerticalDataset& dataset, const model::AbstractModel& model,
     const std::vector<std::vector<int>>& attribute_idxs, int num_numerical_bins,
-    float example_sampling);
+    float example_sampling, int num_threads = 1);
 
 absl::StatusOr<ConditionalExpectationPlotSet>
 ComputeConditionalExpectationPlotSet(
     const dataset::VerticalDataset& dataset, const model::AbstractModel& model,
     const std::vector<std::vector<int>>& attribute_idxs, int num_numerical_bins,
-    float example_sampling);
+    float example_sampling, int num_threads = 1);
 
 // Appends all the "num_dims"-dimensional combinations of input features.
 absl::Status AppendAttributesCombinations(
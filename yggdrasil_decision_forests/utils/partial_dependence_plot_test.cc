@@ -15,6 +15,8 @@
 
 #include "yggdrasil_decision_forests/utils/partial_dependence_plot.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -27,11 +29,14 @@
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
 #include "yggdrasil_decision_forests/dataset/example.pb.h"
 #include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
 #include "yggdrasil_decision_forests/model/decision_tree/decision_tree.pb.h"
 #include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
 #include "yggdrasil_decision_forests/utils/test.h"
+#include "yggdrasil_decision_forests/utils/test_utils.h"
+#include "yggdrasil_decision_forests/utils/testing_macros.h"
 
 namespace yggdrasil_decision_forests {
 namespace utils {
@@ -903,6 +908,116 @@ TEST(SortedUniqueCounts, Basic) {
             internal::SortedUniqueCounts({1, nan, 5, nan, 1, 2}));
 }
 
+// Checks that two plot sets are equal up to the numerical differences between
+// the inference engines.
+void ExpectNearPlotSets(const proto::PartialDependencePlotSet& a,
+                        const proto::PartialDependencePlotSet& b) {
+  ASSERT_EQ(a.pdps_size(), b.pdps_size());
+  for (int pdp_idx = 0; pdp_idx < a.pdps_size(); pdp_idx++) {
+    const auto& pdp_a = a.pdps(pdp_idx);
+    const auto& pdp_b = b.pdps(pdp_idx);
+    const double margin = 1e-3 * pdp_a.num_observations();
+    EXPECT_NEAR(pdp_a.num_observations(), pdp_b.num_observations(), margin);
+    ASSERT_EQ(pdp_a.attribute_info_size(), pdp_b.attribute_info_size());
+    for (int info_idx = 0; info_idx < pdp_a.attribute_info_size();
+         info_idx++) {
+      EXPECT_THAT(pdp_a.attribute_info(info_idx),
+                  EqualsProto(pdp_b.attribute_info(info_idx)));
+    }
+    ASSERT_EQ(pdp_a.pdp_bins_size(), pdp_b.pdp_bins_size());
+    for (int bin_idx = 0; bin_idx < pdp_a.pdp_bins_size(); bin_idx++) {
+      const auto& bin_a = pdp_a.pdp_bins(bin_idx);
+      const auto& bin_b = pdp_b.pdp_bins(bin_idx);
+      for (const auto& accumulators :
+           {std::make_pair(bin_a.prediction(), bin_b.prediction()),
+            std::make_pair(bin_a.ground_truth(), bin_b.ground_truth())}) {
+        const auto& dist_a =
+            accumulators.first.classification_class_distribution();
+        const auto& dist_b =
+            accumulators.second.classification_class_distribution();
+        ASSERT_EQ(dist_a.counts_size(), dist_b.counts_size());
+        for (int i = 0; i < dist_a.counts_size(); i++) {
+          EXPECT_NEAR(dist_a.counts(i), dist_b.counts(i), margin);
+        }
+        const double sum_a = accumulators.first.sum_of_regression_predictions();
+        EXPECT_NEAR(sum_a,
+                    accumulators.second.sum_of_regression_predictions(),
+                    std::abs(sum_a) * 1e-4 + 1e-6);
+      }
+      // A few predictions close to the decision threshold can flip.
+      EXPECT_NEAR(bin_a.evaluation().num_correct_predictions(),
+                  bin_b.evaluation().num_correct_predictions(), 2);
+      EXPECT_NEAR(bin_a.evaluation().sum_squared_error(),
+                  bin_b.evaluation().sum_squared_error(),
+                  bin_a.evaluation().sum_squared_error() * 1e-3 + 1e-6);
+    }
+  }
+}
+
+// Computing the plots with the fast engine and multiple threads gives the same
+// results as the generic inference, one example at a time.
+TEST(ComputePlotSet, SameAsGenericInference) {
+  const int num_numerical_bins = 10;
+
+  for (const auto& model_and_dataset :
+       std::vector<std::pair<std::string, std::string>>{
+           {"adult_binary_class_gbdt", "adult_test.csv"},
+           {"iris_multi_class_gbdt", "iris.csv"},
+           {"iris_multi_class_rf", "iris.csv"},
+           {"abalone_regression_gbdt", "abalone.csv"}}) {
+    SCOPED_TRACE(model_and_dataset.first);
+    std::unique_ptr<model::AbstractModel> model;
+    dataset::VerticalDataset dataset;
+    ASSERT_OK(LoadTestModelAndDataset(model_and_dataset.first,
+                                      model_and_dataset.second, &model,
+                                      &dataset, /*max_num_examples=*/300));
+
+    const auto& input_features = model->input_features();
+    const std::vector<std::vector<int>> attribute_idxs = {
+        {input_features[0]},
+        {input_features[1]},
+        {input_features[0], input_features[1]}};
+
+    // Generic inference.
+    ASSERT_OK_AND_ASSIGN(
+        auto expected_pdp,
+        InitializePartialDependencePlotSet(
+            model->data_spec(), attribute_idxs, model->task(),
+            model->label_col_idx(), num_numerical_bins, dataset));
+    ASSERT_OK_AND_ASSIGN(
+        auto expected_cep,
+        InitializeConditionalExpectationPlotSet(
+            model->data_spec(), attribute_idxs, model->task(),
+            model->label_col_idx(), num_numerical_bins, dataset));
+    dataset::proto::Example example;
+    for (dataset::VerticalDataset::row_t row = 0; row < dataset.nrow();
+         row++) {
+      dataset.ExtractExample(row, &example);
+      ASSERT_OK(UpdatePartialDependencePlotSet(*model, example, &expected_pdp));
+      ASSERT_OK(
+          UpdateConditionalExpectationPlotSet(*model, example, &expected_cep));
+    }
+
+    for (const int num_threads : {1, 4}) {
+      ASSERT_OK_AND_ASSIGN(
+          const auto pdp,
+          ComputePartialDependencePlotSet(dataset, *model, attribute_idxs,
+                                          num_numerical_bins,
+                                          /*example_sampling=*/1.f,
+                                          num_threads));
+      ExpectNearPlotSets(pdp, expected_pdp);
+
+      ASSERT_OK_AND_ASSIGN(
+          const auto cep,
+          ComputeConditionalExpectationPlotSet(dataset, *model, attribute_idxs,
+                                               num_numerical_bins,
+                                               /*example_sampling=*/1.f,
+                                               num_threads));
+      ExpectNearPlotSets(cep, expected_cep);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace utils
 }  // namespace yggdrasil_decision_forests
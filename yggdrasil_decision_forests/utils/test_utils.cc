@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <cstring>
 #include <memory>
+#include <numeric>
 #include <random>
 #include <string>
 #include <utility>
@@ -62,6 +63,7 @@
 #include "yggdrasil_decision_forests/utils/filesystem.h"
 #include "yggdrasil_decision_forests/utils/logging.h"
 #include "yggdrasil_decision_forests/utils/random.h"
+#include "yggdrasil_decision_forests/utils/status_macros.h"
 #include "yggdrasil_decision_forests/utils/test.h"
 #include "yggdrasil_decision_forests/utils/uid.h"
 
@@ -944,5 +946,27 @@ int GetVariableImportanceRank(
   return std::distance(variable_importance.begin(), found_iterator);
 }
 
+absl::Status LoadTestModelAndDataset(
+    const absl::string_view model_name, const absl::string_view dataset_name,
+    std::unique_ptr<model::AbstractModel>* model,
+    dataset::VerticalDataset* dataset,
+    const absl::optional<dataset::VerticalDataset::row_t> max_num_examples) {
+  const auto test_data_dir = file::JoinPath(
+      test::DataRootDirectory(), "yggdrasil_decision_forests/test_data");
+  RETURN_IF_ERROR(model::LoadModel(
+      file::JoinPath(test_data_dir, "model", model_name), model));
+  RETURN_IF_ERROR(dataset::LoadVerticalDataset(
+      absl::StrCat("csv:",
+                   file::JoinPath(test_data_dir, "dataset", dataset_name)),
+      (*model)->data_spec(), dataset));
+  if (max_num_examples.has_value() &&
+      max_num_examples.value() < dataset->nrow()) {
+    std::vector<dataset::VerticalDataset::row_t> rows(max_num_examples.value());
+    std::iota(rows.begin(), rows.end(), 0);
+    ASSIGN_OR_RETURN(*dataset, dataset->Extract(rows));
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace utils
 }  // namespace yggdrasil_decision_forests
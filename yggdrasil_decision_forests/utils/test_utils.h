@@ -45,6 +45,7 @@
 
 #include "gtest/gtest.h"
 #include "absl/random/random.h"
+#include "absl/status/status.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
@@ -362,6 +363,15 @@ int GetVariableImportanceRank(
     const dataset::proto::DataSpecification& data_spec,
     const std::vector<model::proto::VariableImportance>& variable_importance);
 
+// Loads the model "model_name" from "test_data/model" and the csv dataset
+// "dataset_name" from "test_data/dataset" with the dataspec of the model. If
+// set, only the first "max_num_examples" examples of the dataset are kept.
+absl::Status LoadTestModelAndDataset(
+    absl::string_view model_name, absl::string_view dataset_name,
+    std::unique_ptr<model::AbstractModel>* model,
+    dataset::VerticalDataset* dataset,
+    absl::optional<dataset::VerticalDataset::row_t> max_num_examples = {});
+
 }  // namespace utils
 }  // namespace yggdrasil_decision_forests
 